@@ -86,6 +86,10 @@ mag_converter_min_fov               = 0.001
 
 labels_amount                       = 3.0
 init_bortle_scale                   = 2
+flag_parallel_draw                  = false
+flag_repack_catalogs                = false
+flag_stream_catalogs                = false
+stream_cache_size                   = 256
 
 [custom_selected_info]
 flag_show_absolutemagnitude         = false
@@ -275,6 +279,9 @@ flag_planets                        = true
 flag_planets_hints                  = false
 flag_planets_orbits                 = false
 flag_light_travel_time              = true
+flag_parallel_positions             = false
+compact_minor_bodies_threshold      = 10000
+flag_solar_system_cache             = true
 flag_object_trails                  = false
 flag_nebula                         = true
 flag_nebula_name                    = false
@@ -300,6 +307,8 @@ flag_use_de430                      = false
 flag_use_de431                      = false
 de430_path                          = ""
 de431_path                          = ""
+flag_ephemeris_cache                = true
+ephemeris_cache_accuracy            = 1e-9
 
 [init_location]
 location                            = auto
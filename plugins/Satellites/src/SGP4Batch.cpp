@@ -0,0 +1,349 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "SGP4Batch.hpp"
+
+#include <QtConcurrent>
+
+#include <cmath>
+
+// Same constants as gSatTEME
+#define CONSTANTS_SET wgs72
+// Number of satellites of a job
+#define NEAR_EARTH_JOB_SIZE 512
+#define DEEP_SPACE_JOB_SIZE 64
+
+static const int Lanes = SGP4Batch::Lanes;
+
+class SGP4Batch::PropagationStep
+{
+public:
+	PropagationStep(SGP4Batch* batch, double jd) : batch(batch), jd(jd) {}
+	void operator()(const Job& job) const
+	{
+		if (job.deepSpace)
+			batch->propagateDeepSpace(job.first, job.count, jd);
+		else
+			batch->propagateNearEarth(job.first, job.count, jd);
+	}
+private:
+	SGP4Batch* batch;
+	double jd;
+};
+
+SGP4Batch::SGP4Batch()
+	: jd(0.)
+	, jobsDirty(false)
+{
+}
+
+void SGP4Batch::clear()
+{
+	*this = SGP4Batch();
+}
+
+int SGP4Batch::append(const elsetrec& satrec)
+{
+	const int index = error.size();
+	if (satrec.method=='d')
+	{
+		deepSpaceSatellite.append(index);
+		deepSpaceRecords.append(satrec);
+	}
+	else
+	{
+		nearEarthSatellite.append(index);
+		jdsatepoch.append(satrec.jdsatepoch);
+		isimp.append(satrec.isimp==1);
+		mo.append(satrec.mo);
+		mdot.append(satrec.mdot);
+		argpo.append(satrec.argpo);
+		argpdot.append(satrec.argpdot);
+		nodeo.append(satrec.nodeo);
+		nodedot.append(satrec.nodedot);
+		nodecf.append(satrec.nodecf);
+		cc1.append(satrec.cc1);
+		cc4.append(satrec.cc4);
+		cc5.append(satrec.cc5);
+		bstar.append(satrec.bstar);
+		t2cof.append(satrec.t2cof);
+		t3cof.append(satrec.t3cof);
+		t4cof.append(satrec.t4cof);
+		t5cof.append(satrec.t5cof);
+		omgcof.append(satrec.omgcof);
+		xmcof.append(satrec.xmcof);
+		eta.append(satrec.eta);
+		delmo.append(satrec.delmo);
+		d2.append(satrec.d2);
+		d3.append(satrec.d3);
+		d4.append(satrec.d4);
+		sinmao.append(satrec.sinmao);
+		no.append(satrec.no);
+		ecco.append(satrec.ecco);
+		inclo.append(satrec.inclo);
+		aycof.append(satrec.aycof);
+		xlcof.append(satrec.xlcof);
+		con41.append(satrec.con41);
+		x1mth2.append(satrec.x1mth2);
+		x7thm1.append(satrec.x7thm1);
+		double tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2;
+		getgravconst(CONSTANTS_SET, tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2);
+		// sgp4() fails with error 2 when no<=0, the value is then not used.
+		ano.append(satrec.no > 0.0 ? std::pow((xke / satrec.no), 2.0 / 3.0) : 1.0);
+		sinio.append(std::sin(satrec.inclo));
+		cosio.append(std::cos(satrec.inclo));
+	}
+	posX.append(0.); posY.append(0.); posZ.append(0.);
+	velX.append(0.); velY.append(0.); velZ.append(0.);
+	error.append(0);
+	jobsDirty = true;
+	return index;
+}
+
+void SGP4Batch::updateJobs()
+{
+	jobs.clear();
+	for (int first=0;first<nearEarthSatellite.size();first+=NEAR_EARTH_JOB_SIZE)
+	{
+		const Job job = {false, first, qMin(NEAR_EARTH_JOB_SIZE, nearEarthSatellite.size()-first)};
+		jobs.append(job);
+	}
+	for (int first=0;first<deepSpaceSatellite.size();first+=DEEP_SPACE_JOB_SIZE)
+	{
+		const Job job = {true, first, qMin(DEEP_SPACE_JOB_SIZE, deepSpaceSatellite.size()-first)};
+		jobs.append(job);
+	}
+	jobsDirty = false;
+}
+
+void SGP4Batch::propagate(double ajd, bool parallel)
+{
+	jd = ajd;
+	if (jobsDirty)
+		updateJobs();
+	const PropagationStep step(this, jd);
+	if (parallel && jobs.size()>1)
+		QtConcurrent::blockingMap(jobs, step);
+	else
+	{
+		for (int i=0;i<jobs.size();++i)
+			step(jobs.at(i));
+	}
+}
+
+void SGP4Batch::propagateDeepSpace(int first, int count, double jd)
+{
+	for (int k=first;k<first+count;++k)
+	{
+		elsetrec& satrec = deepSpaceRecords[k];
+		// Same as gSatTEME::setEpoch()
+		const double tsince = (jd-satrec.jdsatepoch)*86400./60.;
+		double r[3] = {};
+		double v[3] = {};
+		sgp4(CONSTANTS_SET, satrec, tsince, r, v);
+		const int i = deepSpaceSatellite.at(k);
+		posX[i] = r[0]; posY[i] = r[1]; posZ[i] = r[2];
+		velX[i] = v[0]; velY[i] = v[1]; velZ[i] = v[2];
+		error[i] = satrec.error;
+	}
+}
+
+// The computations of sgp4() for method 'n', lane by lane. The comments of sgp4() are not repeated.
+void SGP4Batch::propagateNearEarth(int first, int count, double jd)
+{
+	double tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2;
+	getgravconst(CONSTANTS_SET, tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2);
+	const double vkmpersec = radiusearthkm * xke/60.0;
+	const double twopi = 2.0 * M_PI;
+
+	for (int block=first;block<first+count;block+=Lanes)
+	{
+		const int nb = qMin(Lanes, first+count-block);
+		// The unused lanes of the last block repeat its last satellite.
+		int k[Lanes];
+		for (int l=0;l<Lanes;++l)
+			k[l] = block+qMin(l, nb-1);
+
+		double t[Lanes], mm[Lanes], argpm[Lanes], nodem[Lanes], tempa[Lanes], tempe[Lanes], templ[Lanes];
+		int err[Lanes];
+		for (int l=0;l<Lanes;++l)
+		{
+			const int s = k[l];
+			t[l] = (jd-jdsatepoch[s])*86400./60.;
+			const double xmdf = mo[s] + mdot[s] * t[l];
+			const double argpdf = argpo[s] + argpdot[s] * t[l];
+			const double nodedf = nodeo[s] + nodedot[s] * t[l];
+			const double t2 = t[l] * t[l];
+			argpm[l] = argpdf;
+			mm[l] = xmdf;
+			nodem[l] = nodedf + nodecf[s] * t2;
+			tempa[l] = 1.0 - cc1[s] * t[l];
+			tempe[l] = bstar[s] * cc4[s] * t[l];
+			templ[l] = t2cof[s] * t2;
+			if (!isimp[s])
+			{
+				const double delomg = omgcof[s] * t[l];
+				const double delm = xmcof[s] * (std::pow((1.0 + eta[s] * std::cos(xmdf)), 3) - delmo[s]);
+				const double temp = delomg + delm;
+				mm[l] = xmdf + temp;
+				argpm[l] = argpdf - temp;
+				const double t3 = t2 * t[l];
+				const double t4 = t3 * t[l];
+				tempa[l] = tempa[l] - d2[s] * t2 - d3[s] * t3 - d4[s] * t4;
+				tempe[l] = tempe[l] + bstar[s] * cc5[s] * (std::sin(mm[l]) - sinmao[s]);
+				templ[l] = templ[l] + t3cof[s] * t3 + t4 * (t4cof[s] + t[l] * t5cof[s]);
+			}
+		}
+
+		double am[Lanes], nm[Lanes], em[Lanes], axnl[Lanes], aynl[Lanes], xl[Lanes], nodep[Lanes], u[Lanes];
+		double sinip[Lanes], cosip[Lanes], xincp[Lanes];
+		for (int l=0;l<Lanes;++l)
+		{
+			const int s = k[l];
+			err[l] = 0;
+			nm[l] = no[s];
+			if (nm[l] <= 0.0)
+			{
+				err[l] = 2;
+				nm[l] = 1.0;	// The lane goes on with harmless values.
+			}
+			am[l] = ano[s] * tempa[l] * tempa[l];
+			nm[l] = xke / std::pow(am[l], 1.5);
+			em[l] = ecco[s] - tempe[l];
+			if (err[l]==0 && ((em[l] >= 1.0) || (em[l] < -0.001)))
+				err[l] = 1;
+			if (em[l] < 1.0e-6)
+				em[l] = 1.0e-6;
+			mm[l] = mm[l] + no[s] * templ[l];
+			double xlm = mm[l] + argpm[l] + nodem[l];
+			nodem[l] = std::fmod(nodem[l], twopi);
+			argpm[l] = std::fmod(argpm[l], twopi);
+			xlm = std::fmod(xlm, twopi);
+			mm[l] = std::fmod(xlm - argpm[l] - nodem[l], twopi);
+
+			xincp[l] = inclo[s];
+			sinip[l] = sinio[s];
+			cosip[l] = cosio[s];
+			const double ep = em[l];
+			const double argpp = argpm[l];
+			nodep[l] = nodem[l];
+			axnl[l] = ep * std::cos(argpp);
+			const double temp = 1.0 / (am[l] * (1.0 - ep * ep));
+			aynl[l] = ep* std::sin(argpp) + temp * aycof[s];
+			xl[l] = mm[l] + argpp + nodep[l] + temp * xlcof[s] * axnl[l];
+			u[l] = std::fmod(xl[l] - nodep[l], twopi);
+		}
+
+		// Kepler's equation, each lane stops when it converged as in sgp4().
+		double eo1[Lanes], tem5[Lanes], sineo1[Lanes], coseo1[Lanes];
+		for (int l=0;l<Lanes;++l)
+		{
+			eo1[l] = u[l];
+			tem5[l] = 9999.9;
+			sineo1[l] = 0.0;
+			coseo1[l] = 0.0;
+		}
+		for (int ktr=1;ktr<=10;++ktr)
+		{
+			bool active = false;
+			for (int l=0;l<Lanes;++l)
+			{
+				if (std::fabs(tem5[l]) < 1.0e-12)
+					continue;
+				active = true;
+				sineo1[l] = std::sin(eo1[l]);
+				coseo1[l] = std::cos(eo1[l]);
+				double tem = 1.0 - coseo1[l] * axnl[l] - sineo1[l] * aynl[l];
+				tem = (u[l] - aynl[l] * coseo1[l] + axnl[l] * sineo1[l] - eo1[l]) / tem;
+				if (std::fabs(tem) >= 0.95)
+					tem = tem > 0.0 ? 0.95 : -0.95;
+				eo1[l] = eo1[l] + tem;
+				tem5[l] = tem;
+			}
+			if (!active)
+				break;
+		}
+
+		for (int l=0;l<nb;++l)
+		{
+			const int s = k[l];
+			const int index = nearEarthSatellite.at(s);
+			double mrt = 0.0;
+			const double ecose = axnl[l]*coseo1[l] + aynl[l]*sineo1[l];
+			const double esine = axnl[l]*sineo1[l] - aynl[l]*coseo1[l];
+			const double el2 = axnl[l]*axnl[l] + aynl[l]*aynl[l];
+			const double pl = am[l]*(1.0-el2);
+			if (err[l]==0 && pl < 0.0)
+				err[l] = 4;
+			if (err[l]!=0)
+			{
+				// sgp4() returns before computing the state vector.
+				posX[index] = posY[index] = posZ[index] = 0.;
+				velX[index] = velY[index] = velZ[index] = 0.;
+				error[index] = err[l];
+				continue;
+			}
+
+			const double rl = am[l] * (1.0 - ecose);
+			const double rdotl = std::sqrt(am[l]) * esine/rl;
+			const double rvdotl = std::sqrt(pl) / rl;
+			const double betal = std::sqrt(1.0 - el2);
+			double temp = esine / (1.0 + betal);
+			const double sinu = am[l] / rl * (sineo1[l] - aynl[l] - axnl[l] * temp);
+			const double cosu = am[l] / rl * (coseo1[l] - axnl[l] + aynl[l] * temp);
+			double su = std::atan2(sinu, cosu);
+			const double sin2u = (cosu + cosu) * sinu;
+			const double cos2u = 1.0 - 2.0 * sinu * sinu;
+			temp = 1.0 / pl;
+			const double temp1 = 0.5 * j2 * temp;
+			const double temp2 = temp1 * temp;
+
+			mrt = rl * (1.0 - 1.5 * temp2 * betal * con41[s]) + 0.5 * temp1 * x1mth2[s] * cos2u;
+			su = su - 0.25 * temp2 * x7thm1[s] * sin2u;
+			const double xnode = nodep[l] + 1.5 * temp2 * cosip[l] * sin2u;
+			const double xinc = xincp[l] + 1.5 * temp2 * cosip[l] * sinip[l] * cos2u;
+			const double mvt = rdotl - nm[l] * temp1 * x1mth2[s] * sin2u / xke;
+			const double rvdot = rvdotl + nm[l] * temp1 * (x1mth2[s] * cos2u + 1.5 * con41[s]) / xke;
+
+			const double sinsu = std::sin(su);
+			const double cossu = std::cos(su);
+			const double snod = std::sin(xnode);
+			const double cnod = std::cos(xnode);
+			const double sini = std::sin(xinc);
+			const double cosi = std::cos(xinc);
+			const double xmx = -snod * cosi;
+			const double xmy = cnod * cosi;
+			const double ux = xmx * sinsu + cnod * cossu;
+			const double uy = xmy * sinsu + snod * cossu;
+			const double uz = sini * sinsu;
+			const double vx = xmx * cossu - cnod * sinsu;
+			const double vy = xmy * cossu - snod * sinsu;
+			const double vz = sini * cossu;
+
+			posX[index] = (mrt * ux)* radiusearthkm;
+			posY[index] = (mrt * uy)* radiusearthkm;
+			posZ[index] = (mrt * uz)* radiusearthkm;
+			velX[index] = (mvt * ux + rvdot * vx) * vkmpersec;
+			velY[index] = (mvt * uy + rvdot * vy) * vkmpersec;
+			velZ[index] = (mvt * uz + rvdot * vz) * vkmpersec;
+			// sgp4fix for decaying satellites
+			error[index] = mrt < 1.0 ? 6 : 0;
+		}
+	}
+}
@@ -0,0 +1,109 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _SGP4BATCH_HPP_
+#define _SGP4BATCH_HPP_
+
+#include "VecMath.hpp"
+#include "gsatellite/sgp4unit.h"
+
+#include <QVector>
+
+//! @class SGP4Batch
+//! Propagates the orbits of many satellites at once with SGP4.
+//! The constants of the near earth orbits (period below 225 minutes), computed by sgp4init(),
+//! are kept in one array per constant. They are propagated in blocks of Lanes satellites,
+//! with the computations of sgp4() in loops over the lanes, which read contiguous constants.
+//! The loops still branch per lane (simplified drag terms for isimp, convergence of Kepler's
+//! equation, error checks) and call the trigonometric functions of libm, so that the gain comes
+//! from the memory layout rather than from vectorization. The deep space orbits (SDP4) keep their elsetrec, and are
+//! propagated by sgp4() itself, as their resonance integration has a state per satellite.
+//! The satellites can be split in jobs computed by several threads.
+//! The results are the TEME positions and velocities of sgp4(), in km and km/s.
+//! @ingroup satellites
+class SGP4Batch
+{
+public:
+	//! Number of satellites propagated together.
+	static const int Lanes = 4;
+
+	SGP4Batch();
+
+	//! Add a satellite initialized by sgp4init() or twoline2rv(), and return its index.
+	int append(const elsetrec& satrec);
+	//! Remove all satellites.
+	void clear();
+	int size() const {return error.size();}
+
+	//! Propagate all satellites to the Julian day @em jd (UTC), as gSatTEME::setEpoch().
+	//! @param parallel compute the jobs in the global thread pool
+	void propagate(double jd, bool parallel);
+	double getJD() const {return jd;}
+
+	//! Get the TEME position of the satellite @em index in km, after propagate().
+	Vec3d getPosition(int index) const {return Vec3d(posX[index], posY[index], posZ[index]);}
+	//! Get the TEME velocity of the satellite @em index in km/s, after propagate().
+	Vec3d getVelocity(int index) const {return Vec3d(velX[index], velY[index], velZ[index]);}
+	//! Get the error code of sgp4() for the satellite @em index, 0 if the propagation succeeded.
+	int getError(int index) const {return error[index];}
+
+	//! A range of near earth or deep space satellites computed by one thread.
+	struct Job
+	{
+		bool deepSpace;
+		int first;
+		int count;
+	};
+
+private:
+	class PropagationStep;
+
+	//! Propagate the near earth satellites [first, first+count[, by blocks of Lanes.
+	void propagateNearEarth(int first, int count, double jd);
+	//! Propagate the deep space satellites [first, first+count[ with sgp4().
+	void propagateDeepSpace(int first, int count, double jd);
+	//! Split the satellites in jobs.
+	void updateJobs();
+
+	double jd;
+	QVector<Job> jobs;
+	bool jobsDirty;
+
+	// Constants of the near earth satellites, by near earth index
+	QVector<int> nearEarthSatellite;
+	QVector<double> jdsatepoch;
+	QVector<quint8> isimp;
+	QVector<double> mo, mdot, argpo, argpdot, nodeo, nodedot, nodecf;
+	QVector<double> cc1, cc4, cc5, bstar, t2cof, t3cof, t4cof, t5cof;
+	QVector<double> omgcof, xmcof, eta, delmo, d2, d3, d4, sinmao;
+	QVector<double> no, ecco, inclo, aycof, xlcof, con41, x1mth2, x7thm1;
+	//! Terms of sgp4() which only depend on the elements: (xke/no)^(2/3), sin and cos of inclo
+	QVector<double> ano, sinio, cosio;
+
+	// Deep space satellites
+	QVector<int> deepSpaceSatellite;
+	QVector<elsetrec> deepSpaceRecords;
+
+	// Results, by satellite index
+	QVector<double> posX, posY, posZ;
+	QVector<double> velX, velY, velZ;
+	QVector<int> error;
+};
+
+#endif // _SGP4BATCH_HPP_
@@ -43,6 +43,7 @@
 
 #include "gsatellite/gTime.hpp"
 #include "gsatellite/stdsat.h"
+#include "SGP4Batch.hpp"
 
 #include <cmath>
 
@@ -72,6 +73,11 @@ double Satellite::sunReflAngle = 180.;
 //double Satellite::timeShift = 0.;
 
 Satellite::Satellite(const QString& identifier, const QVariantMap& map)
+	: Satellite(SatelliteCatalogEntry::fromMap(identifier, map))
+{
+}
+
+Satellite::Satellite(const SatelliteCatalogEntry& entry)
 	: initialized(false)
 	, displayed(true)
 	, orbitDisplayed(false)
@@ -93,78 +99,31 @@ Satellite::Satellite(const QString& identifier, const QVariantMap& map)
 	, epochTime(0.)
 {
 	// return initialized if the mandatory fields are not present
-	if (identifier.isEmpty())
-		return;
-	if (!map.contains("name") || !map.contains("tle1") || !map.contains("tle2"))
+	if (entry.id.isEmpty() || entry.name.isEmpty() || entry.tle1.isEmpty() || entry.tle2.isEmpty())
 		return;
 
 	// Font size is 16
 	font.setPixelSize(StelApp::getInstance().getBaseFontSize()+3);
 
-	id = identifier;
-	name  = map.value("name").toString();
-	if (name.isEmpty())
-		return;
-	
-	// If there are no such keys, these will be initialized with the default
-	// values given them above.
-	description = map.value("description", description).toString().trimmed();
-	displayed = map.value("visible", displayed).toBool();
-	orbitDisplayed = map.value("orbitVisible", orbitDisplayed).toBool();
-	userDefined = map.value("userDefined", userDefined).toBool();
-	stdMag = map.value("stdMag", 99.f).toDouble();
-	status = map.value("status", StatusUnknown).toInt();
-	// Satellite hint color
-	QVariantList list = map.value("hintColor", QVariantList()).toList();
-	if (list.count() == 3)
-	{
-		hintColor[0] = list.at(0).toDouble();
-		hintColor[1] = list.at(1).toDouble();
-		hintColor[2] = list.at(2).toDouble();
-	}
-	
-	// Satellite orbit section color
-	list = map.value("orbitColor", QVariantList()).toList();
-	if (list.count() == 3)
-	{
-		orbitColor[0] = list.at(0).toDouble();
-		orbitColor[1] = list.at(1).toDouble();
-		orbitColor[2] = list.at(2).toDouble();
-	}
-	else
-	{
-		orbitColor = hintColor;
-	}
-
-	if (map.contains("comms"))
-	{
-		foreach(const QVariant &comm, map.value("comms").toList())
-		{
-			QVariantMap commMap = comm.toMap();
-			CommLink c;
-			if (commMap.contains("frequency")) c.frequency = commMap.value("frequency").toDouble();
-			if (commMap.contains("modulation")) c.modulation = commMap.value("modulation").toString();
-			if (commMap.contains("description")) c.description = commMap.value("description").toString();
-			comms.append(c);
-		}
-	}
-
-	QVariantList groupList =  map.value("groups", QVariantList()).toList();
-	if (!groupList.isEmpty())
-	{
-		foreach(const QVariant& group, groupList)
-			groups.insert(group.toString());
-	}
+	id = entry.id;
+	name = entry.name;
+	description = entry.description;
+	displayed = entry.visible;
+	orbitDisplayed = entry.orbitVisible;
+	userDefined = entry.userDefined;
+	stdMag = entry.stdMag;
+	status = entry.status;
+	hintColor = entry.hintColor;
+	orbitColor = entry.orbitColor;
+	comms = entry.comms;
+	foreach(const QString& group, entry.groups)
+		groups.insert(group);
 
 	// TODO: Somewhere here - some kind of TLE validation.
-	QString line1 = map.value("tle1").toString();
-	QString line2 = map.value("tle2").toString();
-	setNewTleElements(line1, line2);
+	setNewTleElements(QString::fromLatin1(entry.tle1), QString::fromLatin1(entry.tle2));
 	// This also sets the international designator and launch year.
 
-	QString dateString = map.value("lastUpdated").toString();
-	if (!dateString.isEmpty())
-		lastUpdated = QDateTime::fromString(dateString, Qt::ISODate);
+	lastUpdated = entry.lastUpdated;
 
 	orbitValid = true;
 	initialized = true;
@@ -195,49 +154,28 @@ QString Satellite::getNameI18n() const
 
 QVariantMap Satellite::getMap(void)
 {
-	QVariantMap map;
-	map["name"] = name;	
-	map["stdMag"] = stdMag;
-	map["status"] = status;
-	map["tle1"] = tleElements.first.data();
-	map["tle2"] = tleElements.second.data();
-
-	if (!description.isEmpty())
-		map["description"] = description;
-
-	map["visible"] = displayed;
-	map["orbitVisible"] = orbitDisplayed;
-	if (userDefined)
-		map.insert("userDefined", userDefined);
-	QVariantList col, orbitCol;
-	col << roundToDp(hintColor[0],3) << roundToDp(hintColor[1], 3) << roundToDp(hintColor[2], 3);
-	orbitCol << roundToDp(orbitColor[0], 3) << roundToDp(orbitColor[1], 3) << roundToDp(orbitColor[2],3);
-	map["hintColor"] = col;
-	map["orbitColor"] = orbitCol;
-	QVariantList commList;
-	foreach(const CommLink &c, comms)
-	{
-		QVariantMap commMap;
-		commMap["frequency"] = c.frequency;
-		if (!c.modulation.isEmpty()) commMap["modulation"] = c.modulation;
-		if (!c.description.isEmpty()) commMap["description"] = c.description;
-		commList << commMap;
-	}
-	map["comms"] = commList;
-	QVariantList groupList;
-	foreach(const QString &g, groups)
-	{
-		groupList << g;
-	}
-	map["groups"] = groupList;
-
-	if (!lastUpdated.isNull())
-	{
-		// A raw QDateTime is not a recognised JSON data type. --BM
-		map["lastUpdated"] = lastUpdated.toString(Qt::ISODate);
-	}
+	return getCatalogEntry().toMap();
+}
 
-	return map;
+SatelliteCatalogEntry Satellite::getCatalogEntry() const
+{
+	SatelliteCatalogEntry entry;
+	entry.id = id;
+	entry.name = name;
+	entry.description = description;
+	entry.tle1 = tleElements.first;
+	entry.tle2 = tleElements.second;
+	entry.visible = displayed;
+	entry.orbitVisible = orbitDisplayed;
+	entry.userDefined = userDefined;
+	entry.stdMag = stdMag;
+	entry.status = status;
+	entry.hintColor = hintColor;
+	entry.orbitColor = orbitColor;
+	entry.comms = comms;
+	entry.groups = groups.values();
+	entry.lastUpdated = lastUpdated;
+	return entry;
 }
 
 float Satellite::getSelectPriority(const StelCore*) const
@@ -766,34 +704,57 @@ void Satellite::update(double)
 		epochTime = core->getJD(); // + timeShift; // We have "true" JD (UTC) from core, satellites don't need JDE!
 
 		pSatWrapper->setEpoch(epochTime);
-		position                 = pSatWrapper->getTEMEPos();
-		velocity                 = pSatWrapper->getTEMEVel();
-		latLongSubPointPosition  = pSatWrapper->getSubPoint();
-		height                   = latLongSubPointPosition[2]; // km
-		if (height <= 150.0)
+		updatePosition(gSatWrapper::getFrameContext());
+	}
+}
+
+void Satellite::update(const SGP4Batch& batch, int index, const gSatFrameContext& frame)
+{
+	if (pSatWrapper && orbitValid)
+	{
+		if (batch.getError(index))
 		{
-			// The orbit is no longer valid.  Causes include very out of date
-			// TLE, system date and time out of a reasonable range, and orbital
-			// degradation and re-entry of a satellite.  In any of these cases
-			// we might end up with a problem - usually a crash of Stellarium
-			// because of a div/0 or something.  To prevent this, we turn off
-			// the satellite when the computed height is 150km. (We can assume bogus at 250km or so...)
-			qWarning() << "Satellite has invalid orbit:" << name << id;
+			// sgp4() failed, the state vector of the batch is not meaningful. See updatePosition().
+			qWarning() << "Satellite has invalid orbit:" << name << id << "SGP4 error" << batch.getError(index);
 			orbitValid = false;
-			displayed = false; // It shouldn't be displayed!
+			displayed = false;
 			return;
 		}
+		epochTime = frame.getEpoch();
+		pSatWrapper->setEpoch(epochTime, batch.getPosition(index), batch.getVelocity(index));
+		updatePosition(frame);
+	}
+}
 
-		elAzPosition = pSatWrapper->getAltAz();
-		elAzPosition.normalize();
+void Satellite::updatePosition(const gSatFrameContext& frame)
+{
+	position                 = pSatWrapper->getTEMEPos();
+	velocity                 = pSatWrapper->getTEMEVel();
+	latLongSubPointPosition  = pSatWrapper->getSubPoint();
+	height                   = latLongSubPointPosition[2]; // km
+	if (height <= 150.0)
+	{
+		// The orbit is no longer valid.  Causes include very out of date
+		// TLE, system date and time out of a reasonable range, and orbital
+		// degradation and re-entry of a satellite.  In any of these cases
+		// we might end up with a problem - usually a crash of Stellarium
+		// because of a div/0 or something.  To prevent this, we turn off
+		// the satellite when the computed height is 150km. (We can assume bogus at 250km or so...)
+		qWarning() << "Satellite has invalid orbit:" << name << id;
+		orbitValid = false;
+		displayed = false; // It shouldn't be displayed!
+		return;
+	}
 
-		pSatWrapper->getSlantRange(range, rangeRate);
-		visibility = pSatWrapper->getVisibilityPredict();
-		phaseAngle = pSatWrapper->getPhaseAngle();
+	elAzPosition = pSatWrapper->getAltAz(frame);
+	visibility = pSatWrapper->getVisibilityPredict(frame, elAzPosition);
+	elAzPosition.normalize();
 
-		// Compute orbit points to draw orbit line.
-		if (orbitDisplayed) computeOrbitPoints();
-	}
+	pSatWrapper->getSlantRange(frame, range, rangeRate);
+	phaseAngle = pSatWrapper->getPhaseAngle(frame);
+
+	// Compute orbit points to draw orbit line.
+	if (orbitDisplayed) computeOrbitPoints();
 }
 
 double Satellite::getDoppler(double freq) const
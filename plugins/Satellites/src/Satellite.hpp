@@ -32,20 +32,13 @@
 #include "StelTextureTypes.hpp"
 #include "StelSphereGeometry.hpp"
 #include "gSatWrapper.hpp"
+#include "SatelliteCatalogStore.hpp"
 
 
 class StelPainter;
+class SGP4Batch;
 class StelLocation;
 
-//! Radio communication channel properties.
-//! @ingroup satellites
-typedef struct
-{
-	double frequency; //!< Channel frequency in MHz.
-	QString modulation; //!< Signal modulation mode.
-	QString description; //!< Channel description.
-} CommLink;
-
 //! Description of the data roles used in SatellitesListModel.
 //! @ingroup satellites
 enum SatelliteDataRole {
@@ -115,11 +108,15 @@ public:
 	//! \param data a QMap which contains the details of the satellite
 	//! (TLE set, description etc.)
 	Satellite(const QString& identifier, const QVariantMap& data);
+	//! \param entry the data of the satellite in the catalog
+	Satellite(const SatelliteCatalogEntry& entry);
 	~Satellite();
 
 	//! Get a QVariantMap which describes the satellite.  Could be used to
 	//! create a duplicate.
 	QVariantMap getMap(void);
+	//! Get the data of the satellite in the catalog.
+	SatelliteCatalogEntry getCatalogEntry() const;
 
 	virtual QString getType(void) const
 	{
@@ -180,6 +177,10 @@ public:
 
 	// calculate faders, new position
 	void update(double deltaTime);
+	//! Same as update(), with the TEME state vector of the satellite @em index of @em batch,
+	//! propagated to the current date, and the observer data of @em frame at this date.
+	//! The orbit becomes invalid if the propagation of the batch failed.
+	void update(const SGP4Batch& batch, int index, const gSatFrameContext& frame);
 
 	double getDoppler(double freq) const;
 	static bool showLabels;
@@ -211,6 +212,9 @@ public:
 	QString getOperationalStatus() const;
 
 private:
+	//! Update the data derived from the position of pSatWrapper.
+	void updatePosition(const gSatFrameContext& frame);
+
 	//draw orbits methods
 	void computeOrbitPoints();
 	void drawOrbit(StelCore* core, StelPainter& painter);
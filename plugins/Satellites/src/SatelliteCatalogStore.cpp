@@ -0,0 +1,593 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "SatelliteCatalogStore.hpp"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Change it when the layout of the store changes.
+#define SATELLITE_STORE_VERSION 1
+static const char storeMagic[8] = {'S','T','E','L','S','A','T','S'};
+
+// Flags of the header
+#define STORE_JSON_EXPORT_PENDING 0x1
+
+// Flags of the records
+#define RECORD_VISIBLE 0x1
+#define RECORD_ORBIT_VISIBLE 0x2
+#define RECORD_USER_DEFINED 0x4
+#define RECORD_LAST_UPDATED 0x8
+
+// All numbers are little-endian, the floating point numbers are stored by their bits.
+struct SatelliteCatalogStore::Header
+{
+	char magic[8];
+	quint32 version;
+	quint32 recordSize;
+	quint32 nrOfRecords;
+	quint32 flags;
+	qint64 jsonSize;
+	qint64 jsonModified;	// msecs since epoch
+	char catalogVersion[20];
+	quint32 defaultHintColor[3];
+};
+
+// The strings are padded with zeros. The data of the entry outside of the record are
+// encoded by QDataStream, see encodeData().
+struct SatelliteCatalogStore::Record
+{
+	char id[16];
+	char tle1[72];
+	char tle2[72];
+	qint64 lastUpdated;	// msecs since epoch
+	quint64 stdMag;
+	quint32 hintColor[3];
+	quint32 orbitColor[3];
+	qint32 status;
+	quint32 flags;
+	quint32 dataOffset;
+	quint32 dataSize;
+};
+
+static quint32 floatToStore(float f)
+{
+	quint32 bits;
+	std::memcpy(&bits, &f, sizeof(bits));
+	return qToLittleEndian(bits);
+}
+
+static float floatFromStore(quint32 bits)
+{
+	bits = qFromLittleEndian(bits);
+	float f;
+	std::memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static quint64 doubleToStore(double d)
+{
+	quint64 bits;
+	std::memcpy(&bits, &d, sizeof(bits));
+	return qToLittleEndian(bits);
+}
+
+static double doubleFromStore(quint64 bits)
+{
+	bits = qFromLittleEndian(bits);
+	double d;
+	std::memcpy(&d, &bits, sizeof(d));
+	return d;
+}
+
+// Copy a string to a field padded with zeros, keeping a zero at the end.
+static bool copyField(char* field, int fieldSize, const QByteArray& value)
+{
+	if (value.size()>=fieldSize)
+		return false;
+	std::memset(field, 0, fieldSize);
+	std::memcpy(field, value.constData(), value.size());
+	return true;
+}
+
+static QByteArray readField(const char* field, int fieldSize)
+{
+	return QByteArray(field, qstrnlen(field, fieldSize));
+}
+
+// The catalog numbers are ordered by length, then by characters: the numbers
+// without leading zeros are in numerical order.
+static bool idLessThan(const QByteArray& a, const QByteArray& b)
+{
+	if (a.size()!=b.size())
+		return a.size()<b.size();
+	return a<b;
+}
+
+// Orders the indices of the entries by catalog number.
+class EntryOrder
+{
+public:
+	EntryOrder(const QVector<QByteArray>& ids) : ids(ids) {}
+	bool operator()(int a, int b) const
+	{
+		return idLessThan(ids.at(a), ids.at(b));
+	}
+private:
+	const QVector<QByteArray>& ids;
+};
+
+// Same as Satellite::roundToDp()
+static double roundToDp(float n, int dp)
+{
+	return std::floor(n * std::pow(10., dp) + .5) / std::pow(10., dp);
+}
+
+SatelliteCatalogEntry::SatelliteCatalogEntry()
+	: visible(true)
+	, orbitVisible(false)
+	, userDefined(false)
+	, stdMag(99.)
+	, status(0)
+	, hintColor(0.f, 0.f, 0.f)
+	, orbitColor(0.f, 0.f, 0.f)
+{
+}
+
+SatelliteCatalogEntry SatelliteCatalogEntry::fromMap(const QString& id, const QVariantMap& map)
+{
+	SatelliteCatalogEntry entry;
+	entry.id = id;
+	entry.name = map.value("name").toString();
+	entry.description = map.value("description").toString().trimmed();
+	entry.tle1 = map.value("tle1").toString().toLatin1();
+	entry.tle2 = map.value("tle2").toString().toLatin1();
+	entry.visible = map.value("visible", entry.visible).toBool();
+	entry.orbitVisible = map.value("orbitVisible", entry.orbitVisible).toBool();
+	entry.userDefined = map.value("userDefined", entry.userDefined).toBool();
+	entry.stdMag = map.value("stdMag", entry.stdMag).toDouble();
+	// Satellite::StatusUnknown by default
+	entry.status = map.value("status", entry.status).toInt();
+
+	QVariantList list = map.value("hintColor", QVariantList()).toList();
+	if (list.count() == 3)
+		entry.hintColor.set(list.at(0).toFloat(), list.at(1).toFloat(), list.at(2).toFloat());
+	list = map.value("orbitColor", QVariantList()).toList();
+	if (list.count() == 3)
+		entry.orbitColor.set(list.at(0).toFloat(), list.at(1).toFloat(), list.at(2).toFloat());
+	else
+		entry.orbitColor = entry.hintColor;
+
+	foreach(const QVariant &comm, map.value("comms").toList())
+	{
+		QVariantMap commMap = comm.toMap();
+		CommLink c;
+		c.frequency = commMap.value("frequency", 0.).toDouble();
+		c.modulation = commMap.value("modulation").toString();
+		c.description = commMap.value("description").toString();
+		entry.comms.append(c);
+	}
+	foreach(const QVariant& group, map.value("groups").toList())
+		entry.groups.append(group.toString());
+
+	QString dateString = map.value("lastUpdated").toString();
+	if (!dateString.isEmpty())
+		entry.lastUpdated = QDateTime::fromString(dateString, Qt::ISODate);
+	return entry;
+}
+
+QVariantMap SatelliteCatalogEntry::toMap() const
+{
+	QVariantMap map;
+	map.insert("name", name);
+	map.insert("stdMag", stdMag);
+	map.insert("status", status);
+	map.insert("tle1", QString::fromLatin1(tle1));
+	map.insert("tle2", QString::fromLatin1(tle2));
+	if (!description.isEmpty())
+		map.insert("description", description);
+	map.insert("visible", visible);
+	map.insert("orbitVisible", orbitVisible);
+	if (userDefined)
+		map.insert("userDefined", userDefined);
+	QVariantList col, orbitCol;
+	col << roundToDp(hintColor[0],3) << roundToDp(hintColor[1], 3) << roundToDp(hintColor[2], 3);
+	orbitCol << roundToDp(orbitColor[0], 3) << roundToDp(orbitColor[1], 3) << roundToDp(orbitColor[2],3);
+	map.insert("hintColor", col);
+	map.insert("orbitColor", orbitCol);
+	QVariantList commList;
+	foreach(const CommLink &c, comms)
+	{
+		QVariantMap commMap;
+		commMap.insert("frequency", c.frequency);
+		if (!c.modulation.isEmpty()) commMap.insert("modulation", c.modulation);
+		if (!c.description.isEmpty()) commMap.insert("description", c.description);
+		commList << commMap;
+	}
+	map.insert("comms", commList);
+	QVariantList groupList;
+	foreach(const QString &g, groups)
+		groupList << g;
+	map.insert("groups", groupList);
+	if (!lastUpdated.isNull())
+	{
+		// A raw QDateTime is not a recognised JSON data type. --BM
+		map.insert("lastUpdated", lastUpdated.toString(Qt::ISODate));
+	}
+	return map;
+}
+
+SatelliteCatalogStore::SatelliteCatalogStore()
+	: image(Q_NULLPTR)
+	, imageSize(0)
+	, nrOfRecords(0)
+{
+	// The layout must be the same on all platforms.
+	Q_STATIC_ASSERT(sizeof(Header)==72);
+	Q_STATIC_ASSERT(sizeof(Record)==216);
+}
+
+SatelliteCatalogStore::~SatelliteCatalogStore()
+{
+	close();
+}
+
+QByteArray SatelliteCatalogStore::encodeData(const SatelliteCatalogEntry& entry)
+{
+	QByteArray data;
+	QDataStream out(&data, QIODevice::WriteOnly);
+	out.setVersion(QDataStream::Qt_5_0);
+	out.setByteOrder(QDataStream::LittleEndian);
+	out << entry.name << entry.description << entry.groups << (quint32)entry.comms.size();
+	foreach(const CommLink& c, entry.comms)
+		out << c.frequency << c.modulation << c.description;
+	return data;
+}
+
+bool SatelliteCatalogStore::fillRecord(const SatelliteCatalogEntry& entry, Record& rec)
+{
+	std::memset(&rec, 0, sizeof(rec));
+	const QByteArray id = entry.id.toLatin1();
+	if (id.isEmpty() || !copyField(rec.id, sizeof(rec.id), id)
+	    || !copyField(rec.tle1, sizeof(rec.tle1), entry.tle1)
+	    || !copyField(rec.tle2, sizeof(rec.tle2), entry.tle2))
+		return false;
+	quint32 flags = 0;
+	if (entry.visible)
+		flags |= RECORD_VISIBLE;
+	if (entry.orbitVisible)
+		flags |= RECORD_ORBIT_VISIBLE;
+	if (entry.userDefined)
+		flags |= RECORD_USER_DEFINED;
+	if (!entry.lastUpdated.isNull())
+	{
+		flags |= RECORD_LAST_UPDATED;
+		rec.lastUpdated = qToLittleEndian(entry.lastUpdated.toMSecsSinceEpoch());
+	}
+	rec.flags = qToLittleEndian(flags);
+	rec.stdMag = doubleToStore(entry.stdMag);
+	rec.status = qToLittleEndian((qint32)entry.status);
+	for (int i=0;i<3;++i)
+	{
+		rec.hintColor[i] = floatToStore(entry.hintColor[i]);
+		rec.orbitColor[i] = floatToStore(entry.orbitColor[i]);
+	}
+	return true;
+}
+
+bool SatelliteCatalogStore::write(const QString& path, const QVector<SatelliteCatalogEntry>& entries,
+				  const QString& catalogVersion, const Vec3f& defaultHintColor,
+				  const QString& jsonPath, bool jsonExportPending)
+{
+	QVector<QByteArray> ids;
+	QVector<int> order;
+	ids.reserve(entries.size());
+	order.reserve(entries.size());
+	for (int i=0;i<entries.size();++i)
+	{
+		ids.append(entries.at(i).id.toLatin1());
+		order.append(i);
+	}
+	std::stable_sort(order.begin(), order.end(), EntryOrder(ids));
+
+	QVector<Record> records;
+	QByteArray data;
+	records.reserve(entries.size());
+	foreach(int i, order)
+	{
+		const SatelliteCatalogEntry& entry = entries.at(i);
+		if (!records.isEmpty() && ids.at(i)==readField(records.last().id, sizeof(records.last().id)))
+			continue;
+		Record rec;
+		if (!fillRecord(entry, rec))
+		{
+			qWarning() << "[Satellites] cannot store the satellite" << entry.id << entry.name;
+			continue;
+		}
+		const QByteArray entryData = encodeData(entry);
+		// Offset from the data block for now
+		rec.dataOffset = data.size();
+		rec.dataSize = qToLittleEndian((quint32)entryData.size());
+		data.append(entryData);
+		records.append(rec);
+	}
+	const qint64 dataStart = sizeof(Header) + (qint64)records.size()*sizeof(Record);
+	if (dataStart + data.size() > 0xffffffffLL)
+		return false;
+	for (int i=0;i<records.size();++i)
+		records[i].dataOffset = qToLittleEndian((quint32)(dataStart + records.at(i).dataOffset));
+
+	Header h;
+	std::memset(&h, 0, sizeof(h));
+	std::memcpy(h.magic, storeMagic, sizeof(h.magic));
+	h.version = qToLittleEndian((quint32)SATELLITE_STORE_VERSION);
+	h.recordSize = qToLittleEndian((quint32)sizeof(Record));
+	h.nrOfRecords = qToLittleEndian((quint32)records.size());
+	h.flags = qToLittleEndian((quint32)(jsonExportPending ? STORE_JSON_EXPORT_PENDING : 0));
+	const QFileInfo jsonInfo(jsonPath);
+	h.jsonSize = qToLittleEndian(jsonInfo.exists() ? jsonInfo.size() : Q_INT64_C(-1));
+	h.jsonModified = qToLittleEndian(jsonInfo.exists() ? jsonInfo.lastModified().toMSecsSinceEpoch() : Q_INT64_C(-1));
+	copyField(h.catalogVersion, sizeof(h.catalogVersion), catalogVersion.toLatin1().left(sizeof(h.catalogVersion)-1));
+	for (int i=0;i<3;++i)
+		h.defaultHintColor[i] = floatToStore(defaultHintColor[i]);
+
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+	file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+	file.write(reinterpret_cast<const char*>(records.constData()), (qint64)records.size()*sizeof(Record));
+	file.write(data);
+	return file.commit();
+}
+
+bool SatelliteCatalogStore::map()
+{
+	imageSize = file.size();
+	image = imageSize>0 ? file.map(0, imageSize) : Q_NULLPTR;
+	return image!=Q_NULLPTR;
+}
+
+void SatelliteCatalogStore::unmap()
+{
+	if (image)
+		file.unmap(image);
+	image = Q_NULLPTR;
+	imageSize = 0;
+}
+
+bool SatelliteCatalogStore::open(const QString& path)
+{
+	close();
+	file.setFileName(path);
+	if (!file.open(QIODevice::ReadWrite) || !map() || imageSize<(qint64)sizeof(Header))
+	{
+		close();
+		return false;
+	}
+	const Header* h = header();
+	const qint64 count = qFromLittleEndian(h->nrOfRecords);
+	if (std::memcmp(h->magic, storeMagic, sizeof(h->magic))!=0
+	    || qFromLittleEndian(h->version)!=SATELLITE_STORE_VERSION
+	    || qFromLittleEndian(h->recordSize)!=sizeof(Record)
+	    || imageSize<(qint64)sizeof(Header)+count*(qint64)sizeof(Record))
+	{
+		qWarning() << "[Satellites] invalid catalog store" << QDir::toNativeSeparators(path);
+		close();
+		return false;
+	}
+	nrOfRecords = (int)count;
+	for (int i=0;i<nrOfRecords;++i)
+	{
+		const Record* rec = record(i);
+		if ((qint64)qFromLittleEndian(rec->dataOffset)+qFromLittleEndian(rec->dataSize)>imageSize
+		    || (i>0 && !idLessThan(readField(record(i-1)->id, sizeof(rec->id)), readField(rec->id, sizeof(rec->id)))))
+		{
+			qWarning() << "[Satellites] invalid catalog store" << QDir::toNativeSeparators(path);
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void SatelliteCatalogStore::close()
+{
+	unmap();
+	if (file.isOpen())
+		file.close();
+	nrOfRecords = 0;
+}
+
+const SatelliteCatalogStore::Header* SatelliteCatalogStore::header() const
+{
+	return reinterpret_cast<const Header*>(image);
+}
+
+const SatelliteCatalogStore::Record* SatelliteCatalogStore::record(int index) const
+{
+	return reinterpret_cast<const Record*>(image + sizeof(Header) + (qint64)index*sizeof(Record));
+}
+
+SatelliteCatalogStore::Record* SatelliteCatalogStore::record(int index)
+{
+	return reinterpret_cast<Record*>(image + sizeof(Header) + (qint64)index*sizeof(Record));
+}
+
+int SatelliteCatalogStore::indexOf(const QString& id) const
+{
+	const QByteArray key = id.toLatin1();
+	int first = 0;
+	int count = nrOfRecords;
+	while (count>0)
+	{
+		const int step = count/2;
+		if (idLessThan(readField(record(first+step)->id, sizeof(Record::id)), key))
+		{
+			first += step+1;
+			count -= step+1;
+		}
+		else
+			count = step;
+	}
+	if (first<nrOfRecords && readField(record(first)->id, sizeof(Record::id))==key)
+		return first;
+	return -1;
+}
+
+QString SatelliteCatalogStore::getId(int index) const
+{
+	return QString::fromLatin1(readField(record(index)->id, sizeof(Record::id)));
+}
+
+SatelliteCatalogEntry SatelliteCatalogStore::getEntry(int index) const
+{
+	SatelliteCatalogEntry entry;
+	const Record* rec = record(index);
+	entry.id = getId(index);
+	entry.tle1 = readField(rec->tle1, sizeof(rec->tle1));
+	entry.tle2 = readField(rec->tle2, sizeof(rec->tle2));
+	const quint32 flags = qFromLittleEndian(rec->flags);
+	entry.visible = (flags & RECORD_VISIBLE)!=0;
+	entry.orbitVisible = (flags & RECORD_ORBIT_VISIBLE)!=0;
+	entry.userDefined = (flags & RECORD_USER_DEFINED)!=0;
+	if (flags & RECORD_LAST_UPDATED)
+		entry.lastUpdated = QDateTime::fromMSecsSinceEpoch(qFromLittleEndian(rec->lastUpdated));
+	entry.stdMag = doubleFromStore(rec->stdMag);
+	entry.status = qFromLittleEndian(rec->status);
+	entry.hintColor.set(floatFromStore(rec->hintColor[0]), floatFromStore(rec->hintColor[1]), floatFromStore(rec->hintColor[2]));
+	entry.orbitColor.set(floatFromStore(rec->orbitColor[0]), floatFromStore(rec->orbitColor[1]), floatFromStore(rec->orbitColor[2]));
+
+	const QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char*>(image) + qFromLittleEndian(rec->dataOffset), qFromLittleEndian(rec->dataSize));
+	QDataStream in(data);
+	in.setVersion(QDataStream::Qt_5_0);
+	in.setByteOrder(QDataStream::LittleEndian);
+	quint32 nrOfComms = 0;
+	in >> entry.name >> entry.description >> entry.groups >> nrOfComms;
+	for (quint32 i=0;i<nrOfComms && in.status()==QDataStream::Ok;++i)
+	{
+		CommLink c;
+		in >> c.frequency >> c.modulation >> c.description;
+		entry.comms.append(c);
+	}
+	if (in.status()!=QDataStream::Ok)
+		qWarning() << "[Satellites] invalid data in the catalog store for" << entry.id;
+	return entry;
+}
+
+QVector<SatelliteCatalogEntry> SatelliteCatalogStore::getEntries() const
+{
+	QVector<SatelliteCatalogEntry> entries;
+	entries.reserve(nrOfRecords);
+	for (int i=0;i<nrOfRecords;++i)
+		entries.append(getEntry(i));
+	return entries;
+}
+
+bool SatelliteCatalogStore::setEntry(int index, const SatelliteCatalogEntry& entry)
+{
+	if (!isOpen() || index<0 || index>=nrOfRecords || entry.id!=getId(index))
+		return false;
+	Record rec;
+	if (!fillRecord(entry, rec))
+		return false;
+
+	const QByteArray data = encodeData(entry);
+	quint32 dataOffset = qFromLittleEndian(record(index)->dataOffset);
+	quint32 dataSize = qFromLittleEndian(record(index)->dataSize);
+	if (data.size()!=(int)dataSize || std::memcmp(image+dataOffset, data.constData(), dataSize)!=0)
+	{
+		// Append the new data at the end of the file.
+		const qint64 end = imageSize;
+		if (end + data.size() > 0xffffffffLL)
+			return false;
+		unmap();
+		if (!file.seek(end) || file.write(data)!=data.size() || !file.flush() || !map())
+		{
+			qWarning() << "[Satellites] cannot write the catalog store" << QDir::toNativeSeparators(file.fileName());
+			close();
+			return false;
+		}
+		dataOffset = (quint32)end;
+		dataSize = data.size();
+	}
+	rec.dataOffset = qToLittleEndian(dataOffset);
+	rec.dataSize = qToLittleEndian(dataSize);
+	std::memcpy(record(index), &rec, sizeof(rec));
+	return true;
+}
+
+QString SatelliteCatalogStore::getCatalogVersion() const
+{
+	if (!isOpen())
+		return QString();
+	return QString::fromLatin1(readField(header()->catalogVersion, sizeof(Header::catalogVersion)));
+}
+
+Vec3f SatelliteCatalogStore::getDefaultHintColor() const
+{
+	if (!isOpen())
+		return Vec3f(0.f, 0.f, 0.f);
+	const Header* h = header();
+	return Vec3f(floatFromStore(h->defaultHintColor[0]), floatFromStore(h->defaultHintColor[1]), floatFromStore(h->defaultHintColor[2]));
+}
+
+bool SatelliteCatalogStore::matchesJson(const QString& jsonPath) const
+{
+	const QFileInfo jsonInfo(jsonPath);
+	return isOpen() && jsonInfo.exists()
+	       && qFromLittleEndian(header()->jsonSize)==jsonInfo.size()
+	       && qFromLittleEndian(header()->jsonModified)==jsonInfo.lastModified().toMSecsSinceEpoch();
+}
+
+bool SatelliteCatalogStore::isJsonExportPending() const
+{
+	return isOpen() && (qFromLittleEndian(header()->flags) & STORE_JSON_EXPORT_PENDING);
+}
+
+void SatelliteCatalogStore::setJsonExportPending(bool pending)
+{
+	if (!isOpen())
+		return;
+	Header* h = reinterpret_cast<Header*>(image);
+	quint32 flags = qFromLittleEndian(h->flags) & ~STORE_JSON_EXPORT_PENDING;
+	if (pending)
+		flags |= STORE_JSON_EXPORT_PENDING;
+	h->flags = qToLittleEndian(flags);
+}
+
+void SatelliteCatalogStore::writeTle(QIODevice& device, const QVector<SatelliteCatalogEntry>& entries)
+{
+	foreach(const SatelliteCatalogEntry& entry, entries)
+	{
+		device.write(entry.name.toUtf8());
+		device.write("\n");
+		device.write(entry.tle1);
+		device.write("\n");
+		device.write(entry.tle2);
+		device.write("\n");
+	}
+}
@@ -0,0 +1,154 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _SATELLITECATALOGSTORE_HPP_
+#define _SATELLITECATALOGSTORE_HPP_
+
+#include "VecMath.hpp"
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+
+class QIODevice;
+
+//! Radio communication channel properties.
+//! @ingroup satellites
+typedef struct
+{
+	double frequency; //!< Channel frequency in MHz.
+	QString modulation; //!< Signal modulation mode.
+	QString description; //!< Channel description.
+} CommLink;
+
+//! The data of one satellite of the catalog, as in the "satellites" section of satellites.json.
+//! @ingroup satellites
+struct SatelliteCatalogEntry
+{
+	SatelliteCatalogEntry();
+
+	//! NORAD catalog number
+	QString id;
+	QString name;
+	QString description;
+	QByteArray tle1;
+	QByteArray tle2;
+	bool visible;
+	bool orbitVisible;
+	bool userDefined;
+	double stdMag;
+	int status;
+	Vec3f hintColor;
+	Vec3f orbitColor;
+	QStringList groups;
+	QList<CommLink> comms;
+	QDateTime lastUpdated;
+
+	//! Read the entry of the satellite @em id from its JSON map.
+	//! The missing values get the defaults of Satellite, a missing orbit color is the hint color.
+	static SatelliteCatalogEntry fromMap(const QString& id, const QVariantMap& map);
+	//! Get the JSON map of the entry, as written by Satellite::getMap().
+	QVariantMap toMap() const;
+};
+
+//! @class SatelliteCatalogStore
+//! A binary copy of the satellite catalog, which is loaded instead of satellites.json
+//! as long as the JSON file did not change, and updated in place when new TLE are downloaded.
+//!
+//! The file is memory-mapped. Its layout does not depend on the machine: all numbers are
+//! little-endian. A header is followed by one record of fixed size per satellite, sorted by
+//! catalog number so that a satellite is found by a binary search. A record holds the
+//! TLE lines, the flags, colors, magnitude, status and update date; the other data (name,
+//! description, groups and radio channels) are in a block at the end of the file.
+//! When such data change, setEntry() appends a new block and the old one is left unused,
+//! until the next write() compacts the file.
+//!
+//! The header keeps the size and date of the JSON file it was made from, so that a JSON file
+//! edited or replaced outside of the plugin is imported again.
+//! @ingroup satellites
+class SatelliteCatalogStore
+{
+public:
+	SatelliteCatalogStore();
+	~SatelliteCatalogStore();
+
+	//! Write the entries to a new store file, which replaces the file @em path.
+	//! @param catalogVersion version of the plugin which wrote the JSON file
+	//! @param defaultHintColor the "hintColor" of the JSON file
+	//! @param jsonPath the JSON file with the same data
+	//! @param jsonExportPending true if the entries are newer than the JSON file
+	static bool write(const QString& path, const QVector<SatelliteCatalogEntry>& entries,
+			  const QString& catalogVersion, const Vec3f& defaultHintColor,
+			  const QString& jsonPath, bool jsonExportPending=false);
+
+	//! Map the store file @em path. The file is closed if it is not a valid store.
+	bool open(const QString& path);
+	void close();
+	bool isOpen() const {return image!=Q_NULLPTR;}
+
+	//! Get the number of satellites.
+	int size() const {return nrOfRecords;}
+	//! Get the index of the satellite with the catalog number @em id, or -1.
+	int indexOf(const QString& id) const;
+	QString getId(int index) const;
+	SatelliteCatalogEntry getEntry(int index) const;
+	//! Get all entries, sorted by catalog number.
+	QVector<SatelliteCatalogEntry> getEntries() const;
+	//! Replace the satellite @em index by @em entry, which has the same catalog number, in the file.
+	bool setEntry(int index, const SatelliteCatalogEntry& entry);
+
+	//! Get the catalogVersion given to write().
+	QString getCatalogVersion() const;
+	//! Get the defaultHintColor given to write().
+	Vec3f getDefaultHintColor() const;
+	//! Test if the JSON file @em jsonPath is the one the store was written with.
+	bool matchesJson(const QString& jsonPath) const;
+	//! Test if the store has changes which are not yet exported to the JSON file.
+	bool isJsonExportPending() const;
+	void setJsonExportPending(bool pending);
+
+	//! Write the elements of the entries in the format of the TLE files: the name, then the two lines.
+	static void writeTle(QIODevice& device, const QVector<SatelliteCatalogEntry>& entries);
+
+private:
+	struct Header;
+	struct Record;
+
+	const Header* header() const;
+	const Record* record(int index) const;
+	Record* record(int index);
+	//! Encode the data of an entry kept outside of its record.
+	static QByteArray encodeData(const SatelliteCatalogEntry& entry);
+	//! Fill the fixed fields of a record, without the data offset and size.
+	static bool fillRecord(const SatelliteCatalogEntry& entry, Record& rec);
+	bool map();
+	void unmap();
+
+	QFile file;
+	uchar* image;
+	qint64 imageSize;
+	int nrOfRecords;
+};
+
+#endif // _SATELLITECATALOGSTORE_HPP_
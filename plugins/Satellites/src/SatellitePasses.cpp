@@ -0,0 +1,492 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "SatellitePasses.hpp"
+#include "gsatellite/stdsat.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+
+// Same constants as gSatTEME
+#define CONSTANTS_SET wgs72
+// Precision of the events, in minutes
+#define EVENT_TOLERANCE (1./60.)
+// Largest step when looking for the changes of visibility during a pass, in minutes
+#define VISIBILITY_STEP (1./3.)
+// A sample below the horizon, higher than its neighbours, is searched for a short pass when
+// the sine of its altitude is above this value.
+#define HIDDEN_PASS_LIMIT -0.1
+// Golden ratio, for the search of the culmination
+#define GOLDEN_RATIO 0.6180339887498949
+
+SatellitePass::SatellitePass()
+	: riseJD(0.)
+	, culminationJD(0.)
+	, setJD(0.)
+	, riseAzimuth(0.f)
+	, culminationAzimuth(0.f)
+	, setAzimuth(0.f)
+	, culminationAltitude(0.f)
+	, riseVisibility(gSatWrapper::UNKNOWN)
+	, culminationVisibility(gSatWrapper::UNKNOWN)
+	, setVisibility(gSatWrapper::UNKNOWN)
+	, visibleStartJD(0.)
+	, visibleEndJD(0.)
+{
+}
+
+// Azimuth from the north to the east, of a position (south, east, zenith) computed by gSatFrameContext.
+static double azimuth(const Vec3d& altAz)
+{
+	const double az = std::atan2(altAz[1], -altAz[0]);
+	return az<0. ? az+2.*M_PI : az;
+}
+
+class SatellitePassPredictor::PredictionStep
+{
+public:
+	PredictionStep(const SatellitePassPredictor* predictor, const QVector<Target>& targets, double startJD, double endJD, QVector<SatellitePass>* results)
+		: predictor(predictor), targets(targets), startJD(startJD), endJD(endJD), results(results) {}
+	void operator()(int& index) const
+	{
+		results[index] = predictor->predict(targets.at(index), startJD, endJD);
+	}
+private:
+	const SatellitePassPredictor* predictor;
+	const QVector<Target>& targets;
+	double startJD;
+	double endJD;
+	QVector<SatellitePass>* results;
+};
+
+// Orders the passes by rise time.
+struct RisesBefore
+{
+	bool operator()(const SatellitePass& a, const SatellitePass& b) const {return a.riseJD<b.riseJD;}
+	bool operator()(const SatellitePass& a, double jd) const {return a.riseJD<jd;}
+};
+
+SatellitePassPredictor::SatellitePassPredictor(double latitude, double longitude, double altitude)
+	: latitude(latitude)
+	, longitude(longitude)
+	, altitude(altitude)
+{
+}
+
+Vec3d SatellitePassPredictor::computeSunECIPos(double jd)
+{
+	// Astronomical Almanac, section C, low precision formulas for the Sun
+	const double n = jd - 2451545.0;
+	const double L = (280.460 + 0.9856474*n) * KDEG2RAD;
+	const double g = (357.528 + 0.9856003*n) * KDEG2RAD;
+	const double lambda = L + (1.915*std::sin(g) + 0.020*std::sin(2.*g)) * KDEG2RAD;
+	const double epsilon = (23.439 - 0.0000004*n) * KDEG2RAD;
+	const double r = (1.00014 - 0.01671*std::cos(g) - 0.00014*std::cos(2.*g)) * KAU;
+	return Vec3d(r*std::cos(lambda), r*std::cos(epsilon)*std::sin(lambda), r*std::sin(epsilon)*std::sin(lambda));
+}
+
+bool SatellitePassPredictor::evaluate(elsetrec& satrec, double startJD, double minutes, Sample& sample) const
+{
+	const double jd = startJD + minutes/1440.;
+	double r[3] = {};
+	double v[3] = {};
+	sample.minutes = minutes;
+	if (!sgp4(CONSTANTS_SET, satrec, (jd-satrec.jdsatepoch)*1440., r, v))
+	{
+		sample.sinAltitude = -1.;
+		sample.geocentricAngle = M_PI;
+		sample.visibility = gSatWrapper::NOT_VISIBLE;
+		return false;
+	}
+	const Vec3d pos(r[0], r[1], r[2]);
+	const gSatFrameContext frame(jd, latitude, longitude, altitude, computeSunECIPos(jd));
+	sample.altAz = frame.computeAltAz(pos);
+	sample.sinAltitude = sample.altAz[2]/sample.altAz.length();
+	sample.geocentricAngle = frame.getObserverECIPos().angle(pos);
+	sample.visibility = gSatWrapper::computeVisibility(frame, pos, sample.altAz);
+	return true;
+}
+
+SatellitePassPredictor::Sample SatellitePassPredictor::refineCrossing(elsetrec& satrec, double startJD, Sample a, Sample b) const
+{
+	const bool aAbove = a.sinAltitude > 0.;
+	while (b.minutes-a.minutes > EVENT_TOLERANCE)
+	{
+		Sample mid;
+		evaluate(satrec, startJD, 0.5*(a.minutes+b.minutes), mid);
+		if ((mid.sinAltitude > 0.) == aAbove)
+			a = mid;
+		else
+			b = mid;
+	}
+	return aAbove ? a : b;
+}
+
+SatellitePassPredictor::Sample SatellitePassPredictor::findCulmination(elsetrec& satrec, double startJD, double a, double b) const
+{
+	Sample c, d;
+	evaluate(satrec, startJD, b - GOLDEN_RATIO*(b-a), c);
+	evaluate(satrec, startJD, a + GOLDEN_RATIO*(b-a), d);
+	while (b-a > EVENT_TOLERANCE)
+	{
+		if (c.sinAltitude > d.sinAltitude)
+		{
+			b = d.minutes;
+			d = c;
+			evaluate(satrec, startJD, b - GOLDEN_RATIO*(b-a), c);
+		}
+		else
+		{
+			a = c.minutes;
+			c = d;
+			evaluate(satrec, startJD, a + GOLDEN_RATIO*(b-a), d);
+		}
+	}
+	return c.sinAltitude > d.sinAltitude ? c : d;
+}
+
+void SatellitePassPredictor::computePass(elsetrec& satrec, double startJD, const Sample& rise, const Sample& set, double coarseStep, SatellitePass& pass) const
+{
+	const Sample culmination = findCulmination(satrec, startJD, rise.minutes, set.minutes);
+	pass.riseJD = startJD + rise.minutes/1440.;
+	pass.culminationJD = startJD + culmination.minutes/1440.;
+	pass.setJD = startJD + set.minutes/1440.;
+	pass.riseAzimuth = azimuth(rise.altAz);
+	pass.culminationAzimuth = azimuth(culmination.altAz);
+	pass.setAzimuth = azimuth(set.altAz);
+	pass.culminationAltitude = std::asin(qMax(culmination.sinAltitude, rise.sinAltitude));
+	pass.riseVisibility = rise.visibility;
+	pass.culminationVisibility = culmination.visibility;
+	pass.setVisibility = set.visibility;
+
+	// The satellite enters or leaves the earth shadow, the Sun rises or sets during the pass.
+	const int nrOfSteps = qMax(1, (int)std::ceil((set.minutes-rise.minutes)/qMin(coarseStep, VISIBILITY_STEP)));
+	const double step = (set.minutes-rise.minutes)/nrOfSteps;
+	double visibleStart = -1.;
+	double visibleEnd = -1.;
+	Sample prev = rise;
+	for (int i=1;i<=nrOfSteps;++i)
+	{
+		Sample cur = set;
+		if (i<nrOfSteps)
+			evaluate(satrec, startJD, rise.minutes+i*step, cur);
+		const bool prevVisible = prev.visibility==gSatWrapper::VISIBLE;
+		const bool curVisible = cur.visibility==gSatWrapper::VISIBLE;
+		if (i==1 && prevVisible)
+			visibleStart = prev.minutes;
+		if (prevVisible!=curVisible)
+		{
+			Sample a = prev;
+			Sample b = cur;
+			while (b.minutes-a.minutes > EVENT_TOLERANCE)
+			{
+				Sample mid;
+				evaluate(satrec, startJD, 0.5*(a.minutes+b.minutes), mid);
+				if ((mid.visibility==gSatWrapper::VISIBLE) == prevVisible)
+					a = mid;
+				else
+					b = mid;
+			}
+			if (curVisible)
+			{
+				if (visibleStart<0.)
+					visibleStart = b.minutes;
+			}
+			else
+				visibleEnd = a.minutes;
+		}
+		if (i==nrOfSteps && curVisible)
+			visibleEnd = cur.minutes;
+		prev = cur;
+	}
+	if (visibleStart>=0. && visibleEnd>=visibleStart)
+	{
+		pass.visibleStartJD = startJD + visibleStart/1440.;
+		pass.visibleEndJD = startJD + visibleEnd/1440.;
+	}
+}
+
+QVector<SatellitePass> SatellitePassPredictor::predict(const Target& target, double startJD, double endJD) const
+{
+	QVector<SatellitePass> passes;
+	elsetrec satrec = target.satrec;
+	if (satrec.no <= 0. || satrec.ecco >= 1. || endJD <= startJD)
+		return passes;
+
+	double tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2;
+	getgravconst(CONSTANTS_SET, tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2);
+	const double e = satrec.ecco;
+	// satrec.no is in rad/min
+	const double coarseStep = qBound(0.5, 2.*M_PI/satrec.no/90., 10.);
+	// The satellite can be above the horizon only when its angle to the observer, seen from the earth
+	// centre, is below the angle of the horizon at the apogee, computed for the polar radius, with a margin
+	// for the difference between the geodetic and geocentric verticals.
+	const double apogee = std::pow(xke/satrec.no, 2./3.) * (1.+e) * radiusearthkm;
+	const double polarRadius = KEARTHRADIUS*(1.-__f);
+	if (apogee <= polarRadius)
+		return passes;
+	const double maxAngle = std::acos(polarRadius/apogee) + 0.01;
+	// Largest angular velocity of the satellite relative to the observer: the satellite at its
+	// perigee, with a margin for the drag, and the earth rotation.
+	const double maxRate = 1.2*satrec.no*(1.+e)*(1.+e)/std::pow(1.-e*e, 1.5) + KMFACTOR*60.;
+
+	const double end = (endJD-startJD)*1440.;
+	Sample beforePrev, prev, rise;
+	if (!evaluate(satrec, startJD, 0., prev))
+		return passes;
+	beforePrev = prev;
+	// A pass in progress at the start of the window is ignored.
+	bool above = prev.sinAltitude > 0.;
+	bool hasRise = false;
+	bool lastStepRegular = false;
+	while (prev.minutes < end)
+	{
+		double step = coarseStep;
+		if (prev.geocentricAngle > maxAngle)
+			step = qMax(coarseStep, (prev.geocentricAngle-maxAngle)/maxRate);
+		const bool stepRegular = step==coarseStep;
+		Sample cur;
+		if (!evaluate(satrec, startJD, qMin(prev.minutes+step, end), cur))
+			break;
+
+		const bool curAbove = cur.sinAltitude > 0.;
+		if (curAbove && !above)
+		{
+			rise = refineCrossing(satrec, startJD, prev, cur);
+			hasRise = true;
+		}
+		else if (!curAbove && above)
+		{
+			if (hasRise)
+			{
+				SatellitePass pass;
+				computePass(satrec, startJD, rise, refineCrossing(satrec, startJD, prev, cur), coarseStep, pass);
+				passes.append(pass);
+			}
+			hasRise = false;
+		}
+		else if (!curAbove && stepRegular && lastStepRegular && prev.sinAltitude > HIDDEN_PASS_LIMIT
+			 && prev.sinAltitude >= beforePrev.sinAltitude && prev.sinAltitude >= cur.sinAltitude)
+		{
+			const Sample top = findCulmination(satrec, startJD, beforePrev.minutes, cur.minutes);
+			if (top.sinAltitude > 0.)
+			{
+				SatellitePass pass;
+				computePass(satrec, startJD, refineCrossing(satrec, startJD, beforePrev, top),
+					    refineCrossing(satrec, startJD, top, cur), coarseStep, pass);
+				passes.append(pass);
+			}
+		}
+		above = curAbove;
+		lastStepRegular = stepRegular;
+		beforePrev = prev;
+		prev = cur;
+	}
+
+	for (int i=0;i<passes.size();++i)
+	{
+		passes[i].id = target.id;
+		passes[i].name = target.name;
+	}
+	return passes;
+}
+
+QVector<SatellitePass> SatellitePassPredictor::predict(const QVector<Target>& targets, double startJD, double endJD, bool parallel) const
+{
+	QVector<QVector<SatellitePass> > results(targets.size());
+	QVector<int> indices(targets.size());
+	for (int i=0;i<indices.size();++i)
+		indices[i] = i;
+	const PredictionStep step(this, targets, startJD, endJD, results.data());
+	if (parallel)
+		QtConcurrent::blockingMap(indices, step);
+	else
+	{
+		for (int i=0;i<indices.size();++i)
+			step(indices[i]);
+	}
+
+	QVector<SatellitePass> passes;
+	for (int i=0;i<results.size();++i)
+		passes += results.at(i);
+	std::stable_sort(passes.begin(), passes.end(), RisesBefore());
+	return passes;
+}
+
+// Orders the indices of the passes by one key.
+class PassOrder
+{
+public:
+	PassOrder(const QVector<SatellitePass>& passes, SatellitePassIndex::SortKey key) : passes(passes), key(key) {}
+	bool operator()(int a, int b) const
+	{
+		const SatellitePass& pa = passes.at(a);
+		const SatellitePass& pb = passes.at(b);
+		switch (key)
+		{
+			case SatellitePassIndex::CulminationAltitude:
+				return pa.culminationAltitude > pb.culminationAltitude;
+			case SatellitePassIndex::Duration:
+				return pa.getDuration() > pb.getDuration();
+			case SatellitePassIndex::SatelliteName:
+				return pa.name.compare(pb.name, Qt::CaseInsensitive) < 0;
+			default:
+				return pa.riseJD < pb.riseJD;
+		}
+	}
+private:
+	const QVector<SatellitePass>& passes;
+	SatellitePassIndex::SortKey key;
+};
+
+SatellitePassIndex::SatellitePassIndex()
+	: startJD(0.)
+	, endJD(0.)
+	, maxDuration(0.)
+{
+}
+
+void SatellitePassIndex::clear()
+{
+	*this = SatellitePassIndex();
+}
+
+void SatellitePassIndex::setPasses(const QVector<SatellitePass>& newPasses, double start, double end)
+{
+	clear();
+	passes = newPasses;
+	startJD = start;
+	endJD = end;
+	std::stable_sort(passes.begin(), passes.end(), RisesBefore());
+	for (int i=0;i<passes.size();++i)
+	{
+		maxDuration = qMax(maxDuration, passes.at(i).getDuration());
+		passesById[passes.at(i).id].append(i);
+	}
+	// The passes of the same rise time keep this order in the other keys.
+	for (int k=0;k<SortKeyCount;++k)
+	{
+		QVector<int>& order = sortedPasses[k];
+		order.resize(passes.size());
+		for (int i=0;i<order.size();++i)
+			order[i] = i;
+		if (k!=RiseTime)
+			std::stable_sort(order.begin(), order.end(), PassOrder(passes, (SortKey)k));
+	}
+}
+
+QVector<int> SatellitePassIndex::visiblePasses(const QVector<int>& indices) const
+{
+	QVector<int> result;
+	foreach (int i, indices)
+	{
+		if (passes.at(i).isVisible())
+			result.append(i);
+	}
+	return result;
+}
+
+QVector<int> SatellitePassIndex::getPasses(double fromJD, double toJD, bool visibleOnly) const
+{
+	QVector<int> result;
+	QVector<SatellitePass>::const_iterator it = std::lower_bound(passes.constBegin(), passes.constEnd(), fromJD-maxDuration, RisesBefore());
+	for (;it!=passes.constEnd() && it->riseJD<toJD;++it)
+	{
+		if (visibleOnly)
+		{
+			if (it->isVisible() && it->visibleEndJD>fromJD && it->visibleStartJD<toJD)
+				result.append(it-passes.constBegin());
+		}
+		else if (it->setJD>fromJD)
+			result.append(it-passes.constBegin());
+	}
+	return result;
+}
+
+QVector<int> SatellitePassIndex::getPassesOf(const QString& id) const
+{
+	return passesById.value(id);
+}
+
+QVector<int> SatellitePassIndex::getSortedPasses(SortKey key, bool visibleOnly) const
+{
+	if (key<0 || key>=SortKeyCount)
+		key = RiseTime;
+	return visibleOnly ? visiblePasses(sortedPasses[key]) : sortedPasses[key];
+}
+
+SatellitePassIndex::SortKey SatellitePassIndex::sortKeyFromString(const QString& name, bool* ok)
+{
+	static const char* const names[SortKeyCount] = {"rise", "altitude", "duration", "name"};
+	for (int k=0;k<SortKeyCount;++k)
+	{
+		if (name.compare(names[k], Qt::CaseInsensitive)==0)
+		{
+			if (ok)
+				*ok = true;
+			return (SortKey)k;
+		}
+	}
+	if (ok)
+		*ok = false;
+	return RiseTime;
+}
+
+static QString visibilityName(gSatWrapper::Visibility visibility)
+{
+	switch (visibility)
+	{
+		case gSatWrapper::RADAR_SUN:
+			return "radar_sun";
+		case gSatWrapper::VISIBLE:
+			return "visible";
+		case gSatWrapper::RADAR_NIGHT:
+			return "radar_night";
+		case gSatWrapper::NOT_VISIBLE:
+			return "not_visible";
+		default:
+			return "unknown";
+	}
+}
+
+QVariantMap SatellitePassIndex::toVariantMap(const SatellitePass& pass)
+{
+	QVariantMap map;
+	map.insert("id", pass.id);
+	map.insert("name", pass.name);
+	map.insert("rise", pass.riseJD);
+	map.insert("rise-azimuth", pass.riseAzimuth*KRAD2DEG);
+	map.insert("rise-visibility", visibilityName(pass.riseVisibility));
+	map.insert("culmination", pass.culminationJD);
+	map.insert("culmination-azimuth", pass.culminationAzimuth*KRAD2DEG);
+	map.insert("culmination-altitude", pass.culminationAltitude*KRAD2DEG);
+	map.insert("culmination-visibility", visibilityName(pass.culminationVisibility));
+	map.insert("set", pass.setJD);
+	map.insert("set-azimuth", pass.setAzimuth*KRAD2DEG);
+	map.insert("set-visibility", visibilityName(pass.setVisibility));
+	map.insert("visible", pass.isVisible());
+	if (pass.isVisible())
+	{
+		map.insert("visible-start", pass.visibleStartJD);
+		map.insert("visible-end", pass.visibleEndJD);
+	}
+	return map;
+}
@@ -0,0 +1,186 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _SATELLITEPASSES_HPP_
+#define _SATELLITEPASSES_HPP_
+
+#include "VecMath.hpp"
+#include "gSatFrameContext.hpp"
+#include "gSatWrapper.hpp"
+#include "gsatellite/sgp4unit.h"
+
+#include <QHash>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+//! One pass of a satellite above the horizon of the observer.
+//! @ingroup satellites
+struct SatellitePass
+{
+	SatellitePass();
+
+	//! NORAD catalog number
+	QString id;
+	QString name;
+	//! Julian days (UTC) of the rise, the culmination and the set
+	double riseJD;
+	double culminationJD;
+	double setJD;
+	//! Azimuths in radians, from the north to the east
+	float riseAzimuth;
+	float culminationAzimuth;
+	float setAzimuth;
+	//! Geometric altitude at the culmination, in radians
+	float culminationAltitude;
+	gSatWrapper::Visibility riseVisibility;
+	gSatWrapper::Visibility culminationVisibility;
+	gSatWrapper::Visibility setVisibility;
+	//! First and last Julian days where the satellite is gSatWrapper::VISIBLE, 0 if it is never visible
+	double visibleStartJD;
+	double visibleEndJD;
+
+	bool isVisible() const {return visibleStartJD>0.;}
+	//! Duration of the pass in days.
+	double getDuration() const {return setJD-riseJD;}
+};
+
+//! @class SatellitePassPredictor
+//! Computes the passes of satellites above the horizon of an observer, with their visibility
+//! as predicted by gSatWrapper::getVisibilityPredict().
+//! The orbit of each satellite is sampled with a coarse step, skipping the times where the
+//! satellite is certainly too far from the observer to be above the horizon. The rise and the
+//! set are then refined by bisection, the culmination by a golden section search, to a second.
+//! A sample just below the horizon, higher than its neighbours, is searched for a short pass
+//! which could be between two samples.
+//! The Sun is computed with a low precision formula (about 0.01 degree), independent of the
+//! SolarSystem module, so that the satellites can be computed in several threads.
+//! Only the passes which rise and set inside the time window are found: a satellite which is
+//! above the horizon during the whole window, like a geostationary satellite, has no pass.
+//! @ingroup satellites
+class SatellitePassPredictor
+{
+public:
+	//! A satellite, with its SGP4 elements initialized by sgp4init() or twoline2rv().
+	struct Target
+	{
+		QString id;
+		QString name;
+		elsetrec satrec;
+	};
+
+	//! @param latitude geodetic latitude of the observer in degrees
+	//! @param longitude longitude of the observer in degrees
+	//! @param altitude altitude of the observer in m
+	SatellitePassPredictor(double latitude, double longitude, double altitude);
+
+	//! Compute the passes of a satellite between startJD and endJD (UTC), by rise time.
+	QVector<SatellitePass> predict(const Target& target, double startJD, double endJD) const;
+	//! Compute the passes of all targets between startJD and endJD (UTC), by rise time.
+	//! @param parallel compute the satellites in the global thread pool
+	QVector<SatellitePass> predict(const QVector<Target>& targets, double startJD, double endJD, bool parallel) const;
+
+	//! Geocentric position of the Sun in the equatorial frame of date, in km, from the low precision
+	//! formula of the Astronomical Almanac.
+	static Vec3d computeSunECIPos(double jd);
+
+private:
+	class PredictionStep;
+
+	//! The state of a satellite at a date.
+	struct Sample
+	{
+		//! Minutes from the start of the window
+		double minutes;
+		//! Sine of the geometric altitude
+		double sinAltitude;
+		//! Angle between the observer and the satellite seen from the earth centre, in radians
+		double geocentricAngle;
+		Vec3d altAz;
+		gSatWrapper::Visibility visibility;
+	};
+
+	//! Compute the state of the satellite at the date startJD+minutes/1440.
+	//! @return false if sgp4() failed, e.g. for a decayed orbit.
+	bool evaluate(elsetrec& satrec, double startJD, double minutes, Sample& sample) const;
+	//! Find the time of the horizon crossing between a and b, which are on both sides of the horizon.
+	Sample refineCrossing(elsetrec& satrec, double startJD, Sample a, Sample b) const;
+	//! Find the highest sample between a and b.
+	Sample findCulmination(elsetrec& satrec, double startJD, double a, double b) const;
+	//! Fill the pass between rise and set.
+	void computePass(elsetrec& satrec, double startJD, const Sample& rise, const Sample& set, double coarseStep, SatellitePass& pass) const;
+
+	double latitude;
+	double longitude;
+	double altitude;
+};
+
+//! @class SatellitePassIndex
+//! The passes predicted for the satellites of the catalog, indexed by rise time and by satellite,
+//! and sorted by the other keys, so that they can be queried without being computed again.
+//! @ingroup satellites
+class SatellitePassIndex
+{
+public:
+	enum SortKey
+	{
+		RiseTime,
+		CulminationAltitude,
+		Duration,
+		SatelliteName,
+		SortKeyCount
+	};
+
+	SatellitePassIndex();
+
+	//! Replace the passes of the index, predicted between startJD and endJD.
+	void setPasses(const QVector<SatellitePass>& passes, double startJD, double endJD);
+	void clear();
+	bool isEmpty() const {return passes.isEmpty();}
+	int size() const {return passes.size();}
+	//! Get a pass by its index, from 0 to size()-1. The passes are ordered by rise time.
+	const SatellitePass& at(int index) const {return passes.at(index);}
+	double getStartJD() const {return startJD;}
+	double getEndJD() const {return endJD;}
+
+	//! Get the indices of the passes above the horizon at some time between fromJD and toJD, by rise time.
+	QVector<int> getPasses(double fromJD, double toJD, bool visibleOnly=false) const;
+	//! Get the indices of the passes of the satellite with the given NORAD number, by rise time.
+	QVector<int> getPassesOf(const QString& id) const;
+	//! Get the indices of all passes, sorted by increasing key, or by decreasing altitude.
+	QVector<int> getSortedPasses(SortKey key, bool visibleOnly=false) const;
+
+	//! Get the key from its name: "rise", "altitude", "duration" or "name".
+	static SortKey sortKeyFromString(const QString& name, bool* ok=Q_NULLPTR);
+	//! Get the data of a pass for scripts and for the RemoteControl plugin.
+	static QVariantMap toVariantMap(const SatellitePass& pass);
+
+private:
+	QVector<int> visiblePasses(const QVector<int>& indices) const;
+
+	QVector<SatellitePass> passes;
+	double startJD;
+	double endJD;
+	//! Longest pass, to find the passes which rose before a date
+	double maxDuration;
+	QHash<QString, QVector<int> > passesById;
+	QVector<int> sortedPasses[SortKeyCount];
+};
+
+#endif // _SATELLITEPASSES_HPP_
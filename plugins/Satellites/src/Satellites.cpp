@@ -33,6 +33,7 @@
 #include "Satellites.hpp"
 #include "Satellite.hpp"
 #include "SatellitesListModel.hpp"
+#include "SatellitesRemoteControlService.hpp"
 #include "Planet.hpp"
 #include "SolarSystem.hpp"
 #include "StelJsonParser.hpp"
@@ -55,6 +56,7 @@
 #include <QVariant>
 #include <QDir>
 #include <QTemporaryFile>
+#include <QtConcurrent>
 
 StelModule* SatellitesStelPluginInterface::getStelModule() const
 {
@@ -77,8 +79,17 @@ StelPluginInfo SatellitesStelPluginInterface::getPluginInfo() const
 	return info;
 }
 
+QObjectList SatellitesStelPluginInterface::getExtensionList() const
+{
+	QObjectList ret;
+	ret.append(new SatellitesRemoteControlService());
+	return ret;
+}
+
 Satellites::Satellites()
-	: satelliteListModel(Q_NULLPTR)
+	: catalogExportPending(false)
+	, sgp4BatchDirty(true)
+	, satelliteListModel(Q_NULLPTR)
 	, toolbarButton(Q_NULLPTR)
 	, earth(Q_NULLPTR)
 	, defaultHintColor(0.0f, 0.4f, 0.6f)
@@ -94,13 +105,25 @@ Satellites::Satellites()
 	, updateFrequencyHours(0)
 	, messageTimer(Q_NULLPTR)
 	, iridiumFlaresPredictionDepth(7)
+	, passPredictionDepth(3)
+	, passPrediction(this)
+	, passPredictionStartJD(0.)
+	, passPredictionEndJD(0.)
+	, pendingPassPredictionDays(0)
 {
 	setObjectName("Satellites");
+	connect(&passPrediction, &QFutureWatcherBase::finished, this, &Satellites::passPredictionCompleted);
 	configDialog = new SatellitesDialog();
 }
 
 void Satellites::deinit()
 {
+	// The TLE updates were only written to the catalog store.
+	if (catalogExportPending)
+		saveCatalog();
+	catalogStore.close();
+	pendingPassPredictionDays = 0;
+	passPrediction.waitForFinished();
 	Satellite::hintTexture.clear();
 	texPointer.clear();
 }
@@ -136,6 +159,7 @@ void Satellites::init()
 
 		// absolute file name for inner catalog of the satellites
 		catalogPath = dataDir.absoluteFilePath("satellites.json");
+		catalogStorePath = dataDir.absoluteFilePath("satellites.dat");
 		// absolute file name for qs.mag file
 		qsMagFilePath = dataDir.absoluteFilePath("qs.mag");
 
@@ -177,7 +201,8 @@ void Satellites::init()
 	// If the json file does not already exist, create it from the resource in the QT resource
 	if(QFileInfo(catalogPath).exists())
 	{
-		if (!checkJsonFileFormat() || readCatalogVersion() != SATELLITES_PLUGIN_VERSION)
+		// The catalog file was checked when the catalog store was written.
+		if (!openCatalogStore() && (!checkJsonFileFormat() || readCatalogVersion() != SATELLITES_PLUGIN_VERSION))
 		{
 			displayMessage(q_("The old satellites.json file is no longer compatible - using default file"), "#bb0000");
 			restoreDefaultCatalog();
@@ -569,6 +594,10 @@ void Satellites::restoreDefaultSettings()
 
 void Satellites::restoreDefaultCatalog()
 {
+	catalogStore.close();
+	QFile::remove(catalogStorePath);
+	// The data of the store are dropped with it.
+	catalogExportPending = false;
 	if (QFileInfo(catalogPath).exists())
 		backupCatalog(true);
 
@@ -674,6 +703,7 @@ void Satellites::loadSettings()
 	autoAddEnabled = conf->value("auto_add_enabled", true).toBool();
 	autoRemoveEnabled = conf->value("auto_remove_enabled", true).toBool();
 	iridiumFlaresPredictionDepth = conf->value("flares_prediction_depth", 7).toInt();
+	setPassPredictionDepth(conf->value("passes_prediction_depth", 3).toInt());
 
 	// Get a font for labels
 	labelFont.setPixelSize(conf->value("hint_font_size", 10).toInt());
@@ -707,6 +737,7 @@ void Satellites::saveSettings()
 	conf->setValue("auto_add_enabled", autoAddEnabled);
 	conf->setValue("auto_remove_enabled", autoRemoveEnabled);
 	conf->setValue("flares_prediction_depth", iridiumFlaresPredictionDepth);
+	conf->setValue("passes_prediction_depth", passPredictionDepth);
 
 	// Get a font for labels
 	conf->setValue("hint_font_size", labelFont.pixelSize());
@@ -728,7 +759,46 @@ void Satellites::saveSettings()
 
 void Satellites::loadCatalog()
 {
+	if (openCatalogStore())
+	{
+		qDebug() << "[Satellites] loading catalog store:" << QDir::toNativeSeparators(catalogStorePath);
+		defaultHintColor = catalogStore.getDefaultHintColor();
+		setCatalogEntries(catalogStore.getEntries());
+		// The last session may have been interrupted before writing the catalog file.
+		catalogExportPending = catalogStore.isJsonExportPending();
+		return;
+	}
 	setDataMap(loadDataMap());
+	saveCatalogStore(false);
+}
+
+bool Satellites::openCatalogStore()
+{
+	if (!catalogStore.isOpen() && !catalogStore.open(catalogStorePath))
+		return false;
+	if (catalogStore.matchesJson(catalogPath) && catalogStore.getCatalogVersion() == SATELLITES_PLUGIN_VERSION)
+		return true;
+	catalogStore.close();
+	return false;
+}
+
+void Satellites::saveCatalogStore(bool jsonExportPending)
+{
+	QVector<SatelliteCatalogEntry> entries;
+	entries.reserve(satellites.size());
+	foreach(const SatelliteP& sat, satellites)
+		entries.append(sat->getCatalogEntry());
+	// The file is replaced, it must not be mapped.
+	catalogStore.close();
+	catalogExportPending = jsonExportPending;
+	if (!SatelliteCatalogStore::write(catalogStorePath, entries, SATELLITES_PLUGIN_VERSION, defaultHintColor, catalogPath, jsonExportPending)
+	    || !catalogStore.open(catalogStorePath))
+	{
+		qWarning() << "[Satellites] cannot write the catalog store" << QDir::toNativeSeparators(catalogStorePath);
+		// Without store, the catalog file is the only copy of the data.
+		if (catalogExportPending)
+			catalogExportPending = !saveDataMap(createDataMap());
+	}
 }
 
 const QString Satellites::readCatalogVersion()
@@ -839,11 +909,35 @@ void Satellites::setDataMap(const QVariantMap& map)
 		}
 	}
 	qSort(satellites);
+	sgp4BatchDirty = true;
 	
 	if (satelliteListModel)
 		satelliteListModel->endSatellitesChange();
 }
 
+void Satellites::setCatalogEntries(const QVector<SatelliteCatalogEntry>& entries)
+{
+	if (satelliteListModel)
+		satelliteListModel->beginSatellitesChange();
+
+	satellites.clear();
+	groups.clear();
+	foreach(const SatelliteCatalogEntry& entry, entries)
+	{
+		SatelliteP sat(new Satellite(entry));
+		if (sat->initialized)
+		{
+			satellites.append(sat);
+			groups.unite(sat->groups);
+		}
+	}
+	qSort(satellites);
+	sgp4BatchDirty = true;
+
+	if (satelliteListModel)
+		satelliteListModel->endSatellitesChange();
+}
+
 QVariantMap Satellites::createDataMap(void)
 {
 	QVariantMap map;
@@ -1009,6 +1103,7 @@ void Satellites::add(const TleDataList& newSatellites)
 	}
 	if (numAdded > 0)
 		qSort(satellites);
+	sgp4BatchDirty = true;
 	
 	if (satelliteListModel)
 		satelliteListModel->endSatellitesChange();
@@ -1042,6 +1137,7 @@ void Satellites::remove(const QStringList& idList)
 		}
 	}
 	// As the satellite list is kept sorted, no need for re-sorting.
+	sgp4BatchDirty = true;
 	
 	if (satelliteListModel)
 		satelliteListModel->endSatellitesChange();
@@ -1404,7 +1500,26 @@ void Satellites::hideMessages()
 
 void Satellites::saveCatalog(QString path)
 {
-	saveDataMap(createDataMap(), path);
+	const bool saved = saveDataMap(createDataMap(), path);
+	if (path.isEmpty() || path == catalogPath)
+		saveCatalogStore(!saved);
+}
+
+bool Satellites::saveTleFile(const QString& path)
+{
+	QFile tleFile(path);
+	if (!tleFile.open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		qWarning() << "[Satellites] cannot open for writing:" << QDir::toNativeSeparators(path);
+		return false;
+	}
+	QVector<SatelliteCatalogEntry> entries;
+	entries.reserve(satellites.size());
+	foreach(const SatelliteP& sat, satellites)
+		entries.append(sat->getCatalogEntry());
+	SatelliteCatalogStore::writeTle(tleFile, entries);
+	tleFile.close();
+	return true;
 }
 
 void Satellites::updateFromFiles(QStringList paths, bool deleteFiles)
@@ -1452,6 +1567,7 @@ void Satellites::updateSatellites(TleDataHash& newTleSets)
 	int addedCount = 0;
 	int missingCount = 0; // Also the number of removed sats, if any.
 	QStringList toBeRemoved;
+	QList<SatelliteP> updatedSatellites;
 	foreach(const SatelliteP& sat, satellites)
 	{
 		totalCount++;
@@ -1484,10 +1600,15 @@ void Satellites::updateSatellites(TleDataHash& newTleSets)
 
 				// we reset this to "now" when we started the update.
 				sat->lastUpdated = lastUpdate;
+				updatedSatellites.append(sat);
 				updatedCount++;
 			}
-			if (qsMagList.contains(id))
+			if (qsMagList.contains(id) && sat->stdMag != qsMagList[id])
+			{
 				sat->stdMag = qsMagList[id];
+				if (updatedSatellites.isEmpty() || updatedSatellites.last() != sat)
+					updatedSatellites.append(sat);
+			}
 
 		}
 		else
@@ -1523,6 +1644,7 @@ void Satellites::updateSatellites(TleDataHash& newTleSets)
 	}
 	if (addedCount)
 		qSort(satellites);
+	sgp4BatchDirty = true;
 	
 	if (autoRemoveEnabled && !toBeRemoved.isEmpty())
 	{
@@ -1533,7 +1655,22 @@ void Satellites::updateSatellites(TleDataHash& newTleSets)
 	if (updatedCount > 0 ||
 	        (autoRemoveEnabled && missingCount > 0))
 	{
-		saveDataMap(createDataMap());
+		// The new elements are written in place in the catalog store, the catalog
+		// file is written when the plug-in is unloaded.
+		bool updatedInPlace = catalogStore.isOpen() && addedCount == 0 && !(autoRemoveEnabled && !toBeRemoved.isEmpty());
+		foreach(const SatelliteP& sat, updatedSatellites)
+		{
+			if (!updatedInPlace)
+				break;
+			updatedInPlace = catalogStore.setEntry(catalogStore.indexOf(sat->id), sat->getCatalogEntry());
+		}
+		if (updatedInPlace)
+		{
+			catalogStore.setJsonExportPending(true);
+			catalogExportPending = true;
+		}
+		else
+			saveCatalogStore(true);
 		updateState = CompleteUpdates;
 	}
 	else
@@ -1695,11 +1832,29 @@ void Satellites::update(double deltaTime)
 
 	hintFader.update((int)(deltaTime*1000));
 
+	// The orbits of the displayed satellites are propagated together by SGP4Batch.
+	QVector<Satellite*> displayedSatellites;
+	displayedSatellites.reserve(satellites.size());
 	foreach(const SatelliteP& sat, satellites)
 	{
-		if (sat->initialized && sat->displayed)
-			sat->update(deltaTime);
+		if (sat->initialized && sat->displayed && sat->orbitValid && sat->pSatWrapper && sat->pSatWrapper->getSatRec())
+			displayedSatellites.append(sat.data());
+	}
+	if (sgp4BatchDirty || displayedSatellites!=batchSatellites)
+	{
+		sgp4Batch.clear();
+		foreach(Satellite* sat, displayedSatellites)
+			sgp4Batch.append(*sat->pSatWrapper->getSatRec());
+		batchSatellites = displayedSatellites;
+		sgp4BatchDirty = false;
 	}
+
+	sgp4Batch.propagate(core->getJD(), true);
+	// The observer and the Sun are computed once for all satellites. The context is copied,
+	// the orbit lines of the satellites change the epoch of gSatWrapper.
+	const gSatFrameContext frame = gSatWrapper::updateFrameContext(core->getJD());
+	for (int i=0;i<batchSatellites.size();++i)
+		batchSatellites[i]->update(sgp4Batch, i, frame);
 }
 
 void Satellites::draw(StelCore* core)
@@ -2040,6 +2195,89 @@ IridiumFlaresPredictionList Satellites::getIridiumFlaresPrediction()
 #endif
 
 
+// Run in the global thread pool by predictPasses(), the targets are copies of the satellites.
+static QVector<SatellitePass> predictPassesBackground(const SatellitePassPredictor& predictor, const QVector<SatellitePassPredictor::Target>& targets, double startJD, double endJD)
+{
+	return predictor.predict(targets, startJD, endJD, true);
+}
+
+void Satellites::predictPasses(int days)
+{
+	days = days<0 ? passPredictionDepth : boundPassPredictionDepth(days);
+	// The prediction can't be cancelled, the last request is started once it is finished.
+	if (passPrediction.isRunning())
+	{
+		pendingPassPredictionDays = days;
+		return;
+	}
+	StelCore* core = StelApp::getInstance().getCore();
+	const StelLocation& loc = core->getCurrentLocation();
+	const double startJD = core->getJD();
+	const double endJD = startJD + days;
+
+	QVector<SatellitePassPredictor::Target> targets;
+	targets.reserve(satellites.size());
+	foreach(const SatelliteP& sat, satellites)
+	{
+		const elsetrec* satrec = (sat->initialized && sat->pSatWrapper) ? sat->pSatWrapper->getSatRec() : Q_NULLPTR;
+		if (satrec)
+		{
+			SatellitePassPredictor::Target target;
+			target.id = sat->id;
+			target.name = sat->name;
+			target.satrec = *satrec;
+			targets.append(target);
+		}
+	}
+
+	const SatellitePassPredictor predictor(loc.latitude, loc.longitude, loc.altitude);
+	passPredictionStartJD = startJD;
+	passPredictionEndJD = endJD;
+	passPrediction.setFuture(QtConcurrent::run(predictPassesBackground, predictor, targets, startJD, endJD));
+}
+
+void Satellites::passPredictionCompleted()
+{
+	passIndex.setPasses(passPrediction.result(), passPredictionStartJD, passPredictionEndJD);
+	qDebug() << "[Satellites]" << passIndex.size() << "passes predicted for" << passPredictionEndJD-passPredictionStartJD << "days";
+	emit passIndexUpdated();
+	if (pendingPassPredictionDays>0)
+	{
+		const int days = pendingPassPredictionDays;
+		pendingPassPredictionDays = 0;
+		predictPasses(days);
+	}
+}
+
+// Get the data of the passes of given indices for scripts.
+static QVariantList passList(const SatellitePassIndex& index, const QVector<int>& passes, int maxCount=-1)
+{
+	QVariantList list;
+	const int count = maxCount<0 ? passes.size() : qMin(maxCount, passes.size());
+	for (int i=0;i<count;++i)
+		list.append(SatellitePassIndex::toVariantMap(index.at(passes.at(i))));
+	return list;
+}
+
+QVariantList Satellites::getPasses(double fromJD, double toJD, bool visibleOnly) const
+{
+	return passList(passIndex, passIndex.getPasses(fromJD, toJD, visibleOnly));
+}
+
+QVariantList Satellites::getSatellitePasses(const QString& id) const
+{
+	return passList(passIndex, passIndex.getPassesOf(id));
+}
+
+QVariantList Satellites::getSortedPasses(const QString& key, bool visibleOnly, int maxCount) const
+{
+	bool ok;
+	const SatellitePassIndex::SortKey sortKey = SatellitePassIndex::sortKeyFromString(key, &ok);
+	if (!ok)
+		qWarning() << "[Satellites] unknown key to sort the passes:" << key;
+	return passList(passIndex, passIndex.getSortedPasses(sortKey, visibleOnly), maxCount);
+}
+
 void Satellites::translations()
 {
 #if 0
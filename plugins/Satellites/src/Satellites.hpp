@@ -26,10 +26,14 @@
 #include "StelGui.hpp"
 #include "StelDialog.hpp"
 #include "StelLocation.hpp"
+#include "SGP4Batch.hpp"
+#include "SatellitePasses.hpp"
+#include "SatelliteCatalogStore.hpp"
 
 #include <QDateTime>
 #include <QFile>
 #include <QDir>
+#include <QFutureWatcher>
 #include <QUrl>
 #include <QVariantMap>
 
@@ -79,6 +83,11 @@ The satellite catalog is stored on the disk in [JSON](http://www.json.org/)
 format, in a file named "satellites.json". A default copy is embedded in the
 plug-in at compile time. A working copy is kept in the user data directory.
 
+A binary copy of the working catalog, "satellites.dat", is loaded instead of the
+JSON file as long as the JSON file is not changed (see SatelliteCatalogStore).
+The online updates are written to this file, and the JSON file is written when
+the plug-in is unloaded.
+
 <b>Configuration</b>
 
 The plug-ins' configuration data is stored in Stellarium's main configuration
@@ -377,6 +386,16 @@ public:
 
 	IridiumFlaresPredictionList getIridiumFlaresPrediction();
 
+	//! Longest prediction of satellite passes, in days
+	static const int MaxPassPredictionDepth = 30;
+	//! Bound a depth of prediction of satellite passes to 1 - MaxPassPredictionDepth days.
+	static int boundPassPredictionDepth(int days) { return qBound(1, days, static_cast<int>(MaxPassPredictionDepth)); }
+	//! Get depth of prediction for satellite passes, in days
+	int getPassPredictionDepth(void) const { return passPredictionDepth; }
+	//! Get the passes computed by the last predictPasses().
+	//! The passes of a running prediction are only available after passIndexUpdated().
+	const SatellitePassIndex& getPassIndex() const { return passIndex; }
+
 signals:
 	void hintsVisibleChanged(bool b);
 	void labelsVisibleChanged(bool b);
@@ -400,6 +419,9 @@ signals:
 	//! update source(s) (and were removed, if autoRemoveEnabled is set).
 	void tleUpdateComplete(int updated, int total, int added, int missing);
 
+	//! Emitted when the passes started by predictPasses() have been computed.
+	void passIndexUpdated();
+
 public slots:
 	// FIXME: Put back the getter functions - for scripts? --BM
 	
@@ -467,11 +489,38 @@ public slots:
 
 	//! Save the current satellite catalog to disk.
 	void saveCatalog(QString path=QString());
+	//! Save the elements of the satellites to a TLE file, with the name of each satellite
+	//! followed by its two lines.
+	//! @return true if the file was written
+	bool saveTleFile(const QString& path);
 
 	//! Set depth of prediction for Iridium flares
 	//! @param depth in days
 	void setIridiumFlaresPredictionDepth(int depth) { iridiumFlaresPredictionDepth=depth; }
 
+	//! Set depth of prediction for satellite passes, in days, see boundPassPredictionDepth()
+	void setPassPredictionDepth(int days) { passPredictionDepth=boundPassPredictionDepth(days); }
+	//! Start computing the passes of all satellites of the catalog above the horizon of the
+	//! current location, from the current date, in the global thread pool. The pass index is
+	//! replaced and passIndexUpdated() is emitted when they are computed. Only one prediction
+	//! runs at a time: a request made while one is running is started when it finishes, and
+	//! replaces the requests made before it.
+	//! @param days length of the prediction, see boundPassPredictionDepth(), or -1 for
+	//! getPassPredictionDepth()
+	void predictPasses(int days=-1);
+	//! Get the passes of the pass index above the horizon at some time between two dates.
+	//! @param fromJD, toJD Julian days (UTC)
+	//! @param visibleOnly only the passes where the satellite is visible during this time
+	//! @return a list of maps, see SatellitePassIndex::toVariantMap()
+	QVariantList getPasses(double fromJD, double toJD, bool visibleOnly=true) const;
+	//! Get the passes of the pass index of one satellite.
+	//! @param id NORAD catalog number of the satellite
+	QVariantList getSatellitePasses(const QString& id) const;
+	//! Get the passes of the pass index, sorted by "rise" time, culmination "altitude",
+	//! "duration" or satellite "name".
+	//! @param maxCount number of passes, or -1 for all passes
+	QVariantList getSortedPasses(const QString& key, bool visibleOnly=true, int maxCount=-1) const;
+
 private slots:
 
 private:
@@ -512,6 +561,13 @@ private:
 	QVariantMap loadDataMap(QString path=QString());
 	//! Parse a satellite catalog structure into internal satellite data.
 	void setDataMap(const QVariantMap& map);
+	//! Replace the satellites by the entries of the catalog store.
+	void setCatalogEntries(const QVector<SatelliteCatalogEntry>& entries);
+	//! Open the catalog store, if it has the data of the catalog file.
+	bool openCatalogStore();
+	//! Write the current satellites to the catalog store.
+	//! @param jsonExportPending true if the catalog file does not have these data yet
+	void saveCatalogStore(bool jsonExportPending);
 	//! Make a satellite catalog structure from current satellite data.
 	//! @return a representation of a JSON file.
 	QVariantMap createDataMap();
@@ -533,6 +589,14 @@ private:
 	QString qsMagFilePath;
 	//! Path to the satellite catalog file.
 	QString catalogPath;
+	//! Path to the binary copy of the catalog file.
+	QString catalogStorePath;
+	//! The satellites of the catalog file, loaded and updated faster than the JSON file.
+	//! The catalog file is written when the plug-in is unloaded, if the store has newer data.
+	SatelliteCatalogStore catalogStore;
+	//! The catalog file does not have the last data of the satellites yet. Kept apart from the
+	//! flag of the store, which cannot be read when the store could not be written.
+	bool catalogExportPending;
 	//! Plug-in data directory.
 	//! Intialized by init(). Contains the catalog file (satellites.json),
 	//! temporary TLE lists downloaded during an online update, or whatever
@@ -540,6 +604,11 @@ private:
 	QDir dataDir;
 	
 	QList<SatelliteP> satellites;
+	//! Orbits of the satellites updated by update(), in the order of batchSatellites.
+	SGP4Batch sgp4Batch;
+	QVector<Satellite*> batchSatellites;
+	//! Set when the satellites or their orbital elements change, to rebuild sgp4Batch.
+	bool sgp4BatchDirty;
 	SatellitesListModel* satelliteListModel;
 
 	QHash<QString, double> qsMagList;
@@ -604,6 +673,16 @@ private:
 
 	int iridiumFlaresPredictionDepth;
 
+	//! Satellite passes predicted by predictPasses()
+	SatellitePassIndex passIndex;
+	int passPredictionDepth;
+	//! The prediction started by predictPasses(), and its time window
+	QFutureWatcher<QVector<SatellitePass> > passPrediction;
+	double passPredictionStartJD;
+	double passPredictionEndJD;
+	//! The days of the last request made while a prediction was running, 0 if none
+	int pendingPassPredictionDays;
+
 	// GUI
 	SatellitesDialog* configDialog;
 
@@ -622,6 +701,8 @@ private slots:
 	//! can be modified to read directly form QNetworkReply-s. --BM
 	void saveDownloadedUpdate(QNetworkReply* reply);
 	void updateObserverLocation(StelLocation loc);
+	//! Replace the pass index by the passes of the finished prediction.
+	void passPredictionCompleted();
 };
 
 
@@ -638,7 +719,7 @@ class SatellitesStelPluginInterface : public QObject, public StelPluginInterface
 public:
 	virtual StelModule* getStelModule() const;
 	virtual StelPluginInfo getPluginInfo() const;
-	virtual QObjectList getExtensionList() const { return QObjectList(); }
+	virtual QObjectList getExtensionList() const;
 };
 
 #endif /*_SATELLITES_HPP_*/
@@ -0,0 +1,113 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "SatellitesRemoteControlService.hpp"
+
+#include "StelApp.hpp"
+#include "StelCore.hpp"
+#include "StelModuleMgr.hpp"
+
+#include <QJsonDocument>
+
+SatellitesRemoteControlService::SatellitesRemoteControlService()
+{
+	satellites = GETSTELMODULE(Satellites);
+}
+
+QLatin1String SatellitesRemoteControlService::getPath() const
+{
+	return QLatin1String("satellites");
+}
+
+bool SatellitesRemoteControlService::isThreadSafe() const
+{
+	return false;
+}
+
+void SatellitesRemoteControlService::update(double deltaTime)
+{
+	Q_UNUSED(deltaTime)
+}
+
+void SatellitesRemoteControlService::get(const QByteArray &operation, const APIParameters &parameters, APIServiceResponse &response)
+{
+	// The visible passes, unless visible=false
+	const bool visibleOnly = parameters.value("visible") != "false";
+
+	if(operation == "passes")
+	{
+		//passes between "from" and "to" (Julian days), by default the whole pass index
+		const SatellitePassIndex& index = satellites->getPassIndex();
+		bool fromOk, toOk;
+		double fromJD = parameters.value("from").toDouble(&fromOk);
+		double toJD = parameters.value("to").toDouble(&toOk);
+		if(!fromOk)
+			fromJD = index.getStartJD();
+		if(!toOk)
+			toJD = index.getEndJD();
+		response.writeJSON(QJsonDocument::fromVariant(satellites->getPasses(fromJD, toJD, visibleOnly)));
+	}
+	else if(operation == "satellitepasses")
+	{
+		QString id = QString::fromUtf8(parameters.value("id"));
+		if(id.isEmpty())
+		{
+			response.writeRequestError("requires id parameter");
+			return;
+		}
+		response.writeJSON(QJsonDocument::fromVariant(satellites->getSatellitePasses(id)));
+	}
+	else if(operation == "sortedpasses")
+	{
+		QString key = QString::fromUtf8(parameters.value("key", "rise"));
+		bool ok;
+		SatellitePassIndex::sortKeyFromString(key, &ok);
+		if(!ok)
+		{
+			response.writeRequestError("invalid key parameter. Keys: rise,altitude,duration,name");
+			return;
+		}
+		bool countOk;
+		int count = parameters.value("count").toInt(&countOk);
+		response.writeJSON(QJsonDocument::fromVariant(satellites->getSortedPasses(key, visibleOnly, countOk ? count : -1)));
+	}
+	else
+	{
+		response.writeRequestError("unsupported operation. GET: passes,satellitepasses,sortedpasses");
+	}
+}
+
+void SatellitesRemoteControlService::post(const QByteArray &operation, const APIParameters &parameters, const QByteArray &data, APIServiceResponse &response)
+{
+	Q_UNUSED(data)
+
+	if(operation == "predictpasses")
+	{
+		bool ok;
+		int days = parameters.value("days").toInt(&ok);
+		// Only starts the prediction, or queues it while another one runs. The passes are
+		// available when the pass index is updated.
+		satellites->predictPasses(ok ? Satellites::boundPassPredictionDepth(days) : -1);
+		response.setData("ok");
+	}
+	else
+	{
+		response.writeRequestError("unsupported operation. POST: predictpasses");
+	}
+}
@@ -0,0 +1,47 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _SATELLITESREMOTECONTROLSERVICE_HPP_
+#define _SATELLITESREMOTECONTROLSERVICE_HPP_
+
+#include "../../RemoteControl/include/RemoteControlServiceInterface.hpp"
+#include "Satellites.hpp"
+
+//! Provides the satellite passes of the pass index to the \ref remoteControl plugin.
+//! @ingroup satellites
+class SatellitesRemoteControlService : public QObject, public RemoteControlServiceInterface
+{
+	Q_OBJECT
+	Q_INTERFACES(RemoteControlServiceInterface)
+
+public:
+	//! Requires the Satellites module to be registered
+	SatellitesRemoteControlService();
+
+	// RemoteControlServiceInterface interface
+	virtual QLatin1String getPath() const Q_DECL_OVERRIDE;
+	virtual bool isThreadSafe() const Q_DECL_OVERRIDE;
+	virtual void get(const QByteArray &operation, const APIParameters &parameters, APIServiceResponse &response) Q_DECL_OVERRIDE;
+	virtual void post(const QByteArray &operation, const APIParameters &parameters, const QByteArray &data, APIServiceResponse &response) Q_DECL_OVERRIDE;
+	virtual void update(double deltaTime) Q_DECL_OVERRIDE;
+private:
+	Satellites* satellites;
+};
+
+#endif // _SATELLITESREMOTECONTROLSERVICE_HPP_
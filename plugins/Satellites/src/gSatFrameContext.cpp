@@ -0,0 +1,117 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "gSatFrameContext.hpp"
+#include "gsatellite/gTime.hpp"
+#include "gsatellite/stdsat.h"
+
+#include <cmath>
+
+gSatFrameContext::gSatFrameContext()
+	: valid(false)
+	, epoch(0.)
+	, latitude(0.)
+	, longitude(0.)
+	, altitude(0.)
+	, theta(0.)
+	, sinLatitude(0.)
+	, cosLatitude(1.)
+	, sinTheta(0.)
+	, cosTheta(1.)
+	, sunAboveHorizon(false)
+{
+}
+
+gSatFrameContext::gSatFrameContext(double ai_julianDaysEpoch, double ai_latitude, double ai_longitude, double ai_altitude,
+				   const Vec3d& ai_sunTopoEquPos, bool ai_sunAboveHorizon)
+{
+	init(ai_julianDaysEpoch, ai_latitude, ai_longitude, ai_altitude);
+	// Change ref system centre
+	sunECIPos = ai_sunTopoEquPos + observerECIPos;
+	sunAboveHorizon = ai_sunAboveHorizon;
+}
+
+gSatFrameContext::gSatFrameContext(double ai_julianDaysEpoch, double ai_latitude, double ai_longitude, double ai_altitude,
+				   const Vec3d& ai_sunECIPos)
+{
+	init(ai_julianDaysEpoch, ai_latitude, ai_longitude, ai_altitude);
+	sunECIPos = ai_sunECIPos;
+	sunAboveHorizon = computeAltAz(sunECIPos)[2] > 0.0;
+}
+
+void gSatFrameContext::init(double ai_julianDaysEpoch, double ai_latitude, double ai_longitude, double ai_altitude)
+{
+	valid       = true;
+	epoch       = ai_julianDaysEpoch;
+	latitude    = ai_latitude;
+	longitude   = ai_longitude;
+	altitude    = ai_altitude;
+
+	const double radLatitude = latitude * KDEG2RAD;
+	theta       = gTime(epoch).toThetaLMST(longitude * KDEG2RAD);
+	sinLatitude = std::sin(radLatitude);
+	cosLatitude = std::cos(radLatitude);
+	sinTheta    = std::sin(theta);
+	cosTheta    = std::cos(theta);
+
+	/* Reference:  Explanatory supplement to the Astronomical Almanac 1992, page 209-210. */
+	/* Elipsoid earth model*/
+	/* c = Nlat/a */
+	const double c  = 1/std::sqrt(1 + __f*(__f - 2)*sinLatitude*sinLatitude);
+	const double sq = (1 - __f)*(1 - __f)*c;
+	const double r  = (KEARTHRADIUS*c + (altitude/1000))*cosLatitude;
+	observerECIPos.set(r * cosTheta, r * sinTheta, (KEARTHRADIUS*sq + (altitude/1000))*sinLatitude); /*kilometers*/
+	observerECIVel.set(-KMFACTOR*observerECIPos[1], KMFACTOR*observerECIPos[0], 0.); /*kilometers/second*/
+}
+
+Vec3d gSatFrameContext::computeAltAz(const Vec3d& satECIPos) const
+{
+	const Vec3d slantRange = satECIPos - observerECIPos;
+	//top_s
+	return Vec3d(sinLatitude * cosTheta*slantRange[0]
+		     + sinLatitude* sinTheta*slantRange[1]
+		     - cosLatitude* slantRange[2],
+	//top_e
+		     (-1.0)* sinTheta*slantRange[0]
+		     + cosTheta*slantRange[1],
+	//top_z
+		     cosLatitude * cosTheta*slantRange[0]
+		     + cosLatitude * sinTheta*slantRange[1]
+		     + sinLatitude *slantRange[2]);
+}
+
+void gSatFrameContext::computeSlantRange(const Vec3d& satECIPos, const Vec3d& satECIVel, double& ao_slantRange, double& ao_slantRangeRate) const
+{
+	const Vec3d slantRange         = satECIPos - observerECIPos;
+	const Vec3d slantRangeVelocity = satECIVel - observerECIVel;
+	ao_slantRange     = slantRange.length();
+	ao_slantRangeRate = slantRange.dot(slantRangeVelocity)/ao_slantRange;
+}
+
+bool gSatFrameContext::isSunlit(const Vec3d& satECIPos) const
+{
+	const double sunSatAngle = sunECIPos.angle(satECIPos);
+	const double Dist = satECIPos.length()*std::cos(sunSatAngle - (M_PI/2));
+	return Dist > KEARTHRADIUS;
+}
+
+double gSatFrameContext::computePhaseAngle(const Vec3d& satECIPos) const
+{
+	return sunECIPos.angle(satECIPos);
+}
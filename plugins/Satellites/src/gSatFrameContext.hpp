@@ -0,0 +1,91 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _GSATFRAMECONTEXT_HPP_
+#define _GSATFRAMECONTEXT_HPP_
+
+#include "VecMath.hpp"
+
+//! @class gSatFrameContext
+//! Observer and Sun data shared by all satellites at an epoch: the observer ECI position and
+//! velocity, the local mean sidereal time and the Sun ECI position. gSatWrapper computes them
+//! once per epoch and location, instead of once per satellite and method.
+//! ECI axis (IJK) are parallel to StelCore::EquinoxEQ Framework, centered in the earth centre.
+//! All positions are measured in km, velocities in km/s.
+//! @ingroup satellites
+class gSatFrameContext
+{
+public:
+	gSatFrameContext();
+	//! @param ai_julianDaysEpoch Julian day (UTC) of the context
+	//! @param ai_latitude geodetic latitude of the observer in degrees
+	//! @param ai_longitude longitude of the observer in degrees
+	//! @param ai_altitude altitude of the observer in m
+	//! @param ai_sunTopoEquPos topocentric position of the Sun in the equatorial frame of date
+	//! @param ai_sunAboveHorizon whether the Sun is above the horizon of the observer
+	gSatFrameContext(double ai_julianDaysEpoch, double ai_latitude, double ai_longitude, double ai_altitude,
+			 const Vec3d& ai_sunTopoEquPos, bool ai_sunAboveHorizon);
+	//! Same as above, with the geocentric (ECI) position of the Sun. The Sun is above the horizon
+	//! when its geometric altitude is positive.
+	gSatFrameContext(double ai_julianDaysEpoch, double ai_latitude, double ai_longitude, double ai_altitude,
+			 const Vec3d& ai_sunECIPos);
+
+	//! Check whether the context was computed for this epoch and observer location.
+	bool isValidFor(double ai_julianDaysEpoch, double ai_latitude, double ai_longitude, double ai_altitude) const
+	{
+		return valid && epoch==ai_julianDaysEpoch && latitude==ai_latitude && longitude==ai_longitude && altitude==ai_altitude;
+	}
+
+	double getEpoch() const {return epoch;}
+	//! Local mean sidereal time in radians.
+	double getThetaLMST() const {return theta;}
+	const Vec3d& getObserverECIPos() const {return observerECIPos;}
+	const Vec3d& getObserverECIVel() const {return observerECIVel;}
+	const Vec3d& getSunECIPos() const {return sunECIPos;}
+	bool isSunAboveHorizon() const {return sunAboveHorizon;}
+
+	//! Compute the topocentric position of a satellite (south, east, zenith).
+	//! @par References
+	//!  Orbital Coordinate Systems, Part II
+	//!   Dr. T.S. Kelso
+	//!   http://www.celestrak.com/columns/v02n02/
+	Vec3d computeAltAz(const Vec3d& satECIPos) const;
+	//! Compute the distance between the satellite and the observer, and its variation.
+	void computeSlantRange(const Vec3d& satECIPos, const Vec3d& satECIVel, double& ao_slantRange, double& ao_slantRangeRate) const;
+	//! Check whether the satellite is outside of the earth shadow.
+	bool isSunlit(const Vec3d& satECIPos) const;
+	double computePhaseAngle(const Vec3d& satECIPos) const;
+
+private:
+	//! Compute the observer data.
+	void init(double ai_julianDaysEpoch, double ai_latitude, double ai_longitude, double ai_altitude);
+
+	bool valid;
+	double epoch;
+	double latitude, longitude, altitude;
+	double theta;
+	double sinLatitude, cosLatitude;
+	double sinTheta, cosTheta;
+	Vec3d observerECIPos;
+	Vec3d observerECIVel;
+	Vec3d sunECIPos;
+	bool sunAboveHorizon;
+};
+
+#endif // _GSATFRAMECONTEXT_HPP_
@@ -124,163 +124,98 @@ void gSatWrapper::setEpoch(double ai_julianDaysEpoch)
 }
 
 
-void gSatWrapper::calcObserverECIPosition(Vec3d& ao_position, Vec3d& ao_velocity)
+void gSatWrapper::setEpoch(double ai_julianDaysEpoch, const Vec3d& ai_temePos, const Vec3d& ai_temeVel)
 {
-
-	if (epoch != lastCalcObserverECIPosition)
+	epoch = ai_julianDaysEpoch;
+	if (pSatellite)
 	{
-		StelLocation loc   = StelApp::getInstance().getCore()->getCurrentLocation();
-
-		double radLatitude = loc.latitude * KDEG2RAD;
-		double theta       = epoch.toThetaLMST(loc.longitude * KDEG2RAD);
-		double r;
-		double c,sq;
-
-		/* Reference:  Explanatory supplement to the Astronomical Almanac 1992, page 209-210. */
-		/* Elipsoid earth model*/
-		/* c = Nlat/a */
-		c = 1/std::sqrt(1 + __f*(__f - 2)*Sqr(sin(radLatitude)));
-		sq = Sqr(1 - __f)*c;
-
-		r = (KEARTHRADIUS*c + (loc.altitude/1000))*cos(radLatitude);
-		ao_position[0] = r * cos(theta);/*kilometers*/
-		ao_position[1] = r * sin(theta);
-		ao_position[2] = (KEARTHRADIUS*sq + (loc.altitude/1000))*sin(radLatitude);
-		ao_velocity[0] = -KMFACTOR*ao_position[1];/*kilometers/second*/
-		ao_velocity[1] =  KMFACTOR*ao_position[0];
-		ao_velocity[2] =  0;
-
-		lastCalcObserverECIPosition=epoch;
+		const double position[3] = {ai_temePos[0], ai_temePos[1], ai_temePos[2]};
+		const double vel[3] = {ai_temeVel[0], ai_temeVel[1], ai_temeVel[2]};
+		pSatellite->setStateVector(epoch, position, vel);
 	}
 }
 
-
-
-Vec3d gSatWrapper::getAltAz() const
+const elsetrec* gSatWrapper::getSatRec() const
 {
-	StelLocation loc   = StelApp::getInstance().getCore()->getCurrentLocation();
-	Vec3d topoSatPos;
-
-	const double  radLatitude    = loc.latitude * KDEG2RAD;
-	const double  theta          = epoch.toThetaLMST(loc.longitude * KDEG2RAD);
-	const double sinRadLatitude=sin(radLatitude);
-	const double cosRadLatitude=cos(radLatitude);
-	const double sinTheta=sin(theta);
-	const double cosTheta=cos(theta);
-
-	// This now only updates if required.
-	calcObserverECIPosition(observerECIPos, observerECIVel);
-
-	Vec3d satECIPos  = getTEMEPos();
-	Vec3d slantRange = satECIPos - observerECIPos;
-
-	//top_s
-	topoSatPos[0] = (sinRadLatitude * cosTheta*slantRange[0]
-			 + sinRadLatitude* sinTheta*slantRange[1]
-			 - cosRadLatitude* slantRange[2]);
-	//top_e
-	topoSatPos[1] = ((-1.0)* sinTheta*slantRange[0]
-			 + cosTheta*slantRange[1]);
-
-	//top_z
-	topoSatPos[2] = (cosRadLatitude * cosTheta*slantRange[0]
-			 + cosRadLatitude * sinTheta*slantRange[1]
-			 + sinRadLatitude *slantRange[2]);
-
-	return topoSatPos;
+	return pSatellite ? &pSatellite->getSatRec() : Q_NULLPTR;
 }
 
-void  gSatWrapper::getSlantRange(double &ao_slantRange, double &ao_slantRangeRate) const
+const gSatFrameContext& gSatWrapper::getFrameContext()
 {
-	//Vec3d observerECIPos;
-	//Vec3d observerECIVel;
-	calcObserverECIPosition(observerECIPos, observerECIVel);
-
-        Vec3d satECIPos            = getTEMEPos();
-        Vec3d satECIVel            = getTEMEVel();
-        Vec3d slantRange           = satECIPos - observerECIPos;
-        Vec3d slantRangeVelocity   = satECIVel - observerECIVel;
-
-	ao_slantRange     = slantRange.length();
-        ao_slantRangeRate = slantRange.dot(slantRangeVelocity)/ao_slantRange;
+	StelCore* core = StelApp::getInstance().getCore();
+	const StelLocation& loc = core->getCurrentLocation();
+	if (!frameContext.isValidFor(epoch.getGmtTm(), loc.latitude, loc.longitude, loc.altitude))
+	{
+		static const SolarSystem *solsystem = (SolarSystem*)StelApp::getInstance().getModuleMgr().getModule("SolarSystem");
+		// All positions in ECI system are positions referenced in a StelCore::EquinoxEq system centered in the earth centre
+		// sunEquinoxEqPos is measured in AU. we need measure it in Km
+		const Vec3d sunEquinoxEqPos = solsystem->getSun()->getEquinoxEquatorialPos(core) * AU;
+		const bool sunAboveHorizon = solsystem->getSun()->getAltAzPosGeometric(core)[2] > 0.0;
+		frameContext = gSatFrameContext(epoch.getGmtTm(), loc.latitude, loc.longitude, loc.altitude, sunEquinoxEqPos, sunAboveHorizon);
+	}
+	return frameContext;
 }
 
-// Does the actual computation only if necessary (0.1s apart) and caches the result in a static variable.
-void gSatWrapper::updateSunECIPos()
+const gSatFrameContext& gSatWrapper::updateFrameContext(double ai_julianDaysEpoch)
 {
-	// All positions in ECI system are positions referenced in a StelCore::EquinoxEq system centered in the earth centre
-	//Vec3d observerECIPos;
-	//Vec3d observerECIVel;
-	calcObserverECIPosition(observerECIPos, observerECIVel);
+	epoch = ai_julianDaysEpoch;
+	return getFrameContext();
+}
 
-	static const SolarSystem *solsystem = (SolarSystem*)StelApp::getInstance().getModuleMgr().getModule("SolarSystem");
-	Vec3d sunEquinoxEqPos = solsystem->getSun()->getEquinoxEquatorialPos(StelApp::getInstance().getCore());
+void gSatWrapper::calcObserverECIPosition(Vec3d& ao_position, Vec3d& ao_velocity)
+{
+	const gSatFrameContext& frame = getFrameContext();
+	ao_position = frame.getObserverECIPos();
+	ao_velocity = frame.getObserverECIVel();
+}
 
-	//sunEquinoxEqPos is measured in AU. we need measure it in Km
-	//Vec3d sunECIPos;
-	sunECIPos.set(sunEquinoxEqPos[0]*AU, sunEquinoxEqPos[1]*AU, sunEquinoxEqPos[2]*AU);
-	sunECIPos = sunECIPos + observerECIPos; //Change ref system centre
+Vec3d gSatWrapper::getAltAz() const
+{
+	return getAltAz(getFrameContext());
+}
 
+Vec3d gSatWrapper::getAltAz(const gSatFrameContext& ai_frame) const
+{
+	return ai_frame.computeAltAz(getTEMEPos());
+}
 
+void  gSatWrapper::getSlantRange(double &ao_slantRange, double &ao_slantRangeRate) const
+{
+	getSlantRange(getFrameContext(), ao_slantRange, ao_slantRangeRate);
+}
 
+void  gSatWrapper::getSlantRange(const gSatFrameContext& ai_frame, double &ao_slantRange, double &ao_slantRangeRate) const
+{
+	ai_frame.computeSlantRange(getTEMEPos(), getTEMEVel(), ao_slantRange, ao_slantRangeRate);
 }
 
 Vec3d gSatWrapper::getSunECIPos()
 {
-	if (epoch != lastSunECIepoch)
-	{
-		updateSunECIPos();
-		lastSunECIepoch=epoch;
-	}
-	return sunECIPos;
+	return getFrameContext().getSunECIPos();
 }
 
 // Operation getVisibilityPredict
 // @brief This operation predicts the satellite visibility conditions.
 gSatWrapper::Visibility gSatWrapper::getVisibilityPredict()
 {
-	Vec3d satAltAzPos = getAltAz();
+	const gSatFrameContext& frame = getFrameContext();
+	return getVisibilityPredict(frame, getAltAz(frame));
+}
 
-	if (satAltAzPos[2] > 0)
-	{
-		Vec3d satECIPos = getTEMEPos();
-		static const SolarSystem *solsystem = (SolarSystem*)StelApp::getInstance().getModuleMgr().getModule("SolarSystem");
-		Vec3d sunAltAzPos = solsystem->getSun()->getAltAzPosGeometric(StelApp::getInstance().getCore());
-		Vec3d sunECIPos = getSunECIPos();
-
-		if (sunAltAzPos[2] > 0.0)
-		{
-			return RADAR_SUN;
-		}
-		else
-		{
-			double sunSatAngle = sunECIPos.angle(satECIPos);
-			double Dist = satECIPos.length()*cos(sunSatAngle - (M_PI/2));
-
-			if (Dist > KEARTHRADIUS)
-			{
-				return VISIBLE;
-			}
-			else
-			{
-				return RADAR_NIGHT;
-			}
-		}
-	}
-	else
-		return NOT_VISIBLE;
+gSatWrapper::Visibility gSatWrapper::getVisibilityPredict(const gSatFrameContext& ai_frame, const Vec3d& ai_altAz) const
+{
+	return computeVisibility(ai_frame, getTEMEPos(), ai_altAz);
 }
 
 double gSatWrapper::getPhaseAngle() const
 {
-	Vec3d sunECIPos = getSunECIPos();
-	return sunECIPos.angle(getTEMEPos());
+	return getPhaseAngle(getFrameContext());
 }
 
-gTime gSatWrapper::epoch;
-gTime gSatWrapper::lastSunECIepoch=0.0; // store last time of computation to avoid all-1 computations.
-gTime gSatWrapper::lastCalcObserverECIPosition;
+double gSatWrapper::getPhaseAngle(const gSatFrameContext& ai_frame) const
+{
+	return ai_frame.computePhaseAngle(getTEMEPos());
+}
 
-Vec3d gSatWrapper::sunECIPos; // enough to have this once.
-Vec3d gSatWrapper::observerECIPos;
-Vec3d gSatWrapper::observerECIVel;
+gTime gSatWrapper::epoch;
+gSatFrameContext gSatWrapper::frameContext;
@@ -32,6 +32,7 @@
 #include <QString>
 
 #include "VecMath.hpp"
+#include "gSatFrameContext.hpp"
 
 #include "gsatellite/gSatTEME.hpp"
 #include "gsatellite/gTime.hpp"
@@ -59,6 +60,14 @@ public:
 	//! from Stellarium Julian Date.
 	void setEpoch(double ai_julianDaysEpoch);
 
+	//! @brief Same as setEpoch(), with the TEME position (km) and velocity (km/s)
+	//! already computed, e.g. by SGP4Batch.
+	void setEpoch(double ai_julianDaysEpoch, const Vec3d& ai_temePos, const Vec3d& ai_temeVel);
+
+	//! @brief Get the SGP4 elements and constants of the satellite, to propagate it with SGP4Batch.
+	//! @return Q_NULLPTR if the satellite is not initialized.
+	const elsetrec* getSatRec() const;
+
 	// Operation getTEMEPos
 	//! @brief This operation isolate gSatTEME getPos operation.
 	//! @return Vec3d with TEME position. Units measured in Km.
@@ -90,6 +99,8 @@ public:
 	//!   Dr. T.S. Kelso
 	//!   http://www.celestrak.com/columns/v02n02/
 	Vec3d getAltAz() const;
+	//! @brief Same as getAltAz(), with the observer data of @em ai_frame.
+	Vec3d getAltAz(const gSatFrameContext& ai_frame) const;
 
         // Operation getSlantRange
         //! @brief This operation compute the slant range (distance between the
@@ -98,6 +109,7 @@ public:
         //! @param &ao_slantRangeRate Reference to a output variable where the method store the slant range variation in Km/s
         //! @return void
 	void  getSlantRange(double &ao_slantRange, double &ao_slantRangeRate) const; //measured in km and km/s
+	void  getSlantRange(const gSatFrameContext& ai_frame, double &ao_slantRange, double &ao_slantRangeRate) const;
 
 
         // Operation getVisibilityPredict
@@ -116,8 +128,36 @@ public:
         //!   Fundamentals of Astrodynamis and Applications (Third Edition) pg 898
         //!   David A. Vallado
 	Visibility getVisibilityPredict();
+	//! @brief Same as getVisibilityPredict(), with the observer and Sun data of @em ai_frame
+	//! and the position @em ai_altAz returned by getAltAz(ai_frame).
+	Visibility getVisibilityPredict(const gSatFrameContext& ai_frame, const Vec3d& ai_altAz) const;
+	//! @brief The prediction of getVisibilityPredict() for a satellite at the TEME position
+	//! @em ai_satECIPos, seen at @em ai_altAz.
+	static Visibility computeVisibility(const gSatFrameContext& ai_frame, const Vec3d& ai_satECIPos, const Vec3d& ai_altAz)
+	{
+		if (ai_altAz[2] > 0)
+		{
+			if (ai_frame.isSunAboveHorizon())
+				return RADAR_SUN;
+			else if (ai_frame.isSunlit(ai_satECIPos))
+				return VISIBLE;
+			else
+				return RADAR_NIGHT;
+		}
+		else
+			return NOT_VISIBLE;
+	}
 
 	double getPhaseAngle() const;
+	double getPhaseAngle(const gSatFrameContext& ai_frame) const;
+
+	// Operation getFrameContext
+	//! @brief Get the observer and Sun data shared by all satellites at the current epoch,
+	//! for the current location. They are computed once per epoch and location.
+	static const gSatFrameContext& getFrameContext();
+	//! @brief Set the epoch of all satellites and compute the frame context at this epoch.
+	//! Call it once per frame, before updating the satellites.
+	static const gSatFrameContext& updateFrameContext(double ai_julianDaysEpoch);
 	gTime	getEpoch() const { return epoch; }
 
 
@@ -138,18 +178,11 @@ public:
 
 
 private:
-	//! do the actual work to compute a cached value.
-	static void updateSunECIPos();
-
 	gSatTEME *pSatellite;
 	static gTime	 epoch;
 
 	// GZ We can avoid many computations (solar and observer positions for every satellite) by computing them only once for all objects.
-	static gTime lastSunECIepoch; // store last time of computation to avoid all-1 computations.
-	static Vec3d sunECIPos;       // enough to have these once.
-	static Vec3d observerECIPos;
-	static Vec3d observerECIVel;
-	static gTime lastCalcObserverECIPosition;
+	static gSatFrameContext frameContext;
 
 };
 
@@ -84,6 +84,10 @@ public:
 	//! and fraction of minutes.
 	void setMinSinceKepEpoch(double ai_minSinceKepEpoch);
 
+	// Set the state vector already computed by sgp4 for ai_time,
+	// e.g. by a batch propagation of many satellites.
+	void setStateVector(gTime ai_time, const double ai_position[3], const double ai_vel[3]);
+
 	// Operation: getPos()
 	//! @brief Get the TEME satellite position Vector
 	//! @return gVector
@@ -129,6 +133,11 @@ public:
 		return satrec.error;
 	}
 
+	const elsetrec& getSatRec() const
+	{
+		return satrec;
+	}
+
 private:
 	// Operation:  computeSubPoint
 	//! @brief Compute the Geographic satellite subpoint Vector
@@ -41,6 +41,7 @@
 
 // Init statics
 QNetworkAccessManager* MultiLevelJsonBase::networkAccessManager = Q_NULLPTR;
+QPointer<StelJsonParseQueue> MultiLevelJsonBase::parseQueue;
 
 QNetworkAccessManager& MultiLevelJsonBase::getNetworkAccessManager()
 {
@@ -58,35 +59,15 @@ QNetworkAccessManager& MultiLevelJsonBase::getNetworkAccessManager()
 	return *networkAccessManager;
 }
 
-/*************************************************************************
-  Class used to load a JSON file in a thread
- *************************************************************************/
-class JsonLoadThread : public QThread
+StelJsonParseQueue& MultiLevelJsonBase::getParseQueue()
 {
-	public:
-		JsonLoadThread(MultiLevelJsonBase* atile, QByteArray content, bool aqZcompressed=false, bool agzCompressed=false) : QThread((QObject*)atile),
-			tile(atile), data(content), qZcompressed(aqZcompressed), gzCompressed(agzCompressed){;}
-		virtual void run();
-	private:
-		MultiLevelJsonBase* tile;
-		QByteArray data;
-		const bool qZcompressed;
-		const bool gzCompressed;
-};
-
-void JsonLoadThread::run()
-{
-	try
+	if (parseQueue.isNull())
 	{
-		QBuffer buf(&data);
-		buf.open(QIODevice::ReadOnly);
-		tile->temporaryResultMap = MultiLevelJsonBase::loadFromJSON(buf, qZcompressed, gzCompressed);
-	}
-	catch (std::runtime_error e)
-	{
-		qWarning() << "WARNING : Can't parse loaded JSON description: " << e.what();
-		tile->errorOccured = true;
+		// A few threads are enough, the queue makes sure that the tiles in view are parsed first
+		// and the tiles which left the view are not parsed at all.
+		parseQueue = new StelJsonParseQueue(qMin(2, QThread::idealThreadCount()), 64, &StelApp::getInstance());
 	}
+	return *parseQueue;
 }
 
 MultiLevelJsonBase::MultiLevelJsonBase(MultiLevelJsonBase* parent) : StelSkyLayer(parent)
@@ -94,14 +75,15 @@ MultiLevelJsonBase::MultiLevelJsonBase(MultiLevelJsonBase* parent) : StelSkyLaye
 	, downloading(false)
 	, httpReply(Q_NULLPTR)
 	, deletionDelay(2.)
-	, loadThread(Q_NULLPTR)
 	, timeWhenDeletionScheduled(-1.) // Avoid tiles to be deleted just after constructed
+	, loadPriority(0.)
 	, loadingState(false)
 	, lastPercent(0)
 {
 	if (parent!=Q_NULLPTR)
 	{
 		deletionDelay = parent->deletionDelay;
+		loadPriority = parent->loadPriority;
 	}
 }
 
@@ -136,6 +118,13 @@ void MultiLevelJsonBase::initFromUrl(const QString& url)
 		{
 			const bool compressed = fileName.endsWith(".qZ");
 			const bool gzCompressed = fileName.endsWith(".gz");
+			if (parent!=Q_NULLPTR)
+			{
+				// Subtiles are created while drawing, parse them in the background
+				queueJsonContent(f.readAll(), compressed, gzCompressed);
+				f.close();
+				return;
+			}
 			try
 			{
 				loadFromQVariantMap(loadFromJSON(f, compressed, gzCompressed));
@@ -217,16 +206,12 @@ MultiLevelJsonBase::~MultiLevelJsonBase()
 		//httpReply->deleteLater();
 		httpReply = Q_NULLPTR;
 	}
-	if (loadThread && loadThread->isRunning())
+	// The queue may already be destroyed with the application
+	if (parseRequest && parseQueue)
 	{
-		//qDebug() << "--> Abort thread " << contructorUrl;
-		disconnect(loadThread, SIGNAL(finished()), this, SLOT(jsonLoadFinished()));
-		// The thread is currently running, it needs to be properly stopped
-		if (loadThread->wait(1)==false)
-		{
-			loadThread->terminate();
-			//loadThread->wait(2000);
-		}
+		// If the file is being parsed, the result is discarded
+		parseQueue->cancel(parseRequest);
+		parseRequest.clear();
 	}
 	foreach (MultiLevelJsonBase* tile, subTiles)
 	{
@@ -242,6 +227,18 @@ void MultiLevelJsonBase::scheduleChildsDeletion()
 	{
 		if (tile->timeWhenDeletionScheduled<0)
 			tile->timeWhenDeletionScheduled = StelApp::getInstance().getTotalRunTime();
+		tile->dropParseRequests();
+	}
+}
+
+// Remove the pending parsing of this element and its childs from the queue.
+void MultiLevelJsonBase::dropParseRequests()
+{
+	if (parseRequest)
+		getParseQueue().drop(parseRequest);
+	foreach (MultiLevelJsonBase* tile, subTiles)
+	{
+		tile->dropParseRequests();
 	}
 }
 
@@ -255,33 +252,43 @@ void MultiLevelJsonBase::cancelDeletion()
 	}
 }
 
+void MultiLevelJsonBase::setLoadPriority(double priority)
+{
+	loadPriority = priority;
+	if (parseRequest)
+		getParseQueue().setPriority(parseRequest, priority);
+}
+
+// Return the priority used to parse the JSON file of this element
+double MultiLevelJsonBase::computeLoadPriority(const SphericalRegionP& viewPortPoly) const
+{
+	const MultiLevelJsonBase* parentElement = qobject_cast<MultiLevelJsonBase*>(parent());
+	if (parentElement==Q_NULLPTR)
+		return 0.;
+	const QVector<SphericalCap> caps = parentElement->getBoundingCaps();
+	if (caps.isEmpty())
+		return 0.;
+	const Vec3d viewCenter = viewPortPoly->getBoundingCap().n;
+	double priority = M_PI;
+	foreach (const SphericalCap& cap, caps)
+		priority = qMin(priority, viewCenter.angle(cap.n));
+	return priority;
+}
+
 // Load the tile information from a JSON file
 QVariantMap MultiLevelJsonBase::loadFromJSON(QIODevice& input, bool qZcompressed, bool gzCompressed)
 {
-	QVariantMap map;
-	if (qZcompressed && input.size()>0)
-	{
-		QByteArray ar = qUncompress(input.readAll());
-		input.close();
-		QBuffer buf(&ar);
-		buf.open(QIODevice::ReadOnly);
-		map = StelJsonParser::parse(&buf).toMap();
-		buf.close();
-	}
-	else if (gzCompressed)
-	{
-		QByteArray ar = StelUtils::uncompress(input.readAll());
-		input.close();
-		map = StelJsonParser::parse(ar).toMap();
-	}
-	else
-	{
-		map = StelJsonParser::parse(&input).toMap();
-	}
+	return StelJsonParseQueue::parse(input, qZcompressed, gzCompressed);
+}
 
-	if (map.isEmpty())
-		throw std::runtime_error("empty JSON file, cannot load");
-	return map;
+// Queue the content of the JSON file to be parsed
+void MultiLevelJsonBase::queueJsonContent(const QByteArray& content, bool qZcompressed, bool gzCompressed)
+{
+	Q_ASSERT(!parseRequest);
+	downloading = true;
+	parseRequest = getParseQueue().enqueue(content, qZcompressed, gzCompressed, loadPriority, this, "jsonLoadFinished");
+	if (isDeletionScheduled())
+		getParseQueue().drop(parseRequest);
 }
 
 
@@ -318,24 +325,25 @@ void MultiLevelJsonBase::downloadFinished()
 	httpReply->deleteLater();
 	httpReply=Q_NULLPTR;
 
-	Q_ASSERT(loadThread==Q_NULLPTR);
-	loadThread = new JsonLoadThread(this, content, qZcompressed, gzCompressed);
-	connect(loadThread, SIGNAL(finished()), this, SLOT(jsonLoadFinished()));
-	loadThread->start(QThread::LowestPriority);
+	queueJsonContent(content, qZcompressed, gzCompressed);
 }
 
 // Called when the element is fully loaded from the JSON file
 void MultiLevelJsonBase::jsonLoadFinished()
 {
-	loadThread->wait();
-	delete loadThread;
-	loadThread = Q_NULLPTR;
+	Q_ASSERT(parseRequest);
+	const StelJsonParseQueue::RequestP request = parseRequest;
+	parseRequest.clear();
 	downloading = false;
-	if (errorOccured)
+	if (request->hasError())
+	{
+		qWarning() << "WARNING : Can't parse loaded JSON description for " << contructorUrl << ": " << request->getErrorString();
+		errorOccured = true;
 		return;
+	}
 	try
 	{
-		loadFromQVariantMap(temporaryResultMap);
+		loadFromQVariantMap(request->getResult());
 	}
 	catch (std::runtime_error e)
 	{
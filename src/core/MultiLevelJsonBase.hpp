@@ -20,8 +20,11 @@
 #define _MULTILEVELJSONBASE_HPP_
 
 #include "StelSkyLayer.hpp"
+#include "StelJsonParseQueue.hpp"
+#include "StelSphereGeometry.hpp"
 
 #include <QList>
+#include <QPointer>
 #include <QString>
 #include <QVariantMap>
 #include <QNetworkReply>
@@ -30,13 +33,12 @@ class QIODevice;
 class StelCore;
 
 //! Abstract base class for managing multi-level tree objects stored in JSON format.
-//! The JSON files can be stored on disk or remotely and are loaded into threads.
+//! The JSON files can be stored on disk or remotely. Apart from the root file, they are parsed
+//! in the threads of a shared StelJsonParseQueue, the most urgent ones first.
 class MultiLevelJsonBase : public StelSkyLayer
 {
 	Q_OBJECT
 
-	friend class JsonLoadThread;
-
 public:
 	//! Default constructor.
 	MultiLevelJsonBase(MultiLevelJsonBase* parent=Q_NULLPTR);
@@ -67,8 +69,13 @@ public:
 
 	//! Schedule a deletion for all the childs.
 	//! It will practically occur after the delay passed as argument to deleteUnusedTiles() has expired.
+	//! The JSON files of the childs waiting to be parsed are removed from the parse queue.
 	void scheduleChildsDeletion();
 
+	//! Set the priority used to parse the JSON file of this element, the lower the sooner.
+	//! If its parsing was dropped from the queue, it is queued again.
+	void setLoadPriority(double priority);
+
 private slots:
 	//! Called when the download for the JSON file terminated.
 	void downloadFinished();
@@ -112,6 +119,17 @@ protected:
 	//! Load the element information from a JSON file
 	static QVariantMap loadFromJSON(QIODevice& input, bool qZcompressed=false, bool gzCompressed=false);
 
+	//! Queue the content of the JSON file to be parsed, loadFromQVariantMap() is called when it is done.
+	void queueJsonContent(const QByteArray& content, bool qZcompressed, bool gzCompressed);
+
+	//! Return the priority used to parse the JSON file of this element: the angle in radian between
+	//! the center of the view and the region of its parent, as the region of the element is not yet known.
+	//! The priority is 0 if there is no parent or if the region of the parent is not known.
+	double computeLoadPriority(const SphericalRegionP& viewPortPoly) const;
+
+	//! Get the bounding caps of the polygons of the region of this element, empty if it is not known.
+	virtual QVector<SphericalCap> getBoundingCaps() const {return QVector<SphericalCap>();}
+
 private:
 	//! Return the base URL prefixed to relative URL
 	QString getBaseUrl() const {return baseUrl;}
@@ -122,13 +140,15 @@ private:
 	// The delay after which a scheduled deletion will occur
 	float deletionDelay;
 
-	class JsonLoadThread* loadThread;
-
 	// Time at which deletion was first scheduled
 	double timeWhenDeletionScheduled;
 
-	// The temporary map filled in a thread
-	QVariantMap temporaryResultMap;
+	//! The request parsing the JSON file, null when no file is being parsed
+	StelJsonParseQueue::RequestP parseRequest;
+	double loadPriority;
+
+	//! Remove the pending parsing of this element and its childs from the queue.
+	void dropParseRequests();
 
 	bool loadingState;
 	int lastPercent;
@@ -137,6 +157,11 @@ private:
 	static class QNetworkAccessManager* networkAccessManager;
 
 	static QNetworkAccessManager& getNetworkAccessManager();
+
+	//! The queue shared by all the elements to parse JSON files
+	static QPointer<StelJsonParseQueue> parseQueue;
+
+	static StelJsonParseQueue& getParseQueue();
 };
 
 #endif // _MULTILEVELJSONBASE_HPP_
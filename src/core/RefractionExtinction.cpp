@@ -23,8 +23,22 @@
 #include "StelApp.hpp"
 #include "RefractionExtinction.hpp"
 
+const float Extinction::TABLE_MIN_SIN_ALT = -0.035f;
+
 Extinction::Extinction() : ext_coeff(50), undergroundExtinctionMode(UndergroundExtinctionMirror)
 {
+	updateTable();
+}
+
+void Extinction::updateTable()
+{
+	// Only the part above the horizon is tabulated: the airmass below -2 degrees
+	// is not continuous, and it is derived from the part above in all modes.
+	for (int i=0;i<=TABLE_SIZE;++i)
+	{
+		const float sinAlt = TABLE_MIN_SIN_ALT + i*(1.f-TABLE_MIN_SIN_ALT)/TABLE_SIZE;
+		magShiftTable[i] = airmass(qMax(sinAlt, TABLE_MIN_SIN_ALT), false) * ext_coeff;
+	}
 }
 
 // airmass computation for cosine of zenith angle z
@@ -83,15 +83,48 @@ public:
 		*mag -= airmass(altAzPos[2], false) * ext_coeff;
 	}
 
+	//! Get the magnitude shift added by forward() to a star at the geometric altitude
+	//! of sine @em sinAlt, interpolated in a table of altitude bins instead of evaluating
+	//! the airmass. The table is rebuilt when the extinction coefficient or the underground
+	//! mode change. The difference with forward() stays below 0.004 airmass.
+	float forwardFromTable(float sinAlt) const
+	{
+		if (sinAlt<TABLE_MIN_SIN_ALT)
+		{
+			switch (undergroundExtinctionMode)
+			{
+				case UndergroundExtinctionZero:
+					return 0.f;
+				case UndergroundExtinctionMax:
+					return 42.f*ext_coeff;
+				case UndergroundExtinctionMirror:
+					sinAlt = qMin(1.f, 2.f*TABLE_MIN_SIN_ALT - sinAlt);
+			}
+		}
+		const float f = qMax(0.f, (sinAlt-TABLE_MIN_SIN_ALT)*(TABLE_SIZE/(1.f-TABLE_MIN_SIN_ALT)));
+		const int i = (int)f;
+		if (i>=TABLE_SIZE)
+			return magShiftTable[TABLE_SIZE];
+		return magShiftTable[i] + (f-i)*(magShiftTable[i+1]-magShiftTable[i]);
+	}
+
 	//! Set visual extinction coefficient (mag/airmass), influences extinction computation.
 	//! @param k= 0.1 for highest mountains, 0.2 for very good lowland locations, 0.35 for typical lowland, 0.5 in humid climates.
-	void setExtinctionCoefficient(float k) { ext_coeff=k; }
+	void setExtinctionCoefficient(float k) { ext_coeff=k; updateTable(); }
 	float getExtinctionCoefficient() const {return ext_coeff;}
 
-	void setUndergroundExtinctionMode(UndergroundExtinctionMode mode) {undergroundExtinctionMode=mode;}
+	void setUndergroundExtinctionMode(UndergroundExtinctionMode mode) {undergroundExtinctionMode=mode; updateTable();}
 	UndergroundExtinctionMode getUndergroundExtinctionMode() const {return undergroundExtinctionMode;}
 	
 private:
+	//! Number of altitude bins of the table used by forwardFromTable().
+	static const int TABLE_SIZE = 2048;
+	//! The table goes from this sin(altitude) (about -2 degrees, see airmass()) to the zenith.
+	static const float TABLE_MIN_SIN_ALT;
+
+	//! Recompute the table used by forwardFromTable().
+	void updateTable();
+
 	//! airmass computation for @param cosZ = cosine of zenith angle z (=sin(altitude)!).
 	//! The default (@param apparent_z = true) is computing airmass from observed altitude, following Rozenberg (1966) [X(90)~40].
 	//! if (@param apparent_z = false), we have geometrical altitude and compute airmass from that,
@@ -106,6 +139,9 @@ private:
 
 	//! Define what we are going to do for underground stars when ground is not rendered
 	UndergroundExtinctionMode undergroundExtinctionMode;
+
+	//! Magnitude shift at the limits of the altitude bins.
+	float magShiftTable[TABLE_SIZE+1];
 };
 
 //! @class Refraction
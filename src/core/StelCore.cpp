@@ -1045,7 +1045,7 @@ void StelCore::returnToHome()
 	if (loc.isValid())
 		moveObserverTo(loc, 0.);
 
-	PlanetP p = GETSTELMODULE(SolarSystem)->searchByEnglishName(loc.planetName);
+	PlanetP p = GETSTELMODULE(SolarSystem)->materializeByEnglishName(loc.planetName);
 	QSettings* conf = StelApp::getInstance().getSettings();
 
 	LandscapeMgr* landscapeMgr = GETSTELMODULE(LandscapeMgr);
@@ -1872,10 +1872,12 @@ double StelCore::getDeltaT() const
 double StelCore::computeDeltaT(const double JD)
 {
 	double DeltaT = 0.;
+	// Only read the members here: the planets may call this method from several threads.
+	double nDot = deltaTnDot;
 	if (currentDeltaTAlgorithm==Custom)
 	{
 		// User defined coefficients for quadratic equation for DeltaT may change frequently.
-		deltaTnDot = deltaTCustomNDot; // n.dot = custom value "/cy/cy
+		nDot = deltaTCustomNDot; // n.dot = custom value "/cy/cy
 		int year, month, day;
 		StelUtils::getDateFromJulianDay(JD, &year, &month, &day);
 		double u = (StelUtils::getDecYear(year,month,day)-getDeltaTCustomYear())/100;
@@ -1889,7 +1891,7 @@ double StelCore::computeDeltaT(const double JD)
 	}
 
 	if (!deltaTdontUseMoon)
-		DeltaT += StelUtils::getMoonSecularAcceleration(JD, deltaTnDot, ((de430Active&&EphemWrapper::jd_fits_de430(JD)) || (de431Active&&EphemWrapper::jd_fits_de431(JD))));
+		DeltaT += StelUtils::getMoonSecularAcceleration(JD, nDot, ((de430Active&&EphemWrapper::jd_fits_de430(JD)) || (de431Active&&EphemWrapper::jd_fits_de431(JD))));
 
 	return DeltaT;
 }
@@ -2450,6 +2452,10 @@ void StelCore::initEphemeridesFunctions()
 		EphemWrapper::init_de431(de431FilePath.toStdString().c_str());
 	}
 	setDe431Active(de431Available && conf->value("astro/flag_use_de431", false).toBool());
+
+	//<-- VSOP87 and ELP82B -->
+	EphemWrapper::init_ephem_cache(conf->value("astro/flag_ephemeris_cache", true).toBool(),
+				       conf->value("astro/ephemeris_cache_accuracy", 1e-9).toDouble());
 }
 
 // Methods for finding constellation from J2000 position.
@@ -0,0 +1,215 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "StelJsonParseQueue.hpp"
+#include "StelJsonParser.hpp"
+#include "StelUtils.hpp"
+
+#include <QBuffer>
+#include <QMetaObject>
+#include <QRunnable>
+#include <QThreadPool>
+#include <stdexcept>
+
+/*************************************************************************
+  Task used to parse the data of a request in a thread of the pool
+ *************************************************************************/
+class JsonParseTask : public QRunnable
+{
+public:
+	JsonParseTask(StelJsonParseQueue* aqueue, const StelJsonParseQueue::RequestP& arequest) : queue(aqueue), request(arequest) {;}
+	virtual void run();
+private:
+	StelJsonParseQueue* queue;
+	StelJsonParseQueue::RequestP request;
+};
+
+void JsonParseTask::run()
+{
+	try
+	{
+		QBuffer buf(&request->data);
+		buf.open(QIODevice::ReadOnly);
+		request->result = StelJsonParseQueue::parse(buf, request->qZcompressed, request->gzCompressed);
+	}
+	catch (std::runtime_error& e)
+	{
+		request->errorString = e.what();
+		if (request->errorString.isEmpty())
+			request->errorString = "unknown error";
+	}
+	queue->finishedMutex.lock();
+	queue->finished.append(request);
+	queue->finishedMutex.unlock();
+	QMetaObject::invokeMethod(queue, "processFinished", Qt::QueuedConnection);
+}
+
+StelJsonParseQueue::StelJsonParseQueue(int maxThreads, int amaxQueued, QObject* parent)
+	: QObject(parent)
+	, threadPool(new QThreadPool(this))
+	, maxQueued(qMax(1, amaxQueued))
+	, running(0)
+	, nextSequence(0)
+{
+	threadPool->setMaxThreadCount(qMax(1, maxThreads));
+}
+
+StelJsonParseQueue::~StelJsonParseQueue()
+{
+	foreach (const RequestP& r, queued)
+		r->state = Request::Cancelled;
+	queued.clear();
+	// The tasks hold a pointer to this queue
+	threadPool->waitForDone();
+}
+
+StelJsonParseQueue::RequestP StelJsonParseQueue::enqueue(const QByteArray& data, bool qZcompressed, bool gzCompressed, double priority, QObject* receiver, const char* member)
+{
+	RequestP r(new Request());
+	r->data = data;
+	r->qZcompressed = qZcompressed;
+	r->gzCompressed = gzCompressed;
+	r->priority = priority;
+	r->receiver = receiver;
+	r->member = member;
+	insert(r);
+	startRequests();
+	return r;
+}
+
+void StelJsonParseQueue::setPriority(const RequestP& request, double priority)
+{
+	Q_ASSERT(request);
+	request->priority = priority;
+	if (request->state==Request::Dropped)
+	{
+		insert(request);
+		startRequests();
+	}
+}
+
+void StelJsonParseQueue::drop(const RequestP& request)
+{
+	Q_ASSERT(request);
+	if (request->state!=Request::Queued)
+		return;
+	queued.removeOne(request);
+	request->state = Request::Dropped;
+}
+
+void StelJsonParseQueue::cancel(const RequestP& request)
+{
+	Q_ASSERT(request);
+	if (request->state==Request::Queued)
+		queued.removeOne(request);
+	// A running request stays referenced by its task, its result is discarded in processFinished()
+	request->state = Request::Cancelled;
+	request->receiver = Q_NULLPTR;
+}
+
+void StelJsonParseQueue::insert(const RequestP& request)
+{
+	request->state = Request::Queued;
+	request->sequence = nextSequence++;
+	queued.append(request);
+	if (queued.size()<=maxQueued)
+		return;
+	// Drop the least urgent request, the most recent one for equal priorities
+	int worst = 0;
+	for (int i=1;i<queued.size();++i)
+	{
+		const Request& r = *queued.at(i);
+		const Request& w = *queued.at(worst);
+		if (r.priority>w.priority || (r.priority==w.priority && r.sequence>w.sequence))
+			worst = i;
+	}
+	queued.takeAt(worst)->state = Request::Dropped;
+}
+
+void StelJsonParseQueue::startRequests()
+{
+	while (running<threadPool->maxThreadCount() && !queued.isEmpty())
+	{
+		// The queue is small, a linear search is cheaper than keeping it sorted while priorities change
+		int best = 0;
+		for (int i=1;i<queued.size();++i)
+		{
+			const Request& r = *queued.at(i);
+			const Request& b = *queued.at(best);
+			if (r.priority<b.priority || (r.priority==b.priority && r.sequence<b.sequence))
+				best = i;
+		}
+		RequestP r = queued.takeAt(best);
+		r->state = Request::Running;
+		++running;
+		threadPool->start(new JsonParseTask(this, r));
+	}
+}
+
+void StelJsonParseQueue::processFinished()
+{
+	finishedMutex.lock();
+	QList<RequestP> done = finished;
+	finished.clear();
+	finishedMutex.unlock();
+
+	running -= done.size();
+	Q_ASSERT(running>=0);
+	// Start the next requests before notifying, the receivers may take some time to use the results
+	startRequests();
+
+	foreach (const RequestP& r, done)
+	{
+		if (r->state==Request::Cancelled)
+			continue;
+		r->state = Request::Finished;
+		r->data.clear();
+		if (r->receiver)
+			QMetaObject::invokeMethod(r->receiver, r->member.constData(), Qt::DirectConnection);
+	}
+}
+
+// Parse a JSON file, possibly compressed
+QVariantMap StelJsonParseQueue::parse(QIODevice& input, bool qZcompressed, bool gzCompressed)
+{
+	QVariantMap map;
+	if (qZcompressed && input.size()>0)
+	{
+		QByteArray ar = qUncompress(input.readAll());
+		input.close();
+		QBuffer buf(&ar);
+		buf.open(QIODevice::ReadOnly);
+		map = StelJsonParser::parse(&buf).toMap();
+		buf.close();
+	}
+	else if (gzCompressed)
+	{
+		QByteArray ar = StelUtils::uncompress(input.readAll());
+		input.close();
+		map = StelJsonParser::parse(ar).toMap();
+	}
+	else
+	{
+		map = StelJsonParser::parse(&input).toMap();
+	}
+
+	if (map.isEmpty())
+		throw std::runtime_error("empty JSON file, cannot load");
+	return map;
+}
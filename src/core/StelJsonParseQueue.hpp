@@ -0,0 +1,137 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _STELJSONPARSEQUEUE_HPP_
+#define _STELJSONPARSEQUEUE_HPP_
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QVariantMap>
+
+class QIODevice;
+class QThreadPool;
+
+//! @class StelJsonParseQueue
+//! Parses JSON descriptions in a small shared pool of threads.
+//! The requests wait in a bounded queue, and the one with the lowest priority value is parsed first.
+//! A queued request can be dropped, e.g. when its tile went out of the view: it keeps its data, and
+//! is queued again by setPriority(). When the queue is full, the request with the highest priority
+//! value is dropped. When a request is parsed, the slot given to enqueue() is called in the main thread.
+class StelJsonParseQueue : public QObject
+{
+	Q_OBJECT
+
+public:
+	//! @class Request
+	//! The data to parse and the result of a request.
+	class Request
+	{
+	public:
+		enum State
+		{
+			Queued,		//!< Waiting to be parsed
+			Running,	//!< Being parsed in a thread
+			Dropped,	//!< Removed from the queue, can be queued again
+			Finished,	//!< Parsed, the result is available
+			Cancelled	//!< Removed for good
+		};
+
+		State getState() const {return state;}
+		double getPriority() const {return priority;}
+		//! Return the parsed map, after the receiver was notified.
+		const QVariantMap& getResult() const {return result;}
+		//! Return true if the data could not be parsed.
+		bool hasError() const {return !errorString.isEmpty();}
+		QString getErrorString() const {return errorString;}
+
+	private:
+		friend class StelJsonParseQueue;
+		friend class JsonParseTask;
+
+		Request() : qZcompressed(false), gzCompressed(false), priority(0.), sequence(0), state(Queued) {;}
+
+		QByteArray data;
+		bool qZcompressed;
+		bool gzCompressed;
+		double priority;
+		//! Order of insertion, used for requests of equal priority.
+		quint64 sequence;
+		State state;
+		QPointer<QObject> receiver;
+		QByteArray member;
+		QVariantMap result;
+		QString errorString;
+	};
+	typedef QSharedPointer<Request> RequestP;
+
+	//! @param maxThreads the number of threads parsing the requests.
+	//! @param maxQueued the maximum number of requests waiting in the queue.
+	StelJsonParseQueue(int maxThreads, int maxQueued, QObject* parent=Q_NULLPTR);
+	~StelJsonParseQueue();
+
+	//! Queue the data of a JSON file to be parsed.
+	//! @param priority the lower the value, the sooner the data is parsed.
+	//! @param receiver the object notified when the data is parsed.
+	//! @param member the name of a slot of receiver without arguments, called in the main thread.
+	//! @return the request, which is dropped at once if the queue is full of more urgent requests.
+	RequestP enqueue(const QByteArray& data, bool qZcompressed, bool gzCompressed, double priority, QObject* receiver, const char* member);
+	//! Change the priority of a queued request, or queue a dropped request again.
+	void setPriority(const RequestP& request, double priority);
+	//! Remove a queued request from the queue, keeping its data.
+	void drop(const RequestP& request);
+	//! Remove a request for good. If it is being parsed, its result is discarded.
+	void cancel(const RequestP& request);
+
+	//! Return the number of requests waiting in the queue.
+	int getQueuedCount() const {return queued.size();}
+	//! Return the number of requests being parsed.
+	int getRunningCount() const {return running;}
+
+	//! Parse a JSON file, possibly compressed with qCompress() or gzip.
+	//! Throws a std::runtime_error if the file is empty or invalid.
+	static QVariantMap parse(QIODevice& input, bool qZcompressed=false, bool gzCompressed=false);
+
+private slots:
+	//! Notify the receivers of the parsed requests and start the next ones.
+	void processFinished();
+
+private:
+	friend class JsonParseTask;
+
+	//! Start parsing the most urgent requests while threads are available.
+	void startRequests();
+	//! Insert a request in the queue, dropping the least urgent one if the queue is full.
+	void insert(const RequestP& request);
+
+	QThreadPool* threadPool;
+	int maxQueued;
+	int running;
+	quint64 nextSequence;
+	QList<RequestP> queued;
+
+	//! Requests parsed by the threads, not yet processed in the main thread.
+	QList<RequestP> finished;
+	QMutex finishedMutex;
+};
+
+#endif // _STELJSONPARSEQUEUE_HPP_
@@ -34,6 +34,11 @@
 #include <QDebug>
 #include <QStringList>
 
+// Number of candidates asked to each module when picking an object. The modules rank them
+// like cleverFind(), only the difference between the angular and the projected distance or
+// the extinction may change the order, so a few more than one are plenty.
+static const int maxNbSelectionCandidates = 8;
+
 StelObjectMgr::StelObjectMgr() : objectPointerVisibility(true), searchRadiusPixel(25.f), distanceWeight(1.f)
 {
 	setObjectName("StelObjectMgr");
@@ -167,6 +172,20 @@ StelObjectP StelObjectMgr::searchByName(const QString &name) const
 	return rval;
 }
 
+StelObjectP StelObjectMgr::materializeByName(const QString &name)
+{
+	StelObjectP rval = searchByName(name);
+	if (rval)
+		return rval;
+	foreach (StelObjectModule* m, objectsModule)
+	{
+		rval = m->materializeByName(name);
+		if (rval)
+			return rval;
+	}
+	return rval;
+}
+
 StelObjectP StelObjectMgr::searchByID(const QString &type, const QString &id) const
 {
 	QMap<QString, StelObjectModule*>::const_iterator it = typeToModuleMap.constFind(type);
@@ -185,6 +204,8 @@ bool StelObjectMgr::findAndSelectI18n(const QString &nameI18n, StelModule::StelM
 {
 	// Then look for another object
 	StelObjectP obj = searchByNameI18n(nameI18n);
+	if (!obj)
+		obj = materializeByName(nameI18n);
 	if (!obj)
 		return false;
 	else
@@ -195,7 +216,7 @@ bool StelObjectMgr::findAndSelectI18n(const QString &nameI18n, StelModule::StelM
 bool StelObjectMgr::findAndSelect(const QString &name, StelModule::StelModuleSelectAction action)
 {
 	// Then look for another object
-	StelObjectP obj = searchByName(name);
+	StelObjectP obj = materializeByName(name);
 	if (!obj)
 		return false;
 	else
@@ -228,9 +249,11 @@ StelObjectP StelObjectMgr::cleverFind(const StelCore* core, const Vec3d& v) cons
 	// Field of view for a searchRadiusPixel pixel diameter circle on screen
 	float fov_around = core->getMovementMgr()->getCurrentFov()/qMin(prj->getViewportWidth(), prj->getViewportHeight()) * searchRadiusPixel;
 
-	// Collect the objects inside the range
+	// Collect the best candidates of each module inside the range. The modules rank them
+	// with the function minimized below, the distance being measured in degree.
+	const double degreeWeight = distanceWeight*searchRadiusPixel/fov_around;
 	foreach (const StelObjectModule* m, objectsModule)
-		candidates += m->searchAround(v, fov_around, core);
+		candidates += m->searchSelectionCandidates(v, fov_around, degreeWeight, maxNbSelectionCandidates, core);
 
 	// GZ 2014-08-17: This should be exactly the sky's limit magnitude (or even more, but not less!), else visible stars cannot be clicked.
 	float limitMag = core->getSkyDrawer()->getLimitMagnitude(); // -2.f;
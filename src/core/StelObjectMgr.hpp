@@ -125,6 +125,10 @@ public:
 	//! Find any kind of object by its standard program name.
 	StelObjectP searchByName(const QString &name) const;
 
+	//! Find any kind of object by its standard program name, creating it if a module
+	//! keeps it in a compact catalog (see StelObjectModule::materializeByName()).
+	StelObjectP materializeByName(const QString &name);
+
 	//! Find an object of the given type and ID
 	//! @param type the type of the object as given by StelObject::getType()
 	//! @param id the ID of the object as given by StelObject::getID()
@@ -29,6 +29,13 @@ StelObjectModule::~StelObjectModule()
 {
 }
 
+QList<StelObjectP> StelObjectModule::searchSelectionCandidates(const Vec3d& v, double limitFov, double degreeWeight, int maxNbItem, const StelCore* core) const
+{
+	Q_UNUSED(degreeWeight);
+	Q_UNUSED(maxNbItem);
+	return searchAround(v, limitFov, core);
+}
+
 bool StelObjectModule::matchObjectName(const QString& objName, const QString& objPrefix, bool useStartOfWords) const
 {
 	if (useStartOfWords)
@@ -48,6 +48,18 @@ public:
 	//! @param core the core instance to use.
 	//! @return the list of all the displayed objects contained in the defined zone.
 	virtual QList<StelObjectP> searchAround(const Vec3d& v, double limitFov, const StelCore* core) const = 0;
+
+	//! Search for the best candidates of a selection around a point, i.e. the objects minimizing
+	//! degreeWeight*distance + StelObject::getSelectPriority(), with the distance to v in degree.
+	//! StelObjectMgr uses it when the user clicks on the sky. Modules which may find many objects
+	//! in the zone should only create the StelObjects of the best maxNbItem candidates.
+	//! The default implementation returns all the objects found by searchAround().
+	//! @param v equatorial position at epoch J2000.
+	//! @param limitFov angular diameter of the searching zone in degree.
+	//! @param degreeWeight weight of one degree of distance, in magnitudes.
+	//! @param maxNbItem the number of candidates which need to be returned.
+	//! @param core the core instance to use.
+	virtual QList<StelObjectP> searchSelectionCandidates(const Vec3d& v, double limitFov, double degreeWeight, int maxNbItem, const StelCore* core) const;
 	
 	//! Find a StelObject by name.
 	//! @param nameI18n The translated name for the current sky locale.
@@ -62,6 +74,12 @@ public:
 	//! @param name the english object name
 	virtual StelObjectP searchByID(const QString& id) const = 0;
 
+	//! Create the StelObject with the given english name, for a module which keeps its objects
+	//! in a compact catalog and creates them only when needed. The searches above only return
+	//! existing objects, StelObjectMgr calls this function when it selects an object by name.
+	//! @return the new object, or the empty StelObject if there is none with this name.
+	virtual StelObjectP materializeByName(const QString& name) {Q_UNUSED(name); return StelObjectP();}
+
 	//! Find and return the list of at most maxNbItem objects auto-completing passed object name
 	//! @param objPrefix the first letters of the searched object
 	//! @param maxNbItem the maximum number of returned object names
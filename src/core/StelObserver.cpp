@@ -175,7 +175,7 @@ void ArtificialPlanet::computeAverage(double f1)
 StelObserver::StelObserver(const StelLocation &loc) : currentLocation(loc)
 {
 	SolarSystem* ssystem = GETSTELMODULE(SolarSystem);
-	planet = ssystem->searchByEnglishName(loc.planetName);
+	planet = ssystem->materializeByEnglishName(loc.planetName);
 	if (planet==Q_NULLPTR)
 	{
 		qWarning() << "Can't create StelObserver on planet " + loc.planetName + " because it is unknown. Use Earth as default.";
@@ -282,10 +282,10 @@ SpaceShipObserver::SpaceShipObserver(const StelLocation& startLoc, const StelLoc
 		timeToGo = transitSeconds;
 
 	SolarSystem* ssystem = GETSTELMODULE(SolarSystem);
-	PlanetP targetPlanet = ssystem->searchByEnglishName(moveTargetLocation.planetName);
+	PlanetP targetPlanet = ssystem->materializeByEnglishName(moveTargetLocation.planetName);
 	if (moveStartLocation.planetName!=moveTargetLocation.planetName)
 	{
-		PlanetP startPlanet = ssystem->searchByEnglishName(moveStartLocation.planetName);
+		PlanetP startPlanet = ssystem->materializeByEnglishName(moveStartLocation.planetName);
 		if (startPlanet.isNull() || targetPlanet.isNull())
 		{
 			qWarning() << "Can't move from planet " + moveStartLocation.planetName + " to planet " + moveTargetLocation.planetName + " because it is unknown";
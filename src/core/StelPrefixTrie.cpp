@@ -0,0 +1,141 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "StelPrefixTrie.hpp"
+
+#include <algorithm>
+
+StelPrefixTrie::StelPrefixTrie()
+{
+	clear();
+}
+
+void StelPrefixTrie::clear()
+{
+	nodes.clear();
+	entries.clear();
+	Node root = {0, -1, -1, -1};
+	nodes.append(root);
+}
+
+void StelPrefixTrie::insert(const QString& key, const QString& value)
+{
+	const QString ukey = key.toUpper();
+	int node = 0;
+	for (int i=0;i<ukey.size();++i)
+	{
+		const ushort c = ukey.at(i).unicode();
+		// Find the child for c, or the place where to insert it to keep the children sorted.
+		int previous = -1;
+		int child = nodes[node].firstChild;
+		while (child>=0 && nodes[child].ch<c)
+		{
+			previous = child;
+			child = nodes[child].nextSibling;
+		}
+		if (child<0 || nodes[child].ch!=c)
+		{
+			Node n = {c, -1, child, -1};
+			nodes.append(n);
+			const int created = nodes.size()-1;
+			if (previous<0)
+				nodes[node].firstChild = created;
+			else
+				nodes[previous].nextSibling = created;
+			child = created;
+		}
+		node = child;
+	}
+
+	// Keep the values of a key in insertion order
+	Entry e;
+	if (value!=ukey && !value.isEmpty())
+		e.value = value;
+	e.next = -1;
+	entries.append(e);
+	const int created = entries.size()-1;
+	if (nodes[node].firstEntry<0)
+		nodes[node].firstEntry = created;
+	else
+	{
+		int last = nodes[node].firstEntry;
+		while (entries[last].next>=0)
+			last = entries[last].next;
+		entries[last].next = created;
+	}
+}
+
+int StelPrefixTrie::find(const QString& prefix, int maxNbItem, QStringList& result) const
+{
+	if (maxNbItem<=0)
+		return 0;
+
+	QString key = prefix.toUpper();
+	int node = 0;
+	for (int i=0;i<key.size() && node>=0;++i)
+	{
+		const ushort c = key.at(i).unicode();
+		int child = nodes[node].firstChild;
+		while (child>=0 && nodes[child].ch<c)
+			child = nodes[child].nextSibling;
+		node = (child>=0 && nodes[child].ch==c) ? child : -1;
+	}
+	if (node<0)
+		return 0;
+
+	const int initialSize = result.size();
+	QSet<QString> seen = QSet<QString>::fromList(result);
+	collect(node, key, initialSize+maxNbItem, result, seen);
+	return result.size()-initialSize;
+}
+
+void StelPrefixTrie::collect(int node, QString& key, int maxSize, QStringList& result, QSet<QString>& seen) const
+{
+	for (int e=nodes[node].firstEntry;e>=0 && result.size()<maxSize;e=entries[e].next)
+	{
+		const QString& value = entries[e].value.isNull() ? key : entries[e].value;
+		if (seen.contains(value))
+			continue;
+		seen.insert(value);
+		result.append(value);
+	}
+
+	for (int child=nodes[node].firstChild;child>=0 && result.size()<maxSize;child=nodes[child].nextSibling)
+	{
+		key.append(QChar(nodes[child].ch));
+		collect(child, key, maxSize, result, seen);
+		key.chop(1);
+	}
+}
+
+bool StelPrefixTrie::lessThan(const QString& a, const QString& b)
+{
+	// The keys are ordered by their uppercase characters.
+	const QString ua = a.toUpper();
+	const QString ub = b.toUpper();
+	return ua!=ub ? ua<ub : a<b;
+}
+
+void StelPrefixTrie::sortCompletions(QStringList& result, int maxNbItem)
+{
+	result.removeDuplicates();
+	std::sort(result.begin(), result.end(), lessThan);
+	if (result.size() > maxNbItem)
+		result.erase(result.begin() + maxNbItem, result.end());
+}
@@ -0,0 +1,85 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _STELPREFIXTRIE_HPP_
+#define _STELPREFIXTRIE_HPP_
+
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+//! @class StelPrefixTrie
+//! Case insensitive prefix tree of strings, used for the auto-completion of object names and designations.
+//! Each key is stored with a display value, e.g. the key "NGC 31" with the value "NGC 31", or the key
+//! "CED 214" with the value "Ced 214". The values matching a prefix are found in the order of their keys,
+//! by walking only the subtree of the prefix, so the cost of a query does not depend on the number of keys.
+//! The nodes are stored in one vector, with the children of a node linked in the order of their character.
+class StelPrefixTrie
+{
+public:
+	StelPrefixTrie();
+
+	//! Add a value for a key. A key can have several values.
+	//! @param key the key, compared without case
+	//! @param value the value returned by find(), the uppercase key if empty
+	void insert(const QString& key, const QString& value=QString());
+	//! Remove all keys.
+	void clear();
+	//! Get the number of stored values.
+	int size() const {return entries.size();}
+	bool isEmpty() const {return entries.isEmpty();}
+
+	//! Append to result the values of the keys starting with prefix (case insensitive), in the order of the keys.
+	//! The values already in result, e.g. found by the aliases of a designation or in another trie, are skipped.
+	//! @param maxNbItem the maximum number of distinct values to append
+	//! @return the number of appended values
+	int find(const QString& prefix, int maxNbItem, QStringList& result) const;
+
+	//! Compare two values in the order of their keys: case insensitive, then case sensitive for a total order.
+	static bool lessThan(const QString& a, const QString& b);
+	//! Sort the values found by find() in one or several tries with lessThan(), remove the
+	//! duplicates, and keep the first maxNbItem values.
+	static void sortCompletions(QStringList& result, int maxNbItem);
+
+private:
+	struct Node
+	{
+		ushort ch;
+		int firstChild;
+		int nextSibling;
+		int firstEntry;
+	};
+	struct Entry
+	{
+		//! Display value, null if it is the key
+		QString value;
+		int next;
+	};
+
+	//! Append the values of the subtree of node, whose key is key, which are not in seen yet,
+	//! until result has maxSize items.
+	void collect(int node, QString& key, int maxSize, QStringList& result, QSet<QString>& seen) const;
+
+	//! The root is nodes[0]
+	QVector<Node> nodes;
+	QVector<Entry> entries;
+};
+
+#endif // _STELPREFIXTRIE_HPP_
@@ -419,26 +419,54 @@ void StelSkyDrawer::postDrawPointSource(StelPainter* sPainter)
 	nbPointSources = 0;
 }
 
+//! Random number of the twinkling of the sources drawn from the main thread.
+struct QrandTwinkle
+{
+	float operator()() const {return (float)qrand()/RAND_MAX;}
+};
+
+//! Random number of the twinkling given by the caller of computePointSource().
+struct FixedTwinkle
+{
+	float value;
+	float operator()() const {return value;}
+};
+
 // Draw a point source halo.
 bool StelSkyDrawer::drawPointSource(StelPainter* sPainter, const Vec3f& v, const RCMag& rcMag, const Vec3f& color, bool checkInScreen, float twinkleFactor)
 {
 	Q_ASSERT(sPainter);
 
-	if (rcMag.radius<=0.f)
+	const bool twinkle = flagStarTwinkle && (flagHasAtmosphere || flagForcedTwinkle);
+	QrandTwinkle random;
+	ProjectedPointSource source;
+	if (!projectPointSource(*sPainter->getProjector(), v, rcMag, color, checkInScreen, twinkle, twinkleAmount, twinkleFactor, random, source))
 		return false;
+	addPointSource(sPainter, source);
+	return true;
+}
 
-	Vec3f win;
-	if (!(checkInScreen ? sPainter->getProjector()->projectCheck(v, win) : sPainter->getProjector()->project(v, win)))
-		return false;
+bool StelSkyDrawer::computePointSource(const StelProjectorP& prj, const Vec3f& v, const RCMag& rcMag, const Vec3f& color,
+				       bool checkInScreen, float twinkleFactor, float twinkleRandom, ProjectedPointSource& source) const
+{
+	const bool twinkle = flagStarTwinkle && (flagHasAtmosphere || flagForcedTwinkle);
+	FixedTwinkle random = {twinkleRandom};
+	return projectPointSource(*prj, v, rcMag, color, checkInScreen, twinkle, twinkleAmount, twinkleFactor, random, source);
+}
 
-	const float radius = rcMag.radius;
-	// Random coef for star twinkling. twinkleFactor can introduce height-dependent twinkling.
-	const float tw = (flagStarTwinkle && (flagHasAtmosphere || flagForcedTwinkle)) ? (1.f-twinkleFactor*twinkleAmount*qrand()/RAND_MAX)*rcMag.luminance : rcMag.luminance;
+void StelSkyDrawer::addPointSource(StelPainter* sPainter, const ProjectedPointSource& source)
+{
+	Q_ASSERT(sPainter);
+
+	const Vec3f& win = source.win;
+	const Vec3f& color = source.color;
+	const float radius = source.radius;
+	const float tw = source.twinkle*source.luminance;
 
 	// If the rmag is big, draw a big halo
 	if (radius>MAX_LINEAR_RADIUS+5.f)
 	{
-		float cmag = qMin(rcMag.luminance,(float)(radius-(MAX_LINEAR_RADIUS+5.f))/30.f);
+		float cmag = qMin(source.luminance,(float)(radius-(MAX_LINEAR_RADIUS+5.f))/30.f);
 		float rmag = 150.f;
 		if (cmag>1.f)
 			cmag = 1.f;
@@ -469,7 +497,6 @@ bool StelSkyDrawer::drawPointSource(StelPainter* sPainter, const Vec3f& v, const
 		// Flush the buffer (draw all buffered stars)
 		postDrawPointSource(sPainter);
 	}
-	return true;
 }
 
 // Draw's the Sun's corona during a solar eclipse on Earth.
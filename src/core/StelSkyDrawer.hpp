@@ -105,6 +105,53 @@ public:
 
 	bool drawPointSource(StelPainter* sPainter, const Vec3f& v, const RCMag &rcMag, const Vec3f& bcolor, bool checkInScreen=false, float twinkleFactor=1.0f);
 
+	//! A point source projected on the screen by computePointSource(), not yet stored in the vertex arrays.
+	struct ProjectedPointSource
+	{
+		Vec3f win;		//!< Screen position
+		float radius;		//!< Halo radius in pixels
+		float luminance;	//!< Luminance as computed by computeRCMag()
+		float twinkle;		//!< Twinkling coefficient applied to the luminance of the halo
+		Vec3f color;		//!< RGB color of the source
+	};
+
+	//! Project a point source and compute its twinkled luminance, without touching the OpenGL state
+	//! nor the vertex arrays. Contrary to drawPointSource() this can be called from worker threads.
+	//! @param prj the projector to use
+	//! @param twinkleRandom a random number in [0..1] which defines the twinkling of the source
+	//! @return true if the source is visible
+	bool computePointSource(const StelProjectorP& prj, const Vec3f& v, const RCMag &rcMag, const Vec3f& bcolor,
+				bool checkInScreen, float twinkleFactor, float twinkleRandom, ProjectedPointSource& source) const;
+
+	//! Project a point source and compute its twinkling, without touching the OpenGL state nor the vertex arrays.
+	//! This is the common part of drawPointSource() and computePointSource(). The twinkling random number is
+	//! only drawn for visible sources, so that culled sources don't change the sequence of random numbers.
+	//! @tparam Projector a StelProjector, or any class with the same project() and projectCheck() methods
+	//! @param twinkle whether the source twinkles, i.e. flagStarTwinkle and either flagHasAtmosphere or flagForcedTwinkle
+	//! @param random a functor returning the random number in [0..1] which defines the twinkling of the source
+	//! @return true if the source is visible
+	template<class Projector, class Random>
+	static bool projectPointSource(const Projector& prj, const Vec3f& v, const RCMag &rcMag, const Vec3f& color, bool checkInScreen,
+				       bool twinkle, double twinkleAmount, float twinkleFactor, Random& random, ProjectedPointSource& source)
+	{
+		if (rcMag.radius<=0.f)
+			return false;
+
+		if (!(checkInScreen ? prj.projectCheck(v, source.win) : prj.project(v, source.win)))
+			return false;
+
+		source.radius = rcMag.radius;
+		source.luminance = rcMag.luminance;
+		// Random coef for star twinkling. twinkleFactor can introduce height-dependent twinkling.
+		source.twinkle = twinkle ? 1.f-twinkleFactor*twinkleAmount*random() : 1.f;
+		source.color = color;
+		return true;
+	}
+
+	//! Store a point source computed by computePointSource() in the vertex arrays.
+	//! Must be called from the main thread, between preDrawPointSource() and postDrawPointSource().
+	void addPointSource(StelPainter* sPainter, const ProjectedPointSource& source);
+
 	void drawSunCorona(StelPainter* painter, const Vec3f& v, float radius, const Vec3f& color, const float alpha);
 
 	//! Terminate drawing of a 3D model, draw the halo
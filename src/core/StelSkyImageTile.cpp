@@ -131,6 +131,8 @@ void StelSkyImageTile::getTilesToDraw(QMultiMap<double, StelSkyImageTile*>& resu
 	if (downloading)
 	{
 		//qDebug() << "Downloading " << contructorUrl;
+		// The tiles closest to the center of the view are parsed first
+		setLoadPriority(computeLoadPriority(viewPortPoly));
 		return;
 	}
 
@@ -240,6 +242,16 @@ void StelSkyImageTile::getTilesToDraw(QMultiMap<double, StelSkyImageTile*>& resu
 	}
 }
 
+// Get the bounding caps of the polygons of the tile
+QVector<SphericalCap> StelSkyImageTile::getBoundingCaps() const
+{
+	QVector<SphericalCap> caps;
+	caps.reserve(skyConvexPolygons.size());
+	foreach (const SphericalRegionP& poly, skyConvexPolygons)
+		caps.append(poly->getBoundingCap());
+	return caps;
+}
+
 // Draw the image on the screen.
 // Assume GL_TEXTURE_2D is enabled
 bool StelSkyImageTile::drawTile(StelCore* core, StelPainter& sPainter)
@@ -106,6 +106,9 @@ protected:
 	//! Load the tile from a valid QVariantMap.
 	virtual void loadFromQVariantMap(const QVariantMap& map);
 
+	//! Get the bounding caps of skyConvexPolygons
+	virtual QVector<SphericalCap> getBoundingCaps() const;
+
 	//! The credits of the server where this data come from
 	ServerCredits serverCredits;
 
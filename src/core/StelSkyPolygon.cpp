@@ -72,6 +72,15 @@ void StelSkyPolygon::draw(StelCore* core, StelPainter& sPainter, float)
 	deleteUnusedSubTiles();
 }
 
+QVector<SphericalCap> StelSkyPolygon::getBoundingCaps() const
+{
+	QVector<SphericalCap> caps;
+	caps.reserve(skyConvexPolygons.size());
+	foreach (const SphericalConvexPolygon& poly, skyConvexPolygons)
+		caps.append(poly.getBoundingCap());
+	return caps;
+}
+
 // Return the list of tiles which should be drawn.
 void StelSkyPolygon::getTilesToDraw(QMultiMap<double, StelSkyPolygon*>& result, StelCore* core, const SphericalRegionP& viewPortPoly, bool recheckIntersect)
 {
@@ -81,7 +90,11 @@ void StelSkyPolygon::getTilesToDraw(QMultiMap<double, StelSkyPolygon*>& result,
 
 	// The JSON file is currently being downloaded
 	if (downloading)
+	{
+		// The tiles closest to the center of the view are parsed first
+		setLoadPriority(computeLoadPriority(viewPortPoly));
 		return;
+	}
 
 	// Check that we are in the screen
 	bool fullInScreen = true;
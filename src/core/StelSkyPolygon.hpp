@@ -74,6 +74,9 @@ protected:
 	//! Load the polygon from a valid QVariantMap
 	virtual void loadFromQVariantMap(const QVariantMap& map);
 
+	//! Get the bounding caps of skyConvexPolygons
+	virtual QVector<SphericalCap> getBoundingCaps() const;
+
 private:
 	//! The list of all the subTiles URL or already loaded JSON map for this tile
 	QVariantList subTilesUrls;
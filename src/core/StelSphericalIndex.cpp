@@ -32,8 +32,209 @@ StelSphericalIndex::~StelSphericalIndex()
 
 void StelSphericalIndex::insert(StelRegionObjectP regObj)
 {
+	clearFlatLayout();
 	NodeElem el(regObj);
 	rootNode->insert(el, 0);
 }
 
+void StelSphericalIndex::compact()
+{
+	clearFlatLayout();
+	FlatNode root = {0, 0, 0, 0, 0};
+	flatNodes.append(root);
+	flatTriangles.append(SphericalConvexPolygon());
+	compactNode(*rootNode, 0);
+	flatNodes.squeeze();
+	flatTriangles.squeeze();
+	pointX.squeeze();
+	pointY.squeeze();
+	pointZ.squeeze();
+	flatObjects.squeeze();
+}
+
+void StelSphericalIndex::compactNode(const Node& node, int n)
+{
+	flatNodes[n].firstElement = flatObjects.size();
+	flatNodes[n].nbElements = node.elements.size();
+	foreach (const NodeElem& el, node.elements)
+	{
+		const Vec3d p = el.obj->getPointInRegion();
+		pointX.append(p[0]);
+		pointY.append(p[1]);
+		pointZ.append(p[2]);
+		flatObjects.append(el.obj);
+	}
+
+	// The children are stored next to each other, before their own children.
+	const int firstChild = flatNodes.size();
+	flatNodes[n].firstChild = firstChild;
+	flatNodes[n].nbChildren = node.children.size();
+	foreach (const Node& child, node.children)
+	{
+		FlatNode flatChild = {0, 0, 0, 0, 0};
+		flatNodes.append(flatChild);
+		flatTriangles.append(child.triangle);
+	}
+	for (int c=0;c<node.children.size();++c)
+		compactNode(node.children.at(c), firstChild+c);
+	flatNodes[n].endElement = flatObjects.size();
+}
+
+bool StelSphericalIndex::setFlatLayout(const QVector<FlatNode>& nodes, const QVector<SphericalConvexPolygon>& triangles,
+				       const QVector<double>& x, const QVector<double>& y, const QVector<double>& z)
+{
+	rootNode->clear();
+	clearFlatLayout();
+	const int nbElements = x.size();
+	if (nodes.isEmpty() || triangles.size()!=nodes.size() || y.size()!=nbElements || z.size()!=nbElements)
+		return false;
+	// The queries go through the children and elements without checking their indices.
+	for (int n=0;n<nodes.size();++n)
+	{
+		const FlatNode& node = nodes.at(n);
+		if (node.nbChildren<0 || (node.nbChildren>0 && (node.firstChild<=n || node.firstChild+node.nbChildren>nodes.size()))
+		    || node.firstElement<0 || node.nbElements<0 || node.firstElement+node.nbElements>node.endElement
+		    || node.endElement>nbElements || (n>0 && triangles.at(n).getConvexContour().size()!=3))
+			return false;
+	}
+	flatNodes = nodes;
+	flatTriangles = triangles;
+	pointX = x;
+	pointY = y;
+	pointZ = z;
+	return true;
+}
+
+void StelSphericalIndex::clearFlatLayout()
+{
+	flatNodes.clear();
+	flatTriangles.clear();
+	pointX.clear();
+	pointY.clear();
+	pointZ.clear();
+	flatObjects.clear();
+}
+
+StelSphericalIndex::PointFilter::PointFilter(const SphericalRegion* aregion) : region(aregion), generic(false), nbHalfSpaces(0)
+{
+	switch (region->getType())
+	{
+		case SphericalRegion::AllSky:
+			break;
+		case SphericalRegion::Cap:
+		{
+			const SphericalCap cap = region->getBoundingCap();
+			nx[0] = cap.n[0]; ny[0] = cap.n[1]; nz[0] = cap.n[2]; d[0] = cap.d;
+			nbHalfSpaces = 1;
+			break;
+		}
+		case SphericalRegion::ConvexPolygon:
+		{
+			const QVector<Vec3d>& contour = static_cast<const SphericalConvexPolygon*>(region)->getConvexContour();
+			if (contour.size()+1>MaxHalfSpaces)
+			{
+				generic = true;
+				break;
+			}
+			// The bounding cap, then the sides as in sideHalfSpaceContains()
+			const SphericalCap cap = region->getBoundingCap();
+			nx[0] = cap.n[0]; ny[0] = cap.n[1]; nz[0] = cap.n[2]; d[0] = cap.d;
+			nbHalfSpaces = 1;
+			for (int i=0;i<contour.size();++i)
+			{
+				const Vec3d& v1 = contour.at((i+1)%contour.size());
+				const Vec3d& v2 = contour.at(i);
+				nx[nbHalfSpaces] = v1[1]*v2[2] - v1[2]*v2[1];
+				ny[nbHalfSpaces] = v1[2]*v2[0] - v1[0]*v2[2];
+				nz[nbHalfSpaces] = v1[0]*v2[1] - v1[1]*v2[0];
+				d[nbHalfSpaces] = -1e-17;
+				++nbHalfSpaces;
+			}
+			break;
+		}
+		default:
+			generic = true;
+	}
+}
 
+
+
+//! Insert the object in the k nearest objects sorted by decreasing cosAngle.
+//! minCosAngle is raised to the k-th nearest object once k objects are kept.
+static void insertNeighbour(QVector<StelSphericalIndex::Neighbour>& result, int k, const StelRegionObjectP& obj, int index, double cosAngle, double& minCosAngle)
+{
+	int i = result.size();
+	if (i<k)
+		result.append(StelSphericalIndex::Neighbour());
+	else
+		--i;
+	for (;i>0 && result.at(i-1).cosAngle<cosAngle;--i)
+		result[i] = result.at(i-1);
+	result[i].obj = obj;
+	result[i].index = index;
+	result[i].cosAngle = cosAngle;
+	if (result.size()==k)
+		minCosAngle = result.last().cosAngle;
+}
+
+void StelSphericalIndex::findNearest(const Vec3d& v, int k, double minCosAngle, QVector<Neighbour>& result) const
+{
+	result.clear();
+	if (k<=0)
+		return;
+	if (isCompact())
+		findNearestFlat(0, v, k, minCosAngle, result);
+	else
+		rootNode->findNearest(v, k, minCosAngle, result);
+}
+
+void StelSphericalIndex::findNearestFlat(int n, const Vec3d& v, int k, double& minCosAngle, QVector<Neighbour>& result) const
+{
+	const FlatNode& node = flatNodes.at(n);
+	const double* x = pointX.constData();
+	const double* y = pointY.constData();
+	const double* z = pointZ.constData();
+	const int end = node.firstElement+node.nbElements;
+	for (int i=node.firstElement;i<end;++i)
+	{
+		const double cosAngle = x[i]*v[0] + y[i]*v[1] + z[i]*v[2];
+		if (cosAngle>minCosAngle)
+			insertNeighbour(result, k, flatObjects.value(i), i, cosAngle, minCosAngle);
+	}
+
+	// Search first the child containing the direction, see RootNode::findNearest()
+	for (int pass=0;pass<2;++pass)
+	{
+		for (int c=node.firstChild;c<node.firstChild+node.nbChildren;++c)
+		{
+			const SphericalConvexPolygon& triangle = flatTriangles.at(c);
+			if (triangle.contains(v)!=(pass==0))
+				continue;
+			if (SphericalCap(v, minCosAngle).intersects(triangle))
+				findNearestFlat(c, v, k, minCosAngle, result);
+		}
+	}
+}
+
+void StelSphericalIndex::RootNode::findNearest(const Node& node, const Vec3d& v, int k, double& minCosAngle, QVector<Neighbour>& result) const
+{
+	foreach (const NodeElem& el, node.elements)
+	{
+		const double cosAngle = el.obj->getPointInRegion()*v;
+		if (cosAngle>minCosAngle)
+			insertNeighbour(result, k, el.obj, -1, cosAngle, minCosAngle);
+	}
+
+	// Search first the child containing the direction, whose objects are likely the nearest
+	// and reduce the cap of the other children.
+	for (int pass=0;pass<2;++pass)
+	{
+		foreach (const Node& child, node.children)
+		{
+			if (child.triangle.contains(v)!=(pass==0))
+				continue;
+			if (SphericalCap(v, minCosAngle).intersects(child.triangle))
+				findNearest(child, v, k, minCosAngle, result);
+		}
+	}
+}
@@ -24,15 +24,66 @@
 
 //! @class StelSphericalIndex
 //! Container allowing to store and query SphericalRegion.
+//! The objects are inserted in a tree of nodes. Once all objects are inserted, compact() builds a flat
+//! copy of the tree for the queries on the points in region of the objects (processIntersectingPointInRegions(),
+//! processPointsInCap(), findNearest() and processAll()): the nodes are in one array, the children of a node
+//! next to each other, and the points of the elements are in coordinate arrays ordered by node, so that the
+//! elements of a subtree are contiguous and are tested without going through the objects.
+//! The flat layout can be saved and set again with setFlatLayout() without the objects, e.g. from a file:
+//! the elements are then given by their index in the layout (processPointIndicesInRegion() and findNearest()),
+//! and the queries on the objects find nothing.
 class StelSphericalIndex
 {
 public:
+	//! A node of the flat layout.
+	struct FlatNode
+	{
+		//! The children are flatNodes[firstChild] to flatNodes[firstChild+nbChildren-1].
+		int firstChild;
+		int nbChildren;
+		//! The elements of the node are [firstElement, firstElement+nbElements[,
+		//! the ones of the node and all its children [firstElement, endElement[.
+		int firstElement;
+		int nbElements;
+		int endElement;
+	};
+
 	StelSphericalIndex(int maxObjectsPerNode = 100, int maxLevel=7);
 	virtual ~StelSphericalIndex();
 
 	//! Insert the given object in the StelSphericalIndex.
+	//! The flat layout built by compact() is dropped.
 	void insert(StelRegionObjectP obj);
 
+	//! Build the flat layout used by the queries on points until the next insert() or clear().
+	//! The points in region of the objects are read once here, they must not change afterwards.
+	void compact();
+
+	//! Return whether the queries on points use the flat layout.
+	bool isCompact() const {return !flatNodes.isEmpty();}
+
+	//! Return whether the flat layout has the objects of its elements, i.e. was built by compact().
+	bool hasFlatObjects() const {return isCompact() && flatObjects.size()==pointX.size();}
+
+	//! Replace the content of the container by a flat layout without objects, as returned by
+	//! getFlatNodes(), getFlatTriangles() and getFlatPoint() after compact().
+	//! Only processPointIndicesInRegion() and findNearest() can then be used, the queries on the objects
+	//! process nothing until the next insert() and compact().
+	//! @return false if the layout is not valid, the container is then empty.
+	bool setFlatLayout(const QVector<FlatNode>& nodes, const QVector<SphericalConvexPolygon>& triangles,
+			   const QVector<double>& x, const QVector<double>& y, const QVector<double>& z);
+
+	//! Get the nodes of the flat layout, the root first.
+	const QVector<FlatNode>& getFlatNodes() const {return flatNodes;}
+	//! Get the triangle of each node of the flat layout, empty for the root.
+	const QVector<SphericalConvexPolygon>& getFlatTriangles() const {return flatTriangles;}
+	//! Get the number of elements in the flat layout.
+	int getFlatElementCount() const {return pointX.size();}
+	//! Get the point in region of the element i of the flat layout.
+	Vec3d getFlatPoint(int i) const {return Vec3d(pointX.at(i), pointY.at(i), pointZ.at(i));}
+	//! Get the object of the element i of the flat layout, null if it was set by setFlatLayout().
+	StelRegionObjectP getFlatObject(int i) const {return flatObjects.value(i);}
+
 	//! Process all the objects intersecting the given region using the passed function object.
 	template<class FuncObject> void processIntersectingRegions(const SphericalRegion* region, FuncObject& func) const
 	{
@@ -42,7 +93,13 @@ public:
 	//! Process all the objects intersecting the given region using the passed function object.
 	template<class FuncObject> void processIntersectingPointInRegions(const SphericalRegion* region, FuncObject& func) const
 	{
-		rootNode->processIntersectingPointInRegions(region, func);
+		if (hasFlatObjects())
+		{
+			RawPointerCaller<FuncObject> caller(flatObjects, func);
+			processFlatPointsInRegion(0, region, PointFilter(region), caller);
+		}
+		else
+			rootNode->processIntersectingPointInRegions(region, func);
 	}
 	
 	//! Process all the objects intersecting the given region using the passed function object.
@@ -60,13 +117,62 @@ public:
 	//! Process all the objects intersecting the given region using the passed function object.
 	template<class FuncObject> void processAll(FuncObject& func) const
 	{
-		rootNode->processAll(func);
+		if (hasFlatObjects())
+		{
+			for (int i=0;i<flatObjects.size();++i)
+				func(flatObjects.at(i).data());
+		}
+		else
+			rootNode->processAll(func);
+	}
+
+	//! Process the elements of the flat layout whose point in region is inside the given region, passing
+	//! their index in the layout to the function object. The container must be compact.
+	template<class FuncObject> void processPointIndicesInRegion(const SphericalRegion* region, FuncObject& func) const
+	{
+		Q_ASSERT(isCompact());
+		processFlatPointsInRegion(0, region, PointFilter(region), func);
 	}
 
+	//! Process all the objects whose point in region is inside the cap using the passed function object.
+	//! The function object is called with the const StelRegionObjectP& of the object, so that it can keep
+	//! a reference on it, e.g. in a buffer reused between the queries.
+	template<class FuncObject> void processPointsInCap(const SphericalCap& cap, FuncObject& func) const
+	{
+		if (hasFlatObjects())
+		{
+			SharedPointerCaller<FuncObject> caller(flatObjects, func);
+			processFlatPointsInRegion(0, &cap, PointFilter(&cap), caller);
+		}
+		else
+			rootNode->processPointsInCap(cap, func);
+	}
+
+	//! An object found by findNearest().
+	struct Neighbour
+	{
+		//! The object, null if the flat layout was set by setFlatLayout().
+		StelRegionObjectP obj;
+		//! The index of the element in the flat layout, -1 if the container is not compact.
+		int index;
+		//! The cosine of the angle between the point in region of the object and the searched direction.
+		double cosAngle;
+	};
+
+	//! Find the objects whose point in region is the nearest to a direction.
+	//! The nodes out of the cap of the k nearest objects found so far are skipped.
+	//! @param v the normalized direction.
+	//! @param k the maximum number of objects to find.
+	//! @param minCosAngle only the objects whose point in region p verifies p*v>minCosAngle are found.
+	//! @param result the found objects, the nearest first. It is cleared first, and can be reused between
+	//! the queries so that they don't allocate memory.
+	void findNearest(const Vec3d& v, int k, double minCosAngle, QVector<Neighbour>& result) const;
+
 	//! Remove all the elements in the container.
 	void clear()
 	{
 		rootNode->clear();
+		clearFlatLayout();
 	}
 
 	//! Return the total number of elements in the container.
@@ -78,6 +184,82 @@ public:
 	}
 
 private:
+	//! Test of points against a region. The half-spaces of caps and small convex polygons are
+	//! precomputed, giving the same results as SphericalCap::contains() and SphericalConvexPolygon::contains().
+	class PointFilter
+	{
+	public:
+		PointFilter(const SphericalRegion* region);
+		bool contains(double x, double y, double z) const
+		{
+			if (generic)
+				return region->contains(Vec3d(x, y, z));
+			for (int h=0;h<nbHalfSpaces;++h)
+			{
+				if (!(nx[h]*x + ny[h]*y + nz[h]*z >= d[h]))
+					return false;
+			}
+			return true;
+		}
+	private:
+		static const int MaxHalfSpaces = 9;
+		const SphericalRegion* region;
+		bool generic;
+		int nbHalfSpaces;
+		double nx[MaxHalfSpaces], ny[MaxHalfSpaces], nz[MaxHalfSpaces], d[MaxHalfSpaces];
+	};
+
+	//! Call a function object with the raw pointer of the elements, as the tree queries.
+	template<class FuncObject> struct RawPointerCaller
+	{
+		RawPointerCaller(const QVector<StelRegionObjectP>& aobjects, FuncObject& afunc) : objects(aobjects), func(afunc) {;}
+		void operator()(int i) {func(objects.at(i).data());}
+		const QVector<StelRegionObjectP>& objects;
+		FuncObject& func;
+	};
+
+	//! Call a function object with the shared pointer of the elements, as processPointsInCap().
+	template<class FuncObject> struct SharedPointerCaller
+	{
+		SharedPointerCaller(const QVector<StelRegionObjectP>& aobjects, FuncObject& afunc) : objects(aobjects), func(afunc) {;}
+		void operator()(int i) {func(objects.at(i));}
+		const QVector<StelRegionObjectP>& objects;
+		FuncObject& func;
+	};
+
+	//! Process the elements of the flat node n and its children with point in the region.
+	template<class Caller> void processFlatPointsInRegion(int n, const SphericalRegion* region, const PointFilter& filter, Caller& caller) const
+	{
+		const FlatNode& node = flatNodes.at(n);
+		const double* x = pointX.constData();
+		const double* y = pointY.constData();
+		const double* z = pointZ.constData();
+		const int end = node.firstElement+node.nbElements;
+		for (int i=node.firstElement;i<end;++i)
+		{
+			if (filter.contains(x[i], y[i], z[i]))
+				caller(i);
+		}
+		for (int c=node.firstChild;c<node.firstChild+node.nbChildren;++c)
+		{
+			const SphericalConvexPolygon& triangle = flatTriangles.at(c);
+			if (region->contains(triangle))
+			{
+				const FlatNode& child = flatNodes.at(c);
+				for (int i=child.firstElement;i<child.endElement;++i)
+					caller(i);
+			}
+			else if (region->intersects(triangle))
+				processFlatPointsInRegion(c, region, filter, caller);
+		}
+	}
+
+	//! Find the objects nearest to v in the flat node n and its children.
+	void findNearestFlat(int n, const Vec3d& v, int k, double& minCosAngle, QVector<Neighbour>& result) const;
+
+	//! Drop the flat layout.
+	void clearFlatLayout();
+
 	struct CountFunc
 	{
 		CountFunc() : nb(0) {;}
@@ -213,6 +395,18 @@ private:
 				processAll(*this, func);
 			}
 
+			//! Process all the objects whose point in region is inside the cap using the passed function object.
+			template<class FuncObject> void processPointsInCap(const SphericalCap& cap, FuncObject& func) const
+			{
+				processPointsInCap(*this, cap, func);
+			}
+
+			//! Find the objects nearest to v, see StelSphericalIndex::findNearest().
+			void findNearest(const Vec3d& v, int k, double& minCosAngle, QVector<Neighbour>& result) const
+			{
+				findNearest(*this, v, k, minCosAngle, result);
+			}
+
 		private:
 			//! Insert the given element in the given node.
 			void insert(Node& node, const NodeElem& el, int level)
@@ -324,16 +518,58 @@ private:
 					processAll(child, func);
 			}
 
+			//! Process all the objects with point in the cap using the passed function object.
+			template<class FuncObject> void processPointsInCap(const Node& node, const SphericalCap& cap, FuncObject& func) const
+			{
+				foreach (const NodeElem& el, node.elements)
+				{
+					if (cap.contains(el.obj->getPointInRegion()))
+						func(el.obj);
+				}
+				foreach (const Node& child, node.children)
+				{
+					if (cap.contains(child.triangle))
+						processAllPointers(child, func);
+					else if (cap.intersects(child.triangle))
+						processPointsInCap(child, cap, func);
+				}
+			}
+
+			//! Process all the objects, passing their shared pointer to the function object.
+			template<class FuncObject> void processAllPointers(const Node& node, FuncObject& func) const
+			{
+				foreach (const NodeElem& el, node.elements)
+					func(el.obj);
+				foreach (const Node& child, node.children)
+					processAllPointers(child, func);
+			}
+
+			//! Find the objects nearest to v in the node and its children.
+			//! minCosAngle is raised to the k-th nearest object once k objects are found.
+			void findNearest(const Node& node, const Vec3d& v, int k, double& minCosAngle, QVector<Neighbour>& result) const;
+
 			//! The maximum number of objects per node.
 			int maxObjectsPerNode;
 			//! The maximum level of the grid. Prevents grid split into too small triangles if unecessary.
 			int maxLevel;
 	};
 
+	//! Copy the node and its children at the index n of the flat layout.
+	void compactNode(const Node& node, int n);
+
 	//! The maximum allowed number of object per node.
 	int maxObjectsPerNode;
 
 	RootNode* rootNode;
+
+	// The flat layout, empty until compact() is called
+	QVector<FlatNode> flatNodes;
+	//! The triangle of each flat node, empty for the root.
+	QVector<SphericalConvexPolygon> flatTriangles;
+	//! The point in region of each element.
+	QVector<double> pointX, pointY, pointZ;
+	//! The object of each element.
+	QVector<StelRegionObjectP> flatObjects;
 };
 
 #endif // _STELSPHERICALINDEX_HPP_
@@ -103,20 +103,9 @@ bool Asterism::read(const QString& record, StarMgr *starMgr)
 			{
 				istr >> RA >> DE;				
 				StelUtils::spheToRect(RA*M_PI/12., DE*M_PI/180., coords);
-				QList<StelObjectP> stars = starMgr->searchAround(coords, 0.1, core);
-				StelObjectP s = NULL;
-				float d = 10.f;
-				foreach (const StelObjectP &p, stars)
-				{
-					float a = coords.angle(p->getJ2000EquatorialPos(core));
-					if (a<d)
-					{
-						d = a;
-						s = p;
-					}
-				}
-
-				asterism[i] = s;
+				// The star may be fainter than the current limit magnitude.
+				QList<StelObjectP> stars = starMgr->searchNearest(coords, 0.1, 1, core, false);
+				asterism[i] = stars.isEmpty() ? StelObjectP() : stars.first();
 
 				if (!asterism[i])
 				{
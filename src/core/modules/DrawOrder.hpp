@@ -0,0 +1,154 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _DRAWORDER_HPP_
+#define _DRAWORDER_HPP_
+
+#include <QSet>
+#include <QVector>
+#include <algorithm>
+
+//! @class DrawOrder
+//! Order in which bodies are drawn, from the furthest to the closest to the observer.
+//! The order is kept from one frame to the next. The distances change little between two frames,
+//! so that an insertion sort repairs the order in about linear time. The bodies which are not
+//! drawn are culled before the sort, but keep their place for the next frames.
+//! T is a pointer to a body, SolarSystem uses Planet*.
+template<class T> class DrawOrder
+{
+public:
+	DrawOrder() : nrOfFullSorts(0) {}
+
+	//! Set the bodies to order. The known bodies keep their order, the new ones are added as the closest.
+	void setItems(const QVector<T>& newItems)
+	{
+		const QSet<T> newSet = QSet<T>::fromList(newItems.toList());
+		QSet<T> kept;
+		QVector<T> order;
+		order.reserve(newItems.size());
+		foreach (const T& item, items)
+		{
+			if (newSet.contains(item))
+			{
+				order.append(item);
+				kept.insert(item);
+			}
+		}
+		foreach (const T& item, newItems)
+		{
+			if (!kept.contains(item))
+				order.append(item);
+		}
+		items = order;
+		drawn.clear();
+	}
+
+	//! Update the order for a new frame.
+	//! @param visible a functor called as visible(item, distance) for each body, which returns
+	//! whether the body is drawn and sets its distance to the observer.
+	//! @return the drawn bodies, from the furthest to the closest
+	template<class Visible> const QVector<T>& update(Visible& visible)
+	{
+		drawn.resize(0);
+		drawnDistances.resize(0);
+		drawnSlots.resize(0);
+		for (int i=0;i<items.size();++i)
+		{
+			double distance;
+			if (visible(items.at(i), distance))
+			{
+				drawn.append(items.at(i));
+				drawnDistances.append(distance);
+				drawnSlots.append(i);
+			}
+		}
+
+		if (!insertionSort())
+			fullSort();
+		// The drawn bodies take the slots of the order in their new order.
+		for (int k=0;k<drawn.size();++k)
+			items[drawnSlots.at(k)] = drawn.at(k);
+		return drawn;
+	}
+
+	//! Get the bodies drawn by the last update(), from the furthest to the closest.
+	const QVector<T>& getDrawnItems() const {return drawn;}
+	//! Get the number of updates which had to sort the bodies from scratch.
+	int getNrOfFullSorts() const {return nrOfFullSorts;}
+
+private:
+	//! Sort drawn by decreasing distance, stopping when the order is too far from sorted.
+	//! @return false if the sort was stopped
+	bool insertionSort()
+	{
+		const qint64 maxMoves = 8*(qint64)drawn.size()+64;
+		qint64 moves = 0;
+		for (int i=1;i<drawn.size();++i)
+		{
+			const T item = drawn.at(i);
+			const double distance = drawnDistances.at(i);
+			int j = i;
+			while (j>0 && drawnDistances.at(j-1)<distance)
+			{
+				drawn[j] = drawn.at(j-1);
+				drawnDistances[j] = drawnDistances.at(j-1);
+				--j;
+			}
+			drawn[j] = item;
+			drawnDistances[j] = distance;
+			moves += i-j;
+			if (moves>maxMoves)
+				return false;
+		}
+		return true;
+	}
+
+	struct FurtherFirst
+	{
+		FurtherFirst(const QVector<double>& distances) : distances(distances) {}
+		bool operator()(int a, int b) const {return distances.at(a)>distances.at(b);}
+		const QVector<double>& distances;
+	};
+
+	void fullSort()
+	{
+		nrOfFullSorts++;
+		QVector<int> permutation(drawn.size());
+		for (int k=0;k<permutation.size();++k)
+			permutation[k] = k;
+		std::stable_sort(permutation.begin(), permutation.end(), FurtherFirst(drawnDistances));
+		const QVector<T> unsorted = drawn;
+		const QVector<double> unsortedDistances = drawnDistances;
+		for (int k=0;k<permutation.size();++k)
+		{
+			drawn[k] = unsorted.at(permutation.at(k));
+			drawnDistances[k] = unsortedDistances.at(permutation.at(k));
+		}
+	}
+
+	//! All bodies, the drawn ones by decreasing distance at the last update
+	QVector<T> items;
+	QVector<T> drawn;
+	QVector<double> drawnDistances;
+	//! Index in items of the drawn bodies
+	QVector<int> drawnSlots;
+	int nrOfFullSorts;
+};
+
+#endif // _DRAWORDER_HPP_
@@ -0,0 +1,578 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "DsoCatalogStore.hpp"
+#include "StelSphericalIndex.hpp"
+#include "StelUtils.hpp"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <cstring>
+
+// Change it when the layout of the store changes.
+#define DSO_STORE_VERSION 2
+static const char storeMagic[8] = {'S','T','E','L','D','S','O','S'};
+
+// The grid of the DSO, as the one of NebulaMgr.
+static const int GridMaxObjectsPerNode = 200;
+
+// All numbers are little-endian. The sections are at the given offsets from the start of the file:
+// - positions: the columns of the x, y and z coordinates of the DSO, as doubles;
+// - triangles: the 3 vertices of the triangle of each node of the grid, as doubles, zeros for the root;
+// - columns: the NrOfColumns columns of the records, of 4 bytes per DSO;
+// - nodes: the firstChild, nbChildren, firstElement, nbElements and endElement of each node of the grid;
+// - elements: the record of each element of the grid;
+// - pool: the zero terminated UTF-8 strings, the empty string first.
+struct DsoCatalogStore::Header
+{
+	char magic[8];
+	quint32 version;
+	quint32 nrOfRecords;
+	quint32 nrOfColumns;
+	quint32 nrOfNodes;
+	qint64 catalogSize;
+	qint64 catalogModified;	// msecs since epoch
+	char catalogVersion[16];
+	char catalogEdition[16];
+	quint64 positionsOffset;
+	quint64 trianglesOffset;
+	quint64 columnsOffset;
+	quint64 nodesOffset;
+	quint64 elementsOffset;
+	quint64 poolOffset;
+	quint64 poolSize;
+};
+
+static const int NodeSize = 5*sizeof(qint32);
+static const int TriangleSize = 9*sizeof(double);
+
+static quint32 floatToStore(float f)
+{
+	quint32 bits;
+	std::memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+static float floatFromStore(quint32 bits)
+{
+	float f;
+	std::memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static quint64 doubleToStore(double d)
+{
+	quint64 bits;
+	std::memcpy(&bits, &d, sizeof(bits));
+	return bits;
+}
+
+static double doubleAt(const uchar* p)
+{
+	const quint64 bits = qFromLittleEndian<quint64>(p);
+	double d;
+	std::memcpy(&d, &bits, sizeof(d));
+	return d;
+}
+
+// Copy a string to a field padded with zeros, keeping a zero at the end.
+static void copyField(char* field, int fieldSize, const QByteArray& value)
+{
+	std::memset(field, 0, fieldSize);
+	std::memcpy(field, value.constData(), qMin(value.size(), fieldSize-1));
+}
+
+static QString readField(const char* field, int fieldSize)
+{
+	return QString::fromLatin1(field, qstrnlen(field, fieldSize));
+}
+
+// Add a string to the pool, once, and return its offset.
+static quint32 poolString(const QString& s, QByteArray& pool, QHash<QByteArray, quint32>& offsets)
+{
+	if (s.isEmpty())
+		return 0;
+	const QByteArray utf8 = s.toUtf8();
+	if (offsets.contains(utf8))
+		return offsets.value(utf8);
+	const quint32 offset = pool.size();
+	pool.append(utf8);
+	pool.append('\0');
+	offsets.insert(utf8, offset);
+	return offset;
+}
+
+DsoCatalogStore::DsoCatalogStore()
+	: image(Q_NULLPTR)
+	, imageSize(0)
+	, nrOfRecords(0)
+{
+	// The layout must be the same on all platforms.
+	Q_STATIC_ASSERT(sizeof(Header)==128);
+}
+
+DsoCatalogStore::~DsoCatalogStore()
+{
+	close();
+}
+
+QByteArray DsoCatalogStore::convert(const QString& catalogPath, const QString& catalogVersion)
+{
+	QFile in(catalogPath);
+	if (!in.open(QIODevice::ReadOnly))
+		return QByteArray();
+
+	// Let's begin use gzipped data
+	QDataStream ins(StelUtils::uncompress(in.readAll()));
+	ins.setVersion(QDataStream::Qt_5_2);
+	in.close();
+
+	QString version = "", edition= "";
+	ins >> version >> edition;
+	if (version.isEmpty())
+		version = "3.1"; // The first version of extended edition of the catalog
+	if (edition.isEmpty())
+		edition = "unknown";
+	qDebug() << "[...]" << QString("Stellarium DSO Catalog, version %1 (%2 edition)").arg(version).arg(edition);
+	if (StelUtils::compareVersions(version, catalogVersion)!=0)
+	{
+		qDebug() << "WARNING: Mismatch the version of catalog! The expected version of catalog is" << catalogVersion;
+		return QByteArray();
+	}
+
+	// The objects are only created to build the grid.
+	QVector<NebulaP> nebulae;
+	QHash<const StelRegionObject*, int> records;
+	StelSphericalIndex grid(GridMaxObjectsPerNode);
+	while (!ins.atEnd())
+	{
+		NebulaP n = NebulaP(new Nebula);
+		n->readDSO(ins);
+		records.insert(n.data(), nebulae.size());
+		nebulae.append(n);
+		grid.insert(qSharedPointerCast<StelRegionObject>(n));
+	}
+	grid.compact();
+	const int count = nebulae.size();
+
+	QVector<quint32> columns(NrOfColumns*count);
+	QByteArray pool(1, '\0');
+	QHash<QByteArray, quint32> poolOffsets;
+	for (int r=0;r<count;++r)
+	{
+		const Nebula& n = *nebulae.at(r);
+		quint32* c = columns.data()+r;
+		c[ColDsoNumber*count] = n.DSO_nb;
+		c[ColBMag*count] = floatToStore(n.bMag);
+		c[ColVMag*count] = floatToStore(n.vMag);
+		c[ColType*count] = (quint32)n.nType;
+		c[ColCatalogs*count] = (quint32)static_cast<int>(n.getCatalogGroup());
+		c[ColMorphType*count] = poolString(n.mTypeString, pool, poolOffsets);
+		c[ColMajorAxisSize*count] = floatToStore(n.majorAxisSize);
+		c[ColMinorAxisSize*count] = floatToStore(n.minorAxisSize);
+		c[ColOrientationAngle*count] = (quint32)n.orientationAngle;
+		c[ColRedshift*count] = floatToStore(n.redshift);
+		c[ColRedshiftErr*count] = floatToStore(n.redshiftErr);
+		c[ColParallax*count] = floatToStore(n.parallax);
+		c[ColParallaxErr*count] = floatToStore(n.parallaxErr);
+		c[ColDistance*count] = floatToStore(n.oDistance);
+		c[ColDistanceErr*count] = floatToStore(n.oDistanceErr);
+		c[ColNGC*count] = n.NGC_nb;
+		c[ColIC*count] = n.IC_nb;
+		c[ColM*count] = n.M_nb;
+		c[ColC*count] = n.C_nb;
+		c[ColB*count] = n.B_nb;
+		c[ColSh2*count] = n.Sh2_nb;
+		c[ColVdB*count] = n.VdB_nb;
+		c[ColRCW*count] = n.RCW_nb;
+		c[ColLDN*count] = n.LDN_nb;
+		c[ColLBN*count] = n.LBN_nb;
+		c[ColCr*count] = n.Cr_nb;
+		c[ColMel*count] = n.Mel_nb;
+		c[ColPGC*count] = n.PGC_nb;
+		c[ColUGC*count] = n.UGC_nb;
+		c[ColCed*count] = poolString(n.Ced_nb, pool, poolOffsets);
+		c[ColArp*count] = n.Arp_nb;
+		c[ColVV*count] = n.VV_nb;
+		c[ColPK*count] = poolString(n.PK_nb, pool, poolOffsets);
+		c[ColPNG*count] = poolString(n.PNG_nb, pool, poolOffsets);
+		c[ColSNRG*count] = poolString(n.SNRG_nb, pool, poolOffsets);
+		c[ColACO*count] = poolString(n.ACO_nb, pool, poolOffsets);
+	}
+
+	const QVector<StelSphericalIndex::FlatNode>& nodes = grid.getFlatNodes();
+	const QVector<SphericalConvexPolygon>& triangles = grid.getFlatTriangles();
+
+	Header h;
+	std::memset(&h, 0, sizeof(h));
+	std::memcpy(h.magic, storeMagic, sizeof(h.magic));
+	h.version = qToLittleEndian((quint32)DSO_STORE_VERSION);
+	h.nrOfRecords = qToLittleEndian((quint32)count);
+	h.nrOfColumns = qToLittleEndian((quint32)NrOfColumns);
+	h.nrOfNodes = qToLittleEndian((quint32)nodes.size());
+	const QFileInfo catalogInfo(catalogPath);
+	h.catalogSize = qToLittleEndian(catalogInfo.size());
+	h.catalogModified = qToLittleEndian(catalogInfo.lastModified().toMSecsSinceEpoch());
+	copyField(h.catalogVersion, sizeof(h.catalogVersion), version.toLatin1());
+	copyField(h.catalogEdition, sizeof(h.catalogEdition), edition.toLatin1());
+	// The sections of doubles first, all sections are aligned on 4 bytes.
+	quint64 offset = sizeof(Header);
+	h.positionsOffset = qToLittleEndian(offset);
+	offset += (quint64)3*count*sizeof(double);
+	h.trianglesOffset = qToLittleEndian(offset);
+	offset += (quint64)nodes.size()*TriangleSize;
+	h.columnsOffset = qToLittleEndian(offset);
+	offset += (quint64)columns.size()*sizeof(quint32);
+	h.nodesOffset = qToLittleEndian(offset);
+	offset += (quint64)nodes.size()*NodeSize;
+	h.elementsOffset = qToLittleEndian(offset);
+	offset += (quint64)count*sizeof(quint32);
+	h.poolOffset = qToLittleEndian(offset);
+	h.poolSize = qToLittleEndian((quint64)pool.size());
+
+	QByteArray data;
+	data.reserve((int)offset+pool.size());
+	data.append(reinterpret_cast<const char*>(&h), sizeof(h));
+	QDataStream out(&data, QIODevice::Append);
+	out.setByteOrder(QDataStream::LittleEndian);
+	for (int axis=0;axis<3;++axis)
+	{
+		for (int r=0;r<count;++r)
+			out << doubleToStore(nebulae.at(r)->XYZ[axis]);
+	}
+	for (int i=0;i<nodes.size();++i)
+	{
+		const QVector<Vec3d>& contour = triangles.at(i).getConvexContour();
+		for (int v=0;v<3;++v)
+		{
+			for (int axis=0;axis<3;++axis)
+				out << doubleToStore(contour.isEmpty() ? 0. : contour.at(v)[axis]);
+		}
+	}
+	foreach (quint32 value, columns)
+		out << value;
+	foreach (const StelSphericalIndex::FlatNode& node, nodes)
+		out << (qint32)node.firstChild << (qint32)node.nbChildren << (qint32)node.firstElement << (qint32)node.nbElements << (qint32)node.endElement;
+	for (int e=0;e<grid.getFlatElementCount();++e)
+		out << (quint32)records.value(grid.getFlatObject(e).data());
+	out.writeRawData(pool.constData(), pool.size());
+	return data;
+}
+
+bool DsoCatalogStore::write(const QString& path, const QByteArray& data)
+{
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+	file.write(data);
+	return file.commit();
+}
+
+bool DsoCatalogStore::open(const QString& path)
+{
+	close();
+	file.setFileName(path);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	imageSize = file.size();
+	image = imageSize>0 ? file.map(0, imageSize) : Q_NULLPTR;
+	if (!checkImage())
+	{
+		qWarning() << "Invalid DSO catalog store" << QDir::toNativeSeparators(path);
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool DsoCatalogStore::openData(const QByteArray& adata)
+{
+	close();
+	data = adata;
+	image = reinterpret_cast<const uchar*>(data.constData());
+	imageSize = data.size();
+	if (!checkImage())
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void DsoCatalogStore::close()
+{
+	if (image && file.isOpen())
+		file.unmap(const_cast<uchar*>(image));
+	if (file.isOpen())
+		file.close();
+	data.clear();
+	image = Q_NULLPTR;
+	imageSize = 0;
+	nrOfRecords = 0;
+}
+
+bool DsoCatalogStore::checkImage()
+{
+	if (image==Q_NULLPTR || imageSize<(qint64)sizeof(Header))
+		return false;
+	const Header* h = header();
+	const quint64 count = qFromLittleEndian(h->nrOfRecords);
+	const quint64 nrOfNodes = qFromLittleEndian(h->nrOfNodes);
+	const quint64 poolSize = qFromLittleEndian(h->poolSize);
+	if (std::memcmp(h->magic, storeMagic, sizeof(h->magic))!=0
+	    || qFromLittleEndian(h->version)!=DSO_STORE_VERSION
+	    || qFromLittleEndian(h->nrOfColumns)!=NrOfColumns
+	    || count>0x7fffffff || nrOfNodes==0 || poolSize==0)
+		return false;
+	// Each section must be in the file.
+	const quint64 sections[6][2] =
+	{
+		{qFromLittleEndian(h->positionsOffset), 3*count*sizeof(double)},
+		{qFromLittleEndian(h->trianglesOffset), nrOfNodes*TriangleSize},
+		{qFromLittleEndian(h->columnsOffset), NrOfColumns*count*sizeof(quint32)},
+		{qFromLittleEndian(h->nodesOffset), nrOfNodes*NodeSize},
+		{qFromLittleEndian(h->elementsOffset), count*sizeof(quint32)},
+		{qFromLittleEndian(h->poolOffset), poolSize}
+	};
+	for (int i=0;i<6;++i)
+	{
+		if (sections[i][0]>(quint64)imageSize || sections[i][1]>(quint64)imageSize-sections[i][0])
+			return false;
+	}
+	if (image[sections[5][0]+poolSize-1]!='\0')
+		return false;
+	nrOfRecords = (int)count;
+	for (int e=0;e<nrOfRecords;++e)
+	{
+		if ((quint32)getElementRecord(e)>=(quint32)nrOfRecords)
+			return false;
+	}
+	return true;
+}
+
+const DsoCatalogStore::Header* DsoCatalogStore::header() const
+{
+	return reinterpret_cast<const Header*>(image);
+}
+
+bool DsoCatalogStore::matchesCatalog(const QString& catalogPath) const
+{
+	const QFileInfo catalogInfo(catalogPath);
+	return isOpen() && catalogInfo.exists()
+		&& qFromLittleEndian(header()->catalogSize)==catalogInfo.size()
+		&& qFromLittleEndian(header()->catalogModified)==catalogInfo.lastModified().toMSecsSinceEpoch();
+}
+
+QString DsoCatalogStore::getCatalogVersion() const
+{
+	return readField(header()->catalogVersion, sizeof(Header::catalogVersion));
+}
+
+QString DsoCatalogStore::getCatalogEdition() const
+{
+	return readField(header()->catalogEdition, sizeof(Header::catalogEdition));
+}
+
+quint32 DsoCatalogStore::value(Column column, int record) const
+{
+	const quint64 offset = qFromLittleEndian(header()->columnsOffset) + ((quint64)column*nrOfRecords+record)*sizeof(quint32);
+	return qFromLittleEndian<quint32>(image+offset);
+}
+
+float DsoCatalogStore::floatValue(Column column, int record) const
+{
+	return floatFromStore(value(column, record));
+}
+
+QString DsoCatalogStore::stringValue(Column column, int record) const
+{
+	const quint32 offset = value(column, record);
+	if (offset==0 || offset>=qFromLittleEndian(header()->poolSize))
+		return QString();
+	// The pool ends with a zero, see checkImage()
+	return QString::fromUtf8(reinterpret_cast<const char*>(image+qFromLittleEndian(header()->poolOffset)+offset));
+}
+
+int DsoCatalogStore::catalogColumn(Nebula::CatalogGroupFlags catalog)
+{
+	switch (catalog)
+	{
+		case Nebula::CatM:	return ColM;
+		case Nebula::CatNGC:	return ColNGC;
+		case Nebula::CatIC:	return ColIC;
+		case Nebula::CatC:	return ColC;
+		case Nebula::CatB:	return ColB;
+		case Nebula::CatSh2:	return ColSh2;
+		case Nebula::CatVdB:	return ColVdB;
+		case Nebula::CatRCW:	return ColRCW;
+		case Nebula::CatLDN:	return ColLDN;
+		case Nebula::CatLBN:	return ColLBN;
+		case Nebula::CatCr:	return ColCr;
+		case Nebula::CatMel:	return ColMel;
+		case Nebula::CatPGC:	return ColPGC;
+		case Nebula::CatUGC:	return ColUGC;
+		case Nebula::CatCed:	return ColCed;
+		case Nebula::CatArp:	return ColArp;
+		case Nebula::CatVV:	return ColVV;
+		case Nebula::CatPK:	return ColPK;
+		case Nebula::CatPNG:	return ColPNG;
+		case Nebula::CatSNRG:	return ColSNRG;
+		case Nebula::CatACO:	return ColACO;
+		default:		return -1;
+	}
+}
+
+unsigned int DsoCatalogStore::getDsoNumber(int record) const
+{
+	return value(ColDsoNumber, record);
+}
+
+float DsoCatalogStore::getBMagnitude(int record) const
+{
+	return floatValue(ColBMag, record);
+}
+
+float DsoCatalogStore::getVMagnitude(int record) const
+{
+	return floatValue(ColVMag, record);
+}
+
+float DsoCatalogStore::getMajorAxisSize(int record) const
+{
+	return floatValue(ColMajorAxisSize, record);
+}
+
+Nebula::NebulaType DsoCatalogStore::getType(int record) const
+{
+	return (Nebula::NebulaType)value(ColType, record);
+}
+
+Nebula::CatalogGroup DsoCatalogStore::getCatalogGroup(int record) const
+{
+	return Nebula::CatalogGroup(QFlag((int)value(ColCatalogs, record)));
+}
+
+unsigned int DsoCatalogStore::getCatalogNumber(int record, Nebula::CatalogGroupFlags catalog) const
+{
+	const int column = catalogColumn(catalog);
+	if (column<0 || column==ColCed || column>=ColPK)
+		return 0;
+	return value((Column)column, record);
+}
+
+QString DsoCatalogStore::getCatalogString(int record, Nebula::CatalogGroupFlags catalog) const
+{
+	const int column = catalogColumn(catalog);
+	if (column!=ColCed && column<ColPK)
+		return QString();
+	return stringValue((Column)column, record);
+}
+
+NebulaP DsoCatalogStore::createNebula(int record) const
+{
+	NebulaP n = NebulaP(new Nebula);
+	n->DSO_nb = value(ColDsoNumber, record);
+	n->bMag = floatValue(ColBMag, record);
+	n->vMag = floatValue(ColVMag, record);
+	n->mTypeString = stringValue(ColMorphType, record);
+	n->majorAxisSize = floatValue(ColMajorAxisSize, record);
+	n->minorAxisSize = floatValue(ColMinorAxisSize, record);
+	n->orientationAngle = (qint32)value(ColOrientationAngle, record);
+	n->redshift = floatValue(ColRedshift, record);
+	n->redshiftErr = floatValue(ColRedshiftErr, record);
+	n->parallax = floatValue(ColParallax, record);
+	n->parallaxErr = floatValue(ColParallaxErr, record);
+	n->oDistance = floatValue(ColDistance, record);
+	n->oDistanceErr = floatValue(ColDistanceErr, record);
+	n->NGC_nb = value(ColNGC, record);
+	n->IC_nb = value(ColIC, record);
+	n->M_nb = value(ColM, record);
+	n->C_nb = value(ColC, record);
+	n->B_nb = value(ColB, record);
+	n->Sh2_nb = value(ColSh2, record);
+	n->VdB_nb = value(ColVdB, record);
+	n->RCW_nb = value(ColRCW, record);
+	n->LDN_nb = value(ColLDN, record);
+	n->LBN_nb = value(ColLBN, record);
+	n->Cr_nb = value(ColCr, record);
+	n->Mel_nb = value(ColMel, record);
+	n->PGC_nb = value(ColPGC, record);
+	n->UGC_nb = value(ColUGC, record);
+	n->Ced_nb = stringValue(ColCed, record);
+	n->Arp_nb = value(ColArp, record);
+	n->VV_nb = value(ColVV, record);
+	n->PK_nb = stringValue(ColPK, record);
+	n->PNG_nb = stringValue(ColPNG, record);
+	n->SNRG_nb = stringValue(ColSNRG, record);
+	n->ACO_nb = stringValue(ColACO, record);
+	const uchar* positions = image+qFromLittleEndian(header()->positionsOffset);
+	for (int axis=0;axis<3;++axis)
+		n->XYZ[axis] = doubleAt(positions+((quint64)axis*nrOfRecords+record)*sizeof(double));
+	n->setupRecord(value(ColType, record));
+	return n;
+}
+
+int DsoCatalogStore::getElementRecord(int element) const
+{
+	return qFromLittleEndian<quint32>(image+qFromLittleEndian(header()->elementsOffset)+(quint64)element*sizeof(quint32));
+}
+
+bool DsoCatalogStore::setupIndex(StelSphericalIndex& index) const
+{
+	const int nrOfNodes = qFromLittleEndian(header()->nrOfNodes);
+	const uchar* nodeData = image+qFromLittleEndian(header()->nodesOffset);
+	const uchar* triangleData = image+qFromLittleEndian(header()->trianglesOffset);
+	QVector<StelSphericalIndex::FlatNode> nodes(nrOfNodes);
+	QVector<SphericalConvexPolygon> triangles(nrOfNodes);
+	for (int i=0;i<nrOfNodes;++i)
+	{
+		const uchar* p = nodeData+(qint64)i*NodeSize;
+		StelSphericalIndex::FlatNode& node = nodes[i];
+		node.firstChild = qFromLittleEndian<qint32>(p);
+		node.nbChildren = qFromLittleEndian<qint32>(p+4);
+		node.firstElement = qFromLittleEndian<qint32>(p+8);
+		node.nbElements = qFromLittleEndian<qint32>(p+12);
+		node.endElement = qFromLittleEndian<qint32>(p+16);
+		if (i==0)
+			continue;
+		const uchar* t = triangleData+(qint64)i*TriangleSize;
+		Vec3d c[3];
+		for (int v=0;v<3;++v)
+			c[v].set(doubleAt(t+24*v), doubleAt(t+24*v+8), doubleAt(t+24*v+16));
+		triangles[i] = SphericalConvexPolygon(c[0], c[1], c[2]);
+	}
+
+	// The points of the elements, in the order of the grid
+	const uchar* positions = image+qFromLittleEndian(header()->positionsOffset);
+	QVector<double> x(nrOfRecords), y(nrOfRecords), z(nrOfRecords);
+	for (int e=0;e<nrOfRecords;++e)
+	{
+		const quint64 r = getElementRecord(e);
+		x[e] = doubleAt(positions+r*sizeof(double));
+		y[e] = doubleAt(positions+((quint64)nrOfRecords+r)*sizeof(double));
+		z[e] = doubleAt(positions+((quint64)2*nrOfRecords+r)*sizeof(double));
+	}
+	return index.setFlatLayout(nodes, triangles, x, y, z);
+}
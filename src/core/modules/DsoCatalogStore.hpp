@@ -0,0 +1,124 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _DSOCATALOGSTORE_HPP_
+#define _DSOCATALOGSTORE_HPP_
+
+#include "Nebula.hpp"
+
+#include <QByteArray>
+#include <QFile>
+#include <QSharedPointer>
+#include <QString>
+
+class StelSphericalIndex;
+
+typedef QSharedPointer<Nebula> NebulaP;
+
+//! @class DsoCatalogStore
+//! An uncompressed copy of the DSO catalog (catalog.dat), which is memory-mapped instead of being
+//! read into one Nebula object per DSO: the Nebula objects are created by createNebula() when they are
+//! drawn, selected or searched.
+//!
+//! The layout does not depend on the machine: all numbers are little-endian. A header is followed by
+//! one column per field of the records, in the order of the DSO in catalog.dat. The columns have fixed
+//! widths: the positions are doubles, the other fields are stored on 4 bytes, the strings (morphological
+//! type and non numeric designations) as offsets in a pool of zero terminated UTF-8 strings. A column
+//! of catalog flags and the type let the DSO be filtered before their Nebula object is created.
+//! The file also holds the flat layout of a StelSphericalIndex of the DSO (see StelSphericalIndex::compact()),
+//! with the record of each element, so that the grid of NebulaMgr is set without inserting the objects.
+//!
+//! The header keeps the size and date of the catalog it was converted from, so that a new catalog.dat
+//! is converted again.
+class DsoCatalogStore
+{
+public:
+	DsoCatalogStore();
+	~DsoCatalogStore();
+
+	//! Convert the catalog file @em catalogPath to the content of a store file.
+	//! @param catalogVersion the version of the catalog format which can be read
+	//! @return the content of the store, empty if the catalog cannot be read or has another version.
+	static QByteArray convert(const QString& catalogPath, const QString& catalogVersion);
+	//! Write the content of a store to a new file, which replaces the file @em path.
+	static bool write(const QString& path, const QByteArray& data);
+
+	//! Map the store file @em path. The file is closed if it is not a valid store.
+	bool open(const QString& path);
+	//! Use a store kept in memory, e.g. when it cannot be written to a file.
+	bool openData(const QByteArray& data);
+	void close();
+	bool isOpen() const {return image!=Q_NULLPTR;}
+
+	//! Test if the catalog file @em catalogPath is the one the store was converted from.
+	bool matchesCatalog(const QString& catalogPath) const;
+	QString getCatalogVersion() const;
+	QString getCatalogEdition() const;
+
+	//! Get the number of DSO.
+	int size() const {return nrOfRecords;}
+	unsigned int getDsoNumber(int record) const;
+	float getBMagnitude(int record) const;
+	float getVMagnitude(int record) const;
+	float getMajorAxisSize(int record) const;
+	Nebula::NebulaType getType(int record) const;
+	//! Get the catalogs in which the DSO has a designation, as Nebula::getCatalogGroup().
+	Nebula::CatalogGroup getCatalogGroup(int record) const;
+	//! Get the number of the DSO in a catalog with numeric designations, 0 if it has none.
+	unsigned int getCatalogNumber(int record, Nebula::CatalogGroupFlags catalog) const;
+	//! Get the designation of the DSO in a catalog with non numeric designations, e.g. PK, empty if it has none.
+	QString getCatalogString(int record, Nebula::CatalogGroupFlags catalog) const;
+
+	//! Create the Nebula object of a record, the same as Nebula::readDSO() of the catalog.
+	NebulaP createNebula(int record) const;
+
+	//! Set the flat layout of the DSO in @em index, see StelSphericalIndex::setFlatLayout().
+	bool setupIndex(StelSphericalIndex& index) const;
+	//! Get the record of the element @em element of the index set by setupIndex().
+	int getElementRecord(int element) const;
+
+private:
+	struct Header;
+	enum Column
+	{
+		ColDsoNumber, ColBMag, ColVMag, ColType, ColCatalogs, ColMorphType, ColMajorAxisSize, ColMinorAxisSize,
+		ColOrientationAngle, ColRedshift, ColRedshiftErr, ColParallax, ColParallaxErr, ColDistance, ColDistanceErr,
+		ColNGC, ColIC, ColM, ColC, ColB, ColSh2, ColVdB, ColRCW, ColLDN, ColLBN, ColCr, ColMel, ColPGC, ColUGC,
+		ColCed, ColArp, ColVV, ColPK, ColPNG, ColSNRG, ColACO,
+		NrOfColumns
+	};
+
+	const Header* header() const;
+	quint32 value(Column column, int record) const;
+	float floatValue(Column column, int record) const;
+	QString stringValue(Column column, int record) const;
+	//! Get the column of a catalog, or -1.
+	static int catalogColumn(Nebula::CatalogGroupFlags catalog);
+	//! Check the header and sections of the image.
+	bool checkImage();
+
+	QFile file;
+	//! The store kept in memory by openData()
+	QByteArray data;
+	const uchar* image;
+	qint64 imageSize;
+	int nrOfRecords;
+};
+
+#endif // _DSOCATALOGSTORE_HPP_
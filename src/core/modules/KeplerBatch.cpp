@@ -0,0 +1,594 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "KeplerBatch.hpp"
+#include "Orbit.hpp"
+#include "StelUtils.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KEPLERBATCH_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Same convergence criterion as the solvers of CometOrbit.
+#define EPSILON 1e-10
+
+#if defined(_MSC_VER)
+// cuberoot is missing in VC++ !?
+#define cbrt(x) pow((x),1./3.)
+#endif
+
+static const int Lanes = KeplerBatch::Lanes;
+
+// Arithmetic on the lanes: two lanes per SSE2 register, else one lane per double.
+// The scalar version does exactly the same operations.
+#ifdef KEPLERBATCH_USE_SSE2
+typedef __m128d LaneVec;
+typedef __m128d LaneMask;
+static const int LaneWidth = 2;
+static inline LaneVec vLoad(const double* p) {return _mm_loadu_pd(p);}
+static inline void vStore(double* p, LaneVec a) {_mm_storeu_pd(p, a);}
+static inline LaneVec vSet(double x) {return _mm_set1_pd(x);}
+static inline LaneVec vAdd(LaneVec a, LaneVec b) {return _mm_add_pd(a, b);}
+static inline LaneVec vSub(LaneVec a, LaneVec b) {return _mm_sub_pd(a, b);}
+static inline LaneVec vMul(LaneVec a, LaneVec b) {return _mm_mul_pd(a, b);}
+static inline LaneVec vDiv(LaneVec a, LaneVec b) {return _mm_div_pd(a, b);}
+static inline LaneVec vSqrt(LaneVec a) {return _mm_sqrt_pd(a);}
+static inline LaneVec vAbs(LaneVec a) {return _mm_andnot_pd(_mm_set1_pd(-0.0), a);}
+static inline LaneVec vMin(LaneVec a, LaneVec b) {return _mm_min_pd(a, b);}
+static inline LaneVec vMax(LaneVec a, LaneVec b) {return _mm_max_pd(a, b);}
+static inline LaneMask vGt(LaneVec a, LaneVec b) {return _mm_cmpgt_pd(a, b);}
+static inline LaneMask vLt(LaneVec a, LaneVec b) {return _mm_cmplt_pd(a, b);}
+static inline LaneMask vGe(LaneVec a, LaneVec b) {return _mm_cmpge_pd(a, b);}
+static inline LaneMask vEq(LaneVec a, LaneVec b) {return _mm_cmpeq_pd(a, b);}
+static inline LaneMask vOr(LaneMask a, LaneMask b) {return _mm_or_pd(a, b);}
+static inline LaneMask vNoLane() {return _mm_setzero_pd();}
+static inline bool vAll(LaneMask m) {return _mm_movemask_pd(m)==3;}
+static inline LaneVec vSelect(LaneMask m, LaneVec a, LaneVec b) {return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b));}
+//! 2^k for an integral k in [-1022, 1023], built in the exponent bits.
+static inline LaneVec vPow2(LaneVec k)
+{
+	const __m128i bits = _mm_castpd_si128(_mm_add_pd(k, _mm_set1_pd(4503599627370496.0+1023.0)));
+	return _mm_castsi128_pd(_mm_slli_epi64(bits, 52));
+}
+#else
+typedef double LaneVec;
+typedef bool LaneMask;
+static const int LaneWidth = 1;
+static inline LaneVec vLoad(const double* p) {return *p;}
+static inline void vStore(double* p, LaneVec a) {*p = a;}
+static inline LaneVec vSet(double x) {return x;}
+static inline LaneVec vAdd(LaneVec a, LaneVec b) {return a+b;}
+static inline LaneVec vSub(LaneVec a, LaneVec b) {return a-b;}
+static inline LaneVec vMul(LaneVec a, LaneVec b) {return a*b;}
+static inline LaneVec vDiv(LaneVec a, LaneVec b) {return a/b;}
+static inline LaneVec vSqrt(LaneVec a) {return std::sqrt(a);}
+static inline LaneVec vAbs(LaneVec a) {return std::fabs(a);}
+static inline LaneVec vMin(LaneVec a, LaneVec b) {return a<b ? a : b;}
+static inline LaneVec vMax(LaneVec a, LaneVec b) {return a>b ? a : b;}
+static inline LaneMask vGt(LaneVec a, LaneVec b) {return a>b;}
+static inline LaneMask vLt(LaneVec a, LaneVec b) {return a<b;}
+static inline LaneMask vGe(LaneVec a, LaneVec b) {return a>=b;}
+static inline LaneMask vEq(LaneVec a, LaneVec b) {return a==b;}
+static inline LaneMask vOr(LaneMask a, LaneMask b) {return a || b;}
+static inline LaneMask vNoLane() {return false;}
+static inline bool vAll(LaneMask m) {return m;}
+static inline LaneVec vSelect(LaneMask m, LaneVec a, LaneVec b) {return m ? a : b;}
+static inline LaneVec vPow2(LaneVec k)
+{
+	const double t = k+(4503599627370496.0+1023.0);
+	quint64 bits;
+	memcpy(&bits, &t, sizeof(bits));
+	bits <<= 52;
+	double result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+#endif
+
+//! Round to the nearest integer, for |x| < 2^51.
+static inline LaneVec vRound(LaneVec x)
+{
+	const LaneVec magic = vSet(6755399441055744.0);
+	return vSub(vAdd(x, magic), magic);
+}
+
+static inline LaneVec vNeg(LaneVec x)
+{
+	return vSub(vSet(0.0), x);
+}
+
+//! Same as StelUtils::sign()
+static inline LaneVec vSign(LaneVec x)
+{
+	const LaneVec zero = vSet(0.0);
+	const LaneVec one = vSet(1.0);
+	return vSub(vSelect(vGt(x, zero), one, zero), vSelect(vLt(x, zero), one, zero));
+}
+
+// Cephes coefficients of the sine and cosine on [-pi/4, pi/4]
+static const double SIN_COEFFS[6] = {1.58962301576546568060E-10, -2.50507477628578072866E-8, 2.75573136213857245213E-6,
+				     -1.98412698295895385996E-4, 8.33333333332211858878E-3, -1.66666666666666307295E-1};
+static const double COS_COEFFS[6] = {-1.13585365213876817300E-11, 2.08757008419747316778E-9, -2.75573141792967388112E-7,
+				     2.48015872888517045348E-5, -1.38888888888730564116E-3, 4.16666666666665929218E-2};
+// pi/2 in three parts, with enough trailing zeros for exact products by the quadrant.
+static const double PIO2_1 = 1.57079625129699707031E0;
+static const double PIO2_2 = 7.54978941586159635335E-8;
+static const double PIO2_3 = 5.39030285815811905290E-15;
+
+static inline LaneVec vPoly(LaneVec x, const double* c, int n)
+{
+	LaneVec r = vSet(c[0]);
+	for (int i=1;i<n;++i)
+		r = vAdd(vMul(r, x), vSet(c[i]));
+	return r;
+}
+
+//! Sine and cosine, within 1 ulp of libm for |x| < 1e8.
+static inline void vSinCos(LaneVec x, LaneVec& s, LaneVec& c)
+{
+	// Quadrant k of x, and z = x-k*pi/2 in [-pi/4, pi/4]
+	const LaneVec k = vRound(vMul(x, vSet(0.63661977236758134308)));
+	const LaneVec z = vSub(vSub(vSub(x, vMul(k, vSet(PIO2_1))), vMul(k, vSet(PIO2_2))), vMul(k, vSet(PIO2_3)));
+	const LaneVec z2 = vMul(z, z);
+	const LaneVec sz = vAdd(z, vMul(vMul(z, z2), vPoly(z2, SIN_COEFFS, 6)));
+	const LaneVec cz = vAdd(vSub(vSet(1.0), vMul(vSet(0.5), z2)), vMul(vMul(z2, z2), vPoly(z2, COS_COEFFS, 6)));
+	// q = k modulo 4
+	const LaneVec k4 = vMul(k, vSet(0.25));
+	const LaneVec r4 = vRound(k4);
+	const LaneVec q = vSub(k, vMul(vSet(4.0), vSub(r4, vSelect(vGt(r4, k4), vSet(1.0), vSet(0.0)))));
+	// The sine and the cosine are swapped in the odd quadrants, the sine
+	// is negative in the quadrants 2 and 3, the cosine in 1 and 2.
+	const LaneMask odd = vOr(vEq(q, vSet(1.0)), vEq(q, vSet(3.0)));
+	const LaneVec sa = vSelect(odd, cz, sz);
+	const LaneVec ca = vSelect(odd, sz, cz);
+	s = vSelect(vGe(q, vSet(2.0)), vNeg(sa), sa);
+	c = vSelect(vOr(vEq(q, vSet(1.0)), vEq(q, vSet(2.0))), vNeg(ca), ca);
+}
+
+// Cephes coefficients of exp(r) = 1+2r*P(r^2)/(Q(r^2)-r*P(r^2)) on [-ln(2)/2, ln(2)/2]
+static const double EXP_P[3] = {1.26177193074810590878E-4, 3.02994407707441961300E-2, 9.99999999999999999910E-1};
+static const double EXP_Q[4] = {3.00198505138664455042E-6, 2.52448340349684104192E-3, 2.27265548208155028766E-1, 2.00000000000000000009E0};
+// ln(2) in two parts
+static const double LN2_1 = 6.93145751953125E-1;
+static const double LN2_2 = 1.42860682030941723212E-6;
+
+//! Hyperbolic sine and cosine computed from exp(x), within a few ulp of libm
+//! (absolute for the sine near 0). |x| is limited to 700, where exp() would overflow.
+static inline void vSinhCosh(LaneVec x, LaneVec& sh, LaneVec& ch)
+{
+	const LaneVec xc = vMin(vMax(x, vSet(-700.0)), vSet(700.0));
+	const LaneVec k = vRound(vMul(xc, vSet(1.44269504088896340736)));
+	const LaneVec r = vSub(vSub(xc, vMul(k, vSet(LN2_1))), vMul(k, vSet(LN2_2)));
+	const LaneVec r2 = vMul(r, r);
+	const LaneVec p = vMul(r, vPoly(r2, EXP_P, 3));
+	const LaneVec er = vAdd(vSet(1.0), vDiv(vMul(vSet(2.0), p), vSub(vPoly(r2, EXP_Q, 4), p)));
+	const LaneVec ex = vMul(er, vPow2(k));
+	const LaneVec emx = vDiv(vSet(1.0), ex);
+	sh = vMul(vSet(0.5), vSub(ex, emx));
+	ch = vMul(vSet(0.5), vAdd(ex, emx));
+}
+
+//! Laguerre-Conway step of InitEll() and InitHyp() in Orbit.cpp, @em f2 being e*sin(E) or e*sinh(H),
+//! @em f1 the derivative of @em f.
+static inline LaneVec vLaguerreConwayStep(LaneVec f, LaneVec f1, LaneVec f2)
+{
+	const LaneVec d = vSub(vMul(vMul(vSet(16.0), f1), f1), vMul(vMul(vSet(20.0), f), f2));
+	return vDiv(vMul(vSet(-5.0), f), vAdd(f1, vMul(vSign(f1), vSqrt(vAbs(d)))));
+}
+
+//! Initial guess M+0.85*e*sign(sin(M)) of the Laguerre-Conway iterations for elliptic orbits.
+static inline LaneVec vEllipticGuess(LaneVec e, LaneVec M)
+{
+	LaneVec s, c;
+	vSinCos(M, s, c);
+	return vAdd(M, vMul(vMul(vSet(0.85), e), vSign(s)));
+}
+
+//! Solve M = E - e sin(E) in all lanes with the iterations of InitEll() in Orbit.cpp. A lane
+//! stops at the iteration where InitEll() stops, it is masked until all lanes of its register stopped.
+static void solveCometEllipticLanes(const double* ep, const double* Mp, double* Ep)
+{
+	for (int l=0;l<Lanes;l+=LaneWidth)
+	{
+		const LaneVec e = vLoad(ep+l);
+		const LaneVec M = vLoad(Mp+l);
+		LaneVec E = vEllipticGuess(e, M);
+		LaneMask done = vNoLane();
+		for (int iter=0;iter<=10;++iter)
+		{
+			LaneVec s, c;
+			vSinCos(E, s, c);
+			const LaneVec f2 = vMul(e, s);
+			const LaneVec f = vSub(vSub(E, f2), M);
+			const LaneVec f1 = vSub(vSet(1.0), vMul(e, c));
+			const LaneVec next = vAdd(E, vLaguerreConwayStep(f, f1, f2));
+			const LaneMask converged = vLt(vAbs(vSub(next, E)), vSet(EPSILON));
+			E = vSelect(done, E, next);
+			done = vOr(done, converged);
+			if (vAll(done))
+				break;
+		}
+		vStore(Ep+l, E);
+	}
+}
+
+//! Solve M = e sinh(H) - H in all lanes with the iterations of InitHyp(), from the initial guess in @em Hp.
+static void solveCometHyperbolicLanes(const double* ep, const double* Mp, double* Hp)
+{
+	for (int l=0;l<Lanes;l+=LaneWidth)
+	{
+		const LaneVec e = vLoad(ep+l);
+		const LaneVec M = vLoad(Mp+l);
+		LaneVec H = vLoad(Hp+l);
+		LaneMask done = vNoLane();
+		// InitHyp() has no limit, it usually converges in a few iterations.
+		for (int iter=0;iter<50;++iter)
+		{
+			LaneVec sh, ch;
+			vSinhCosh(H, sh, ch);
+			const LaneVec f2 = vMul(e, sh);
+			const LaneVec f = vSub(vSub(f2, H), M);
+			const LaneVec f1 = vSub(vMul(e, ch), vSet(1.0));
+			const LaneVec next = vAdd(H, vLaguerreConwayStep(f, f1, f2));
+			const LaneMask converged = vLt(vAbs(vSub(next, H)), vSet(EPSILON));
+			H = vSelect(done, H, next);
+			done = vOr(done, converged);
+			if (vAll(done))
+				break;
+		}
+		vStore(Hp+l, H);
+	}
+}
+
+//! The fixed iterations of EllipticalOrbit::eccentricAnomaly() for 0<e<0.2: E = M + e sin(E), 5 times.
+static void solveLowEccentricityLanes(const double* ep, const double* Mp, double* Ep)
+{
+	for (int l=0;l<Lanes;l+=LaneWidth)
+	{
+		const LaneVec e = vLoad(ep+l);
+		const LaneVec M = vLoad(Mp+l);
+		LaneVec E = M;
+		for (int iter=0;iter<5;++iter)
+		{
+			LaneVec s, c;
+			vSinCos(E, s, c);
+			E = vAdd(M, vMul(e, s));
+		}
+		vStore(Ep+l, E);
+	}
+}
+
+//! The fixed iterations of EllipticalOrbit::eccentricAnomaly() for 0.2<=e<0.9: 6 Newton iterations.
+static void solveMediumEccentricityLanes(const double* ep, const double* Mp, double* Ep)
+{
+	for (int l=0;l<Lanes;l+=LaneWidth)
+	{
+		const LaneVec e = vLoad(ep+l);
+		const LaneVec M = vLoad(Mp+l);
+		LaneVec E = M;
+		for (int iter=0;iter<6;++iter)
+		{
+			LaneVec s, c;
+			vSinCos(E, s, c);
+			E = vAdd(E, vDiv(vSub(vAdd(M, vMul(e, s)), E), vSub(vSet(1.0), vMul(e, c))));
+		}
+		vStore(Ep+l, E);
+	}
+}
+
+//! The fixed iterations of EllipticalOrbit::eccentricAnomaly() for 0.9<=e<1: 8 Laguerre-Conway iterations.
+static void solveHighEccentricityLanes(const double* ep, const double* Mp, double* Ep)
+{
+	for (int l=0;l<Lanes;l+=LaneWidth)
+	{
+		const LaneVec e = vLoad(ep+l);
+		const LaneVec M = vLoad(Mp+l);
+		LaneVec E = vEllipticGuess(e, M);
+		for (int iter=0;iter<8;++iter)
+		{
+			LaneVec s, c;
+			vSinCos(E, s, c);
+			s = vMul(e, s);
+			c = vMul(e, c);
+			E = vAdd(E, vLaguerreConwayStep(vSub(vSub(E, s), M), vSub(vSet(1.0), c), s));
+		}
+		vStore(Ep+l, E);
+	}
+}
+
+//! The fixed iterations of EllipticalOrbit::eccentricAnomaly() for e>1: 30 Laguerre-Conway iterations,
+//! from the initial guess in @em Hp.
+static void solveHyperbolicLanes(const double* ep, const double* Mp, double* Hp)
+{
+	for (int l=0;l<Lanes;l+=LaneWidth)
+	{
+		const LaneVec e = vLoad(ep+l);
+		const LaneVec M = vLoad(Mp+l);
+		LaneVec H = vLoad(Hp+l);
+		for (int iter=0;iter<30;++iter)
+		{
+			LaneVec sh, ch;
+			vSinhCosh(H, sh, ch);
+			sh = vMul(e, sh);
+			ch = vMul(e, ch);
+			H = vAdd(H, vLaguerreConwayStep(vSub(vSub(sh, H), M), vSub(ch, vSet(1.0)), sh));
+		}
+		vStore(Hp+l, H);
+	}
+}
+
+//! r*cos(nu) = a*(cos(E)-e) and r*sin(nu) = b*sin(E) for elliptic orbits.
+static void ellipticPlaneLanes(const double* ep, const double* Ep, const double* ap, const double* bp, double* rCosNu, double* rSinNu)
+{
+	for (int l=0;l<Lanes;l+=LaneWidth)
+	{
+		LaneVec s, c;
+		vSinCos(vLoad(Ep+l), s, c);
+		vStore(rCosNu+l, vMul(vLoad(ap+l), vSub(c, vLoad(ep+l))));
+		vStore(rSinNu+l, vMul(vLoad(bp+l), s));
+	}
+}
+
+//! r*cos(nu) = a*(e-cosh(H)) and r*sin(nu) = b*sinh(H) for hyperbolic orbits.
+static void hyperbolicPlaneLanes(const double* ep, const double* Hp, const double* ap, const double* bp, double* rCosNu, double* rSinNu)
+{
+	for (int l=0;l<Lanes;l+=LaneWidth)
+	{
+		LaneVec sh, ch;
+		vSinhCosh(vLoad(Hp+l), sh, ch);
+		vStore(rCosNu+l, vMul(vLoad(ap+l), vSub(vLoad(ep+l), ch)));
+		vStore(rSinNu+l, vMul(vLoad(bp+l), sh));
+	}
+}
+
+KeplerBatch::KeplerBatch()
+{
+	for (int k=0;k<=NrOfKinds;++k)
+		groupStart[k] = 0;
+}
+
+int KeplerBatch::appendElements(Kind k, double q, double e, double n, double t0, double m0,
+				double a, double b, const double p[3], const double qv[3])
+{
+	kind.append((quint8)k);
+	pericenterDistance.append(q);
+	eccentricity.append(e);
+	meanMotion.append(n);
+	epoch.append(t0);
+	meanAnomalyAtEpoch.append(m0);
+	semiMajorAxis.append(a);
+	semiMinorAxis.append(b);
+	px.append(p[0]); py.append(p[1]); pz.append(p[2]);
+	qx.append(qv[0]); qy.append(qv[1]); qz.append(qv[2]);
+	return kind.size()-1;
+}
+
+// Rotate the vector v of the orbital plane to the VSOP87 frame.
+static void rotateVector(const double* rot, const double v[3], double result[3])
+{
+	result[0] = rot[0]*v[0] + rot[1]*v[1] + rot[2]*v[2];
+	result[1] = rot[3]*v[0] + rot[4]*v[1] + rot[5]*v[2];
+	result[2] = rot[6]*v[0] + rot[7]*v[1] + rot[8]*v[2];
+}
+
+int KeplerBatch::append(const CometOrbit& orbit)
+{
+	const double e = orbit.e;
+	const double q = orbit.q;
+	// Same as Init3D() in Orbit.cpp
+	const double cw = std::cos(orbit.w);
+	const double sw = std::sin(orbit.w);
+	const double cOm = std::cos(orbit.Om);
+	const double sOm = std::sin(orbit.Om);
+	const double ci = std::cos(orbit.i);
+	const double si = std::sin(orbit.i);
+	const double p[3] = {-sw*sOm*ci+cw*cOm, sw*cOm*ci+cw*sOm, sw*si};
+	const double qv[3] = {-cw*sOm*ci-sw*cOm, cw*cOm*ci-sw*sOm, cw*si};
+	double pRot[3], qRot[3];
+	rotateVector(orbit.rotateToVsop87, p, pRot);
+	rotateVector(orbit.rotateToVsop87, qv, qRot);
+
+	if (e<1.0)
+		return appendElements(CometElliptic, q, e, orbit.n, orbit.t0, 0., q/(1.0-e), q*std::sqrt((1.0+e)/(1.0-e)), pRot, qRot);
+	if (e>1.0)
+	{
+		const double a = q/(e-1.0);
+		return appendElements(CometHyperbolic, q, e, orbit.n, orbit.t0, 0., a, a*std::sqrt(e*e-1.0), pRot, qRot);
+	}
+	return appendElements(CometParabolic, q, e, orbit.n, orbit.t0, 0., 0., 0., pRot, qRot);
+}
+
+int KeplerBatch::append(const EllipticalOrbit& orbit)
+{
+	const double e = orbit.eccentricity;
+	const double q = orbit.pericenterDistance;
+	// Same as EllipticalOrbit::positionAtE(), which puts the orbit in the (x, -z) plane.
+	const Mat4d R = Mat4d::zrotation(orbit.ascendingNode) * Mat4d::xrotation(orbit.inclination) * Mat4d::zrotation(orbit.argOfPeriapsis);
+	const Vec3d pv = R * Vec3d(1., 0., 0.);
+	const Vec3d qvv = R * Vec3d(0., 1., 0.);
+	const double p[3] = {pv[0], pv[1], pv[2]};
+	const double qv[3] = {qvv[0], qvv[1], qvv[2]};
+	double pRot[3], qRot[3];
+	rotateVector(orbit.rotateToVsop87, p, pRot);
+	rotateVector(orbit.rotateToVsop87, qv, qRot);
+
+	// Same choice of the iterations as EllipticalOrbit::eccentricAnomaly()
+	const double n = 2.0*M_PI/orbit.period;
+	if (e<1.0)
+	{
+		const double a = q/(1.0-e);
+		const Kind k = e==0.0 ? Circular : (e<0.2 ? LowEccentricity : (e<0.9 ? MediumEccentricity : HighEccentricity));
+		return appendElements(k, q, e, n, orbit.epoch, orbit.meanAnomalyAtEpoch, a, a*std::sqrt(1-e*e), pRot, qRot);
+	}
+	if (e>1.0)
+	{
+		const double a = -(q/(1.0-e));
+		return appendElements(Hyperbolic, q, e, n, orbit.epoch, orbit.meanAnomalyAtEpoch, a, a*std::sqrt(e*e-1), pRot, qRot);
+	}
+	// EllipticalOrbit does not handle parabolic orbits and stays at the center.
+	const double zero[3] = {0., 0., 0.};
+	return appendElements(Degenerate, q, e, n, orbit.epoch, orbit.meanAnomalyAtEpoch, 0., 0., zero, zero);
+}
+
+void KeplerBatch::clear()
+{
+	*this = KeplerBatch();
+}
+
+void KeplerBatch::computePositions(double jde, double* xyz)
+{
+	groupRequests(Q_NULLPTR, size(), &jde, 0);
+	computeGroups(xyz);
+}
+
+void KeplerBatch::computePositions(const int* indices, int count, const double* jde, double* xyz)
+{
+	groupRequests(indices, count, jde, 1);
+	computeGroups(xyz);
+}
+
+void KeplerBatch::groupRequests(const int* indices, int count, const double* jde, int jdeStride)
+{
+	// Counting sort of the requests by kind, so that all lanes of a block solve the same equation.
+	for (int k=0;k<=NrOfKinds;++k)
+		groupStart[k] = 0;
+	for (int r=0;r<count;++r)
+		++groupStart[kind[indices ? indices[r] : r]+1];
+	for (int k=0;k<NrOfKinds;++k)
+		groupStart[k+1] += groupStart[k];
+	groupIndices.resize(count);
+	groupDates.resize(count);
+	groupSlots.resize(count);
+	int next[NrOfKinds];
+	for (int k=0;k<NrOfKinds;++k)
+		next[k] = groupStart[k];
+	for (int r=0;r<count;++r)
+	{
+		const int i = indices ? indices[r] : r;
+		const int g = next[kind[i]]++;
+		groupIndices[g] = i;
+		groupDates[g] = jde[r*jdeStride];
+		groupSlots[g] = r;
+	}
+}
+
+void KeplerBatch::computeGroups(double* xyz) const
+{
+	for (int k=0;k<NrOfKinds;++k)
+	{
+		const int first = groupStart[k];
+		if (groupStart[k+1]>first)
+			computeKind((Kind)k, groupIndices.constData()+first, groupStart[k+1]-first,
+				    groupDates.constData()+first, groupSlots.constData()+first, xyz);
+	}
+}
+
+void KeplerBatch::computeKind(Kind k, const int* indices, int count, const double* jde, const int* slots, double* xyz) const
+{
+	for (int first=0;first<count;first+=Lanes)
+	{
+		const int nb = qMin(Lanes, count-first);
+		double e[Lanes], m[Lanes], a[Lanes], b[Lanes], x[Lanes], rCosNu[Lanes], rSinNu[Lanes];
+		// The unused lanes of the last block repeat its last orbit.
+		for (int l=0;l<Lanes;++l)
+		{
+			const int j = first+qMin(l, nb-1);
+			const int i = indices[j];
+			e[l] = eccentricity[i];
+			m[l] = meanAnomalyAtEpoch[i]+(jde[j]-epoch[i])*meanMotion[i];
+			a[l] = semiMajorAxis[i];
+			b[l] = semiMinorAxis[i];
+		}
+
+		// The closed forms and the initial guesses which need libm are computed once per orbit,
+		// the iterations are done on whole registers.
+		switch (k)
+		{
+			case CometElliptic:
+				for (int l=0;l<Lanes;++l)
+				{
+					m[l] = std::fmod(m[l], 2*M_PI);
+					if (m[l]<0.0)
+						m[l] += 2.0*M_PI;
+				}
+				solveCometEllipticLanes(e, m, x);
+				ellipticPlaneLanes(e, x, a, b, rCosNu, rSinNu);
+				break;
+			case CometHyperbolic:
+				for (int l=0;l<Lanes;++l)
+					x[l] = StelUtils::sign(m[l])*std::log(2.0*std::fabs(m[l])/e[l]+1.85);
+				solveCometHyperbolicLanes(e, m, x);
+				hyperbolicPlaneLanes(e, x, a, b, rCosNu, rSinNu);
+				break;
+			case CometParabolic:
+				// Same as InitPar() in Orbit.cpp, m is W.
+				for (int l=0;l<Lanes;++l)
+				{
+					const double q = pericenterDistance[indices[first+qMin(l, nb-1)]];
+					const double Y = cbrt(m[l]+std::sqrt(m[l]*m[l]+1.));
+					const double tanNu2 = Y-1.0/Y;
+					rCosNu[l] = q*(1.0-tanNu2*tanNu2);
+					rSinNu[l] = 2.0*q*tanNu2;
+				}
+				break;
+			case Circular:
+				ellipticPlaneLanes(e, m, a, b, rCosNu, rSinNu);
+				break;
+			case LowEccentricity:
+				solveLowEccentricityLanes(e, m, x);
+				ellipticPlaneLanes(e, x, a, b, rCosNu, rSinNu);
+				break;
+			case MediumEccentricity:
+				solveMediumEccentricityLanes(e, m, x);
+				ellipticPlaneLanes(e, x, a, b, rCosNu, rSinNu);
+				break;
+			case HighEccentricity:
+				solveHighEccentricityLanes(e, m, x);
+				ellipticPlaneLanes(e, x, a, b, rCosNu, rSinNu);
+				break;
+			case Hyperbolic:
+				for (int l=0;l<Lanes;++l)
+					x[l] = std::log(2*m[l]/e[l]+1.85);
+				solveHyperbolicLanes(e, m, x);
+				hyperbolicPlaneLanes(e, x, a, b, rCosNu, rSinNu);
+				break;
+			case Degenerate:
+			default:
+				for (int l=0;l<Lanes;++l)
+				{
+					rCosNu[l] = 0.;
+					rSinNu[l] = 0.;
+				}
+				break;
+		}
+
+		for (int l=0;l<nb;++l)
+		{
+			const int i = indices[first+l];
+			double* v = xyz+3*slots[first+l];
+			v[0] = px[i]*rCosNu[l] + qx[i]*rSinNu[l];
+			v[1] = py[i]*rCosNu[l] + qy[i]*rSinNu[l];
+			v[2] = pz[i]*rCosNu[l] + qz[i]*rSinNu[l];
+		}
+	}
+}
@@ -0,0 +1,125 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _KEPLERBATCH_HPP_
+#define _KEPLERBATCH_HPP_
+
+#include <QVector>
+
+class CometOrbit;
+class EllipticalOrbit;
+
+//! @class KeplerBatch
+//! Computes the positions of many CometOrbit and EllipticalOrbit at once.
+//! The elements of the orbits are kept in one array per element. The orbital plane vectors are
+//! computed once, with the rotation to the VSOP87 frame included, so that a position only costs
+//! the solution of Kepler's equation. The orbits are grouped by the way their class solves the
+//! equation, and each group is solved in blocks of Lanes orbits with branch-free arithmetic,
+//! using SSE2 where available. The lanes of a CometOrbit block stop at the iteration where
+//! CometOrbit stops, the finished lanes are masked until all of them stopped. EllipticalOrbit
+//! does a fixed number of iterations which depends on the eccentricity, the lanes do the same.
+//! The sine, cosine and exponential of the lanes are computed by polynomials which agree with
+//! libm to a few ulp, so the results are those of positionAtTimevInVSOP87Coordinates() of the
+//! orbits up to rounding errors. The velocity of the comets is not computed.
+//! The buffers of computePositions() are kept between calls, so a KeplerBatch must not be used
+//! by several threads at once.
+class KeplerBatch
+{
+public:
+	//! Number of orbits solved together.
+	static const int Lanes = 4;
+
+	KeplerBatch();
+
+	//! Add an orbit and return its index. The orbit object is not used anymore after the call.
+	int append(const CometOrbit& orbit);
+	int append(const EllipticalOrbit& orbit);
+	//! Remove all orbits.
+	void clear();
+	int size() const {return kind.size();}
+
+	//! Compute the positions of all orbits at the date @em jde, and store them in @em xyz,
+	//! 3 values per orbit, in the order of the orbits.
+	void computePositions(double jde, double* xyz);
+	//! Compute the positions of the @em count orbits of given @em indices, the orbit @em indices[k]
+	//! at the date @em jde[k], and store them in @em xyz[3*k..3*k+2].
+	void computePositions(const int* indices, int count, const double* jde, double* xyz);
+
+private:
+	//! How the position of an orbit is computed.
+	enum Kind
+	{
+		//! CometOrbit: Laguerre-Conway iterations until convergence, see InitEll() in Orbit.cpp
+		CometElliptic,
+		//! CometOrbit: closed form of InitPar()
+		CometParabolic,
+		//! CometOrbit: Laguerre-Conway iterations until convergence, see InitHyp()
+		CometHyperbolic,
+		//! EllipticalOrbit with e=0: the eccentric anomaly is the mean anomaly
+		Circular,
+		//! EllipticalOrbit with e<0.2: 5 iterations E = M + e sin(E)
+		LowEccentricity,
+		//! EllipticalOrbit with e<0.9: 6 Newton iterations
+		MediumEccentricity,
+		//! EllipticalOrbit with e<1: 8 Laguerre-Conway iterations
+		HighEccentricity,
+		//! EllipticalOrbit with e=1, which stays at the center
+		Degenerate,
+		//! EllipticalOrbit with e>1: 30 Laguerre-Conway iterations
+		Hyperbolic,
+		NrOfKinds
+	};
+
+	//! Append the elements shared by all kinds. @em p and @em q are the unit vectors of the
+	//! orbital plane in the direction of the pericenter and 90 degrees further, in VSOP87 frame.
+	int appendElements(Kind k, double pericenterDistance, double eccentricity, double meanMotion, double epoch,
+			   double meanAnomalyAtEpoch, double semiMajorAxis, double semiMinorAxis, const double p[3], const double q[3]);
+	//! Sort the requested orbits by kind into the group buffers. The orbit k is @em indices[k],
+	//! or k when @em indices is null, at the date @em jde[k*jdeStride].
+	void groupRequests(const int* indices, int count, const double* jde, int jdeStride);
+	//! Solve the groups filled by groupRequests().
+	void computeGroups(double* xyz) const;
+	//! Solve the blocks of orbits of one kind.
+	void computeKind(Kind k, const int* indices, int count, const double* jde, const int* slots, double* xyz) const;
+
+	QVector<quint8> kind;
+	QVector<double> pericenterDistance;
+	QVector<double> eccentricity;
+	//! rad/day, W/dt for parabolic orbits
+	QVector<double> meanMotion;
+	//! JDE of the pericenter of a CometOrbit, epoch of the mean anomaly of an EllipticalOrbit
+	QVector<double> epoch;
+	//! 0 for a CometOrbit
+	QVector<double> meanAnomalyAtEpoch;
+	//! |a| and the semi-minor axis b = a*sqrt(|1-e*e|), for the elliptic and hyperbolic orbits
+	QVector<double> semiMajorAxis;
+	QVector<double> semiMinorAxis;
+	QVector<double> px, py, pz;
+	QVector<double> qx, qy, qz;
+
+	//! Requests of computePositions(): orbit, date and output slot, grouped by kind.
+	//! They keep their capacity between calls.
+	QVector<int> groupIndices;
+	QVector<double> groupDates;
+	QVector<int> groupSlots;
+	//! Number of requests of each kind, then their first position in the groups.
+	int groupStart[NrOfKinds+1];
+};
+
+#endif // _KEPLERBATCH_HPP_
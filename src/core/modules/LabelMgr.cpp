@@ -411,7 +411,7 @@ int LabelMgr::labelObject(const QString& text,
 {
 	QFont font;
 	font.setPixelSize(fontSize);
-	StelObjectP obj = GETSTELMODULE(StelObjectMgr)->searchByName(objectName);
+	StelObjectP obj = GETSTELMODULE(StelObjectMgr)->materializeByName(objectName);
 	if (!obj)
 	{
 		qWarning() << "LabelMgr::labelObject object not found: " << objectName;
@@ -0,0 +1,347 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "MinorBodyCatalog.hpp"
+#include "Orbit.hpp"
+
+#include <QHash>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+MinorBodyCatalog::Body::Body()
+	: minorPlanetNumber(0)
+	, pericenterDistance(0.)
+	, eccentricity(0.)
+	, inclination(0.)
+	, ascendingNode(0.)
+	, argOfPericenter(0.)
+	, timeAtPericenter(0.)
+	, meanMotion(0.)
+	, orbitGoodDays(0.)
+	, orbitVisualizationPeriod(0.)
+	, absoluteMagnitude(-99.f)
+	, slopeParameter(0.15f)
+	, albedo(0.25f)
+	, radius(1.f)
+	, colorIndexBV(99.f)
+{
+}
+
+MinorBodyCatalog::MinorBodyCatalog()
+	: nrOfIndexedBodies(0)
+{
+}
+
+void MinorBodyCatalog::clear()
+{
+	*this = MinorBodyCatalog();
+}
+
+int MinorBodyCatalog::append(const Body& body)
+{
+	int type = types.indexOf(body.type);
+	if (type<0)
+	{
+		Q_ASSERT(types.size()<256);
+		type = types.size();
+		types.append(body.type);
+	}
+
+	pericenterDistance.append(body.pericenterDistance);
+	eccentricity.append(body.eccentricity);
+	timeAtPericenter.append(body.timeAtPericenter);
+	meanMotion.append(body.meanMotion);
+	inclination.append(body.inclination);
+	ascendingNode.append(body.ascendingNode);
+	argOfPericenter.append(body.argOfPericenter);
+	orbitGoodDays.append(body.orbitGoodDays);
+	orbitVisualizationPeriod.append(body.orbitVisualizationPeriod);
+	absoluteMagnitude.append(body.absoluteMagnitude);
+	slopeParameter.append(body.slopeParameter);
+	albedo.append(body.albedo);
+	radius.append(body.radius);
+	colorIndexBV.append(body.colorIndexBV);
+	minorPlanetNumber.append(body.minorPlanetNumber);
+	typeIndex.append((quint8)type);
+	flags.append(0);
+	// Unknown until the first call to updateApproxPositions().
+	posX.append(0.f);
+	posY.append(0.f);
+	posZ.append(0.f);
+
+	nameOffsets.append(strings.size());
+	strings.append(body.englishName.toUtf8());
+	strings.append('\0');
+	strings.append(body.provisionalDesignation.toUtf8());
+	strings.append('\0');
+	return nameOffsets.size()-1;
+}
+
+void MinorBodyCatalog::squeeze()
+{
+	pericenterDistance.squeeze();
+	eccentricity.squeeze();
+	timeAtPericenter.squeeze();
+	meanMotion.squeeze();
+	inclination.squeeze();
+	ascendingNode.squeeze();
+	argOfPericenter.squeeze();
+	orbitGoodDays.squeeze();
+	orbitVisualizationPeriod.squeeze();
+	absoluteMagnitude.squeeze();
+	slopeParameter.squeeze();
+	albedo.squeeze();
+	radius.squeeze();
+	colorIndexBV.squeeze();
+	minorPlanetNumber.squeeze();
+	typeIndex.squeeze();
+	flags.squeeze();
+	posX.squeeze();
+	posY.squeeze();
+	posZ.squeeze();
+	strings.squeeze();
+	nameOffsets.squeeze();
+
+	nameIndex.reserve(size());
+	for (int i=nrOfIndexedBodies;i<size();++i)
+		nameIndex.append(nameKey(getEnglishName(i), i));
+	std::sort(nameIndex.begin(), nameIndex.end());
+
+	// Sort the new bodies and merge them with the sorted old ones.
+	listedNameOrder.reserve(size());
+	for (int i=nrOfIndexedBodies;i<size();++i)
+		listedNameOrder.append((quint32)i);
+	const ListedNameLess less(*this);
+	QVector<quint32>::iterator middle = listedNameOrder.begin()+nrOfIndexedBodies;
+	std::sort(middle, listedNameOrder.end(), less);
+	std::inplace_merge(listedNameOrder.begin(), middle, listedNameOrder.end(), less);
+	nrOfIndexedBodies = size();
+}
+
+//! Order of the bodies in listedNameOrder.
+struct ListedNameLess
+{
+	ListedNameLess(const MinorBodyCatalog& c) : catalog(c) {}
+	bool operator()(quint32 a, quint32 b) const
+	{
+		char keyA[MinorBodyCatalog::ListedKeySize], keyB[MinorBodyCatalog::ListedKeySize];
+		catalog.listedKey(a, keyA);
+		catalog.listedKey(b, keyB);
+		return std::strcmp(keyA, keyB)<0;
+	}
+	const MinorBodyCatalog& catalog;
+};
+
+//! Compare a body of listedNameOrder with a folded prefix, for the lower bound of the bodies starting with it.
+struct ListedNameBefore
+{
+	ListedNameBefore(const MinorBodyCatalog& c) : catalog(c) {}
+	bool operator()(quint32 a, const QByteArray& prefix) const
+	{
+		char key[MinorBodyCatalog::ListedKeySize];
+		catalog.listedKey(a, key);
+		return std::strcmp(key, prefix.constData())<0;
+	}
+	const MinorBodyCatalog& catalog;
+};
+
+int MinorBodyCatalog::listedKey(int index, char* buf) const
+{
+	int n = 0;
+	const int number = minorPlanetNumber[index];
+	if (number)
+	{
+		char digits[12];
+		int nrOfDigits = 0;
+		for (unsigned int d=number;d;d/=10)
+			digits[nrOfDigits++] = '0'+d%10;
+		buf[n++] = '(';
+		while (nrOfDigits)
+			buf[n++] = digits[--nrOfDigits];
+		buf[n++] = ')';
+		buf[n++] = ' ';
+	}
+	for (const char* c=nameData(index);*c && n<ListedKeySize-1;++c)
+		buf[n++] = (*c>='A' && *c<='Z') ? *c-'A'+'a' : *c;
+	buf[n] = '\0';
+	return n;
+}
+
+quint64 MinorBodyCatalog::nameKey(const QString& englishName, int index)
+{
+	return ((quint64)qHash(englishName) << 32) | (quint32)index;
+}
+
+MinorBodyCatalog::Body MinorBodyCatalog::getBody(int index) const
+{
+	Q_ASSERT(index>=0 && index<size());
+	Body body;
+	const char* name = nameData(index);
+	body.englishName = QString::fromUtf8(name);
+	body.provisionalDesignation = QString::fromUtf8(name+std::strlen(name)+1);
+	body.type = types.at(typeIndex[index]);
+	body.minorPlanetNumber = minorPlanetNumber[index];
+	body.pericenterDistance = pericenterDistance[index];
+	body.eccentricity = eccentricity[index];
+	body.inclination = inclination[index];
+	body.ascendingNode = ascendingNode[index];
+	body.argOfPericenter = argOfPericenter[index];
+	body.timeAtPericenter = timeAtPericenter[index];
+	body.meanMotion = meanMotion[index];
+	body.orbitGoodDays = orbitGoodDays[index];
+	body.orbitVisualizationPeriod = orbitVisualizationPeriod[index];
+	body.absoluteMagnitude = absoluteMagnitude[index];
+	body.slopeParameter = slopeParameter[index];
+	body.albedo = albedo[index];
+	body.radius = radius[index];
+	body.colorIndexBV = colorIndexBV[index];
+	return body;
+}
+
+QString MinorBodyCatalog::getEnglishName(int index) const
+{
+	return QString::fromUtf8(nameData(index));
+}
+
+int MinorBodyCatalog::indexOf(const QString& englishName) const
+{
+	const QByteArray name = englishName.toUtf8();
+	const quint64 key = nameKey(englishName, 0);
+	QVector<quint64>::const_iterator it = std::lower_bound(nameIndex.constBegin(), nameIndex.constEnd(), key);
+	for (;it!=nameIndex.constEnd() && (*it>>32)==(key>>32);++it)
+	{
+		const int i = (int)(*it & 0xffffffff);
+		if (!isRemoved(i) && name==nameData(i))
+			return i;
+	}
+	for (int i=nrOfIndexedBodies;i<size();++i)
+	{
+		if (!isRemoved(i) && name==nameData(i))
+			return i;
+	}
+	return -1;
+}
+
+QString MinorBodyCatalog::getListedName(int index) const
+{
+	const int number = minorPlanetNumber[index];
+	if (number)
+		return QString("(%1) %2").arg(number).arg(getEnglishName(index));
+	return getEnglishName(index);
+}
+
+void MinorBodyCatalog::findNames(const QString& text, bool startOnly, int maxCount, QVector<int>& result) const
+{
+	if (maxCount<=0)
+		return;
+	bool ascii = true;
+	foreach (const QChar& c, text)
+		ascii = ascii && c.unicode()<128;
+	if (!ascii)
+	{
+		// The keys only fold the ASCII letters, compare the names themselves.
+		for (int i=0;i<size() && maxCount>0;++i)
+		{
+			if (!isListed(i))
+				continue;
+			const QString name = getListedName(i);
+			if (startOnly ? name.startsWith(text, Qt::CaseInsensitive) : name.contains(text, Qt::CaseInsensitive))
+			{
+				result.append(i);
+				--maxCount;
+			}
+		}
+		return;
+	}
+
+	const QByteArray folded = text.toLower().toLatin1();
+	char key[ListedKeySize];
+	int first = 0;
+	if (startOnly)
+	{
+		QVector<quint32>::const_iterator it = std::lower_bound(listedNameOrder.constBegin(), listedNameOrder.constEnd(),
+									folded, ListedNameBefore(*this));
+		for (;it!=listedNameOrder.constEnd() && maxCount>0;++it)
+		{
+			listedKey(*it, key);
+			if (std::strncmp(key, folded.constData(), folded.size())!=0)
+				break;
+			if (isListed(*it))
+			{
+				result.append(*it);
+				--maxCount;
+			}
+		}
+		// Bodies appended since the last squeeze()
+		first = nrOfIndexedBodies;
+	}
+	for (int i=first;i<size() && maxCount>0;++i)
+	{
+		if (!isListed(i))
+			continue;
+		listedKey(i, key);
+		if (startOnly ? std::strncmp(key, folded.constData(), folded.size())==0 : std::strstr(key, folded.constData())!=Q_NULLPTR)
+		{
+			result.append(i);
+			--maxCount;
+		}
+	}
+}
+
+void MinorBodyCatalog::computePosition(int index, double jde, double xyz[3]) const
+{
+	// The parent of all bodies of the catalog is the Sun, so that no rotation is needed.
+	CometOrbit orbit(pericenterDistance[index], eccentricity[index], inclination[index], ascendingNode[index],
+			 argOfPericenter[index], timeAtPericenter[index], orbitGoodDays[index], meanMotion[index], 0., 0., 0.);
+	orbit.positionAtTimevInVSOP87Coordinates(jde, xyz, false);
+}
+
+void MinorBodyCatalog::updateApproxPositions(int first, int count, double jde)
+{
+	const int last = qMin(first+count, size());
+	for (int i=first;i<last;++i)
+	{
+		double xyz[3];
+		computePosition(i, jde, xyz);
+		posX[i] = (float)xyz[0];
+		posY[i] = (float)xyz[1];
+		posZ[i] = (float)xyz[2];
+	}
+}
+
+float MinorBodyCatalog::estimateMagnitude(int index, const Vec3d& observerPos) const
+{
+	const Vec3d pos = getApproxPosition(index);
+	const double r2 = pos.lengthSquared();
+	const double delta2 = (pos-observerPos).lengthSquared();
+	// Without H, derive it from the size and albedo (Bowell et al. 1989).
+	float h = absoluteMagnitude[index];
+	if (h<-90.f)
+		h = 5.f*std::log10(1329.f/(2.f*radius[index]*std::sqrt(albedo[index])));
+	// Same as MinorPlanet::getVMagnitude() at a phase angle of 0.
+	return h + 5.f*(float)std::log10(std::sqrt(r2*delta2));
+}
+
+qint64 MinorBodyCatalog::getMemoryUsage() const
+{
+	const qint64 n = size();
+	return n*(7*sizeof(double) + 10*sizeof(float) + sizeof(int) + 2*sizeof(quint8) + sizeof(quint32))
+		+ nameIndex.size()*sizeof(quint64) + listedNameOrder.size()*sizeof(quint32) + strings.size();
+}
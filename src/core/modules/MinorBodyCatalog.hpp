@@ -0,0 +1,171 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _MINORBODYCATALOG_HPP_
+#define _MINORBODYCATALOG_HPP_
+
+#include "VecMath.hpp"
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+//! @class MinorBodyCatalog
+//! Compact storage of the orbital elements of a large number of minor bodies on heliocentric
+//! Keplerian orbits. The elements are kept in one array per element ("structure of arrays"),
+//! the names in a single UTF-8 buffer, so that a body costs about 150 bytes instead of the
+//! tens of kilobytes of a MinorPlanet object with its textures, faders and orbit points.
+//! SolarSystem creates MinorPlanet objects from the catalog only for the bodies which have
+//! to be displayed, selected or searched.
+//! The catalog also keeps an approximate position per body, in single precision, which is
+//! used to decide which bodies may be visible.
+class MinorBodyCatalog
+{
+public:
+	//! All data of one body, as read from ssystem_minor.ini.
+	struct Body
+	{
+		Body();
+		QString englishName;
+		QString provisionalDesignation;
+		QString type;
+		int minorPlanetNumber;
+		double pericenterDistance;	//!< AU
+		double eccentricity;
+		double inclination;		//!< radians
+		double ascendingNode;		//!< radians
+		double argOfPericenter;		//!< radians
+		double timeAtPericenter;	//!< JDE
+		double meanMotion;		//!< radians/day, W/dt for parabolic orbits
+		double orbitGoodDays;
+		double orbitVisualizationPeriod;	//!< days
+		float absoluteMagnitude;
+		float slopeParameter;
+		float albedo;
+		float radius;			//!< km
+		float colorIndexBV;		//!< 99 when unknown
+	};
+
+	MinorBodyCatalog();
+
+	//! Remove all bodies and release the memory.
+	void clear();
+	//! Add a body and return its index. The name index is updated by squeeze().
+	int append(const Body& body);
+	//! Release the spare capacity of the arrays and sort the name index.
+	//! Call it once all bodies of a file have been appended.
+	void squeeze();
+
+	//! Number of bodies, removed bodies included.
+	int size() const {return nameOffsets.size();}
+	//! Get all data of a body.
+	Body getBody(int index) const;
+	QString getEnglishName(int index) const;
+	int getMinorPlanetNumber(int index) const {return minorPlanetNumber[index];}
+	QString getType(int index) const {return types.at(typeIndex[index]);}
+	//! Get the index of the body with the given english name, or -1.
+	//! Removed bodies are not found.
+	int indexOf(const QString& englishName) const;
+	//! Get the name of a body as listed by SolarSystem, i.e. as returned by MinorPlanet::getEnglishName():
+	//! "(number) name" for a numbered body, else the name.
+	QString getListedName(int index) const;
+	//! Find the bodies whose listed name starts with (@em startOnly) or contains @em text, ignoring the case.
+	//! The prefix search uses a sorted index, and returns the bodies by order of listed name.
+	//! No string is allocated per body. Removed and materialized bodies are skipped.
+	//! @param maxCount stop after this number of bodies
+	//! @param result receives the indices of the bodies
+	void findNames(const QString& text, bool startOnly, int maxCount, QVector<int>& result) const;
+
+	//! A removed body is kept in the arrays, but is not found or listed anymore.
+	void setRemoved(int index) {flags[index] |= Removed;}
+	bool isRemoved(int index) const {return flags[index] & Removed;}
+	//! A materialized body has a MinorPlanet object in SolarSystem.
+	void setMaterialized(int index, bool b) {if (b) flags[index] |= Materialized; else flags[index] &= ~Materialized;}
+	bool isMaterialized(int index) const {return flags[index] & Materialized;}
+
+	//! Compute the heliocentric position of a body in the VSOP87 frame, with the same code as the CometOrbit used by a MinorPlanet.
+	void computePosition(int index, double jde, double xyz[3]) const;
+	//! Update the approximate positions of the @em count bodies from @em first at the date @em jde.
+	void updateApproxPositions(int first, int count, double jde);
+	//! Get the last approximate position of a body, in the VSOP87 frame.
+	Vec3d getApproxPosition(int index) const {return Vec3d(posX[index], posY[index], posZ[index]);}
+	//! Estimate the visual magnitude of a body from its approximate position, for an observer at
+	//! @em observerPos (heliocentric, VSOP87 frame). The phase angle is ignored, so that the estimate
+	//! is never fainter than the magnitude computed by MinorPlanet.
+	float estimateMagnitude(int index, const Vec3d& observerPos) const;
+
+	//! Get the number of bytes used by the catalog.
+	qint64 getMemoryUsage() const;
+
+private:
+	enum Flag
+	{
+		Removed		= 0x01,
+		Materialized	= 0x02
+	};
+
+	//! Key of the name index: hash in the high 32 bits, index in the low 32 bits.
+	static quint64 nameKey(const QString& englishName, int index);
+	const char* nameData(int index) const {return strings.constData()+nameOffsets[index];}
+	//! Size of the buffers of listedKey(), longer names are truncated.
+	static const int ListedKeySize = 256;
+	//! Write the listed name of a body in @em buf, with the ASCII letters in lower case,
+	//! and return its length. The key is null-terminated.
+	int listedKey(int index, char* buf) const;
+	//! Whether a body is returned by findNames().
+	bool isListed(int index) const {return !(flags[index] & (Removed|Materialized));}
+	friend struct ListedNameLess;
+	friend struct ListedNameBefore;
+
+	// Orbital elements
+	QVector<double> pericenterDistance;
+	QVector<double> eccentricity;
+	QVector<double> timeAtPericenter;
+	QVector<double> meanMotion;
+	QVector<double> inclination;
+	QVector<double> ascendingNode;
+	QVector<double> argOfPericenter;
+	QVector<float> orbitGoodDays;
+	QVector<float> orbitVisualizationPeriod;
+	// Physical data
+	QVector<float> absoluteMagnitude;
+	QVector<float> slopeParameter;
+	QVector<float> albedo;
+	QVector<float> radius;
+	QVector<float> colorIndexBV;
+	QVector<int> minorPlanetNumber;
+	QVector<quint8> typeIndex;
+	QVector<quint8> flags;
+	//! Approximate positions
+	QVector<float> posX, posY, posZ;
+
+	//! "name\0designation\0" of all bodies, UTF-8 encoded
+	QByteArray strings;
+	QVector<quint32> nameOffsets;
+	QStringList types;
+	//! Sorted keys of the bodies appended before the last squeeze()
+	QVector<quint64> nameIndex;
+	//! Indices of the bodies appended before the last squeeze(), sorted by listedKey()
+	QVector<quint32> listedNameOrder;
+	//! Number of bodies in nameIndex and listedNameOrder, the later ones are searched linearly
+	int nrOfIndexedBodies;
+};
+
+#endif // _MINORBODYCATALOG_HPP_
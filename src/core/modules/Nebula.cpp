@@ -897,24 +897,34 @@ void Nebula::readDSO(QDataStream &in)
 		>> NGC_nb >> IC_nb >> M_nb >> C_nb >> B_nb >> Sh2_nb >> VdB_nb >> RCW_nb >> LDN_nb >> LBN_nb >> Cr_nb
 		>> Mel_nb >> PGC_nb >> UGC_nb >> Ced_nb >> Arp_nb >> VV_nb >> PK_nb >> PNG_nb >> SNRG_nb >> ACO_nb;
 
+	StelUtils::spheToRect(ra,dec,XYZ);
+	Q_ASSERT(fabs(XYZ.lengthSquared()-1.)<0.000000001);
+	setupRecord(oType);
+}
+
+void Nebula::setupRecord(unsigned int oType)
+{
 	int f = NGC_nb + IC_nb + M_nb + C_nb + B_nb + Sh2_nb + VdB_nb + RCW_nb + LDN_nb + LBN_nb + Cr_nb + Mel_nb + PGC_nb + UGC_nb + Arp_nb + VV_nb;
 	if (f==0 && Ced_nb.isEmpty() && PK_nb.isEmpty() && PNG_nb.isEmpty() && SNRG_nb.isEmpty() && ACO_nb.isEmpty())
 		withoutID = true;
 
-	StelUtils::spheToRect(ra,dec,XYZ);
-	Q_ASSERT(fabs(XYZ.lengthSquared()-1.)<0.000000001);
 	nType = (Nebula::NebulaType)oType;
 	pointRegion = SphericalRegionP(new SphericalPoint(getJ2000EquatorialPos(Q_NULLPTR)));
 }
 
 bool Nebula::objectInDisplayedType() const
+{
+	return isTypeDisplayed(nType);
+}
+
+bool Nebula::isTypeDisplayed(NebulaType type)
 {
 	if (!flagUseTypeFilters)
 		return true;
 
 	bool r = false;
 	int cntype = -1;
-	switch (nType)
+	switch (type)
 	{
 		case NebGx:
 			cntype = 0; // Galaxies
@@ -1002,55 +1012,61 @@ bool Nebula::objectInDisplayedType() const
 
 bool Nebula::objectInDisplayedCatalog() const
 {
-	bool r = false;
-	if ((catalogFilters&CatM) && (M_nb>0))
-		r = true;
-	else if ((catalogFilters&CatC) && (C_nb>0))
-		r = true;
-	else if ((catalogFilters&CatNGC) && (NGC_nb>0))
-		r = true;
-	else if ((catalogFilters&CatIC) && (IC_nb>0))
-		r = true;
-	else if ((catalogFilters&CatB) && (B_nb>0))
-		r = true;
-	else if ((catalogFilters&CatSh2) && (Sh2_nb>0))
-		r = true;
-	else if ((catalogFilters&CatVdB) && (VdB_nb>0))
-		r = true;
-	else if ((catalogFilters&CatRCW) && (RCW_nb>0))
-		r = true;
-	else if ((catalogFilters&CatLDN) && (LDN_nb>0))
-		r = true;
-	else if ((catalogFilters&CatLBN) && (LBN_nb>0))
-		r = true;
-	else if ((catalogFilters&CatCr) && (Cr_nb>0))
-		r = true;
-	else if ((catalogFilters&CatMel) && (Mel_nb>0))
-		r = true;
-	else if ((catalogFilters&CatPGC) && (PGC_nb>0))
-		r = true;
-	else if ((catalogFilters&CatUGC) && (UGC_nb>0))
-		r = true;
-	else if ((catalogFilters&CatCed) && !(Ced_nb.isEmpty()))
-		r = true;
-	else if ((catalogFilters&CatArp) && (Arp_nb>0))
-		r = true;
-	else if ((catalogFilters&CatVV) && (VV_nb>0))
-		r = true;
-	else if ((catalogFilters&CatPK) && !(PK_nb.isEmpty()))
-		r = true;
-	else if ((catalogFilters&CatPNG) && !(PNG_nb.isEmpty()))
-		r = true;
-	else if ((catalogFilters&CatSNRG) && !(SNRG_nb.isEmpty()))
-		r = true;
-	else if ((catalogFilters&CatACO) && (!ACO_nb.isEmpty()))
-		r = true;
-
 	// Special case: objects without ID from current catalogs
-	if (withoutID)
-		r = true;
+	return withoutID || isCatalogGroupDisplayed(getCatalogGroup());
+}
 
-	return r;
+Nebula::CatalogGroup Nebula::getCatalogGroup() const
+{
+	CatalogGroup catalogs = CatalogGroup(0);
+	if (M_nb>0)
+		catalogs |= CatM;
+	if (C_nb>0)
+		catalogs |= CatC;
+	if (NGC_nb>0)
+		catalogs |= CatNGC;
+	if (IC_nb>0)
+		catalogs |= CatIC;
+	if (B_nb>0)
+		catalogs |= CatB;
+	if (Sh2_nb>0)
+		catalogs |= CatSh2;
+	if (VdB_nb>0)
+		catalogs |= CatVdB;
+	if (RCW_nb>0)
+		catalogs |= CatRCW;
+	if (LDN_nb>0)
+		catalogs |= CatLDN;
+	if (LBN_nb>0)
+		catalogs |= CatLBN;
+	if (Cr_nb>0)
+		catalogs |= CatCr;
+	if (Mel_nb>0)
+		catalogs |= CatMel;
+	if (PGC_nb>0)
+		catalogs |= CatPGC;
+	if (UGC_nb>0)
+		catalogs |= CatUGC;
+	if (!Ced_nb.isEmpty())
+		catalogs |= CatCed;
+	if (Arp_nb>0)
+		catalogs |= CatArp;
+	if (VV_nb>0)
+		catalogs |= CatVV;
+	if (!PK_nb.isEmpty())
+		catalogs |= CatPK;
+	if (!PNG_nb.isEmpty())
+		catalogs |= CatPNG;
+	if (!SNRG_nb.isEmpty())
+		catalogs |= CatSNRG;
+	if (!ACO_nb.isEmpty())
+		catalogs |= CatACO;
+	return catalogs;
+}
+
+bool Nebula::isCatalogGroupDisplayed(CatalogGroup catalogs)
+{
+	return !catalogs || (catalogFilters & catalogs);
 }
 
 QString Nebula::getMorphologicalTypeString(void) const
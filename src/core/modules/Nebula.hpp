@@ -35,6 +35,8 @@ class QDataStream;
 class Nebula : public StelObject
 {
 friend class NebulaMgr;
+friend class DsoCatalogStore;
+friend class TestDsoCatalogStore;
 
 	//Required for the correct working of the Q_FLAGS macro (which requires a MOC pass)
 	Q_GADGET
@@ -201,6 +203,13 @@ public:
 	QString getDSODesignation() const;
 
 	bool objectInDisplayedCatalog() const;
+	//! Get the catalogs in which the DSO has a designation, none for the DSO without designation.
+	CatalogGroup getCatalogGroup() const;
+	//! Test if the DSO of the catalogs @em catalogs are displayed with the current catalog filters,
+	//! as objectInDisplayedCatalog() without the Nebula object. The DSO without designation are displayed.
+	static bool isCatalogGroupDisplayed(CatalogGroup catalogs);
+	//! Test if the DSO of type @em type are displayed with the current type filters, as objectInDisplayedType().
+	static bool isTypeDisplayed(NebulaType type);
 
 private:
 	friend struct DrawNebulaFuncObject;
@@ -215,6 +224,9 @@ private:
 	}
 
 	void readDSO(QDataStream& in);
+	//! Set the data computed from a catalog record once its fields and XYZ are set:
+	//! the type, region and flag of the objects without designation.
+	void setupRecord(unsigned int oType);
 
 	void drawLabel(StelPainter& sPainter, float maxMagLabel) const;
 	void drawHints(StelPainter& sPainter, float maxMagHints) const;
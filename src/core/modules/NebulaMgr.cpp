@@ -54,6 +54,41 @@
 // This number must be incremented each time the content or file format of the stars catalogs change
 static const QString StellariumDSOCatalogVersion = "3.2";
 
+//! Written forms of the designations of a catalog, without and with space, as listed by the auto-completion.
+struct DesignationFormat
+{
+	Nebula::CatalogGroupFlags catalog;
+	const char* prefix;
+	const char* spacedPrefix;
+	bool numeric;
+};
+
+static const DesignationFormat designationFormats[] =
+{
+	{Nebula::CatM,		"M",	"M ",		true},
+	{Nebula::CatNGC,	"NGC",	"NGC ",		true},
+	{Nebula::CatIC,		"IC",	"IC ",		true},
+	{Nebula::CatC,		"C",	"C ",		true},
+	{Nebula::CatB,		"B",	"B ",		true},
+	{Nebula::CatSh2,	"SH2-",	"SH 2-",	true},
+	{Nebula::CatVdB,	"VDB",	"VDB ",		true},
+	{Nebula::CatRCW,	"RCW",	"RCW ",		true},
+	{Nebula::CatLDN,	"LDN",	"LDN ",		true},
+	{Nebula::CatLBN,	"LBN",	"LBN ",		true},
+	{Nebula::CatCr,		"CR",	"CR ",		true},
+	{Nebula::CatMel,	"MEL",	"MEL ",		true},
+	{Nebula::CatPGC,	"PGC",	"PGC ",		true},
+	{Nebula::CatUGC,	"UGC",	"UGC ",		true},
+	{Nebula::CatArp,	"ARP",	"ARP ",		true},
+	{Nebula::CatVV,		"VV",	"VV ",		true},
+	{Nebula::CatCed,	"Ced",	"Ced ",		false},
+	{Nebula::CatPK,		"PK",	"PK ",		false},
+	{Nebula::CatPNG,	"PNG",	"PN G",		false},
+	{Nebula::CatSNRG,	"SNRG",	"SNR G",	false},
+	{Nebula::CatACO,	"ACO",	"ACO ",		false}
+};
+static const int designationFormatCount = sizeof(designationFormats)/sizeof(designationFormats[0]);
+
 void NebulaMgr::setLabelsColor(const Vec3f& c) {Nebula::labelColor = c; emit labelsColorChanged(c);}
 const Vec3f NebulaMgr::getLabelsColor(void) const {return Nebula::labelColor;}
 void NebulaMgr::setCirclesColor(const Vec3f& c) {Nebula::circleColor = c; emit circlesColorChanged(c); }
@@ -137,6 +172,7 @@ bool NebulaMgr::getFlagOutlines(void) const {return Nebula::flagUseOutlines;}
 
 NebulaMgr::NebulaMgr(void)
 	: nebGrid(200)
+	, drawStamp(0)
 	, hintsAmount(0)
 	, labelsAmount(0)
 	, flagConverter(false)
@@ -398,7 +434,10 @@ void NebulaMgr::init()
 	StelApp *app = &StelApp::getInstance();
 	connect(app, SIGNAL(languageChanged()), this, SLOT(updateI18n()));
 	connect(&app->getSkyCultureMgr(), SIGNAL(currentSkyCultureChanged(QString)), this, SLOT(updateSkyCulture(const QString&)));
-	GETSTELMODULE(StelObjectMgr)->registerStelObjectMgr(this);
+	StelObjectMgr *objectManager = GETSTELMODULE(StelObjectMgr);
+	objectManager->registerStelObjectMgr(this);
+	connect(objectManager, SIGNAL(selectedObjectChanged(StelModule::StelModuleSelectAction)),
+			this, SLOT(selectedObjectChange(StelModule::StelModuleSelectAction)));
 
 	addAction("actionShow_Nebulas", N_("Display Options"), N_("Deep-sky objects"), "flagHintDisplayed", "D", "N");
 	addAction("actionSet_Nebula_TypeFilterUsage", N_("Display Options"), N_("Toggle DSO type filter"), "flagTypeFiltersUsage");
@@ -406,8 +445,9 @@ void NebulaMgr::init()
 
 struct DrawNebulaFuncObject
 {
-	DrawNebulaFuncObject(float amaxMagHints, float amaxMagLabels, StelPainter* p, StelCore* aCore, bool acheckMaxMagHints)
-		: maxMagHints(amaxMagHints)
+	DrawNebulaFuncObject(const NebulaMgr* aMgr, float amaxMagHints, float amaxMagLabels, StelPainter* p, StelCore* aCore, bool acheckMaxMagHints)
+		: mgr(aMgr)
+		, maxMagHints(amaxMagHints)
 		, maxMagLabels(amaxMagLabels)
 		, sPainter(p)
 		, core(aCore)
@@ -415,29 +455,36 @@ struct DrawNebulaFuncObject
 	{
 		angularSizeLimit = 5.f/sPainter->getProjector()->getPixelPerRadAtCenter()*180.f/M_PI;
 	}
-	void operator()(StelRegionObject* obj)
+	void operator()(int element)
 	{
 		if (checkMaxMagHints)
 			return;
 
-		Nebula* n = static_cast<Nebula*>(obj);
-		float mag = qMin(n->vMag, n->bMag);
+		// The magnitude and size are read from the store, the Nebula object is only created when it is drawn.
+		const DsoCatalogStore& store = mgr->dsoStore;
+		const int record = store.getElementRecord(element);
+		float mag = qMin(store.getVMagnitude(record), store.getBMagnitude(record));
 
 		StelSkyDrawer *drawer = core->getSkyDrawer();
 		// filter out DSOs which are too dim to be seen (e.g. for bino observers)
 		if ((drawer->getFlagNebulaMagnitudeLimit()) && (mag > drawer->getCustomNebulaMagnitudeLimit()))
 			return;
 
-		if (!n->objectInDisplayedCatalog())
-			return;
-
-		if (n->majorAxisSize>angularSizeLimit || n->majorAxisSize==0.f || mag <= maxMagHints)
+		const float majorAxisSize = store.getMajorAxisSize(record);
+		if (majorAxisSize>angularSizeLimit || majorAxisSize==0.f || mag <= maxMagHints)
 		{
+			// Same filters as Nebula::objectInDisplayedCatalog() and objectInDisplayedType(), before creating the object.
+			if (!Nebula::isCatalogGroupDisplayed(store.getCatalogGroup(record)) || !Nebula::isTypeDisplayed(store.getType(record)))
+				return;
+
+			const NebulaP n = mgr->getDrawnNebula(record);
+
 			sPainter->getProjector()->project(n->XYZ,n->XY);
 			n->drawLabel(*sPainter, maxMagLabels);
 			n->drawHints(*sPainter, maxMagHints);
 		}
 	}
+	const NebulaMgr* mgr;
 	float maxMagHints;
 	float maxMagLabels;
 	StelPainter* sPainter;
@@ -489,8 +536,11 @@ void NebulaMgr::draw(StelCore* core)
 	float maxMagHints  = computeMaxMagHint(skyDrawer);
 	float maxMagLabels = skyDrawer->getLimitMagnitude()-2.f+(labelsAmount*1.2f)-2.f;
 	sPainter.setFont(nebulaFont);
-	DrawNebulaFuncObject func(maxMagHints, maxMagLabels, &sPainter, core, hintsFader.getInterstate()<=0.f);
-	nebGrid.processIntersectingPointInRegions(p.data(), func);
+	++drawStamp;
+	DrawNebulaFuncObject func(this, maxMagHints, maxMagLabels, &sPainter, core, hintsFader.getInterstate()<=0.f);
+	if (nebGrid.isCompact())
+		nebGrid.processPointIndicesInRegion(p.data(), func);
+	trimDrawnNebulae();
 
 	if (GETSTELMODULE(StelObjectMgr)->getFlagSelectedObjectPointer())
 		drawPointer(core, sPainter);
@@ -534,11 +584,8 @@ NebulaP NebulaMgr::search(const QString& name)
 {
 	QString uname = name.toUpper();
 
-	foreach (const NebulaP& n, dsoArray)
-	{
-		QString testName = n->getEnglishName().toUpper();
-		if (testName==uname) return n;
-	}
+	if (englishNameIndex.contains(uname))
+		return englishNameIndex.value(uname);
 
 	// If no match found, try search by catalog reference
 	static QRegExp catNumRx("^(M|NGC|IC|C|B|VDB|RCW|LDN|LBN|CR|MEL|PGC|UGC|ARP|VV)\\s*(\\d+)$");
@@ -602,7 +649,13 @@ void NebulaMgr::loadNebulaSet(const QString& setName)
 	QString dsoOutlinesPath		= StelFileMgr::findFile("nebulae/" + setName + "/outlines.dat");
 
 	dsoArray.clear();
+	drawnNebulae.clear();
+	dsoStore.close();
 	dsoIndex.clear();
+	catalogNumberIndex.clear();
+	catalogStringIndex.clear();
+	designationTrie.clear();
+	spacedDesignationTrie.clear();
 	nebGrid.clear();
 
 	if (flagConverter)
@@ -620,7 +673,7 @@ void NebulaMgr::loadNebulaSet(const QString& setName)
 		return;
 	}
 
-	loadDSOCatalog(dsoCatalogPath);
+	loadDSOCatalog(dsoCatalogPath, setName);
 
 	if (!dsoOutlinesPath.isEmpty())
 		loadDSOOutlines(dsoOutlinesPath);
@@ -631,23 +684,24 @@ NebulaP NebulaMgr::search(const Vec3d& apos)
 {
 	Vec3d pos = apos;
 	pos.normalize();
-	NebulaP plusProche;
-	float anglePlusProche=0.0f;
-	foreach (const NebulaP& n, dsoArray)
-	{
-		if (n->XYZ*pos>anglePlusProche)
-		{
-			anglePlusProche=n->XYZ*pos;
-			plusProche=n;
-		}
-	}
-	if (anglePlusProche>0.999f)
-	{
-		return plusProche;
-	}
-	else return NebulaP();
+	nebGrid.findNearest(pos, 1, 0.999, nearestNebulae);
+	if (nearestNebulae.isEmpty())
+		return NebulaP();
+	return getDrawnNebula(dsoStore.getElementRecord(nearestNebulae.first().index));
 }
 
+//! Collects the DSO found by a cone search in the grid. Their objects are taken from the
+//! drawn ones, the DSO which get selected are kept by selectedObjectChange().
+struct SearchAroundFuncObject
+{
+	SearchAroundFuncObject(const NebulaMgr* aMgr, QList<StelObjectP>& aresult) : mgr(aMgr), result(aresult) {;}
+	void operator()(int element)
+	{
+		result.append(qSharedPointerCast<StelObject>(mgr->getDrawnNebula(mgr->dsoStore.getElementRecord(element))));
+	}
+	const NebulaMgr* mgr;
+	QList<StelObjectP>& result;
+};
 
 QList<StelObjectP> NebulaMgr::searchAround(const Vec3d& av, double limitFov, const StelCore*) const
 {
@@ -658,195 +712,333 @@ QList<StelObjectP> NebulaMgr::searchAround(const Vec3d& av, double limitFov, con
 	Vec3d v(av);
 	v.normalize();
 	double cosLimFov = cos(limitFov * M_PI/180.);
-	Vec3d equPos;
-	foreach (const NebulaP& n, dsoArray)
-	{
-		equPos = n->XYZ;
-		equPos.normalize();
-		if (equPos*v>=cosLimFov)
-		{
-			result.push_back(qSharedPointerCast<StelObject>(n));
-		}
-	}
+	SearchAroundFuncObject func(this, result);
+	const SphericalCap cap(v, cosLimFov);
+	if (nebGrid.isCompact())
+		nebGrid.processPointIndicesInRegion(&cap, func);
 	return result;
 }
 
 NebulaP NebulaMgr::searchDSO(unsigned int DSO)
 {
-	if (dsoIndex.contains(DSO))
-		return dsoIndex[DSO];
-	return NebulaP();
+	return getNebula(dsoIndex.value(DSO, -1));
 }
 
 
 NebulaP NebulaMgr::searchM(unsigned int M)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->M_nb == M)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatM).value(M, -1));
 }
 
 NebulaP NebulaMgr::searchNGC(unsigned int NGC)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->NGC_nb == NGC)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatNGC).value(NGC, -1));
 }
 
 NebulaP NebulaMgr::searchIC(unsigned int IC)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->IC_nb == IC)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatIC).value(IC, -1));
 }
 
 NebulaP NebulaMgr::searchC(unsigned int C)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->C_nb == C)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatC).value(C, -1));
 }
 
 NebulaP NebulaMgr::searchB(unsigned int B)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->B_nb == B)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatB).value(B, -1));
 }
 
 NebulaP NebulaMgr::searchSh2(unsigned int Sh2)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->Sh2_nb == Sh2)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatSh2).value(Sh2, -1));
 }
 
 NebulaP NebulaMgr::searchVdB(unsigned int VdB)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->VdB_nb == VdB)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatVdB).value(VdB, -1));
 }
 
 NebulaP NebulaMgr::searchRCW(unsigned int RCW)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->RCW_nb == RCW)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatRCW).value(RCW, -1));
 }
 
 NebulaP NebulaMgr::searchLDN(unsigned int LDN)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->LDN_nb == LDN)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatLDN).value(LDN, -1));
 }
 
 NebulaP NebulaMgr::searchLBN(unsigned int LBN)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->LBN_nb == LBN)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatLBN).value(LBN, -1));
 }
 
 NebulaP NebulaMgr::searchCr(unsigned int Cr)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->Cr_nb == Cr)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatCr).value(Cr, -1));
 }
 
 NebulaP NebulaMgr::searchMel(unsigned int Mel)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->Mel_nb == Mel)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatMel).value(Mel, -1));
 }
 
 NebulaP NebulaMgr::searchPGC(unsigned int PGC)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->PGC_nb == PGC)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatPGC).value(PGC, -1));
 }
 
 NebulaP NebulaMgr::searchUGC(unsigned int UGC)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->UGC_nb == UGC)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatUGC).value(UGC, -1));
 }
 
 NebulaP NebulaMgr::searchCed(QString Ced)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->Ced_nb.trimmed().toUpper() == Ced.trimmed().toUpper())
-			return n;
-	return NebulaP();
+	return getNebula(catalogStringIndex.value(Nebula::CatCed).value(Ced.trimmed().toUpper(), -1));
 }
 
 NebulaP NebulaMgr::searchArp(unsigned int Arp)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->Arp_nb == Arp)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatArp).value(Arp, -1));
 }
 
 NebulaP NebulaMgr::searchVV(unsigned int VV)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->VV_nb == VV)
-			return n;
-	return NebulaP();
+	return getNebula(catalogNumberIndex.value(Nebula::CatVV).value(VV, -1));
 }
 
 NebulaP NebulaMgr::searchPK(QString PK)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->PK_nb.trimmed().toUpper() == PK.trimmed().toUpper())
-			return n;
-	return NebulaP();
+	return getNebula(catalogStringIndex.value(Nebula::CatPK).value(PK.trimmed().toUpper(), -1));
 }
 
 NebulaP NebulaMgr::searchPNG(QString PNG)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->PNG_nb.trimmed().toUpper() == PNG.trimmed().toUpper())
-			return n;
-	return NebulaP();
+	return getNebula(catalogStringIndex.value(Nebula::CatPNG).value(PNG.trimmed().toUpper(), -1));
 }
 
 NebulaP NebulaMgr::searchSNRG(QString SNRG)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->SNRG_nb.trimmed().toUpper() == SNRG.trimmed().toUpper())
-			return n;
-	return NebulaP();
+	return getNebula(catalogStringIndex.value(Nebula::CatSNRG).value(SNRG.trimmed().toUpper(), -1));
 }
 
 NebulaP NebulaMgr::searchACO(QString ACO)
 {
-	foreach (const NebulaP& n, dsoArray)
-		if (n->ACO_nb.trimmed().toUpper() == ACO.trimmed().toUpper())
-			return n;
+	return getNebula(catalogStringIndex.value(Nebula::CatACO).value(ACO.trimmed().toUpper(), -1));
+}
+
+NebulaP NebulaMgr::searchDesignation(const QString& designation) const
+{
+	QString objw = designation.trimmed().toUpper();
+	if (objw.startsWith("ABELL"))
+		objw.replace(0, 5, "ACO");
+
+	for (int i=0;i<designationFormatCount;++i)
+	{
+		const DesignationFormat& f = designationFormats[i];
+		const QString prefix = QString(f.prefix).toUpper();
+		const QString spacedPrefix = QString(f.spacedPrefix).toUpper();
+		QString number;
+		if (objw.startsWith(spacedPrefix))
+			number = objw.mid(spacedPrefix.size());
+		else if (objw.startsWith(prefix))
+			number = objw.mid(prefix.size());
+		else
+			continue;
+
+		// Several prefixes can match, e.g. "MEL 31" is first tried as the Messier "EL 31".
+		int record = -1;
+		if (f.numeric)
+		{
+			bool ok;
+			unsigned int nb = number.toUInt(&ok);
+			if (ok && nb>0)
+				record = catalogNumberIndex.value(f.catalog).value(nb, -1);
+		}
+		else
+			record = catalogStringIndex.value(f.catalog).value(number.trimmed(), -1);
+		if (record>=0)
+			return getNebula(record);
+	}
 	return NebulaP();
 }
 
+void NebulaMgr::indexDesignations(int record)
+{
+	for (int i=0;i<designationFormatCount;++i)
+	{
+		const DesignationFormat& f = designationFormats[i];
+		QString number;
+		if (f.numeric)
+		{
+			unsigned int nb = dsoStore.getCatalogNumber(record, f.catalog);
+			if (nb==0)
+				continue;
+			// Keep the first DSO of a designation, as the searches did when they walked dsoArray
+			QHash<unsigned int, int>& index = catalogNumberIndex[f.catalog];
+			if (!index.contains(nb))
+				index.insert(nb, record);
+			number = QString::number(nb);
+		}
+		else
+		{
+			number = dsoStore.getCatalogString(record, f.catalog).trimmed();
+			if (number.isEmpty())
+				continue;
+			QHash<QString, int>& index = catalogStringIndex[f.catalog];
+			if (!index.contains(number.toUpper()))
+				index.insert(number.toUpper(), record);
+		}
+
+		const QString designation = f.prefix + number;
+		const QString spacedDesignation = f.spacedPrefix + number;
+		designationTrie.insert(designation, designation);
+		spacedDesignationTrie.insert(spacedDesignation, spacedDesignation);
+		// The Abell clusters are also completed from the name of the catalog, as searchDesignation() accepts it.
+		if (f.catalog==Nebula::CatACO)
+		{
+			designationTrie.insert("Abell" + number, designation);
+			spacedDesignationTrie.insert("Abell " + number, spacedDesignation);
+		}
+	}
+}
+
+NebulaP NebulaMgr::getNebula(int record) const
+{
+	if (record<0)
+		return NebulaP();
+	NebulaP& n = dsoArray[record];
+	// The named DSO got their object when the names were loaded, the others need no translation.
+	// An object created to draw the DSO is kept from now on.
+	if (n.isNull())
+		n = drawnNebulae.take(record).nebula;
+	if (n.isNull())
+		n = dsoStore.createNebula(record);
+	return n;
+}
+
+// Number of Nebula objects kept for the DSO which are only drawn, more than the DSO drawn in a wide field.
+static const int MAX_DRAWN_NEBULAE = 8192;
+
+NebulaP NebulaMgr::getDrawnNebula(int record) const
+{
+	const NebulaP& n = dsoArray.at(record);
+	if (!n.isNull())
+		return n;
+	DrawnNebula& d = drawnNebulae[record];
+	if (d.nebula.isNull())
+		d.nebula = dsoStore.createNebula(record);
+	d.lastUse = drawStamp;
+	return d.nebula;
+}
+
+void NebulaMgr::selectedObjectChange(StelModule::StelModuleSelectAction)
+{
+	// Move the selected DSO from drawnNebulae to dsoArray, so that they keep their object.
+	const QList<StelObjectP> selected = GETSTELMODULE(StelObjectMgr)->getSelectedObject(Nebula::NEBULA_TYPE);
+	foreach (const StelObjectP& obj, selected)
+	{
+		const NebulaP n = obj.staticCast<Nebula>();
+		int record = -1;
+		for (QHash<int, DrawnNebula>::const_iterator it=drawnNebulae.constBegin();it!=drawnNebulae.constEnd();++it)
+		{
+			if (it->nebula==n)
+			{
+				record = it.key();
+				break;
+			}
+		}
+		// The object may already have been released from drawnNebulae.
+		if (record<0 && n->DSO_nb!=0)
+			record = dsoIndex.value(n->DSO_nb, -1);
+		if (record<0 || !dsoArray.at(record).isNull())
+			continue;
+		dsoArray[record] = n;
+		drawnNebulae.remove(record);
+	}
+}
+
+void NebulaMgr::trimDrawnNebulae()
+{
+	if (drawnNebulae.size()<=MAX_DRAWN_NEBULAE)
+		return;
+	// Release the least recently drawn objects down to 3/4 of the maximum, those of the last draw() excepted.
+	QVector<quint32> stamps;
+	stamps.reserve(drawnNebulae.size());
+	foreach (const DrawnNebula& d, drawnNebulae)
+		stamps.append(d.lastUse);
+	const int nbToRelease = drawnNebulae.size()-MAX_DRAWN_NEBULAE*3/4;
+	std::nth_element(stamps.begin(), stamps.begin()+nbToRelease-1, stamps.end());
+	const quint32 lastReleased = qMin(stamps.at(nbToRelease-1), drawStamp-1);
+	QHash<int, DrawnNebula>::iterator it = drawnNebulae.begin();
+	while (it!=drawnNebulae.end())
+	{
+		if (it->lastUse<=lastReleased)
+			it = drawnNebulae.erase(it);
+		else
+			++it;
+	}
+}
+
+void NebulaMgr::createAllNebulae() const
+{
+	for (int i=0;i<dsoArray.size();++i)
+	{
+		if (dsoArray.at(i).isNull())
+			dsoArray[i] = dsoStore.createNebula(i);
+	}
+}
+
+const QVector<NebulaP>& NebulaMgr::getAllDeepSkyObjects() const
+{
+	createAllNebulae();
+	return dsoArray;
+}
+
+//! Add a name to the index, list and trie of a language.
+static void indexName(const QString& name, const NebulaP& n, QHash<QString, NebulaP>& index, QStringList& names, StelPrefixTrie& trie)
+{
+	if (name.isEmpty())
+		return;
+	const QString key = name.toUpper();
+	if (!index.contains(key))
+		index.insert(key, n);
+	names.append(name);
+	trie.insert(name, name);
+}
+
+void NebulaMgr::updateNameIndexes()
+{
+	englishNameIndex.clear();
+	nameI18nIndex.clear();
+	englishNames.clear();
+	namesI18n.clear();
+	englishNameTrie.clear();
+	nameI18nTrie.clear();
+
+	// The names are indexed before the aliases, which they take precedence over.
+	// The DSO without Nebula object have no name.
+	foreach (const NebulaP& n, dsoArray)
+	{
+		if (n.isNull())
+			continue;
+		indexName(n->englishName, n, englishNameIndex, englishNames, englishNameTrie);
+		indexName(n->nameI18, n, nameI18nIndex, namesI18n, nameI18nTrie);
+	}
+	foreach (const NebulaP& n, dsoArray)
+	{
+		if (n.isNull())
+			continue;
+		foreach (const QString& alias, n->englishAliases)
+			indexName(alias, n, englishNameIndex, englishNames, englishNameTrie);
+		foreach (const QString& alias, n->nameI18Aliases)
+			indexName(alias, n, nameI18nIndex, namesI18n, nameI18nTrie);
+	}
+}
+
 QString NebulaMgr::getLatestSelectedDSODesignation()
 {
 	QString result = "";
@@ -1182,52 +1374,45 @@ void NebulaMgr::convertDSOCatalog(const QString &in, const QString &out, bool de
 	qDebug() << "[...] Please use 'gzip -nc catalog.pack > catalog.dat' to pack the catalog.";
 }
 
-bool NebulaMgr::loadDSOCatalog(const QString &filename)
+bool NebulaMgr::loadDSOCatalog(const QString &filename, const QString& setName)
 {
-	QFile in(filename);
-	if (!in.open(QIODevice::ReadOnly))
-		return false;
-
 	qDebug() << "Loading DSO data ...";
 
-	// Let's begin use gzipped data
-	QDataStream ins(StelUtils::uncompress(in.readAll()));
-	ins.setVersion(QDataStream::Qt_5_2);
-
-	QString version = "", edition= "";
-	int totalRecords=0;
-	while (!ins.atEnd())
+	// The catalog is converted once to a store in the cache directory, which is mapped.
+	const QString cacheDir = StelFileMgr::getCacheDir() + "/nebulae/" + setName;
+	const QString storePath = cacheDir + "/catalog.store";
+	if (!dsoStore.open(storePath) || !dsoStore.matchesCatalog(filename)
+	    || StelUtils::compareVersions(dsoStore.getCatalogVersion(), StellariumDSOCatalogVersion)!=0)
 	{
-		if (totalRecords==0) // Read the version of catalog
-		{
-			ins >> version >> edition;
-			if (version.isEmpty())
-				version = "3.1"; // The first version of extended edition of the catalog
-			if (edition.isEmpty())
-				edition = "unknown";
-			qDebug() << "[...]" << QString("Stellarium DSO Catalog, version %1 (%2 edition)").arg(version).arg(edition);
-			if (StelUtils::compareVersions(version, StellariumDSOCatalogVersion)!=0)
-			{
-				qDebug() << "WARNING: Mismatch the version of catalog! The expected version of catalog is" << StellariumDSOCatalogVersion;
-				++totalRecords;
-				break;
-			}
-		}
-		else
+		dsoStore.close();
+		const QByteArray data = DsoCatalogStore::convert(filename, StellariumDSOCatalogVersion);
+		if (data.isEmpty())
+			return false;
+		if (!QDir().mkpath(cacheDir) || !DsoCatalogStore::write(storePath, data) || !dsoStore.open(storePath))
 		{
-			// Create a new Nebula record
-			NebulaP e = NebulaP(new Nebula);
-			e->readDSO(ins);
-
-			dsoArray.append(e);
-			nebGrid.insert(qSharedPointerCast<StelRegionObject>(e));
-			if (e->DSO_nb!=0)
-				dsoIndex.insert(e->DSO_nb, e);
+			qWarning() << "Cannot write the DSO catalog store" << QDir::toNativeSeparators(storePath);
+			if (!dsoStore.openData(data))
+				return false;
 		}
-		++totalRecords;
 	}
-	in.close();
-	qDebug() << "Loaded" << --totalRecords << "DSO records";
+	else
+		qDebug() << "[...]" << QString("Stellarium DSO Catalog, version %1 (%2 edition)").arg(dsoStore.getCatalogVersion()).arg(dsoStore.getCatalogEdition());
+
+	const int totalRecords = dsoStore.size();
+	dsoArray.fill(NebulaP(), totalRecords);
+	for (int i=0;i<totalRecords;++i)
+	{
+		const unsigned int dsoNumber = dsoStore.getDsoNumber(i);
+		if (dsoNumber!=0)
+			dsoIndex.insert(dsoNumber, i);
+		indexDesignations(i);
+	}
+	if (!dsoStore.setupIndex(nebGrid))
+	{
+		qWarning() << "Invalid grid in the DSO catalog store" << QDir::toNativeSeparators(storePath);
+		return false;
+	}
+	qDebug() << "Loaded" << totalRecords << "DSO records";
 	return true;
 }
 
@@ -1458,7 +1643,11 @@ void NebulaMgr::updateSkyCulture(const QString& skyCultureDir)
 	QString namesFile = StelFileMgr::findFile("skycultures/" + skyCultureDir + "/dso_names.fab");
 
 	foreach (const NebulaP& n, dsoArray)
-		n->removeAllNames();
+	{
+		if (!n.isNull())
+			n->removeAllNames();
+	}
+	updateNameIndexes();
 
 	if (namesFile.isEmpty())
 	{
@@ -1531,8 +1720,12 @@ void NebulaMgr::updateSkyCulture(const QString& skyCultureDir)
 void NebulaMgr::updateI18n()
 {
 	const StelTranslator& trans = StelApp::getInstance().getLocaleMgr().getSkyTranslator();
-	foreach (NebulaP n, dsoArray)
-		n->translateName(trans);
+	foreach (const NebulaP& n, dsoArray)
+	{
+		if (!n.isNull())
+			n->translateName(trans);
+	}
+	updateNameIndexes();
 }
 
 
@@ -1541,947 +1734,76 @@ StelObjectP NebulaMgr::searchByNameI18n(const QString& nameI18n) const
 {
 	QString objw = nameI18n.toUpper();
 
-	// Search by NGC numbers (possible formats are "NGC31" or "NGC 31")
-	if (objw.left(3) == "NGC")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("NGC%1").arg(n->NGC_nb) == objw || QString("NGC %1").arg(n->NGC_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by common names
-	foreach (const NebulaP& n, dsoArray)
-	{
-		QString objwcap = n->nameI18.toUpper();
-		if (objwcap==objw)
-			return qSharedPointerCast<StelObject>(n);
-	}
-
-	// Search by aliases of common names
-	foreach (const NebulaP& n, dsoArray)
-	{
-		foreach(QString objwcapa, n->nameI18Aliases)
-		{
-			if (objwcapa.toUpper()==objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by IC numbers (possible formats are "IC466" or "IC 466")
-	if (objw.left(2) == "IC")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("IC%1").arg(n->IC_nb) == objw || QString("IC %1").arg(n->IC_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-
-	// Search by Messier numbers (possible formats are "M31" or "M 31")
-	if (objw.left(1) == "M" && objw.left(3) != "MEL")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("M%1").arg(n->M_nb) == objw || QString("M %1").arg(n->M_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
+	// Search by common names and their aliases
+	if (nameI18nIndex.contains(objw))
+		return qSharedPointerCast<StelObject>(nameI18nIndex.value(objw));
 
-	// Search by Caldwell numbers (possible formats are "C31" or "C 31")
-	if (objw.left(1) == "C" && objw.left(2) != "CR" && objw.left(3) != "CED")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("C%1").arg(n->C_nb) == objw || QString("C %1").arg(n->C_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
+	// Search by catalog designations (possible formats are e.g. "NGC31" or "NGC 31")
+	return qSharedPointerCast<StelObject>(searchDesignation(objw));
+}
 
-	// Search by Barnard numbers (possible formats are "B31" or "B 31")
-	if (objw.left(1) == "B")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("B%1").arg(n->B_nb) == objw || QString("B %1").arg(n->B_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
 
-	// Search by Sharpless numbers (possible formats are "Sh2-31" or "Sh 2-31")
-	if (objw.left(2) == "SH")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("SH2-%1").arg(n->Sh2_nb) == objw || QString("SH 2-%1").arg(n->Sh2_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
+//! Return the matching Nebula object's pointer if exists or Q_NULLPTR
+//! TODO Decide whether empty StelObjectP or Q_NULLPTR is the better return type and select the same for both.
+StelObjectP NebulaMgr::searchByName(const QString& name) const
+{
+	QString objw = name.toUpper();
 
-	// Search by Van den Bergh numbers (possible formats are "VdB31" or "VdB 31")
-	if (objw.left(3) == "VDB")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("VDB%1").arg(n->VdB_nb) == objw || QString("VDB %1").arg(n->VdB_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
+	// Search by common names and their aliases
+	if (englishNameIndex.contains(objw))
+		return qSharedPointerCast<StelObject>(englishNameIndex.value(objw));
 
-	// Search by RCW numbers (possible formats are "RCW31" or "RCW 31")
-	if (objw.left(3) == "RCW")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("RCW%1").arg(n->RCW_nb) == objw || QString("RCW %1").arg(n->RCW_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
+	// Search by catalog designations (possible formats are e.g. "NGC31" or "NGC 31")
+	NebulaP n = searchDesignation(objw);
+	if (!n.isNull())
+		return qSharedPointerCast<StelObject>(n);
 
-	// Search by LDN numbers (possible formats are "LDN31" or "LDN 31")
-	if (objw.left(3) == "LDN")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("LDN%1").arg(n->LDN_nb) == objw || QString("LDN %1").arg(n->LDN_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
+	return Q_NULLPTR;
+}
 
-	// Search by LBN numbers (possible formats are "LBN31" or "LBN 31")
-	if (objw.left(3) == "LBN")
+//! Find and return the list of at most maxNbItem objects auto-completing the passed object name
+QStringList NebulaMgr::listMatchingObjects(const QString& objPrefix, int maxNbItem, bool useStartOfWords, bool inEnglish) const
+{
+	QStringList result;
+	if (maxNbItem <= 0)
 	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("LBN%1").arg(n->LBN_nb) == objw || QString("LBN %1").arg(n->LBN_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
+		return result;
 	}
 
-	// Search by Collinder numbers (possible formats are "Cr31" or "Cr 31")
-	if (objw.left(2) == "CR")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("CR%1").arg(n->Cr_nb) == objw || QString("CR %1").arg(n->Cr_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
+	// Search by catalog designations. The forms with space (e.g. "NGC 31") are only listed
+	// once the space is typed, the other prefixes also match the forms without space.
+	// The tries skip the designations already found, e.g. an ACO designation from its Abell alias.
+	designationTrie.find(objPrefix, maxNbItem, result);
+	if (objPrefix.contains(' '))
+		spacedDesignationTrie.find(objPrefix, maxNbItem, result);
 
-	// Search by Melotte numbers (possible formats are "Mel31" or "Mel 31")
-	if (objw.left(3) == "MEL")
+	// Search by common names and their aliases
+	if (useStartOfWords)
 	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("MEL%1").arg(n->Mel_nb) == objw || QString("MEL %1").arg(n->Mel_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
+		const StelPrefixTrie& nameTrie = inEnglish ? englishNameTrie : nameI18nTrie;
+		nameTrie.find(objPrefix, maxNbItem, result);
 	}
-
-	// Search by PGC numbers (possible formats are "PGC31" or "PGC 31")
-	if (objw.left(3) == "PGC")
+	else
 	{
-		foreach (const NebulaP& n, dsoArray)
+		const QStringList& names = inEnglish ? englishNames : namesI18n;
+		foreach (const QString& name, names)
 		{
-			if (QString("PGC%1").arg(n->PGC_nb) == objw || QString("PGC %1").arg(n->PGC_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
+			if (matchObjectName(name, objPrefix, useStartOfWords))
+				result.append(name);
 		}
 	}
 
-	// Search by UGC numbers (possible formats are "UGC31" or "UGC 31")
-	if (objw.left(3) == "UGC")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("UGC%1").arg(n->UGC_nb) == objw || QString("UGC %1").arg(n->UGC_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by Arp numbers (possible formats are "ARP31" or "ARP 31")
-	if (objw.left(3) == "ARP")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("ARP%1").arg(n->Arp_nb) == objw || QString("ARP %1").arg(n->Arp_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by VV numbers (possible formats are "VV31" or "VV 31")
-	if (objw.left(2) == "VV")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("VV%1").arg(n->VV_nb) == objw || QString("VV %1").arg(n->VV_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by Cederblad numbers (possible formats are "Ced31" or "Ced 31")
-	if (objw.left(3) == "CED")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("CED%1").arg(n->Ced_nb.trimmed().toUpper()) == objw.trimmed() || QString("CED %1").arg(n->Ced_nb.trimmed().toUpper()) == objw.trimmed())
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by PK numbers
-	if (objw.left(2) == "PK")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("PK%1").arg(n->PK_nb.trimmed().toUpper()) == objw.trimmed() || QString("PK %1").arg(n->PK_nb.trimmed().toUpper()) == objw.trimmed())
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by PN G numbers
-	if (objw.left(2) == "PN")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("PNG%1").arg(n->PNG_nb.trimmed().toUpper()) == objw.trimmed() || QString("PN G%1").arg(n->PNG_nb.trimmed().toUpper()) == objw.trimmed())
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by SNR G numbers
-	if (objw.left(3) == "SNR")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("SNRG%1").arg(n->SNRG_nb.trimmed().toUpper()) == objw.trimmed() || QString("SNR G%1").arg(n->SNRG_nb.trimmed().toUpper()) == objw.trimmed())
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by ACO numbers (possible formats are "ACO31", "ACO 31", "Abell31" or "Abell 31")
-	if (objw.left(2) == "ACO" || objw.left(5) == "ABELL")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("ACO%1").arg(n->ACO_nb.trimmed().toUpper()) == objw.trimmed()
-			|| QString("ACO %1").arg(n->ACO_nb.trimmed().toUpper()) == objw.trimmed()
-			|| QString("ABELL%1").arg(n->ACO_nb.trimmed().toUpper()) == objw.trimmed()
-			|| QString("ABELL %1").arg(n->ACO_nb.trimmed().toUpper()) == objw.trimmed())
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	return StelObjectP();
-}
-
-
-//! Return the matching Nebula object's pointer if exists or Q_NULLPTR
-//! TODO split common parts of this and I18 fn above into a separate fn.
-//! TODO Decide whether empty StelObjectP or Q_NULLPTR is the better return type and select the same for both.
-StelObjectP NebulaMgr::searchByName(const QString& name) const
-{
-	QString objw = name.toUpper();
-
-	// Search by NGC numbers (possible formats are "NGC31" or "NGC 31")
-	if (objw.startsWith("NGC"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("NGC%1").arg(n->NGC_nb) == objw || QString("NGC %1").arg(n->NGC_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by common names
-	foreach (const NebulaP& n, dsoArray)
-	{
-		QString objwcap = n->englishName.toUpper();
-		if (objwcap==objw)
-			return qSharedPointerCast<StelObject>(n);
-	}
-
-	// Search by aliases of common names
-	foreach (const NebulaP& n, dsoArray)
-	{
-		foreach(QString objwcapa, n->englishAliases)
-		{
-			if (objwcapa.toUpper()==objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by IC numbers (possible formats are "IC466" or "IC 466")
-	if (objw.startsWith("IC"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("IC%1").arg(n->IC_nb) == objw || QString("IC %1").arg(n->IC_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by Messier numbers (possible formats are "M31" or "M 31")
-	if (objw.startsWith("M") && !objw.startsWith("ME"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("M%1").arg(n->M_nb) == objw || QString("M %1").arg(n->M_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by Caldwell numbers (possible formats are "C31" or "C 31")
-	if (objw.startsWith("C") && !objw.startsWith("CR") && !objw.startsWith("CE"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("C%1").arg(n->C_nb) == objw || QString("C %1").arg(n->C_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by Barnard numbers (possible formats are "B31" or "B 31")
-	if (objw.startsWith("B"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("B%1").arg(n->B_nb) == objw || QString("B %1").arg(n->B_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by Sharpless numbers (possible formats are "Sh2-31" or "Sh 2-31")
-	if (objw.startsWith("SH"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("SH2-%1").arg(n->Sh2_nb) == objw || QString("SH 2-%1").arg(n->Sh2_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by Van den Bergh numbers (possible formats are "VdB31" or "VdB 31")
-	if (objw.startsWith("VDB"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("VDB%1").arg(n->VdB_nb) == objw || QString("VDB %1").arg(n->VdB_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by RCW numbers (possible formats are "RCW31" or "RCW 31")
-	if (objw.startsWith("RCW"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("RCW%1").arg(n->RCW_nb) == objw || QString("RCW %1").arg(n->RCW_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by LDN numbers (possible formats are "LDN31" or "LDN 31")
-	if (objw.startsWith("LDN"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("LDN%1").arg(n->LDN_nb) == objw || QString("LDN %1").arg(n->LDN_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by LBN numbers (possible formats are "LBN31" or "LBN 31")
-	if (objw.startsWith("LBN"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("LBN%1").arg(n->LBN_nb) == objw || QString("LBN %1").arg(n->LBN_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by Collinder numbers (possible formats are "Cr31" or "Cr 31")
-	if (objw.startsWith("CR") || objw.startsWith("COL"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("CR%1").arg(n->Cr_nb) == objw || QString("CR %1").arg(n->Cr_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by Melotte numbers (possible formats are "Mel31" or "Mel 31")
-	if (objw.startsWith("MEL"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("MEL%1").arg(n->Mel_nb) == objw || QString("MEL %1").arg(n->Mel_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by PGC numbers (possible formats are "PGC31" or "PGC 31")
-	if (objw.startsWith("PGC"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("PGC%1").arg(n->PGC_nb) == objw || QString("PGC %1").arg(n->PGC_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by UGC numbers (possible formats are "UGC31" or "UGC 31")
-	if (objw.startsWith("UGC"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("UGC%1").arg(n->UGC_nb) == objw || QString("UGC %1").arg(n->UGC_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by Arp numbers (possible formats are "Arp31" or "Arp 31")
-	if (objw.startsWith("ARP"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("ARP%1").arg(n->Arp_nb) == objw || QString("ARP %1").arg(n->Arp_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by VV numbers (possible formats are "VV31" or "VV 31")
-	if (objw.startsWith("VV"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("VV%1").arg(n->VV_nb) == objw || QString("VV %1").arg(n->VV_nb) == objw)
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by Cederblad numbers (possible formats are "Ced31" or "Ced 31")
-	if (objw.startsWith("CED"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("CED%1").arg(n->Ced_nb.trimmed().toUpper()) == objw.trimmed() || QString("CED %1").arg(n->Ced_nb.trimmed().toUpper()) == objw.trimmed())
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by PK numbers
-	if (objw.startsWith("PK"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("PK%1").arg(n->PK_nb.trimmed().toUpper()) == objw.trimmed() || QString("PK %1").arg(n->PK_nb.trimmed().toUpper()) == objw.trimmed())
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by PN G numbers
-	if (objw.startsWith("PN"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("PNG%1").arg(n->PNG_nb.trimmed().toUpper()) == objw.trimmed() || QString("PN G%1").arg(n->PNG_nb.trimmed().toUpper()) == objw.trimmed())
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by SNR G numbers
-	if (objw.startsWith("SNR"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("SNRG%1").arg(n->SNRG_nb.trimmed().toUpper()) == objw.trimmed() || QString("SNR G%1").arg(n->SNRG_nb.trimmed().toUpper()) == objw.trimmed())
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	// Search by ACO numbers
-	if (objw.startsWith("ACO") || objw.startsWith("ABELL"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (QString("ACO%1").arg(n->ACO_nb.trimmed().toUpper()) == objw.trimmed()
-			|| QString("ACO %1").arg(n->ACO_nb.trimmed().toUpper()) == objw.trimmed()
-			|| QString("ABELL%1").arg(n->ACO_nb.trimmed().toUpper()) == objw.trimmed()
-			|| QString("ABELL %1").arg(n->ACO_nb.trimmed().toUpper()) == objw.trimmed())
-				return qSharedPointerCast<StelObject>(n);
-		}
-	}
-
-	return Q_NULLPTR;
-}
-
-//! Find and return the list of at most maxNbItem objects auto-completing the passed object name
-QStringList NebulaMgr::listMatchingObjects(const QString& objPrefix, int maxNbItem, bool useStartOfWords, bool inEnglish) const
-{
-	QStringList result;
-	if (maxNbItem <= 0)
-	{
-		return result;
-	}
-
-	QString objw = objPrefix.toUpper();
-
-	// Search by Messier objects number (possible formats are "M31" or "M 31")
-	if (objw.size()>=1 && objw.left(1)=="M" && objw.left(3)!="MEL")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->M_nb==0) continue;
-			QString constw = QString("M%1").arg(n->M_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("M %1").arg(n->M_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by Melotte objects number (possible formats are "Mel31" or "Mel 31")
-	if (objw.size()>=1 && objw.left(3)=="MEL")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->Mel_nb==0) continue;
-			QString constw = QString("MEL%1").arg(n->Mel_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("MEL %1").arg(n->Mel_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by IC objects number (possible formats are "IC466" or "IC 466")
-	if (objw.size()>=1 && objw.left(2)=="IC")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->IC_nb==0) continue;
-			QString constw = QString("IC%1").arg(n->IC_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("IC %1").arg(n->IC_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by NGC numbers (possible formats are "NGC31" or "NGC 31")
-	foreach (const NebulaP& n, dsoArray)
-	{
-		if (n->NGC_nb==0) continue;
-		QString constw = QString("NGC%1").arg(n->NGC_nb);
-		QString constws = constw.mid(0, objw.size());
-		if (constws==objw)
-		{
-			result << constws;
-			continue;
-		}
-		constw = QString("NGC %1").arg(n->NGC_nb);
-		constws = constw.mid(0, objw.size());
-		if (constws==objw)
-			result << constw;
-	}
-
-	// Search by PGC object numbers (possible formats are "PGC31" or "PGC 31")
-	if (objw.size()>=1 && objw.left(3)=="PGC")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->PGC_nb==0) continue;
-			QString constw = QString("PGC%1").arg(n->PGC_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;	// Prevent adding both forms for name
-				continue;
-			}
-			constw = QString("PGC %1").arg(n->PGC_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by UGC object numbers (possible formats are "UGC31" or "UGC 31")
-	if (objw.size()>=1 && objw.left(3)=="UGC")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->UGC_nb==0) continue;
-			QString constw = QString("UGC%1").arg(n->UGC_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("UGC %1").arg(n->UGC_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by Caldwell objects number (possible formats are "C31" or "C 31")
-	if (objw.size()>=1 && objw.left(1)=="C" && objw.left(2)!="CR" && objw.left(2)!="CE")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->C_nb==0) continue;
-			QString constw = QString("C%1").arg(n->C_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("C %1").arg(n->C_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by Collinder objects number (possible formats are "Cr31" or "Cr 31")
-	if (objw.size()>=1 && objw.left(2)=="CR")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->Cr_nb==0) continue;
-			QString constw = QString("CR%1").arg(n->Cr_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("CR %1").arg(n->Cr_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by Ced objects number (possible formats are "Ced31" or "Ced 31")
-	if (objw.size()>=1 && objw.left(3)=="CED")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->Ced_nb.isEmpty()) continue;
-			QString constw = QString("Ced%1").arg(n->Ced_nb.trimmed());
-			QString constws = constw.mid(0, objw.size());
-			if (constws.toUpper()==objw.toUpper())
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("Ced %1").arg(n->Ced_nb.trimmed());
-			constws = constw.mid(0, objw.size());
-			if (constws.toUpper()==objw.toUpper())
-				result << constw;
-		}
-	}
-
-	// Search by Barnard objects number (possible formats are "B31" or "B 31")
-	if (objw.size()>=1 && objw.left(1)=="B")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->B_nb==0) continue;
-			QString constw = QString("B%1").arg(n->B_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("B %1").arg(n->B_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by Sharpless objects number (possible formats are "Sh2-31" or "Sh 2-31")
-	if (objw.size()>=1 && objw.left(2)=="SH")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->Sh2_nb==0) continue;
-			QString constw = QString("SH2-%1").arg(n->Sh2_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("SH 2-%1").arg(n->Sh2_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by Van den Bergh objects number (possible formats are "VdB31" or "VdB 31")
-	if (objw.size()>=1 && objw.left(3)=="VDB")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->VdB_nb==0) continue;
-			QString constw = QString("VDB%1").arg(n->VdB_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("VDB %1").arg(n->VdB_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by RCW objects number (possible formats are "RCW31" or "RCW 31")
-	if (objw.size()>=1 && objw.left(3)=="RCW")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->RCW_nb==0) continue;
-			QString constw = QString("RCW%1").arg(n->RCW_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("RCW %1").arg(n->RCW_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by LDN objects number (possible formats are "LDN31" or "LDN 31")
-	if (objw.size()>=1 && objw.left(3)=="LDN")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->LDN_nb==0) continue;
-			QString constw = QString("LDN%1").arg(n->LDN_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("LDN %1").arg(n->LDN_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by LBN objects number (possible formats are "LBN31" or "LBN 31")
-	if (objw.size()>=1 && objw.left(3)=="LBN")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->LBN_nb==0) continue;
-			QString constw = QString("LBN%1").arg(n->LBN_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("LBN %1").arg(n->LBN_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by Arp objects number
-	if (objw.size()>=1 && objw.left(3)=="ARP")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->Arp_nb==0) continue;
-			QString constw = QString("ARP%1").arg(n->Arp_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("ARP %1").arg(n->Arp_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by VV objects number
-	if (objw.size()>=1 && objw.left(2)=="VV")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->VV_nb==0) continue;
-			QString constw = QString("VV%1").arg(n->VV_nb);
-			QString constws = constw.mid(0, objw.size());
-			if (constws==objw)
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("VV %1").arg(n->VV_nb);
-			constws = constw.mid(0, objw.size());
-			if (constws==objw)
-				result << constw;
-		}
-	}
-
-	// Search by PK objects number
-	if (objw.size()>=1 && objw.left(2)=="PK")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->PK_nb.isEmpty()) continue;
-			QString constw = QString("PK%1").arg(n->PK_nb.trimmed());
-			QString constws = constw.mid(0, objw.size());
-			if (constws.toUpper()==objw.toUpper())
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("PK %1").arg(n->PK_nb.trimmed());
-			constws = constw.mid(0, objw.size());
-			if (constws.toUpper()==objw.toUpper())
-				result << constw;
-		}
-	}
-
-	// Search by PN G objects number
-	if (objw.size()>=1 && objw.left(2)=="PN")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->PNG_nb.isEmpty()) continue;
-			QString constw = QString("PNG%1").arg(n->PNG_nb.trimmed());
-			QString constws = constw.mid(0, objw.size());
-			if (constws.toUpper()==objw.toUpper())
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("PN G%1").arg(n->PNG_nb.trimmed());
-			constws = constw.mid(0, objw.size());
-			if (constws.toUpper()==objw.toUpper())
-				result << constw;
-		}
-	}
-
-	// Search by SNR G objects number
-	if (objw.size()>=1 && objw.left(3)=="SNR")
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->SNRG_nb.isEmpty()) continue;
-			QString constw = QString("SNRG%1").arg(n->SNRG_nb.trimmed());
-			QString constws = constw.mid(0, objw.size());
-			if (constws.toUpper()==objw.toUpper())
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("SNR G%1").arg(n->SNRG_nb.trimmed());
-			constws = constw.mid(0, objw.size());
-			if (constws.toUpper()==objw.toUpper())
-				result << constw;
-		}
-	}
-
-	// Search by ACO objects number
-	if (objw.size()>=1 && (objw.left(3)=="ACO" || objw.left(5)=="ABELL"))
-	{
-		foreach (const NebulaP& n, dsoArray)
-		{
-			if (n->ACO_nb.isEmpty()) continue;
-			QString constw = QString("ACO%1").arg(n->ACO_nb.trimmed());
-			QString constws = constw.mid(0, objw.size());
-			if (constws.toUpper()==objw.toUpper())
-			{
-				result << constws;
-				continue;	// Prevent adding both forms for name
-			}
-			constw = QString("ACO %1").arg(n->ACO_nb.trimmed());
-			constws = constw.mid(0, objw.size());
-			if (constws.toUpper()==objw.toUpper())
-				result << constw;
-		}
-	}
-
-	// Search by common names
-	foreach (const NebulaP& n, dsoArray)
-	{
-		QString name = inEnglish ? n->englishName : n->nameI18;
-		if (matchObjectName(name, objPrefix, useStartOfWords))
-		{
-			result.append(name);
-		}
-	}
-
-	// Search by aliases of common names
-	foreach (const NebulaP& n, dsoArray)
-	{
-		QStringList nameList = inEnglish ? n->englishAliases : n->nameI18Aliases;
-		foreach(QString name, nameList)
-		{
-			if (matchObjectName(name, objPrefix, useStartOfWords))
-				result.append(name);
-		}
-	}
-
-	result.sort();
-	if (result.size() > maxNbItem)
-	{
-		result.erase(result.begin() + maxNbItem, result.end());
-	}
-
+	StelPrefixTrie::sortCompletions(result, maxNbItem);
 	return result;
 }
 
 QStringList NebulaMgr::listAllObjects(bool inEnglish) const
 {
 	QStringList result;
+	// The DSO without Nebula object have no name.
 	foreach(const NebulaP& n, dsoArray)
 	{
-		if (!n->getEnglishName().isEmpty())
+		if (!n.isNull() && !n->getEnglishName().isEmpty())
 		{
 			if (inEnglish)
 				result << n->getEnglishName();
@@ -2496,6 +1818,8 @@ QStringList NebulaMgr::listAllObjectsByType(const QString &objType, bool inEngli
 {
 	QStringList result;
 	int type = objType.toInt();
+	// Most lists go through the whole catalog
+	createAllNebulae();
 	switch (type)
 	{
 		case 0: // Bright galaxies?
@@ -2781,6 +2105,8 @@ QList<NebulaP> NebulaMgr::getDeepSkyObjectsByType(const QString &objType)
 {
 	QList<NebulaP> dso;
 	int type = objType.toInt();
+	// Most lists go through the whole catalog
+	createAllNebulae();
 	switch (type)
 	{
 		case 100: // Messier Catalogue?
@@ -25,6 +25,8 @@
 #include "StelObjectType.hpp"
 #include "StelFader.hpp"
 #include "StelSphericalIndex.hpp"
+#include "StelPrefixTrie.hpp"
+#include "DsoCatalogStore.hpp"
 #include "StelObjectModule.hpp"
 #include "StelTextureTypes.hpp"
 #include "Nebula.hpp"
@@ -355,7 +357,8 @@ public:
 	QString getLatestSelectedDSODesignation();
 
 	//! Get the list of all deep-sky objects.
-	const QVector<NebulaP>& getAllDeepSkyObjects() const { return dsoArray; }
+	//! The objects are created when they are needed, the first call creates all of them.
+	const QVector<NebulaP>& getAllDeepSkyObjects() const;
 
 	//! Get the list of deep-sky objects by type.
 	QList<NebulaP> getDeepSkyObjectsByType(const QString& objType);
@@ -873,7 +876,13 @@ private slots:
 	//! @param skyCultureDir the name of the directory containing the sky culture to use.
 	void updateSkyCulture(const QString& skyCultureDir);
 
+	//! Keep the Nebula objects of the selected DSO in dsoArray, the objects
+	//! returned by the searches around a position are only in drawnNebulae.
+	void selectedObjectChange(StelModule::StelModuleSelectAction action);
+
 private:
+	friend struct DrawNebulaFuncObject;
+	friend struct SearchAroundFuncObject;
 
 	//! Search for a nebula object by name. e.g. M83, NGC 1123, IC 1234.
 	NebulaP search(const QString& name);
@@ -915,22 +924,76 @@ private:
 	NebulaP searchSNRG(QString SNRG);
 	NebulaP searchACO(QString ACO);
 
-	// Load catalog of DSO
-	bool loadDSOCatalog(const QString& filename);
+	//! Search a DSO by a designation of one of the catalogs, e.g. "NGC31", "NGC 31", "SH 2-31" or "PN G001.2+03.4".
+	NebulaP searchDesignation(const QString& designation) const;
+	//! Add the designations of the DSO of a record of dsoStore to the catalog indexes and to the designation tries.
+	void indexDesignations(int record);
+	//! Get the DSO of a record of dsoStore, creating its Nebula object if needed. Null if record is -1.
+	NebulaP getNebula(int record) const;
+	//! Get the DSO of a record to draw it. The Nebula objects of the DSO which are only drawn are kept
+	//! in drawnNebulae, not in dsoArray, so that they can be released by trimDrawnNebulae().
+	NebulaP getDrawnNebula(int record) const;
+	//! Release the least recently drawn objects of drawnNebulae beyond the maximum number.
+	void trimDrawnNebulae();
+	//! Create the Nebula objects of all the DSO, for the operations on the whole catalog.
+	void createAllNebulae() const;
+	//! Rebuild the indexes of the English and translated names and aliases.
+	void updateNameIndexes();
+
+	// Load catalog of DSO, through its store in the cache directory
+	bool loadDSOCatalog(const QString& filename, const QString& setName);
 	void convertDSOCatalog(const QString& in, const QString& out, bool decimal);
 	// Load proper names for DSO
 	bool loadDSONames(const QString& filename);
 	// Load outlines for DSO
 	bool loadDSOOutlines(const QString& filename);
 
-	QVector<NebulaP> dsoArray;		// The DSO list
-	QHash<unsigned int, NebulaP> dsoIndex;
+	//! The mapped catalog of the DSO
+	DsoCatalogStore dsoStore;
+	//! The DSO list, by record of dsoStore. The entries are null until getNebula() creates their Nebula object.
+	mutable QVector<NebulaP> dsoArray;
+	//! The records of dsoStore by DSO number
+	QHash<unsigned int, int> dsoIndex;
+
+	//! The records by catalog (Nebula::CatalogGroupFlags) and number, for the catalogs with numeric designations
+	QHash<int, QHash<unsigned int, int> > catalogNumberIndex;
+	//! The records by catalog and uppercase designation, for the catalogs with string designations (Ced, PK, PN G, SNR G, ACO)
+	QHash<int, QHash<QString, int> > catalogStringIndex;
+	//! The DSO by uppercase English or translated name, then alias
+	QHash<QString, NebulaP> englishNameIndex;
+	QHash<QString, NebulaP> nameI18nIndex;
+	//! English and translated names and aliases, for the auto-completion inside of words
+	QStringList englishNames;
+	QStringList namesI18n;
+
+	//! Auto-completion of the designations written without space, e.g. "NGC31"
+	StelPrefixTrie designationTrie;
+	//! Auto-completion of the designations written with a space, e.g. "NGC 31"
+	StelPrefixTrie spacedDesignationTrie;
+	//! Auto-completion of the English and translated names and aliases
+	StelPrefixTrie englishNameTrie;
+	StelPrefixTrie nameI18nTrie;
 
 	LinearFader hintsFader;
 	LinearFader flagShow;
 
-	//! The internal grid for fast positional lookup
+	//! The internal grid for fast positional lookup, set from dsoStore: its elements are given by index
 	StelSphericalIndex nebGrid;
+	//! Buffer of the nearest DSO searches in nebGrid, reused between the searches
+	QVector<StelSphericalIndex::Neighbour> nearestNebulae;
+
+	//! A Nebula object created to draw a DSO, and the last draw() which used it.
+	struct DrawnNebula
+	{
+		DrawnNebula() : lastUse(0) {}
+		NebulaP nebula;
+		quint32 lastUse;
+	};
+	//! The Nebula objects of the DSO which were drawn or found around a position, but not
+	//! selected or searched by name, by record.
+	mutable QHash<int, DrawnNebula> drawnNebulae;
+	//! Number of the current draw(), for the last use of drawnNebulae
+	quint32 drawStamp;
 
 	//! The amount of hints (between 0 and 10)
 	double hintsAmount;
@@ -60,6 +60,7 @@ public:
 	virtual void sample(double, double, int, OrbitSampleProc&) const;
 
 private:
+	friend class KeplerBatch;
 	//! returns eccentric anomaly E for Mean anomaly M
 	double eccentricAnomaly(const double M) const;
 	Vec3d positionAtE(const double E) const;
@@ -102,6 +103,7 @@ public:
 	double getEccentricity() const { return e; }
 	bool objectDateValid(const double JDE) const { return (fabs(t0-JDE)<orbitGood); }
 private:
+	friend class KeplerBatch;
 	const double q;  //! perihel distance
 	const double e;  //! eccentricity
 	const double i;  //! inclination
@@ -0,0 +1,249 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "OrbitPath.hpp"
+
+#include <cmath>
+#include <limits>
+
+// Number of segments the interval is first cut into.
+#define INITIAL_SEGMENTS 32
+// Each initial segment is split in at most 2^MAX_DEPTH segments.
+#define MAX_DEPTH 10
+// Cosine of the largest turn of the orbit within a segment (6 degrees).
+#define COS_MAX_TURN 0.9945219
+// Relative distance between the ends of a periodic path.
+#define PERIODIC_TOLERANCE 1e-7
+
+struct OrbitPath::Sampling
+{
+	Sampling(const PositionFunction& f, const Vec3d& observerPos, double angularTolerance, double maxStep)
+		: f(f), observerPos(observerPos), angularTolerance(angularTolerance), maxStep(maxStep) {}
+	const PositionFunction& f;
+	Vec3d observerPos;
+	double angularTolerance;
+	//! Largest segment before refinement
+	double maxStep;
+};
+
+OrbitPath::OrbitPath()
+	: startJDE(0.)
+	, endJDE(0.)
+	, angularTolerance(0.)
+	, observerPos(0., 0., 0.)
+	, observerDistance(0.)
+	, periodic(false)
+	, nrOfEvaluations(0)
+{
+}
+
+void OrbitPath::clear()
+{
+	dates = QVector<double>();
+	points = QVector<Vec3d>();
+	startJDE = endJDE = 0.;
+	angularTolerance = 0.;
+	observerPos.set(0., 0., 0.);
+	observerDistance = 0.;
+	periodic = false;
+}
+
+Vec3d OrbitPath::evaluate(const Sampling& s, double jde)
+{
+	++nrOfEvaluations;
+	return s.f.position(jde);
+}
+
+void OrbitPath::sample(const PositionFunction& f, double start, double end, const Vec3d& observerPos, double tolerance)
+{
+	const Sampling s(f, observerPos, tolerance, (end-start)/INITIAL_SEGMENTS);
+	QVector<double> newDates;
+	QVector<Vec3d> newPoints;
+	const Vec3d p0 = evaluate(s, start);
+	const Vec3d p1 = evaluate(s, end);
+	appendRange(s, start, p0, end, p1, newDates, newPoints);
+	newDates.append(end);
+	newPoints.append(p1);
+
+	dates = newDates;
+	points = newPoints;
+	startJDE = start;
+	endJDE = end;
+	angularTolerance = tolerance;
+	updateObserver(observerPos);
+	updatePeriodic();
+}
+
+void OrbitPath::shift(const PositionFunction& f, double start, double end, const Vec3d& observerPos, double tolerance)
+{
+	// First kept point, and the last one
+	int first = 0;
+	while (first<dates.size() && dates.at(first)<start)
+		++first;
+	int last = dates.size()-1;
+	while (last>=first && dates.at(last)>end)
+		--last;
+	// The kept points are only reused while their error seen from the new observer stays
+	// within twice the tolerance, as in Planet::isOrbitPathValid().
+	const double keptTolerance = getAngularErrorBound(observerPos);
+	if (first>last || keptTolerance>2.*tolerance)
+	{
+		sample(f, start, end, observerPos, tolerance);
+		return;
+	}
+
+	const Sampling s(f, observerPos, tolerance, (end-start)/INITIAL_SEGMENTS);
+	QVector<double> newDates;
+	QVector<Vec3d> newPoints;
+	newDates.reserve(dates.size());
+	newPoints.reserve(points.size());
+
+	// The new head of the interval
+	if (dates.at(first)>start)
+		appendRange(s, start, evaluate(s, start), dates.at(first), points.at(first), newDates, newPoints);
+	// The kept points, between the points of the new head and tail
+	for (int i=first;i<last;++i)
+	{
+		newDates.append(dates.at(i));
+		newPoints.append(points.at(i));
+	}
+	// The new tail
+	if (dates.at(last)<end)
+	{
+		const Vec3d pEnd = evaluate(s, end);
+		appendRange(s, dates.at(last), points.at(last), end, pEnd, newDates, newPoints);
+		newDates.append(end);
+		newPoints.append(pEnd);
+	}
+	else
+	{
+		newDates.append(dates.at(last));
+		newPoints.append(points.at(last));
+	}
+
+	dates = newDates;
+	points = newPoints;
+	startJDE = start;
+	endJDE = end;
+	angularTolerance = qMax(keptTolerance, tolerance);
+	updateObserver(observerPos);
+	updatePeriodic();
+}
+
+void OrbitPath::appendRange(const Sampling& s, double t0, const Vec3d& p0, double t1, const Vec3d& p1,
+			    QVector<double>& newDates, QVector<Vec3d>& newPoints)
+{
+	const int nbSegments = qMax(1, (int)std::ceil((t1-t0)/s.maxStep-1e-9));
+	double ta = t0;
+	Vec3d pa = p0;
+	for (int i=1;i<=nbSegments;++i)
+	{
+		const double tb = i==nbSegments ? t1 : t0+(t1-t0)*i/nbSegments;
+		const Vec3d pb = i==nbSegments ? p1 : evaluate(s, tb);
+		newDates.append(ta);
+		newPoints.append(pa);
+		appendRefined(s, ta, pa, tb, pb, 0, newDates, newPoints);
+		ta = tb;
+		pa = pb;
+	}
+}
+
+void OrbitPath::appendRefined(const Sampling& s, double t0, const Vec3d& p0, double t1, const Vec3d& p1, int depth,
+			      QVector<double>& newDates, QVector<Vec3d>& newPoints)
+{
+	if (depth>=MAX_DEPTH)
+		return;
+	const double tm = 0.5*(t0+t1);
+	const Vec3d pm = evaluate(s, tm);
+
+	// Error of the segment seen from the observer. Segments close to the observer
+	// are compared with their own length, so that they are not split indefinitely.
+	const double deviation = (pm-(p0+p1)*0.5).length();
+	const double distance = qMax((pm-s.observerPos).length(), (p1-p0).length());
+	bool split = deviation>s.angularTolerance*distance;
+	if (!split)
+	{
+		// Turn of the orbit within the segment
+		const Vec3d u = pm-p0;
+		const Vec3d v = p1-pm;
+		const double uv = u.length()*v.length();
+		split = uv>0. && u.dot(v)<COS_MAX_TURN*uv;
+	}
+	if (!split)
+		return;
+
+	appendRefined(s, t0, p0, tm, pm, depth+1, newDates, newPoints);
+	newDates.append(tm);
+	newPoints.append(pm);
+	appendRefined(s, tm, pm, t1, p1, depth+1, newDates, newPoints);
+}
+
+void OrbitPath::updatePeriodic()
+{
+	periodic = points.size()>1 && (points.last()-points.first()).length()<=PERIODIC_TOLERANCE*points.first().length();
+}
+
+void OrbitPath::updateObserver(const Vec3d& pos)
+{
+	// Same distance as in appendRefined(): the segments close to the observer were compared
+	// with their own length.
+	observerPos = pos;
+	observerDistance = std::numeric_limits<double>::max();
+	for (int i=0;i<points.size();++i)
+	{
+		const double length = i+1<points.size() ? (points.at(i+1)-points.at(i)).length() : 0.;
+		observerDistance = qMin(observerDistance, qMax((points.at(i)-pos).length(), length));
+	}
+}
+
+double OrbitPath::getAngularErrorBound(const Vec3d& newObserverPos) const
+{
+	// A segment at the distance d from the old observer, where its deviation was at most
+	// angularTolerance*d, is at least at d-shift from the new one. The ratio d/(d-shift)
+	// is largest for the closest segment.
+	const double shift = (newObserverPos-observerPos).length();
+	if (shift==0.)
+		return angularTolerance;
+	if (shift>=observerDistance)
+		return std::numeric_limits<double>::infinity();
+	return angularTolerance*observerDistance/(observerDistance-shift);
+}
+
+int OrbitPath::indexAfter(double jde) const
+{
+	if (periodic && endJDE>startJDE)
+	{
+		const double period = endJDE-startJDE;
+		jde = startJDE+std::fmod(jde-startJDE, period);
+		if (jde<startJDE)
+			jde += period;
+	}
+	// Binary search of the first date after jde
+	int lo = 0;
+	int hi = dates.size();
+	while (lo<hi)
+	{
+		const int mid = (lo+hi)/2;
+		if (dates.at(mid)<=jde)
+			lo = mid+1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
@@ -0,0 +1,116 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _ORBITPATH_HPP_
+#define _ORBITPATH_HPP_
+
+#include "VecMath.hpp"
+
+#include <QVector>
+
+//! @class OrbitPath
+//! The points of the orbit line of a body, sampled over a time interval.
+//! Instead of uniform time steps, the interval is first cut in a few segments, which are split
+//! recursively as long as the curve deviates from them by more than a given angle seen from the
+//! observer, or turns too much within them. Highly eccentric orbits therefore get many points
+//! near the pericenter and few elsewhere, and nearly circular orbits need far fewer positions
+//! than with uniform steps.
+//! The path is kept between frames: shift() moves the interval and only computes the positions
+//! of its new parts. A path which closes on itself over its interval is periodic, and can be
+//! used at any date as long as the orbital elements do not change.
+//! The tolerance only holds for the observer of the sampling: getAngularErrorBound() tells how
+//! much the error may grow once the observer has moved.
+class OrbitPath
+{
+public:
+	//! Computes the positions of the orbit.
+	class PositionFunction
+	{
+	public:
+		virtual ~PositionFunction() {}
+		//! Get the position at @em jde in the frame of the parent body.
+		virtual Vec3d position(double jde) const = 0;
+	};
+
+	OrbitPath();
+
+	//! Remove all points and release the memory.
+	void clear();
+	bool isEmpty() const {return dates.isEmpty();}
+	int size() const {return dates.size();}
+
+	//! Sample the orbit from @em startJDE to @em endJDE, replacing all points.
+	//! @param observerPos the observer in the frame of the parent body
+	//! @param angularTolerance maximal error of the line seen from the observer, in radians
+	void sample(const PositionFunction& f, double startJDE, double endJDE, const Vec3d& observerPos, double angularTolerance);
+	//! Move the interval to @em startJDE - @em endJDE, keeping the points of the old interval
+	//! within the new one. The positions of @em f must not depend on the interval.
+	void shift(const PositionFunction& f, double startJDE, double endJDE, const Vec3d& observerPos, double angularTolerance);
+
+	double getStartJDE() const {return startJDE;}
+	double getEndJDE() const {return endJDE;}
+	double getCenterJDE() const {return 0.5*(startJDE+endJDE);}
+	//! Get the largest tolerance used for the points.
+	double getAngularTolerance() const {return angularTolerance;}
+	//! Get the observer of the sampling, in the frame of the parent body.
+	const Vec3d& getObserverPos() const {return observerPos;}
+	//! Get the smallest distance between the observer of the sampling and the line.
+	double getObserverDistance() const {return observerDistance;}
+	//! Get an upper bound of the error of the line seen from @em newObserverPos, in radians.
+	//! Returns infinity when the observer may have come arbitrarily close to the line.
+	double getAngularErrorBound(const Vec3d& newObserverPos) const;
+	//! Return true if the path closes on itself, i.e. the interval is a period of the orbit.
+	bool isPeriodic() const {return periodic;}
+
+	const QVector<double>& getDates() const {return dates;}
+	//! Get the points, in the frame of the parent body.
+	const QVector<Vec3d>& getPoints() const {return points;}
+	//! Get the index of the first point after @em jde, where the position at @em jde fits in
+	//! the line. Dates of periodic paths are taken modulo the period.
+	int indexAfter(double jde) const;
+
+	//! Get the number of positions computed since the creation of the path, for statistics.
+	int getNrOfEvaluations() const {return nrOfEvaluations;}
+
+private:
+	struct Sampling;
+
+	//! Append the point at @em t0 and the points strictly between @em t0 and @em t1.
+	void appendRange(const Sampling& s, double t0, const Vec3d& p0, double t1, const Vec3d& p1,
+			 QVector<double>& newDates, QVector<Vec3d>& newPoints);
+	//! Append the points strictly between @em t0 and @em t1, splitting the segment recursively.
+	void appendRefined(const Sampling& s, double t0, const Vec3d& p0, double t1, const Vec3d& p1, int depth,
+			   QVector<double>& newDates, QVector<Vec3d>& newPoints);
+	Vec3d evaluate(const Sampling& s, double jde);
+	void updatePeriodic();
+	//! Set the observer of the sampling and its distance to the points.
+	void updateObserver(const Vec3d& observerPos);
+
+	QVector<double> dates;
+	QVector<Vec3d> points;
+	double startJDE;
+	double endJDE;
+	double angularTolerance;
+	Vec3d observerPos;
+	double observerDistance;
+	bool periodic;
+	int nrOfEvaluations;
+};
+
+#endif // _ORBITPATH_HPP_
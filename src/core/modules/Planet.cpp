@@ -61,6 +61,8 @@ const QString Planet::PLANET_TYPE = QStringLiteral("Planet");
 bool Planet::shaderError = false;
 
 Vec3f Planet::labelColor = Vec3f(0.4f,0.4f,0.8f);
+double Planet::orbitAngularTolerance = 1e-3;
+Vec3d Planet::orbitObserverPos = Vec3d(0.,0.,0.);
 Vec3f Planet::orbitColor = Vec3f(1.0f,0.6f,1.0f);
 Vec3f Planet::orbitMajorPlanetsColor = Vec3f(1.0f,0.6f,1.0f);
 Vec3f Planet::orbitMoonsColor = Vec3f(1.0f,0.6f,1.0f);
@@ -184,10 +186,9 @@ Planet::Planet(const QString& englishName,
 	       const QString& pTypeStr)
 	: flagNativeName(true),
 	  flagTranslatedName(true),
-	  lastOrbitJDE(0.0),
 	  deltaJDE(StelCore::JD_SECOND),
 	  deltaOrbitJDE(0.0),
-	  orbitCached(false),
+	  fixedOrbitElements(false),
 	  closeOrbit(acloseOrbit),
 	  englishName(englishName),
 	  nameI18(englishName),
@@ -700,7 +701,7 @@ void Planet::computePositionWithoutOrbits(const double dateJDE)
 {
 	if (fabs(lastJDE-dateJDE)>deltaJDE)
 	{
-		coordFunc(dateJDE, eclipticPos, orbitPtr);
+		coordFunc(dateJDE, eclipticPos, getCoordFuncData());
 		lastJDE = dateJDE;
 	}
 }
@@ -776,135 +777,88 @@ void Planet::computePosition(const double dateJDE)
 {
 	// Make sure the parent position is computed for the dateJDE, otherwise
 	// getHeliocentricPos() would return incorrect values.
-	if (parent)
+	// The Sun is the origin of the heliocentric coordinates and never moves. Skipping it allows
+	// SolarSystem to compute the bodies orbiting the Sun in parallel.
+	if (parent && parent->parent)
 		parent->computePositionWithoutOrbits(dateJDE);
 
-	if (orbitFader.getInterstate()>0.000001 && deltaOrbitJDE > 0 && (fabs(lastOrbitJDE-dateJDE)>deltaOrbitJDE || !orbitCached))
+	if (orbitFader.getInterstate()>0.000001 && deltaOrbitJDE > 0 && !isOrbitPathValid(dateJDE))
 	{
-		StelCore *core=StelApp::getInstance().getCore();
-
-		double calc_date;
-		// int delta_points = (int)(0.5 + (date - lastOrbitJD)/date_increment);
-		int delta_points;
-
-		if( dateJDE > lastOrbitJDE )
-		{
-			delta_points = (int)(0.5 + (dateJDE - lastOrbitJDE)/deltaOrbitJDE);
-		}
-		else
-		{
-			delta_points = (int)(-0.5 + (dateJDE - lastOrbitJDE)/deltaOrbitJDE);
-		}
-		double new_date = lastOrbitJDE + delta_points*deltaOrbitJDE;
-
-		// qDebug( "Updating orbit coordinates for %s (delta %f) (%d points)\n", getEnglishName().toUtf8().data(), deltaOrbitJDE, delta_points);
-
-		if( delta_points > 0 && delta_points < ORBIT_SEGMENTS && orbitCached)
-		{
-
-			for( int d=0; d<ORBIT_SEGMENTS; d++ )
-			{
-				if(d + delta_points >= ORBIT_SEGMENTS-1 )
-				{
-					// calculate new points
-					calc_date = new_date + (d-ORBIT_SEGMENTS/2)*deltaOrbitJDE;
-
-					// date increments between points will not be completely constant though
-					computeTransMatrix(calc_date-core->computeDeltaT(calc_date)/86400.0, calc_date);
-					if (osculatingFunc)
-					{
-						(*osculatingFunc)(dateJDE,calc_date,eclipticPos);
-					}
-					else
-					{
-						coordFunc(calc_date, eclipticPos, orbitPtr);
-					}
-					orbitP[d] = eclipticPos;
-					orbit[d] = getHeliocentricEclipticPos();
-				}
-				else
-				{
-					orbitP[d] = orbitP[d+delta_points];
-					orbit[d] = getHeliocentricPos(orbitP[d]);
-				}
-			}
-
-			lastOrbitJDE = new_date;
-		}
-		else if( delta_points < 0 && abs(delta_points) < ORBIT_SEGMENTS  && orbitCached)
-		{
-
-			for( int d=ORBIT_SEGMENTS-1; d>=0; d-- )
-			{
-				if(d + delta_points < 0 )
-				{
-					// calculate new points
-					calc_date = new_date + (d-ORBIT_SEGMENTS/2)*deltaOrbitJDE;
-
-					computeTransMatrix(calc_date-core->computeDeltaT(calc_date)/86400.0, calc_date);
-					if (osculatingFunc) {
-						(*osculatingFunc)(dateJDE,calc_date,eclipticPos);
-					}
-					else
-					{
-						coordFunc(calc_date, eclipticPos, orbitPtr);
-					}
-					orbitP[d] = eclipticPos;
-					orbit[d] = getHeliocentricEclipticPos();
-				}
-				else
-				{
-					orbitP[d] = orbitP[d+delta_points];
-					orbit[d] = getHeliocentricPos(orbitP[d]);
-				}
-			}
-
-			lastOrbitJDE = new_date;
-
-		}
-		else if( delta_points || !orbitCached)
-		{
-
-			// update all points (less efficient)
-			for( int d=0; d<ORBIT_SEGMENTS; d++ )
-			{
-				calc_date = dateJDE + (d-ORBIT_SEGMENTS/2)*deltaOrbitJDE;
-				computeTransMatrix(calc_date-core->computeDeltaT(calc_date)/86400.0, calc_date);
-				if (osculatingFunc)
-				{
-					(*osculatingFunc)(dateJDE,calc_date,eclipticPos);
-				}
-				else
-				{
-					coordFunc(calc_date, eclipticPos, orbitPtr);
-				}
-				orbitP[d] = eclipticPos;
-				orbit[d] = getHeliocentricEclipticPos();
-			}
-
-			lastOrbitJDE = dateJDE;
-			if (!osculatingFunc) orbitCached = 1;
-		}
-
+		updateOrbitPath(dateJDE);
 
 		// calculate actual Planet position
-		coordFunc(dateJDE, eclipticPos, orbitPtr);
-
+		coordFunc(dateJDE, eclipticPos, getCoordFuncData());
 		lastJDE = dateJDE;
 
+		const QVector<Vec3d>& points = orbitPath.getPoints();
+		orbit.resize(points.size());
+		for (int d=0; d<points.size(); d++)
+			orbit[d]=getHeliocentricPos(points.at(d));
 	}
 	else if (fabs(lastJDE-dateJDE)>deltaJDE)
 	{
 		// calculate actual Planet position
-		coordFunc(dateJDE, eclipticPos, orbitPtr);
-		if (orbitFader.getInterstate()>0.000001)
-			for( int d=0; d<ORBIT_SEGMENTS; d++ )
-				orbit[d]=getHeliocentricPos(orbitP[d]);
+		coordFunc(dateJDE, eclipticPos, getCoordFuncData());
+		if (orbitFader.getInterstate()>0.000001 && !orbit.isEmpty())
+		{
+			const QVector<Vec3d>& points = orbitPath.getPoints();
+			for (int d=0; d<points.size(); d++)
+				orbit[d]=getHeliocentricPos(points.at(d));
+		}
 		lastJDE = dateJDE;
 	}
 
 }
 
+// Positions of the orbit line. Osculating orbits use the elements at the date of the line.
+class Planet::OrbitPositions : public OrbitPath::PositionFunction
+{
+public:
+	OrbitPositions(const Planet* planet, double dateJDE) : planet(planet), dateJDE(dateJDE) {}
+	virtual Vec3d position(double jde) const
+	{
+		Vec3d pos;
+		if (planet->osculatingFunc)
+			(*planet->osculatingFunc)(dateJDE, jde, pos, planet->ephemContext.data());
+		else
+			planet->coordFunc(jde, pos, planet->getCoordFuncData());
+		return pos;
+	}
+private:
+	const Planet* planet;
+	double dateJDE;
+};
+
+Vec3d Planet::getOrbitObserverPos() const
+{
+	return parent ? orbitObserverPos-parent->getHeliocentricEclipticPos() : orbitObserverPos;
+}
+
+bool Planet::isOrbitPathValid(double dateJDE) const
+{
+	if (orbitPath.isEmpty() || orbitAngularTolerance<0.5*orbitPath.getAngularTolerance())
+		return false;
+	// A closed orbit with fixed elements, sampled over its period, is the same at all dates,
+	// as long as the observer has not moved enough to make the error exceed the tolerance.
+	if (fixedOrbitElements && orbitPath.isPeriodic())
+		return orbitPath.getAngularErrorBound(getOrbitObserverPos())<=2.*orbitAngularTolerance;
+	// Else the line follows the date by steps of deltaOrbitJDE.
+	return fabs(dateJDE-orbitPath.getCenterJDE())<=deltaOrbitJDE;
+}
+
+void Planet::updateOrbitPath(double dateJDE)
+{
+	const double start = dateJDE-0.5*re.siderealPeriod;
+	const double end = dateJDE+0.5*re.siderealPeriod;
+	const Vec3d observerPos = getOrbitObserverPos();
+	const OrbitPositions f(this, dateJDE);
+	// The osculating elements change with the date, so the old points can't be kept.
+	if (osculatingFunc || orbitAngularTolerance<0.5*orbitPath.getAngularTolerance())
+		orbitPath.sample(f, start, end, observerPos, orbitAngularTolerance);
+	else
+		orbitPath.shift(f, start, end, observerPos, orbitAngularTolerance);
+}
+
 // Compute the transformation matrix from the local Planet coordinate system to the parent Planet coordinate system.
 // In case of the planets, this makes the axis point to their respective celestial poles.
 // TODO: Verify for the other planets if their axes are relative to J2000 ecliptic (VSOP87A XY plane) or relative to (precessed) ecliptic of date?
@@ -3017,7 +2971,7 @@ Vec3f Planet::getCurrentOrbitColor() const
 // draw orbital path of Planet
 void Planet::drawOrbit(const StelCore* core)
 {
-	if (!orbitFader.getInterstate())
+	if (!orbitFader.getInterstate() || orbit.isEmpty())
 		return;
 	if (!re.siderealPeriod)
 		return;
@@ -3033,19 +2987,22 @@ void Planet::drawOrbit(const StelCore* core)
 
 	sPainter.setColor(orbColor[0], orbColor[1], orbColor[2], orbitFader.getInterstate());
 	Vec3d onscreen;
-	// special case - use current Planet position as center vertex so that draws
+	// special case - insert the current Planet position in the line so that it is drawn
 	// on its orbit all the time (since segmented rather than smooth curve)
-	Vec3d savePos = orbit[ORBIT_SEGMENTS/2];
-	orbit[ORBIT_SEGMENTS/2]=getHeliocentricEclipticPos();
-	orbit[ORBIT_SEGMENTS]=orbit[0];
-	int nbIter = closeOrbit ? ORBIT_SEGMENTS : ORBIT_SEGMENTS-1;
+	const int current = orbitPath.indexAfter(lastJDE);
+	const int nbPoints = orbit.size();
+	const int nbIter = closeOrbit ? nbPoints+1 : nbPoints;
+	const Vec3d currentPos = getHeliocentricEclipticPos();
+	Vec3d previous;
 	QVarLengthArray<float, 1024> vertexArray;
 
 	sPainter.enableClientStates(true, false, false);
 
 	for (int n=0; n<=nbIter; ++n)
 	{
-		if (prj->project(orbit[n],onscreen) && (vertexArray.size()==0 || !prj->intersectViewportDiscontinuity(orbit[n-1], orbit[n])))
+		// vertex n of the line: the points before current, the Planet, the other points and the first point again
+		const Vec3d& point = n<current ? orbit[n] : (n==current ? currentPos : orbit[(n-1)%nbPoints]);
+		if (prj->project(point,onscreen) && (vertexArray.size()==0 || !prj->intersectViewportDiscontinuity(previous, point)))
 		{
 			vertexArray.append(onscreen[0]);
 			vertexArray.append(onscreen[1]);
@@ -3056,8 +3013,8 @@ void Planet::drawOrbit(const StelCore* core)
 			sPainter.drawFromArray(StelPainter::LineStrip, vertexArray.size()/2, 0, false);
 			vertexArray.clear();
 		}
+		previous = point;
 	}
-	orbit[ORBIT_SEGMENTS/2]=savePos;
 	if (!vertexArray.isEmpty())
 	{
 		sPainter.setVertexPointer(2, GL_FLOAT, vertexArray.constData());
@@ -3071,6 +3028,12 @@ void Planet::update(int deltaTime)
 	hintFader.update(deltaTime);
 	labelsFader.update(deltaTime);
 	orbitFader.update(deltaTime);
+	// Release the orbit points of hidden orbits, they are recomputed when the orbit is shown again.
+	if (!orbitFader.getInterstate() && !orbit.isEmpty())
+	{
+		orbit = QVector<Vec3d>();
+		orbitPath.clear();
+	}
 }
 
 void Planet::setApparentMagnitudeAlgorithm(QString algorithm)
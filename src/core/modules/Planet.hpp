@@ -27,6 +27,7 @@
 #include "StelFader.hpp"
 #include "StelTextureTypes.hpp"
 #include "StelProjectorType.hpp"
+#include "OrbitPath.hpp"
 
 #include <QString>
 
@@ -34,12 +35,14 @@
 // The last variable is the userData pointer.
 typedef void (*posFuncType)(double, double*, void*);
 
-typedef void (OsculatingFunctType)(double jde0,double jde,double xyz[3]);
+// The last variable is the EphemContext of the planet, see Planet::ephemContext.
+typedef void (OsculatingFunctType)(double jde0,double jde,double xyz[3], void*);
 
 // epoch J2000: 12 UT on 1 Jan 2000
 #define J2000 2451545.0
 #define ORBIT_SEGMENTS 360
 
+class EphemContext;
 class StelFont;
 class StelPainter;
 class StelTranslator;
@@ -232,6 +235,8 @@ public:
 	const QString& getTextMapName() const {return texMapName;}
 	const QString getPlanetTypeString() const {return pTypeMap.value(pType);}
 	PlanetType getPlanetType() const {return pType;}
+	//! Hidden bodies are used as observation positions, they are not drawn.
+	bool isHidden() const {return hidden;}
 
 	void setNativeName(QString planet) { nativeName = planet; }
 
@@ -328,22 +333,33 @@ public:
 	///////////////////////////////////////////////////////////////////////////
 	// DEPRECATED
 	///// Orbit related code
-	// Should move to an OrbitPath class which works on a SolarSystemObject, not a Planet
+	// The points of the orbit are sampled by OrbitPath.
 	void setFlagOrbits(bool b){orbitFader = b;}
 	bool getFlagOrbits(void) const {return orbitFader;}
 	LinearFader orbitFader;
 	// draw orbital path of Planet
 	void drawOrbit(const StelCore*);
-	Vec3d orbit[ORBIT_SEGMENTS+1];  // store heliocentric coordinates for drawing the orbit
-	Vec3d orbitP[ORBIT_SEGMENTS+1]; // store local coordinate for orbit
-	double lastOrbitJDE;
+	// orbitObserverPos in the frame of the parent body
+	Vec3d getOrbitObserverPos() const;
+	// whether the points of orbitPath can be drawn at dateJDE
+	bool isOrbitPathValid(double dateJDE) const;
+	// sample or move orbitPath for dateJDE
+	void updateOrbitPath(double dateJDE);
+	QVector<Vec3d> orbit;           // store heliocentric coordinates of the points of orbitPath while the orbit is shown
+	OrbitPath orbitPath;            // store local coordinates for orbit, released with orbit when the orbit fades out
 	double deltaJDE;                // time difference between positional updates.
-	double deltaOrbitJDE;
-	bool orbitCached;               // whether orbit calculations are cached for drawing orbit yet
+	double deltaOrbitJDE;           // time difference between moves of the orbit line along the orbit
+	bool fixedOrbitElements;        // whether the orbital elements never change (Keplerian orbits), set by SolarSystem
 	bool closeOrbit;                // whether to connect the beginning of the orbit line to
 					// the end: good for elliptical orbits, bad for parabolic
 					// and hyperbolic orbits
 
+	// Largest error of the orbit lines, in radians, and the heliocentric position of the observer it is seen from.
+	static double orbitAngularTolerance;
+	static void setOrbitAngularTolerance(double tolerance) {orbitAngularTolerance = tolerance;}
+	static Vec3d orbitObserverPos;
+	static void setOrbitObserverPos(const Vec3d& pos) {orbitObserverPos = pos;}
+
 	static Vec3f orbitColor;
 	static void setOrbitColor(const Vec3f& oc) {orbitColor = oc;}
 	static const Vec3f& getOrbitColor() {return orbitColor;}
@@ -531,6 +547,11 @@ protected:
 	// The callback for the calculation of the equatorial rect heliocentric position at time JDE.
 	posFuncType coordFunc;
 	void* orbitPtr;               // this is always used with an Orbit object.
+	// Cached elements of the analytic theory of the planet, shared with the other bodies
+	// computed by the same thread in SolarSystem::computePositions(). Null for orbits.
+	QSharedPointer<EphemContext> ephemContext;
+	// The userData pointer of coordFunc
+	void* getCoordFuncData() const {return orbitPtr ? orbitPtr : ephemContext.data();}
 
 	OsculatingFunctType *const osculatingFunc;
 	QSharedPointer<Planet> parent;           // Planet parent i.e. sun for earth
@@ -560,6 +581,8 @@ protected:
 	static double customGrsDrift;		// Annual drift of Great Red Spot position (degrees)
 
 private:
+	class OrbitPositions;
+
 	QString iauMoonNumber;
 
 	// Shader-related variables
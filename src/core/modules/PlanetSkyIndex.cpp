@@ -0,0 +1,135 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "PlanetSkyIndex.hpp"
+#include "StelGeodesicGrid.hpp"
+#include "StelSphereGeometry.hpp"
+
+#include <cmath>
+
+// Largest angular radius in degrees of the bucketed bodies
+#define MAX_BUCKETED_BODY_SIZE 1.
+// Above this radius in degrees, a query returns all bodies.
+#define MAX_ZONE_SEARCH_FOV 30.
+
+PlanetSkyIndex::PlanetSkyIndex()
+{
+}
+
+void PlanetSkyIndex::clear()
+{
+	zoneStart.clear();
+	zoneBodies.clear();
+	largeBodies.clear();
+}
+
+void PlanetSkyIndex::build(const StelGeodesicGrid* grid, const QVector<Vec3d>& pos, const QVector<double>& angularSize)
+{
+	Q_ASSERT(grid->getMaxLevel()>=GridLevel);
+	Q_ASSERT(pos.size()==angularSize.size());
+	const int nrOfZones = StelGeodesicGrid::nrOfZones(GridLevel);
+	QVector<int> zoneOfBody(pos.size(), -1);
+	zoneStart.fill(0, nrOfZones+1);
+	largeBodies.clear();
+	for (int i=0;i<pos.size();++i)
+	{
+		const double length = pos.at(i).length();
+		if (!(length>0.))
+			continue;
+		if (angularSize.at(i)>MAX_BUCKETED_BODY_SIZE)
+		{
+			largeBodies.append(i);
+			continue;
+		}
+		const Vec3d& p = pos.at(i);
+		const Vec3f v(p[0]/length, p[1]/length, p[2]/length);
+		const int zone = grid->getZoneNumberForPoint(v, GridLevel);
+		zoneOfBody[i] = zone;
+		zoneStart[zone+1]++;
+	}
+	for (int z=0;z<nrOfZones;++z)
+		zoneStart[z+1] += zoneStart.at(z);
+
+	zoneBodies.resize(zoneStart.last());
+	QVector<int> filled(zoneStart);
+	for (int i=0;i<zoneOfBody.size();++i)
+	{
+		if (zoneOfBody.at(i)>=0)
+			zoneBodies[filled[zoneOfBody.at(i)]++] = i;
+	}
+}
+
+void PlanetSkyIndex::query(const StelGeodesicGrid* grid, const Vec3d& v, double limFov, QVector<int>& result) const
+{
+	result = largeBodies;
+	if (zoneBodies.isEmpty())
+		return;
+	// A bucketed body reaches v when its center is within its angular size of v.
+	// The margin covers the single precision of the zones.
+	const double fov = qMax(limFov, MAX_BUCKETED_BODY_SIZE) + 1e-4;
+	if (fov>MAX_ZONE_SEARCH_FOV)
+	{
+		result += zoneBodies;
+		return;
+	}
+
+	// Same region as StarMgr::searchAround(): a square around the circle of radius fov,
+	// whose edges are great circles, as required by StelGeodesicGrid::search().
+	int i;
+	{
+		const double a0 = std::fabs(v[0]);
+		const double a1 = std::fabs(v[1]);
+		const double a2 = std::fabs(v[2]);
+		if (a0 <= a1)
+			i = (a0 <= a2) ? 0 : 2;
+		else
+			i = (a1 <= a2) ? 1 : 2;
+	}
+	Vec3d h0(0.0,0.0,0.0);
+	h0[i] = 1.0;
+	Vec3d h1 = h0 ^ v;
+	h1.normalize();
+	h0 = h1 ^ v;
+	h0.normalize();
+	const double f = 1.4142136 * std::tan(fov * M_PI/180.0);
+	h0 *= f;
+	h1 *= f;
+	Vec3d e0 = v + h0;
+	Vec3d e1 = v + h1;
+	Vec3d e2 = v - h0;
+	Vec3d e3 = v - h1;
+	e0.normalize();
+	e1.normalize();
+	e2.normalize();
+	e3.normalize();
+	const SphericalConvexPolygon square(e3, e2, e1, e0);
+	const GeodesicSearchResult* zones = grid->search(square.getBoundingSphericalCaps(), GridLevel);
+
+	int zone;
+	for (GeodesicSearchInsideIterator it(*zones, GridLevel);(zone = it.next()) >= 0;)
+		appendZone(zone, result);
+	for (GeodesicSearchBorderIterator it(*zones, GridLevel);(zone = it.next()) >= 0;)
+		appendZone(zone, result);
+}
+
+void PlanetSkyIndex::appendZone(int zone, QVector<int>& result) const
+{
+	for (int k=zoneStart.at(zone);k<zoneStart.at(zone+1);++k)
+		result.append(zoneBodies.at(k));
+}
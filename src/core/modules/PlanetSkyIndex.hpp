@@ -0,0 +1,67 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _PLANETSKYINDEX_HPP_
+#define _PLANETSKYINDEX_HPP_
+
+#include "VecMath.hpp"
+
+#include <QVector>
+
+class StelGeodesicGrid;
+
+//! @class PlanetSkyIndex
+//! Index of the directions of the solar system bodies as seen by the observer, used by
+//! SolarSystem::search() and SolarSystem::searchAround().
+//! The bodies are bucketed by the zones of a StelGeodesicGrid, so that a cone search only looks
+//! at the bodies of the zones touching the cone. The few bodies with a large angular size
+//! (the Sun, the Moon, the planets seen from close) are kept apart and returned by all queries.
+class PlanetSkyIndex
+{
+public:
+	//! Level of the StelGeodesicGrid zones, about 1.6 degrees wide.
+	static const int GridLevel = 5;
+
+	PlanetSkyIndex();
+
+	//! Build the index.
+	//! @param grid a grid of at least GridLevel levels
+	//! @param pos J2000 equatorial positions of the bodies relative to the observer. The bodies
+	//! with a null position (the observer's planet) are not indexed.
+	//! @param angularSize angular radius of the bodies in degrees
+	void build(const StelGeodesicGrid* grid, const QVector<Vec3d>& pos, const QVector<double>& angularSize);
+	//! Remove all bodies.
+	void clear();
+
+	//! Get the indices of the bodies which may lie within @em limFov degrees of the normalized
+	//! J2000 direction @em v, or whose angular size may reach @em v. The caller has to do the exact test.
+	void query(const StelGeodesicGrid* grid, const Vec3d& v, double limFov, QVector<int>& result) const;
+
+private:
+	void appendZone(int zone, QVector<int>& result) const;
+
+	//! Index of the first body of each zone in zoneBodies, and the end of the last zone.
+	QVector<int> zoneStart;
+	//! The indexed bodies, grouped by zone.
+	QVector<int> zoneBodies;
+	//! The bodies larger than the bucketed ones.
+	QVector<int> largeBodies;
+};
+
+#endif // _PLANETSKYINDEX_HPP_
@@ -22,9 +22,11 @@
 #include "SolarSystem.hpp"
 #include "StelTexture.hpp"
 #include "EphemWrapper.hpp"
+#include "EphemContext.hpp"
 #include "Orbit.hpp"
 
 #include "StelProjector.hpp"
+#include "StelSphereGeometry.hpp"
 #include "StelApp.hpp"
 #include "StelCore.hpp"
 #include "StelTextureMgr.hpp"
@@ -33,10 +35,11 @@
 #include "StelSkyCultureMgr.hpp"
 #include "StelFileMgr.hpp"
 #include "StelModuleMgr.hpp"
-#include "StelIniParser.hpp"
+#include "SolarSystemIniCache.hpp"
 #include "Planet.hpp"
 #include "MinorPlanet.hpp"
 #include "Comet.hpp"
+#include "StelGeodesicGrid.hpp"
 #include "StelMainView.hpp"
 
 #include "StelSkyDrawer.hpp"
@@ -60,6 +63,8 @@
 #include <QMapIterator>
 #include <QDebug>
 #include <QDir>
+#include <QFileInfo>
+#include <QtConcurrent>
 
 SolarSystem::SolarSystem()
 	: shadowPlanetCount(0)
@@ -72,6 +77,10 @@ SolarSystem::SolarSystem()
 	, flagLightTravelTime(true)
 	, flagUseObjModels(false)
 	, flagShowObjSelfShadows(true)
+	, flagParallelPositions(false)
+	, nrOfRootPositionJobs(0)
+	, positionJobsDirty(true)
+	, skyIndexDirty(true)
 	, flagShow(false)
 	, flagPointer(false)
 	, flagNativePlanetNames(false)
@@ -84,6 +93,9 @@ SolarSystem::SolarSystem()
 	, ephemerisHorizontalCoordinates(false)
 	, allTrails(Q_NULLPTR)
 	, conf(StelApp::getInstance().getSettings())
+	, compactMinorBodiesThreshold(10000)
+	, flagSolarSystemCache(true)
+	, minorBodyCatalogCursor(0)
 {
 	planetNameFont.setPixelSize(StelApp::getInstance().getBaseFontSize());
 	setObjectName("SolarSystem");
@@ -146,6 +158,8 @@ void SolarSystem::init()
 	Q_ASSERT(conf);
 
 	Planet::init();
+	compactMinorBodiesThreshold = conf->value("astro/compact_minor_bodies_threshold", 10000).toInt();
+	flagSolarSystemCache = conf->value("astro/flag_solar_system_cache", true).toBool();
 	loadPlanets();	// Load planets data
 
 	// Compute position and matrix of sun and all the satellites (ie planets)
@@ -163,6 +177,7 @@ void SolarSystem::init()
 	setLabelsAmount(conf->value("astro/labels_amount", 3.).toFloat());
 	setFlagOrbits(conf->value("astro/flag_planets_orbits").toBool());
 	setFlagLightTravelTime(conf->value("astro/flag_light_travel_time", true).toBool());
+	setFlagParallelPositions(conf->value("astro/flag_parallel_positions", false).toBool());
 	setFlagUseObjModels(conf->value("astro/flag_use_obj_models", false).toBool());
 	setFlagShowObjSelfShadows(conf->value("astro/flag_show_obj_self_shadows", true).toBool());
 	setFlagPointer(conf->value("astro/flag_planets_pointers", true).toBool());
@@ -400,11 +415,36 @@ void cometOrbitPosFunc(double jd,double xyz[3], void* userDataPtr)
 	static_cast<CometOrbit*>(userDataPtr)->positionAtTimevInVSOP87Coordinates(jd, xyz);
 }
 
+// Sections of the minor bodies which can be kept in the compact catalog: asteroid-like bodies
+// drawn with the default texture and rotation, whose data are all stored by MinorBodyCatalog.
+static bool isCompactMinorBodySection(const SolarSystemIniCache& pd, const QString& secname, const QString& englishName)
+{
+	static const QStringList types = QStringList() << "asteroid" << "dwarf planet" << "cubewano" << "plutino" << "scattered disc object" << "Oort cloud object";
+	static const QStringList keys = QStringList() << "name" << "parent" << "type" << "coord_func" << "tex_map" << "hidden" << "lighting"
+						      << "radius" << "albedo" << "color_index_bv" << "absolute_magnitude" << "slope_parameter"
+						      << "minor_planet_number" << "provisional_designation";
+	if (!types.contains(pd.value(secname+"/type").toString()) || englishName.contains("Pluto"))
+		return false;
+	if (pd.value(secname+"/tex_map", "nomap.png").toString()!="nomap.png" || pd.value(secname+"/hidden", false).toBool())
+		return false;
+	const QStringList sectionKeys = pd.childKeys(secname);
+	foreach (const QString& key, sectionKeys)
+	{
+		// orbit_Period also gives the default rotation period.
+		if (!keys.contains(key) && !(key.startsWith("orbit_") && key!="orbit_Period"))
+			return false;
+	}
+	return true;
+}
+
 // Init and load the solar system data (2 files)
 void SolarSystem::loadPlanets()
 {
 	minorBodies.clear();
 	systemMinorBodies.clear();
+	materializedMinorBodies.clear();
+	minorBodyCatalog.clear();
+	minorBodyCatalogCursor = 0;
 	qDebug() << "Loading Solar System data (1: planets and moons) ...";
 	QString solarSystemFile = StelFileMgr::findFile("data/ssystem_major.ini");
 	if (solarSystemFile.isEmpty())
@@ -452,6 +492,9 @@ void SolarSystem::loadPlanets()
 				}
 			}			
 			systemPlanets.clear();			
+			materializedMinorBodies.clear();
+			minorBodyCatalog.clear();
+			positionJobsDirty = true;
 			//Memory leak? What's the proper way of cleaning shared pointers?
 
 			// TODO: 0.16pre what about the orbits list?
@@ -495,98 +538,32 @@ bool SolarSystem::loadPlanets(const QString& filePath)
 	StelSkyDrawer* skyDrawer = StelApp::getInstance().getCore()->getSkyDrawer();
 	qDebug() << "Loading from :"  << filePath;
 	int readOk = 0;
-	QSettings pd(filePath, StelIniFormat);
-	if (pd.status() != QSettings::NoError)
-	{
-		qWarning() << "ERROR while parsing" << QDir::toNativeSeparators(filePath);
-		return false;
-	}
-
-	// QSettings does not allow us to say that the sections of the file
-	// will be listed in the same order  as in the file like the old
-	// InitParser used to so we can no longer assume that.
-	//
-	// This means we must first decide what order to read the sections
-	// of the file in (each section contains one planet/moon/asteroid/comet/...) to avoid setting
-	// the parent Planet* to one which has not yet been created.
-	//
-	// Stage 1: Make a map of body names back to the section names
-	// which they come from. Also make a map of body name to parent body
-	// name. These two maps can be made in a single pass through the
-	// sections of the file.
-	//
-	// Stage 2: Make an ordered list of section names such that each
-	// item is only ever dependent on items which appear earlier in the
-	// list.
-	// 2a: Make a QMultiMap relating the number of levels of dependency
-	//     to the body name, i.e.
-	//     0 -> Sun
-	//     1 -> Mercury
-	//     1 -> Venus
-	//     1 -> Earth
-	//     2 -> Moon
-	//     etc.
-	// 2b: Populate an ordered list of section names by iterating over
-	//     the QMultiMap.  This type of container is always sorted on the
-	//     key in ascending order, so it's easy.
-	//     i.e. [sun, earth, moon] is fine, but not [sun, moon, earth]
-	//
-	// Stage 3: iterate over the ordered sections decided in stage 2,
-	// creating the planet objects from the QSettings data.
-
-	// Stage 1 (as described above).
-	QMap<QString, QString> secNameMap;
-	QMap<QString, QString> parentMap;
-	QStringList sections = pd.childGroups();
-	// qDebug() << "Stage 1: load ini file with" << sections.size() << "entries: "<< sections;
-	for (int i=0; i<sections.size(); ++i)
-	{
-		const QString secname = sections.at(i);
-		const QString englishName = pd.value(secname+"/name").toString();
-		const QString strParent = pd.value(secname+"/parent", "Sun").toString();
-		secNameMap[englishName] = secname;
-		if (strParent!="none" && !strParent.isEmpty() && !englishName.isEmpty())
-		{
-			parentMap[englishName] = strParent;
-			// qDebug() << "parentmap[" << englishName << "] = " << strParent;
-		}
-	}
-
-	// Stage 2a (as described above).
-	QMultiMap<int, QString> depLevelMap;
-	for (int i=0; i<sections.size(); ++i)
+	// The sections of the file are read in an order where each body comes after its parent,
+	// to avoid setting the parent Planet* to one which has not yet been created.
+	// See SolarSystemIniCache for the ordering and the binary cache of large files.
+	QString cachePath;
+	if (flagSolarSystemCache)
 	{
-		const QString englishName = pd.value(sections.at(i)+"/name").toString();
-
-		// follow dependencies, incrementing level when we have one
-		// till we run out.
-		QString p=englishName;
-		int level = 0;
-		while(parentMap.contains(p) && parentMap[p]!="none")
-		{
-			level++;
-			p = parentMap[p];
-		}
-
-		depLevelMap.insert(level, secNameMap[englishName]);
-		// qDebug() << "2a: Level" << level << "secNameMap[" << englishName << "]="<< secNameMap[englishName];
+		const QFileInfo fileInfo(filePath);
+		cachePath = StelFileMgr::getCacheDir() + "/solarsystem/" + fileInfo.fileName() + "-"
+			    + QString::number(qHash(fileInfo.absoluteFilePath()), 16) + ".cache";
 	}
-
-	// Stage 2b (as described above).
-	// qDebug() << "Stage 2b:";
-	QStringList orderedSections;
-	QMapIterator<int, QString> levelMapIt(depLevelMap);
-	while(levelMapIt.hasNext())
+	SolarSystemIniCache pd;
+	if (!pd.load(filePath, cachePath))
 	{
-		levelMapIt.next();
-		orderedSections << levelMapIt.value();
+		qWarning() << "ERROR while parsing" << QDir::toNativeSeparators(filePath);
+		return false;
 	}
-	// qDebug() << orderedSections;
+	if (pd.isLoadedFromCache())
+		qDebug() << "Using the solar system cache" << QDir::toNativeSeparators(cachePath);
+	const QStringList orderedSections = pd.getOrderedSections();
 
-	// Stage 3 (as described above).
 	//int readOk=0;
 	//int totalPlanets=0;
 
+	// In large files, most asteroids are only kept in the compact catalog.
+	const bool compactMinorBodies = compactMinorBodiesThreshold>0 && orderedSections.size()>compactMinorBodiesThreshold;
+
 	// qDebug() << "Adding " << orderedSections.size() << "objects...";
 	for (int i = 0;i<orderedSections.size();++i)
 	{
@@ -816,6 +793,33 @@ bool SolarSystem::loadPlanets(const QString& filePath)
 							J2000NodeOrigin.normalize();
 							parent_rot_j2000_longitude = atan2(J2000NodeOrigin*OrbitAxis1,J2000NodeOrigin*OrbitAxis0);
 						}
+			if (compactMinorBodies && !parent->getParent() && isCompactMinorBodySection(pd, secname, englishName))
+			{
+				MinorBodyCatalog::Body body;
+				body.englishName = englishName;
+				body.provisionalDesignation = pd.value(secname+"/provisional_designation").toString();
+				body.type = pd.value(secname+"/type").toString();
+				body.minorPlanetNumber = pd.value(secname+"/minor_planet_number", 0).toInt();
+				body.pericenterDistance = pericenterDistance;
+				body.eccentricity = eccentricity;
+				body.inclination = inclination;
+				body.ascendingNode = ascending_node;
+				body.argOfPericenter = arg_of_pericenter;
+				body.timeAtPericenter = time_at_pericenter;
+				body.meanMotion = meanMotion;
+				body.orbitGoodDays = orbitGoodDays;
+				body.orbitVisualizationPeriod = pd.value(secname+"/orbit_visualization_period", 0.).toDouble();
+				body.absoluteMagnitude = pd.value(secname+"/absolute_magnitude", -99.f).toFloat();
+				const float slope = pd.value(secname+"/slope_parameter", 0.15f).toFloat();
+				body.slopeParameter = (slope >= 0.f && slope <= 1.f) ? slope : 0.15f;
+				body.albedo = pd.value(secname+"/albedo", 0.25f).toFloat();
+				body.radius = pd.value(secname+"/radius").toFloat();
+				body.colorIndexBV = pd.value(secname+"/color_index_bv", 99.f).toFloat();
+				minorBodyCatalog.append(body);
+				readOk++;
+				continue;
+			}
+
 			//qDebug() << "Creating CometOrbit for" << englishName;
 			CometOrbit *orb = new CometOrbit(pericenterDistance,
 							 eccentricity,
@@ -1158,6 +1162,7 @@ bool SolarSystem::loadPlanets(const QString& filePath)
 		}
 
 		systemPlanets.push_back(p);
+		positionJobsDirty = true;
 		readOk++;
 	}
 
@@ -1180,20 +1185,227 @@ bool SolarSystem::loadPlanets(const QString& filePath)
 
 	if (readOk>0)
 		qDebug() << "Loaded" << readOk << "Solar System bodies";
+	if (minorBodyCatalog.size()>0)
+	{
+		minorBodyCatalog.squeeze();
+		qDebug() << "Compact minor body catalog:" << minorBodyCatalog.size() << "bodies," << minorBodyCatalog.getMemoryUsage()/1024 << "kB";
+	}
 
 	return true;
 }
 
+// A step of computePositions(), run on the bodies of each job.
+class PlanetPositionStep
+{
+public:
+	enum Step
+	{
+		PositionsWithoutOrbits,	// Planet::computePositionWithoutOrbits()
+		Positions,		// Planet::computePosition()
+		TransMatrices		// Planet::computeTransMatrix()
+	};
+
+	PlanetPositionStep(const QVector<Planet*>& positionOrder, Step step, bool lightTravelTime, double dateJDE,
+			   double dateJD=0., const Vec3d& observerPos=Vec3d(0.))
+		: planets(positionOrder.constData())
+		, step(step)
+		, lightTravelTime(lightTravelTime)
+		, dateJDE(dateJDE)
+		, dateJD(dateJD)
+		, observerPos(observerPos)
+	{
+	}
+
+	void operator()(const PlanetPositionJob& job) const
+	{
+		for (Planet* const* it=planets+job.first;it<planets+job.first+job.count;++it)
+		{
+			Planet* p = *it;
+			const double light_speed_correction = lightTravelTime ? (p->getHeliocentricEclipticPos()-observerPos).length() * (AU / (SPEED_OF_LIGHT * 86400.)) : 0.;
+			switch (step)
+			{
+				case PositionsWithoutOrbits:
+					p->computePositionWithoutOrbits(dateJDE);
+					break;
+				case Positions:
+					p->computePosition(dateJDE-light_speed_correction);
+					break;
+				case TransMatrices:
+					p->computeTransMatrix(dateJD-light_speed_correction, dateJDE-light_speed_correction);
+					break;
+			}
+		}
+	}
+
+private:
+	Planet* const* planets;
+	Step step;
+	bool lightTravelTime;
+	double dateJDE;
+	double dateJD;
+	Vec3d observerPos;
+};
+
+// Run the step on the jobs of the bodies without parent first, then on the other jobs,
+// which don't share any data and can be computed in parallel.
+static void runPlanetPositionStep(QVector<PlanetPositionJob>& jobs, int nrOfRootJobs, bool parallel, const PlanetPositionStep& step)
+{
+	for (int i=0;i<nrOfRootJobs;++i)
+		step(jobs.at(i));
+	if (parallel)
+		QtConcurrent::blockingMap(jobs.begin()+nrOfRootJobs, jobs.end(), step);
+	else
+	{
+		for (int i=nrOfRootJobs;i<jobs.size();++i)
+			step(jobs.at(i));
+	}
+}
+
+void SolarSystem::updatePositionJobs()
+{
+	// The root of a job is the body orbiting the Sun, or a body without parent.
+	QHash<const Planet*, int> jobOfRoot;
+	QVector<const Planet*> roots;
+	QVector<int> jobOfPlanet;
+	QVector<PlanetPositionJob> jobs;
+	jobOfPlanet.reserve(systemPlanets.size());
+	foreach (const PlanetP& p, systemPlanets)
+	{
+		const Planet* root = p.data();
+		while (root->parent && root->parent->parent)
+			root = root->parent.data();
+		QHash<const Planet*, int>::const_iterator it = jobOfRoot.constFind(root);
+		if (it==jobOfRoot.constEnd())
+		{
+			it = jobOfRoot.insert(root, jobs.size());
+			const PlanetPositionJob job = {0, 0};
+			jobs.append(job);
+			roots.append(root);
+		}
+		jobOfPlanet.append(it.value());
+		jobs[it.value()].count++;
+	}
+
+	// Lay out the jobs without parent first.
+	positionJobs.clear();
+	positionJobs.reserve(jobs.size());
+	nrOfRootPositionJobs = 0;
+	int first = 0;
+	for (int pass=0;pass<2;++pass)
+	{
+		for (int i=0;i<jobs.size();++i)
+		{
+			if ((pass==0) != roots.at(i)->parent.isNull())
+				continue;
+			jobs[i].first = first;
+			first += jobs.at(i).count;
+			positionJobs.append(jobs.at(i));
+			if (pass==0)
+				nrOfRootPositionJobs++;
+		}
+	}
+
+	positionOrder.resize(systemPlanets.size());
+	QVector<int> filled(jobs.size(), 0);
+	for (int i=0;i<systemPlanets.size();++i)
+	{
+		const int j = jobOfPlanet.at(i);
+		positionOrder[jobs.at(j).first + filled[j]++] = systemPlanets.at(i).data();
+	}
+
+	// The bodies computed by an analytic theory share the cached elements of their job.
+	ephemContexts.clear();
+	foreach (const PlanetPositionJob& job, positionJobs)
+	{
+		QSharedPointer<EphemContext> context;
+		for (int i=job.first;i<job.first+job.count;++i)
+		{
+			Planet* p = positionOrder.at(i);
+			if (!p->orbitPtr && !context)
+			{
+				context = QSharedPointer<EphemContext>(new EphemContext());
+				ephemContexts.append(context);
+			}
+			p->ephemContext = p->orbitPtr ? QSharedPointer<EphemContext>() : context;
+		}
+	}
+
+	// The orbit lines of Keplerian orbits can be reused at all dates, see Planet::isOrbitPathValid().
+	foreach (const PlanetP& p, systemPlanets)
+		p->fixedOrbitElements = !p->osculatingFunc && (p->coordFunc==&cometOrbitPosFunc || p->coordFunc==&ellipticalOrbitPosFunc);
+
+	// The comets are left out, their tails need the velocity computed by their CometOrbit.
+	batchOrbits.clear();
+	batchPlanets.clear();
+	foreach (const PlanetP& p, systemPlanets)
+	{
+		if (!p->parent || p->parent->parent || p->osculatingFunc || p->getPlanetType()==Planet::isComet)
+			continue;
+		if (p->coordFunc==&cometOrbitPosFunc)
+			batchOrbits.append(*static_cast<const CometOrbit*>(p->orbitPtr));
+		else if (p->coordFunc==&ellipticalOrbitPosFunc)
+			batchOrbits.append(*static_cast<const EllipticalOrbit*>(p->orbitPtr));
+		else
+			continue;
+		batchPlanets.append(p.data());
+	}
+	drawOrder.setItems(positionOrder);
+	// skyIndex refers to the bodies by their index in systemPlanets.
+	skyIndexDirty = true;
+	positionJobsDirty = false;
+}
+
+void SolarSystem::computeBatchedPositions(double dateJDE, bool lightTravelTime, const Vec3d& observerPos)
+{
+	// Same dates and same test as the steps of computePositions()
+	batchIndices.resize(0);
+	batchDates.resize(0);
+	for (int i=0;i<batchPlanets.size();++i)
+	{
+		const Planet* p = batchPlanets.at(i);
+		const double light_speed_correction = lightTravelTime ? (p->getHeliocentricEclipticPos()-observerPos).length() * (AU / (SPEED_OF_LIGHT * 86400.)) : 0.;
+		const double date = dateJDE-light_speed_correction;
+		if (fabs(p->lastJDE-date)>p->deltaJDE)
+		{
+			batchIndices.append(i);
+			batchDates.append(date);
+		}
+	}
+	if (batchIndices.isEmpty())
+		return;
+
+	batchPositions.resize(3*batchIndices.size());
+	batchOrbits.computePositions(batchIndices.constData(), batchIndices.size(), batchDates.constData(), batchPositions.data());
+	for (int k=0;k<batchIndices.size();++k)
+	{
+		Planet* p = batchPlanets.at(batchIndices.at(k));
+		p->eclipticPos.set(batchPositions.at(3*k), batchPositions.at(3*k+1), batchPositions.at(3*k+2));
+		p->lastJDE = batchDates.at(k);
+	}
+}
+
 // Compute the position for every elements of the solar system.
-// The order is not important since the position is computed relatively to the mother body
+// The bodies are grouped by jobs, see PlanetPositionJob, which may be computed in parallel.
+// The result does not depend on the order of the jobs, since the position is computed relatively to the mother body.
 void SolarSystem::computePositions(double dateJDE, PlanetP observerPlanet)
 {
+	if (positionJobsDirty)
+		updatePositionJobs();
+	StelCore* core = StelApp::getInstance().getCore();
+	// The orbit lines are sampled for the observer of the last frame.
+	if (observerPlanet)
+		Planet::setOrbitObserverPos(observerPlanet->getHeliocentricEclipticPos());
+	foreach (const QSharedPointer<EphemContext>& context, ephemContexts)
+	{
+		context->setDe430Active(core->de430IsActive());
+		context->setDe431Active(core->de431IsActive());
+	}
+
 	if (flagLightTravelTime)
 	{
-		foreach (PlanetP p, systemPlanets)
-		{
-			p->computePositionWithoutOrbits(dateJDE);
-		}
+		computeBatchedPositions(dateJDE, false);
+		runPlanetPositionStep(positionJobs, nrOfRootPositionJobs, flagParallelPositions,
+				      PlanetPositionStep(positionOrder, PlanetPositionStep::PositionsWithoutOrbits, false, dateJDE));
 		// BEGIN HACK: 0.16.0post for solar aberration/light time correction
 		// This fixes eclipse bug LP:#1275092) and outer planet rendering bug (LP:#1699648) introduced by the first fix in 0.16.0.
 		// We compute a "light time corrected position" for the sun and apply it only for rendering, not for other computations.
@@ -1208,53 +1420,60 @@ void SolarSystem::computePositions(double dateJDE, PlanetP observerPlanet)
 		// We must reset observerPlanet for the next step!
 		observerPlanet->computePosition(dateJDE);
 		// END HACK FOR SOLAR LIGHT TIME/ABERRATION
-		foreach (PlanetP p, systemPlanets)
-		{
-			const double light_speed_correction = (p->getHeliocentricEclipticPos()-obsPosJDE).length() * (AU / (SPEED_OF_LIGHT * 86400.));
-			p->computePosition(dateJDE-light_speed_correction);
-		}
+		computeBatchedPositions(dateJDE, true, obsPosJDE);
+		runPlanetPositionStep(positionJobs, nrOfRootPositionJobs, flagParallelPositions,
+				      PlanetPositionStep(positionOrder, PlanetPositionStep::Positions, true, dateJDE, 0., obsPosJDE));
 	}
 	else
 	{
-		foreach (PlanetP p, systemPlanets)
-		{
-			p->computePosition(dateJDE);
-		}
+		computeBatchedPositions(dateJDE, false);
+		runPlanetPositionStep(positionJobs, nrOfRootPositionJobs, flagParallelPositions,
+				      PlanetPositionStep(positionOrder, PlanetPositionStep::Positions, false, dateJDE));
 		lightTimeSunPosition.set(0.,0.,0.);
 	}
 	computeTransMatrices(dateJDE, observerPlanet->getHeliocentricEclipticPos());
+	skyIndexDirty = true;
 }
 
 // Compute the transformation matrix for every elements of the solar system.
 // The elements have to be ordered hierarchically, eg. it's important to compute earth before moon.
 void SolarSystem::computeTransMatrices(double dateJDE, const Vec3d& observerPos)
 {
+	if (positionJobsDirty)
+		updatePositionJobs();
 	double dateJD=dateJDE - (StelApp::getInstance().getCore()->computeDeltaT(dateJDE))/86400.0;
 
-	if (flagLightTravelTime)
-	{
-		foreach (PlanetP p, systemPlanets)
-		{
-			const double light_speed_correction = (p->getHeliocentricEclipticPos()-observerPos).length() * (AU / (SPEED_OF_LIGHT * 86400));
-			p->computeTransMatrix(dateJD-light_speed_correction, dateJDE-light_speed_correction);
-		}
-	}
-	else
-	{
-		foreach (PlanetP p, systemPlanets)
-		{
-			p->computeTransMatrix(dateJD, dateJDE);
-		}
-	}
+	runPlanetPositionStep(positionJobs, nrOfRootPositionJobs, flagParallelPositions,
+			      PlanetPositionStep(positionOrder, PlanetPositionStep::TransMatrices, flagLightTravelTime, dateJDE, dateJD, observerPos));
 }
 
-// And sort them from the furthest to the closest to the observer
-struct biggerDistance : public std::binary_function<PlanetP, PlanetP, bool>
+// Compute the distance of the bodies to the observer for DrawOrder, and cull the bodies which
+// Planet::draw() would not draw anyway: the hidden bodies, and the minor bodies too faint to be seen.
+class PlanetDrawFilter
 {
-	bool operator()(PlanetP p1, PlanetP p2)
+public:
+	PlanetDrawFilter(const StelCore* core)
+		: core(core)
+		, obsHelioPos(core->getObserverHeliocentricEclipticPos())
+		, limitMagnitude(core->getSkyDrawer()->getLimitMagnitude())
+		, observerView(core->getCurrentLocation().planetName.contains("Observer", Qt::CaseInsensitive))
+	{
+	}
+
+	bool operator()(Planet* p, double& distance) const
 	{
-		return p1->getDistance() > p2->getDistance();
+		distance = p->computeDistance(obsHelioPos);
+		if (p->isHidden())
+			return false;
+		// Same test as Planet::draw()
+		return !(p->getPlanetType()>=Planet::isAsteroid && !observerView && (p->getVMagnitude(core)-5.0f) > limitMagnitude);
 	}
+
+private:
+	const StelCore* core;
+	Vec3d obsHelioPos;
+	float limitMagnitude;
+	bool observerView;
 };
 
 // Draw all the elements of the solar system
@@ -1264,16 +1483,15 @@ void SolarSystem::draw(StelCore* core)
 	if (!flagShow)
 		return;
 
-	// Compute each Planet distance to the observer
-	Vec3d obsHelioPos = core->getObserverHeliocentricEclipticPos();
-
-	foreach (PlanetP p, systemPlanets)
-	{
-		p->computeDistance(obsHelioPos);
-	}
+	// Compute each Planet distance to the observer, and sort the drawn ones from the furthest to the closest.
+	// The order of the previous frame is nearly sorted, see DrawOrder.
+	if (positionJobsDirty)
+		updatePositionJobs();
+	PlanetDrawFilter filter(core);
+	const QVector<Planet*>& drawnPlanets = drawOrder.update(filter);
 
-	// And sort them from the furthest to the closest
-	sort(systemPlanets.begin(),systemPlanets.end(),biggerDistance());
+	// The orbit lines of the next positions are sampled with an error below one pixel.
+	Planet::setOrbitAngularTolerance(1.0/core->getProjection(StelCore::FrameHeliocentricEclipticJ2000)->getPixelPerRadAtCenter());
 
 	if (trailFader.getInterstate()>0.0000001f)
 	{
@@ -1288,7 +1506,7 @@ void SolarSystem::draw(StelCore* core)
 			5.f+(core->getSkyDrawer()->getLimitMagnitude()-5.f)*1.2f) +(labelsAmount-3.f)*1.2f;
 
 	// Draw the elements
-	foreach (const PlanetP& p, systemPlanets)
+	foreach (Planet* p, drawnPlanets)
 	{
 		p->draw(core, maxMagLabel, planetNameFont);
 	}
@@ -1372,6 +1590,29 @@ PlanetP SolarSystem::searchMinorPlanetByEnglishName(QString planetEnglishName) c
 	return PlanetP();
 }
 
+PlanetP SolarSystem::materializeByEnglishName(const QString& englishName)
+{
+	PlanetP p = searchByEnglishName(englishName);
+	if (p.isNull()) // Possible was asked the common name of minor planet?
+		p = searchMinorPlanetByEnglishName(englishName);
+	if (p.isNull())
+	{
+		const int index = searchCatalogMinorBody(englishName);
+		if (index>=0)
+			p = materializeMinorBody(index);
+	}
+	return p;
+}
+
+StelObjectP SolarSystem::materializeByName(const QString& name)
+{
+	// The names of the minor bodies are not translated, the english name is also the name in the sky culture.
+	const int index = searchCatalogMinorBody(name);
+	if (index>=0)
+		return qSharedPointerCast<StelObject>(materializeMinorBody(index));
+	return StelObjectP();
+}
+
 
 StelObjectP SolarSystem::searchByNameI18n(const QString& planetNameI18) const
 {
@@ -1394,11 +1635,146 @@ StelObjectP SolarSystem::searchByName(const QString& name) const
 	return StelObjectP();
 }
 
-float SolarSystem::getPlanetVMagnitude(QString planetName, bool withExtinction) const
+int SolarSystem::searchCatalogMinorBody(const QString& englishName) const
 {
-	PlanetP p = searchByEnglishName(planetName);
-	if (p.isNull()) // Possible was asked the common name of minor planet?
-		p = searchMinorPlanetByEnglishName(planetName);
+	if (minorBodyCatalog.size()==0)
+		return -1;
+	int index = minorBodyCatalog.indexOf(englishName);
+	if (index<0 && englishName.startsWith('('))
+	{
+		// "(number) name", see MinorPlanet::getEnglishName()
+		const int end = englishName.indexOf(") ");
+		if (end>0)
+		{
+			index = minorBodyCatalog.indexOf(englishName.mid(end+2));
+			if (index>=0 && QString::number(minorBodyCatalog.getMinorPlanetNumber(index))!=englishName.mid(1, end-1))
+				index = -1;
+		}
+	}
+	return index;
+}
+
+void SolarSystem::deleteCatalogMinorPlanet(MinorPlanet* p)
+{
+	CometOrbit* orbit = static_cast<CometOrbit*>(static_cast<Planet*>(p)->orbitPtr);
+	delete p;
+	delete orbit;
+}
+
+PlanetP SolarSystem::materializeMinorBody(int index)
+{
+	PlanetP p = materializedMinorBodies.value(index);
+	if (p)
+		return p;
+
+	const MinorBodyCatalog::Body body = minorBodyCatalog.getBody(index);
+	StelCore* core = StelApp::getInstance().getCore();
+	Vec3f color = Vec3f(1.f, 1.f, 1.f);
+	if (body.colorIndexBV<99.f)
+		color = core->getSkyDrawer()->indexToColor(BvToColorIndex(body.colorIndexBV))*0.75f;
+	// Same as loadPlanets() for a body orbiting the Sun, but the object owns its orbit.
+	CometOrbit* orb = new CometOrbit(body.pericenterDistance, body.eccentricity, body.inclination, body.ascendingNode,
+					 body.argOfPericenter, body.timeAtPericenter, body.orbitGoodDays, body.meanMotion, 0., 0., 0.);
+	QSharedPointer<MinorPlanet> mp(new MinorPlanet(body.englishName, body.radius/AU, 0.0, color, body.albedo, 0.9f,
+						       "nomap.png", "", &cometOrbitPosFunc, orb, Q_NULLPTR,
+						       body.eccentricity<1.0, false, body.type),
+				       &SolarSystem::deleteCatalogMinorPlanet);
+	if (body.minorPlanetNumber)
+		mp->setMinorPlanetNumber(body.minorPlanetNumber);
+	if (!body.provisionalDesignation.isEmpty())
+		mp->setProvisionalDesignation(body.provisionalDesignation);
+	if (body.absoluteMagnitude > -99.f)
+		mp->setAbsoluteMagnitudeAndSlope(body.absoluteMagnitude, body.slopeParameter);
+	mp->setSemiMajorAxis(body.eccentricity<1.0 ? body.pericenterDistance/(1.0-body.eccentricity) : 0.);
+	mp->setColorIndexBV(body.colorIndexBV);
+	mp->setSpectralType();
+	mp->setRotationElements(1., 0., J2000, 0., 0., 0., body.orbitVisualizationPeriod);
+	p = mp;
+
+	// Apply the settings applied to the other bodies
+	p->setFlagHints(getFlagHints());
+	p->setFlagLabels(getFlagLabels());
+	p->setFlagOrbits(flagOrbits && (!selected || selected==sun));
+	if (flagMinorBodyScale)
+		p->setSphereScale(minorBodyScale);
+	p->translateName(StelApp::getInstance().getLocaleMgr().getSkyTranslator());
+
+	p->parent = sun;
+	sun->satellites.append(p);
+	systemPlanets.push_back(p);
+	systemMinorBodies.push_back(p);
+	positionJobsDirty = true;
+	materializedMinorBodies.insert(index, p);
+	minorBodyCatalog.setMaterialized(index, true);
+
+	// The next computePositions() will include the new body, until then it needs a position.
+	p->computePosition(core->getJDE());
+	p->computeTransMatrix(core->getJD(), core->getJDE());
+	p->computeDistance(core->getObserverHeliocentricEclipticPos());
+	return p;
+}
+
+void SolarSystem::dematerializeMinorBody(int index)
+{
+	minorBodyCatalog.setMaterialized(index, false);
+	PlanetP p = materializedMinorBodies.take(index);
+	if (!p)
+		return;
+	sun->satellites.removeOne(p);
+	systemPlanets.removeOne(p);
+	systemMinorBodies.removeOne(p);
+	positionJobsDirty = true;
+}
+
+// Number of bodies of the compact catalog checked at each frame. At 60 frames per second,
+// a catalog of a million bodies is checked in about 2 seconds.
+static const int MINOR_BODY_CATALOG_SLICE = 8192;
+// Margin on the limiting magnitude, for the approximations of MinorBodyCatalog::estimateMagnitude().
+static const float MINOR_BODY_MAGNITUDE_MARGIN = 1.f;
+
+void SolarSystem::updateMaterializedMinorBodies(const StelCore* core)
+{
+	const int n = minorBodyCatalog.size();
+	if (n==0)
+		return;
+	if (minorBodyCatalogCursor>=n)
+		minorBodyCatalogCursor = 0;
+	const int first = minorBodyCatalogCursor;
+	const int count = qMin(MINOR_BODY_CATALOG_SLICE, n-first);
+	minorBodyCatalogCursor += count;
+	minorBodyCatalog.updateApproxPositions(first, count, core->getJDE());
+
+	const bool show = getFlagPlanets();
+	const Vec3d observerPos = core->getObserverHeliocentricEclipticPos();
+	const float limitMagnitude = core->getSkyDrawer()->getLimitMagnitude() + MINOR_BODY_MAGNITUDE_MARGIN;
+	const StelProjectorP prj = core->getProjection(StelCore::FrameJ2000);
+	const SphericalCap& viewCap = prj->getBoundingCap();
+	for (int i=first;i<first+count;++i)
+	{
+		if (minorBodyCatalog.isRemoved(i))
+			continue;
+		bool visible = show && minorBodyCatalog.estimateMagnitude(i, observerPos)<=limitMagnitude;
+		if (visible)
+		{
+			Vec3d dir = StelCore::matVsop87ToJ2000.multiplyWithoutTranslation(minorBodyCatalog.getApproxPosition(i)-observerPos);
+			dir.normalize();
+			visible = viewCap.contains(dir);
+		}
+		if (visible && !minorBodyCatalog.isMaterialized(i))
+			materializeMinorBody(i);
+		else if (!visible && minorBodyCatalog.isMaterialized(i))
+		{
+			// Keep the selected body and the body of the observer.
+			const PlanetP p = materializedMinorBodies.value(i);
+			if (p!=selected && p!=core->getCurrentPlanet())
+				dematerializeMinorBody(i);
+		}
+	}
+}
+
+float SolarSystem::getPlanetVMagnitude(QString planetName, bool withExtinction)
+{
+	PlanetP p = materializeByEnglishName(planetName);
 	float r = 0.f;
 	if (withExtinction)
 		r = p->getVMagnitudeWithExtinction(StelApp::getInstance().getCore());
@@ -1407,49 +1783,39 @@ float SolarSystem::getPlanetVMagnitude(QString planetName, bool withExtinction)
 	return r;
 }
 
-QString SolarSystem::getPlanetType(QString planetName) const
+QString SolarSystem::getPlanetType(QString planetName)
 {
-	PlanetP p = searchByEnglishName(planetName);
-	if (p.isNull()) // Possible was asked the common name of minor planet?
-		p = searchMinorPlanetByEnglishName(planetName);
+	PlanetP p = materializeByEnglishName(planetName);
 	return p->getPlanetTypeString();
 }
 
-double SolarSystem::getDistanceToPlanet(QString planetName) const
+double SolarSystem::getDistanceToPlanet(QString planetName)
 {
-	PlanetP p = searchByEnglishName(planetName);
-	if (p.isNull()) // Possible was asked the common name of minor planet?
-		p = searchMinorPlanetByEnglishName(planetName);
+	PlanetP p = materializeByEnglishName(planetName);
 	double r = 0.f;
 	r = p->getDistance();
 	return r;
 }
 
-double SolarSystem::getElongationForPlanet(QString planetName) const
+double SolarSystem::getElongationForPlanet(QString planetName)
 {
-	PlanetP p = searchByEnglishName(planetName);
-	if (p.isNull()) // Possible was asked the common name of minor planet?
-		p = searchMinorPlanetByEnglishName(planetName);
+	PlanetP p = materializeByEnglishName(planetName);
 	double r = 0.f;
 	r = p->getElongation(StelApp::getInstance().getCore()->getObserverHeliocentricEclipticPos());
 	return r;
 }
 
-double SolarSystem::getPhaseAngleForPlanet(QString planetName) const
+double SolarSystem::getPhaseAngleForPlanet(QString planetName)
 {
-	PlanetP p = searchByEnglishName(planetName);
-	if (p.isNull()) // Possible was asked the common name of minor planet?
-		p = searchMinorPlanetByEnglishName(planetName);
+	PlanetP p = materializeByEnglishName(planetName);
 	double r = 0.f;
 	r = p->getPhaseAngle(StelApp::getInstance().getCore()->getObserverHeliocentricEclipticPos());
 	return r;
 }
 
-float SolarSystem::getPhaseForPlanet(QString planetName) const
+float SolarSystem::getPhaseForPlanet(QString planetName)
 {
-	PlanetP p = searchByEnglishName(planetName);
-	if (p.isNull()) // Possible was asked the common name of minor planet?
-		p = searchMinorPlanetByEnglishName(planetName);
+	PlanetP p = materializeByEnglishName(planetName);
 	float r = 0.f;
 	r = p->getPhase(StelApp::getInstance().getCore()->getObserverHeliocentricEclipticPos());
 	return r;
@@ -1473,16 +1839,43 @@ QStringList SolarSystem::getObjectsList(QString objType) const
 	return r;
 }
 
+void SolarSystem::updateSkyIndex(const StelCore* core) const
+{
+	const Vec3d observerPos = core->getObserverHeliocentricEclipticPos();
+	if (!skyIndexDirty && !positionJobsDirty && observerPos==skyIndexObserverPos)
+		return;
+	QVector<Vec3d> pos;
+	QVector<double> angularSize;
+	pos.reserve(systemPlanets.size());
+	angularSize.reserve(systemPlanets.size());
+	foreach (const PlanetP& p, systemPlanets)
+	{
+		pos.append(p->getJ2000EquatorialPos(core));
+		angularSize.append(p->getSpheroidAngularSize(core));
+	}
+	skyIndex.build(core->getGeodesicGrid(PlanetSkyIndex::GridLevel), pos, angularSize);
+	skyIndexObserverPos = observerPos;
+	skyIndexDirty = false;
+}
+
 // Search if any Planet is close to position given in earth equatorial position and return the distance
 StelObjectP SolarSystem::search(Vec3d pos, const StelCore* core) const
 {
 	pos.normalize();
 	PlanetP closest;
-	double cos_angle_closest = 0.;
+	double cos_angle_closest = 0.999;
 	Vec3d equPos;
 
-	foreach (const PlanetP& p, systemPlanets)
+	// Only the bodies within acos(0.999) of pos can be found. They are checked in the
+	// order of systemPlanets, as without index.
+	updateSkyIndex(core);
+	QVector<int> candidates;
+	skyIndex.query(core->getGeodesicGrid(PlanetSkyIndex::GridLevel), core->equinoxEquToJ2000(pos, StelCore::RefractionOff),
+		       std::acos(0.999)*180./M_PI, candidates);
+	std::sort(candidates.begin(), candidates.end());
+	foreach (int i, candidates)
 	{
+		const PlanetP& p = systemPlanets.at(i);
 		equPos = p->getEquinoxEquatorialPos(core);
 		equPos.normalize();
 		double cos_ang_dist = equPos*pos;
@@ -1493,11 +1886,7 @@ StelObjectP SolarSystem::search(Vec3d pos, const StelCore* core) const
 		}
 	}
 
-	if (cos_angle_closest>0.999)
-	{
-		return qSharedPointerCast<StelObject>(closest);
-	}
-	else return StelObjectP();
+	return qSharedPointerCast<StelObject>(closest);
 }
 
 // Return a stl vector containing the planets located inside the limFov circle around position v
@@ -1513,15 +1902,25 @@ QList<StelObjectP> SolarSystem::searchAround(const Vec3d& vv, double limitFov, c
 	Vec3d equPos;
 	double cosAngularSize;
 
-	QString weAreHere = core->getCurrentPlanet()->getEnglishName();
-	foreach (const PlanetP& p, systemPlanets)
+	updateSkyIndex(core);
+	Vec3d vJ2000 = vv;
+	vJ2000.normalize();
+	QVector<int> candidates;
+	skyIndex.query(core->getGeodesicGrid(PlanetSkyIndex::GridLevel), vJ2000, limitFov, candidates);
+	std::sort(candidates.begin(), candidates.end());
+
+	const Planet* weAreHere = core->getCurrentPlanet().data();
+	foreach (int i, candidates)
 	{
+		const PlanetP& p = systemPlanets.at(i);
+		if (p.data()==weAreHere)
+			continue;
 		equPos = p->getEquinoxEquatorialPos(core);
 		equPos.normalize();
 
 		cosAngularSize = std::cos(p->getSpheroidAngularSize(core) * M_PI/180.);
 
-		if (equPos*v>=std::min(cosLimFov, cosAngularSize) && p->getEnglishName()!=weAreHere)
+		if (equPos*v>=std::min(cosLimFov, cosAngularSize))
 		{
 			result.append(qSharedPointerCast<StelObject>(p));
 		}
@@ -1670,6 +2069,8 @@ void SolarSystem::update(double deltaTime)
 		allTrails->update();
 	}
 
+	updateMaterializedMinorBodies(StelApp::getInstance().getCore());
+
 	foreach (PlanetP p, systemPlanets)
 	{
 		p->update((int)(deltaTime*1000));
@@ -1717,6 +2118,37 @@ QStringList SolarSystem::listAllObjects(bool inEnglish) const
 			result << p->getNameI18n();
 		}
 	}
+	// The names of the minor bodies are not translated.
+	for (int i=0;i<minorBodyCatalog.size();++i)
+	{
+		if (!minorBodyCatalog.isRemoved(i) && !minorBodyCatalog.isMaterialized(i))
+			result << minorBodyCatalog.getListedName(i);
+	}
+	return result;
+}
+
+QStringList SolarSystem::listMatchingObjects(const QString& objPrefix, int maxNbItem, bool useStartOfWords, bool inEnglish) const
+{
+	QStringList result;
+	if (maxNbItem <= 0)
+		return result;
+
+	foreach(const PlanetP& p, systemPlanets)
+	{
+		const QString name = inEnglish ? p->getEnglishName() : p->getNameI18n();
+		if (!matchObjectName(name, objPrefix, useStartOfWords))
+			continue;
+		result.append(name);
+		if (result.size() >= maxNbItem)
+			break;
+	}
+	// The materialized bodies were listed above with the other planets.
+	QVector<int> indexes;
+	minorBodyCatalog.findNames(objPrefix, useStartOfWords, maxNbItem-result.size(), indexes);
+	foreach (int i, indexes)
+		result.append(minorBodyCatalog.getListedName(i));
+
+	result.sort();
 	return result;
 }
 
@@ -1739,6 +2171,11 @@ QStringList SolarSystem::listAllObjectsByType(const QString &objType, bool inEng
 				result << p->getNameI18n();
 		}
 	}
+	for (int i=0;i<minorBodyCatalog.size();++i)
+	{
+		if (!minorBodyCatalog.isRemoved(i) && !minorBodyCatalog.isMaterialized(i) && minorBodyCatalog.getType(i)==objType)
+			result << minorBodyCatalog.getListedName(i);
+	}
 	return result;
 }
 
@@ -2191,6 +2628,22 @@ QStringList SolarSystem::getAllMinorPlanetCommonEnglishNames() const
 	QStringList res;
 	foreach (const PlanetP& p, systemMinorBodies)
 		res.append(p->getCommonEnglishName());
+	for (int i=0;i<minorBodyCatalog.size();++i)
+	{
+		if (!minorBodyCatalog.isRemoved(i) && !minorBodyCatalog.isMaterialized(i))
+			res.append(minorBodyCatalog.getEnglishName(i));
+	}
+	return res;
+}
+
+const QStringList SolarSystem::getMinorBodiesList() const
+{
+	QStringList res = minorBodies;
+	for (int i=0;i<minorBodyCatalog.size();++i)
+	{
+		if (!minorBodyCatalog.isRemoved(i))
+			res.append(minorBodyCatalog.getEnglishName(i));
+	}
 	return res;
 }
 
@@ -2251,6 +2704,7 @@ void SolarSystem::reloadPlanets()
 	}
 	systemPlanets.clear();
 	systemMinorBodies.clear();
+	positionJobsDirty = true;
 	// Memory leak? What's the proper way of cleaning shared pointers?
 
 	// Also delete Comet textures (loaded in loadPlanets()
@@ -2463,14 +2917,29 @@ bool SolarSystem::removeMinorPlanet(QString name)
 	PlanetP candidate = searchMinorPlanetByEnglishName(name);
 	if (!candidate)
 	{
+		// A body of the compact catalog without object is only marked as removed.
+		const int index = minorBodyCatalog.indexOf(name);
+		if (index>=0)
+		{
+			minorBodyCatalog.setRemoved(index);
+			return true;
+		}
 		qWarning() << "Cannot remove planet " << name << ": Not found.";
 		return false;
 	}
+	// The object of a body of the compact catalog, see materializeMinorBody().
+	const int index = materializedMinorBodies.key(candidate, -1);
+	if (index>=0)
+	{
+		dematerializeMinorBody(index);
+		minorBodyCatalog.setRemoved(index);
+	}
 	Orbit* orbPtr=(Orbit*) candidate->orbitPtr;
 	if (orbPtr)
 		orbits.removeOne(orbPtr);
 	systemPlanets.removeOne(candidate);
 	systemMinorBodies.removeOne(candidate);
+	positionJobsDirty = true;
 	candidate.clear();
 	return true;
 }
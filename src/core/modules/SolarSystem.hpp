@@ -28,11 +28,17 @@
 #include "StelObjectModule.hpp"
 #include "StelTextureTypes.hpp"
 #include "Planet.hpp"
+#include "MinorBodyCatalog.hpp"
+#include "KeplerBatch.hpp"
+#include "PlanetSkyIndex.hpp"
+#include "DrawOrder.hpp"
 #include "StelGui.hpp"
 
 #include <QFont>
 
 class Orbit;
+class EphemContext;
+class MinorPlanet;
 class StelTranslator;
 class StelObject;
 class StelCore;
@@ -41,6 +47,16 @@ class QSettings;
 
 typedef QSharedPointer<Planet> PlanetP;
 
+//! Bodies of the solar system whose positions are computed by one thread, see SolarSystem::computePositions().
+//! A job is a body orbiting the Sun followed by its satellites: a satellite updates the position
+//! of its parent, so they can't be computed at the same time.
+struct PlanetPositionJob
+{
+	//! Index of the first body of the job in SolarSystem::positionOrder
+	int first;
+	int count;
+};
+
 //! @class SolarSystem
 //! This StelObjectModule derivative is used to model SolarSystem bodies.
 //! This includes the Major Planets, Minor Planets and Comets.
@@ -95,6 +111,11 @@ class SolarSystem : public StelObjectModule
 		   WRITE setFlagLightTravelTime
 		   NOTIFY flagLightTravelTimeChanged
 		   )
+	Q_PROPERTY(bool flagParallelPositions
+		   READ getFlagParallelPositions
+		   WRITE setFlagParallelPositions
+		   NOTIFY flagParallelPositionsChanged
+		   )
 	Q_PROPERTY(bool flagUseObjModels
 		   READ getFlagUseObjModels
 		   WRITE setFlagUseObjModels
@@ -331,6 +352,13 @@ public:
 		return searchByName(id);
 	}
 
+	//! Create the MinorPlanet object of a body of the compact minor body catalog,
+	//! from its name with or without its minor planet number.
+	virtual StelObjectP materializeByName(const QString& name);
+
+	//! Same as StelObjectModule::listMatchingObjects(), using the name index of the
+	//! compact minor body catalog.
+	virtual QStringList listMatchingObjects(const QString& objPrefix, int maxNbItem=5, bool useStartOfWords=false, bool inEnglish=false) const;
 	virtual QStringList listAllObjects(bool inEnglish) const;
 	virtual QStringList listAllObjectsByType(const QString& objType, bool inEnglish) const;
 	virtual QString getName() const { return "Solar System"; }
@@ -384,6 +412,12 @@ public slots:
 	//! calculation is used or not.
 	bool getFlagLightTravelTime(void) const {return flagLightTravelTime;}
 
+	//! Set whether the positions of the bodies are computed in parallel on all CPU cores.
+	//! The results are the same in both modes.
+	void setFlagParallelPositions(bool b) { if(b!=flagParallelPositions) { flagParallelPositions = b; emit flagParallelPositionsChanged(b); } }
+	//! Get whether the positions of the bodies are computed in parallel.
+	bool getFlagParallelPositions(void) const { return flagParallelPositions; }
+
 	//! Set flag whether to use OBJ models for rendering, where available
 	void setFlagUseObjModels(bool b) { if(b!=flagUseObjModels) { flagUseObjModels = b; emit flagUseObjModelsChanged(b); } }
 	//! Get the current value of the flag which determines wether to use OBJ models for rendering, where available
@@ -667,32 +701,32 @@ public slots:
 	//! @param planetName the case in-sensistive English planet name.
 	//! @param withExtinction the flag for use extinction effect for magnitudes (default not use)
 	//! @return a magnitude
-	float getPlanetVMagnitude(QString planetName, bool withExtinction=false) const;
+	float getPlanetVMagnitude(QString planetName, bool withExtinction=false);
 
 	//! Get type for Solar system bodies from scripts
 	//! @param planetName the case in-sensistive English planet name.
 	//! @return a type of planet (planet, moon, asteroid, comet, plutoid)
-	QString getPlanetType(QString planetName) const;
+	QString getPlanetType(QString planetName);
 
 	//! Get distance to Solar system bodies from scripts
 	//! @param planetName the case in-sensistive English planet name.
 	//! @return a distance (in AU)
-	double getDistanceToPlanet(QString planetName) const;
+	double getDistanceToPlanet(QString planetName);
 
 	//! Get elongation for Solar system bodies from scripts
 	//! @param planetName the case in-sensistive English planet name.
 	//! @return a elongation (in radians)
-	double getElongationForPlanet(QString planetName) const;
+	double getElongationForPlanet(QString planetName);
 
 	//! Get phase angle for Solar system bodies from scripts
 	//! @param planetName the case in-sensistive English planet name.
 	//! @return a phase angle (in radians)
-	double getPhaseAngleForPlanet(QString planetName) const;
+	double getPhaseAngleForPlanet(QString planetName);
 
 	//! Get phase for Solar system bodies from scripts
 	//! @param planetName the case in-sensistive English planet name.
 	//! @return a phase
-	float getPhaseForPlanet(QString planetName) const;
+	float getPhaseForPlanet(QString planetName);
 
 	//! Set the algorithm for computation of apparent magnitudes for planets in case observer on the Earth.
 	//! Possible values:
@@ -782,6 +816,7 @@ signals:
 	void flagIsolatedOrbitsChanged(bool b);
 	void flagIsolatedTrailsChanged(bool b);
 	void flagLightTravelTimeChanged(bool b);
+	void flagParallelPositionsChanged(bool b);
 	void flagUseObjModelsChanged(bool b);
 	void flagShowObjSelfShadowsChanged(bool b);
 	void flagMoonScaleChanged(bool b);
@@ -832,6 +867,12 @@ public:
 
 	PlanetP searchMinorPlanetByEnglishName(QString planetEnglishName) const;
 
+	//! Get a pointer to a Planet object, creating the MinorPlanet object of a body of the
+	//! compact minor body catalog if needed. The searches only return existing objects.
+	//! @param englishName the English name, or the common name of a minor planet.
+	//! @return The matching planet pointer if exists or Q_NULLPTR.
+	PlanetP materializeByEnglishName(const QString& englishName);
+
 	//! Get the Planet object pointer for the Sun.
 	PlanetP getSun() const {return sun;}
 
@@ -871,8 +912,8 @@ public:
 	const QList<PlanetP>& getAllPlanets() const {return systemPlanets;}
 	//! Get the list of all the bodies of the solar system.
 	const QList<PlanetP>& getAllMinorBodies() const {return systemMinorBodies;}
-	//! Get the list of all minor bodies names.
-	const QStringList getMinorBodiesList() const { return minorBodies; }
+	//! Get the list of all minor bodies names, including the bodies of the compact catalog.
+	const QStringList getMinorBodiesList() const;
 
 	//! Get lighttime corrected solar position (essential to draw the sun during solar eclipse and compute things like eclipse factor etc, until we get aberration working.)
 	const Vec3d getLightTimeSunPosition() const { return lightTimeSunPosition; }
@@ -909,10 +950,22 @@ private:
 	//! @return a pointer to a StelObject if found, else Q_NULLPTR
 	StelObjectP search(Vec3d v, const StelCore* core) const;
 
+	//! Rebuild skyIndex if the positions of the bodies or of the observer changed since the last build.
+	void updateSkyIndex(const StelCore* core) const;
+
 	//! Compute the transformation matrix for every elements of the solar system.
 	//! observerPos is needed for light travel time computation.
 	void computeTransMatrices(double dateJDE, const Vec3d& observerPos = Vec3d(0.));
 
+	//! Group the bodies into the jobs of computePositions(), and give an EphemContext
+	//! to each job which uses the analytic theories.
+	void updatePositionJobs();
+
+	//! Compute the positions of the bodies of batchOrbits which need an update at the date @em dateJDE,
+	//! corrected for the light travel time to @em observerPos if @em lightTravelTime is set, so that
+	//! the steps of computePositions() find them up to date.
+	void computeBatchedPositions(double dateJDE, bool lightTravelTime, const Vec3d& observerPos=Vec3d(0.));
+
 	//! Draw a nice animated pointer around the object.
 	void drawPointer(const StelCore* core);
 
@@ -925,6 +978,20 @@ private:
 	//! Load planet data from the given file
 	bool loadPlanets(const QString& filePath);
 
+	//! Get the index in minorBodyCatalog of the body with the given english name,
+	//! with or without its minor planet number, or -1.
+	int searchCatalogMinorBody(const QString& englishName) const;
+	//! Create the MinorPlanet object of a body of minorBodyCatalog and add it to the solar system,
+	//! or return the existing one.
+	PlanetP materializeMinorBody(int index);
+	//! Remove the MinorPlanet object of a body of minorBodyCatalog from the solar system.
+	void dematerializeMinorBody(int index);
+	//! Create the MinorPlanet objects of the bodies of minorBodyCatalog which may be visible,
+	//! and release those which are not anymore. A slice of the catalog is checked at each call.
+	void updateMaterializedMinorBodies(const StelCore* core);
+	//! Deleter of the MinorPlanet objects of minorBodyCatalog, which own their orbit.
+	static void deleteCatalogMinorPlanet(MinorPlanet* p);
+
 	void recreateTrails();
 
 	//! Calculate a color of Solar system bodies
@@ -972,6 +1039,35 @@ private:
 	bool flagLightTravelTime;
 	bool flagUseObjModels;
 	bool flagShowObjSelfShadows;
+	bool flagParallelPositions;
+
+	//! The bodies of systemPlanets grouped by job, in the order of systemPlanets within a job.
+	QVector<Planet*> positionOrder;
+	//! The jobs of the bodies without parent (the Sun) come first, they are computed before the others.
+	QVector<PlanetPositionJob> positionJobs;
+	int nrOfRootPositionJobs;
+	//! Set when systemPlanets changes, the jobs are rebuilt by the next computePositions().
+	bool positionJobsDirty;
+	//! The contexts of the analytic theories used by the jobs.
+	QList<QSharedPointer<EphemContext> > ephemContexts;
+	//! The orbits of the bodies orbiting the Sun on fixed Keplerian orbits, comets excepted,
+	//! which are computed together by computeBatchedPositions().
+	KeplerBatch batchOrbits;
+	//! The bodies of batchOrbits, in the order of the orbits.
+	QVector<Planet*> batchPlanets;
+	//! Buffers of computeBatchedPositions()
+	QVector<int> batchIndices;
+	QVector<double> batchDates;
+	QVector<double> batchPositions;
+	//! The bodies of systemPlanets in the order of draw(), from the furthest to the closest.
+	//! Its bodies are updated with the jobs.
+	DrawOrder<Planet*> drawOrder;
+	//! Directions of the bodies of systemPlanets seen by the observer, used by search() and searchAround().
+	//! It is rebuilt by the first search after computePositions().
+	mutable PlanetSkyIndex skyIndex;
+	mutable bool skyIndexDirty;
+	//! Position of the observer when skyIndex was built
+	mutable Vec3d skyIndexObserverPos;
 
 	//! The selection pointer texture.
 	StelTextureSP texPointer;
@@ -998,6 +1094,17 @@ private:
 	QHash<QString, QString> planetNativeNamesMap;
 	QStringList minorBodies;
 
+	//! Minor bodies kept without a MinorPlanet object, see MinorBodyCatalog.
+	MinorBodyCatalog minorBodyCatalog;
+	//! The MinorPlanet objects of minorBodyCatalog, by index in the catalog.
+	QHash<int, PlanetP> materializedMinorBodies;
+	//! Files with more sections than this load their minor bodies in minorBodyCatalog, 0 to disable.
+	int compactMinorBodiesThreshold;
+	//! Load the files through SolarSystemIniCache with a binary cache file.
+	bool flagSolarSystemCache;
+	//! First body of minorBodyCatalog checked by the next updateMaterializedMinorBodies().
+	int minorBodyCatalogCursor;
+
 	Vec3d lightTimeSunPosition;			// when observing a solar eclipse, we need solar position 8 minutes ago.
 							// Direct shift caused problems (LP:#1699648), circumvented with this construction.
 	// 0.16pre observation GZ: this list contains pointers to all orbit objects,
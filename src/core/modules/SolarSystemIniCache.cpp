@@ -0,0 +1,410 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "SolarSystemIniCache.hpp"
+#include "StelIniParser.hpp"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QMultiMap>
+#include <QSaveFile>
+
+#include <cstring>
+
+// Change it when the layout of the cache or the parsing of the files changes.
+#define SOLAR_SYSTEM_CACHE_VERSION 1
+static const char cacheMagic[8] = {'S','S','Y','S','C','A','C','H'};
+
+struct SolarSystemIniCache::Header
+{
+	char magic[8];
+	quint32 version;
+	quint32 nrOfSections;
+	quint32 nrOfEntries;
+	quint32 nrOfChars;
+	char sourceHash[20];	// SHA-1 of the source file
+	quint32 reserved;
+};
+
+// Offsets and lengths are counted in QChar, in the string table.
+struct SolarSystemIniCache::Section
+{
+	quint32 name;
+	quint32 nameLength;
+	quint32 firstEntry;
+	quint32 nrOfEntries;
+};
+
+struct SolarSystemIniCache::Entry
+{
+	quint32 key;
+	quint32 keyLength;
+	quint32 value;
+	quint32 valueLength;
+};
+
+SolarSystemIniCache::SolarSystemIniCache()
+	: mappedFile(Q_NULLPTR)
+	, image(Q_NULLPTR)
+	, imageSize(0)
+	, lastSection(-1)
+{
+}
+
+SolarSystemIniCache::~SolarSystemIniCache()
+{
+	clear();
+}
+
+void SolarSystemIniCache::clear()
+{
+	sectionByName.clear();
+	lastSectionName.clear();
+	lastSection = -1;
+	if (mappedFile)
+	{
+		mappedFile->unmap(reinterpret_cast<uchar*>(const_cast<char*>(image)));
+		delete mappedFile;
+		mappedFile = Q_NULLPTR;
+	}
+	ownedImage.clear();
+	image = Q_NULLPTR;
+	imageSize = 0;
+}
+
+QByteArray SolarSystemIniCache::computeSourceHash(const QByteArray& data)
+{
+	return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+}
+
+bool SolarSystemIniCache::load(const QString& iniPath, const QString& cachePath)
+{
+	QFile file(iniPath);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	const QByteArray source = file.readAll();
+	file.close();
+	const QByteArray sourceHash = computeSourceHash(source);
+
+	if (!cachePath.isEmpty() && loadCache(cachePath, sourceHash))
+		return true;
+	if (!parse(source, sourceHash))
+		return false;
+	if (!cachePath.isEmpty())
+	{
+		QDir().mkpath(QFileInfo(cachePath).absolutePath());
+		if (!saveCache(cachePath))
+			qWarning() << "Cannot write the solar system cache" << QDir::toNativeSeparators(cachePath);
+	}
+	return true;
+}
+
+bool SolarSystemIniCache::loadIni(const QString& iniPath)
+{
+	QFile file(iniPath);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	const QByteArray source = file.readAll();
+	return parse(source, computeSourceHash(source));
+}
+
+bool SolarSystemIniCache::parse(const QByteArray& source, const QByteArray& sourceHash)
+{
+	clear();
+	// Same parser as QSettings(filePath, StelIniFormat)
+	QSettings::SettingsMap map;
+	QByteArray data(source);
+	QBuffer buffer(&data);
+	if (!buffer.open(QIODevice::ReadOnly) || !readStelIniFile(buffer, map))
+		return false;
+
+	// The keys of a section, in the order of the map. Like QSettings::childGroups(), the sections are sorted.
+	QHash<QString, QStringList> sectionKeys;
+	QStringList sections;
+	for (QSettings::SettingsMap::const_iterator it=map.constBegin();it!=map.constEnd();++it)
+	{
+		const int slash = it.key().indexOf('/');
+		if (slash<0)
+			continue;
+		const QString section = it.key().left(slash);
+		QHash<QString, QStringList>::iterator keys = sectionKeys.find(section);
+		if (keys==sectionKeys.end())
+		{
+			keys = sectionKeys.insert(section, QStringList());
+			sections << section;
+		}
+		keys->append(it.key().mid(slash+1));
+	}
+	sections.sort();
+
+	// Order the sections as described in SolarSystem::loadPlanets().
+	// Stage 1: Make a map of body names back to the section names
+	// which they come from. Also make a map of body name to parent body name.
+	QMap<QString, QString> secNameMap;
+	QMap<QString, QString> parentMap;
+	for (int i=0; i<sections.size(); ++i)
+	{
+		const QString secname = sections.at(i);
+		const QString englishName = map.value(secname+"/name").toString();
+		const QString strParent = map.value(secname+"/parent", "Sun").toString();
+		secNameMap[englishName] = secname;
+		if (strParent!="none" && !strParent.isEmpty() && !englishName.isEmpty())
+			parentMap[englishName] = strParent;
+	}
+
+	// Stage 2a: Make a QMultiMap relating the number of levels of dependency to the body name.
+	QMultiMap<int, QString> depLevelMap;
+	for (int i=0; i<sections.size(); ++i)
+	{
+		const QString englishName = map.value(sections.at(i)+"/name").toString();
+
+		// follow dependencies, incrementing level when we have one
+		// till we run out.
+		QString p=englishName;
+		int level = 0;
+		while(parentMap.contains(p) && parentMap[p]!="none")
+		{
+			level++;
+			p = parentMap[p];
+		}
+
+		depLevelMap.insert(level, secNameMap[englishName]);
+	}
+
+	// Stage 2b: Populate an ordered list of section names by iterating over the QMultiMap.
+	QStringList orderedSections;
+	QMapIterator<int, QString> levelMapIt(depLevelMap);
+	while(levelMapIt.hasNext())
+	{
+		levelMapIt.next();
+		orderedSections << levelMapIt.value();
+	}
+
+	// Build the image of the cache.
+	QString strings;
+	QVector<Section> sectionTable;
+	QVector<Entry> entryTable;
+	foreach (const QString& secname, orderedSections)
+	{
+		Section section;
+		section.name = strings.size();
+		section.nameLength = secname.size();
+		strings += secname;
+		section.firstEntry = entryTable.size();
+		const QStringList keys = sectionKeys.value(secname);
+		section.nrOfEntries = keys.size();
+		foreach (const QString& key, keys)
+		{
+			const QString value = map.value(secname+"/"+key).toString();
+			Entry entry;
+			entry.key = strings.size();
+			entry.keyLength = key.size();
+			strings += key;
+			entry.value = strings.size();
+			entry.valueLength = value.size();
+			strings += value;
+			entryTable.append(entry);
+		}
+		sectionTable.append(section);
+	}
+
+	Header h;
+	std::memcpy(h.magic, cacheMagic, sizeof(h.magic));
+	h.version = SOLAR_SYSTEM_CACHE_VERSION;
+	h.nrOfSections = sectionTable.size();
+	h.nrOfEntries = entryTable.size();
+	h.nrOfChars = strings.size();
+	Q_ASSERT(sourceHash.size()==(int)sizeof(h.sourceHash));
+	std::memcpy(h.sourceHash, sourceHash.constData(), sizeof(h.sourceHash));
+	h.reserved = 0;
+
+	QByteArray newImage;
+	newImage.append(reinterpret_cast<const char*>(&h), sizeof(Header));
+	newImage.append(reinterpret_cast<const char*>(sectionTable.constData()), sectionTable.size()*sizeof(Section));
+	newImage.append(reinterpret_cast<const char*>(entryTable.constData()), entryTable.size()*sizeof(Entry));
+	newImage.append(reinterpret_cast<const char*>(strings.constData()), strings.size()*sizeof(QChar));
+	ownedImage = newImage;
+	return setImage(ownedImage.constData(), ownedImage.size());
+}
+
+bool SolarSystemIniCache::loadCache(const QString& cachePath, const QByteArray& sourceHash)
+{
+	clear();
+	QFile* file = new QFile(cachePath);
+	if (!file->open(QIODevice::ReadOnly) || file->size()<(qint64)sizeof(Header))
+	{
+		delete file;
+		return false;
+	}
+	const qint64 size = file->size();
+	uchar* data = file->map(0, size);
+	if (data==Q_NULLPTR)
+	{
+		delete file;
+		return false;
+	}
+	const Header* h = reinterpret_cast<const Header*>(data);
+	if (sourceHash.size()!=(int)sizeof(h->sourceHash) || std::memcmp(h->sourceHash, sourceHash.constData(), sizeof(h->sourceHash))!=0
+	    || !setImage(reinterpret_cast<const char*>(data), size))
+	{
+		file->unmap(data);
+		delete file;
+		clear();
+		return false;
+	}
+	mappedFile = file;
+	return true;
+}
+
+bool SolarSystemIniCache::saveCache(const QString& cachePath) const
+{
+	if (image==Q_NULLPTR)
+		return false;
+	QSaveFile file(cachePath);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+	if (file.write(image, imageSize)!=imageSize)
+	{
+		file.cancelWriting();
+		return false;
+	}
+	return file.commit();
+}
+
+bool SolarSystemIniCache::setImage(const char* data, qint64 size)
+{
+	image = data;
+	imageSize = size;
+	const Header* h = header();
+	const qint64 expectedSize = (qint64)sizeof(Header) + (qint64)h->nrOfSections*sizeof(Section)
+				    + (qint64)h->nrOfEntries*sizeof(Entry) + (qint64)h->nrOfChars*sizeof(QChar);
+	bool ok = std::memcmp(h->magic, cacheMagic, sizeof(h->magic))==0 && h->version==SOLAR_SYSTEM_CACHE_VERSION && size==expectedSize;
+	// Check all offsets, so that a damaged cache is rejected rather than read out of bounds.
+	for (quint32 s=0;ok && s<h->nrOfSections;++s)
+	{
+		const Section& section = sections()[s];
+		ok = (qint64)section.name+section.nameLength<=h->nrOfChars
+		     && (qint64)section.firstEntry+section.nrOfEntries<=h->nrOfEntries;
+	}
+	for (quint32 e=0;ok && e<h->nrOfEntries;++e)
+	{
+		const Entry& entry = entries()[e];
+		ok = (qint64)entry.key+entry.keyLength<=h->nrOfChars && (qint64)entry.value+entry.valueLength<=h->nrOfChars;
+	}
+	if (!ok)
+	{
+		image = Q_NULLPTR;
+		imageSize = 0;
+		return false;
+	}
+
+	sectionByName.reserve(h->nrOfSections);
+	for (quint32 s=0;s<h->nrOfSections;++s)
+	{
+		const Section& section = sections()[s];
+		sectionByName.insert(QString::fromRawData(chars()+section.name, section.nameLength), s);
+	}
+	return true;
+}
+
+const SolarSystemIniCache::Header* SolarSystemIniCache::header() const
+{
+	return reinterpret_cast<const Header*>(image);
+}
+
+const SolarSystemIniCache::Section* SolarSystemIniCache::sections() const
+{
+	return reinterpret_cast<const Section*>(image+sizeof(Header));
+}
+
+const SolarSystemIniCache::Entry* SolarSystemIniCache::entries() const
+{
+	return reinterpret_cast<const Entry*>(image+sizeof(Header)+header()->nrOfSections*sizeof(Section));
+}
+
+const QChar* SolarSystemIniCache::chars() const
+{
+	return reinterpret_cast<const QChar*>(image+sizeof(Header)+header()->nrOfSections*sizeof(Section)+header()->nrOfEntries*sizeof(Entry));
+}
+
+QString SolarSystemIniCache::string(quint32 offset, quint32 length) const
+{
+	return QString(chars()+offset, length);
+}
+
+int SolarSystemIniCache::size() const
+{
+	return image ? header()->nrOfSections : 0;
+}
+
+int SolarSystemIniCache::sectionIndex(const QString& section) const
+{
+	return sectionByName.value(section, -1);
+}
+
+QStringList SolarSystemIniCache::getOrderedSections() const
+{
+	QStringList result;
+	result.reserve(size());
+	for (int s=0;s<size();++s)
+		result << string(sections()[s].name, sections()[s].nameLength);
+	return result;
+}
+
+QStringList SolarSystemIniCache::childKeys(const QString& section) const
+{
+	QStringList result;
+	const int s = sectionIndex(section);
+	if (s<0)
+		return result;
+	const Section& sec = sections()[s];
+	for (quint32 e=sec.firstEntry;e<sec.firstEntry+sec.nrOfEntries;++e)
+		result << string(entries()[e].key, entries()[e].keyLength);
+	return result;
+}
+
+QVariant SolarSystemIniCache::value(const QString& key, const QVariant& defaultValue) const
+{
+	const int slash = key.indexOf('/');
+	if (slash<0)
+		return defaultValue;
+	int s = lastSection;
+	if (s<0 || slash!=lastSectionName.size() || !key.startsWith(lastSectionName))
+	{
+		lastSectionName = key.left(slash);
+		s = lastSection = sectionIndex(lastSectionName);
+	}
+	if (s<0)
+		return defaultValue;
+
+	const QStringRef name = key.midRef(slash+1);
+	const Section& sec = sections()[s];
+	for (quint32 e=sec.firstEntry;e<sec.firstEntry+sec.nrOfEntries;++e)
+	{
+		const Entry& entry = entries()[e];
+		if (name==QString::fromRawData(chars()+entry.key, entry.keyLength))
+			return QVariant(string(entry.value, entry.valueLength));
+	}
+	return defaultValue;
+}
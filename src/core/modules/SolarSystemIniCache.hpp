@@ -0,0 +1,104 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _SOLARSYSTEMINICACHE_HPP_
+#define _SOLARSYSTEMINICACHE_HPP_
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+class QFile;
+
+//! @class SolarSystemIniCache
+//! The sections of a solar system file (ssystem_major.ini, ssystem_minor.ini), ordered so that
+//! each body comes after its parent, as SolarSystem::loadPlanets() creates them.
+//! With large minor body lists, parsing the file and ordering its sections dominates the startup.
+//! The sections are therefore also written to a binary cache file, which the next startups
+//! memory-map instead of parsing the file again. The cache holds the SHA-1 hash of the file
+//! it was made from, so that it is rebuilt when the file changes.
+//! The values are read like with QSettings: value("section/key", defaultValue).
+class SolarSystemIniCache
+{
+public:
+	SolarSystemIniCache();
+	~SolarSystemIniCache();
+
+	//! Load the sections of the file @em iniPath. If @em cachePath is not empty, they are read
+	//! from this cache file when it was made from the same file, else the file is parsed and
+	//! the cache file is written.
+	//! @return false if the file can't be read
+	bool load(const QString& iniPath, const QString& cachePath=QString());
+	//! Parse the file @em iniPath and order its sections.
+	bool loadIni(const QString& iniPath);
+	//! Map the cache file @em cachePath.
+	//! @return false if the cache is missing, invalid or not made from a file of hash @em sourceHash.
+	bool loadCache(const QString& cachePath, const QByteArray& sourceHash);
+	//! Write the loaded sections to the cache file @em cachePath.
+	bool saveCache(const QString& cachePath) const;
+	//! Remove all sections.
+	void clear();
+
+	//! Return true if the sections are read from a memory-mapped cache file.
+	bool isLoadedFromCache() const {return mappedFile!=Q_NULLPTR;}
+	//! Get the hash of the content of a source file, which keys the cache.
+	static QByteArray computeSourceHash(const QByteArray& data);
+
+	//! Get the number of sections.
+	int size() const;
+	//! Get the names of the sections, each body after its parent.
+	QStringList getOrderedSections() const;
+	//! Get the keys of a section.
+	QStringList childKeys(const QString& section) const;
+	//! Get the value of @em key, given as "section/key", or @em defaultValue if it is missing.
+	//! The values are strings, as read by QSettings from a StelIniFormat file.
+	QVariant value(const QString& key, const QVariant& defaultValue=QVariant()) const;
+
+private:
+	struct Header;
+	struct Section;
+	struct Entry;
+
+	//! Parse the content of a file and build the cache image.
+	bool parse(const QByteArray& source, const QByteArray& sourceHash);
+	//! Check the cache image at @em data and index its sections.
+	bool setImage(const char* data, qint64 size);
+	const Header* header() const;
+	const Section* sections() const;
+	const Entry* entries() const;
+	const QChar* chars() const;
+	QString string(quint32 offset, quint32 length) const;
+	//! Get the index of a section, or -1.
+	int sectionIndex(const QString& section) const;
+
+	//! The cache image, owned when the file was parsed.
+	QByteArray ownedImage;
+	QFile* mappedFile;
+	const char* image;
+	qint64 imageSize;
+	//! Index of the sections by name, the keys point into the image.
+	QHash<QString, int> sectionByName;
+	//! The last section found by value(), which is mostly called for the keys of one section after the other.
+	mutable QString lastSectionName;
+	mutable int lastSection;
+};
+
+#endif // _SOLARSYSTEMINICACHE_HPP_
@@ -0,0 +1,165 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "StarBatch.hpp"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STARBATCH_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Same arithmetic as SphericalCap::contains(const Vec3f&): float coordinates
+// promoted to double, evaluated from left to right.
+static inline bool capContains(const StarBlockCap& cap, float x, float y, float z)
+{
+	return x*cap.n[0]+y*cap.n[1]+z*cap.n[2]>=cap.d;
+}
+
+static inline int compactStarBlock(StarPositionBlock& block, const unsigned char* keep)
+{
+	int n=0;
+	for (int i=0;i<block.count;++i)
+	{
+		if (!keep[i])
+			continue;
+		block.x[n] = block.x[i];
+		block.y[n] = block.y[i];
+		block.z[n] = block.z[i];
+		block.index[n] = block.index[i];
+		++n;
+	}
+	block.count = n;
+	return n;
+}
+
+static void normalizeStarBlockScalar(StarPositionBlock& block, int from)
+{
+	for (int i=from;i<block.count;++i)
+	{
+		Vec3f v(block.x[i], block.y[i], block.z[i]);
+		v.normalize();
+		block.x[i] = v[0];
+		block.y[i] = v[1];
+		block.z[i] = v[2];
+	}
+}
+
+void normalizeStarBlock(StarPositionBlock& block)
+{
+	int i=0;
+#ifdef STARBATCH_USE_SSE2
+	// 1/sqrt(x) computed in double and rounded to float (as Vec3f::normalize does)
+	// is the same as the correctly rounded float division, so this is exact.
+	const __m128 one = _mm_set1_ps(1.f);
+	for (;i+4<=block.count;i+=4)
+	{
+		__m128 x = _mm_loadu_ps(block.x+i);
+		__m128 y = _mm_loadu_ps(block.y+i);
+		__m128 z = _mm_loadu_ps(block.z+i);
+		const __m128 l2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x,x), _mm_mul_ps(y,y)), _mm_mul_ps(z,z));
+		const __m128 s = _mm_div_ps(one, _mm_sqrt_ps(l2));
+		_mm_storeu_ps(block.x+i, _mm_mul_ps(x,s));
+		_mm_storeu_ps(block.y+i, _mm_mul_ps(y,s));
+		_mm_storeu_ps(block.z+i, _mm_mul_ps(z,s));
+	}
+#endif
+	normalizeStarBlockScalar(block, i);
+}
+
+int cullStarBlockScalar(StarPositionBlock& block, const StarBlockCap* caps, int nbCaps)
+{
+	normalizeStarBlockScalar(block, 0);
+	unsigned char keep[StarPositionBlock::Size];
+	for (int i=0;i<block.count;++i)
+	{
+		keep[i] = 1;
+		for (int c=0;c<nbCaps;++c)
+		{
+			if (!capContains(caps[c], block.x[i], block.y[i], block.z[i]))
+			{
+				keep[i] = 0;
+				break;
+			}
+		}
+	}
+	return compactStarBlock(block, keep);
+}
+
+int cullStarBlock(StarPositionBlock& block, const StarBlockCap* caps, int nbCaps)
+{
+#ifdef STARBATCH_USE_SSE2
+	normalizeStarBlock(block);
+	unsigned char keep[StarPositionBlock::Size];
+	int i=0;
+	for (;i+2<=block.count;i+=2)
+	{
+		// Two stars per iteration, in double precision.
+		const __m128d x = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(block.x+i))));
+		const __m128d y = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(block.y+i))));
+		const __m128d z = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(block.z+i))));
+		int mask = 3;
+		for (int c=0;c<nbCaps && mask;++c)
+		{
+			const StarBlockCap& cap = caps[c];
+			const __m128d dot = _mm_add_pd(_mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(cap.n[0])),
+								  _mm_mul_pd(y, _mm_set1_pd(cap.n[1]))),
+							_mm_mul_pd(z, _mm_set1_pd(cap.n[2])));
+			mask &= _mm_movemask_pd(_mm_cmpge_pd(dot, _mm_set1_pd(cap.d)));
+		}
+		keep[i] = mask & 1;
+		keep[i+1] = (mask >> 1) & 1;
+	}
+	for (;i<block.count;++i)
+	{
+		keep[i] = 1;
+		for (int c=0;c<nbCaps;++c)
+		{
+			if (!capContains(caps[c], block.x[i], block.y[i], block.z[i]))
+			{
+				keep[i] = 0;
+				break;
+			}
+		}
+	}
+	return compactStarBlock(block, keep);
+#else
+	return cullStarBlockScalar(block, caps, nbCaps);
+#endif
+}
+
+void computeStarBlockAltitudes(const StarPositionBlock& block, const float altRow[3], float* sinAlt)
+{
+	int i=0;
+#ifdef STARBATCH_USE_SSE2
+	const __m128 r0 = _mm_set1_ps(altRow[0]);
+	const __m128 r1 = _mm_set1_ps(altRow[1]);
+	const __m128 r2 = _mm_set1_ps(altRow[2]);
+	for (;i+4<=block.count;i+=4)
+	{
+		const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(block.x+i), r0),
+						       _mm_mul_ps(_mm_loadu_ps(block.y+i), r1)),
+					    _mm_mul_ps(_mm_loadu_ps(block.z+i), r2));
+		_mm_storeu_ps(sinAlt+i, d);
+	}
+#endif
+	for (;i<block.count;++i)
+		sinAlt[i] = block.x[i]*altRow[0]+block.y[i]*altRow[1]+block.z[i]*altRow[2];
+}
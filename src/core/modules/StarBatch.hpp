@@ -0,0 +1,100 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _STARBATCH_HPP_
+#define _STARBATCH_HPP_
+
+#include "ZoneData.hpp"
+#include "VecMath.hpp"
+
+//! @struct StarPositionBlock
+//! Structure-of-arrays block of decoded J2000 star positions of one zone.
+//! SpecialZoneArray::draw decodes the packed Star1/Star2/Star3 records of a
+//! zone into such blocks, so that normalization and viewport culling can be
+//! done on several stars at once with SSE instead of star by star.
+struct StarPositionBlock
+{
+	//! Maximum number of stars in one block. Must be a multiple of 4.
+	enum {Size=256};
+	float x[Size];
+	float y[Size];
+	float z[Size];
+	//! Index of the star relative to the first star of the block.
+	int index[Size];
+	//! Number of valid entries.
+	int count;
+
+	Vec3f getPos(int i) const {return Vec3f(x[i], y[i], z[i]);}
+};
+
+//! @struct StarBlockCap
+//! Plain copy of a SphericalCap used by cullStarBlock().
+//! The test is done in double precision like SphericalCap::contains(const Vec3f&).
+struct StarBlockCap
+{
+	double n[3];
+	double d;
+};
+
+//! Decode up to StarPositionBlock::Size stars starting at @em first into @em block.
+//! Decoding stops at @em last or at the first star fainter than @em cutoffMagStep
+//! (stars are sorted by magnitude inside a zone).
+//! @return the number of decoded stars, 0 when nothing is left to draw.
+template<class Star>
+int decodeStarBlock(const ZoneData* zone, const Star* first, const Star* last,
+		    float movementFactor, int cutoffMagStep, StarPositionBlock& block)
+{
+	Vec3f pos;
+	int n=0;
+	for (const Star* s=first; s<last && n<StarPositionBlock::Size; ++s, ++n)
+	{
+		if (s->getMag() > cutoffMagStep)
+			break;
+		s->getJ2000Pos(zone, movementFactor, pos);
+		block.x[n] = pos[0];
+		block.y[n] = pos[1];
+		block.z[n] = pos[2];
+		block.index[n] = n;
+	}
+	block.count = n;
+	return n;
+}
+
+//! Normalize all positions of the block in place.
+//! Gives bitwise the same result as Vec3f::normalize() for each star.
+void normalizeStarBlock(StarPositionBlock& block);
+
+//! Normalize all positions of the block and remove the stars which are not
+//! contained in all the caps. The surviving entries are compacted to the
+//! front of the block keeping their order, and block.count is updated.
+//! @return the number of remaining stars.
+int cullStarBlock(StarPositionBlock& block, const StarBlockCap* caps, int nbCaps);
+
+//! Scalar implementation of cullStarBlock(), used as fallback and as
+//! reference in the unit tests.
+int cullStarBlockScalar(StarPositionBlock& block, const StarBlockCap* caps, int nbCaps);
+
+//! Compute the sine of the geometric altitude of all stars of a normalized block.
+//! @param altRow the third row of the J2000 to altazimuthal matrix, computed once
+//! for the whole zone, so that only one dot product per star is needed instead
+//! of the full rotation done by StelCore::j2000ToAltAzInPlaceNoRefraction().
+//! @param sinAlt output array of at least block.count values.
+void computeStarBlockAltitudes(const StarPositionBlock& block, const float altRow[3], float* sinAlt);
+
+#endif // _STARBATCH_HPP_
@@ -0,0 +1,334 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "StarCatalogFile.hpp"
+#include "Star.hpp"
+#include "StelGeodesicGrid.hpp"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QVector>
+#include <QtEndian>
+
+#ifndef Q_OS_WIN
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+static inline int ReadInt(QFile& file, unsigned int &x)
+{
+	const int rval = (4 == file.read((char*)&x, 4)) ? 0 : -1;
+	return rval;
+}
+
+const quint32 StarCatalogFile::PageSize;
+
+int StarCatalogFile::recordSize(unsigned int type)
+{
+	switch (type)
+	{
+		case 0: return sizeof(Star1);
+		case 1: return sizeof(Star2);
+		case 2: return sizeof(Star3);
+		default: return 0;
+	}
+}
+
+// FNV-1a hash of the header and of the zone table.
+quint32 StarCatalogFile::checksum(const PagedCatalogHeader& header, const PagedZoneEntry* table, unsigned int nrOfZones)
+{
+	PagedCatalogHeader h = header;
+	h.checksum = 0;
+	quint32 rval = 2166136261u;
+	const uchar* p = (const uchar*)&h;
+	for (unsigned int i=0;i<sizeof(h);++i)
+		rval = (rval ^ p[i]) * 16777619u;
+	p = (const uchar*)table;
+	for (qint64 i=0;i<(qint64)sizeof(PagedZoneEntry)*nrOfZones;++i)
+		rval = (rval ^ p[i]) * 16777619u;
+	return rval;
+}
+
+bool StarCatalogFile::isPaged(const QString& path)
+{
+	QFile file(path);
+	unsigned int magic;
+	return file.open(QIODevice::ReadOnly) && ReadInt(file, magic)==0 && magic==FILE_MAGIC_PAGED;
+}
+
+const PagedZoneEntry* StarCatalogFile::checkPaged(const uchar* data, qint64 size, unsigned int nrOfZones, int recordSize)
+{
+	const qint64 tableEnd = sizeof(PagedCatalogHeader) + (qint64)sizeof(PagedZoneEntry)*nrOfZones;
+	if (data == Q_NULLPTR || size < tableEnd)
+		return Q_NULLPTR;
+	const PagedCatalogHeader* header = reinterpret_cast<const PagedCatalogHeader*>(data);
+	const PagedZoneEntry* table = reinterpret_cast<const PagedZoneEntry*>(data+sizeof(PagedCatalogHeader));
+	if (header->magic != FILE_MAGIC_PAGED || header->nr_of_zones != nrOfZones ||
+	    StarCatalogFile::recordSize(header->type) != recordSize ||
+	    header->checksum != checksum(*header, table, nrOfZones))
+		return Q_NULLPTR;
+	for (unsigned int z=0;z<nrOfZones;z++)
+	{
+		if (table[z].offset < (quint64)tableEnd ||
+		    table[z].offset + (quint64)table[z].size*recordSize > (quint64)size)
+			return Q_NULLPTR;
+	}
+	return table;
+}
+
+bool StarCatalogFile::repack(const QString& srcPath, const QString& dstPath)
+{
+	QFile src(srcPath);
+	if (!src.open(QIODevice::ReadOnly))
+	{
+		qWarning() << "Error while repacking" << QDir::toNativeSeparators(srcPath) << ": failed to open file.";
+		return false;
+	}
+	PagedCatalogHeader header;
+	if (ReadInt(src,header.magic) < 0 ||
+			ReadInt(src,header.type) < 0 ||
+			ReadInt(src,header.major) < 0 ||
+			ReadInt(src,header.minor) < 0 ||
+			ReadInt(src,header.level) < 0 ||
+			ReadInt(src,header.mag_min) < 0 ||
+			ReadInt(src,header.mag_range) < 0 ||
+			ReadInt(src,header.mag_steps) < 0)
+	{
+		qWarning() << "Error while repacking" << QDir::toNativeSeparators(srcPath) << ": file format is bad.";
+		return false;
+	}
+	const bool byte_swap = (header.magic == FILE_MAGIC_OTHER_ENDIAN);
+	if (byte_swap)
+	{
+		header.type = qbswap(header.type);
+		header.major = qbswap(header.major);
+		header.minor = qbswap(header.minor);
+		header.level = qbswap(header.level);
+		header.mag_min = qbswap(header.mag_min);
+		header.mag_range = qbswap(header.mag_range);
+		header.mag_steps = qbswap(header.mag_steps);
+	}
+	else if (header.magic != FILE_MAGIC && header.magic != FILE_MAGIC_NATIVE)
+	{
+		qWarning() << "Error while repacking" << QDir::toNativeSeparators(srcPath) << ": not a catalogue file.";
+		return false;
+	}
+	const int recordSize = StarCatalogFile::recordSize(header.type);
+	if (recordSize == 0 || header.major > MAX_MAJOR_FILE_VERSION)
+	{
+		qWarning() << "Error while repacking" << QDir::toNativeSeparators(srcPath) << ": unsupported catalogue type or version.";
+		return false;
+	}
+
+	// Place the zones. The star records themselves are portable and are copied as they are.
+	const unsigned int nrOfZones = StelGeodesicGrid::nrOfZones(header.level);
+	QVector<PagedZoneEntry> table(nrOfZones);
+	qint64 pos = sizeof(PagedCatalogHeader) + (qint64)sizeof(PagedZoneEntry)*nrOfZones;
+	for (unsigned int z=0;z<nrOfZones;z++)
+	{
+		unsigned int size;
+		if (ReadInt(src,size) < 0)
+		{
+			qWarning() << "Error while repacking" << QDir::toNativeSeparators(srcPath) << ": error reading zones.";
+			return false;
+		}
+		if (byte_swap)
+			size = qbswap(size);
+		const qint64 bytes = (qint64)size*recordSize;
+		const qint64 pageOffset = pos % PageSize;
+		if (bytes > 0 && pageOffset > 0 && pageOffset+bytes > PageSize)
+			pos += PageSize-pageOffset;
+		table[z].offset = pos;
+		table[z].size = size;
+		table[z].reserved = 0;
+		pos += bytes;
+	}
+	header.magic = FILE_MAGIC_PAGED;
+	header.page_size = PageSize;
+	header.nr_of_zones = nrOfZones;
+	header.reserved = 0;
+	header.checksum = checksum(header, table.constData(), nrOfZones);
+
+	// Write to a temporary file first, so that an interrupted conversion never leaves a partial catalog.
+	const QString tmpPath = dstPath + ".tmp";
+	QFile dst(tmpPath);
+	if (!dst.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		qWarning() << "Error while repacking" << QDir::toNativeSeparators(srcPath) << ": cannot write" << QDir::toNativeSeparators(tmpPath);
+		return false;
+	}
+	bool ok = dst.write((const char*)&header, sizeof(header)) == sizeof(header) &&
+		  dst.write((const char*)table.constData(), sizeof(PagedZoneEntry)*nrOfZones) == (qint64)sizeof(PagedZoneEntry)*nrOfZones;
+	const QByteArray padding(PageSize, '\0');
+	QByteArray buffer;
+	for (unsigned int z=0;ok && z<nrOfZones;z++)
+	{
+		const qint64 paddingSize = table[z].offset - dst.pos();
+		if (paddingSize > 0)
+			ok = dst.write(padding.constData(), paddingSize) == paddingSize;
+		const qint64 bytes = (qint64)table[z].size*recordSize;
+		buffer.resize(bytes);
+		ok = ok && src.read(buffer.data(), bytes) == bytes && dst.write(buffer) == bytes;
+	}
+	dst.close();
+	if (ok)
+	{
+		QFile::remove(dstPath);
+		ok = dst.rename(dstPath);
+	}
+	if (!ok)
+	{
+		qWarning() << "Error while repacking" << QDir::toNativeSeparators(srcPath) << ":" << dst.errorString();
+		dst.remove();
+		return false;
+	}
+	qDebug() << "Repacked" << QDir::toNativeSeparators(srcPath) << "to" << QDir::toNativeSeparators(dstPath);
+	return true;
+}
+
+StarZoneStream::StarZoneStream(QFile* file, ZoneData* zones, unsigned int nrOfZones, qint64 dataStart, int recordSize)
+	: file(file), zones(zones), nrOfZones(nrOfZones), recordSize(recordSize), useStamp(0),
+	  nrOfResidentZones(0), residentSize(0), nrOfPageIns(0)
+{
+	offsets.resize(nrOfZones);
+	lastUse.fill(0, nrOfZones);
+	qint64 offset = dataStart;
+	for (unsigned int z=0;z<nrOfZones;z++)
+	{
+		zones[z].stars = Q_NULLPTR;
+		offsets[z] = offset;
+		offset += (qint64)zones[z].size*recordSize;
+	}
+}
+
+StarZoneStream::~StarZoneStream()
+{
+	for (unsigned int z=0;z<nrOfZones;z++)
+		release(z);
+}
+
+bool StarZoneStream::read(qint64 offset, char* data, qint64 size)
+{
+#ifdef Q_OS_WIN
+	QMutexLocker locker(&fileMutex);
+	return file->seek(offset) && file->read(data, size) == size;
+#else
+	const int fd = file->handle();
+	while (size > 0)
+	{
+		const ssize_t n = pread(fd, data, size, offset);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		data += n;
+		offset += n;
+		size -= n;
+	}
+	return true;
+#endif
+}
+
+bool StarZoneStream::load(int zone)
+{
+	ZoneData& z = zones[zone];
+	{
+		QMutexLocker locker(&zoneLock(zone));
+		lastUse[zone] = useStamp;
+		if (z.stars != Q_NULLPTR || z.size == 0)
+			return true;
+	}
+	const qint64 size = (qint64)z.size*recordSize;
+	char* data = new char[size];
+	if (!read(offsets.at(zone), data, size))
+	{
+		qDebug() << "Error reading zone" << zone << "from catalog:" << file->fileName() << file->errorString();
+		delete[] data;
+		return false;
+	}
+	{
+		QMutexLocker locker(&zoneLock(zone));
+		if (z.stars != Q_NULLPTR)
+		{
+			// Read meanwhile by another thread.
+			delete[] data;
+			return true;
+		}
+		z.stars = data;
+	}
+	QMutexLocker locker(&countersMutex);
+	++nrOfResidentZones;
+	residentSize += size;
+	++nrOfPageIns;
+	return true;
+}
+
+qint64 StarZoneStream::release(int zone)
+{
+	ZoneData& z = zones[zone];
+	{
+		QMutexLocker locker(&zoneLock(zone));
+		if (z.stars == Q_NULLPTR)
+			return 0;
+		delete[] static_cast<char*>(z.stars);
+		z.stars = Q_NULLPTR;
+	}
+	const qint64 size = (qint64)z.size*recordSize;
+	QMutexLocker locker(&countersMutex);
+	--nrOfResidentZones;
+	residentSize -= size;
+	return size;
+}
+
+void StarZoneStream::getResidentZones(QVector<ResidentZone>& result) const
+{
+	for (unsigned int z=0;z<nrOfZones;z++)
+	{
+		QMutexLocker locker(&zoneLock(z));
+		if (zones[z].stars == Q_NULLPTR)
+			continue;
+		const ResidentZone r = {lastUse.at(z), (qint64)zones[z].size*recordSize, (int)z};
+		result.append(r);
+	}
+}
+
+int StarZoneStream::getNrOfResidentZones() const
+{
+	QMutexLocker locker(&countersMutex);
+	return nrOfResidentZones;
+}
+
+qint64 StarZoneStream::getResidentSize() const
+{
+	QMutexLocker locker(&countersMutex);
+	return residentSize;
+}
+
+int StarZoneStream::getNrOfPageIns() const
+{
+	QMutexLocker locker(&countersMutex);
+	return nrOfPageIns;
+}
+
+qint64 StarZoneStream::getTableSize() const
+{
+	return sizeof(*this) + offsets.capacity()*sizeof(qint64) + lastUse.capacity()*sizeof(quint32);
+}
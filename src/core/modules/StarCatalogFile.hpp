@@ -0,0 +1,221 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _STARCATALOGFILE_HPP_
+#define _STARCATALOGFILE_HPP_
+
+#include "ZoneData.hpp"
+
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include <algorithm>
+
+class QFile;
+
+#define FILE_MAGIC 0x835f040a
+#define FILE_MAGIC_OTHER_ENDIAN 0x0a045f83
+#define FILE_MAGIC_NATIVE 0x835f040b
+#define FILE_MAGIC_PAGED 0x835f040c
+#define MAX_MAJOR_FILE_VERSION 0
+
+//! @struct PagedCatalogHeader
+//! Header of a FILE_MAGIC_PAGED star catalog, as written by StarCatalogFile::repack().
+//! Such a catalog is always mapped read-only, it is never read into memory.
+//! All integers are in the byte order of the machine which wrote the file.
+//! The header is followed by one PagedZoneEntry per zone, then by the star
+//! records of the zones, in the same record format as the other catalogs.
+//! The star records of a zone smaller than a page never cross a page boundary,
+//! the records of a larger zone start on a page boundary, so that looking at
+//! a zone only pages in the pages of that zone.
+struct PagedCatalogHeader
+{
+	quint32 magic;
+	quint32 type;
+	quint32 major;
+	quint32 minor;
+	quint32 level;
+	quint32 mag_min;
+	quint32 mag_range;
+	quint32 mag_steps;
+	quint32 page_size;
+	quint32 nr_of_zones;
+	//! Checksum of the header (with checksum set to 0) and of the zone table.
+	quint32 checksum;
+	quint32 reserved;
+};
+
+//! @struct PagedZoneEntry
+//! Entry of the zone table of a FILE_MAGIC_PAGED star catalog.
+struct PagedZoneEntry
+{
+	//! Offset of the star records of the zone from the start of the file.
+	quint64 offset;
+	//! Number of stars in the zone.
+	quint32 size;
+	quint32 reserved;
+};
+
+//! @class StarCatalogFile
+//! On-disk layout of the star catalogs which does not depend on how ZoneArray
+//! uses the stars: conversion to the FILE_MAGIC_PAGED format and its validation.
+//! See StarZoneStream for reading the zones of a catalog on demand.
+class StarCatalogFile
+{
+public:
+	//! Pages of FILE_MAGIC_PAGED catalogs. 4 KiB is the page size of all common
+	//! platforms; the layout stays valid (only less tight) with larger pages.
+	static const quint32 PageSize = 4096;
+
+	//! Get the size of a star record of a catalog type (0, 1 or 2).
+	//! @return the size in bytes, or 0 for an unknown type
+	static int recordSize(unsigned int type);
+
+	//! Compute the checksum of the header and of the zone table of a FILE_MAGIC_PAGED catalog.
+	//! The checksum field of @em header is ignored.
+	static quint32 checksum(const PagedCatalogHeader& header, const PagedZoneEntry* table, unsigned int nrOfZones);
+
+	//! Convert a star catalog to the FILE_MAGIC_PAGED format, in the byte order of this machine.
+	//! @param srcPath path of a catalog in any of the supported formats
+	//! @param dstPath path of the catalog to write
+	//! @return @c true if successful, or @c false if an error occurred
+	static bool repack(const QString& srcPath, const QString& dstPath);
+
+	//! Check whether a catalog file is already in the FILE_MAGIC_PAGED format of this machine.
+	static bool isPaged(const QString& path);
+
+	//! Validate a FILE_MAGIC_PAGED catalog in memory: the file must be large enough
+	//! for its zone table and for the stars of every zone, and the checksum must match.
+	//! @param data start of the file, typically mapped
+	//! @param size size of the file
+	//! @param nrOfZones expected number of zones
+	//! @param recordSize expected size of a star record
+	//! @return the zone table, or Q_NULLPTR if the catalog is truncated or corrupted
+	static const PagedZoneEntry* checkPaged(const uchar* data, qint64 size, unsigned int nrOfZones, int recordSize);
+};
+
+//! @class StarZoneStream
+//! Reads the stars of the zones of a catalog when they are first used, for
+//! ZoneArray::Streamed catalogs, and keeps them until release().
+//! load() is thread safe. No lock is held while the file is read, and the file
+//! is read without moving its position where the platform allows it, so that
+//! threads loading different zones don't wait for each other. If two threads
+//! load the same zone at the same time, the first copy read is kept.
+class StarZoneStream
+{
+public:
+	//! @param file the catalog, which must stay open as long as the stream is used
+	//! @param zones the zones of the catalog, with their size set. Their stars are
+	//! set by load() and release().
+	//! @param nrOfZones number of zones
+	//! @param dataStart offset in the file of the stars of the first zone; the stars
+	//! of the other zones follow in the order of the zones.
+	//! @param recordSize size of a star record
+	StarZoneStream(QFile* file, ZoneData* zones, unsigned int nrOfZones, qint64 dataStart, int recordSize);
+	//! Free the stars of all the zones.
+	~StarZoneStream();
+
+	//! Make sure the stars of a zone are in memory, reading them if needed,
+	//! and record the current use stamp as the last use of the zone.
+	//! @return @c false if the stars could not be read
+	bool load(int zone);
+
+	//! Free the stars of a zone. They must not be used by anybody.
+	//! @return the number of freed bytes
+	qint64 release(int zone);
+
+	//! Set the stamp recorded by load(), e.g. a frame counter. Not thread safe:
+	//! it must not change while zones are loaded.
+	void setUseStamp(quint32 stamp) {useStamp = stamp;}
+
+	//! A zone in memory.
+	struct ResidentZone
+	{
+		quint32 lastUse;
+		//! Memory used by the zone, in bytes.
+		qint64 size;
+		int zone;
+	};
+
+	//! Add the zones in memory to @em result.
+	void getResidentZones(QVector<ResidentZone>& result) const;
+
+	//! Get the number of zones in memory.
+	int getNrOfResidentZones() const;
+	//! Get the memory used by the stars of the zones in memory, in bytes.
+	qint64 getResidentSize() const;
+	//! Get how many times the stars of a zone were read.
+	int getNrOfPageIns() const;
+	//! Get the memory used by the table of the zones, which stays in memory, in bytes.
+	qint64 getTableSize() const;
+
+	//! Sort @em zones from the least recently used, and count how many of them must
+	//! be released so that @em size fits in @em budget. The zones last used at
+	//! @em currentStamp are never released, even if they don't fit.
+	//! @tparam Zone a struct with the lastUse and size of a zone, like ResidentZone
+	template<class Zone>
+	static int countZonesToRelease(QVector<Zone>& zones, qint64 size, qint64 budget, quint32 currentStamp)
+	{
+		if (size <= budget)
+			return 0;
+		std::sort(zones.begin(), zones.end(), OlderZone<Zone>());
+		int n = 0;
+		while (n < zones.size() && size > budget && zones.at(n).lastUse != currentStamp)
+			size -= zones.at(n++).size;
+		return n;
+	}
+
+private:
+	template<class Zone>
+	struct OlderZone
+	{
+		bool operator()(const Zone& a, const Zone& b) const {return a.lastUse < b.lastUse;}
+	};
+
+	//! Read @em size bytes at @em offset of the file.
+	bool read(qint64 offset, char* data, qint64 size);
+
+	//! Zones share locks, by their index modulo NrOfLocks.
+	static const int NrOfLocks = 64;
+	QMutex& zoneLock(int zone) const {return locks[zone%NrOfLocks];}
+
+	QFile* file;
+	ZoneData* zones;
+	const unsigned int nrOfZones;
+	const int recordSize;
+	QVector<qint64> offsets;
+	// Protected by the lock of the zone.
+	QVector<quint32> lastUse;
+	quint32 useStamp;
+	mutable QMutex locks[NrOfLocks];
+
+	// Protected by countersMutex.
+	int nrOfResidentZones;
+	qint64 residentSize;
+	int nrOfPageIns;
+	mutable QMutex countersMutex;
+#ifdef Q_OS_WIN
+	//! Serializes the seek and read of the file.
+	QMutex fileMutex;
+#endif
+};
+
+#endif // _STARCATALOGFILE_HPP_
@@ -56,6 +56,9 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QCryptographicHash>
+#include <QtConcurrent>
+
+#include <algorithm>
 
 #include <errno.h>
 
@@ -141,6 +144,9 @@ StarMgr::StarMgr(void)
 	: flagStarName(false)
 	, labelsAmount(0.)
 	, gravityLabel(false)
+	, flagParallelDraw(false)
+	, drawFrameCounter(0)
+	, starZoneCacheSize(256)
 	, hipIndex(new HipIndexStruct[NR_OF_HIP+1])
 {
 	setObjectName("StarMgr");
@@ -170,6 +176,8 @@ StarMgr::~StarMgr(void)
 	foreach(ZoneArray* z, gridLevels)
 		delete z;
 	gridLevels.clear();
+	qDeleteAll(drawBuffers);
+	drawBuffers.clear();
 	if (hipIndex)
 		delete[] hipIndex;
 }
@@ -430,6 +438,8 @@ void StarMgr::init()
 	setFlagStars(conf->value("astro/flag_stars", true).toBool());
 	setFlagLabels(conf->value("astro/flag_star_name",true).toBool());
 	setLabelsAmount(conf->value("stars/labels_amount",3.f).toFloat());
+	setFlagParallelDraw(conf->value("stars/flag_parallel_draw", false).toBool());
+	setStarZoneCacheSize(conf->value("stars/stream_cache_size", 256).toInt());
 
 	// Load colors from config file
 	QString defaultColor = conf->value("color/default_color").toString();
@@ -472,6 +482,23 @@ void StarMgr::drawPointer(StelPainter& sPainter, const StelCore* core)
 	}
 }
 
+// Return the path of a copy of the catalog in the FILE_MAGIC_PAGED format, creating
+// it in the cache directory if needed, or the original path if the conversion fails.
+static QString getPagedCatalogPath(const QString& catalogFilePath)
+{
+	if (StarCatalogFile::isPaged(catalogFilePath))
+		return catalogFilePath;
+	const QString cacheDir = StelFileMgr::getCacheDir() + "/stars";
+	const QFileInfo srcInfo(catalogFilePath);
+	const QString pagedPath = cacheDir + "/" + srcInfo.fileName();
+	const QFileInfo pagedInfo(pagedPath);
+	if (pagedInfo.exists() && pagedInfo.lastModified() >= srcInfo.lastModified() && StarCatalogFile::isPaged(pagedPath))
+		return pagedPath;
+	if (QDir().mkpath(cacheDir) && StarCatalogFile::repack(catalogFilePath, pagedPath))
+		return pagedPath;
+	return catalogFilePath;
+}
+
 bool StarMgr::checkAndLoadCatalog(const QVariantMap& catDesc)
 {
 	const bool checked = catDesc.value("checked").toBool();
@@ -541,7 +568,12 @@ bool StarMgr::checkAndLoadCatalog(const QVariantMap& catDesc)
 		}
 	}
 
-	ZoneArray* z = ZoneArray::create(catalogFilePath, true);
+	// Load a native, page aligned copy of the catalog which is always mmapped.
+	if (StelApp::getInstance().getSettings()->value("stars/flag_repack_catalogs", false).toBool())
+		catalogFilePath = getPagedCatalogPath(catalogFilePath);
+
+	const bool streamed = StelApp::getInstance().getSettings()->value("stars/flag_stream_catalogs", false).toBool();
+	ZoneArray* z = ZoneArray::create(catalogFilePath, true, streamed);
 	if (z)
 	{
 		if (z->level<gridLevels.size())
@@ -1103,6 +1135,57 @@ int StarMgr::getMaxSearchLevel() const
 
 
 // Draw all the stars
+//! A zone to be projected by a worker thread in parallel draw mode.
+struct StarZoneJob
+{
+	const ZoneArray* zoneArray;
+	int zone;
+	bool isInsideViewport;
+	const RCMag* rcmagTable;
+	int limitMagIndex;
+	int maxMagStarName;
+	const StelCore* core;
+	const StelProjectorP* prj;
+	const QVector<SphericalCap>* viewportCaps;
+	quint32 twinkleSeed;
+	StarDrawBuffer* buffer;
+};
+
+static void computeStarZoneJob(StarZoneJob& job)
+{
+	job.buffer->clear();
+	job.zoneArray->computeDraw(*job.buffer, *job.prj, job.zone, job.isInsideViewport, job.rcmagTable, job.limitMagIndex,
+				   job.core, job.maxMagStarName, *job.viewportCaps, job.twinkleSeed);
+}
+
+void StarMgr::drawZonesParallel(StelPainter& sPainter, StelCore* core, QVector<StarZoneJob>& jobs, float names_brightness)
+{
+	// Each zone gets its own buffer, so that the result does not depend on the
+	// way the zones are distributed over the threads.
+	while (drawBuffers.size()<jobs.size())
+		drawBuffers.append(new StarDrawBuffer());
+	for (int i=0;i<jobs.size();++i)
+		jobs[i].buffer = drawBuffers.at(i);
+
+	// QtConcurrent hands out the zones dynamically to idle threads of the global pool.
+	QtConcurrent::blockingMap(jobs, computeStarZoneJob);
+
+	// Submit all the buffers in the zone order, from the main thread.
+	StelSkyDrawer* skyDrawer = core->getSkyDrawer();
+	for (int i=0;i<jobs.size();++i)
+	{
+		const StarDrawBuffer& buffer = *drawBuffers.at(i);
+		for (int j=0;j<buffer.points.size();++j)
+			skyDrawer->addPointSource(&sPainter, buffer.points.at(j));
+		for (int j=0;j<buffer.labels.size();++j)
+		{
+			const StarDrawBuffer::Label& label = buffer.labels.at(j);
+			sPainter.setColor(label.color[0], label.color[1], label.color[2], names_brightness);
+			sPainter.drawText(Vec3d(label.pos[0], label.pos[1], label.pos[2]), label.name, 0, label.offset, label.offset, false);
+		}
+	}
+}
+
 void StarMgr::draw(StelCore* core)
 {
 	const StelProjectorP prj = core->getProjection(StelCore::FrameJ2000);
@@ -1125,12 +1208,18 @@ void StarMgr::draw(StelCore* core)
 	sPainter.setFont(starFont);
 	skyDrawer->preDrawPointSource(&sPainter);
 
-	// Prepare a table for storing precomputed RCMag for all ZoneArrays
-	RCMag rcmag_table[RCMAG_TABLE_SIZE];
+	// Prepare a table for storing precomputed RCMag for all ZoneArrays.
+	// In parallel mode each level needs its own table, because all zones are projected at once.
+	QVector<RCMag> rcmagTables(flagParallelDraw ? RCMAG_TABLE_SIZE*gridLevels.size() : RCMAG_TABLE_SIZE);
+	QVector<StarZoneJob> jobs;
+	++drawFrameCounter;
+	foreach (ZoneArray* z, gridLevels)
+		z->setZoneUseStamp(drawFrameCounter);
 	
 	// Draw all the stars of all the selected zones
 	foreach(const ZoneArray* z, gridLevels)
 	{
+		RCMag* rcmag_table = flagParallelDraw ? rcmagTables.data()+RCMAG_TABLE_SIZE*z->level : rcmagTables.data();
 		int limitMagIndex=RCMAG_TABLE_SIZE;
 		const float mag_min = 0.001f*z->mag_min;
 		const float k = (0.001f*z->mag_range)/z->mag_steps; // MagStepIncrement
@@ -1169,6 +1258,23 @@ void StarMgr::draw(StelCore* core)
 		}
 		int zone;
 		
+		if (flagParallelDraw)
+		{
+			StarZoneJob job = {z, 0, true, rcmag_table, limitMagIndex, (int)maxMagStarName, core, &prj, &viewportCaps, drawFrameCounter, Q_NULLPTR};
+			for (GeodesicSearchInsideIterator it1(*geodesic_search_result,z->level);(zone = it1.next()) >= 0;)
+			{
+				job.zone = zone;
+				jobs.append(job);
+			}
+			job.isInsideViewport = false;
+			for (GeodesicSearchBorderIterator it1(*geodesic_search_result,z->level);(zone = it1.next()) >= 0;)
+			{
+				job.zone = zone;
+				jobs.append(job);
+			}
+			continue;
+		}
+
 		for (GeodesicSearchInsideIterator it1(*geodesic_search_result,z->level);(zone = it1.next()) >= 0;)
 			z->draw(&sPainter, zone, true, rcmag_table, limitMagIndex, core, maxMagStarName, names_brightness, viewportCaps);
 		for (GeodesicSearchBorderIterator it1(*geodesic_search_result,z->level);(zone = it1.next()) >= 0;)
@@ -1176,6 +1282,12 @@ void StarMgr::draw(StelCore* core)
 	}
 	exit_loop:
 
+	if (!jobs.isEmpty())
+		drawZonesParallel(sPainter, core, jobs, names_brightness);
+
+	// No zone is used anymore, it is safe to free them.
+	trimStarZoneCache();
+
 	// Finish drawing many stars
 	skyDrawer->postDrawPointSource(&sPainter);
 
@@ -1184,14 +1296,42 @@ void StarMgr::draw(StelCore* core)
 }
 
 
-// Return a QList containing the stars located
-// inside the limFov circle around position v
-QList<StelObjectP > StarMgr::searchAround(const Vec3d& vv, double limFov, const StelCore* core) const
+void StarMgr::trimStarZoneCache()
 {
-	QList<StelObjectP > result;
-	if (!getFlagStars())
-		return result;
+	const qint64 budget = (qint64)starZoneCacheSize*1024*1024;
+	qint64 size = 0;
+	foreach (const ZoneArray* z, gridLevels)
+		size += z->getResidentSize();
+	if (size <= budget)
+		return;
+
+	QVector<ZoneArray::ResidentZone> residentZones;
+	foreach (ZoneArray* z, gridLevels)
+		z->getResidentZones(residentZones);
+	// Never free the zones of the current view, even if they don't fit.
+	const int n = StarZoneStream::countZonesToRelease(residentZones, size, budget, drawFrameCounter);
+	for (int i=0;i<n;++i)
+		residentZones.at(i).zoneArray->releaseZone(residentZones.at(i).zone);
+}
+
+int StarMgr::getNrOfResidentStarZones() const
+{
+	int n = 0;
+	foreach (const ZoneArray* z, gridLevels)
+		n += z->getNrOfResidentZones();
+	return n;
+}
+
+int StarMgr::getNrOfStarZonePageIns() const
+{
+	int n = 0;
+	foreach (const ZoneArray* z, gridLevels)
+		n += z->getNrOfPageIns();
+	return n;
+}
 
+void StarMgr::searchAround(const Vec3d& vv, double limFov, const StelCore* core, bool onlyVisible, QVector<StarSearchHit>& hits) const
+{
 	Vec3d v(vv);
 	v.normalize();
 
@@ -1236,23 +1376,89 @@ QList<StelObjectP > StarMgr::searchAround(const Vec3d& vv, double limFov, const
 	SphericalConvexPolygon c(e3, e2, e2, e0);
 	const GeodesicSearchResult* geodesic_search_result = core->getGeodesicGrid(lastMaxSearchLevel)->search(c.getBoundingSphericalCaps(),lastMaxSearchLevel);
 
-	// Iterate over the stars inside the triangles
+	// Iterate over the stars inside the triangles.
+	float limitMag = 100.f;
+	if (onlyVisible)
+	{
+		const StelSkyDrawer* drawer = core->getSkyDrawer();
+		limitMag = drawer->getLimitMagnitude();
+		if (drawer->getFlagStarMagnitudeLimit())
+			limitMag = qMin(limitMag, (float)drawer->getCustomStarMagnitudeLimit());
+	}
 	f = cos(limFov * M_PI/180.);
 	foreach(ZoneArray* z, gridLevels)
 	{
-		//qDebug() << "search inside(" << it->first << "):";
+		const int maxMagIndex = qMin(z->getMagIndex(limitMag), 255);
+		if (maxMagIndex<0)
+			continue;
 		int zone;
 		for (GeodesicSearchInsideIterator it1(*geodesic_search_result,z->level);(zone = it1.next()) >= 0;)
-		{
-			z->searchAround(core, zone,v,f,result);
-			//qDebug() << " " << zone;
-		}
-		//qDebug() << endl << "search border(" << it->first << "):";
+			z->searchAround(core, zone, v, f, maxMagIndex, hits);
 		for (GeodesicSearchBorderIterator it1(*geodesic_search_result,z->level); (zone = it1.next()) >= 0;)
-		{
-			z->searchAround(core, zone,v,f,result);
-			//qDebug() << " " << zone;
-		}
+			z->searchAround(core, zone, v, f, maxMagIndex, hits);
+	}
+}
+
+// Return a QList containing the stars located
+// inside the limFov circle around position v
+QList<StelObjectP > StarMgr::searchAround(const Vec3d& vv, double limFov, const StelCore* core) const
+{
+	QList<StelObjectP > result;
+	if (!getFlagStars())
+		return result;
+
+	QVector<StarSearchHit> hits;
+	searchAround(vv, limFov, core, true, hits);
+	result.reserve(hits.size());
+	foreach (const StarSearchHit& hit, hits)
+	{
+		const StelObjectP obj = hit.zoneArray->createStelObject(hit.zone, hit.star);
+		if (obj)
+			result.append(obj);
+	}
+	return result;
+}
+
+static bool closerStarSearchHit(const StarSearchHit& a, const StarSearchHit& b)
+{
+	return a.cosDistance > b.cosDistance;
+}
+
+QList<StelObjectP > StarMgr::searchNearest(const Vec3d& v, double limFov, int maxNbItem, const StelCore* core, bool onlyVisible) const
+{
+	QList<StelObjectP > result;
+	if ((onlyVisible && !getFlagStars()) || maxNbItem<=0)
+		return result;
+
+	QVector<StarSearchHit> hits;
+	searchAround(v, limFov, core, onlyVisible, hits);
+	// Only create the StelObjects of the closest stars.
+	const int n = qMin(maxNbItem, hits.size());
+	std::partial_sort(hits.begin(), hits.begin()+n, hits.end(), closerStarSearchHit);
+	for (int i=0;i<n;++i)
+	{
+		const StelObjectP obj = hits.at(i).zoneArray->createStelObject(hits.at(i).zone, hits.at(i).star);
+		if (obj)
+			result.append(obj);
+	}
+	return result;
+}
+
+QList<StelObjectP > StarMgr::searchSelectionCandidates(const Vec3d& v, double limFov, double degreeWeight, int maxNbItem, const StelCore* core) const
+{
+	QList<StelObjectP > result;
+	if (!getFlagStars())
+		return result;
+
+	QVector<StarSearchHit> hits;
+	searchAround(v, limFov, core, true, hits);
+	// A wide field of view may put thousands of stars in the cone, only create the best ones.
+	const int n = StarZoneIndex::selectPickingCandidates(hits, maxNbItem, degreeWeight);
+	for (int i=0;i<n;++i)
+	{
+		const StelObjectP obj = hits.at(i).zoneArray->createStelObject(hits.at(i).zone, hits.at(i).star);
+		if (obj)
+			result.append(obj);
 	}
 	return result;
 }
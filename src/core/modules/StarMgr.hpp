@@ -36,6 +36,9 @@ class QSettings;
 
 class ZoneArray;
 struct HipIndexStruct;
+struct StarDrawBuffer;
+struct StarZoneJob;
+struct StarSearchHit;
 
 static const int RCMAG_TABLE_SIZE = 4096;
 
@@ -102,6 +105,18 @@ class StarMgr : public StelObjectModule
 		   READ getLabelsAmount
 		   WRITE setLabelsAmount
 		   NOTIFY labelsAmountChanged)
+	Q_PROPERTY(bool flagParallelDraw
+		   READ getFlagParallelDraw
+		   WRITE setFlagParallelDraw
+		   NOTIFY flagParallelDrawChanged)
+	Q_PROPERTY(int starZoneCacheSize
+		   READ getStarZoneCacheSize
+		   WRITE setStarZoneCacheSize
+		   NOTIFY starZoneCacheSizeChanged)
+	Q_PROPERTY(int residentStarZones
+		   READ getNrOfResidentStarZones)
+	Q_PROPERTY(int starZonePageIns
+		   READ getNrOfStarZonePageIns)
 
 public:
 	StarMgr(void);
@@ -133,6 +148,15 @@ public:
 	//! Return a list containing the stars located inside the limFov circle around position v
 	virtual QList<StelObjectP > searchAround(const Vec3d& v, double limitFov, const StelCore* core) const;
 
+	//! Return the stars located inside the limitFov circle around position v, sorted by distance.
+	//! Only the StelObjects of the at most maxNbItem closest stars are created.
+	//! @param onlyVisible if true, like searchAround(), stars too faint to be displayed are ignored.
+	QList<StelObjectP > searchNearest(const Vec3d& v, double limitFov, int maxNbItem, const StelCore* core, bool onlyVisible=true) const;
+
+	//! Return the visible stars inside the limitFov circle around position v which are the best
+	//! candidates for a selection. Only the StelObjects of these at most maxNbItem stars are created.
+	virtual QList<StelObjectP > searchSelectionCandidates(const Vec3d& v, double limitFov, double degreeWeight, int maxNbItem, const StelCore* core) const;
+
 	//! Return the matching Stars object's pointer if exists or Q_NULLPTR
 	//! @param nameI18n The case in-sensistive star common name or HP
 	//! catalog name (format can be HP1234 or HP 1234 or HIP 1234) or sci name
@@ -190,6 +214,24 @@ public slots:
 	//! Define font size to use for star names display.
 	void setFontSize(float newFontSize);
 
+	//! Set whether the zones of the star catalogs are projected in parallel on all CPU cores.
+	//! In this mode the twinkling of stars is computed from a seed instead of qrand(),
+	//! so that the same sequence of frames always gives the same images.
+	void setFlagParallelDraw(bool b) {if(b!=flagParallelDraw){ flagParallelDraw=b; emit flagParallelDrawChanged(b);}}
+	//! Get whether the zones of the star catalogs are projected in parallel.
+	bool getFlagParallelDraw() const {return flagParallelDraw;}
+
+	//! Set the memory budget in MB for the stars of streamed catalogs (see stars/flag_stream_catalogs).
+	//! The search indexes of their zones and their zone tables count in the budget too.
+	//! The zones which were not drawn for the longest time are freed first.
+	void setStarZoneCacheSize(int mb) {if(mb!=starZoneCacheSize){ starZoneCacheSize=mb; emit starZoneCacheSizeChanged(mb);}}
+	//! Get the memory budget in MB for the stars of streamed catalogs.
+	int getStarZoneCacheSize() const {return starZoneCacheSize;}
+	//! Get the number of zones of streamed catalogs which are in memory.
+	int getNrOfResidentStarZones() const;
+	//! Get how many times the stars of a zone of a streamed catalog were read since startup.
+	int getNrOfStarZonePageIns() const;
+
 	//! Show scientific or catalog names on stars without common names.
 	static void setFlagSciNames(bool f) {flagSciNames = f;}
 	static bool getFlagSciNames(void) {return flagSciNames;}
@@ -353,6 +395,8 @@ signals:
 	void starLabelsDisplayedChanged(const bool displayed);
 	void starsDisplayedChanged(const bool displayed);
 	void labelsAmountChanged(float a);
+	void flagParallelDrawChanged(bool b);
+	void starZoneCacheSizeChanged(int mb);
 
 private:
 	void setCheckFlag(const QString& catalogId, bool b);
@@ -382,6 +426,9 @@ private:
 	//! @param the path to a file containing the cross-identification data.
 	void loadCrossIdentificationData(const QString& crossIdFile);
 
+	//! Collect the stars located inside the limFov circle around position v, without creating StelObjects.
+	void searchAround(const Vec3d& v, double limFov, const StelCore* core, bool onlyVisible, QVector<StarSearchHit>& hits) const;
+
 	//! Gets the maximum search level.
 	// TODO: add a non-lame description - what is the purpose of the max search level?
 	int getMaxSearchLevel() const;
@@ -392,6 +439,9 @@ private:
 	//! Draw a nice animated pointer around the object.
 	void drawPointer(StelPainter& sPainter, const StelCore* core);
 
+	//! Project the given zones in parallel and submit the result to the StelSkyDrawer.
+	void drawZonesParallel(StelPainter& sPainter, StelCore* core, QVector<StarZoneJob>& jobs, float names_brightness);
+
 	void populateHipparcosLists();
 	void populateStarsDesignations();
 
@@ -408,6 +458,17 @@ private:
 
 	int maxGeodesicGridLevel;
 	int lastMaxSearchLevel;
+
+	bool flagParallelDraw;
+	//! Incremented at each draw(), used as twinkle seed in parallel mode.
+	quint32 drawFrameCounter;
+	//! One buffer per zone drawn in parallel mode, kept between frames to avoid reallocations.
+	QVector<StarDrawBuffer*> drawBuffers;
+
+	//! Memory budget in MB for the streamed catalogs: the stars of the zones in memory and their indexes.
+	int starZoneCacheSize;
+	//! Free the least recently used zones of streamed catalogs until they fit in starZoneCacheSize.
+	void trimStarZoneCache();
 	
 	// A ZoneArray per grid level
 	QVector<ZoneArray*> gridLevels;
@@ -73,7 +73,7 @@ template <class Star> class StarWrapper : public StarWrapperBase
 protected:
 	StarWrapper(const SpecialZoneArray<Star> *a,
 		const SpecialZoneData<Star> *z,
-		const Star *s) : a(a), z(z), s(s) {;}
+		const Star *s) : a(a), z(z), star(*s), s(&star) {;}
 	Vec3d getJ2000EquatorialPos(const StelCore* core) const
 	{
 		static const double d2000 = 2451545.0;
@@ -97,7 +97,12 @@ protected:
 protected:
 	const SpecialZoneArray<Star> *const a;
 	const SpecialZoneData<Star> *const z;
+	//! Copy of the star record: the stars of streamed catalogs may be freed.
+	const Star star;
+	//! Points to star, so the wrapper can't be copied.
 	const Star *const s;
+private:
+	Q_DISABLE_COPY(StarWrapper)
 };
 
 
@@ -0,0 +1,116 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "StarZoneIndex.hpp"
+
+#include <cmath>
+
+// Average number of stars per cell.
+static const int STARS_PER_CELL = 32;
+// Maximum number of cells along one axis of the grid.
+static const int MAX_GRID_SIZE = 64;
+
+void StarZoneIndex::build(const Vec3f* pos, const int* mag, const float* motion, int n)
+{
+	cells.clear();
+	starIndex.clear();
+	starMag.clear();
+	if (n<=0)
+		return;
+
+	// Tangent plane at the mean direction of the stars.
+	Vec3f m(0.f);
+	for (int i=0;i<n;++i)
+		m += pos[i];
+	m.normalize();
+	Vec3f e0 = (std::fabs(m[2])<0.9f ? Vec3f(0.f,0.f,1.f) : Vec3f(1.f,0.f,0.f)) ^ m;
+	e0.normalize();
+	const Vec3f e1 = m ^ e0;
+
+	// Gnomonic coordinates of the stars and their bounding box.
+	QVector<float> u(n), w(n);
+	float minU=1e30f, maxU=-1e30f, minW=1e30f, maxW=-1e30f;
+	for (int i=0;i<n;++i)
+	{
+		const float d = qMax(pos[i]*m, 0.01f);
+		u[i] = (pos[i]*e0)/d;
+		w[i] = (pos[i]*e1)/d;
+		minU = qMin(minU, u[i]);
+		maxU = qMax(maxU, u[i]);
+		minW = qMin(minW, w[i]);
+		maxW = qMax(maxW, w[i]);
+	}
+	const int gridSize = qBound(1, (int)std::ceil(std::sqrt((float)n/STARS_PER_CELL)), MAX_GRID_SIZE);
+	const float scaleU = gridSize/qMax(maxU-minU, 1e-9f);
+	const float scaleW = gridSize/qMax(maxW-minW, 1e-9f);
+
+	// Counting sort of the stars by cell. The sort is stable, so the
+	// stars of a cell stay sorted by magnitude like in the catalog.
+	QVector<int> cellOfStar(n);
+	QVector<int> cellStart(gridSize*gridSize+1, 0);
+	for (int i=0;i<n;++i)
+	{
+		const int cu = qMin((int)((u[i]-minU)*scaleU), gridSize-1);
+		const int cw = qMin((int)((w[i]-minW)*scaleW), gridSize-1);
+		cellOfStar[i] = cu*gridSize+cw;
+		++cellStart[cellOfStar[i]+1];
+	}
+	for (int c=0;c<gridSize*gridSize;++c)
+		cellStart[c+1] += cellStart[c];
+	starIndex.resize(n);
+	starMag.resize(n);
+	QVector<int> fill = cellStart;
+	for (int i=0;i<n;++i)
+	{
+		const int j = fill[cellOfStar[i]]++;
+		starIndex[j] = i;
+		starMag[j] = (quint8)qBound(0, mag[i], 255);
+	}
+
+	// Bounding cap of each non empty cell.
+	for (int c=0;c<gridSize*gridSize;++c)
+	{
+		if (cellStart[c]==cellStart[c+1])
+			continue;
+		Cell cell;
+		cell.first = cellStart[c];
+		cell.last = cellStart[c+1];
+		cell.center.set(0.f, 0.f, 0.f);
+		cell.maxMotion = 0.f;
+		for (int j=cell.first;j<cell.last;++j)
+		{
+			cell.center += pos[starIndex[j]];
+			cell.maxMotion = qMax(cell.maxMotion, motion[starIndex[j]]);
+		}
+		cell.center.normalize();
+		// Use atan2 in double precision, acos is not accurate for small angles.
+		const Vec3d cd(cell.center[0], cell.center[1], cell.center[2]);
+		double radius = 0.;
+		for (int j=cell.first;j<cell.last;++j)
+		{
+			const Vec3f& p = pos[starIndex[j]];
+			const Vec3d pd(p[0], p[1], p[2]);
+			radius = qMax(radius, std::atan2((pd^cd).length(), pd*cd));
+		}
+		// Small margin against rounding errors.
+		cell.radius = (float)radius + 1e-6f;
+		cells.append(cell);
+	}
+	cells.squeeze();
+}
@@ -0,0 +1,126 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _STARZONEINDEX_HPP_
+#define _STARZONEINDEX_HPP_
+
+#include "VecMath.hpp"
+
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+
+//! @class StarZoneIndex
+//! Secondary spatial index over the stars of one zone, used for picking.
+//! The stars are bucketed in a regular grid of cells over the tangent plane
+//! of the zone. Each cell knows the bounding cap of its stars, so a cone
+//! search only has to look at the stars of the cells touching the cone.
+//! Inside a cell, the stars keep the catalog order (bright stars first),
+//! which allows to stop at a magnitude cutoff.
+class StarZoneIndex
+{
+public:
+	StarZoneIndex() {}
+
+	//! Build the index.
+	//! @param pos normalized J2000 positions of the stars at epoch J2000
+	//! @param mag magnitude index of the stars, as stored in the catalog
+	//! @param motion maximum angular displacement of each star per unit of movement factor
+	//! @param n number of stars
+	void build(const Vec3f* pos, const int* mag, const float* motion, int n);
+
+	//! Get the number of indexed stars.
+	int getNrOfStars() const {return starIndex.size();}
+
+	//! Get the number of cells of the grid.
+	int getNrOfCells() const {return cells.size();}
+
+	//! Get the memory used by the index, in bytes.
+	qint64 getMemoryUsage() const
+	{
+		return sizeof(*this) + cells.capacity()*sizeof(Cell) + starIndex.capacity()*sizeof(int) + starMag.capacity()*sizeof(quint8);
+	}
+
+	//! Call @em visitor with the index of each star which may lie inside the cone
+	//! of axis @em v and half aperture @em limFov (radian), and which magnitude index is
+	//! not larger than @em maxMag. The caller has to do the exact test.
+	//! @param movementFactor the movement factor of the query epoch, used to
+	//! enlarge the cells by the proper motion of their stars.
+	template<class Visitor>
+	void query(const Vec3f& v, float limFov, float movementFactor, int maxMag, Visitor& visitor) const
+	{
+		const Vec3d vd(v[0], v[1], v[2]);
+		const double absMovement = std::fabs(movementFactor);
+		for (int c=0;c<cells.size();++c)
+		{
+			const Cell& cell = cells.at(c);
+			if (starMag.at(cell.first)>maxMag)
+				continue;
+			const double reach = limFov + cell.radius + absMovement*cell.maxMotion;
+			if (reach<M_PI)
+			{
+				const Vec3d center(cell.center[0], cell.center[1], cell.center[2]);
+				if (std::atan2((vd^center).length(), vd*center) > reach)
+					continue;
+			}
+			for (int i=cell.first;i<cell.last && starMag.at(i)<=maxMag;++i)
+				visitor(starIndex.at(i));
+		}
+	}
+
+	//! Partially sort @em hits so that the best picking candidates come first, and return
+	//! the number of candidates to keep, at most @em n. The best candidates minimize
+	//! degreeWeight*distance + magnitude, with the distance in degree, like
+	//! StelObjectMgr::cleverFind(). Hit must have the cosDistance and mag members.
+	template<class Hit>
+	static int selectPickingCandidates(QVector<Hit>& hits, int n, double degreeWeight)
+	{
+		struct Better
+		{
+			double degreeWeight;
+			// Same magnitude limit as StelObject::getSelectPriority().
+			double score(const Hit& h) const
+			{
+				return degreeWeight*(180./M_PI)*std::acos(qBound(-1., (double)h.cosDistance, 1.)) + qMin(h.mag, 15.f);
+			}
+			bool operator()(const Hit& a, const Hit& b) const {return score(a)<score(b);}
+		};
+		n = qBound(0, n, hits.size());
+		const Better better = {degreeWeight};
+		std::partial_sort(hits.begin(), hits.begin()+n, hits.end(), better);
+		return n;
+	}
+
+private:
+	struct Cell
+	{
+		Vec3f center;		// normalized mean direction of the stars in the cell
+		float radius;		// angular radius in radian of the cap containing the stars
+		float maxMotion;	// largest motion of the stars of the cell
+		int first;		// first star of the cell in starIndex
+		int last;		// one past the last star of the cell
+	};
+	QVector<Cell> cells;
+	//! Index of the stars in the zone, grouped by cell, sorted by magnitude in each cell.
+	QVector<int> starIndex;
+	//! Magnitude index of the stars, in the same order as starIndex.
+	QVector<quint8> starMag;
+};
+
+#endif // _STARZONEINDEX_HPP_
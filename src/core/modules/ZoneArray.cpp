@@ -18,6 +18,7 @@
  */
 
 #include "ZoneArray.hpp"
+#include "StarBatch.hpp"
 #include "StelApp.hpp"
 #include "StelFileMgr.hpp"
 #include "StelGeodesicGrid.hpp"
@@ -27,9 +28,15 @@
 #include <QDebug>
 #include <QFile>
 #include <QDir>
+#include <QVarLengthArray>
+
+#include <cmath>
+
 #ifdef Q_OS_WIN
 #include <io.h>
 #include <windows.h>
+#else
+#include <sys/mman.h>
 #endif
 
 
@@ -90,7 +97,7 @@ static inline int ReadInt(QFile& file, unsigned int &x)
 #endif
 #endif
 
-ZoneArray* ZoneArray::create(const QString& catalogFilePath, bool use_mmap)
+ZoneArray* ZoneArray::create(const QString& catalogFilePath, bool use_mmap, bool streamed)
 {
 	QString dbStr; // for debugging output.
 	QFile* file = new QFile(catalogFilePath);
@@ -115,6 +122,7 @@ ZoneArray* ZoneArray::create(const QString& catalogFilePath, bool use_mmap)
 		return 0;
 	}
 	const bool byte_swap = (magic == FILE_MAGIC_OTHER_ENDIAN);
+	const bool paged = (magic == FILE_MAGIC_PAGED);
 	if (byte_swap)
 	{
 		// ok, FILE_MAGIC_OTHER_ENDIAN, must swap
@@ -124,7 +132,7 @@ ZoneArray* ZoneArray::create(const QString& catalogFilePath, bool use_mmap)
 #if (!defined(__GNUC__))
 			dbStr += "to native format ";
 #endif
-			dbStr += "before mmap loading";
+			dbStr += "before mmap loading (see stars/flag_repack_catalogs)";
 			qWarning() << dbStr;
 			use_mmap = false;
 			qWarning() << "Revert to not using mmmap";
@@ -157,6 +165,11 @@ ZoneArray* ZoneArray::create(const QString& catalogFilePath, bool use_mmap)
 	{
 		// ok, will work for any architecture and any compiler
 	}
+	else if (paged)
+	{
+		// ok, always mapped read-only, whatever use_mmap says
+		dbStr += "paged ";
+	}
 	else
 	{
 		dbStr += "error - not a catalogue file.";
@@ -166,6 +179,16 @@ ZoneArray* ZoneArray::create(const QString& catalogFilePath, bool use_mmap)
 	ZoneArray *rval = Q_NULLPTR;
 	dbStr += QString("%1_%2v%3_%4; ").arg(level).arg(type).arg(major).arg(minor);
 
+	// The Hipparcos stars are always all in memory, because of the HIP index.
+	LoadMode mode = use_mmap ? MapAll : ReadAll;
+	if (paged)
+		mode = MapPaged;
+	else if (streamed && type != 0)
+	{
+		mode = Streamed;
+		dbStr += "streamed ";
+	}
+
 	switch (type)
 	{
 		case 0:
@@ -180,7 +203,7 @@ ZoneArray* ZoneArray::create(const QString& catalogFilePath, bool use_mmap)
 				// Because your compiler does not pack the data,
 				// which is crucial for this application.
 				Q_ASSERT(sizeof(Star1) == 28);
-				rval = new HipZoneArray(file, byte_swap, use_mmap, level, mag_min, mag_range, mag_steps);
+				rval = new HipZoneArray(file, byte_swap, mode, level, mag_min, mag_range, mag_steps);
 				if (rval == 0)
 				{
 					dbStr += "error - no memory ";
@@ -201,7 +224,7 @@ ZoneArray* ZoneArray::create(const QString& catalogFilePath, bool use_mmap)
 #ifndef _MSC_BUILD
 				Q_ASSERT(sizeof(Star2) == 10);
 #endif
-				rval = new SpecialZoneArray<Star2>(file, byte_swap, use_mmap, level, mag_min, mag_range, mag_steps);
+				rval = new SpecialZoneArray<Star2>(file, byte_swap, mode, level, mag_min, mag_range, mag_steps);
 				if (rval == Q_NULLPTR)
 				{
 					dbStr += "error - no memory ";
@@ -222,7 +245,7 @@ ZoneArray* ZoneArray::create(const QString& catalogFilePath, bool use_mmap)
 #ifndef _MSC_BUILD
 				Q_ASSERT(sizeof(Star3) == 6);
 #endif
-				rval = new SpecialZoneArray<Star3>(file, byte_swap, use_mmap, level, mag_min, mag_range, mag_steps);
+				rval = new SpecialZoneArray<Star3>(file, byte_swap, mode, level, mag_min, mag_range, mag_steps);
 				if (rval == Q_NULLPTR)
 				{
 					dbStr += "error - no memory ";
@@ -251,15 +274,83 @@ ZoneArray* ZoneArray::create(const QString& catalogFilePath, bool use_mmap)
 	return rval;
 }
 
-ZoneArray::ZoneArray(const QString& fname, QFile* file, int level, int mag_min,
+ZoneArray::ZoneArray(const QString& fname, QFile* file, LoadMode mode, int level, int mag_min,
 			 int mag_range, int mag_steps)
 			: fname(fname), level(level), mag_min(mag_min),
 			  mag_range(mag_range), mag_steps(mag_steps),
-			  star_position_scale(0.0), nr_of_stars(0), zones(Q_NULLPTR), file(file)
+			  star_position_scale(0.0), nr_of_stars(0), zones(Q_NULLPTR), file(file), loadMode(mode),
+			  stream(Q_NULLPTR), searchIndexSize(0)
 {
 	nr_of_zones = StelGeodesicGrid::nrOfZones(level);	
 }
 
+ZoneArray::~ZoneArray()
+{
+	delete stream;
+	stream = Q_NULLPTR;
+	qDeleteAll(searchIndexes);
+	searchIndexes.clear();
+	nr_of_zones = 0;
+}
+
+void ZoneArray::initStreaming(qint64 dataStart, int recordSize)
+{
+	stream = new StarZoneStream(file, zones, nr_of_zones, dataStart, recordSize);
+}
+
+void ZoneArray::closeStream()
+{
+	delete stream;
+	stream = Q_NULLPTR;
+}
+
+bool ZoneArray::loadZone(int index) const
+{
+	return stream == Q_NULLPTR || stream->load(index);
+}
+
+void ZoneArray::getResidentZones(QVector<ResidentZone>& result)
+{
+	if (stream == Q_NULLPTR)
+		return;
+	QVector<StarZoneStream::ResidentZone> streamZones;
+	stream->getResidentZones(streamZones);
+	QMutexLocker locker(&searchIndexMutex);
+	foreach (const StarZoneStream::ResidentZone& z, streamZones)
+	{
+		ResidentZone r = {z.lastUse, z.size, this, z.zone};
+		if (!searchIndexes.isEmpty() && searchIndexes.at(z.zone) != Q_NULLPTR)
+			r.size += searchIndexes.at(z.zone)->getMemoryUsage();
+		result.append(r);
+	}
+}
+
+qint64 ZoneArray::releaseZone(int index)
+{
+	if (stream == Q_NULLPTR)
+		return 0;
+	qint64 size = stream->release(index);
+	QMutexLocker locker(&searchIndexMutex);
+	if (!searchIndexes.isEmpty() && searchIndexes.at(index) != Q_NULLPTR)
+	{
+		const qint64 indexSize = searchIndexes.at(index)->getMemoryUsage();
+		delete searchIndexes.at(index);
+		searchIndexes[index] = Q_NULLPTR;
+		searchIndexSize -= indexSize;
+		size += indexSize;
+	}
+	return size;
+}
+
+qint64 ZoneArray::getResidentSize() const
+{
+	if (stream == Q_NULLPTR)
+		return 0;
+	QMutexLocker locker(&searchIndexMutex);
+	return stream->getResidentSize() + stream->getTableSize() + searchIndexSize
+		+ searchIndexes.capacity()*sizeof(StarZoneIndex*);
+}
+
 bool ZoneArray::readFile(QFile& file, void *data, qint64 size)
 {
 	int parts = 256;
@@ -316,12 +407,71 @@ void SpecialZoneArray<Star>::scaleAxis()
 }
 
 template<class Star>
-SpecialZoneArray<Star>::SpecialZoneArray(QFile* file, bool byte_swap,bool use_mmap,
+bool SpecialZoneArray<Star>::mapPagedCatalog()
+{
+	const qint64 fileSize = file->size();
+	const qint64 tableEnd = sizeof(PagedCatalogHeader) + (qint64)sizeof(PagedZoneEntry)*nr_of_zones;
+	if (fileSize < tableEnd)
+	{
+		qDebug() << "Error reading zones from catalog:" << file->fileName();
+		return false;
+	}
+	mmap_start = file->map(0, fileSize);
+	if (mmap_start == Q_NULLPTR)
+	{
+		qDebug() << "ERROR: SpecialZoneArray(" << level
+			 << ")::mapPagedCatalog: QFile(" << file->fileName()
+			 << ".map(0," << fileSize
+			 << ") failed: " << file->errorString();
+		return false;
+	}
+#ifndef Q_OS_WIN
+	// Zones are looked at in the order of the viewport, not of the file:
+	// disable read-ahead, but load the zone table which is used right now.
+	posix_madvise(mmap_start, fileSize, POSIX_MADV_RANDOM);
+	posix_madvise(mmap_start, tableEnd, POSIX_MADV_WILLNEED);
+#endif
+	const PagedZoneEntry* table = StarCatalogFile::checkPaged(mmap_start, fileSize, nr_of_zones, sizeof(Star));
+	if (table == Q_NULLPTR)
+	{
+		qDebug() << "Error: bad zone table in catalog:" << file->fileName();
+		file->unmap(mmap_start);
+		mmap_start = Q_NULLPTR;
+		return false;
+	}
+	for (unsigned int z=0;z<nr_of_zones;z++)
+	{
+		getZones()[z].size = table[z].size;
+		getZones()[z].stars = mmap_start + table[z].offset;
+		nr_of_stars += table[z].size;
+	}
+	stars = reinterpret_cast<Star*>(mmap_start);
+	return true;
+}
+
+template<class Star>
+SpecialZoneArray<Star>::SpecialZoneArray(QFile* file, bool byte_swap,LoadMode mode,
 					 int level, int mag_min, int mag_range, int mag_steps)
-		: ZoneArray(file->fileName(), file, level, mag_min, mag_range, mag_steps),
+		: ZoneArray(file->fileName(), file, mode, level, mag_min, mag_range, mag_steps),
 		  stars(0), mmap_start(0)
 {
-	if (nr_of_zones > 0)
+	if (nr_of_zones > 0 && mode == MapPaged)
+	{
+		zones = new SpecialZoneData<Star>[nr_of_zones];
+		if (!mapPagedCatalog() || nr_of_stars == 0)
+		{
+			if (mmap_start != Q_NULLPTR)
+				file->unmap(mmap_start);
+			mmap_start = Q_NULLPTR;
+			stars = Q_NULLPTR;
+			nr_of_stars = 0;
+			delete[] getZones();
+			zones = Q_NULLPTR;
+			nr_of_zones = 0;
+		}
+		file->close();
+	}
+	else if (nr_of_zones > 0)
 	{
 		zones = new SpecialZoneData<Star>[nr_of_zones];
 		if (zones == Q_NULLPTR)
@@ -369,7 +519,12 @@ SpecialZoneArray<Star>::SpecialZoneArray(QFile* file, bool byte_swap,bool use_mm
 		}
 		else
 		{
-			if (use_mmap)
+			if (mode == Streamed)
+			{
+				// The file stays open, the stars are read by loadZone().
+				initStreaming(file->pos(), sizeof(Star));
+			}
+			else if (mode == MapAll)
 			{
 				mmap_start = file->map(file->pos(), sizeof(Star)*nr_of_stars);
 				if (mmap_start == Q_NULLPTR)
@@ -436,6 +591,7 @@ SpecialZoneArray<Star>::SpecialZoneArray(QFile* file, bool byte_swap,bool use_mm
 template<class Star>
 SpecialZoneArray<Star>::~SpecialZoneArray(void)
 {
+	closeStream();
 	if (stars)
 	{
 		if (mmap_start != Q_NULLPTR)
@@ -446,9 +602,10 @@ SpecialZoneArray<Star>::~SpecialZoneArray(void)
 		{
 			delete[] stars;
 		}
-		delete file;
 		stars = Q_NULLPTR;
 	}
+	delete file;
+	file = Q_NULLPTR;
 	if (zones)
 	{
 		delete[] getZones();
@@ -458,20 +615,117 @@ SpecialZoneArray<Star>::~SpecialZoneArray(void)
 	nr_of_stars = 0;
 }
 
+//! Draws the stars of a zone directly with the StelSkyDrawer, from the main thread.
+struct DirectStarSink
+{
+	StelPainter* sPainter;
+	StelSkyDrawer* drawer;
+	float names_brightness;
+
+	bool addStar(const Vec3f& v, const RCMag& rcMag, int bV, bool checkInScreen, float twinkleFactor, quint32)
+	{
+		return drawer->drawPointSource(sPainter, v, rcMag, bV, checkInScreen, twinkleFactor);
+	}
+
+	void addLabel(const Vec3f& v, const QString& name, float offset, int bV)
+	{
+		const Vec3f colorr = StelSkyDrawer::indexToColor(bV)*0.75f;
+		sPainter->setColor(colorr[0], colorr[1], colorr[2],names_brightness);
+		sPainter->drawText(Vec3d(v[0], v[1], v[2]), name, 0, offset, offset, false);
+	}
+};
+
+//! Stores the projected stars of a zone in a StarDrawBuffer. Can be used from worker threads.
+struct BufferStarSink
+{
+	StarDrawBuffer& buffer;
+	const StelSkyDrawer* drawer;
+	const StelProjectorP& prj;
+	quint32 twinkleSeed;
+
+	BufferStarSink(StarDrawBuffer& buffer, const StelSkyDrawer* drawer, const StelProjectorP& prj, quint32 twinkleSeed)
+		: buffer(buffer), drawer(drawer), prj(prj), twinkleSeed(twinkleSeed) {}
+
+	// Deterministic replacement for qrand(), mixing the frame seed with the star identifier.
+	float twinkleRandom(quint32 starId) const
+	{
+		quint32 h = starId*0x9E3779B1u ^ twinkleSeed;
+		h ^= h >> 16;
+		h *= 0x85EBCA6Bu;
+		h ^= h >> 13;
+		h *= 0xC2B2AE35u;
+		h ^= h >> 16;
+		return (h >> 8)*(1.f/16777215.f);
+	}
+
+	bool addStar(const Vec3f& v, const RCMag& rcMag, int bV, bool checkInScreen, float twinkleFactor, quint32 starId)
+	{
+		StelSkyDrawer::ProjectedPointSource source;
+		if (!drawer->computePointSource(prj, v, rcMag, StelSkyDrawer::indexToColor(bV), checkInScreen, twinkleFactor, twinkleRandom(starId), source))
+			return false;
+		buffer.points.append(source);
+		return true;
+	}
+
+	void addLabel(const Vec3f& v, const QString& name, float offset, int bV)
+	{
+		StarDrawBuffer::Label label;
+		label.pos = v;
+		label.color = StelSkyDrawer::indexToColor(bV)*0.75f;
+		label.offset = offset;
+		label.name = name;
+		buffer.labels.append(label);
+	}
+};
+
 template<class Star>
 void SpecialZoneArray<Star>::draw(StelPainter* sPainter, int index, bool isInsideViewport, const RCMag* rcmag_table,
 				  int limitMagIndex, StelCore* core, int maxMagStarName, float names_brightness,
 				  const QVector<SphericalCap> &boundingCaps) const
 {
-	StelSkyDrawer* drawer = core->getSkyDrawer();
+	DirectStarSink sink = {sPainter, core->getSkyDrawer(), names_brightness};
+	drawZone(sink, index, isInsideViewport, rcmag_table, limitMagIndex, core, maxMagStarName, boundingCaps);
+}
+
+template<class Star>
+void SpecialZoneArray<Star>::computeDraw(StarDrawBuffer& buffer, const StelProjectorP& prj, int index, bool isInsideViewport,
+					 const RCMag* rcmag_table, int limitMagIndex, const StelCore* core,
+					 int maxMagStarName, const QVector<SphericalCap>& boundingCaps,
+					 quint32 twinkleSeed) const
+{
+	// Make the seed depend on the zone, so that stars at the same place in different zones twinkle independently.
+	BufferStarSink sink(buffer, core->getSkyDrawer(), prj, twinkleSeed ^ ((quint32)level << 24) ^ ((quint32)index*0x27D4EB2Du));
+	drawZone(sink, index, isInsideViewport, rcmag_table, limitMagIndex, core, maxMagStarName, boundingCaps);
+}
+
+template<class Star>
+template<class Sink>
+void SpecialZoneArray<Star>::drawZone(Sink& sink, int index, bool isInsideViewport, const RCMag* rcmag_table,
+				      int limitMagIndex, const StelCore* core, int maxMagStarName,
+				      const QVector<SphericalCap> &boundingCaps) const
+{
+	if (!loadZone(index))
+		return;
+	const StelSkyDrawer* drawer = core->getSkyDrawer();
 	Vec3f vf;
 	static const double d2000 = 2451545.0;
 	const float movementFactor = (M_PI/180.)*(0.0001/3600.) * ((core->getJDE()-d2000)/365.25) / star_position_scale;
 
 	// GZ, added for extinction
-	const Extinction& extinction=core->getSkyDrawer()->getExtinction();
+	const Extinction& extinction=drawer->getExtinction();
 	const bool withExtinction=drawer->getFlagHasAtmosphere() && extinction.getExtinctionCoefficient()>=0.01f;
 	const float k = 0.001f*mag_range/mag_steps; // from StarMgr.cpp line 654
+	// Only the altitude is needed for the extinction, so take the third row of the
+	// J2000 to altazimuthal rotation once for the whole zone.
+	float altRow[3] = {0.f, 0.f, 0.f};
+	if (withExtinction)
+	{
+		const Mat4d& m = core->getJ2000ToAltAzMatrix();
+		altRow[0] = m.r[2];
+		altRow[1] = m.r[6];
+		altRow[2] = m.r[10];
+	}
+	float sinAlt[StarPositionBlock::Size];
 	
 	// Allow artificial cutoff:
 	// find the (integer) mag at which is just bright enough to be drawn.
@@ -484,85 +738,150 @@ void SpecialZoneArray<Star>::draw(StelPainter* sPainter, int index, bool isInsid
 	}
 	Q_ASSERT(cutoffMagStep<RCMAG_TABLE_SIZE);
     
-	// Go through all stars, which are sorted by magnitude (bright stars first)
+	// Copy the bounding caps once, so that the culling of each block of stars can be done with SSE.
+	QVarLengthArray<StarBlockCap, 8> caps(isInsideViewport ? 0 : boundingCaps.size());
+	for (int i=0;i<caps.size();++i)
+	{
+		const SphericalCap& cap = boundingCaps.at(i);
+		caps[i].n[0] = cap.n[0];
+		caps[i].n[1] = cap.n[1];
+		caps[i].n[2] = cap.n[2];
+		caps[i].d = cap.d;
+	}
+
+	// Go through all stars, which are sorted by magnitude (bright stars first).
+	// Stars are decoded in blocks, culled per block, and then drawn one by one.
+	StarPositionBlock block;
 	const SpecialZoneData<Star>* zoneToDraw = getZones() + index;
 	const Star* lastStar = zoneToDraw->getStars() + zoneToDraw->size;
-	for (const Star* s=zoneToDraw->getStars();s<lastStar;++s)
+	for (const Star* blockStart=zoneToDraw->getStars();blockStart<lastStar;)
 	{
-		// Artifical cutoff per magnitude
-		if (s->getMag() > cutoffMagStep)
+		// Artifical cutoff per magnitude is done while decoding.
+		const int nbDecoded = decodeStarBlock(zoneToDraw, blockStart, lastStar, movementFactor, cutoffMagStep, block);
+		if (nbDecoded==0)
 			break;
-    
-		// Because of the test above, the star should always be visible from this point.
-		
-		// Array of 2 numbers containing radius and magnitude
-		const RCMag* tmpRcmag = &rcmag_table[s->getMag()];
-		
-		// Get the star position from the array
-		s->getJ2000Pos(zoneToDraw, movementFactor, vf);
-		
-		// If the star zone is not strictly contained inside the viewport, eliminate from the 
+
+		// If the star zone is not strictly contained inside the viewport, eliminate from the
 		// beginning the stars actually outside viewport.
 		if (!isInsideViewport)
+			cullStarBlock(block, caps.constData(), caps.size());
+		if (withExtinction)
+		{
+			if (isInsideViewport)
+				normalizeStarBlock(block);
+			computeStarBlockAltitudes(block, altRow, sinAlt);
+		}
+
+		for (int i=0;i<block.count;++i)
 		{
-			vf.normalize();
-			bool isVisible = true;
-			foreach (const SphericalCap& cap, boundingCaps)
+			const Star* s = blockStart + block.index[i];
+			vf.set(block.x[i], block.y[i], block.z[i]);
+
+			// Because of the magnitude cutoff, the star should always be visible from this point.
+			// Array of 2 numbers containing radius and magnitude
+			const RCMag* tmpRcmag = &rcmag_table[s->getMag()];
+
+			int extinctedMagIndex = s->getMag();
+			float twinkleFactor=1.0f; // allow height-dependent twinkle.
+			if (withExtinction)
 			{
-				if (!cap.contains(vf))
-				{
-					isVisible = false;
+				const float extMagShift=extinction.forwardFromTable(sinAlt[i]);
+				extinctedMagIndex = s->getMag() + (int)(extMagShift/k);
+				if (extinctedMagIndex >= cutoffMagStep || extinctedMagIndex<0) // i.e., if extincted it is dimmer than cutoff or extinctedMagIndex is negative (missing star catalog), so remove
 					continue;
-				}
+				tmpRcmag = &rcmag_table[extinctedMagIndex];
+				twinkleFactor=qMin(1.0f, 1.0f-0.9f*sinAlt[i]); // suppress twinkling in higher altitudes. Keep 0.1 twinkle amount in zenith.
 			}
-			if (!isVisible)
-				continue;
-		}
 
-		int extinctedMagIndex = s->getMag();
-		float twinkleFactor=1.0f; // allow height-dependent twinkle.
-		if (withExtinction)
-		{
-			Vec3f altAz(vf);
-			altAz.normalize();
-			core->j2000ToAltAzInPlaceNoRefraction(&altAz);
-			float extMagShift=0.0f;
-			extinction.forward(altAz, &extMagShift);
-			extinctedMagIndex = s->getMag() + (int)(extMagShift/k);
-			if (extinctedMagIndex >= cutoffMagStep || extinctedMagIndex<0) // i.e., if extincted it is dimmer than cutoff or extinctedMagIndex is negative (missing star catalog), so remove
-				continue;
-			tmpRcmag = &rcmag_table[extinctedMagIndex];
-			twinkleFactor=qMin(1.0f, 1.0f-0.9f*altAz[2]); // suppress twinkling in higher altitudes. Keep 0.1 twinkle amount in zenith.
+			const quint32 starId = (quint32)(s - zoneToDraw->getStars());
+			if (sink.addStar(vf, *tmpRcmag, s->getBVIndex(), !isInsideViewport, twinkleFactor, starId) && s->hasName() && extinctedMagIndex < maxMagStarName && s->hasComponentID()<=1)
+			{
+				sink.addLabel(vf, s->getNameI18n(), tmpRcmag->radius*0.7f, s->getBVIndex());
+			}
 		}
+		blockStart += nbDecoded;
+	}
+}
 
-		if (drawer->drawPointSource(sPainter, vf, *tmpRcmag, s->getBVIndex(), !isInsideViewport, twinkleFactor) && s->hasName() && extinctedMagIndex < maxMagStarName && s->hasComponentID()<=1)
+// Proper motion of a star in catalog units, used to enlarge the cells of the search index.
+static inline float starMotion(const Star1& s) {return std::sqrt((float)s.getDx0()*s.getDx0()+(float)s.getDx1()*s.getDx1());}
+static inline float starMotion(const Star2& s) {return std::sqrt((float)s.getDx0()*s.getDx0()+(float)s.getDx1()*s.getDx1());}
+static inline float starMotion(const Star3&) {return 0.f;}
+
+template<class Star>
+const StarZoneIndex* SpecialZoneArray<Star>::getSearchIndex(int index)
+{
+	QMutexLocker locker(&searchIndexMutex);
+	if (searchIndexes.isEmpty())
+		searchIndexes.fill(Q_NULLPTR, nr_of_zones);
+	StarZoneIndex*& zoneIndex = searchIndexes[index];
+	if (zoneIndex==Q_NULLPTR)
+	{
+		// Index the J2000 positions, the query takes care of the proper motion.
+		const SpecialZoneData<Star> *const z = getZones()+index;
+		QVector<Vec3f> pos(z->size);
+		QVector<int> mag(z->size);
+		QVector<float> motion(z->size);
+		for (int i=0;i<z->size;++i)
 		{
-			const float offset = tmpRcmag->radius*0.7f;
-			const Vec3f colorr = StelSkyDrawer::indexToColor(s->getBVIndex())*0.75f;
-			sPainter->setColor(colorr[0], colorr[1], colorr[2],names_brightness);
-			sPainter->drawText(Vec3d(vf[0], vf[1], vf[2]), s->getNameI18n(), 0, offset, offset, false);
+			const Star& s = z->getStars()[i];
+			s.getJ2000Pos(z, 0.f, pos[i]);
+			pos[i].normalize();
+			mag[i] = s.getMag();
+			motion[i] = starMotion(s)*star_position_scale;
 		}
+		zoneIndex = new StarZoneIndex();
+		zoneIndex->build(pos.constData(), mag.constData(), motion.constData(), z->size);
+		searchIndexSize += zoneIndex->getMemoryUsage();
 	}
+	return zoneIndex;
 }
 
 template<class Star>
 void SpecialZoneArray<Star>::searchAround(const StelCore* core, int index, const Vec3d &v, double cosLimFov,
-					  QList<StelObjectP > &result)
+					  int maxMagIndex, QVector<StarSearchHit> &hits)
 {
+	if (!loadZone(index))
+		return;
 	static const double d2000 = 2451545.0;
 	const double movementFactor = (M_PI/180.)*(0.0001/3600.) * ((core->getJDE()-d2000)/365.25)/ star_position_scale;
 	const SpecialZoneData<Star> *const z = getZones()+index;
-	Vec3f tmp;
-	Vec3f vf(v[0], v[1], v[2]);
-	for (const Star* s=z->getStars();s<z->getStars()+z->size;++s)
+	const Vec3f vf(v[0], v[1], v[2]);
+
+	struct Visitor
 	{
-		s->getJ2000Pos(z,movementFactor, tmp);
-		tmp.normalize();
-		if (tmp*vf >= cosLimFov)
+		const SpecialZoneArray<Star>* a;
+		const SpecialZoneData<Star>* z;
+		int index;
+		const Vec3f& vf;
+		float movementFactor;
+		double cosLimFov;
+		QVector<StarSearchHit>& hits;
+		void operator()(int i)
 		{
-			// TODO: do not select stars that are too faint to display
-			result.push_back(s->createStelObject(this,z));
+			Vec3f tmp;
+			z->getStars()[i].getJ2000Pos(z, movementFactor, tmp);
+			tmp.normalize();
+			const float cosDistance = tmp*vf;
+			if (cosDistance >= cosLimFov)
+			{
+				const StarSearchHit hit = {cosDistance, a, index, i,
+							   0.001f*a->mag_min + z->getStars()[i].getMag()*(0.001f*a->mag_range)/a->mag_steps};
+				hits.append(hit);
+			}
 		}
-	}
+	} visitor = {this, z, index, vf, (float)movementFactor, cosLimFov, hits};
+
+	// The float dot product of the exact test accepts stars slightly outside of
+	// the cone, enlarge the cone of the query so that no such star is lost.
+	getSearchIndex(index)->query(vf, std::acos(qBound(-1., cosLimFov-1e-6, 1.)), movementFactor, maxMagIndex, visitor);
 }
 
+template<class Star>
+StelObjectP SpecialZoneArray<Star>::createStelObject(int index, int star) const
+{
+	if (!loadZone(index))
+		return StelObjectP();
+	const SpecialZoneData<Star> *const z = getZones()+index;
+	return z->getStars()[star].createStelObject(this, z);
+}
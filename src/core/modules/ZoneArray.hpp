@@ -25,6 +25,8 @@
 
 #include "ZoneData.hpp"
 #include "Star.hpp"
+#include "StarZoneIndex.hpp"
+#include "StarCatalogFile.hpp"
 
 #include "StelCore.hpp"
 #include "StelSkyDrawer.hpp"
@@ -33,6 +35,8 @@
 #include <QString>
 #include <QFile>
 #include <QDebug>
+#include <QVector>
+#include <QMutex>
 
 #ifdef __OpenBSD__
 #include <unistd.h>
@@ -53,11 +57,6 @@ class StelPainter;
 
 
 #define NR_OF_HIP 120416
-#define FILE_MAGIC 0x835f040a
-#define FILE_MAGIC_OTHER_ENDIAN 0x0a045f83
-#define FILE_MAGIC_NATIVE 0x835f040b
-#define MAX_MAJOR_FILE_VERSION 0
-
 //! @struct HipIndexStruct
 //! Container for Hipparcos information. Stores a pointer to a Hipparcos star,
 //! its catalog and its triangle.
@@ -68,6 +67,43 @@ struct HipIndexStruct
 	const Star1 *s;
 };
 
+//! @struct StarDrawBuffer
+//! Stars of some zones projected by ZoneArray::computeDraw() in a worker thread,
+//! waiting to be submitted to the StelSkyDrawer from the main thread.
+struct StarDrawBuffer
+{
+	struct Label
+	{
+		Vec3f pos;
+		Vec3f color;
+		float offset;
+		QString name;
+	};
+	QVector<StelSkyDrawer::ProjectedPointSource> points;
+	QVector<Label> labels;
+
+	//! Empty the buffer, keeping the allocated memory.
+	void clear()
+	{
+		points.resize(0);
+		labels.resize(0);
+	}
+};
+
+//! @struct StarSearchHit
+//! A star found by ZoneArray::searchAround(), before any StelObject is created for it.
+struct StarSearchHit
+{
+	//! Cosine of the angular distance to the search center.
+	float cosDistance;
+	const ZoneArray* zoneArray;
+	int zone;
+	//! Index of the star in its zone.
+	int star;
+	//! Catalog V magnitude of the star.
+	float mag;
+};
+
 //! @class ZoneArray
 //! Manages all ZoneData structures of a given StelGeodesicGrid level. An
 //! instance of this class is never created directly; the named constructor
@@ -81,22 +117,80 @@ public:
 	//! loading.
 	//! @param extended_file_name path of the star catalog to load from
 	//! @param use_mmap whether or not to mmap the star catalog
+	//! @param streamed whether to read the stars of a zone only when the zone is first
+	//! used, see loadZone(). Ignored for Hipparcos and FILE_MAGIC_PAGED catalogs.
 	//! @return an instance of SpecialZoneArray or HipZoneArray
-	static ZoneArray *create(const QString &extended_file_name, bool use_mmap);
-	virtual ~ZoneArray()
-	{
-		nr_of_zones = 0;
-	}
+	static ZoneArray *create(const QString &extended_file_name, bool use_mmap, bool streamed=false);
+
+	virtual ~ZoneArray();
 
 	//! Get the total number of stars in this catalog.
 	unsigned int getNrOfStars() const { return nr_of_stars; }
 
+	//! How the star records of a catalog are brought into memory.
+	enum LoadMode
+	{
+		ReadAll,	//!< Read the whole catalog when it is loaded.
+		MapAll,		//!< Map the whole catalog with mmap.
+		MapPaged,	//!< Map a FILE_MAGIC_PAGED catalog with mmap.
+		Streamed	//!< Read the stars of a zone the first time the zone is used.
+	};
+
+	//! Get whether the stars of the zones are read on demand.
+	bool isStreamed() const {return loadMode==Streamed;}
+
+	//! Make sure the stars of a zone are in memory, reading them from the catalog
+	//! if needed. Does nothing unless the catalog is streamed. Thread safe.
+	//! @return @c false if the stars could not be read
+	bool loadZone(int index) const;
+
+	//! Set the stamp recorded by loadZone() for the least recently used zones eviction.
+	//! StarMgr uses its frame counter.
+	void setZoneUseStamp(quint32 stamp) {if (stream) stream->setUseStamp(stamp);}
+
+	//! A zone in memory of a streamed catalog.
+	struct ResidentZone
+	{
+		quint32 lastUse;
+		//! Memory used by the stars of the zone and by its search index, in bytes.
+		qint64 size;
+		ZoneArray* zoneArray;
+		int zone;
+	};
+
+	//! Add the zones in memory of a streamed catalog to @em result.
+	void getResidentZones(QVector<ResidentZone>& result);
+
+	//! Free the stars of a zone of a streamed catalog, and its search index.
+	//! The stars must not be used by anybody.
+	//! @return the number of freed bytes
+	qint64 releaseZone(int index);
+
+	//! Get the number of zones in memory of a streamed catalog.
+	int getNrOfResidentZones() const {return stream ? stream->getNrOfResidentZones() : 0;}
+	//! Get the memory used by a streamed catalog, in bytes: the stars of the zones
+	//! in memory, the search indexes and the table of the zones.
+	qint64 getResidentSize() const;
+	//! Get how many times the stars of a zone of a streamed catalog were read.
+	int getNrOfPageIns() const {return stream ? stream->getNrOfPageIns() : 0;}
+
 	//! Dummy method that does nothing. See subclass implementation.
 	virtual void updateHipIndex(HipIndexStruct hipIndex[]) const {Q_UNUSED(hipIndex);}
 
 	//! Pure virtual method. See subclass implementation.
-	virtual void searchAround(const StelCore* core, int index,const Vec3d &v,double cosLimFov,
-							  QList<StelObjectP > &result) = 0;
+	virtual void searchAround(const StelCore* core, int index, const Vec3d &v, double cosLimFov,
+				  int maxMagIndex, QVector<StarSearchHit> &hits) = 0;
+
+	//! Pure virtual method. See subclass implementation.
+	virtual StelObjectP createStelObject(int index, int star) const = 0;
+
+	//! Get the index in the magnitude steps of this catalog of the given magnitude.
+	//! Stars with a magnitude index smaller or equal to the returned value are
+	//! at least as bright as @em mag.
+	int getMagIndex(float mag) const
+	{
+		return (int)std::floor(((double)mag*1000.-mag_min)*mag_steps/mag_range);
+	}
 
 	//! Pure virtual method. See subclass implementation.
 	virtual void draw(StelPainter* sPainter, int index,bool is_inside,
@@ -104,6 +198,12 @@ public:
 					  int maxMagStarName, float names_brightness,
 					  const QVector<SphericalCap>& boundingCaps) const = 0;
 
+	//! Pure virtual method. See subclass implementation.
+	virtual void computeDraw(StarDrawBuffer& buffer, const StelProjectorP& prj, int index, bool is_inside,
+				 const RCMag* rcmag_table, int limitMagIndex, const StelCore* core,
+				 int maxMagStarName, const QVector<SphericalCap>& boundingCaps,
+				 quint32 twinkleSeed) const = 0;
+
 	//! Get whether or not the catalog was successfully loaded.
 	//! @return @c true if at least one zone was loaded, otherwise @c false
 	bool isInitialized(void) const { return (nr_of_zones>0); }
@@ -136,11 +236,31 @@ protected:
 	static bool readFile(QFile& file, void *data, qint64 size);
 
 	//! Protected constructor. Initializes fields and does not load anything.
-	ZoneArray(const QString& fname, QFile* file, int level, int mag_min, int mag_range, int mag_steps);
+	ZoneArray(const QString& fname, QFile* file, LoadMode mode, int level, int mag_min, int mag_range, int mag_steps);
+
+	//! Prepare a streamed catalog: compute where the stars of each zone are in the
+	//! file, which is kept open. The sizes of the zones must be known.
+	//! @param dataStart offset of the first star in the file
+	//! @param recordSize size of a star record
+	void initStreaming(qint64 dataStart, int recordSize);
+
+	//! Free the stars of all the zones of a streamed catalog and stop reading them.
+	//! Must be called before the zones are deleted.
+	void closeStream();
+
 	unsigned int nr_of_zones;
 	unsigned int nr_of_stars;
 	ZoneData *zones;
 	QFile* file;
+	LoadMode loadMode;
+	//! Reads the zones of a streamed catalog, Q_NULLPTR for the other catalogs.
+	StarZoneStream* stream;
+
+	//! Search index of each zone, Q_NULLPTR until the zone is searched for the first time.
+	QVector<StarZoneIndex*> searchIndexes;
+	//! Memory used by the search indexes, in bytes.
+	qint64 searchIndexSize;
+	mutable QMutex searchIndexMutex;
 };
 
 //! @class SpecialZoneArray
@@ -155,12 +275,12 @@ public:
 	//! Handles loading of the meaty part of star catalogs.
 	//! @param file catalog to load from
 	//! @param byte_swap whether to switch endianness of catalog data
-	//! @param use_mmap whether or not to mmap the star catalog
+	//! @param mode how to bring the stars into memory
 	//! @param level level in StelGeodesicGrid
 	//! @param mag_min lower bound of magnitudes
 	//! @param mag_range range of magnitudes
 	//! @param mag_steps number of steps used to describe values in range
-	SpecialZoneArray(QFile* file,bool byte_swap,bool use_mmap,int level,int mag_min,
+	SpecialZoneArray(QFile* file,bool byte_swap,LoadMode mode,int level,int mag_min,
 			 int mag_range,int mag_steps);
 	~SpecialZoneArray(void);
 protected:
@@ -184,12 +304,43 @@ protected:
 			  int maxMagStarName, float names_brightness,
 			  const QVector<SphericalCap>& boundingCaps) const;
 
+	//! Same as draw(), but store the projected stars and labels in @em buffer
+	//! instead of drawing them. This method does not touch the OpenGL state and
+	//! can be called for several zones at the same time from worker threads.
+	//! The twinkling of each star is derived from @em twinkleSeed and the
+	//! position of the star in the catalog, so that the result is deterministic.
+	virtual void computeDraw(StarDrawBuffer& buffer, const StelProjectorP& prj, int index, bool isInsideViewport,
+				 const RCMag* rcmag_table, int limitMagIndex, const StelCore* core,
+				 int maxMagStarName, const QVector<SphericalCap>& boundingCaps,
+				 quint32 twinkleSeed) const;
+
 	virtual void scaleAxis();
-	virtual void searchAround(const StelCore* core, int index,const Vec3d &v,double cosLimFov,
-					  QList<StelObjectP > &result);
+
+	//! Add to @em hits the stars of a zone which lie within the cone of axis @em v
+	//! and with cos(aperture)=@em cosLimFov, and which magnitude index is not larger
+	//! than @em maxMagIndex. The stars are looked up with a StarZoneIndex, built
+	//! the first time the zone is searched.
+	virtual void searchAround(const StelCore* core, int index, const Vec3d &v, double cosLimFov,
+				  int maxMagIndex, QVector<StarSearchHit> &hits);
+
+	//! Create the StelObject for the star number @em star of the zone @em index.
+	virtual StelObjectP createStelObject(int index, int star) const;
 
 	Star *stars;
 private:
+	//! Common implementation of draw() and computeDraw().
+	//! @tparam Sink receives the stars which survived culling and extinction.
+	template<class Sink>
+	void drawZone(Sink& sink, int index, bool isInsideViewport, const RCMag *rcmag_table, int limitMagIndex,
+		      const StelCore* core, int maxMagStarName, const QVector<SphericalCap>& boundingCaps) const;
+
+	//! Map a FILE_MAGIC_PAGED catalog and set up the zones from its zone table.
+	//! @return @c true if successful, or @c false if an error occurred
+	bool mapPagedCatalog();
+
+	//! Get the search index of a zone, building it if needed.
+	const StarZoneIndex* getSearchIndex(int index);
+
 	uchar *mmap_start;
 };
 
@@ -199,9 +350,9 @@ private:
 class HipZoneArray : public SpecialZoneArray<Star1>
 {
 public:
-	HipZoneArray(QFile* file,bool byte_swap,bool use_mmap,
+	HipZoneArray(QFile* file,bool byte_swap,LoadMode mode,
 		   int level,int mag_min,int mag_range,int mag_steps)
-			: SpecialZoneArray<Star1>(file,byte_swap,use_mmap,level,
+			: SpecialZoneArray<Star1>(file,byte_swap,mode,level,
 									  mag_min,mag_range,mag_steps) {}
 
 	//! Add Hipparcos information for all stars in this catalog into @em hipIndex.
@@ -0,0 +1,241 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "ChebyshevEphemCache.hpp"
+
+#include <QDebug>
+#include <QVarLengthArray>
+#include <cmath>
+
+// Windows are counted from J2000.
+static const double WINDOW_ORIGIN = 2451545.0;
+// A window is split at most this number of times.
+static const int MAX_SPLIT_LEVEL = 6;
+// Bias of the window index in the keys, so that windows before J2000 have a positive index.
+static const qint64 INDEX_BIAS = Q_INT64_C(1) << 40;
+
+static inline quint64 windowKey(int level, qint64 index)
+{
+	return ((quint64)level << 56) | (quint64)(index + INDEX_BIAS);
+}
+
+ChebyshevEphemCache::ChebyshevEphemCache(EphemFullCoorFunc func, int nrOfBodies, double windowLength, int degree)
+	: func(func)
+	, nrOfBodies(nrOfBodies)
+	, windowLength(windowLength)
+	, degree(degree)
+	, accuracy(1e-9)
+	, maxNrOfWindows(2048)
+	, accuracyWarned(false)
+{
+	const int n = degree+1;
+	cosTable.resize(n*n);
+	for (int j=0;j<n;++j)
+		for (int k=0;k<n;++k)
+			cosTable[j*n+k] = std::cos(M_PI*j*(k+0.5)/n);
+}
+
+void ChebyshevEphemCache::fitWindow(double start, double length, QVector<double>& coeffs, double* error) const
+{
+	const int n = degree+1;
+	const int dim = nrOfBodies*3;
+	// Values of the theory at the Chebyshev nodes, cosTable[n+k] being the node k.
+	QVarLengthArray<double, 1024> values(n*dim);
+	for (int k=0;k<n;++k)
+		func(start + 0.5*length*(1.+cosTable[n+k]), values.data()+k*dim);
+
+	coeffs.resize(n*dim);
+	for (int i=0;i<dim;++i)
+	{
+		double* c = coeffs.data()+i*n;
+		for (int j=0;j<n;++j)
+		{
+			double s = 0.;
+			for (int k=0;k<n;++k)
+				s += values[k*dim+i]*cosTable[j*n+k];
+			c[j] = s*(j==0 ? 1. : 2.)/n;
+		}
+	}
+
+	// The size of the last two coefficients is a good estimate of the truncation error.
+	*error = 0.;
+	for (int b=0;b<nrOfBodies;++b)
+	{
+		double e = 0.;
+		for (int i=b*3;i<b*3+3;++i)
+			e += std::fabs(coeffs[i*n+degree]) + std::fabs(coeffs[i*n+degree-1]);
+		*error = qMax(*error, e);
+	}
+}
+
+void ChebyshevEphemCache::evaluate(const double* coeffs, int body, double x, double xyz[3]) const
+{
+	const int n = degree+1;
+	// Clenshaw recurrence
+	for (int i=0;i<3;++i)
+	{
+		const double* c = coeffs + (body*3+i)*n;
+		double b0=0., b1=0., b2;
+		for (int j=degree;j>=1;--j)
+		{
+			b2 = b1;
+			b1 = b0;
+			b0 = 2.*x*b1 - b2 + c[j];
+		}
+		xyz[i] = x*b0 - b1 + c[0];
+	}
+}
+
+void ChebyshevEphemCache::insertWindow(quint64 key, const Window& window, double length)
+{
+	QWriteLocker locker(&lock);
+	// Another thread may have fitted the same window in the meantime.
+	if (windows.contains(key))
+		return;
+	if (window.exact && !accuracyWarned)
+	{
+		qWarning() << "ChebyshevEphemCache: no fit of" << length << "days meets the accuracy of"
+			   << accuracy << "AU, the theory is used directly in these windows";
+		accuracyWarned = true;
+	}
+	while (insertionOrder.size()>=maxNrOfWindows)
+		windows.remove(insertionOrder.dequeue());
+	windows.insert(key, window);
+	insertionOrder.enqueue(key);
+}
+
+bool ChebyshevEphemCache::lookupCoor(double jd, int body, double xyz[3], bool fit)
+{
+	Q_ASSERT(body>=0 && body<nrOfBodies);
+	for (int level=0;;++level)
+	{
+		const double length = windowLength/(1<<level);
+		const qint64 index = (qint64)std::floor((jd-WINDOW_ORIGIN)/length);
+		const double start = WINDOW_ORIGIN + index*length;
+		const double x = qBound(-1., 2.*(jd-start)/length-1., 1.);
+		const quint64 key = windowKey(level, index);
+		double requiredAccuracy;
+		Window window;
+		{
+			QReadLocker locker(&lock);
+			QHash<quint64, Window>::const_iterator it = windows.constFind(key);
+			if (it!=windows.constEnd())
+			{
+				if (it->split)
+					continue;
+				if (!it->exact)
+				{
+					evaluate(it->coeffs.constData(), body, x, xyz);
+					return true;
+				}
+				window.exact = true;
+			}
+			requiredAccuracy = accuracy;
+		}
+
+		if (!window.exact)
+		{
+			if (!fit)
+				return false;
+			// Fit without holding the lock, the theory is reentrant.
+			double error;
+			fitWindow(start, length, window.coeffs, &error);
+			if (error>requiredAccuracy)
+			{
+				// Split the window, unless it is already as short as allowed, in which case
+				// the accuracy bound can only be met by the theory itself.
+				window.split = level<MAX_SPLIT_LEVEL;
+				window.exact = !window.split;
+				window.coeffs.clear();
+			}
+			insertWindow(key, window, length);
+			if (window.split)
+				continue;
+		}
+
+		if (window.exact)
+		{
+			QVarLengthArray<double, 64> values(nrOfBodies*3);
+			func(jd, values.data());
+			for (int i=0;i<3;++i)
+				xyz[i] = values[body*3+i];
+		}
+		else
+			evaluate(window.coeffs.constData(), body, x, xyz);
+		return true;
+	}
+}
+
+void ChebyshevEphemCache::getCoor(double jd, int body, double xyz[3])
+{
+	lookupCoor(jd, body, xyz, true);
+}
+
+bool ChebyshevEphemCache::getCoor(double jd, int body, double xyz[3], Usage& usage)
+{
+	const qint64 index = (qint64)std::floor((jd-WINDOW_ORIGIN)/windowLength);
+	if (index!=usage.window)
+	{
+		usage.paidOff = usage.nrOfRequests>degree;
+		usage.window = index;
+		usage.nrOfRequests = 0;
+	}
+	++usage.nrOfRequests;
+	// Only the usage decides: a window fitted for another caller is not used before it pays off
+	// for this one, else the result would depend on the requests of the other callers.
+	if (!usage.paidOff && usage.nrOfRequests<=degree)
+		return false;
+	return lookupCoor(jd, body, xyz, true);
+}
+
+void ChebyshevEphemCache::setAccuracy(double acc)
+{
+	QWriteLocker locker(&lock);
+	accuracy = acc;
+	accuracyWarned = false;
+	windows.clear();
+	insertionOrder.clear();
+}
+
+double ChebyshevEphemCache::getAccuracy() const
+{
+	QReadLocker locker(&lock);
+	return accuracy;
+}
+
+void ChebyshevEphemCache::setMaxNrOfWindows(int n)
+{
+	QWriteLocker locker(&lock);
+	maxNrOfWindows = qMax(1, n);
+	while (insertionOrder.size()>maxNrOfWindows)
+		windows.remove(insertionOrder.dequeue());
+}
+
+void ChebyshevEphemCache::clear()
+{
+	QWriteLocker locker(&lock);
+	windows.clear();
+	insertionOrder.clear();
+}
+
+int ChebyshevEphemCache::getNrOfWindows() const
+{
+	QReadLocker locker(&lock);
+	return windows.size();
+}
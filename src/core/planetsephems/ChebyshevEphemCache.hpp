@@ -0,0 +1,129 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _CHEBYSHEVEPHEMCACHE_HPP_
+#define _CHEBYSHEVEPHEMCACHE_HPP_
+
+#include <QHash>
+#include <QQueue>
+#include <QReadWriteLock>
+#include <QVector>
+
+//! Function computing the rectangular coordinates of all bodies of an analytic theory
+//! at the date @em jd, e.g. GetVsop87FullCoor(). It must be reentrant.
+typedef void (*EphemFullCoorFunc)(double jd, double* xyz);
+
+//! @class ChebyshevEphemCache
+//! Cache of Chebyshev polynomials fitted to an analytic planetary theory (VSOP87, ELP82B).
+//! Time is cut into windows. The first time a date of a window is requested, the theory is
+//! evaluated at the Chebyshev nodes of the window, and the coordinates of all bodies of the
+//! theory are fitted at once. Later requests in the window only evaluate the polynomials.
+//! When the estimated error of a fit is larger than the accuracy bound, the window is
+//! split in two halves, which are fitted independently. When even the shortest windows
+//! can't meet the bound, the theory is evaluated directly in these windows.
+//! A fit evaluates the theory degree+1 times, so it only pays off for windows which are
+//! used often enough. When time runs fast, callers should use the getCoor() with a Usage.
+//! All methods are thread safe.
+class ChebyshevEphemCache
+{
+public:
+	//! @param func the theory, evaluated only when a window is fitted
+	//! @param nrOfBodies number of bodies computed by @em func
+	//! @param windowLength length in days of the largest windows
+	//! @param degree degree of the polynomials
+	ChebyshevEphemCache(EphemFullCoorFunc func, int nrOfBodies, double windowLength, int degree);
+
+	//! Get the rectangular coordinates of @em body at the date @em jd, as computed by the theory.
+	void getCoor(double jd, int body, double xyz[3]);
+
+	//! Requests of one caller, to decide whether the cache pays off for it.
+	//! A Usage must not be shared by several threads.
+	struct Usage
+	{
+		Usage() : window(0), nrOfRequests(0), paidOff(false) {}
+		//! Index of the window of the last request, in windows of the largest length.
+		qint64 window;
+		//! Number of requests in this window.
+		int nrOfRequests;
+		//! Whether the window before was requested at least degree+1 times.
+		bool paidOff;
+	};
+
+	//! Same as getCoor(), but the cache is only used when it pays off for the caller of @em usage:
+	//! once the current window was requested degree+1 times, or when the previous window was.
+	//! The decision only depends on the requests made with @em usage, not on the windows fitted
+	//! for other callers, so that a caller gets the same results whatever the other callers do.
+	//! The fit of a window doesn't depend on who requested it.
+	//! @return @c false if time runs too fast for the cache, in which case @em xyz is not set
+	//! and the caller has to use the theory itself
+	bool getCoor(double jd, int body, double xyz[3], Usage& usage);
+
+	//! Set the largest error in AU allowed for the fitted coordinates. Clears the cache.
+	void setAccuracy(double accuracy);
+	double getAccuracy() const;
+
+	//! Set the maximum number of windows kept in memory.
+	//! When the limit is reached, the oldest windows are forgotten first.
+	void setMaxNrOfWindows(int n);
+
+	//! Forget all fitted windows.
+	void clear();
+
+	//! Get the number of windows currently kept in memory (split windows included).
+	int getNrOfWindows() const;
+
+private:
+	struct Window
+	{
+		Window() : split(false), exact(false) {}
+		//! When true, the fit was not accurate enough and the halves have to be used.
+		bool split;
+		//! When true, the window can't be split any more and the theory has to be used.
+		bool exact;
+		//! Chebyshev coefficients, (degree+1) per coordinate and 3 coordinates per body.
+		QVector<double> coeffs;
+	};
+
+	//! Fit the window of given start and length, and estimate the largest error of the fit.
+	void fitWindow(double start, double length, QVector<double>& coeffs, double* error) const;
+	//! Evaluate the polynomials of a window at x in [-1, 1].
+	void evaluate(const double* coeffs, int body, double x, double xyz[3]) const;
+	//! Store a new window, forgetting the oldest ones if needed.
+	void insertWindow(quint64 key, const Window& window, double length);
+	//! Get the coordinates from the windows containing jd. When one of them is missing,
+	//! fit it if @em fit is true, else return false.
+	bool lookupCoor(double jd, int body, double xyz[3], bool fit);
+
+	EphemFullCoorFunc func;
+	const int nrOfBodies;
+	const double windowLength;
+	const int degree;
+	//! cos(pi*j*(k+1/2)/(degree+1)), used by the fit.
+	QVector<double> cosTable;
+
+	mutable QReadWriteLock lock;
+	double accuracy;
+	int maxNrOfWindows;
+	//! Whether the warning about windows using the theory directly was logged.
+	bool accuracyWarned;
+	QHash<quint64, Window> windows;
+	QQueue<quint64> insertionOrder;
+};
+
+#endif // _CHEBYSHEVEPHEMCACHE_HPP_
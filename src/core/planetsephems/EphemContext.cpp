@@ -0,0 +1,181 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "EphemContext.hpp"
+#include "ChebyshevEphemCache.hpp"
+#include "de430.hpp"
+#include "de431.hpp"
+#include "pluto.h"
+
+#include <QDebug>
+#include <cmath>
+
+#define EPHEM_EMB_ID		2
+#define EPHEM_JPL_EARTH_ID	3
+#define EPHEM_JPL_PLUTO_ID	9
+#define EPHEM_JPL_MOON_ID	10
+
+// Chebyshev caches over the full VSOP87 and ELP82B series. A VSOP87 window holds all 8 bodies,
+// its length is set by Mercury, which needs 16 day windows for an accuracy of 1e-9 AU.
+static ChebyshevEphemCache vsop87Cache(&GetVsop87FullCoor, 8, 16., 16);
+static ChebyshevEphemCache elp82bCache(&GetElp82bFullCoor, 1, 8., 16);
+static bool ephemCacheEnabled = false;
+
+EphemContext::EphemContext()
+	: de430Active(false)
+	, de431Active(false)
+{
+	InitVsop87State(&vsop87);
+	InitElp82bState(&elp82b);
+	InitMarsSatState(&marsSat);
+	InitL1State(&l1);
+	InitTass17State(&tass17);
+	InitGust86State(&gust86);
+}
+
+void EphemContext::setChebyshevCache(bool enabled, double accuracy)
+{
+	vsop87Cache.setAccuracy(accuracy);
+	elp82bCache.setAccuracy(accuracy);
+	ephemCacheEnabled = enabled;
+}
+
+bool EphemContext::jdFitsDe430(double jd)
+{
+	//return !(jd < 2287184.5 || jd > 2688974.5);
+	//return !(jd < 2287184.5 || jd > 2688976.5);
+	return ((jd > 2287184.5) && (jd < 2688976.5));
+}
+
+bool EphemContext::jdFitsDe431(double jd)
+{
+	//Correct limits found via jpl_get_double(). Limits hardcoded to avoid calls each time.
+	//return !(jd < -3027215.5 || jd > 7930192.5);
+	//This limits inside those where sun can jump between ecliptic of date and ecliptic2000.
+	// We lose a month in -13000 and a few months in +17000, this should not matter.
+	return ((jd > -3027188.25 ) && (jd < 7930056.87916));
+}
+
+bool EphemContext::getDeCoor(double jde, int jplPlanetId, double xyz[3], int jplCentralBodyId) const
+{
+	if (de430Active && jdFitsDe430(jde))
+		return GetDe430Coor(jde, jplPlanetId, xyz, jplCentralBodyId);
+	if (de431Active && jdFitsDe431(jde))
+		return GetDe431Coor(jde, jplPlanetId, xyz, jplCentralBodyId);
+	return false;
+}
+
+void EphemContext::getVsop87Coor(double jde, int planet, double xyz[3])
+{
+	// When time runs too fast for the cache, the interpolated elements are cheaper.
+	if (!ephemCacheEnabled || !vsop87Cache.getCoor(jde, planet, xyz, vsop87Usage))
+		GetVsop87Coor_r(&vsop87, jde, planet, xyz);
+}
+
+void EphemContext::getElp82bCoor(double jde, double xyz[3])
+{
+	if (!ephemCacheEnabled || !elp82bCache.getCoor(jde, 0, xyz, elp82bUsage))
+		GetElp82bCoor_r(&elp82b, jde, xyz);
+}
+
+void EphemContext::computeCoordinates(Body body, double jde, double xyz[3])
+{
+	if (!std::isfinite(jde))
+	{
+		qDebug() << "EphemContext::computeCoordinates(): SKIPPED CoordCalc, jd is infinite/nan:" << jde;
+		return;
+	}
+
+	switch (body)
+	{
+		case Sun:
+			xyz[0]=0.; xyz[1]=0.; xyz[2]=0.;
+			break;
+		case Mercury:
+		case Venus:
+		case Mars:
+		case Jupiter:
+		case Saturn:
+		case Uranus:
+		case Neptune:
+			// The planets are numbered from 0 in VSOP87, from 1 in the DE.
+			if (!getDeCoor(jde, body, xyz, CENTRAL_PLANET_ID))
+				getVsop87Coor(jde, body-1, xyz);
+			break;
+		case Earth:
+			if (!getDeCoor(jde, EPHEM_JPL_EARTH_ID, xyz, CENTRAL_PLANET_ID))
+			{
+				double moon[3];
+				getVsop87Coor(jde, EPHEM_EMB_ID, xyz);
+				getElp82bCoor(jde, moon);
+				/* Earth != EMB:
+			0.0121505677733761 = mu_m/(1+mu_m),
+			mu_m = mass(moon)/mass(earth) = 0.01230002 */
+				xyz[0] -= 0.0121505677733761 * moon[0];
+				xyz[1] -= 0.0121505677733761 * moon[1];
+				xyz[2] -= 0.0121505677733761 * moon[2];
+			}
+			break;
+		case Pluto:
+			if (!getDeCoor(jde, EPHEM_JPL_PLUTO_ID, xyz, CENTRAL_PLANET_ID))
+				get_pluto_helio_coords(jde, &xyz[0], &xyz[1], &xyz[2]);
+			break;
+		case Moon:
+			if (!getDeCoor(jde, EPHEM_JPL_MOON_ID, xyz, EPHEM_JPL_EARTH_ID))
+				getElp82bCoor(jde, xyz);
+			break;
+		case Phobos:	GetMarsSatCoor_r(&marsSat, jde, MARS_SAT_PHOBOS, xyz); break;
+		case Deimos:	GetMarsSatCoor_r(&marsSat, jde, MARS_SAT_DEIMOS, xyz); break;
+		case Io:	GetL1Coor_r(&l1, jde, L1_IO, xyz); break;
+		case Europa:	GetL1Coor_r(&l1, jde, L1_EUROPA, xyz); break;
+		case Ganymede:	GetL1Coor_r(&l1, jde, L1_GANYMEDE, xyz); break;
+		case Callisto:	GetL1Coor_r(&l1, jde, L1_CALLISTO, xyz); break;
+		case Mimas:	GetTass17Coor_r(&tass17, jde, TASS17_MIMAS, xyz); break;
+		case Enceladus:	GetTass17Coor_r(&tass17, jde, TASS17_ENCELADUS, xyz); break;
+		case Tethys:	GetTass17Coor_r(&tass17, jde, TASS17_TETHYS, xyz); break;
+		case Dione:	GetTass17Coor_r(&tass17, jde, TASS17_DIONE, xyz); break;
+		case Rhea:	GetTass17Coor_r(&tass17, jde, TASS17_RHEA, xyz); break;
+		case Titan:	GetTass17Coor_r(&tass17, jde, TASS17_TITAN, xyz); break;
+		case Hyperion:	GetTass17Coor_r(&tass17, jde, TASS17_HYPERION, xyz); break;
+		case Iapetus:	GetTass17Coor_r(&tass17, jde, TASS17_IAPETUS, xyz); break;
+		case Miranda:	GetGust86Coor_r(&gust86, jde, GUST86_MIRANDA, xyz); break;
+		case Ariel:	GetGust86Coor_r(&gust86, jde, GUST86_ARIEL, xyz); break;
+		case Umbriel:	GetGust86Coor_r(&gust86, jde, GUST86_UMBRIEL, xyz); break;
+		case Titania:	GetGust86Coor_r(&gust86, jde, GUST86_TITANIA, xyz); break;
+		case Oberon:	GetGust86Coor_r(&gust86, jde, GUST86_OBERON, xyz); break;
+	}
+}
+
+void EphemContext::computeOsculatingCoordinates(Body body, double jde0, double jde, double xyz[3])
+{
+	Q_ASSERT(body>=Mercury && body<=Neptune);
+	if (!(std::isfinite(jde) && std::isfinite(jde0)))
+	{
+		qDebug() << "EphemContext::computeOsculatingCoordinates(): SKIPPED CoordCalc, jd0 or jd is infinite/nan. jd0:" << jde0 << "jd: "<< jde;
+		return;
+	}
+	if (!getDeCoor(jde, body, xyz, CENTRAL_PLANET_ID))
+		GetVsop87OsculatingCoor_r(&vsop87, jde0, jde, body-1, xyz);
+}
+
+void EphemContext::computeBatch(Body body, const double* jde, int n, double* xyz)
+{
+	for (int i=0;i<n;++i)
+		computeCoordinates(body, jde[i], xyz+3*i);
+}
@@ -0,0 +1,109 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _EPHEMCONTEXT_HPP_
+#define _EPHEMCONTEXT_HPP_
+
+#include "vsop87.h"
+#include "elp82b.h"
+#include "l1.h"
+#include "tass17.h"
+#include "gust86.h"
+#include "marssat.h"
+#include "ChebyshevEphemCache.hpp"
+
+//! @class EphemContext
+//! Reentrant access to the ephemerides behind EphemWrapper.
+//! The analytic theories interpolate between elements cached by the previous calls. The plain
+//! functions of the theories keep these elements in static variables, an EphemContext owns
+//! its own copy of them. Each thread can therefore compute positions with its own context, and
+//! a context returns the same results for the same sequence of calls, whatever other threads do.
+//! The Chebyshev cache over VSOP87 and ELP82B and the DE430/DE431 ephemerides are shared
+//! by all contexts. They are thread safe, and lock free when the DE files are mapped in memory.
+//! Whether a context uses the Chebyshev cache only depends on its own requests, see
+//! ChebyshevEphemCache::Usage, and the fitted windows are the same whichever context fits them.
+//! A context must not be used by several threads at the same time.
+class EphemContext
+{
+public:
+	//! Bodies computed by the context. The planets are heliocentric,
+	//! the satellites are relative to the center of their planet.
+	enum Body
+	{
+		Sun, Mercury, Venus, Earth, Mars, Jupiter, Saturn, Uranus, Neptune, Pluto,
+		Moon,
+		Phobos, Deimos,
+		Io, Europa, Ganymede, Callisto,
+		Mimas, Enceladus, Tethys, Dione, Rhea, Titan, Hyperion, Iapetus,
+		Miranda, Ariel, Umbriel, Titania, Oberon
+	};
+
+	EphemContext();
+
+	//! Use DE430 instead of the analytic theories in its time range, see StelCore::setDe430Active().
+	void setDe430Active(bool b) {de430Active=b;}
+	bool de430IsActive() const {return de430Active;}
+	//! Use DE431 instead of the analytic theories in its time range, see StelCore::setDe431Active().
+	void setDe431Active(bool b) {de431Active=b;}
+	bool de431IsActive() const {return de431Active;}
+
+	//! Compute the rectangular coordinates in AU of @em body, in the VSOP87 frame,
+	//! at the julian day @em jde expressed in dynamical time.
+	void computeCoordinates(Body body, double jde, double xyz[3]);
+
+	//! Compute the osculating orbit of epoch @em jde0 of a planet from Mercury to Neptune, evaluated
+	//! at @em jde. The orbit of Earth is the one of the Earth-Moon barycenter.
+	//! Where a DE ephemeris is used, @em jde0 is irrelevant.
+	void computeOsculatingCoordinates(Body body, double jde0, double jde, double xyz[3]);
+
+	//! Compute the coordinates of @em body at the @em n dates @em jde, and store them in @em xyz,
+	//! 3 values per date. Consecutive dates should be close to each other, so that the cached
+	//! elements of the theories can be reused.
+	void computeBatch(Body body, const double* jde, int n, double* xyz);
+
+	//! Enable the Chebyshev cache over VSOP87 and ELP82B shared by all contexts,
+	//! and set its accuracy bound in AU. Not to be called while positions are computed.
+	//! A context only uses the cache when its dates move slowly enough for the fits
+	//! to pay off, see ChebyshevEphemCache::Usage.
+	static void setChebyshevCache(bool enabled, double accuracy);
+
+	//! Check if the date fits in the time range of DE430.
+	static bool jdFitsDe430(double jd);
+	//! Check if the date fits in the time range of DE431.
+	static bool jdFitsDe431(double jd);
+
+private:
+	//! Use DE430 or DE431 when active and in range, return false when the analytic theory has to be used.
+	bool getDeCoor(double jde, int jplPlanetId, double xyz[3], int jplCentralBodyId) const;
+	void getVsop87Coor(double jde, int planet, double xyz[3]);
+	void getElp82bCoor(double jde, double xyz[3]);
+
+	bool de430Active;
+	bool de431Active;
+	Vsop87State vsop87;
+	Elp82bState elp82b;
+	MarsSatState marsSat;
+	L1State l1;
+	Tass17State tass17;
+	Gust86State gust86;
+	ChebyshevEphemCache::Usage vsop87Usage;
+	ChebyshevEphemCache::Usage elp82bUsage;
+};
+
+#endif // _EPHEMCONTEXT_HPP_
@@ -19,128 +19,50 @@ Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
 */
 
 #include "EphemWrapper.hpp"
+#include "EphemContext.hpp"
 #include "StelApp.hpp"
 #include "StelCore.hpp"
-#include "vsop87.h"
-#include "elp82b.h"
-#include "marssat.h"
-#include "l1.h"
-#include "tass17.h"
-#include "gust86.h"
 #include "de431.hpp"
 #include "de430.hpp"
-#include "pluto.h"
-
-#define EPHEM_MERCURY_ID  0
-#define EPHEM_VENUS_ID    1
-#define EPHEM_EMB_ID    2
-#define EPHEM_MARS_ID   3
-#define EPHEM_JUPITER_ID  4
-#define EPHEM_SATURN_ID   5
-#define EPHEM_URANUS_ID   6
-#define EPHEM_NEPTUNE_ID  7
-#define EPHEM_PLUTO_ID    8
-
-// GZ No idea what IMD stands for?
-//#define EPHEM_IMD_EARTH_ID 2
-#define EPHEM_JPL_EARTH_ID 3
-#define EPHEM_JPL_PLUTO_ID 9
-#define EPHEM_JPL_MOON_ID 10
-#define EPHEM_JPL_SUN_ID 11
-
-/**   JPL PLANET ID LIST
-**            1 = mercury           8 = neptune                             **
-**            2 = venus             9 = pluto                               **
-**            3 = earth            10 = moon                                **
-**            4 = mars             11 = sun                                 **
-**            5 = jupiter          12 = solar-system barycenter             **
-**            6 = saturn           13 = earth-moon barycenter               **
-**            7 = uranus 
-**/
 
-void EphemWrapper::init_de430(const char* filepath)
-{
-	InitDE430(filepath);
-}
+// The context of the functions below when they are not given their own.
+// It is not reentrant, like the theories used to be.
+static EphemContext defaultContext;
 
-void EphemWrapper::init_de431(const char* filepath)
+// The void pointer of the position functions is an optional EphemContext.
+static EphemContext* getContext(void* context)
 {
-	InitDE431(filepath);
+	if (context)
+		return static_cast<EphemContext*>(context);
+	StelCore* core = StelApp::getInstance().getCore();
+	defaultContext.setDe430Active(core->de430IsActive());
+	defaultContext.setDe431Active(core->de431IsActive());
+	return &defaultContext;
 }
 
-bool EphemWrapper::jd_fits_de431(const double jd)
+void EphemWrapper::init_ephem_cache(const bool enabled, const double accuracy)
 {
-	//Correct limits found via jpl_get_double(). Limits hardcoded to avoid calls each time.
-	//return !(jd < -3027215.5 || jd > 7930192.5);
-	//This limits inside those where sun can jump between ecliptic of date and ecliptic2000.
-	// We lose a month in -13000 and a few months in +17000, this should not matter.
-	return ((jd > -3027188.25 ) && (jd < 7930056.87916));
+	EphemContext::setChebyshevCache(enabled, accuracy);
 }
 
-bool EphemWrapper::jd_fits_de430(const double jd)
+void EphemWrapper::init_de430(const char* filepath)
 {
-	//return !(jd < 2287184.5 || jd > 2688974.5);
-	//return !(jd < 2287184.5 || jd > 2688976.5);
-	return ((jd > 2287184.5) && (jd < 2688976.5));
+	InitDE430(filepath);
 }
 
-bool use_de430(const double jd)
+void EphemWrapper::init_de431(const char* filepath)
 {
-	return StelApp::getInstance().getCore()->de430IsActive() && EphemWrapper::jd_fits_de430(jd);
+	InitDE431(filepath);
 }
 
-bool use_de431(const double jd)
+bool EphemWrapper::jd_fits_de431(const double jd)
 {
-	return StelApp::getInstance().getCore()->de431IsActive() && EphemWrapper::jd_fits_de431(jd);
+	return EphemContext::jdFitsDe431(jd);
 }
 
-// planet_id is ONLY one of the #defined values 0..8 above.
-void get_planet_helio_coordsv(const double jd, double xyz[3], const int planet_id)
+bool EphemWrapper::jd_fits_de430(const double jd)
 {
-	bool deOk=false;
-	if(!std::isfinite(jd))
-	{
-		qDebug() << "get_planet_helio_coordsv(): SKIPPED CoordCalc, jd is infinite/nan: " << jd;
-		return;
-	}
-
-	if(use_de430(jd))
-	{
-		deOk=GetDe430Coor(jd, planet_id + 1, xyz);
-	}
-	else if(use_de431(jd))
-	{
-		deOk=GetDe431Coor(jd, planet_id + 1, xyz);
-	}
-	if (!deOk) //VSOP87 as fallback
-	{
-		GetVsop87Coor(jd, planet_id, xyz);
-	}
-}
-
-// Osculating positions for time JDE in elements for JDE0, if possible by the theory used (e.g. VSOP87).
-// For ephemerides like DE4xx, JDE0 is irrelevant.
-void get_planet_helio_osculating_coordsv(double jd0, double jd, double xyz[3], int planet_id)
-{
-	bool deOk=false;
-	if(!(std::isfinite(jd) && std::isfinite(jd0)))
-	{
-		qDebug() << "get_planet_helio_osculating_coordsv(): SKIPPED CoordCalc, jd0 or jd is infinite/nan. jd0:" << jd0 << "jd: "<< jd;
-		return;
-	}
-
-	if(use_de430(jd))
-	{
-		deOk=GetDe430Coor(jd, planet_id + 1, xyz);
-	}
-	else if(use_de431(jd))
-	{
-		deOk=GetDe431Coor(jd, planet_id + 1, xyz);
-	}
-	if (!deOk) //VSOP87 as fallback
-	{
-		GetVsop87OsculatingCoor(jd0, jd, planet_id, xyz);
-	}
+	return EphemContext::jdFitsDe430(jd);
 }
 
 /* Chapter 31 Pg 206-207 Equ 31.1 31.2, 31.3 using VSOP 87
@@ -148,149 +70,99 @@ void get_planet_helio_osculating_coordsv(double jd0, double jd, double xyz[3], i
  * for given Julian Day. Values are in AU.
  * params : Julian day, rect coords */
 
-void get_pluto_helio_coordsv(double jd,double xyz[3], void* unused)
-{
-	Q_UNUSED(unused);
-	bool deOk=false;
-	if(!std::isfinite(jd))
-	{
-		qDebug() << "get_pluto_helio_coordsv(): SKIPPED PlutoCoordCalc, jd is infinite/nan:" << jd;
-		return;
-	}
-
-	if(use_de430(jd))
-	{
-		deOk=GetDe430Coor(jd, EPHEM_JPL_PLUTO_ID, xyz);
-	}
-	else if(use_de431(jd))
-	{
-		deOk=GetDe431Coor(jd, EPHEM_JPL_PLUTO_ID, xyz);
-	}
-	if (!deOk) // fallback to previous solution
-	{
-		get_pluto_helio_coords(jd, &xyz[0], &xyz[1], &xyz[2]);
-	}
+void get_pluto_helio_coordsv(double jd,double xyz[3], void* context)
+{
+	getContext(context)->computeCoordinates(EphemContext::Pluto, jd, xyz);
 }
 
 /* Return 0 for the sun */
-void get_sun_helio_coordsv(double jd,double xyz[3], void* unused)
+void get_sun_helio_coordsv(double jd,double xyz[3], void* context)
 {
 	Q_UNUSED(jd);
-	Q_UNUSED(unused);
+	Q_UNUSED(context);
 	xyz[0]=0.; xyz[1]=0.; xyz[2]=0.;
 }
 
-void get_mercury_helio_coordsv(double jd,double xyz[3], void* unused)
+void get_mercury_helio_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-  	get_planet_helio_coordsv(jd, xyz, EPHEM_MERCURY_ID);
+	getContext(context)->computeCoordinates(EphemContext::Mercury, jd, xyz);
 }
-void get_venus_helio_coordsv(double jd,double xyz[3], void* unused)
+
+void get_venus_helio_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-  	get_planet_helio_coordsv(jd, xyz, EPHEM_VENUS_ID);
+	getContext(context)->computeCoordinates(EphemContext::Venus, jd, xyz);
 }
 
-void get_earth_helio_coordsv(const double jd,double xyz[3], void* unused) 
+void get_earth_helio_coordsv(const double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	bool deOk=false;
-	if(!std::isfinite(jd))
-	{
-		qDebug() << "get_earth_helio_coordsv(): SKIPPED EarthCoordCalc, jd is infinite/nan:" << jd;
-		return;
-	}
-
-	if(use_de430(jd))
-	{
-		deOk=GetDe430Coor(jd, EPHEM_JPL_EARTH_ID, xyz);
-	}
-	else if(use_de431(jd))
-	{
-		deOk=GetDe431Coor(jd, EPHEM_JPL_EARTH_ID, xyz);
-	}
-	if (!deOk) //VSOP87 as fallback
-	{
-		double moon[3];
-		GetVsop87Coor(jd,EPHEM_EMB_ID,xyz);
-		GetElp82bCoor(jd,moon);
-		/* Earth != EMB:
-	0.0121505677733761 = mu_m/(1+mu_m),
-	mu_m = mass(moon)/mass(earth) = 0.01230002 */
-		xyz[0] -= 0.0121505677733761 * moon[0];
-		xyz[1] -= 0.0121505677733761 * moon[1];
-		xyz[2] -= 0.0121505677733761 * moon[2];
-	}
+	getContext(context)->computeCoordinates(EphemContext::Earth, jd, xyz);
 }
 
-void get_mars_helio_coordsv(double jd,double xyz[3], void* unused)
+void get_mars_helio_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	get_planet_helio_coordsv(jd, xyz, EPHEM_MARS_ID);
+	getContext(context)->computeCoordinates(EphemContext::Mars, jd, xyz);
 }
 
-void get_jupiter_helio_coordsv(double jd,double xyz[3], void* unused)
+void get_jupiter_helio_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	get_planet_helio_coordsv(jd, xyz, EPHEM_JUPITER_ID);
+	getContext(context)->computeCoordinates(EphemContext::Jupiter, jd, xyz);
 }
 
-void get_saturn_helio_coordsv(double jd,double xyz[3], void* unused)
+void get_saturn_helio_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	get_planet_helio_coordsv(jd, xyz, EPHEM_SATURN_ID);
+	getContext(context)->computeCoordinates(EphemContext::Saturn, jd, xyz);
 }
 
-void get_uranus_helio_coordsv(double jd,double xyz[3], void* unused)
+void get_uranus_helio_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	get_planet_helio_coordsv(jd, xyz, EPHEM_URANUS_ID);
+	getContext(context)->computeCoordinates(EphemContext::Uranus, jd, xyz);
 }
 
-void get_neptune_helio_coordsv(double jd,double xyz[3], void* unused)
+void get_neptune_helio_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	get_planet_helio_coordsv(jd, xyz, EPHEM_NEPTUNE_ID);
+	getContext(context)->computeCoordinates(EphemContext::Neptune, jd, xyz);
 }
 
-void get_mercury_helio_osculating_coords(double jd0,double jd,double xyz[3])
+// Osculating positions for time JDE in elements for JDE0, if possible by the theory used (e.g. VSOP87).
+// For ephemerides like DE4xx, JDE0 is irrelevant.
+void get_mercury_helio_osculating_coords(double jd0,double jd,double xyz[3], void* context)
 {
-	get_planet_helio_osculating_coordsv(jd0, jd, xyz, EPHEM_MERCURY_ID);
+	getContext(context)->computeOsculatingCoordinates(EphemContext::Mercury, jd0, jd, xyz);
 }
 
-void get_venus_helio_osculating_coords(double jd0,double jd,double xyz[3])
+void get_venus_helio_osculating_coords(double jd0,double jd,double xyz[3], void* context)
 {
-	get_planet_helio_osculating_coordsv(jd0, jd, xyz, EPHEM_VENUS_ID);
+	getContext(context)->computeOsculatingCoordinates(EphemContext::Venus, jd0, jd, xyz);
 }
 
-void get_earth_helio_osculating_coords(double jd0,double jd,double xyz[3])
+void get_earth_helio_osculating_coords(double jd0,double jd,double xyz[3], void* context)
 {
-	get_planet_helio_osculating_coordsv(jd0, jd, xyz, EPHEM_EMB_ID);
+	getContext(context)->computeOsculatingCoordinates(EphemContext::Earth, jd0, jd, xyz);
 }
 
-void get_mars_helio_osculating_coords(double jd0,double jd,double xyz[3])
+void get_mars_helio_osculating_coords(double jd0,double jd,double xyz[3], void* context)
 {
-	get_planet_helio_osculating_coordsv(jd0, jd, xyz, EPHEM_MARS_ID);
+	getContext(context)->computeOsculatingCoordinates(EphemContext::Mars, jd0, jd, xyz);
 }
 
-void get_jupiter_helio_osculating_coords(double jd0,double jd,double xyz[3])
+void get_jupiter_helio_osculating_coords(double jd0,double jd,double xyz[3], void* context)
 {
-	get_planet_helio_osculating_coordsv(jd0, jd, xyz, EPHEM_JUPITER_ID);
+	getContext(context)->computeOsculatingCoordinates(EphemContext::Jupiter, jd0, jd, xyz);
 }
 
-void get_saturn_helio_osculating_coords(double jd0,double jd,double xyz[3])
+void get_saturn_helio_osculating_coords(double jd0,double jd,double xyz[3], void* context)
 {
-	get_planet_helio_osculating_coordsv(jd0, jd, xyz, EPHEM_SATURN_ID);
+	getContext(context)->computeOsculatingCoordinates(EphemContext::Saturn, jd0, jd, xyz);
 }
 
-void get_uranus_helio_osculating_coords(double jd0,double jd,double xyz[3])
+void get_uranus_helio_osculating_coords(double jd0,double jd,double xyz[3], void* context)
 {
-	get_planet_helio_osculating_coordsv(jd0, jd, xyz, EPHEM_URANUS_ID);
+	getContext(context)->computeOsculatingCoordinates(EphemContext::Uranus, jd0, jd, xyz);
 }
 
-void get_neptune_helio_osculating_coords(double jd0,double jd,double xyz[3])
+void get_neptune_helio_osculating_coords(double jd0,double jd,double xyz[3], void* context)
 {
-	get_planet_helio_osculating_coordsv(jd0, jd, xyz, EPHEM_NEPTUNE_ID);
+	getContext(context)->computeOsculatingCoordinates(EphemContext::Neptune, jd0, jd, xyz);
 }
 
 /* Calculate the rectangular geocentric lunar coordinates to the inertial mean
@@ -300,129 +172,102 @@ void get_neptune_helio_osculating_coords(double jd0,double jd,double xyz[3])
  * Michelle Chapront-Touze and Jean Chapront of the Bureau des Longitudes,
  * Paris. ELP 2000-82B theory
  * param jd Julian day, rect pos */
-void get_lunar_parent_coordsv(double jde,double xyz[3], void* unused)
+void get_lunar_parent_coordsv(double jde,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	bool deOk=false;
-	if(use_de430(jde))
-		deOk=GetDe430Coor(jde, EPHEM_JPL_MOON_ID, xyz, EPHEM_JPL_EARTH_ID);
-	else if(use_de431(jde))
-		deOk=GetDe431Coor(jde, EPHEM_JPL_MOON_ID, xyz, EPHEM_JPL_EARTH_ID);
-	if (!deOk) // fallback...
-		GetElp82bCoor(jde,xyz);
+	getContext(context)->computeCoordinates(EphemContext::Moon, jde, xyz);
 }
 
-void get_phobos_parent_coordsv(double jd,double xyz[3], void* unused)
+void get_phobos_parent_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	GetMarsSatCoor(jd,MARS_SAT_PHOBOS,xyz);
+	getContext(context)->computeCoordinates(EphemContext::Phobos, jd, xyz);
 }
 
-void get_deimos_parent_coordsv(double jd,double xyz[3], void* unused)
+void get_deimos_parent_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	GetMarsSatCoor(jd,MARS_SAT_DEIMOS,xyz);
+	getContext(context)->computeCoordinates(EphemContext::Deimos, jd, xyz);
 }
 
-void get_io_parent_coordsv(double jd,double xyz[3], void* unused)
+void get_io_parent_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	GetL1Coor(jd,L1_IO,xyz);
+	getContext(context)->computeCoordinates(EphemContext::Io, jd, xyz);
 }
 
-void get_europa_parent_coordsv(double jd,double xyz[3], void* unused)
+void get_europa_parent_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	GetL1Coor(jd,L1_EUROPA,xyz);
+	getContext(context)->computeCoordinates(EphemContext::Europa, jd, xyz);
 }
 
-void get_ganymede_parent_coordsv(double jd,double xyz[3], void* unused)
+void get_ganymede_parent_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	GetL1Coor(jd,L1_GANYMEDE,xyz);
+	getContext(context)->computeCoordinates(EphemContext::Ganymede, jd, xyz);
 }
 
-void get_callisto_parent_coordsv(double jd,double xyz[3], void* unused)
+void get_callisto_parent_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	GetL1Coor(jd,L1_CALLISTO,xyz);
+	getContext(context)->computeCoordinates(EphemContext::Callisto, jd, xyz);
 }
 
-void get_mimas_parent_coordsv(double jd,double xyz[3], void* unused)
-{ 
-	Q_UNUSED(unused);
-	GetTass17Coor(jd,TASS17_MIMAS,xyz);
+void get_mimas_parent_coordsv(double jd,double xyz[3], void* context)
+{
+	getContext(context)->computeCoordinates(EphemContext::Mimas, jd, xyz);
 }
 
-void get_enceladus_parent_coordsv(double jd,double xyz[3], void* unused)
+void get_enceladus_parent_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	GetTass17Coor(jd,TASS17_ENCELADUS,xyz);
+	getContext(context)->computeCoordinates(EphemContext::Enceladus, jd, xyz);
 }
 
-void get_tethys_parent_coordsv(double jd,double xyz[3], void* unused)
-{ 
-	Q_UNUSED(unused);
-	GetTass17Coor(jd,TASS17_TETHYS,xyz);
+void get_tethys_parent_coordsv(double jd,double xyz[3], void* context)
+{
+	getContext(context)->computeCoordinates(EphemContext::Tethys, jd, xyz);
 }
 
-void get_dione_parent_coordsv(double jd,double xyz[3], void* unused)
-{ 
-	Q_UNUSED(unused);
-	GetTass17Coor(jd,TASS17_DIONE,xyz);
+void get_dione_parent_coordsv(double jd,double xyz[3], void* context)
+{
+	getContext(context)->computeCoordinates(EphemContext::Dione, jd, xyz);
 }
 
-void get_rhea_parent_coordsv(double jd,double xyz[3], void* unused)
-{ 
-	Q_UNUSED(unused);
-	GetTass17Coor(jd,TASS17_RHEA,xyz);
+void get_rhea_parent_coordsv(double jd,double xyz[3], void* context)
+{
+	getContext(context)->computeCoordinates(EphemContext::Rhea, jd, xyz);
 }
 
-void get_titan_parent_coordsv(double jd,double xyz[3], void* unused)
-{ 
-	Q_UNUSED(unused);
-	GetTass17Coor(jd,TASS17_TITAN,xyz);
+void get_titan_parent_coordsv(double jd,double xyz[3], void* context)
+{
+	getContext(context)->computeCoordinates(EphemContext::Titan, jd, xyz);
 }
 
-void get_hyperion_parent_coordsv(double jd,double xyz[3], void* unused)
-{ 
-	Q_UNUSED(unused);
-	GetTass17Coor(jd,TASS17_HYPERION,xyz);
+void get_hyperion_parent_coordsv(double jd,double xyz[3], void* context)
+{
+	getContext(context)->computeCoordinates(EphemContext::Hyperion, jd, xyz);
 }
 
-void get_iapetus_parent_coordsv(double jd,double xyz[3], void* unused)
-{ 
-	Q_UNUSED(unused);
-	GetTass17Coor(jd,TASS17_IAPETUS,xyz);
+void get_iapetus_parent_coordsv(double jd,double xyz[3], void* context)
+{
+	getContext(context)->computeCoordinates(EphemContext::Iapetus, jd, xyz);
 }
 
-void get_miranda_parent_coordsv(double jd,double xyz[3], void* unused)
+void get_miranda_parent_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	GetGust86Coor(jd,GUST86_MIRANDA,xyz);
+	getContext(context)->computeCoordinates(EphemContext::Miranda, jd, xyz);
 }
 
-void get_ariel_parent_coordsv(double jd,double xyz[3], void* unused)
+void get_ariel_parent_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	GetGust86Coor(jd,GUST86_ARIEL,xyz);
+	getContext(context)->computeCoordinates(EphemContext::Ariel, jd, xyz);
 }
 
-void get_umbriel_parent_coordsv(double jd,double xyz[3], void* unused)
+void get_umbriel_parent_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	GetGust86Coor(jd,GUST86_UMBRIEL,xyz);
+	getContext(context)->computeCoordinates(EphemContext::Umbriel, jd, xyz);
 }
 
-void get_titania_parent_coordsv(double jd,double xyz[3], void* unused)
+void get_titania_parent_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	GetGust86Coor(jd,GUST86_TITANIA,xyz);
+	getContext(context)->computeCoordinates(EphemContext::Titania, jd, xyz);
 }
 
-void get_oberon_parent_coordsv(double jd,double xyz[3], void* unused)
+void get_oberon_parent_coordsv(double jd,double xyz[3], void* context)
 {
-	Q_UNUSED(unused);
-	GetGust86Coor(jd,GUST86_OBERON,xyz);
+	getContext(context)->computeCoordinates(EphemContext::Oberon, jd, xyz);
 }
-
@@ -41,9 +41,13 @@ public:
     static void init_de431(const char* filepath);
     static bool jd_fits_de430(const double jd);
     static bool jd_fits_de431(const double jd);
+    //! Enable the Chebyshev cache over VSOP87 and ELP82B, and set its accuracy bound in AU.
+    static void init_ephem_cache(const bool enabled, const double accuracy);
 };
 
-// These functions have an unused void pointer to be compatible to PosFuncType in SolarSystem and Planet classes.
+// These functions have a void pointer to be compatible to PosFuncType in SolarSystem and Planet classes.
+// It may point to an EphemContext, so that the positions can be computed from several threads.
+// When it is null, a context shared by all callers is used, and the functions are not reentrant.
 void get_sun_helio_coordsv(double jd,double xyz[3], void*);
 void get_mercury_helio_coordsv(double jd,double xyz[3], void*);
 void get_venus_helio_coordsv(double jd,double xyz[3], void*);
@@ -55,15 +59,15 @@ void get_uranus_helio_coordsv(double jd,double xyz[3], void*);
 void get_neptune_helio_coordsv(double jd,double xyz[3], void*);
 void get_pluto_helio_coordsv(double jd,double xyz[3], void*);
 
-void get_mercury_helio_osculating_coords(double jd0,double jd,double xyz[3]);
-void get_venus_helio_osculating_coords(double jd0,double jd,double xyz[3]);
-void get_earth_helio_osculating_coords(double jd0,double jd,double xyz[3]);
-void get_mars_helio_osculating_coords(double jd0,double jd,double xyz[3]);
-void get_jupiter_helio_osculating_coords(double jd0,double jd,double xyz[3]);
-void get_saturn_helio_osculating_coords(double jd0,double jd,double xyz[3]);
-void get_uranus_helio_osculating_coords(double jd0,double jd,double xyz[3]);
-void get_neptune_helio_osculating_coords(double jd0,double jd,double xyz[3]);
-void get_pluto_helio_osculating_coords(double jd0,double jd,double xyz[3]);
+void get_mercury_helio_osculating_coords(double jd0,double jd,double xyz[3], void*);
+void get_venus_helio_osculating_coords(double jd0,double jd,double xyz[3], void*);
+void get_earth_helio_osculating_coords(double jd0,double jd,double xyz[3], void*);
+void get_mars_helio_osculating_coords(double jd0,double jd,double xyz[3], void*);
+void get_jupiter_helio_osculating_coords(double jd0,double jd,double xyz[3], void*);
+void get_saturn_helio_osculating_coords(double jd0,double jd,double xyz[3], void*);
+void get_uranus_helio_osculating_coords(double jd0,double jd,double xyz[3], void*);
+void get_neptune_helio_osculating_coords(double jd0,double jd,double xyz[3], void*);
+void get_pluto_helio_osculating_coords(double jd0,double jd,double xyz[3], void*);
 
 void get_lunar_parent_coordsv(double jde, double xyz[3], void*);
 
@@ -31,17 +31,18 @@ THE SOFTWARE.
 #include "VecMath.hpp"
 #endif
 
+#include <QMutex>
+
 #ifdef __cplusplus
   extern "C" {
 #endif
 
 static void * ephem;
+// Serializes jpl_pleph() when the file is read record by record.
+static QMutex fileMutex;
    
-static Vec3d tempECL = Vec3d(0,0,0);
-static Vec3d tempICRF = Vec3d(0,0,0);
 static char nams[JPL_MAX_N_CONSTANTS][6];
 static double vals[JPL_MAX_N_CONSTANTS];
-static double tempXYZ[6];
 #ifdef UNIT_TEST
 // NOTE: Added hook for unit testing
 static const Mat4d matJ2000ToVsop87(Mat4d::xrotation(-23.4392803055555555556*(M_PI/180)) * Mat4d::zrotation(0.0000275*(M_PI/180)));
@@ -67,6 +68,9 @@ void InitDE431(const char* filepath)
 		jd1=jpl_get_double(ephem, JPL_EPHEM_START_JD);
 		jd2=jpl_get_double(ephem, JPL_EPHEM_END_JD);
 		qDebug() << "DE431 init successful. startJD=" << QString::number(jd1, 'f', 4) << "endJD=" << QString::number(jd2, 'f', 4);
+		// Map the file so that GetDe431Coor() can be called from several threads.
+		if (jpl_map_ephemeris(ephem, filepath) != 0)
+			qWarning() << "DE431: cannot map" << filepath << "in memory, reading it record by record";
 	}
 }
 
@@ -79,8 +83,16 @@ bool GetDe431Coor(const double jde, const int planet_id, double * xyz, const int
 {
     if(initDone)
     {
+	double tempXYZ[6];
 	// This may return some error code!
-	int jplresult=jpl_pleph(ephem, jde, planet_id, centralBody_id, tempXYZ, 0);
+	int jplresult;
+	if (jpl_is_mapped(ephem))
+		jplresult=jpl_pleph(ephem, jde, planet_id, centralBody_id, tempXYZ, 0);
+	else
+	{
+		QMutexLocker locker(&fileMutex);
+		jplresult=jpl_pleph(ephem, jde, planet_id, centralBody_id, tempXYZ, 0);
+	}
 
 	switch (jplresult)
 	{
@@ -112,11 +124,11 @@ bool GetDe431Coor(const double jde, const int planet_id, double * xyz, const int
 			break;
 	}
 
-        tempICRF = Vec3d(tempXYZ[0], tempXYZ[1], tempXYZ[2]);
+        const Vec3d tempICRF(tempXYZ[0], tempXYZ[1], tempXYZ[2]);
 	#ifdef UNIT_TEST
-	tempECL = matJ2000ToVsop87 * tempICRF;
+	const Vec3d tempECL = matJ2000ToVsop87 * tempICRF;
 	#else
-        tempECL = StelCore::matJ2000ToVsop87 * tempICRF;
+        const Vec3d tempECL = StelCore::matJ2000ToVsop87 * tempICRF;
 	#endif
 
         xyz[0] = tempECL[0];
@@ -43,6 +43,7 @@ the original Fortran code:
 
 ****************************************************************/
 
+#include "elp82b.h"
 #include "calc_interpolated_elements.h"
 
 #include <math.h>
@@ -162709,13 +162710,14 @@ void GetElp82bSphericalCoor(const double t,double r[3]) {
   r[2] = (accu[2] + t*(accu[5] + t*accu[8])) * a0_div_ath_times_au;
 }
 
-  /* ugly static variable for caching: */
-static double t_0 = -1e100;
-static double t_1 = -1e100;
-static double t_2 = -1e100;
-static double r_0[3];
-static double r_1[3];
-static double r_2[3];
+  /* ugly static variable for caching, the reentrant function takes its own state: */
+static struct Elp82bState elp82b_state = {-1e100,-1e100,-1e100,{0},{0},{0}};
+
+void InitElp82bState(struct Elp82bState *state) {
+  state->t_0 = -1e100;
+  state->t_1 = -1e100;
+  state->t_2 = -1e100;
+}
 
 #define DELTA_T (1.0/(24.0*36525.0))
 
@@ -162731,39 +162733,54 @@ static const double q3 =  1.265417e-9;
 static const double q4 = -1.371808e-12;
 static const double q5 = -3.20334e-15;
 
+static
+void Elp82bSphericalToRectangular(const double t,const double r[3],double xyz[3]) {
+  const double rh = r[2] * cos(r[1]);
+  const double x3 = r[2] * sin(r[1]);
+  const double x1 = rh * cos(r[0]);
+  const double x2 = rh * sin(r[0]);
+
+  double pw = t*(p1 + t*(p2 + t*(p3 + t*(p4 + t*p5))));
+  double qw = t*(q1 + t*(q2 + t*(q3 + t*(q4 + t*q5))));
+  const double pwq = pw * pw;
+  const double qwq = qw * qw;
+  const double pwqw = 2.0 * pw * qw;
+  const double pw2 = 1.0 - 2.0 * pwq;
+  const double qw2 = 1.0 - 2.0 * qwq;
+  const double h = 1.0 - pwq - qwq;
+  const double ra = (h > 0.0) ? (2.0 * sqrt(h)) : 0.0;
+  pw *= ra;
+  qw *= ra;
+
+    /* VSOP87 coordinates: */
+  xyz[0] = pw2 *x1 + pwqw*x2                + pw*x3;
+  xyz[1] = pwqw*x1 + qw2 *x2                - qw*x3;
+  xyz[2] = -pw *x1 + qw  *x2 + (pw2 + qw2 - 1.0)*x3;
+}
+
 void GetElp82bCoor(const double jd,double xyz[3]) {
+  GetElp82bCoor_r(&elp82b_state,jd,xyz);
+}
+
+void GetElp82bCoor_r(struct Elp82bState *state,const double jd,double xyz[3]) {
   const double t = (jd - 2451545.0) / 36525.0;
   double r[3];
   CalcInterpolatedElements(t,r,3,&GetElp82bSphericalCoor,DELTA_T,
-                           &t_0,r_0,&t_1,r_1,&t_2,r_2);
-  {
-    const double rh = r[2] * cos(r[1]);
-    const double x3 = r[2] * sin(r[1]);
-    const double x1 = rh * cos(r[0]);
-    const double x2 = rh * sin(r[0]);
-
-    double pw = t*(p1 + t*(p2 + t*(p3 + t*(p4 + t*p5))));
-    double qw = t*(q1 + t*(q2 + t*(q3 + t*(q4 + t*q5))));
-    const double pwq = pw * pw;
-    const double qwq = qw * qw;
-    const double pwqw = 2.0 * pw * qw;
-    const double pw2 = 1.0 - 2.0 * pwq;
-    const double qw2 = 1.0 - 2.0 * qwq;
-    const double h = 1.0 - pwq - qwq;
-    const double ra = (h > 0.0) ? (2.0 * sqrt(h)) : 0.0;
-    pw *= ra;
-    qw *= ra;
-
-      /* VSOP87 coordinates: */
-    xyz[0] = pw2 *x1 + pwqw*x2                + pw*x3;
-    xyz[1] = pwqw*x1 + qw2 *x2                - qw*x3;
-    xyz[2] = -pw *x1 + qw  *x2 + (pw2 + qw2 - 1.0)*x3;
-
+                           &state->t_0,state->r_0,
+                           &state->t_1,state->r_1,
+                           &state->t_2,state->r_2);
+  Elp82bSphericalToRectangular(t,r,xyz);
 /*
-    printf("Moon: %f  %22.15f %22.15f %22.15f\n",
-           jd,xyz[0],xyz[1],xyz[2]);
+  printf("Moon: %f  %22.15f %22.15f %22.15f\n",
+         jd,xyz[0],xyz[1],xyz[2]);
 */
-  }
+}
+
+void GetElp82bFullCoor(const double jd,double xyz[3]) {
+  const double t = (jd - 2451545.0) / 36525.0;
+  double r[3];
+  GetElp82bSphericalCoor(t,r);
+  Elp82bSphericalToRectangular(t,r,xyz);
 }
 
 
@@ -51,6 +51,15 @@ the original Fortran code:
 extern "C" {
 #endif
 
+struct Elp82bState {
+  /* spherical coordinates cached by CalcInterpolatedElements() */
+  double t_0,t_1,t_2;
+  double r_0[3],r_1[3],r_2[3];
+};
+
+void InitElp82bState(struct Elp82bState *state);
+  /* Prepare a state for its first use by GetElp82bCoor_r(). */
+
 void GetElp82bCoor(double jd,double xyz[3]);
 
   /* Return the rectangular coordinates of the earths moon
@@ -79,6 +88,20 @@ void GetElp82bCoor(double jd,double xyz[3]);
      ICRF, J2000 and FK5 are the same, while the transformation
      ICRF <-> VSOP87 must be done with the matrix given above.
    */
+
+void GetElp82bCoor_r(struct Elp82bState *state,double jd,double xyz[3]);
+
+  /* Same as GetElp82bCoor(), but the cached values are kept in state
+     instead of static variables. Different states can be used from
+     different threads at the same time.
+   */
+
+void GetElp82bFullCoor(double jd,double xyz[3]);
+
+  /* Same as GetElp82bCoor(), but evaluated from the full series at jd,
+     without the interpolation between cached values.
+     Unlike GetElp82bCoor(), this function is reentrant.
+   */
      
 
 #ifdef __cplusplus
@@ -60,6 +60,20 @@ extern "C" {
 #define GUST86_TITANIA   3
 #define GUST86_OBERON    4
 
+#define GUST86_DIM (5*6)
+
+struct Gust86State {
+  /* elements cached by CalcInterpolatedElements() */
+  double t_0,t_1,t_2;
+  double elem_0[GUST86_DIM],elem_1[GUST86_DIM],elem_2[GUST86_DIM];
+  /* elements of the last osculating epoch */
+  double jd0;
+  double elem[GUST86_DIM];
+};
+
+void InitGust86State(struct Gust86State *state);
+  /* Prepare a state for its first use by the _r functions. */
+
 void GetGust86Coor(const double jd, const int body, double *xyz);
   /* Return the rectangular coordinates of the given satellite
      and the given julian date jd expressed in dynamical time (TAI+32.184s).
@@ -93,6 +107,13 @@ void GetGust86OsculatingCoor(const double jd0, const double jd, const int body,
   /* The oculating orbit of epoch jd0, evaluated at jd, is returned.
   */
 
+void GetGust86Coor_r(struct Gust86State *state, const double jd, const int body, double *xyz);
+void GetGust86OsculatingCoor_r(struct Gust86State *state, const double jd0, const double jd, const int body, double *xyz);
+  /* Same as GetGust86Coor() and GetGust86OsculatingCoor(), but the cached
+     elements are kept in state instead of static variables. Different
+     states can be used from different threads at the same time.
+  */
+
 #ifdef __cplusplus
 }
 #endif
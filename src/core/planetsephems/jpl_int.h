@@ -27,6 +27,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
             /* expansion.  There's an assert to catch it if this changes.. */
 #define MAX_CHEBY          18
 
+#ifdef __cplusplus
+class QFile;
+#endif
+
 #pragma pack(1)
 
 struct interpolation_info
@@ -52,6 +56,16 @@ struct jpl_eph_data {
    double *cache;
    struct interpolation_info iinfo;
    FILE *ifile;
+               /* Set by jpl_map_ephemeris().  When the file is mapped, */
+               /* the records are read from the map,  and 'cache',       */
+               /* 'iinfo' and 'pvsun' are replaced by per-thread state. */
+   QFile *map_file;
+   const unsigned char *map;
+   uint64_t map_size;
+               /* Unique number of this ephemeris,  set on init.  A new   */
+               /* ephemeris may be allocated at the address of a closed   */
+               /* one,  the per-thread state compares both.               */
+   uint64_t generation;
    };
 #pragma pack()
 
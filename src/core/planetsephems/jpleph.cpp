@@ -63,6 +63,13 @@ details of the implementation encapsulated.
 #include <stdint.h>
 
 #include "StelUtils.hpp"
+#include <QFile>
+#include <atomic>
+#include <vector>
+#ifndef Q_OS_WIN
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 /**** include variable and type definitions, specific for this C version */
 
 #include "jpleph.h"
@@ -91,6 +98,8 @@ long DLL_FUNC jpl_get_long(const void *ephem, const int value)
 }
 
 
+static const double *current_pvsun(const struct jpl_eph_data *eph);
+
 /*****************************************************************************
 **           jpl_pleph(ephem,et,ntar,ncent,rrd,calc_velocity)              **
 ******************************************************************************
@@ -216,8 +225,11 @@ int DLL_FUNC jpl_pleph(void *ephem, const double et, const int ntarg,
    rval = jpl_state(eph, et, list, pv, rrd, 1);
    /* Solar System barycentric Sun state goes to pv[10][] */
    if(ntarg == 11 || ncent == 11)
+   {
+      const double *pvsun = current_pvsun(eph);
       for(i = 0; i < 6; i++)
-         pv[10][i] = eph->pvsun[i];
+         pv[10][i] = pvsun[i];
+   }
 
    /* Solar System Barycenter coordinates & velocities equal to zero */
    if(ntarg == 12 || ncent == 12)
@@ -577,17 +589,159 @@ static int dimension(const int idx)
 **                       d epsilon dot                                      **
 **                                                                          **
 *****************************************************************************/
+/* Interpolates the quantities of 'list' from the coefficients of one record.
+   'iinfo' and 'pvsun' are the interpolation state: the one of the ephemeris
+   for the FILE path,  or the one of the calling thread for mapped files. */
+static int interp_record(const struct jpl_eph_data *eph, const double *buf, const double t[2],
+                          const int list[14], double pv[][6], double nut[4], const int bary,
+                          struct interpolation_info *iinfo, double pvsun[9], const bool recompute_pvsun)
+{
+	unsigned i, j, n_intervals;
+	const double aufac = 1.0 / eph->au;
+
+	/* Here, i loops through the "traditional" 14 listed items -- 10
+	  solar system objects,  nutations,  librations,  lunar mantle angles,
+	  and TT-TDT -- plus a fifteenth:  the solar system barycenter.  That
+	  last is quite different:  it's computed 'as needed',  rather than
+	  from list[];  the output goes to pvsun rather than the pv array;
+	  and three quantities (position,  velocity,  acceleration) are
+	  computed (nobody else gets accelerations at present.)  */
+	for(n_intervals = 1; n_intervals <= 8; n_intervals *= 2)
+		for(i = 0; i < 15; i++)
+		{
+			unsigned quantities;
+			const uint32_t *iptr = &eph->ipt[i + 1][0];
+
+			if(i == 14)
+			{
+				quantities = (recompute_pvsun ? 3 : 0);
+				iptr = &eph->ipt[10][0];
+			}
+			else
+			{
+				quantities = list[i];
+				iptr = &eph->ipt[i < 10 ? i : i + 1][0];
+			}
+			if(n_intervals == iptr[2] && quantities)
+			{
+				double *dest;
+
+				if(i < 10)
+					dest = pv[i];
+				else if(i == 14)
+					dest = pvsun;
+				else
+					dest = nut;
+				interp(iinfo, &buf[iptr[0]-1], t, (int)iptr[1],
+						dimension(i + 1),
+						n_intervals, quantities, dest);
+
+				if(i < 10 || i == 14)        /*  convert km to AU */
+					for(j = 0; j < quantities * 3; j++)
+						dest[j] *= aufac;
+			}
+		}
+	if(!bary)                             /* gotta correct everybody for */
+		for(i = 0; i < 9; i++)            /* the solar system barycenter */
+			for(j = 0; j < (unsigned)list[i] * 3; j++)
+				pv[i][j] -= pvsun[j];
+	return(0);
+}
+
+/* Interpolation state of one thread for mapped ephemerides.  Threads never
+   share it,  so mapped ephemerides can be used without any lock.  It is
+   reset when the thread switches to another ephemeris (DE430 <-> DE431),
+   including a new one allocated at the address of a closed one. */
+struct jpl_thread_state
+{
+	const struct jpl_eph_data *eph;
+	uint64_t generation;
+	uint32_t curr_rec;
+	struct interpolation_info iinfo;
+	double pvsun[9];
+	double pvsun_t;
+	std::vector<double> swapped_rec;   /* record copy for files with the other byte order */
+};
+
+static thread_local struct jpl_thread_state thread_state;   /* zero initialized: eph is NULL */
+
+/* Source of jpl_eph_data::generation.  Starts at 1,  so that no ephemeris */
+/* matches the zero initialized thread state.                              */
+static std::atomic<uint64_t> next_generation(1);
+
+static const double *current_pvsun(const struct jpl_eph_data *eph)
+{
+	return(eph->map ? thread_state.pvsun : eph->pvsun);
+}
+
+/* Ask the system to read the records around 'nr' in the background,  so */
+/* that scrubbing the time in either direction does not wait on the disk. */
+static void prefetch_records(const struct jpl_eph_data *eph, const uint32_t nr)
+{
+#ifndef Q_OS_WIN
+	static const uint64_t page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+	uint64_t begin = (uint64_t)(nr + 1) * eph->recsize;   /* record nr-1 */
+	uint64_t end = (uint64_t)(nr + 5) * eph->recsize;     /* ...to nr+2 */
+	if(end > eph->map_size)
+		end = eph->map_size;
+	begin -= begin % page_size;
+	if(begin < end)
+		posix_madvise((void *)(eph->map + begin), (size_t)(end - begin), POSIX_MADV_WILLNEED);
+#else
+	Q_UNUSED(eph);
+	Q_UNUSED(nr);
+#endif
+}
+
+static int jpl_state_mapped(const struct jpl_eph_data *eph, const double et, const uint32_t nr, const double t[2],
+                            const int list[14], double pv[][6], double nut[4], const int bary)
+{
+	struct jpl_thread_state &state = thread_state;
+	const uint64_t offset = (uint64_t)(nr + 2) * eph->recsize;   /* two header records */
+	const double *buf;
+	bool recompute_pvsun;
+
+	if(offset + eph->ncoeff * sizeof(double) > eph->map_size)
+		return(JPL_EPH_READ_ERROR);
+
+	if(state.eph != eph || state.generation != eph->generation)
+	{
+		state.eph = eph;
+		state.generation = eph->generation;
+		state.curr_rec = (uint32_t)-1;
+		state.iinfo.posn_coeff[0] = 1.0;
+		state.iinfo.posn_coeff[1] = -2.0;
+		state.iinfo.vel_coeff[0] = 0.0;
+		state.iinfo.vel_coeff[1] = 1.0;
+		state.pvsun_t = -1e100;
+	}
+	if(nr != state.curr_rec)
+	{
+		state.curr_rec = nr;
+		prefetch_records(eph, nr);
+		if(eph->swap_bytes)
+		{
+			state.swapped_rec.resize(eph->ncoeff);
+			memcpy(state.swapped_rec.data(), eph->map + offset, eph->ncoeff * sizeof(double));
+			swap_64_bit_val(state.swapped_rec.data(), eph->ncoeff);
+		}
+	}
+	buf = (eph->swap_bytes ? state.swapped_rec.data() : (const double *)(eph->map + offset));
+
+	recompute_pvsun = (state.pvsun_t != et);
+	state.pvsun_t = et;
+	return(interp_record(eph, buf, t, list, pv, nut, bary, &state.iinfo, state.pvsun, recompute_pvsun));
+}
+
 int DLL_FUNC jpl_state(void *ephem, const double et, const int list[14],
                           double pv[][6], double nut[4], const int bary)
 {
 	struct jpl_eph_data *eph = (struct jpl_eph_data *)ephem;
-	unsigned i, j, n_intervals;
 	uint32_t nr;
 	double *buf = eph->cache;
 	double t[2];
 	const double block_loc = (et - eph->ephem_start) / eph->ephem_step;
 	bool recompute_pvsun;
-	const double aufac = 1.0 / eph->au;
 
 	/*   error return for epoch out of range  */
 	if(et < eph->ephem_start || et > eph->ephem_end)
@@ -602,6 +756,10 @@ int DLL_FUNC jpl_state(void *ephem, const double et, const int list[14],
 		t[0] = 1.;
 		nr--;
 	}
+	t[1] = eph->ephem_step;
+
+	if(eph->map)
+		return(jpl_state_mapped(eph, et, nr, t, list, pv, nut, bary));
 
 	/*   read correct record if not in core (static vector buf[])   */
 	if(nr != eph->curr_cache_loc)
@@ -621,7 +779,6 @@ int DLL_FUNC jpl_state(void *ephem, const double et, const int list[14],
 		if(eph->swap_bytes)
 			swap_64_bit_val(buf, eph->ncoeff);
 	}
-	t[1] = eph->ephem_step;
 
 	if(eph->pvsun_t != et)   /* If several calls are made for the same et, */
 	{                      /* don't recompute pvsun each time... only on */
@@ -631,53 +788,7 @@ int DLL_FUNC jpl_state(void *ephem, const double et, const int list[14],
 	else
 		recompute_pvsun = false;
 
-	/* Here, i loops through the "traditional" 14 listed items -- 10
-	  solar system objects,  nutations,  librations,  lunar mantle angles,
-	  and TT-TDT -- plus a fifteenth:  the solar system barycenter.  That
-	  last is quite different:  it's computed 'as needed',  rather than
-	  from list[];  the output goes to pvsun rather than the pv array;
-	  and three quantities (position,  velocity,  acceleration) are
-	  computed (nobody else gets accelerations at present.)  */
-	for(n_intervals = 1; n_intervals <= 8; n_intervals *= 2)
-		for(i = 0; i < 15; i++)
-		{
-			unsigned quantities;
-			uint32_t *iptr = &eph->ipt[i + 1][0];
-
-			if(i == 14)
-			{
-				quantities = (recompute_pvsun ? 3 : 0);
-				iptr = &eph->ipt[10][0];
-			}
-			else
-			{
-				quantities = list[i];
-				iptr = &eph->ipt[i < 10 ? i : i + 1][0];
-			}
-			if(n_intervals == iptr[2] && quantities)
-			{
-				double *dest = ((i == 10) ? eph->pvsun : pv[i]);
-
-				if(i < 10)
-					dest = pv[i];
-				else if(i == 14)
-					dest = eph->pvsun;
-				else
-					dest = nut;
-				interp(&eph->iinfo, &buf[iptr[0]-1], t, (int)iptr[1],
-						dimension(i + 1),
-						n_intervals, quantities, dest);
-
-				if(i < 10 || i == 14)        /*  convert km to AU */
-					for(j = 0; j < quantities * 3; j++)
-						dest[j] *= aufac;
-			}
-		}
-	if(!bary)                             /* gotta correct everybody for */
-		for(i = 0; i < 9; i++)            /* the solar system barycenter */
-			for(j = 0; j < (unsigned)list[i] * 3; j++)
-				pv[i][j] -= eph->pvsun[j];
-	return(0);
+	return(interp_record(eph, buf, t, list, pv, nut, bary, &eph->iinfo, eph->pvsun, recompute_pvsun));
 }
 
 static int init_err_code = JPL_INIT_NOT_CALLED;
@@ -758,6 +869,9 @@ void * DLL_FUNC jpl_init_ephemeris(const char *ephemeris_filename,
 
     init_err_code = 0;
     temp_data.ifile = ifile;
+    temp_data.map_file = NULL;
+    temp_data.map = NULL;
+    temp_data.map_size = 0;
     if(!ifile)
       init_err_code = JPL_INIT_FILE_NOT_FOUND;
     else if(fread(title, 84, 1, ifile) != 1)
@@ -899,6 +1013,7 @@ void * DLL_FUNC jpl_init_ephemeris(const char *ephemeris_filename,
     rval->iinfo.vel_coeff[0] = 0.0;
     rval->iinfo.vel_coeff[1] = 1.0;
     rval->curr_cache_loc = (uint32_t)-1;
+    rval->generation = next_generation++;
     
               /* The 'cache' data is right after the 'jpl_eph_data' struct: */
     rval->cache = (double *)(rval + 1);
@@ -958,10 +1073,60 @@ void DLL_FUNC jpl_close_ephemeris(void *ephem)
 {
    struct jpl_eph_data *eph = (struct jpl_eph_data *)ephem;
 
+   if(eph->map_file)
+      delete eph->map_file;   /* also unmaps the file */
    fclose(eph->ifile);
    free(ephem);
 }
 
+/****************************************************************************
+**    jpl_map_ephemeris(ephem, ephemeris_filename)                         **
+*****************************************************************************
+**                                                                         **
+**    Maps the whole ephemeris file in memory.  jpl_state() and jpl_pleph()**
+**    then decode the records directly from the map instead of reading     **
+**    them with fseek()/fread() into the single 'cache' record,  and keep  **
+**    their interpolation state per thread:  they can be called from       **
+**    several threads at once.  Returns 0 on success;  on failure (e.g.    **
+**    not enough address space for DE431 on a 32 bit system),  the FILE    **
+**    path keeps being used.                                               **
+****************************************************************************/
+int DLL_FUNC jpl_map_ephemeris(void *ephem, const char *ephemeris_filename)
+{
+   struct jpl_eph_data *eph = (struct jpl_eph_data *)ephem;
+   QFile *file;
+   uchar *map;
+
+   if(eph->map)
+      return(0);
+   file = new QFile(QString::fromLocal8Bit(ephemeris_filename));
+   if(!file->open(QIODevice::ReadOnly))
+   {
+      delete file;
+      return(JPL_EPH_READ_ERROR);
+   }
+   map = file->map(0, file->size());
+   if(!map)
+   {
+      delete file;
+      return(JPL_EPH_READ_ERROR);
+   }
+#ifndef Q_OS_WIN
+   /* Records are prefetched explicitly, the default read-ahead would */
+   /* mostly read records which are never used when jumping in time.  */
+   posix_madvise(map, (size_t)file->size(), POSIX_MADV_RANDOM);
+#endif
+   eph->map_file = file;
+   eph->map_size = (uint64_t)file->size();
+   eph->map = map;
+   return(0);
+}
+
+int DLL_FUNC jpl_is_mapped(const void *ephem)
+{
+   return(((const struct jpl_eph_data *)ephem)->map != NULL);
+}
+
 /* Added 2011 Jan 18:  random access to any desired JPL constant */
 
 
@@ -51,6 +51,8 @@ extern "C" {
 void * DLL_FUNC jpl_init_ephemeris( const char *ephemeris_filename,
                                              char nam[][6], double *val);
 void DLL_FUNC jpl_close_ephemeris( void *ephem);
+int DLL_FUNC jpl_map_ephemeris( void *ephem, const char *ephemeris_filename);
+int DLL_FUNC jpl_is_mapped( const void *ephem);
 int DLL_FUNC jpl_state( void *ephem, const double et, const int list[14],
                           double pv[][6], double nut[4], const int bary);
 int DLL_FUNC jpl_pleph( void *ephem, const double et, const int ntarg,
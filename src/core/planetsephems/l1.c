@@ -979,42 +979,65 @@ const double L1toVsop87[9] = {
 };
 
 
-static double t_0[4] = {-1e100,-1e100,-1e100,-1e100};
-static double t_1[4] = {-1e100,-1e100,-1e100,-1e100};
-static double t_2[4] = {-1e100,-1e100,-1e100,-1e100};
-static double l1_elem_0[4*6];
-static double l1_elem_1[4*6];
-static double l1_elem_2[4*6];
+static struct L1State l1_state = {
+  {-1e100,-1e100,-1e100,-1e100},
+  {-1e100,-1e100,-1e100,-1e100},
+  {-1e100,-1e100,-1e100,-1e100},
+  {0},{0},{0},
+  {-1e100,-1e100,-1e100,-1e100},
+  {0}
+};
 
 /* 1 day: */
 #define DELTA_T 1.0
 
-static double l1_jd0[4] = {-1e100,-1e100,-1e100,-1e100};
-static double l1_elem[4*6];
-
-static int ugly_static_parameter_body = -1;
-static void CalcUglyStaticL1Elem(double t,double elem[6]) {
-  CalcL1Elem(t,ugly_static_parameter_body,elem);
+void InitL1State(struct L1State *state) {
+  int body;
+  for (body=0;body<4;body++) {
+    state->t_0[body] = -1e100;
+    state->t_1[body] = -1e100;
+    state->t_2[body] = -1e100;
+    state->jd0[body] = -1e100;
+  }
 }
 
+/* CalcInterpolatedElements() only passes the time, so there is one function per body. */
+static void CalcL1ElemIo(double t,double elem[6])       {CalcL1Elem(t,L1_IO,elem);}
+static void CalcL1ElemEuropa(double t,double elem[6])   {CalcL1Elem(t,L1_EUROPA,elem);}
+static void CalcL1ElemGanymede(double t,double elem[6]) {CalcL1Elem(t,L1_GANYMEDE,elem);}
+static void CalcL1ElemCallisto(double t,double elem[6]) {CalcL1Elem(t,L1_CALLISTO,elem);}
+
+static void (*const l1_calc_elem[4])(double t,double elem[6]) = {
+  &CalcL1ElemIo,&CalcL1ElemEuropa,&CalcL1ElemGanymede,&CalcL1ElemCallisto
+};
+
 void GetL1Coor(double jd,int body,double *xyz) {
   GetL1OsculatingCoor(jd,jd,body,xyz);
 }
 
 void GetL1OsculatingCoor(const double jd0,const double jd,
                          const int body,double *xyz) {
+  GetL1OsculatingCoor_r(&l1_state,jd0,jd,body,xyz);
+}
+
+void GetL1Coor_r(struct L1State *state,double jd,int body,double *xyz) {
+  GetL1OsculatingCoor_r(state,jd,jd,body,xyz);
+}
+
+void GetL1OsculatingCoor_r(struct L1State *state,
+                           const double jd0,const double jd,
+                           const int body,double *xyz) {
   double x[3];
-  if (jd0 != l1_jd0[body]) {
+  if (jd0 != state->jd0[body]) {
     const double t0 = jd0 - 2433282.5;
-    l1_jd0[body] = jd0;
-    ugly_static_parameter_body = body;
-    CalcInterpolatedElements(t0,l1_elem+(body*6),6,
-                             &CalcUglyStaticL1Elem,DELTA_T,
-                             t_0+body,l1_elem_0+(body*6),
-                             t_1+body,l1_elem_1+(body*6),
-                             t_2+body,l1_elem_2+(body*6));
+    state->jd0[body] = jd0;
+    CalcInterpolatedElements(t0,state->elem+(body*6),6,
+                             l1_calc_elem[body],DELTA_T,
+                             state->t_0+body,state->elem_0+(body*6),
+                             state->t_1+body,state->elem_1+(body*6),
+                             state->t_2+body,state->elem_2+(body*6));
   }
-  EllipticToRectangularA(l1_bodies[body].mu,l1_elem+(body*6),jd-jd0,x);
+  EllipticToRectangularA(l1_bodies[body].mu,state->elem+(body*6),jd-jd0,x);
   xyz[0] = L1toVsop87[0]*x[0]+L1toVsop87[1]*x[1]+L1toVsop87[2]*x[2];
   xyz[1] = L1toVsop87[3]*x[0]+L1toVsop87[4]*x[1]+L1toVsop87[5]*x[2];
   xyz[2] = L1toVsop87[6]*x[0]+L1toVsop87[7]*x[1]+L1toVsop87[8]*x[2];
@@ -56,6 +56,18 @@ extern "C" {
 #define L1_GANYMEDE      2
 #define L1_CALLISTO      3
 
+struct L1State {
+  /* elements cached by CalcInterpolatedElements(), for each body */
+  double t_0[4],t_1[4],t_2[4];
+  double elem_0[4*6],elem_1[4*6],elem_2[4*6];
+  /* elements of the last osculating epoch of each body */
+  double jd0[4];
+  double elem[4*6];
+};
+
+void InitL1State(struct L1State *state);
+  /* Prepare a state for its first use by the _r functions. */
+
 void GetL1Coor(double jd,int body,double *xyz);
   /* Return the rectangular coordinates of the given satellite
      and the given julian date jd expressed in dynamical time (TAI+32.184s).
@@ -64,6 +76,7 @@ void GetL1Coor(double jd,int body,double *xyz);
      which is the reference frame in VSOP87 and VSOP87A.
 
      WARNING! Due to static internal variables, this function is not reentrant and not parallelizable!
+     Use GetL1Coor_r() with one L1State per thread instead.
   */
 
 void GetL1OsculatingCoor(const double jd0,const double jd, const int body,double *xyz);
@@ -71,6 +84,15 @@ void GetL1OsculatingCoor(const double jd0,const double jd, const int body,double
   /* The oculating orbit of epoch jd0, evaluated at jd, is returned.
   */
 
+void GetL1Coor_r(struct L1State *state,double jd,int body,double *xyz);
+void GetL1OsculatingCoor_r(struct L1State *state,
+                           const double jd0,const double jd,
+                           const int body,double *xyz);
+  /* Same as GetL1Coor() and GetL1OsculatingCoor(), but the cached elements
+     are kept in state instead of static variables. Different states can be
+     used from different threads at the same time.
+  */
+
 
 #ifdef __cplusplus
 }
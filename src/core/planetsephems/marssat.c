@@ -408,44 +408,52 @@ void GenerateMarsSatToVSOP87(double t,double mars_sat_to_vsop87[9]) {
   }
 }
 
-static double t_0 = -1e100;
-static double t_1 = -1e100;
-static double t_2 = -1e100;
-static double marssat_elem_0[2*6];
-static double marssat_elem_1[2*6];
-static double marssat_elem_2[2*6];
+static struct MarsSatState marssat_state = {-1e100,-1e100,-1e100,{0},{0},{0},-1e100,{0},{0}};
 
 /* 1 day: */
 #define DELTA_T 1.0
 
-static double marssat_jd0 = -1e100;
-static double marssat_elem[2*6];
+void InitMarsSatState(struct MarsSatState *state) {
+  state->t_0 = -1e100;
+  state->t_1 = -1e100;
+  state->t_2 = -1e100;
+  state->jd0 = -1e100;
+}
 
 static void CalcAllMarsSatElem(double t,double elem[12]) {
   CalcMarsSatElem(t,0,elem+(0*6));
   CalcMarsSatElem(t,1,elem+(1*6));
 }
 
-static double mars_sat_to_vsop87[9];
-
 void GetMarsSatCoor(double jd,int body,double *xyz) {
   GetMarsSatOsculatingCoor(jd,jd,body,xyz);
 }
 
 void GetMarsSatOsculatingCoor(const double jd0,const double jd,
                               const int body,double *xyz) {
+  GetMarsSatOsculatingCoor_r(&marssat_state,jd0,jd,body,xyz);
+}
+
+void GetMarsSatCoor_r(struct MarsSatState *state,double jd,int body,double *xyz) {
+  GetMarsSatOsculatingCoor_r(state,jd,jd,body,xyz);
+}
+
+void GetMarsSatOsculatingCoor_r(struct MarsSatState *state,
+                                const double jd0,const double jd,
+                                const int body,double *xyz) {
   double x[3];
-  if (jd0 != marssat_jd0) {
+  const double *const mars_sat_to_vsop87 = state->mars_sat_to_vsop87;
+  if (jd0 != state->jd0) {
     const double t0 = jd0 - 2451545.0 + 6491.5;
-    marssat_jd0 = jd0;
-    CalcInterpolatedElements(t0,marssat_elem,12,
+    state->jd0 = jd0;
+    CalcInterpolatedElements(t0,state->elem,12,
                              &CalcAllMarsSatElem,DELTA_T,
-                             &t_0,marssat_elem_0,
-                             &t_1,marssat_elem_1,
-                             &t_2,marssat_elem_2);
-    GenerateMarsSatToVSOP87(t0,mars_sat_to_vsop87);
+                             &state->t_0,state->elem_0,
+                             &state->t_1,state->elem_1,
+                             &state->t_2,state->elem_2);
+    GenerateMarsSatToVSOP87(t0,state->mars_sat_to_vsop87);
   }
-  EllipticToRectangularA(mars_sat_bodies[body].mu,marssat_elem+(body*6),
+  EllipticToRectangularA(mars_sat_bodies[body].mu,state->elem+(body*6),
                          jd-jd0,x);
   xyz[0] = mars_sat_to_vsop87[0]*x[0]
          + mars_sat_to_vsop87[1]*x[1]
@@ -456,8 +464,4 @@ void GetMarsSatOsculatingCoor(const double jd0,const double jd,
   xyz[2] = mars_sat_to_vsop87[6]*x[0]
          + mars_sat_to_vsop87[7]*x[1]
          + mars_sat_to_vsop87[8]*x[2];
-/*
-  printf("%d %18.9lf %15.12lf %15.12lf %15.12lf\n",
-         body,jd,xyz[0],xyz[1],xyz[2]);
-*/
 }
@@ -58,6 +58,19 @@ extern "C" {
 #define MARS_SAT_PHOBOS 0
 #define MARS_SAT_DEIMOS 1
 
+struct MarsSatState {
+  /* elements cached by CalcInterpolatedElements() */
+  double t_0,t_1,t_2;
+  double elem_0[2*6],elem_1[2*6],elem_2[2*6];
+  /* elements and orientation of the last osculating epoch */
+  double jd0;
+  double elem[2*6];
+  double mars_sat_to_vsop87[9];
+};
+
+void InitMarsSatState(struct MarsSatState *state);
+  /* Prepare a state for its first use by the _r functions. */
+
 void GetMarsSatCoor(double jd,int body,double *xyz);
   /* Return the rectangular coordinates of the given satellite
      and the given julian date jd expressed in dynamical time (TAI+32.184s).
@@ -70,6 +83,15 @@ void GetMarsSatOsculatingCoor(const double jd0, const double jd, const int body,
   /* The oculating orbit of epoch jd0, evatuated at jd, is returned.
   */
 
+void GetMarsSatCoor_r(struct MarsSatState *state,double jd,int body,double *xyz);
+void GetMarsSatOsculatingCoor_r(struct MarsSatState *state,
+                                const double jd0,const double jd,
+                                const int body,double *xyz);
+  /* Same as GetMarsSatCoor() and GetMarsSatOsculatingCoor(), but the cached
+     elements are kept in state instead of static variables. Different
+     states can be used from different threads at the same time.
+  */
+
 #ifdef __cplusplus
 }
 #endif
@@ -3142,18 +3142,17 @@ const double TASS17toJ2000[9] = {
 };
 */
 
-#define TASS17_DIM (8*6)
-static double t_0 = -1e100;
-static double t_1 = -1e100;
-static double t_2 = -1e100;
-static double tass17_elem_0[TASS17_DIM];
-static double tass17_elem_1[TASS17_DIM];
-static double tass17_elem_2[TASS17_DIM];
+static struct Tass17State tass17_state = {-1e100,-1e100,-1e100,{0},{0},{0},-1e100,{0}};
 /* 1 day: */
 #define DELTA_T 1.0
 
-static double tass17_jd0 = -1e100;
-static double tass17_elem[TASS17_DIM];
+void InitTass17State(struct Tass17State *state)
+{
+	state->t_0 = -1e100;
+	state->t_1 = -1e100;
+	state->t_2 = -1e100;
+	state->jd0 = -1e100;
+}
 
 void CalcAllTass17Elem(const double t,double elem[TASS17_DIM])
 {
@@ -3169,30 +3168,31 @@ void GetTass17Coor(double jd,int body,double *xyz)
 }
 
 void GetTass17OsculatingCoor(const double jd0,const double jd, const int body,double *xyz)
+{
+	GetTass17OsculatingCoor_r(&tass17_state,jd0,jd,body,xyz);
+}
+
+void GetTass17Coor_r(struct Tass17State *state,double jd,int body,double *xyz)
+{
+	GetTass17OsculatingCoor_r(state,jd,jd,body,xyz);
+}
+
+void GetTass17OsculatingCoor_r(struct Tass17State *state,const double jd0,const double jd, const int body,double *xyz)
 {
 	double x[3];
-	if (jd0 != tass17_jd0)
+	if (jd0 != state->jd0)
 	{
 		const double t0 = jd0 - 2444240.0;
-		tass17_jd0 = jd0;
-		CalcInterpolatedElements(t0,tass17_elem,
+		state->jd0 = jd0;
+		CalcInterpolatedElements(t0,state->elem,
 					 TASS17_DIM,
 					 &CalcAllTass17Elem,DELTA_T,
-					 &t_0,tass17_elem_0,
-					 &t_1,tass17_elem_1,
-					 &t_2,tass17_elem_2);
-		/*
-		printf("GetTass17Coor(%d): %f %f  %f %f  %f %f\n",
-			body,
-			tass17_elem[body*6+0],tass17_elem[body*6+1],tass17_elem[body*6+2],
-			tass17_elem[body*6+3],tass17_elem[body*6+4],tass17_elem[body*6+5]);
-		*/
+					 &state->t_0,state->elem_0,
+					 &state->t_1,state->elem_1,
+					 &state->t_2,state->elem_2);
 	}
-	EllipticToRectangularN(tass17bodies[body].mu,tass17_elem+(body*6),jd-jd0,x);
+	EllipticToRectangularN(tass17bodies[body].mu,state->elem+(body*6),jd-jd0,x);
 	xyz[0] = TASS17toVSOP87[0]*x[0]+TASS17toVSOP87[1]*x[1]+TASS17toVSOP87[2]*x[2];
 	xyz[1] = TASS17toVSOP87[3]*x[0]+TASS17toVSOP87[4]*x[1]+TASS17toVSOP87[5]*x[2];
 	xyz[2] = TASS17toVSOP87[6]*x[0]+TASS17toVSOP87[7]*x[1]+TASS17toVSOP87[8]*x[2];
 }
-
-
-
@@ -66,9 +66,30 @@ extern "C" {
 #define TASS17_HYPERION  7
 #define TASS17_IAPETUS   6
 
+#define TASS17_DIM (8*6)
+
+struct Tass17State {
+  /* elements cached by CalcInterpolatedElements() */
+  double t_0,t_1,t_2;
+  double elem_0[TASS17_DIM],elem_1[TASS17_DIM],elem_2[TASS17_DIM];
+  /* elements of the last osculating epoch */
+  double jd0;
+  double elem[TASS17_DIM];
+};
+
+void InitTass17State(struct Tass17State *state);
+  /* Prepare a state for its first use by the _r functions. */
+
 void GetTass17Coor(double jd,int body,double *xyz);
 void GetTass17OsculatingCoor(const double jd0,const double jd, const int body,double *xyz);
 
+void GetTass17Coor_r(struct Tass17State *state,double jd,int body,double *xyz);
+void GetTass17OsculatingCoor_r(struct Tass17State *state,const double jd0,const double jd, const int body,double *xyz);
+  /* Same as above, but the cached elements are kept in state instead of
+     static variables. Different states can be used from different threads
+     at the same time.
+  */
+
 #ifdef __cplusplus
 }
 #endif
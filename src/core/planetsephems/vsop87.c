@@ -137317,38 +137317,53 @@ void CalcVsop87Elem(const double t,double elem[8*6]) {
 */
 }
 
-/* dirty caching in static variables
-   If you ever want to allow parallel execution,
-   make a struct from these and malloc such structs and add pointer arguments to the calls as needed.
-*/
-#define VSOP87_DIM (8*6)
-static double t_0 = -1e100;
-static double t_1 = -1e100;
-static double t_2 = -1e100;
-static double vsop87_elem_0[VSOP87_DIM];
-static double vsop87_elem_1[VSOP87_DIM];
-static double vsop87_elem_2[VSOP87_DIM];
+/* dirty caching in a static state, the reentrant functions take their own state */
+static struct Vsop87State vsop87_state = {-1e100,-1e100,-1e100,{0},{0},{0},-1e100,{0}};
 /* 10 days: */
 #define DELTA_T (10.0/365250.0)
 
-static double vsop87_jd0 = -1e100;
-static double vsop87_elem[VSOP87_DIM];
+void InitVsop87State(struct Vsop87State *state) {
+  state->t_0 = -1e100;
+  state->t_1 = -1e100;
+  state->t_2 = -1e100;
+  state->jd0 = -1e100;
+}
 
 void GetVsop87Coor(double jd,int body,double *xyz) {
   GetVsop87OsculatingCoor(jd,jd,body,xyz);
 }
 
+void GetVsop87FullCoor(double jd,double xyz[8*3]) {
+  const double t = (jd - 2451545.0) / 365250.0;
+  double elem[VSOP87_DIM];
+  int body;
+  CalcVsop87Elem(t,elem);
+  for (body=0;body<8;body++) {
+	EllipticToRectangularA(vsop87_mu[body],elem+(body*6),0.0,xyz+(body*3));
+  }
+}
+
 void GetVsop87OsculatingCoor(const double jd0,const double jd,
 							 const int body,double *xyz) {
-  if (jd0 != vsop87_jd0) {
+  GetVsop87OsculatingCoor_r(&vsop87_state,jd0,jd,body,xyz);
+}
+
+void GetVsop87Coor_r(struct Vsop87State *state,double jd,int body,double *xyz) {
+  GetVsop87OsculatingCoor_r(state,jd,jd,body,xyz);
+}
+
+void GetVsop87OsculatingCoor_r(struct Vsop87State *state,
+							   const double jd0,const double jd,
+							   const int body,double *xyz) {
+  if (jd0 != state->jd0) {
 	const double t0 = (jd0 - 2451545.0) / 365250.0;
-	vsop87_jd0 = jd0;
-	CalcInterpolatedElements(t0,vsop87_elem,
+	state->jd0 = jd0;
+	CalcInterpolatedElements(t0,state->elem,
 							 VSOP87_DIM,
 							 &CalcVsop87Elem,DELTA_T,
-							 &t_0,vsop87_elem_0,
-							 &t_1,vsop87_elem_1,
-							 &t_2,vsop87_elem_2);
+							 &state->t_0,state->elem_0,
+							 &state->t_1,state->elem_1,
+							 &state->t_2,state->elem_2);
   }
-  EllipticToRectangularA(vsop87_mu[body],vsop87_elem+(body*6),jd-jd0,xyz);
+  EllipticToRectangularA(vsop87_mu[body],state->elem+(body*6),jd-jd0,xyz);
 }
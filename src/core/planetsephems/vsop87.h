@@ -42,7 +42,9 @@ Furthermore I used the addition formulas
 so that for given T the functions cos and sin have only to be called 12 times.
 
 
-ATTENTION! Due to static caching this solution is not reentrant and cannot be parallelized to run in several threads.
+ATTENTION! Due to static caching GetVsop87Coor() and GetVsop87OsculatingCoor()
+are not reentrant and cannot be parallelized to run in several threads.
+Use the _r variants with one Vsop87State per thread instead.
 
 ****************************************************************/
 
@@ -54,6 +56,20 @@ ATTENTION! Due to static caching this solution is not reentrant and cannot be pa
 extern "C" {
 #endif
 
+#define VSOP87_DIM (8*6)
+
+struct Vsop87State {
+  /* elements cached by CalcInterpolatedElements() */
+  double t_0,t_1,t_2;
+  double elem_0[VSOP87_DIM],elem_1[VSOP87_DIM],elem_2[VSOP87_DIM];
+  /* elements of the last osculating epoch */
+  double jd0;
+  double elem[VSOP87_DIM];
+};
+
+void InitVsop87State(struct Vsop87State *state);
+  /* Prepare a state for its first use by the _r functions. */
+
 void GetVsop87Coor(double jd,int body,double *xyz);
   /* Return the rectangular coordinates of the given planet
      and the given julian date jd expressed in dynamical time (TAI+32.184s).
@@ -66,6 +82,23 @@ void GetVsop87OsculatingCoor(const double jd0,const double jd, const int body,do
   /* The oculating orbit of epoch jd0, evaluated at jd, is returned.
   */
 
+void GetVsop87Coor_r(struct Vsop87State *state,double jd,int body,double *xyz);
+void GetVsop87OsculatingCoor_r(struct Vsop87State *state,
+                               const double jd0,const double jd,
+                               const int body,double *xyz);
+  /* Same as GetVsop87Coor() and GetVsop87OsculatingCoor(), but the cached
+     elements are kept in state instead of static variables. Given the same
+     sequence of dates, the same results are returned. Different states
+     can be used from different threads at the same time.
+  */
+
+void GetVsop87FullCoor(double jd,double xyz[8*3]);
+  /* Return the rectangular coordinates of all 8 bodies (body*3+i)
+     evaluated from the full series at jd, without the interpolation
+     between cached elements done by GetVsop87Coor().
+     Unlike GetVsop87Coor(), this function is reentrant.
+  */
+
 #ifdef __cplusplus
 }
 #endif
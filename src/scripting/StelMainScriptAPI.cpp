@@ -239,7 +239,7 @@ void StelMainScriptAPI::setObserverLocation(double longitude, double latitude, d
 	loc.latitude = latitude;
 	if (altitude > -1000)
 		loc.altitude = altitude;
-	if (ssmgr->searchByName(planet))
+	if (ssmgr->materializeByEnglishName(planet))
 		loc.planetName = planet;
 	loc.name = name;
 	core->moveObserverTo(loc, duration, duration);
@@ -904,7 +904,7 @@ QVariantMap StelMainScriptAPI::getObjectPosition(const QString& name)
 QVariantMap StelMainScriptAPI::getObjectInfo(const QString& name)
 {
 	StelObjectMgr* omgr = GETSTELMODULE(StelObjectMgr);
-	StelObjectP obj = omgr->searchByName(name);
+	StelObjectP obj = omgr->materializeByName(name);
 
 	return StelObjectMgr::getObjectInfo(obj);
 }
@@ -0,0 +1,214 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+
+#include "tests/testDrawOrder.hpp"
+#include "DrawOrder.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+QTEST_GUILESS_MAIN(TestDrawOrder)
+
+namespace
+{
+	// A body moving on a circle, at the distance of its center plus a periodic term
+	struct TestBody
+	{
+		double meanDistance;
+		double amplitude;
+		double phase;
+		double period;
+		float magnitude;
+		double distance;
+		void computeDistance(double t) {distance = meanDistance + amplitude*std::sin(2.*M_PI*t/period + phase);}
+	};
+
+	struct TestFilter
+	{
+		TestFilter(double t, float limitMagnitude) : t(t), limitMagnitude(limitMagnitude) {}
+		bool operator()(TestBody* b, double& distance) const
+		{
+			b->computeDistance(t);
+			distance = b->distance;
+			return b->magnitude-5.f<=limitMagnitude;
+		}
+		double t;
+		float limitMagnitude;
+	};
+
+	// The order of SolarSystem::draw() before DrawOrder
+	struct BiggerDistance
+	{
+		bool operator()(QSharedPointer<TestBody> b1, QSharedPointer<TestBody> b2)
+		{
+			return b1->distance > b2->distance;
+		}
+	};
+
+	QVector<QSharedPointer<TestBody> > testBodies(int n)
+	{
+		QVector<QSharedPointer<TestBody> > bodies;
+		for (int i=0;i<n;++i)
+		{
+			TestBody* b = new TestBody;
+			b->meanDistance = 1.+0.001*(i%5000);
+			b->amplitude = 0.01*(i%97);
+			b->phase = 0.1*(i%63);
+			b->period = 100.+(i%1000);
+			b->magnitude = 5.f+0.01f*(i%2000);
+			b->distance = 0.;
+			bodies << QSharedPointer<TestBody>(b);
+		}
+		return bodies;
+	}
+
+	QVector<TestBody*> pointers(const QVector<QSharedPointer<TestBody> >& bodies)
+	{
+		QVector<TestBody*> result;
+		foreach (const QSharedPointer<TestBody>& b, bodies)
+			result << b.data();
+		return result;
+	}
+
+	// Check that the drawn bodies are the visible ones, by decreasing distance.
+	bool checkDrawn(const QVector<TestBody*>& drawn, const QVector<TestBody*>& all, float limitMagnitude)
+	{
+		int nbVisible = 0;
+		foreach (TestBody* b, all)
+		{
+			if (b->magnitude-5.f<=limitMagnitude)
+				nbVisible++;
+		}
+		if (drawn.size()!=nbVisible)
+			return false;
+		for (int i=0;i<drawn.size();++i)
+		{
+			if (drawn.at(i)->magnitude-5.f>limitMagnitude)
+				return false;
+			if (i>0 && drawn.at(i-1)->distance<drawn.at(i)->distance)
+				return false;
+		}
+		return true;
+	}
+}
+
+void TestDrawOrder::testOrder()
+{
+	const QVector<QSharedPointer<TestBody> > bodies = testBodies(20000);
+	DrawOrder<TestBody*> order;
+	order.setItems(pointers(bodies));
+
+	// The first update sorts from scratch, the following ones, one hour apart, only repair the order.
+	for (int frame=0;frame<100;++frame)
+	{
+		TestFilter filter(frame/24., 8.f);
+		const QVector<TestBody*>& drawn = order.update(filter);
+		QVERIFY(checkDrawn(drawn, pointers(bodies), 8.f));
+	}
+	QCOMPARE(order.getNrOfFullSorts(), 1);
+
+	// Bodies becoming visible and a jump in time
+	for (int frame=0;frame<10;++frame)
+	{
+		const float limitMagnitude = 8.f+frame;
+		TestFilter filter(100.*frame, limitMagnitude);
+		QVERIFY(checkDrawn(order.update(filter), pointers(bodies), limitMagnitude));
+	}
+}
+
+void TestDrawOrder::testSetItems()
+{
+	QVector<QSharedPointer<TestBody> > bodies = testBodies(1000);
+	DrawOrder<TestBody*> order;
+	order.setItems(pointers(bodies));
+	TestFilter filter(0., 100.f);
+	order.update(filter);
+
+	// Remove some bodies and add new ones
+	QVector<QSharedPointer<TestBody> > newBodies = testBodies(100);
+	QVector<QSharedPointer<TestBody> > remaining;
+	for (int i=0;i<bodies.size();++i)
+	{
+		if (i%3!=0)
+			remaining << bodies.at(i);
+	}
+	order.setItems(pointers(remaining + newBodies));
+	QVERIFY(order.getDrawnItems().isEmpty());
+	const QVector<TestBody*>& drawn = order.update(filter);
+	QVERIFY(checkDrawn(drawn, pointers(remaining + newBodies), 100.f));
+}
+
+void TestDrawOrder::benchmarkFrames_data()
+{
+	QTest::addColumn<int>("nbBodies");
+	QTest::addColumn<bool>("incremental");
+	const int nbBodies[] = {1000, 10000, 100000, 500000};
+	for (int n=0;n<4;++n)
+	{
+		QTest::newRow(qPrintable(QString("%1 bodies, full sort").arg(nbBodies[n]))) << nbBodies[n] << false;
+		QTest::newRow(qPrintable(QString("%1 bodies, incremental").arg(nbBodies[n]))) << nbBodies[n] << true;
+	}
+}
+
+void TestDrawOrder::benchmarkFrames()
+{
+	QFETCH(int, nbBodies);
+	QFETCH(bool, incremental);
+
+	QVector<QSharedPointer<TestBody> > bodies = testBodies(nbBodies);
+	DrawOrder<TestBody*> order;
+	order.setItems(pointers(bodies));
+	// About a quarter of the bodies are bright enough to be drawn.
+	const float limitMagnitude = 5.f;
+	// One frame per hour of animation
+	const int nbFrames = 10;
+	double t = 0.;
+	int nbDrawn = 0;
+	qint64 nbUpdates = 0;
+	QElapsedTimer timer;
+	timer.start();
+	QBENCHMARK {
+		for (int frame=0;frame<nbFrames;++frame)
+		{
+			t += 1./24.;
+			if (incremental)
+			{
+				TestFilter filter(t, limitMagnitude);
+				nbDrawn = order.update(filter).size();
+			}
+			else
+			{
+				foreach (const QSharedPointer<TestBody>& b, bodies)
+					b->computeDistance(t);
+				std::sort(bodies.begin(), bodies.end(), BiggerDistance());
+				nbDrawn = bodies.size();
+			}
+			nbUpdates++;
+		}
+	}
+	const qint64 elapsed = timer.nsecsElapsed();
+	QVERIFY(elapsed>0);
+	qDebug() << nbBodies << "bodies," << nbDrawn << "drawn:" << elapsed/1e6/nbUpdates << "ms per frame," << order.getNrOfFullSorts() << "full sorts";
+}
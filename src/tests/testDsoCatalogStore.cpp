@@ -0,0 +1,390 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+#include <QDataStream>
+#include <QFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cmath>
+
+#include "tests/testDsoCatalogStore.hpp"
+#include "StelSphericalIndex.hpp"
+#include "StelSphereGeometry.hpp"
+
+QTEST_GUILESS_MAIN(TestDsoCatalogStore)
+
+#define NR_OF_DSO 600
+#define CATALOG_VERSION "3.2"
+
+// The offsets of the fields of the header of the store, see DsoCatalogStore.cpp
+#define OFFSET_VERSION 8
+#define OFFSET_NR_OF_RECORDS 12
+#define OFFSET_NR_OF_COLUMNS 16
+#define OFFSET_NR_OF_NODES 20
+#define OFFSET_POSITIONS 72
+#define OFFSET_TRIANGLES 80
+#define OFFSET_COLUMNS 88
+#define OFFSET_NODES 96
+#define OFFSET_ELEMENTS 104
+#define OFFSET_POOL 112
+#define OFFSET_POOL_SIZE 120
+
+static double rand01()
+{
+	return (double)qrand()/RAND_MAX;
+}
+
+// Designations shared by many DSO, stored once in the pool.
+static const char* sharedDesignations[] = {"PK 123-04 5", "PN G010.1+00.7", "SNR G004.5+06.8", "ACO 2151", "Ced 201\xce\xb1"};
+
+QString TestDsoCatalogStore::writeCatalog(const QString& name, const QString& version)
+{
+	qsrand(4321);
+	QByteArray raw;
+	QDataStream out(&raw, QIODevice::WriteOnly);
+	out.setVersion(QDataStream::Qt_5_2);
+	out << version << QString("test");
+	for (int i=0;i<NR_OF_DSO;++i)
+	{
+		const float ra = 2.*M_PI*rand01();
+		const float dec = std::asin(2.*rand01()-1.);
+		// One DSO out of 7 has no designation.
+		const bool withID = i%7!=0;
+		const unsigned int number = withID ? i+1 : 0;
+		const QString shared = QString::fromUtf8(sharedDesignations[i%5]);
+		const QString designation = withID && i%3==0 ? shared : QString();
+		const QString ownDesignation = withID && i%4==0 ? QString("PK %1+01 2").arg(i) : QString();
+		out << (unsigned int)(i+1) << ra << dec << (float)(5.+10.*rand01()) << (float)(4.+10.*rand01())
+		    << (unsigned int)(i%35) << (i%2 ? QString("SBb") : QString())
+		    << (float)rand01() << (float)(0.5*rand01()) << (int)(i%180)
+		    << (float)(0.01*rand01()) << (float)(0.001*rand01()) << (float)rand01() << (float)(0.1*rand01())
+		    << (float)(100.*rand01()) << (float)rand01()
+		    // NGC, IC, M, C, B, Sh2, VdB, RCW, LDN, LBN, Cr, Mel, PGC, UGC
+		    << (i%2 ? number : 0u) << (i%5==1 ? number : 0u) << (i%11==1 ? number : 0u) << (i%13==2 ? number : 0u)
+		    << (i%17==3 ? number : 0u) << (i%19==4 ? number : 0u) << (i%23==5 ? number : 0u) << (i%29==6 ? number : 0u)
+		    << (i%31==7 ? number : 0u) << (i%37==8 ? number : 0u) << (i%41==9 ? number : 0u) << (i%43==10 ? number : 0u)
+		    << (i%3==1 ? number : 0u) << (i%47==11 ? number : 0u)
+		    << (i%5==4 ? designation : QString())
+		    << (i%53==12 ? number : 0u) << (i%59==13 ? number : 0u)
+		    << (i%5==0 ? designation : ownDesignation) << (i%5==1 ? designation : QString())
+		    << (i%5==2 ? designation : QString()) << (i%5==3 ? designation : QString());
+	}
+
+	// The DSO as read from the catalog by NebulaMgr
+	nebulae.clear();
+	QDataStream in(raw);
+	in.setVersion(QDataStream::Qt_5_2);
+	QString readVersion, readEdition;
+	in >> readVersion >> readEdition;
+	while (!in.atEnd())
+	{
+		NebulaP n = NebulaP(new Nebula);
+		n->readDSO(in);
+		nebulae.append(n);
+	}
+
+	// Without the size prefix of qCompress(), as zlib data
+	const QString path = dir.filePath(name);
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly))
+		return QString();
+	file.write(qCompress(raw).mid(4));
+	return path;
+}
+
+void TestDsoCatalogStore::initTestCase()
+{
+	QVERIFY(dir.isValid());
+	catalogPath = writeCatalog("catalog.dat", CATALOG_VERSION);
+	QVERIFY(!catalogPath.isEmpty());
+	QCOMPARE(nebulae.size(), NR_OF_DSO);
+	store = DsoCatalogStore::convert(catalogPath, CATALOG_VERSION);
+	QVERIFY(!store.isEmpty());
+}
+
+void TestDsoCatalogStore::testRoundTrip()
+{
+	DsoCatalogStore s;
+	QVERIFY(s.openData(store));
+	QVERIFY(s.isOpen());
+	QCOMPARE(s.size(), NR_OF_DSO);
+	QCOMPARE(s.getCatalogVersion(), QString(CATALOG_VERSION));
+	QCOMPARE(s.getCatalogEdition(), QString("test"));
+	QVERIFY(s.matchesCatalog(catalogPath));
+
+	int withoutID = 0;
+	for (int r=0;r<NR_OF_DSO;++r)
+	{
+		const Nebula& a = *nebulae.at(r);
+		const NebulaP b = s.createNebula(r);
+		QCOMPARE(b->DSO_nb, a.DSO_nb);
+		QCOMPARE(b->bMag, a.bMag);
+		QCOMPARE(b->vMag, a.vMag);
+		QCOMPARE((int)b->nType, (int)a.nType);
+		QCOMPARE(b->mTypeString, a.mTypeString);
+		QCOMPARE(b->majorAxisSize, a.majorAxisSize);
+		QCOMPARE(b->minorAxisSize, a.minorAxisSize);
+		QCOMPARE(b->orientationAngle, a.orientationAngle);
+		QCOMPARE(b->redshift, a.redshift);
+		QCOMPARE(b->redshiftErr, a.redshiftErr);
+		QCOMPARE(b->parallax, a.parallax);
+		QCOMPARE(b->parallaxErr, a.parallaxErr);
+		QCOMPARE(b->oDistance, a.oDistance);
+		QCOMPARE(b->oDistanceErr, a.oDistanceErr);
+		QCOMPARE(b->NGC_nb, a.NGC_nb);
+		QCOMPARE(b->IC_nb, a.IC_nb);
+		QCOMPARE(b->M_nb, a.M_nb);
+		QCOMPARE(b->C_nb, a.C_nb);
+		QCOMPARE(b->B_nb, a.B_nb);
+		QCOMPARE(b->Sh2_nb, a.Sh2_nb);
+		QCOMPARE(b->VdB_nb, a.VdB_nb);
+		QCOMPARE(b->RCW_nb, a.RCW_nb);
+		QCOMPARE(b->LDN_nb, a.LDN_nb);
+		QCOMPARE(b->LBN_nb, a.LBN_nb);
+		QCOMPARE(b->Cr_nb, a.Cr_nb);
+		QCOMPARE(b->Mel_nb, a.Mel_nb);
+		QCOMPARE(b->PGC_nb, a.PGC_nb);
+		QCOMPARE(b->UGC_nb, a.UGC_nb);
+		QCOMPARE(b->Ced_nb, a.Ced_nb);
+		QCOMPARE(b->Arp_nb, a.Arp_nb);
+		QCOMPARE(b->VV_nb, a.VV_nb);
+		QCOMPARE(b->PK_nb, a.PK_nb);
+		QCOMPARE(b->PNG_nb, a.PNG_nb);
+		QCOMPARE(b->SNRG_nb, a.SNRG_nb);
+		QCOMPARE(b->ACO_nb, a.ACO_nb);
+		QCOMPARE(b->withoutID, a.withoutID);
+		for (int k=0;k<3;++k)
+			QVERIFY(b->XYZ[k]==a.XYZ[k]);
+		QVERIFY(b->getRegion()->contains(a.XYZ));
+
+		// The fields read without the Nebula object
+		QCOMPARE(s.getDsoNumber(r), a.DSO_nb);
+		QCOMPARE(s.getBMagnitude(r), a.bMag);
+		QCOMPARE(s.getVMagnitude(r), a.vMag);
+		QCOMPARE(s.getMajorAxisSize(r), a.majorAxisSize);
+		QCOMPARE((int)s.getType(r), (int)a.nType);
+		QCOMPARE(static_cast<int>(s.getCatalogGroup(r)), static_cast<int>(a.getCatalogGroup()));
+		QCOMPARE(s.getCatalogNumber(r, Nebula::CatNGC), a.NGC_nb);
+		QCOMPARE(s.getCatalogNumber(r, Nebula::CatPGC), a.PGC_nb);
+		QCOMPARE(s.getCatalogNumber(r, Nebula::CatPK), 0u);
+		QCOMPARE(s.getCatalogString(r, Nebula::CatPK), a.PK_nb);
+		QCOMPARE(s.getCatalogString(r, Nebula::CatCed), a.Ced_nb);
+		QCOMPARE(s.getCatalogString(r, Nebula::CatNGC), QString());
+		if (a.withoutID)
+		{
+			++withoutID;
+			QCOMPARE(static_cast<int>(s.getCatalogGroup(r)), 0);
+		}
+	}
+	QVERIFY(withoutID>0);
+
+	// The same store from a file
+	const QString path = dir.filePath("dso.store");
+	QVERIFY(DsoCatalogStore::write(path, store));
+	DsoCatalogStore mapped;
+	QVERIFY(mapped.open(path));
+	QCOMPARE(mapped.size(), NR_OF_DSO);
+	QCOMPARE(mapped.createNebula(NR_OF_DSO-1)->PK_nb, nebulae.last()->PK_nb);
+	QVERIFY(mapped.createNebula(NR_OF_DSO-1)->XYZ==nebulae.last()->XYZ);
+	mapped.close();
+	QVERIFY(!mapped.isOpen());
+}
+
+void TestDsoCatalogStore::testStringPool()
+{
+	// The designations shared by several DSO are stored once.
+	for (int i=0;i<5;++i)
+	{
+		const QString designation = QString::fromUtf8(sharedDesignations[i]);
+		int users = 0;
+		foreach (const NebulaP& n, nebulae)
+		{
+			if (n->Ced_nb==designation || n->PK_nb==designation || n->PNG_nb==designation || n->SNRG_nb==designation || n->ACO_nb==designation)
+				++users;
+		}
+		QVERIFY(users>1);
+		QCOMPARE(store.count(QByteArray(sharedDesignations[i])), 1);
+	}
+	QCOMPARE(store.count(QByteArray("SBb")), 1);
+
+	// Non ASCII designations are kept.
+	DsoCatalogStore s;
+	QVERIFY(s.openData(store));
+	int found = 0;
+	for (int r=0;r<NR_OF_DSO;++r)
+	{
+		if (s.getCatalogString(r, Nebula::CatCed)==QString::fromUtf8(sharedDesignations[4]))
+			++found;
+	}
+	QVERIFY(found>0);
+}
+
+struct RecordCollector
+{
+	RecordCollector(const DsoCatalogStore& astore) : store(astore) {;}
+	void operator()(int element)
+	{
+		records.append(store.getElementRecord(element));
+	}
+	const DsoCatalogStore& store;
+	QVector<int> records;
+};
+
+void TestDsoCatalogStore::testIndex()
+{
+	DsoCatalogStore s;
+	QVERIFY(s.openData(store));
+	StelSphericalIndex index;
+	QVERIFY(s.setupIndex(index));
+	QVERIFY(index.isCompact());
+	QVERIFY(!index.hasFlatObjects());
+	QCOMPARE(index.getFlatElementCount(), NR_OF_DSO);
+
+	// Each record is one element, at its position.
+	QVector<bool> seen(NR_OF_DSO, false);
+	for (int e=0;e<NR_OF_DSO;++e)
+	{
+		const int r = s.getElementRecord(e);
+		QVERIFY(r>=0 && r<NR_OF_DSO);
+		QVERIFY(!seen.at(r));
+		seen[r] = true;
+		QVERIFY(index.getFlatPoint(e)==nebulae.at(r)->XYZ);
+	}
+
+	qsrand(1234);
+	for (int p=0;p<20;++p)
+	{
+		Vec3d v(2.*rand01()-1., 2.*rand01()-1., 2.*rand01()-1.);
+		v.normalize();
+
+		// The records in a cap are found by the index.
+		const SphericalCap cap(v, std::cos(0.1+0.05*p));
+		RecordCollector func(s);
+		index.processPointIndicesInRegion(&cap, func);
+		QVector<int> expected;
+		int nearest = 0;
+		for (int r=0;r<NR_OF_DSO;++r)
+		{
+			if (cap.contains(nebulae.at(r)->XYZ))
+				expected.append(r);
+			if (nebulae.at(r)->XYZ*v > nebulae.at(nearest)->XYZ*v)
+				nearest = r;
+		}
+		std::sort(func.records.begin(), func.records.end());
+		QCOMPARE(func.records, expected);
+
+		QVector<StelSphericalIndex::Neighbour> neighbours;
+		index.findNearest(v, 3, -2., neighbours);
+		QCOMPARE(neighbours.size(), 3);
+		QCOMPARE(s.getElementRecord(neighbours.first().index), nearest);
+		QVERIFY(neighbours.first().obj.isNull());
+	}
+}
+
+void TestDsoCatalogStore::testVersionMismatch()
+{
+	const QString path = writeCatalog("catalog-3.1.dat", "3.1");
+	QVERIFY(!path.isEmpty());
+	QVERIFY(DsoCatalogStore::convert(path, CATALOG_VERSION).isEmpty());
+	QVERIFY(DsoCatalogStore::convert(dir.filePath("missing.dat"), CATALOG_VERSION).isEmpty());
+
+	// The store does not match a missing catalog.
+	DsoCatalogStore s;
+	QVERIFY(s.openData(store));
+	QVERIFY(!s.matchesCatalog(dir.filePath("missing.dat")));
+}
+
+void TestDsoCatalogStore::testTruncated()
+{
+	QList<int> sizes;
+	sizes << 0 << 8 << OFFSET_POOL_SIZE << 127 << 128 << store.size()/2 << store.size()-1;
+	foreach (int size, sizes)
+	{
+		DsoCatalogStore s;
+		QVERIFY2(!s.openData(store.left(size)), qPrintable(QString("size %1").arg(size)));
+		QVERIFY(!s.isOpen());
+		QCOMPARE(s.size(), 0);
+	}
+
+	// A truncated file is closed.
+	const QString path = dir.filePath("truncated.store");
+	QVERIFY(DsoCatalogStore::write(path, store.left(store.size()-1)));
+	DsoCatalogStore s;
+	QVERIFY(!s.open(path));
+	QVERIFY(!s.isOpen());
+}
+
+void TestDsoCatalogStore::checkRejected(const QByteArray& data, int offset, quint64 value, int size)
+{
+	QByteArray corrupted = data;
+	uchar* p = reinterpret_cast<uchar*>(corrupted.data())+offset;
+	if (size==8)
+		qToLittleEndian<quint64>(value, p);
+	else
+		qToLittleEndian<quint32>((quint32)value, p);
+	DsoCatalogStore s;
+	QVERIFY2(!s.openData(corrupted), qPrintable(QString("offset %1 value %2").arg(offset).arg(value)));
+	QVERIFY(!s.isOpen());
+}
+
+void TestDsoCatalogStore::testCorrupted()
+{
+	const uchar* data = reinterpret_cast<const uchar*>(store.constData());
+	const quint64 size = store.size();
+
+	QByteArray badMagic = store;
+	badMagic[0] = badMagic.at(0) ^ 0x10;
+	DsoCatalogStore s;
+	QVERIFY(!s.openData(badMagic));
+
+	checkRejected(store, OFFSET_VERSION, qFromLittleEndian<quint32>(data+OFFSET_VERSION)+1, 4);
+	checkRejected(store, OFFSET_NR_OF_COLUMNS, qFromLittleEndian<quint32>(data+OFFSET_NR_OF_COLUMNS)+1, 4);
+	checkRejected(store, OFFSET_NR_OF_RECORDS, 0x80000000u, 4);
+	checkRejected(store, OFFSET_NR_OF_NODES, 0, 4);
+	checkRejected(store, OFFSET_NR_OF_NODES, 0xffffffffu, 4);
+
+	// The sections out of the file, including offsets which overflow
+	QList<int> sections;
+	sections << OFFSET_POSITIONS << OFFSET_TRIANGLES << OFFSET_COLUMNS << OFFSET_NODES << OFFSET_ELEMENTS << OFFSET_POOL;
+	foreach (int offset, sections)
+	{
+		checkRejected(store, offset, size, 8);
+		checkRejected(store, offset, size-2, 8);
+		checkRejected(store, offset, Q_UINT64_C(0xffffffffffffffff), 8);
+	}
+	checkRejected(store, OFFSET_POOL_SIZE, 0, 8);
+	checkRejected(store, OFFSET_POOL_SIZE, qFromLittleEndian<quint64>(data+OFFSET_POOL_SIZE)+1, 8);
+
+	// The record of an element out of range
+	const quint64 elements = qFromLittleEndian<quint64>(data+OFFSET_ELEMENTS);
+	checkRejected(store, (int)elements, NR_OF_DSO, 4);
+	checkRejected(store, (int)elements+4*(NR_OF_DSO-1), 0xffffffffu, 4);
+
+	// The pool must end with a zero.
+	QByteArray badPool = store;
+	badPool[badPool.size()-1] = 'x';
+	QVERIFY(!s.openData(badPool));
+
+	// The unchanged store is still valid.
+	QVERIFY(s.openData(store));
+}
@@ -0,0 +1,55 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _TESTDSOCATALOGSTORE_HPP_
+#define _TESTDSOCATALOGSTORE_HPP_
+
+#include <QObject>
+#include <QtTest>
+#include <QByteArray>
+#include <QTemporaryDir>
+#include <QVector>
+
+#include "DsoCatalogStore.hpp"
+
+class TestDsoCatalogStore : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void testRoundTrip();
+	void testStringPool();
+	void testIndex();
+	void testVersionMismatch();
+	void testTruncated();
+	void testCorrupted();
+private:
+	//! Write a catalog.dat of the given version with random DSO, and read them in @em nebulae.
+	QString writeCatalog(const QString& name, const QString& version);
+	//! Check that the header and sections of a store are rejected once the field at @em offset is changed.
+	void checkRejected(const QByteArray& store, int offset, quint64 value, int size);
+
+	QTemporaryDir dir;
+	QString catalogPath;
+	QByteArray store;
+	//! The DSO of the catalog, as read by NebulaMgr without a store.
+	QVector<NebulaP> nebulae;
+};
+
+#endif // _TESTDSOCATALOGSTORE_HPP_
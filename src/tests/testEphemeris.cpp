@@ -23,12 +23,25 @@
 #include <QVariantList>
 #include <QString>
 #include <QtGlobal>
+#include <cmath>
 
 #include "StelFileMgr.hpp"
 #include "EphemWrapper.hpp"
+#include "EphemContext.hpp"
 #include "vsop87.h"
+#include "elp82b.h"
+#include "ChebyshevEphemCache.hpp"
 #include "de430.hpp"
 #include "de431.hpp"
+#include "jpleph.h"
+#include "Orbit.hpp"
+
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <cstring>
 
 QTEST_GUILESS_MAIN(TestEphemeris)
 
@@ -40,6 +53,54 @@ QTEST_GUILESS_MAIN(TestEphemeris)
 // Please update them if you changed StelCore::matJ2000ToVsop87 variable
 //
 
+// Write a small DE430 like file with random coefficients, with the layout of the
+// JPL binary files: a header record, a record of constants, then the data records.
+static bool writeSyntheticEphemeris(const QString& path, int nrOfRecords)
+{
+	const double start = 2451536.5, step = 32.;
+	// Number of sub-intervals of the 11 bodies, 12 Chebyshev coefficients each.
+	const quint32 nrOfSubIntervals[11] = {4, 2, 2, 1, 1, 1, 1, 1, 1, 8, 2};
+	quint32 ipt[13][3] = {{0}};
+	quint32 ncoeff = 2;
+	for (int i=0; i<11; ++i)
+	{
+		ipt[i][0] = ncoeff+1;
+		ipt[i][1] = 12;
+		ipt[i][2] = nrOfSubIntervals[i];
+		ncoeff += 12*3*nrOfSubIntervals[i];
+	}
+	const int recsize = ncoeff*sizeof(double);
+
+	QByteArray header(recsize, '\0');
+	const QByteArray title = QByteArray("JPL Planetary Ephemeris DE430/LE430").leftJustified(84*3, ' ');
+	header.replace(0, title.size(), title);
+	const double end = start + nrOfRecords*step;
+	const quint32 ncon = 400, version = 430;
+	const double au = 149597870.7, emrat = 81.3006;
+	char* h = header.data() + 2652;
+	memcpy(h, &start, 8); memcpy(h+8, &end, 8); memcpy(h+16, &step, 8);
+	memcpy(h+24, &ncon, 4); memcpy(h+28, &au, 8); memcpy(h+36, &emrat, 8);
+	memcpy(h+44, ipt, 12*3*4);
+	memcpy(h+188, &version, 4);
+	memcpy(h+192, ipt[12], 3*4);
+
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+	file.write(header);
+	file.write(QByteArray(recsize, '\0'));   // constants
+	QVector<double> record(ncoeff);
+	for (int r=0; r<nrOfRecords; ++r)
+	{
+		record[0] = start + r*step;
+		record[1] = start + (r+1)*step;
+		for (quint32 i=2; i<ncoeff; ++i)
+			record[i] = (qrand()%2000001-1000000)*1000.;
+		file.write((const char*)record.constData(), recsize);
+	}
+	return true;
+}
+
 void TestEphemeris::initTestCase()
 {
 	StelFileMgr::init();
@@ -1233,6 +1294,380 @@ void TestEphemeris::testNeptuneHeliocentricEphemerisVsop87()
 	}
 }
 
+void TestEphemeris::testChebyshevCacheVsop87()
+{
+	const double accuracy = 1E-09;
+	ChebyshevEphemCache cache(&GetVsop87FullCoor, 8, 16., 16);
+	cache.setAccuracy(accuracy);
+	double xyz[3], ref[8*3];
+	// Go back and forth over 200 years, with steps which are not a fraction of the windows.
+	for (double jd=2415020.5; jd<2488069.5; jd+=37.123)
+	{
+		GetVsop87FullCoor(jd, ref);
+		for (int planet_id=0; planet_id<8; ++planet_id)
+		{
+			cache.getCoor(jd, planet_id, xyz);
+			const double error = std::sqrt((xyz[0]-ref[planet_id*3])*(xyz[0]-ref[planet_id*3])
+						     + (xyz[1]-ref[planet_id*3+1])*(xyz[1]-ref[planet_id*3+1])
+						     + (xyz[2]-ref[planet_id*3+2])*(xyz[2]-ref[planet_id*3+2]));
+			QVERIFY2(error <= accuracy, QString("jd=%1 planet=%2 error=%3").arg(jd, 0, 'f', 5).arg(planet_id).arg(error).toUtf8());
+		}
+	}
+	QVERIFY(cache.getNrOfWindows() > 0);
+	cache.clear();
+	QCOMPARE(cache.getNrOfWindows(), 0);
+}
+
+void TestEphemeris::testChebyshevCacheElp82b()
+{
+	const double accuracy = 1E-11;
+	ChebyshevEphemCache cache(&GetElp82bFullCoor, 1, 8., 16);
+	cache.setAccuracy(accuracy);
+	cache.setMaxNrOfWindows(16);
+	double xyz[3], ref[3];
+	for (double jd=2451545.0; jd>2451545.0-3650.; jd-=0.731)
+	{
+		GetElp82bFullCoor(jd, ref);
+		cache.getCoor(jd, 0, xyz);
+		const double error = std::sqrt((xyz[0]-ref[0])*(xyz[0]-ref[0]) + (xyz[1]-ref[1])*(xyz[1]-ref[1]) + (xyz[2]-ref[2])*(xyz[2]-ref[2]));
+		QVERIFY2(error <= accuracy, QString("jd=%1 error=%2").arg(jd, 0, 'f', 5).arg(error).toUtf8());
+	}
+	QVERIFY(cache.getNrOfWindows() <= 16);
+}
+
+static int nrOfVsop87Evaluations = 0;
+
+static void countedVsop87FullCoor(double jd, double* xyz)
+{
+	++nrOfVsop87Evaluations;
+	GetVsop87FullCoor(jd, xyz);
+}
+
+void TestEphemeris::testChebyshevCacheUsage()
+{
+	const double accuracy = 1E-09;
+	ChebyshevEphemCache cache(&countedVsop87FullCoor, 8, 16., 16);
+	cache.setAccuracy(accuracy);
+	ChebyshevEphemCache::Usage usage;
+	double xyz[3], ref[8*3];
+
+	// 20 days per frame, each planet at its own light time: a window is never requested
+	// 17 times, the cache declines all requests and never evaluates the theory.
+	nrOfVsop87Evaluations = 0;
+	double jd = 2451545.0;
+	for (int frame=0; frame<500; ++frame, jd+=20.)
+		for (int planet_id=0; planet_id<8; ++planet_id)
+			QVERIFY(!cache.getCoor(jd-0.001*planet_id, planet_id, xyz, usage));
+	QCOMPARE(nrOfVsop87Evaluations, 0);
+	QCOMPARE(cache.getNrOfWindows(), 0);
+
+	// A quarter of a day per frame: the cache is used from the 17th request of the first
+	// window on, and a fit costs much less than evaluating the theory for each request.
+	int nrOfRequests = 0;
+	for (int frame=0; frame<2000; ++frame, jd+=0.25)
+	{
+		GetVsop87FullCoor(jd, ref);
+		for (int planet_id=0; planet_id<8; ++planet_id, ++nrOfRequests)
+		{
+			if (!cache.getCoor(jd, planet_id, xyz, usage))
+			{
+				QVERIFY(nrOfRequests<17);
+				continue;
+			}
+			const double error = std::sqrt((xyz[0]-ref[planet_id*3])*(xyz[0]-ref[planet_id*3])
+						     + (xyz[1]-ref[planet_id*3+1])*(xyz[1]-ref[planet_id*3+1])
+						     + (xyz[2]-ref[planet_id*3+2])*(xyz[2]-ref[planet_id*3+2]));
+			QVERIFY2(error <= accuracy, QString("jd=%1 planet=%2 error=%3").arg(jd, 0, 'f', 5).arg(planet_id).arg(error).toUtf8());
+		}
+	}
+	QVERIFY(nrOfVsop87Evaluations>0);
+	QVERIFY(nrOfVsop87Evaluations*4 < nrOfRequests);
+
+	// Back to fast: the first window is still used, the next ones are declined again.
+	const int nrOfEvaluations = nrOfVsop87Evaluations;
+	jd += 1000.;
+	QVERIFY(cache.getCoor(jd, 0, xyz, usage));
+	for (int frame=1; frame<100; ++frame)
+		QVERIFY(!cache.getCoor(jd+20.*frame, 0, xyz, usage));
+	QVERIFY(nrOfVsop87Evaluations-nrOfEvaluations <= 17*2*6);
+}
+
+void TestEphemeris::testChebyshevCacheDeterminism()
+{
+	ChebyshevEphemCache cache(&GetVsop87FullCoor, 8, 16., 16);
+	cache.setAccuracy(1E-09);
+	double xyz[3], ref[3];
+
+	// A slow caller fits the window...
+	ChebyshevEphemCache::Usage slowUsage;
+	const double jd = 2451545.0 + 3.3;
+	for (int i=0; i<40; ++i)
+		cache.getCoor(jd+0.1*i, 2, xyz, slowUsage);
+	QVERIFY(cache.getCoor(jd, 2, ref, slowUsage));
+
+	// ...which is not used by a fast caller, whose results must not depend on the other callers.
+	ChebyshevEphemCache::Usage fastUsage;
+	QVERIFY(!cache.getCoor(jd, 2, xyz, fastUsage));
+	for (int i=1; i<100; ++i)
+		QVERIFY(!cache.getCoor(jd+20.*i, 2, xyz, fastUsage));
+
+	// Once the cache pays off for a caller, it gets the same fit as the others.
+	ChebyshevEphemCache::Usage otherUsage;
+	for (int i=0; i<17; ++i)
+		cache.getCoor(jd+0.01*i, 2, xyz, otherUsage);
+	QVERIFY(cache.getCoor(jd, 2, xyz, otherUsage));
+	QCOMPARE(xyz[0], ref[0]);
+	QCOMPARE(xyz[1], ref[1]);
+	QCOMPARE(xyz[2], ref[2]);
+	cache.getCoor(jd, 2, xyz);
+	QCOMPARE(xyz[0], ref[0]);
+}
+
+void TestEphemeris::testChebyshevCacheAccuracyFallback()
+{
+	// No fit can meet this bound: the theory has to be used directly.
+	ChebyshevEphemCache cache(&GetVsop87FullCoor, 8, 16., 16);
+	cache.setAccuracy(1E-30);
+	QTest::ignoreMessage(QtWarningMsg, "ChebyshevEphemCache: no fit of 0.25 days meets the accuracy of 1e-30 AU, the theory is used directly in these windows");
+	double xyz[3], ref[8*3];
+	for (double jd=2451545.0; jd<2451545.0+5.; jd+=0.37)
+	{
+		GetVsop87FullCoor(jd, ref);
+		cache.getCoor(jd, 0, xyz);
+		QCOMPARE(xyz[0], ref[0]);
+		QCOMPARE(xyz[1], ref[1]);
+		QCOMPARE(xyz[2], ref[2]);
+	}
+}
+
+// A body of each theory, and the two bodies built from several theories.
+static const EphemContext::Body contextTestBodies[] = {
+	EphemContext::Mercury, EphemContext::Earth, EphemContext::Pluto, EphemContext::Moon,
+	EphemContext::Deimos, EphemContext::Europa, EphemContext::Hyperion, EphemContext::Umbriel
+};
+
+static QVector<double> computeContextSeries(EphemContext& context, const QVector<double>& dates)
+{
+	QVector<double> xyz;
+	QVector<double> bodyXyz(dates.size()*3);
+	for (unsigned int b=0; b<sizeof(contextTestBodies)/sizeof(contextTestBodies[0]); ++b)
+	{
+		context.computeBatch(contextTestBodies[b], dates.constData(), dates.size(), bodyXyz.data());
+		xyz += bodyXyz;
+	}
+	return xyz;
+}
+
+// Thread computing the positions with its own context.
+class EphemContextThread : public QThread
+{
+public:
+	EphemContextThread(const QVector<double>& dates) : dates(dates) {}
+	void run() Q_DECL_OVERRIDE
+	{
+		EphemContext context;
+		result = computeContextSeries(context, dates);
+	}
+	QVector<double> dates, result;
+};
+
+void TestEphemeris::testEphemContext()
+{
+	// Steps of a few hours, like the animation of the sky, with a jump now and then.
+	QVector<double> dates;
+	double jd = 2451545.0;
+	for (int i=0; i<2000; ++i)
+	{
+		jd += (i%250==249) ? 3000. : 0.23;
+		dates << jd;
+	}
+
+	// Io to Callisto are within 0.02 AU of Jupiter.
+	EphemContext context;
+	double xyz[3];
+	context.computeCoordinates(EphemContext::Callisto, jd, xyz);
+	const double r = std::sqrt(xyz[0]*xyz[0]+xyz[1]*xyz[1]+xyz[2]*xyz[2]);
+	QVERIFY(r>0.01 && r<0.02);
+
+	for (int cache=0; cache<2; ++cache)
+	{
+		EphemContext::setChebyshevCache(cache==1, 1e-9);
+		EphemContext serialContext;
+		const QVector<double> expected = computeContextSeries(serialContext, dates);
+
+		// Contexts used at the same time give the results of a context used alone.
+		QVector<EphemContextThread*> threads;
+		for (int t=0; t<4; ++t)
+		{
+			threads << new EphemContextThread(dates);
+			threads.last()->start();
+		}
+		foreach (EphemContextThread* thread, threads)
+		{
+			thread->wait();
+			QVERIFY(thread->result==expected);
+			delete thread;
+		}
+
+		// Fast time, few requests per window: the results are the same before and after
+		// another context has fitted the windows of these dates.
+		QVector<double> fastDates;
+		for (int i=0; i<200; ++i)
+			fastDates << 2460000.5+20.*i;
+		EphemContext fastContext;
+		const QVector<double> fastExpected = computeContextSeries(fastContext, fastDates);
+		QVector<double> slowDates;
+		for (double d=fastDates.first(); d<=fastDates.last(); d+=0.25)
+			slowDates << d;
+		EphemContext slowContext;
+		computeContextSeries(slowContext, slowDates);
+		EphemContext otherFastContext;
+		QVERIFY(computeContextSeries(otherFastContext, fastDates)==fastExpected);
+	}
+	EphemContext::setChebyshevCache(false, 1e-9);
+}
+
+// A job of the positions benchmark, scheduled like the jobs of SolarSystem::computePositions():
+// a planet followed by its satellites sharing an EphemContext, or a minor body on a Keplerian orbit.
+struct PositionBenchmarkJob
+{
+	QVector<EphemContext::Body> bodies;
+	QSharedPointer<EphemContext> context;
+	QSharedPointer<CometOrbit> orbit;
+	const double* jde;
+	double xyz[3];
+};
+
+static void computePositionBenchmarkJob(PositionBenchmarkJob& job)
+{
+	if (job.orbit)
+		job.orbit->positionAtTimevInVSOP87Coordinates(*job.jde, job.xyz);
+	else
+	{
+		foreach (EphemContext::Body body, job.bodies)
+			job.context->computeCoordinates(body, *job.jde, job.xyz);
+	}
+}
+
+void TestEphemeris::benchmarkPositionJobs_data()
+{
+	QTest::addColumn<int>("minorBodies");
+	QTest::addColumn<int>("threads");
+	const int minorBodies[] = {0, 1000, 100000};
+	const int threads[] = {1, 2, 4, 8};
+	for (int m=0; m<3; ++m)
+		for (int t=0; t<4; ++t)
+			QTest::newRow(qPrintable(QString("%1 minor bodies, %2 threads").arg(minorBodies[m]).arg(threads[t]))) << minorBodies[m] << threads[t];
+}
+
+void TestEphemeris::benchmarkPositionJobs()
+{
+	QFETCH(int, minorBodies);
+	QFETCH(int, threads);
+
+	double jde = 2457900.5;
+	QVector<PositionBenchmarkJob> jobs;
+	int nbBodies = 0;
+	const QVector<EphemContext::Body> families[] = {
+		QVector<EphemContext::Body>() << EphemContext::Mercury,
+		QVector<EphemContext::Body>() << EphemContext::Venus,
+		QVector<EphemContext::Body>() << EphemContext::Earth << EphemContext::Moon,
+		QVector<EphemContext::Body>() << EphemContext::Mars << EphemContext::Phobos << EphemContext::Deimos,
+		QVector<EphemContext::Body>() << EphemContext::Jupiter << EphemContext::Io << EphemContext::Europa << EphemContext::Ganymede << EphemContext::Callisto,
+		QVector<EphemContext::Body>() << EphemContext::Saturn << EphemContext::Mimas << EphemContext::Enceladus << EphemContext::Tethys << EphemContext::Dione
+					      << EphemContext::Rhea << EphemContext::Titan << EphemContext::Hyperion << EphemContext::Iapetus,
+		QVector<EphemContext::Body>() << EphemContext::Uranus << EphemContext::Miranda << EphemContext::Ariel << EphemContext::Umbriel
+					      << EphemContext::Titania << EphemContext::Oberon,
+		QVector<EphemContext::Body>() << EphemContext::Neptune,
+		QVector<EphemContext::Body>() << EphemContext::Pluto
+	};
+	for (unsigned int f=0; f<sizeof(families)/sizeof(families[0]); ++f)
+	{
+		PositionBenchmarkJob job;
+		job.bodies = families[f];
+		job.context = QSharedPointer<EphemContext>(new EphemContext());
+		job.jde = &jde;
+		jobs << job;
+		nbBodies += job.bodies.size();
+	}
+	for (int i=0; i<minorBodies; ++i)
+	{
+		const double q = 1.+0.0004*(i%100000);
+		const double e = 0.002*(i%450);
+		const double a = q/(1.-e);
+		PositionBenchmarkJob job;
+		job.orbit = QSharedPointer<CometOrbit>(new CometOrbit(q, e, 0.001*(i%3000), 0.01*(i%628), 0.03*(i%209), 2457000.5+(i%3650),
+								      1000., 0.01720209895/(a*std::sqrt(a)), 0., 0., 0.));
+		job.jde = &jde;
+		jobs << job;
+		nbBodies++;
+	}
+
+	const int maxThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+	QThreadPool::globalInstance()->setMaxThreadCount(threads);
+	// One frame per hour of animation, each frame waits for all the positions.
+	const int nbFrames = 10;
+	qint64 nbPositions = 0;
+	QElapsedTimer timer;
+	timer.start();
+	QBENCHMARK {
+		for (int frame=0; frame<nbFrames; ++frame)
+		{
+			jde += 1./24.;
+			QtConcurrent::blockingMap(jobs, computePositionBenchmarkJob);
+			nbPositions += nbBodies;
+		}
+	}
+	const qint64 elapsed = timer.nsecsElapsed();
+	QThreadPool::globalInstance()->setMaxThreadCount(maxThreadCount);
+	QVERIFY(elapsed>0);
+	qDebug() << threads << "threads," << nbBodies << "bodies:" << qRound64(nbPositions*1e9/elapsed) << "positions per second";
+}
+
+void TestEphemeris::benchmarkChebyshevCache_data()
+{
+	QTest::addColumn<double>("daysPerFrame");
+	QTest::addColumn<bool>("cache");
+	const double daysPerFrame[] = {1./24., 1., 10., 100., 1000.};
+	for (int d=0; d<5; ++d)
+		for (int cache=0; cache<2; ++cache)
+			QTest::newRow(qPrintable(QString("%1 days per frame, %2").arg(daysPerFrame[d]).arg(cache ? "cache" : "no cache"))) << daysPerFrame[d] << (cache==1);
+}
+
+void TestEphemeris::benchmarkChebyshevCache()
+{
+	QFETCH(double, daysPerFrame);
+	QFETCH(bool, cache);
+
+	// The planets and the Moon, each one at its own light time, as in SolarSystem::computePositions().
+	const EphemContext::Body bodies[] = {
+		EphemContext::Mercury, EphemContext::Venus, EphemContext::Earth, EphemContext::Mars,
+		EphemContext::Jupiter, EphemContext::Saturn, EphemContext::Uranus, EphemContext::Neptune, EphemContext::Moon
+	};
+	const int nbBodies = sizeof(bodies)/sizeof(bodies[0]);
+	EphemContext::setChebyshevCache(cache, 1e-9);
+	EphemContext context;
+	const int nbFrames = 2000;
+	double jde = 2457900.5;
+	qint64 nbPositions = 0;
+	double xyz[3];
+	QElapsedTimer timer;
+	timer.start();
+	QBENCHMARK {
+		for (int frame=0; frame<nbFrames; ++frame)
+		{
+			jde += daysPerFrame;
+			for (int b=0; b<nbBodies; ++b)
+				context.computeCoordinates(bodies[b], jde-0.002*b, xyz);
+			nbPositions += nbBodies;
+		}
+	}
+	const qint64 elapsed = timer.nsecsElapsed();
+	EphemContext::setChebyshevCache(false, 1e-9);
+	QVERIFY(elapsed>0);
+	qDebug() << daysPerFrame << "days per frame," << (cache ? "cache:" : "no cache:") << qRound64(nbPositions*1e9/elapsed) << "positions per second";
+}
+
 void TestEphemeris::testMercuryHeliocentricEphemerisDe430()
 {
 	if (de430FilePath.isEmpty())
@@ -1764,3 +2199,112 @@ void TestEphemeris::testNeptuneHeliocentricEphemerisDe431()
 		}
 	}
 }
+
+// Thread doing the same lookups as the main thread on a mapped ephemeris.
+class JplLookupThread : public QThread
+{
+public:
+	JplLookupThread(void* ephem, const QVector<double>& dates, const QVector<double>& expected)
+		: ephem(ephem), dates(dates), expected(expected), nrOfErrors(0) {}
+	void run() Q_DECL_OVERRIDE
+	{
+		double rrd[6];
+		for (int i=0; i<dates.size(); ++i)
+		{
+			jpl_pleph(ephem, dates.at(i), 1+i%10, 11, rrd, 0);
+			if (rrd[0]!=expected.at(i*3) || rrd[1]!=expected.at(i*3+1) || rrd[2]!=expected.at(i*3+2))
+				++nrOfErrors;
+		}
+	}
+	void* ephem;
+	QVector<double> dates, expected;
+	int nrOfErrors;
+};
+
+void TestEphemeris::testJplMappedReader()
+{
+	QVERIFY(tempDir.isValid());
+	syntheticEphemPath = tempDir.path() + "/synthetic.430";
+	QVERIFY(writeSyntheticEphemeris(syntheticEphemPath, 4000));
+	const QByteArray path = QFile::encodeName(syntheticEphemPath);
+
+	void* fileEphem = jpl_init_ephemeris(path.constData(), Q_NULLPTR, Q_NULLPTR);
+	QVERIFY(fileEphem != Q_NULLPTR);
+	void* mappedEphem = jpl_init_ephemeris(path.constData(), Q_NULLPTR, Q_NULLPTR);
+	QVERIFY(mappedEphem != Q_NULLPTR);
+	QCOMPARE(jpl_map_ephemeris(mappedEphem, path.constData()), 0);
+	QVERIFY(jpl_is_mapped(mappedEphem));
+	QVERIFY(!jpl_is_mapped(fileEphem));
+
+	const double start = jpl_get_double(fileEphem, JPL_EPHEM_START_JD);
+	const double end = jpl_get_double(fileEphem, JPL_EPHEM_END_JD);
+	QVector<double> dates, expected;
+	double rrdFile[6], rrdMapped[6];
+	for (int i=0; i<2000; ++i)
+	{
+		const double jd = start + (end-start)*(qrand()%100000)/100000.;
+		const int target = 1+i%10;
+		QCOMPARE(jpl_pleph(fileEphem, jd, target, 11, rrdFile, 1), 0);
+		QCOMPARE(jpl_pleph(mappedEphem, jd, target, 11, rrdMapped, 1), 0);
+		for (int k=0; k<6; ++k)
+			QCOMPARE(rrdMapped[k], rrdFile[k]);
+		dates << jd;
+		expected << rrdFile[0] << rrdFile[1] << rrdFile[2];
+	}
+	QCOMPARE(jpl_pleph(mappedEphem, end+1., 1, 11, rrdMapped, 0), JPL_EPH_OUTSIDE_RANGE);
+
+	// The mapped ephemeris can be used from several threads at once.
+	QVector<JplLookupThread*> threads;
+	for (int t=0; t<4; ++t)
+	{
+		threads << new JplLookupThread(mappedEphem, dates, expected);
+		threads.last()->start();
+	}
+	foreach (JplLookupThread* thread, threads)
+	{
+		thread->wait();
+		QCOMPARE(thread->nrOfErrors, 0);
+		delete thread;
+	}
+
+	jpl_close_ephemeris(fileEphem);
+	jpl_close_ephemeris(mappedEphem);
+}
+
+void TestEphemeris::benchmarkJplReader_data()
+{
+	QTest::addColumn<bool>("mapped");
+	QTest::addColumn<bool>("sequential");
+	QTest::newRow("FILE random") << false << false;
+	QTest::newRow("mapped random") << true << false;
+	QTest::newRow("FILE sequential") << false << true;
+	QTest::newRow("mapped sequential") << true << true;
+}
+
+void TestEphemeris::benchmarkJplReader()
+{
+	QFETCH(bool, mapped);
+	QFETCH(bool, sequential);
+	if (syntheticEphemPath.isEmpty() || !QFile::exists(syntheticEphemPath))
+		QSKIP("synthetic ephemeris not written");
+	const QByteArray path = QFile::encodeName(syntheticEphemPath);
+	void* ephem = jpl_init_ephemeris(path.constData(), Q_NULLPTR, Q_NULLPTR);
+	QVERIFY(ephem != Q_NULLPTR);
+	if (mapped)
+		QCOMPARE(jpl_map_ephemeris(ephem, path.constData()), 0);
+
+	// Random dates jump across the whole file, sequential dates step by 6 hours,
+	// and every date is used for all planets, like SolarSystem::computePositions().
+	const double start = jpl_get_double(ephem, JPL_EPHEM_START_JD);
+	const double end = jpl_get_double(ephem, JPL_EPHEM_END_JD);
+	QVector<double> dates;
+	for (int i=0; i<2000; ++i)
+		dates << (sequential ? start + 0.25*i : start + (end-start)*(qrand()%100000)/100000.);
+	double rrd[6];
+	QBENCHMARK {
+		foreach (double jd, dates)
+			for (int target=1; target<=10; ++target)
+				jpl_pleph(ephem, jd, target, 11, rrd, 0);
+	}
+	jpl_close_ephemeris(ephem);
+}
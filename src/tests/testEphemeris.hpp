@@ -22,6 +22,7 @@
 
 #include <QObject>
 #include <QTest>
+#include <QTemporaryDir>
 
 class TestEphemeris : public QObject
 {
@@ -37,6 +38,20 @@ private slots:
 	void testSaturnHeliocentricEphemerisVsop87();
 	void testUranusHeliocentricEphemerisVsop87();
 	void testNeptuneHeliocentricEphemerisVsop87();
+	// Chebyshev cache over VSOP87 and ELP82B
+	void testChebyshevCacheVsop87();
+	void testChebyshevCacheElp82b();
+	void testChebyshevCacheUsage();
+	void testChebyshevCacheDeterminism();
+	void testChebyshevCacheAccuracyFallback();
+	// Reentrant context of the analytic theories
+	void testEphemContext();
+	// Positions per second computed by jobs like those of SolarSystem::computePositions()
+	void benchmarkPositionJobs_data();
+	void benchmarkPositionJobs();
+	// Planets per second with and without the Chebyshev cache, at several time rates
+	void benchmarkChebyshevCache_data();
+	void benchmarkChebyshevCache();
 	// JPL DE430
 	void testMercuryHeliocentricEphemerisDe430();
 	void testVenusHeliocentricEphemerisDe430();
@@ -53,10 +68,16 @@ private slots:
 	void testSaturnHeliocentricEphemerisDe431();
 	void testUranusHeliocentricEphemerisDe431();
 	void testNeptuneHeliocentricEphemerisDe431();
+	// JPL DE reader on a synthetic file
+	void testJplMappedReader();
+	void benchmarkJplReader_data();
+	void benchmarkJplReader();
 
 private:
 	QString de430FilePath, de431FilePath;
 	QVariantList mercury, venus, mars, jupiter, saturn, uranus, neptune;
+	QTemporaryDir tempDir;
+	QString syntheticEphemPath;
 
 };
 
@@ -43,3 +43,25 @@ void TestExtinction::testBase()
 	extCls.forward(vert, &mag);
 	QVERIFY(mag==2.25);
 }
+
+void TestExtinction::testTable()
+{
+	Extinction extCls;
+	extCls.setExtinctionCoefficient(0.2f);
+	const Extinction::UndergroundExtinctionMode modes[3] = {Extinction::UndergroundExtinctionZero,
+								Extinction::UndergroundExtinctionMax,
+								Extinction::UndergroundExtinctionMirror};
+	for (int m=0;m<3;++m)
+	{
+		extCls.setUndergroundExtinctionMode(modes[m]);
+		for (int i=-1000;i<=1000;++i)
+		{
+			const float sinAlt = i*0.001f;
+			Vec3f v(std::sqrt(1.f-sinAlt*sinAlt), 0.f, sinAlt);
+			float mag=0.f;
+			extCls.forward(v, &mag);
+			QVERIFY2(std::fabs(extCls.forwardFromTable(sinAlt)-mag)<0.001f,
+				 qPrintable(QString("sinAlt=%1 mode=%2").arg(sinAlt).arg(m)));
+		}
+	}
+}
@@ -29,7 +29,8 @@ class TestExtinction : public QObject
 	Q_OBJECT
 private slots:
 	void initTestCase();
-	void testBase();	
+	void testBase();
+	void testTable();
 };
 
 #endif // _TESTEXTINCTION_HPP_
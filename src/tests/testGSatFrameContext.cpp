@@ -0,0 +1,145 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+#include <QVector>
+
+#include "tests/testGSatFrameContext.hpp"
+#include "gSatFrameContext.hpp"
+#include "SGP4Batch.hpp"
+#include "sgp4io.h"
+#include "gTime.hpp"
+#include "stdsat.h"
+
+#include <cmath>
+#include <cstring>
+
+QTEST_GUILESS_MAIN(TestGSatFrameContext)
+
+#define JD 2454732.5
+#define LATITUDE 48.85
+#define LONGITUDE 2.35
+#define ALTITUDE 35.
+
+static const Vec3d sunTopoEquPos(-1.2e8, 8.5e7, 3.7e7);
+
+void TestGSatFrameContext::testObserverPosition()
+{
+	const gSatFrameContext frame(JD, LATITUDE, LONGITUDE, ALTITUDE, sunTopoEquPos, false);
+	QVERIFY(frame.isValidFor(JD, LATITUDE, LONGITUDE, ALTITUDE));
+	QVERIFY(!frame.isValidFor(JD+1e-5, LATITUDE, LONGITUDE, ALTITUDE));
+	QVERIFY(!frame.isValidFor(JD, LATITUDE, LONGITUDE+0.1, ALTITUDE));
+	QVERIFY(!gSatFrameContext().isValidFor(0., 0., 0., 0.));
+
+	const double theta = gTime(JD).toThetaLMST(LONGITUDE*KDEG2RAD);
+	QCOMPARE(frame.getThetaLMST(), theta);
+	// The observer is on the earth ellipsoid, at the local sidereal time, and turns with the earth.
+	const Vec3d pos = frame.getObserverECIPos();
+	const double p = std::sqrt(pos[0]*pos[0]+pos[1]*pos[1]);
+	const double a = KEARTHRADIUS+ALTITUDE/1000.;
+	const double b = KEARTHRADIUS*(1.-__f)+ALTITUDE/1000.;
+	QVERIFY(std::fabs((p*p)/(a*a)+(pos[2]*pos[2])/(b*b)-1.)<1e-5);
+	QVERIFY(std::fabs(std::atan2(pos[1], pos[0])-std::atan2(std::sin(theta), std::cos(theta)))<1e-12);
+	QVERIFY(std::fabs(frame.getObserverECIVel().dot(pos))<1e-9);
+	QVERIFY(std::fabs(frame.getObserverECIVel().length()-KMFACTOR*p)<1e-12);
+	QVERIFY((frame.getSunECIPos()-sunTopoEquPos-pos).length()<1e-6);
+}
+
+void TestGSatFrameContext::testSatelliteData()
+{
+	const gSatFrameContext frame(JD, LATITUDE, LONGITUDE, ALTITUDE, sunTopoEquPos, false);
+	const Vec3d observer = frame.getObserverECIPos();
+	Vec3d up = observer;
+	up.normalize();
+
+	// A satellite above the observer is at the zenith, the range is its height.
+	const Vec3d zenithSat = observer + up*500.;
+	const Vec3d altAz = frame.computeAltAz(zenithSat);
+	QVERIFY(altAz[2]>499.9);
+	QVERIFY(std::fabs(altAz[0])<2. && std::fabs(altAz[1])<1e-9);
+	double range, rangeRate;
+	frame.computeSlantRange(zenithSat, frame.getObserverECIVel(), range, rangeRate);
+	QVERIFY(std::fabs(range-500.)<1e-9);
+	QVERIFY(std::fabs(rangeRate)<1e-12);
+
+	// A satellite beside the earth is sunlit, one behind the earth is in its shadow.
+	Vec3d sunDir = frame.getSunECIPos();
+	sunDir.normalize();
+	Vec3d side(-sunDir[1], sunDir[0], 0.);
+	side.normalize();
+	QVERIFY(frame.isSunlit(side*7000.));
+	QVERIFY(!frame.isSunlit(side*6000.));
+	QVERIFY(!frame.isSunlit(sunDir*(-7000.)));
+	QVERIFY(std::fabs(frame.computePhaseAngle(sunDir*(-7000.))-M_PI)<1e-6);
+}
+
+void TestGSatFrameContext::benchmarkUpdate_data()
+{
+	QTest::addColumn<int>("satellites");
+	QTest::addColumn<bool>("shared");
+	QTest::newRow("1000 satellites, context per satellite") << 1000 << false;
+	QTest::newRow("1000 satellites, shared context") << 1000 << true;
+	QTest::newRow("10000 satellites, context per satellite") << 10000 << false;
+	QTest::newRow("10000 satellites, shared context") << 10000 << true;
+	QTest::newRow("40000 satellites, shared context") << 40000 << true;
+}
+
+// The computations of Satellites::update() for a frame, without the objects of the program.
+void TestGSatFrameContext::benchmarkUpdate()
+{
+	QFETCH(int, satellites);
+	QFETCH(bool, shared);
+	char line1[130], line2[130];
+	std::strcpy(line1, "1 25544U 98067A   08264.51782528 -.00002182  00000-0 -11606-4 0  2927");
+	std::strcpy(line2, "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.72125391563537");
+	double startmfe, stopmfe, deltamin;
+	elsetrec base;
+	twoline2rv(line1, line2, 'c', 'm', 'i', wgs72, startmfe, stopmfe, deltamin, base);
+	SGP4Batch batch;
+	for (int i=0;i<satellites;++i)
+	{
+		elsetrec satrec;
+		sgp4init(wgs72, 'i', i, base.jdsatepoch-2433281.5, base.bstar, base.ecco+0.0001*(i%100), base.argpo+0.01*i,
+			 base.inclo+0.001*(i%500), base.mo+0.1*i, base.no*(1.-0.0001*(i%1000)), base.nodeo+0.02*i, satrec);
+		batch.append(satrec);
+	}
+
+	double jd = JD;
+	int visible = 0;
+	QBENCHMARK
+	{
+		jd += 1e-5;
+		batch.propagate(jd, true);
+		gSatFrameContext frame(jd, LATITUDE, LONGITUDE, ALTITUDE, sunTopoEquPos, false);
+		for (int i=0;i<batch.size();++i)
+		{
+			if (!shared)
+				frame = gSatFrameContext(jd, LATITUDE, LONGITUDE, ALTITUDE, sunTopoEquPos, false);
+			const Vec3d pos = batch.getPosition(i);
+			const Vec3d altAz = frame.computeAltAz(pos);
+			double range, rangeRate;
+			frame.computeSlantRange(pos, batch.getVelocity(i), range, rangeRate);
+			if (altAz[2]>0 && frame.isSunlit(pos) && frame.computePhaseAngle(pos)<M_PI)
+				visible++;
+		}
+	}
+	QVERIFY(visible>=0);
+}
@@ -0,0 +1,245 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+
+#include "tests/testKeplerBatch.hpp"
+#include "KeplerBatch.hpp"
+#include "Orbit.hpp"
+
+#include <cmath>
+
+QTEST_GUILESS_MAIN(TestKeplerBatch)
+
+// Elliptic, parabolic and hyperbolic orbits, some of them around a rotated parent.
+static CometOrbit* testCometOrbit(int i)
+{
+	const double q = 0.3 + 0.001*(i%5000);
+	const double e = (i%50==0) ? 1.0 : (i%50==1 ? 1.0 + 0.001*(i%997) : 0.002*(i%499));
+	const double a = (e==1.0) ? q : q/std::fabs(1.0-e);
+	const double n = (e==1.0) ? 0.01720209895*std::sqrt(0.5/(q*q*q)) : 0.01720209895/(a*std::sqrt(a));
+	const double parentRot = (i%7==0) ? 0.4 : 0.;
+	return new CometOrbit(q, e, 0.001*(i%3000), 0.01*(i%628), 0.03*(i%209), 2457000.5+(i%3650),
+			      1000., n, parentRot, 0.5*parentRot, 0.2*parentRot);
+}
+
+// Orbits of minor planets as in ssystem_minor.ini: all the iteration schemes of
+// EllipticalOrbit::eccentricAnomaly(), with a few hyperbolic and degenerate orbits.
+static EllipticalOrbit* testEllipticalOrbit(int i)
+{
+	const double eccentricities[] = {0., 0.1, 0.5, 0.95, 1.0, 1.5};
+	const double q = 0.01 + 0.001*(i%5000);
+	const double e = (i%100<6) ? eccentricities[i%100] : 0.001*(i%990);
+	const double a = q/std::fabs(1.0-(e==1.0 ? 0. : e));
+	const double parentRot = (i%7==0) ? 0.4 : 0.;
+	return new EllipticalOrbit(q, e, 0.001*(i%3000), 0.01*(i%628), 0.03*(i%209), 0.0007*(i%9000),
+				   365.25*a*std::sqrt(a), 2451545.0, parentRot, 0.5*parentRot, 0.2*parentRot);
+}
+
+// Largest distance between the positions of the batch and of the orbit objects at the date jde,
+// relative to the distance from the center.
+template <class T>
+static double maxDeviation(const QVector<QSharedPointer<T> >& orbits, KeplerBatch& batch, double jde)
+{
+	QVector<double> xyz(3*batch.size());
+	batch.computePositions(jde, xyz.data());
+	double maxDev = 0.;
+	for (int i=0;i<orbits.size();++i)
+	{
+		double ref[3];
+		orbits.at(i)->positionAtTimevInVSOP87Coordinates(jde, ref);
+		const Vec3d d(xyz.at(3*i)-ref[0], xyz.at(3*i+1)-ref[1], xyz.at(3*i+2)-ref[2]);
+		maxDev = qMax(maxDev, d.length()/qMax(1., Vec3d(ref[0], ref[1], ref[2]).length()));
+	}
+	return maxDev;
+}
+
+void TestKeplerBatch::testCometOrbits()
+{
+	QVector<QSharedPointer<CometOrbit> > orbits;
+	KeplerBatch batch;
+	for (int i=0;i<10000;++i)
+	{
+		orbits << QSharedPointer<CometOrbit>(testCometOrbit(i));
+		QCOMPARE(batch.append(*orbits.last()), i);
+	}
+	// Before and after the pericenters. Each lane does the iterations of CometOrbit, only the
+	// rounding errors of the precomputed orbital plane vectors remain.
+	for (double jde=2456000.5;jde<2462000.;jde+=750.)
+	{
+		const double maxDev = maxDeviation(orbits, batch, jde);
+		QVERIFY2(maxDev<1e-12, qPrintable(QString("JDE %1: deviation %2").arg(jde).arg(maxDev)));
+	}
+}
+
+void TestKeplerBatch::testEllipticalOrbits()
+{
+	QVector<QSharedPointer<EllipticalOrbit> > orbits;
+	KeplerBatch batch;
+	for (int i=0;i<10000;++i)
+	{
+		orbits << QSharedPointer<EllipticalOrbit>(testEllipticalOrbit(i));
+		QCOMPARE(batch.append(*orbits.last()), i);
+	}
+	// The lanes do the fixed number of iterations of EllipticalOrbit::eccentricAnomaly(),
+	// the rotations to the orbital plane are only rounded differently. The initial guess
+	// of the hyperbolic orbits is only defined after the epoch.
+	for (double jde=2451545.5;jde<2470000.;jde+=1750.)
+	{
+		const double maxDev = maxDeviation(orbits, batch, jde);
+		QVERIFY2(maxDev<1e-12, qPrintable(QString("JDE %1: deviation %2").arg(jde).arg(maxDev)));
+	}
+}
+
+void TestKeplerBatch::testScalarPath()
+{
+	// Orbits which need a different number of iterations in the lanes of a block:
+	// near circular, very eccentric, near parabolic on both sides.
+	const double eccentricities[] = {0., 0.01, 0.3, 0.9, 0.99, 0.9999, 1.0001, 1.01, 1.5, 3.};
+	const int nbEccentricities = sizeof(eccentricities)/sizeof(eccentricities[0]);
+	QVector<QSharedPointer<CometOrbit> > orbits;
+	KeplerBatch batch;
+	for (int i=0;i<nbEccentricities;++i)
+	{
+		const double e = eccentricities[i];
+		const double q = 0.5+0.2*i;
+		const double a = q/std::fabs(1.0-e);
+		orbits << QSharedPointer<CometOrbit>(new CometOrbit(q, e, 0.1*i, 0.5*i, 0.3*i, 2457000.5, 1000.,
+								     0.01720209895/(a*std::sqrt(a)), 0., 0., 0.));
+		batch.append(*orbits.last());
+	}
+	// As in SolarSystem::computeBatchedPositions(), each body at its own date, corrected for the light travel time.
+	QVector<int> indices;
+	QVector<double> dates;
+	for (int k=0;k<20*nbEccentricities;++k)
+	{
+		indices << k%nbEccentricities;
+		dates << 2456900.5+17.3*k+0.001*(k%nbEccentricities);
+	}
+	QVector<double> xyz(3*indices.size());
+	batch.computePositions(indices.constData(), indices.size(), dates.constData(), xyz.data());
+	for (int k=0;k<indices.size();++k)
+	{
+		// Same call as cometOrbitPosFunc()
+		double ref[3];
+		orbits.at(indices.at(k))->positionAtTimevInVSOP87Coordinates(dates.at(k), ref);
+		const Vec3d r(ref[0], ref[1], ref[2]);
+		const Vec3d d(xyz.at(3*k)-ref[0], xyz.at(3*k+1)-ref[1], xyz.at(3*k+2)-ref[2]);
+		QVERIFY2(d.length()<1e-12*qMax(1., r.length()),
+			 qPrintable(QString("e=%1, JDE %2: deviation %3").arg(eccentricities[indices.at(k)]).arg(dates.at(k)).arg(d.length())));
+	}
+}
+
+void TestKeplerBatch::testIndexedPositions()
+{
+	QVector<QSharedPointer<CometOrbit> > orbits;
+	KeplerBatch batch;
+	for (int i=0;i<1000;++i)
+	{
+		orbits << QSharedPointer<CometOrbit>(testCometOrbit(i));
+		batch.append(*orbits.last());
+	}
+	// A subset of the orbits, in any order, each at its own date
+	QVector<int> indices;
+	QVector<double> dates;
+	for (int i=999;i>=0;i-=3)
+	{
+		indices << i;
+		dates << 2457000.5+i;
+	}
+	QVector<double> xyz(3*indices.size());
+	batch.computePositions(indices.constData(), indices.size(), dates.constData(), xyz.data());
+	for (int k=0;k<indices.size();++k)
+	{
+		double ref[3];
+		orbits.at(indices.at(k))->positionAtTimevInVSOP87Coordinates(dates.at(k), ref);
+		for (int c=0;c<3;++c)
+			QVERIFY(std::fabs(xyz.at(3*k+c)-ref[c])<1e-12*qMax(1., std::fabs(ref[c])));
+	}
+}
+
+void TestKeplerBatch::benchmarkPositions_data()
+{
+	QTest::addColumn<bool>("elliptical");
+	QTest::addColumn<bool>("batched");
+	QTest::newRow("CometOrbit, per object") << false << false;
+	QTest::newRow("CometOrbit, batch") << false << true;
+	QTest::newRow("EllipticalOrbit, per object") << true << false;
+	QTest::newRow("EllipticalOrbit, batch") << true << true;
+}
+
+void TestKeplerBatch::benchmarkPositions()
+{
+	QFETCH(bool, elliptical);
+	QFETCH(bool, batched);
+
+	const int nbBodies = 100000;
+	QVector<QSharedPointer<CometOrbit> > cometOrbits;
+	QVector<QSharedPointer<EllipticalOrbit> > ellipticalOrbits;
+	KeplerBatch batch;
+	for (int i=0;i<nbBodies;++i)
+	{
+		if (elliptical)
+		{
+			ellipticalOrbits << QSharedPointer<EllipticalOrbit>(testEllipticalOrbit(i));
+			batch.append(*ellipticalOrbits.last());
+		}
+		else
+		{
+			cometOrbits << QSharedPointer<CometOrbit>(testCometOrbit(i));
+			batch.append(*cometOrbits.last());
+		}
+	}
+
+	// One frame per hour of animation
+	const int nbFrames = 10;
+	double jde = 2457900.5;
+	QVector<double> xyz(3*nbBodies);
+	qint64 nbPositions = 0;
+	QElapsedTimer timer;
+	timer.start();
+	QBENCHMARK {
+		for (int frame=0;frame<nbFrames;++frame)
+		{
+			jde += 1./24.;
+			if (batched)
+				batch.computePositions(jde, xyz.data());
+			else if (elliptical)
+			{
+				for (int i=0;i<nbBodies;++i)
+					ellipticalOrbits.at(i)->positionAtTimevInVSOP87Coordinates(jde, xyz.data()+3*i);
+			}
+			else
+			{
+				// The velocity is only needed by the comet tails.
+				for (int i=0;i<nbBodies;++i)
+					cometOrbits.at(i)->positionAtTimevInVSOP87Coordinates(jde, xyz.data()+3*i, false);
+			}
+			nbPositions += nbBodies;
+		}
+	}
+	const qint64 elapsed = timer.nsecsElapsed();
+	QVERIFY(elapsed>0);
+	const double maxDev = elliptical ? maxDeviation(ellipticalOrbits, batch, jde) : maxDeviation(cometOrbits, batch, jde);
+	qDebug() << nbBodies << "bodies:" << qRound64(nbPositions*1e9/elapsed) << "positions per second, max. deviation" << maxDev;
+}
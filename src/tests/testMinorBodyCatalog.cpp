@@ -0,0 +1,183 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+
+#include "tests/testMinorBodyCatalog.hpp"
+#include "Orbit.hpp"
+
+#include <cmath>
+
+QTEST_GUILESS_MAIN(TestMinorBodyCatalog)
+
+#define NB_TEST_BODIES 100000
+
+static MinorBodyCatalog::Body testBody(int i)
+{
+	MinorBodyCatalog::Body body;
+	body.englishName = QString("Body %1").arg(i);
+	body.provisionalDesignation = (i%3==0) ? QString("2017 A%1").arg(i) : QString();
+	body.type = (i%10==0) ? "cubewano" : "asteroid";
+	body.minorPlanetNumber = i+1;
+	// Elliptic, parabolic and hyperbolic orbits
+	body.eccentricity = (i%100==0) ? 1.0 : (i%100==1 ? 1.2 : (i%97)*0.01);
+	body.pericenterDistance = 0.5 + (i%500)*0.01;
+	body.inclination = (i%180)*M_PI/180.;
+	body.ascendingNode = (i%360)*M_PI/180.;
+	body.argOfPericenter = (i%359)*M_PI/180.;
+	body.timeAtPericenter = 2457600.5 + i%1000;
+	body.meanMotion = 0.01720209895/std::pow(body.pericenterDistance, 1.5);
+	body.orbitGoodDays = 1000.;
+	body.orbitVisualizationPeriod = 365.25*(i%5);
+	body.absoluteMagnitude = 10.f + (i%100)*0.1f;
+	body.slopeParameter = 0.15f;
+	body.albedo = 0.1f;
+	body.radius = 1.f + i%50;
+	body.colorIndexBV = (i%7==0) ? 0.7f : 99.f;
+	return body;
+}
+
+void TestMinorBodyCatalog::initTestCase()
+{
+	for (int i=0;i<NB_TEST_BODIES;++i)
+		QCOMPARE(catalog.append(testBody(i)), i);
+	catalog.squeeze();
+}
+
+void TestMinorBodyCatalog::testBodyData()
+{
+	for (int i=0;i<NB_TEST_BODIES;i+=997)
+	{
+		const MinorBodyCatalog::Body ref = testBody(i);
+		const MinorBodyCatalog::Body body = catalog.getBody(i);
+		QCOMPARE(body.englishName, ref.englishName);
+		QCOMPARE(body.provisionalDesignation, ref.provisionalDesignation);
+		QCOMPARE(body.type, ref.type);
+		QCOMPARE(body.minorPlanetNumber, ref.minorPlanetNumber);
+		QCOMPARE(body.pericenterDistance, ref.pericenterDistance);
+		QCOMPARE(body.eccentricity, ref.eccentricity);
+		QCOMPARE(body.inclination, ref.inclination);
+		QCOMPARE(body.ascendingNode, ref.ascendingNode);
+		QCOMPARE(body.argOfPericenter, ref.argOfPericenter);
+		QCOMPARE(body.timeAtPericenter, ref.timeAtPericenter);
+		QCOMPARE(body.meanMotion, ref.meanMotion);
+		QCOMPARE(body.absoluteMagnitude, ref.absoluteMagnitude);
+		QCOMPARE(body.radius, ref.radius);
+		QCOMPARE(body.colorIndexBV, ref.colorIndexBV);
+	}
+}
+
+void TestMinorBodyCatalog::testNameLookup()
+{
+	for (int i=0;i<NB_TEST_BODIES;i+=101)
+		QCOMPARE(catalog.indexOf(QString("Body %1").arg(i)), i);
+	QCOMPARE(catalog.indexOf("Body"), -1);
+	QCOMPARE(catalog.indexOf(QString("Body %1").arg(NB_TEST_BODIES)), -1);
+
+	// Bodies appended after squeeze() are found before the next one.
+	MinorBodyCatalog small;
+	small.append(testBody(1));
+	small.squeeze();
+	small.append(testBody(2));
+	QCOMPARE(small.indexOf("Body 1"), 0);
+	QCOMPARE(small.indexOf("Body 2"), 1);
+	small.setRemoved(0);
+	QCOMPARE(small.indexOf("Body 1"), -1);
+	small.squeeze();
+	QCOMPARE(small.indexOf("Body 2"), 1);
+}
+
+void TestMinorBodyCatalog::testFindNames()
+{
+	QCOMPARE(catalog.getListedName(41), QString("(42) Body 41"));
+
+	// Prefix search, in the order of the names
+	QVector<int> found;
+	catalog.findNames("(12", true, NB_TEST_BODIES, found);
+	QStringList names;
+	foreach (int i, found)
+		names << catalog.getListedName(i);
+	QStringList expected;
+	for (int i=0;i<NB_TEST_BODIES;++i)
+	{
+		if (catalog.getListedName(i).startsWith("(12"))
+			expected << catalog.getListedName(i);
+	}
+	expected.sort();
+	QCOMPARE(names, expected);
+
+	// Substring search, ignoring the case
+	found.clear();
+	catalog.findNames("BODY 4242", false, NB_TEST_BODIES, found);
+	QCOMPARE(found.size(), 11);
+	foreach (int i, found)
+		QVERIFY(catalog.getListedName(i).contains("Body 4242"));
+	found.clear();
+	catalog.findNames("body", false, 5, found);
+	QCOMPARE(found.size(), 5);
+	found.clear();
+	catalog.findNames("Body", true, 5, found);
+	QVERIFY(found.isEmpty());
+
+	// Removed, materialized and appended bodies
+	MinorBodyCatalog small;
+	for (int i=0;i<3;++i)
+		small.append(testBody(i));
+	small.squeeze();
+	small.append(testBody(3));
+	small.setRemoved(0);
+	small.setMaterialized(1, true);
+	found.clear();
+	small.findNames("(", true, 10, found);
+	QCOMPARE(found, QVector<int>() << 2 << 3);
+	found.clear();
+	small.findNames("ody", false, 10, found);
+	QCOMPARE(found, QVector<int>() << 2 << 3);
+}
+
+void TestMinorBodyCatalog::testPositions()
+{
+	const double jde = 2458000.5;
+	catalog.updateApproxPositions(0, NB_TEST_BODIES, jde);
+	for (int i=0;i<NB_TEST_BODIES;i+=13)
+	{
+		const MinorBodyCatalog::Body body = testBody(i);
+		CometOrbit orbit(body.pericenterDistance, body.eccentricity, body.inclination, body.ascendingNode,
+				 body.argOfPericenter, body.timeAtPericenter, body.orbitGoodDays, body.meanMotion, 0., 0., 0.);
+		double ref[3], xyz[3];
+		orbit.positionAtTimevInVSOP87Coordinates(jde, ref, false);
+		catalog.computePosition(i, jde, xyz);
+		QCOMPARE(xyz[0], ref[0]);
+		QCOMPARE(xyz[1], ref[1]);
+		QCOMPARE(xyz[2], ref[2]);
+		const Vec3d approx = catalog.getApproxPosition(i);
+		const Vec3d exact(ref[0], ref[1], ref[2]);
+		QVERIFY((approx-exact).length() <= 1e-6*exact.length());
+	}
+}
+
+void TestMinorBodyCatalog::testMemoryUsage()
+{
+	const double bytesPerBody = (double)catalog.getMemoryUsage()/catalog.size();
+	qDebug() << "Bytes per body:" << bytesPerBody;
+	// A million bodies should fit in 200 MB.
+	QVERIFY(bytesPerBody < 200.);
+}
@@ -0,0 +1,238 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+
+#include "tests/testOrbitPath.hpp"
+#include "OrbitPath.hpp"
+#include "Orbit.hpp"
+
+#include <cmath>
+
+QTEST_GUILESS_MAIN(TestOrbitPath)
+
+namespace
+{
+	// Gaussian gravitational constant
+	const double K = 0.01720209895;
+
+	class CometPositions : public OrbitPath::PositionFunction
+	{
+	public:
+		CometPositions(double q, double e, double timeAtPericenter)
+			: orbit(q, e, 0.3, 1.2, 0.7, timeAtPericenter, 1000., K/std::pow(q/(1.0-e), 1.5), 0., 0., 0.)
+			, period(2.0*M_PI*std::pow(q/(1.0-e), 1.5)/K)
+		{
+		}
+		virtual Vec3d position(double jde) const
+		{
+			Vec3d pos;
+			orbit.positionAtTimevInVSOP87Coordinates(jde, pos, false);
+			return pos;
+		}
+		mutable CometOrbit orbit;
+		double period;
+	};
+
+	// Largest angular error of the path against the positions on the orbit, seen from the observer.
+	double maxAngularError(const OrbitPath& path, const CometPositions& f, const Vec3d& observerPos)
+	{
+		double maxError = 0.;
+		const int nbChecks = 5000;
+		for (int k=0;k<=nbChecks;++k)
+		{
+			const double jde = path.getStartJDE()+(path.getEndJDE()-path.getStartJDE())*k/nbChecks;
+			const Vec3d p = f.position(jde);
+			const int i = qBound(1, path.indexAfter(jde), path.size()-1);
+			// Distance from p to the segment of the path
+			const Vec3d a = path.getPoints().at(i-1);
+			const Vec3d b = path.getPoints().at(i);
+			const Vec3d ab = b-a;
+			const double t = ab.lengthSquared()>0. ? qBound(0., (p-a).dot(ab)/ab.lengthSquared(), 1.) : 0.;
+			const double error = (p-(a+ab*t)).length()/(p-observerPos).length();
+			maxError = qMax(maxError, error);
+		}
+		return maxError;
+	}
+}
+
+void TestOrbitPath::testAccuracy_data()
+{
+	QTest::addColumn<double>("q");
+	QTest::addColumn<double>("e");
+	QTest::addColumn<int>("maxPoints");
+	QTest::newRow("nearly circular") << 1.0 << 0.01 << 200;
+	QTest::newRow("eccentric") << 0.8 << 0.6 << 361;
+	QTest::newRow("highly eccentric") << 0.5 << 0.97 << 2000;
+}
+
+void TestOrbitPath::testAccuracy()
+{
+	QFETCH(double, q);
+	QFETCH(double, e);
+	QFETCH(int, maxPoints);
+	const CometPositions f(q, e, 2457000.5);
+	const Vec3d observerPos(1., 0., 0.);
+	const double tolerance = 1e-3;
+	const double date = 2457100.5;
+	OrbitPath path;
+	path.sample(f, date-0.5*f.period, date+0.5*f.period, observerPos, tolerance);
+
+	QVERIFY(path.size()<=maxPoints);
+	QVERIFY(path.getNrOfEvaluations()<=2*maxPoints);
+	QCOMPARE(path.getDates().first(), date-0.5*f.period);
+	QCOMPARE(path.getDates().last(), date+0.5*f.period);
+	for (int i=1;i<path.size();++i)
+		QVERIFY(path.getDates().at(i)>path.getDates().at(i-1));
+	const double error = maxAngularError(path, f, observerPos);
+	QVERIFY2(error<4*tolerance, qPrintable(QString("error %1 with %2 points").arg(error).arg(path.size())));
+
+	// Uniform time steps give the same number of points everywhere, the path has more near the pericenter.
+	if (e>0.9)
+	{
+		int nearPericenter = 0;
+		foreach (double jde, path.getDates())
+			if (std::fabs(std::remainder(jde-2457000.5, f.period))<0.01*f.period)
+				nearPericenter++;
+		QVERIFY(nearPericenter>0.1*path.size());
+	}
+}
+
+void TestOrbitPath::testPeriodic()
+{
+	const CometPositions f(0.9, 0.3, 2457000.5);
+	const Vec3d observerPos(1., 0., 0.);
+	OrbitPath path;
+	path.sample(f, 2457000.5, 2457000.5+f.period, observerPos, 1e-3);
+	QVERIFY(path.isPeriodic());
+	// The insertion point of any date
+	const double jde = 2457000.5+12.3*f.period+0.25*f.period;
+	const int i = path.indexAfter(jde);
+	QVERIFY(i>0 && i<path.size());
+	QVERIFY(path.getDates().at(i-1)<=2457000.5+0.25*f.period+1e-6);
+	QVERIFY(path.getDates().at(i)>2457000.5+0.25*f.period-1e-6);
+
+	path.sample(f, 2457000.5, 2457000.5+0.7*f.period, observerPos, 1e-3);
+	QVERIFY(!path.isPeriodic());
+}
+
+void TestOrbitPath::testShift()
+{
+	const CometPositions f(0.5, 0.9, 2457000.5);
+	const Vec3d observerPos(1., 0., 0.);
+	const double window = 0.5*f.period;
+	const double step = window/360.;
+	OrbitPath path;
+	double date = 2456900.5;
+	path.sample(f, date-0.5*window, date+0.5*window, observerPos, 1e-3);
+	const int sampled = path.getNrOfEvaluations();
+
+	// Move the path over the pericenter
+	for (int k=0;k<200;++k)
+	{
+		date += step;
+		path.shift(f, date-0.5*window, date+0.5*window, observerPos, 1e-3);
+		QCOMPARE(path.getStartJDE(), date-0.5*window);
+		QCOMPARE(path.getEndJDE(), date+0.5*window);
+		QCOMPARE(path.getDates().first(), date-0.5*window);
+		QCOMPARE(path.getDates().last(), date+0.5*window);
+	}
+	for (int i=1;i<path.size();++i)
+		QVERIFY(path.getDates().at(i)>path.getDates().at(i-1));
+	QVERIFY(maxAngularError(path, f, observerPos)<4e-3);
+	// Each step only computes the new parts of the path
+	QVERIFY(path.getNrOfEvaluations()-sampled<200*20);
+
+	// Backwards
+	date -= 50*step;
+	path.shift(f, date-0.5*window, date+0.5*window, observerPos, 1e-3);
+	QCOMPARE(path.getDates().first(), date-0.5*window);
+	QVERIFY(maxAngularError(path, f, observerPos)<4e-3);
+}
+
+void TestOrbitPath::testObserverMove()
+{
+	// A periodic path sampled from the Earth, seen after the Earth has moved around the Sun
+	const CometPositions f(0.9, 0.3, 2457000.5);
+	const double tolerance = 1e-3;
+	OrbitPath path;
+	path.sample(f, 2457000.5, 2457000.5+f.period, Vec3d(1., 0., 0.), tolerance);
+	QVERIFY(path.isPeriodic());
+	QCOMPARE(path.getAngularErrorBound(Vec3d(1., 0., 0.)), tolerance);
+	QVERIFY(path.getObserverDistance()>0.);
+
+	// The bound grows with the move of the observer and holds for the new observer.
+	const double angles[] = {0.01, 0.05, 0.2, 1.0, 3.0};
+	double lastBound = tolerance;
+	for (unsigned int k=0;k<sizeof(angles)/sizeof(angles[0]);++k)
+	{
+		const Vec3d observerPos(std::cos(angles[k]), std::sin(angles[k]), 0.);
+		const double bound = path.getAngularErrorBound(observerPos);
+		QVERIFY(bound>=lastBound);
+		if (bound<1.)
+			QVERIFY2(maxAngularError(path, f, observerPos)<=4*bound, qPrintable(QString("move %1: bound %2").arg(angles[k]).arg(bound)));
+		lastBound = bound;
+	}
+
+	// Once the bound fails, shift() samples again for the new observer.
+	const Vec3d farObserverPos(-1., 0., 0.);
+	QVERIFY(path.getAngularErrorBound(farObserverPos)>2*tolerance);
+	path.shift(f, 2457000.5+1., 2457000.5+1.+f.period, farObserverPos, tolerance);
+	QCOMPARE(path.getAngularTolerance(), tolerance);
+	QCOMPARE(path.getObserverPos(), farObserverPos);
+	QCOMPARE(path.getAngularErrorBound(farObserverPos), tolerance);
+	QVERIFY(maxAngularError(path, f, farObserverPos)<4*tolerance);
+}
+
+void TestOrbitPath::benchmarkComets()
+{
+	// Orbit lines of comets sampled once, against the 361 points of uniform steps
+	QVector<QSharedPointer<CometPositions> > comets;
+	for (int i=0;i<300;++i)
+		comets << QSharedPointer<CometPositions>(new CometPositions(0.3+0.01*(i%200), 0.05+0.003*(i%300), 2457000.5+i));
+	const Vec3d observerPos(1., 0., 0.);
+
+	QElapsedTimer timer;
+	timer.start();
+	int nbEvaluations = 0;
+	int nbPoints = 0;
+	foreach (const QSharedPointer<CometPositions>& f, comets)
+	{
+		OrbitPath path;
+		path.sample(*f, 2457000.5-0.5*f->period, 2457000.5+0.5*f->period, observerPos, 1e-3);
+		nbEvaluations += path.getNrOfEvaluations();
+		nbPoints += path.size();
+	}
+	const qint64 adaptiveTime = timer.nsecsElapsed();
+
+	timer.restart();
+	double sum = 0.;
+	foreach (const QSharedPointer<CometPositions>& f, comets)
+		for (int d=0;d<=360;++d)
+			sum += f->position(2457000.5+(d-180)*f->period/360.)[0];
+	const qint64 uniformTime = timer.nsecsElapsed();
+	QVERIFY(sum==sum);
+
+	qDebug() << comets.size() << "comets: adaptive" << adaptiveTime/1e6 << "ms," << nbEvaluations << "positions," << nbPoints << "points;"
+		 << "uniform" << uniformTime/1e6 << "ms," << comets.size()*361 << "positions";
+}
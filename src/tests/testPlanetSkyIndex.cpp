@@ -0,0 +1,109 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+
+#include "tests/testPlanetSkyIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+QTEST_GUILESS_MAIN(TestPlanetSkyIndex)
+
+#define NB_TEST_BODIES 50000
+
+// Bodies found by a linear scan, with the same test as SolarSystem::searchAround()
+static QVector<int> scan(const QVector<Vec3d>& pos, const QVector<double>& angularSize, const Vec3d& v, double limFov)
+{
+	QVector<int> result;
+	const double cosLimFov = std::cos(limFov*M_PI/180.);
+	for (int i=0;i<pos.size();++i)
+	{
+		Vec3d p = pos.at(i);
+		p.normalize();
+		if (p*v>=std::min(cosLimFov, std::cos(angularSize.at(i)*M_PI/180.)))
+			result << i;
+	}
+	return result;
+}
+
+void TestPlanetSkyIndex::initTestCase()
+{
+	grid = new StelGeodesicGrid(PlanetSkyIndex::GridLevel);
+	qsrand(12345);
+	for (int i=0;i<NB_TEST_BODIES;++i)
+	{
+		// Uniform on the sphere, at various distances
+		const double z = 2.*qrand()/RAND_MAX-1.;
+		const double phi = 2.*M_PI*qrand()/RAND_MAX;
+		const double r = std::sqrt(1.-z*z);
+		const double distance = 0.1+10.*qrand()/RAND_MAX;
+		pos << Vec3d(r*std::cos(phi), r*std::sin(phi), z)*distance;
+		// Mostly tiny bodies, a few large ones
+		angularSize << ((i%1000==0) ? 0.1*(i%300) : 1e-4*(i%100));
+	}
+	// The observer's planet, never found
+	pos << Vec3d(0.);
+	angularSize << 90.;
+	index.build(grid, pos, angularSize);
+}
+
+void TestPlanetSkyIndex::cleanupTestCase()
+{
+	delete grid;
+}
+
+void TestPlanetSkyIndex::testQuery_data()
+{
+	QTest::addColumn<double>("limFov");
+	QTest::newRow("0.01 deg") << 0.01;
+	QTest::newRow("1 deg") << 1.;
+	QTest::newRow("2.56 deg") << 2.5626;
+	QTest::newRow("10 deg") << 10.;
+	QTest::newRow("60 deg") << 60.;
+}
+
+void TestPlanetSkyIndex::testQuery()
+{
+	QFETCH(double, limFov);
+	qint64 nbCandidates = 0;
+	for (int k=0;k<200;++k)
+	{
+		// Query around some bodies and some random directions
+		Vec3d v = (k%2==0) ? pos.at((k*7919)%NB_TEST_BODIES) : Vec3d(std::sin(0.1*k), std::cos(0.3*k), std::sin(0.7*k));
+		v.normalize();
+		QVector<int> candidates;
+		index.query(grid, v, limFov, candidates);
+		nbCandidates += candidates.size();
+		std::sort(candidates.begin(), candidates.end());
+		QVERIFY(std::adjacent_find(candidates.constBegin(), candidates.constEnd())==candidates.constEnd());
+
+		QVector<int> found;
+		foreach (int i, candidates)
+		{
+			QVERIFY(i>=0 && i<pos.size());
+			if (scan(QVector<Vec3d>() << pos.at(i), QVector<double>() << angularSize.at(i), v, limFov).size()==1)
+				found << i;
+		}
+		QCOMPARE(found, scan(pos, angularSize, v, limFov));
+	}
+	qDebug() << limFov << "degrees:" << nbCandidates/200 << "candidates per query";
+}
@@ -0,0 +1,183 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "tests/testPointSourceDraw.hpp"
+
+#include <QtConcurrent>
+#include <cstdlib>
+
+QTEST_GUILESS_MAIN(TestPointSourceDraw)
+
+//! A gnomonic projection looking toward +z, on a 1000x1000 pixels viewport.
+struct TestProjector
+{
+	bool project(const Vec3f& v, Vec3f& win) const
+	{
+		win.set(500.f+500.f*v[0]/v[2], 500.f+500.f*v[1]/v[2], 0.f);
+		return v[2]>0.f;
+	}
+	bool projectCheck(const Vec3f& v, Vec3f& win) const
+	{
+		return project(v, win) && win[0]>=0.f && win[0]<=1000.f && win[1]>=0.f && win[1]<=1000.f;
+	}
+};
+
+//! Returns the random number of the star being drawn and counts the drawn numbers.
+struct CountingRandom
+{
+	float value;
+	int* count;
+	float operator()() {++*count; return value;}
+};
+
+//! Returns the numbers of a sequence, as qrand() in the serial path.
+struct SequenceRandom
+{
+	const QVector<float>* values;
+	int count;
+	float operator()() {return values->at(count++);}
+};
+
+static const double TwinkleAmount = 0.3;
+
+//! A zone projected by a worker thread into its own buffer, as StarZoneJob in StarMgr.
+struct TestZoneJob
+{
+	const QVector<TestPointStar>* stars;
+	bool checkInScreen;
+	bool twinkle;
+	QVector<StelSkyDrawer::ProjectedPointSource> points;
+};
+
+// Same as BufferStarSink::addStar() for all the stars of a zone.
+static void computeTestZone(TestZoneJob& job)
+{
+	const TestProjector prj;
+	foreach (const TestPointStar& s, *job.stars)
+	{
+		StelSkyDrawer::ProjectedPointSource source;
+		int count = 0;
+		CountingRandom random = {s.random, &count};
+		if (StelSkyDrawer::projectPointSource(prj, s.v, s.rcMag, s.color, job.checkInScreen, job.twinkle, TwinkleAmount, s.twinkleFactor, random, source))
+			job.points.append(source);
+	}
+}
+
+void TestPointSourceDraw::initTestCase()
+{
+	qsrand(1234);
+	zones.resize(20);
+	for (int z=0;z<zones.size();++z)
+	{
+		for (int i=0;i<500;++i)
+		{
+			TestPointStar s;
+			// Many stars are behind or outside the viewport
+			s.v.set((float)qrand()/RAND_MAX*3.f-1.5f, (float)qrand()/RAND_MAX*3.f-1.5f, (float)qrand()/RAND_MAX*2.f-0.5f);
+			s.v.normalize();
+			// Some stars are too faint to be drawn
+			s.rcMag.radius = i%7==0 ? 0.f : 1.f+(float)qrand()/RAND_MAX*5.f;
+			s.rcMag.luminance = (float)qrand()/RAND_MAX;
+			s.color.set((float)qrand()/RAND_MAX, (float)qrand()/RAND_MAX, (float)qrand()/RAND_MAX);
+			s.twinkleFactor = (float)qrand()/RAND_MAX;
+			s.random = (float)qrand()/RAND_MAX;
+			zones[z].append(s);
+		}
+	}
+}
+
+void TestPointSourceDraw::testSerialParallel_data()
+{
+	QTest::addColumn<bool>("checkInScreen");
+	QTest::addColumn<bool>("twinkle");
+	QTest::newRow("inside viewport") << false << false;
+	QTest::newRow("border zones") << true << false;
+	QTest::newRow("twinkling") << true << true;
+}
+
+void TestPointSourceDraw::testSerialParallel()
+{
+	QFETCH(bool, checkInScreen);
+	QFETCH(bool, twinkle);
+	const TestProjector prj;
+
+	// Serial path: all the zones in order from the main thread, as DirectStarSink::addStar().
+	QVector<StelSkyDrawer::ProjectedPointSource> serial;
+	int randomCount = 0;
+	foreach (const QVector<TestPointStar>& zone, zones)
+	{
+		foreach (const TestPointStar& s, zone)
+		{
+			StelSkyDrawer::ProjectedPointSource source;
+			CountingRandom random = {s.random, &randomCount};
+			if (StelSkyDrawer::projectPointSource(prj, s.v, s.rcMag, s.color, checkInScreen, twinkle, TwinkleAmount, s.twinkleFactor, random, source))
+				serial.append(source);
+		}
+	}
+	QVERIFY(serial.size()>0);
+	QVERIFY(serial.size()<zones.size()*zones.first().size());
+	QCOMPARE(randomCount, twinkle ? serial.size() : 0);
+
+	// Parallel path: one buffer per zone filled in worker threads, submitted in the zone order.
+	QVector<TestZoneJob> jobs(zones.size());
+	for (int z=0;z<zones.size();++z)
+	{
+		jobs[z].stars = &zones.at(z);
+		jobs[z].checkInScreen = checkInScreen;
+		jobs[z].twinkle = twinkle;
+	}
+	QtConcurrent::blockingMap(jobs, computeTestZone);
+	QVector<StelSkyDrawer::ProjectedPointSource> parallel;
+	foreach (const TestZoneJob& job, jobs)
+		parallel += job.points;
+
+	QCOMPARE(parallel.size(), serial.size());
+	for (int i=0;i<serial.size();++i)
+	{
+		const StelSkyDrawer::ProjectedPointSource& a = serial.at(i);
+		const StelSkyDrawer::ProjectedPointSource& b = parallel.at(i);
+		QCOMPARE(a.win, b.win);
+		QCOMPARE(a.radius, b.radius);
+		QCOMPARE(a.luminance, b.luminance);
+		QCOMPARE(a.twinkle, b.twinkle);
+		QCOMPARE(a.color, b.color);
+	}
+}
+
+void TestPointSourceDraw::testRandomAfterCulling()
+{
+	// The culled stars must not draw a random number, so that the visible
+	// stars get the same twinkling as before the parallel drawing mode.
+	const TestProjector prj;
+	QVector<float> values;
+	for (int i=0;i<zones.first().size();++i)
+		values.append((float)i/zones.first().size());
+	SequenceRandom random = {&values, 0};
+	int visible = 0;
+	foreach (const TestPointStar& s, zones.first())
+	{
+		StelSkyDrawer::ProjectedPointSource source;
+		if (!StelSkyDrawer::projectPointSource(prj, s.v, s.rcMag, s.color, true, true, TwinkleAmount, s.twinkleFactor, random, source))
+			continue;
+		QCOMPARE(source.twinkle, (float)(1.f-s.twinkleFactor*TwinkleAmount*values.at(visible)));
+		++visible;
+	}
+	QCOMPARE(random.count, visible);
+	QVERIFY(visible<zones.first().size());
+}
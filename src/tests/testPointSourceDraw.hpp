@@ -0,0 +1,55 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _TESTPOINTSOURCEDRAW_HPP_
+#define _TESTPOINTSOURCEDRAW_HPP_
+
+#include <QObject>
+#include <QtTest>
+#include <QVector>
+
+#include "VecMath.hpp"
+#include "StelSkyDrawer.hpp"
+
+//! A star to draw, with the random number of its twinkling.
+struct TestPointStar
+{
+	Vec3f v;
+	RCMag rcMag;
+	Vec3f color;
+	float twinkleFactor;
+	float random;
+};
+
+//! Compares the point sources drawn by the serial path of the stars (StelSkyDrawer::drawPointSource())
+//! and by the parallel path (StelSkyDrawer::computePointSource() in worker threads, submitted by zone).
+class TestPointSourceDraw : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void testSerialParallel_data();
+	void testSerialParallel();
+	void testRandomAfterCulling();
+private:
+	//! Stars of each zone, in the drawing order
+	QVector<QVector<TestPointStar> > zones;
+};
+
+#endif // _TESTPOINTSOURCEDRAW_HPP_
@@ -0,0 +1,206 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+#include <QVector>
+
+#include "tests/testSGP4Batch.hpp"
+#include "SGP4Batch.hpp"
+#include "sgp4io.h"
+
+#include <cmath>
+#include <cstring>
+
+QTEST_GUILESS_MAIN(TestSGP4Batch)
+
+// Low earth orbit, elliptic orbit (Vanguard 1), geostationary orbit and Molniya orbit.
+static const char* const testTles[][2] = {
+	{"1 25544U 98067A   08264.51782528 -.00002182  00000-0 -11606-4 0  2927",
+	 "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.72125391563537"},
+	{"1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753",
+	 "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667"},
+	{"1 28626U 05008A   06176.46683397 -.00000205  00000-0  10000-3 0  2190",
+	 "2 28626   0.0019 286.9433 0000335  13.7918  55.6504  1.00270176  4891"},
+	{"1 08195U 75081A   06176.33215444  .00000099  00000-0  11873-3 0   813",
+	 "2 08195  64.1586 279.0717 6877146 264.7651  20.2257  2.00491383225656"}
+};
+
+static elsetrec readTle(int i)
+{
+	char line1[130], line2[130];
+	std::strcpy(line1, testTles[i][0]);
+	std::strcpy(line2, testTles[i][1]);
+	double startmfe, stopmfe, deltamin;
+	elsetrec satrec;
+	// Same settings as gSatTEME
+	twoline2rv(line1, line2, 'c', 'm', 'i', wgs72, startmfe, stopmfe, deltamin, satrec);
+	return satrec;
+}
+
+// Variations of the orbit of the test TLE i%4. Some near earth orbits get a perigee
+// below 220 km, which sgp4() computes with fewer terms.
+static elsetrec testOrbit(int i)
+{
+	const elsetrec base = readTle(i%4);
+	double ecco = base.ecco + 0.0003*(i%50);
+	if (i%4==1 && i%3==0)
+		ecco = 0.24 + 0.0002*(i%40);
+	elsetrec satrec;
+	sgp4init(wgs72, 'i', i, base.jdsatepoch-2433281.5, base.bstar*(1.+0.01*(i%7)), ecco,
+		 base.argpo+0.01*i, base.inclo+0.001*(i%30), base.mo+0.1*i, base.no*(1.+0.001*(i%11)),
+		 base.nodeo+0.02*i, satrec);
+	return satrec;
+}
+
+// Compare the batch with sgp4() at the date jd. The batch has to use the same operations,
+// the results are expected to be identical.
+static void comparePropagation(const QVector<elsetrec>& orbits, SGP4Batch& batch, double jd)
+{
+	batch.propagate(jd, false);
+	for (int i=0;i<orbits.size();++i)
+	{
+		elsetrec satrec = orbits.at(i);
+		double r[3] = {};
+		double v[3] = {};
+		sgp4(wgs72, satrec, (jd-satrec.jdsatepoch)*86400./60., r, v);
+		QCOMPARE(batch.getError(i), satrec.error);
+		const Vec3d pos = batch.getPosition(i);
+		const Vec3d vel = batch.getVelocity(i);
+		for (int k=0;k<3;++k)
+		{
+			QVERIFY2(std::fabs(pos[k]-r[k])<1e-9, qPrintable(QString("orbit %1: position %2 instead of %3").arg(i).arg(pos[k]).arg(r[k])));
+			QVERIFY2(std::fabs(vel[k]-v[k])<1e-12, qPrintable(QString("orbit %1: velocity %2 instead of %3").arg(i).arg(vel[k]).arg(v[k])));
+		}
+	}
+}
+
+void TestSGP4Batch::testNearEarthOrbits()
+{
+	QVector<elsetrec> orbits;
+	SGP4Batch batch;
+	int simplified = 0;
+	for (int i=0;i<1000;++i)
+	{
+		const elsetrec satrec = testOrbit(4*(i/2)+(i%2));
+		QCOMPARE(satrec.method, 'n');
+		orbits << satrec;
+		QCOMPARE(batch.append(satrec), i);
+		if (satrec.isimp)
+			simplified++;
+	}
+	QVERIFY(simplified>0);
+	// Keep one orbit in the last block of lanes.
+	orbits << readTle(0);
+	batch.append(orbits.last());
+	for (double minutes=-1440.;minutes<=14400.;minutes+=997.)
+		comparePropagation(orbits, batch, orbits.first().jdsatepoch+minutes/1440.);
+}
+
+void TestSGP4Batch::testDeepSpaceOrbits()
+{
+	// Mix deep space and near earth orbits.
+	QVector<elsetrec> orbits;
+	SGP4Batch batch;
+	for (int i=0;i<200;++i)
+	{
+		orbits << testOrbit(i);
+		batch.append(orbits.last());
+	}
+	// The deep space orbits keep the state of the resonance integration of sgp4(),
+	// the dates go forward as in the program.
+	for (double minutes=0.;minutes<=7200.;minutes+=360.)
+		comparePropagation(orbits, batch, orbits.first().jdsatepoch+minutes/1440.);
+}
+
+void TestSGP4Batch::testErrors()
+{
+	QVector<elsetrec> orbits;
+	SGP4Batch batch;
+	// A low orbit with a large drag decays within a few days, sgp4() then fails.
+	const elsetrec base = readTle(0);
+	elsetrec satrec;
+	sgp4init(wgs72, 'i', 1, base.jdsatepoch-2433281.5, 0.05, 0.001, base.argpo, base.inclo, base.mo,
+		 base.no, base.nodeo, satrec);
+	orbits << satrec << base;
+	batch.append(satrec);
+	batch.append(base);
+	batch.propagate(base.jdsatepoch+100., false);
+	QVERIFY(batch.getError(0)!=0);
+	QCOMPARE(batch.getError(1), 0);
+	for (double days=0.;days<=20.;days+=0.5)
+		comparePropagation(orbits, batch, base.jdsatepoch+days);
+}
+
+void TestSGP4Batch::testParallelPropagation()
+{
+	SGP4Batch serial, parallel;
+	for (int i=0;i<3000;++i)
+	{
+		const elsetrec satrec = testOrbit(i);
+		serial.append(satrec);
+		parallel.append(satrec);
+	}
+	const double jd = readTle(0).jdsatepoch+1.5;
+	serial.propagate(jd, false);
+	parallel.propagate(jd, true);
+	QCOMPARE(parallel.getJD(), jd);
+	for (int i=0;i<serial.size();++i)
+	{
+		QCOMPARE(parallel.getError(i), serial.getError(i));
+		QVERIFY(parallel.getPosition(i)==serial.getPosition(i));
+		QVERIFY(parallel.getVelocity(i)==serial.getVelocity(i));
+	}
+}
+
+void TestSGP4Batch::benchmarkPropagation_data()
+{
+	QTest::addColumn<int>("mode");
+	QTest::newRow("sgp4") << 0;
+	QTest::newRow("batch") << 1;
+	QTest::newRow("batch, parallel") << 2;
+}
+
+void TestSGP4Batch::benchmarkPropagation()
+{
+	QFETCH(int, mode);
+	// Near earth orbits, as most of the satellites of the catalogs.
+	QVector<elsetrec> orbits;
+	SGP4Batch batch;
+	for (int i=0;i<10000;++i)
+	{
+		orbits << testOrbit(4*(i/2)+(i%2));
+		batch.append(orbits.last());
+	}
+	const double jd = orbits.first().jdsatepoch+0.5;
+	QBENCHMARK
+	{
+		if (mode==0)
+		{
+			for (int i=0;i<orbits.size();++i)
+			{
+				double r[3], v[3];
+				sgp4(wgs72, orbits[i], (jd-orbits.at(i).jdsatepoch)*86400./60., r, v);
+			}
+		}
+		else
+			batch.propagate(jd, mode==2);
+	}
+}
@@ -0,0 +1,266 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QFile>
+
+#include "tests/testSatelliteCatalogStore.hpp"
+#include "SatelliteCatalogStore.hpp"
+#include "StelJsonParser.hpp"
+
+QTEST_GUILESS_MAIN(TestSatelliteCatalogStore)
+
+namespace
+{
+	// An entry of satellites.json, with the elements of the ISS changed by the number.
+	QVariantMap satelliteMap(int number)
+	{
+		QVariantMap map;
+		map.insert("name", QString("SAT %1").arg(number));
+		map.insert("tle1", QString("1 %1U 98067A   08264.51782528 -.00002182  00000-0 -11606-4 0  2927").arg(number, 5, 10, QChar('0')));
+		map.insert("tle2", QString("2 %1  51.6416 247.4627 0006703 130.5360 325.0288 15.72125391563537").arg(number, 5, 10, QChar('0')));
+		map.insert("stdMag", 2.5+number%10);
+		map.insert("status", number%8);
+		map.insert("visible", number%2==0);
+		map.insert("orbitVisible", false);
+		QVariantList color;
+		color << 0.1 << 0.4 << 0.6;
+		map.insert("hintColor", color);
+		QVariantList groups;
+		groups << "scientific" << (number%3==0 ? "amateur" : "gps");
+		map.insert("groups", groups);
+		map.insert("lastUpdated", "2017-06-01T12:30:00");
+		if (number%5==0)
+		{
+			map.insert("description", "International Space Station");
+			QVariantMap comm;
+			comm.insert("frequency", 145.8);
+			comm.insert("modulation", "FM");
+			map.insert("comms", QVariantList() << comm);
+		}
+		return map;
+	}
+
+	// Write satellites.json with satellites numbered from 1 to nbSatellites.
+	void writeCatalog(const QString& path, int nbSatellites)
+	{
+		QVariantMap satellites;
+		for (int i=1;i<=nbSatellites;++i)
+			satellites.insert(QString::number(i), satelliteMap(i));
+		QVariantMap map;
+		map.insert("creator", "Satellites plugin version 0.10.0");
+		map.insert("satellites", satellites);
+		QFile file(path);
+		QVERIFY(file.open(QIODevice::WriteOnly));
+		StelJsonParser::write(map, &file);
+	}
+
+	QVector<SatelliteCatalogEntry> readCatalog(const QString& path)
+	{
+		QVector<SatelliteCatalogEntry> entries;
+		QFile file(path);
+		if (!file.open(QIODevice::ReadOnly))
+			return entries;
+		const QVariantMap satellites = StelJsonParser::parse(&file).toMap().value("satellites").toMap();
+		for (QVariantMap::const_iterator it=satellites.constBegin();it!=satellites.constEnd();++it)
+			entries.append(SatelliteCatalogEntry::fromMap(it.key(), it.value().toMap()));
+		return entries;
+	}
+}
+
+void TestSatelliteCatalogStore::initTestCase()
+{
+	QVERIFY(tempDir.isValid());
+}
+
+void TestSatelliteCatalogStore::testJsonMap()
+{
+	const QVariantMap map = satelliteMap(25);
+	const SatelliteCatalogEntry entry = SatelliteCatalogEntry::fromMap("25", map);
+	QCOMPARE(entry.name, QString("SAT 25"));
+	QCOMPARE(entry.tle1.size(), 69);
+	QCOMPARE(entry.comms.size(), 1);
+	// A missing orbit color is the hint color.
+	QCOMPARE(entry.orbitColor, entry.hintColor);
+	QCOMPARE(entry.lastUpdated, QDateTime::fromString("2017-06-01T12:30:00", Qt::ISODate));
+
+	const QVariantMap result = entry.toMap();
+	foreach (const QString& key, map.keys())
+	{
+		if (key!="hintColor")
+			QCOMPARE(result.value(key), map.value(key));
+	}
+	QCOMPARE(result.value("hintColor").toList().at(1).toDouble(), 0.4);
+	QCOMPARE(result.value("orbitColor"), result.value("hintColor"));
+	QVERIFY(!result.contains("userDefined"));
+}
+
+void TestSatelliteCatalogStore::testStore()
+{
+	const QString jsonPath = tempDir.path()+"/store.json";
+	const QString storePath = tempDir.path()+"/store.dat";
+	writeCatalog(jsonPath, 120);
+	QVector<SatelliteCatalogEntry> entries = readCatalog(jsonPath);
+	SatelliteCatalogEntry invalid;
+	invalid.id = "1234567890123456";
+	entries.append(invalid);
+	QVERIFY(SatelliteCatalogStore::write(storePath, entries, "0.10.0", Vec3f(0.f, 0.4f, 0.6f), jsonPath));
+
+	SatelliteCatalogStore store;
+	QVERIFY(store.open(storePath));
+	QCOMPARE(store.size(), 120);
+	QCOMPARE(store.getCatalogVersion(), QString("0.10.0"));
+	QCOMPARE(store.getDefaultHintColor(), Vec3f(0.f, 0.4f, 0.6f));
+	QVERIFY(store.matchesJson(jsonPath));
+	QVERIFY(!store.isJsonExportPending());
+
+	// Sorted by catalog number
+	for (int i=0;i<store.size();++i)
+		QCOMPARE(store.getId(i), QString::number(i+1));
+	QCOMPARE(store.indexOf("100"), 99);
+	QCOMPARE(store.indexOf("121"), -1);
+	QCOMPARE(store.indexOf("0"), -1);
+
+	foreach (const SatelliteCatalogEntry& entry, entries.mid(0, 120))
+	{
+		const SatelliteCatalogEntry stored = store.getEntry(store.indexOf(entry.id));
+		QCOMPARE(stored.toMap(), entry.toMap());
+	}
+
+	// TLE export
+	QBuffer buffer;
+	QVERIFY(buffer.open(QIODevice::WriteOnly));
+	SatelliteCatalogStore::writeTle(buffer, store.getEntries().mid(24, 1));
+	const SatelliteCatalogEntry sat25 = store.getEntry(24);
+	QVERIFY(sat25.tle1.startsWith("1 00025U"));
+	QCOMPARE(buffer.data(), QByteArray("SAT 25\n") + sat25.tle1 + "\n" + sat25.tle2 + "\n");
+
+	// A changed JSON file is not the one of the store.
+	store.close();
+	writeCatalog(jsonPath, 121);
+	QVERIFY(store.open(storePath));
+	QVERIFY(!store.matchesJson(jsonPath));
+	store.close();
+
+	// Invalid files
+	QFile file(storePath);
+	QVERIFY(file.open(QIODevice::ReadWrite));
+	file.resize(1000);
+	file.close();
+	QVERIFY(!store.open(storePath));
+	QVERIFY(file.open(QIODevice::ReadWrite));
+	file.write("XXXX");
+	file.close();
+	QVERIFY(!store.open(storePath));
+}
+
+void TestSatelliteCatalogStore::testUpdateInPlace()
+{
+	const QString jsonPath = tempDir.path()+"/update.json";
+	const QString storePath = tempDir.path()+"/update.dat";
+	writeCatalog(jsonPath, 50);
+	QVERIFY(SatelliteCatalogStore::write(storePath, readCatalog(jsonPath), "0.10.0", Vec3f(0.f, 0.4f, 0.6f), jsonPath));
+	const qint64 size = QFileInfo(storePath).size();
+
+	SatelliteCatalogStore store;
+	QVERIFY(store.open(storePath));
+	SatelliteCatalogEntry entry = store.getEntry(store.indexOf("7"));
+
+	// New elements are written in the record.
+	entry.tle1[20] = '5';
+	entry.status = 7;
+	entry.lastUpdated = QDateTime::fromString("2017-07-01T00:00:00", Qt::ISODate);
+	QVERIFY(store.setEntry(store.indexOf("7"), entry));
+	QCOMPARE(QFileInfo(storePath).size(), size);
+	// A new name is appended to the file.
+	entry.name = "SAT 7 (RENAMED)";
+	QVERIFY(store.setEntry(store.indexOf("7"), entry));
+	QVERIFY(QFileInfo(storePath).size()>size);
+	// The catalog number can not change.
+	SatelliteCatalogEntry other = entry;
+	other.id = "8";
+	QVERIFY(!store.setEntry(store.indexOf("7"), other));
+	store.setJsonExportPending(true);
+	store.close();
+
+	QVERIFY(store.open(storePath));
+	QVERIFY(store.isJsonExportPending());
+	QVERIFY(store.matchesJson(jsonPath));
+	QCOMPARE(store.getEntry(store.indexOf("7")).toMap(), entry.toMap());
+	QCOMPARE(store.getEntry(store.indexOf("8")).name, QString("SAT 8"));
+}
+
+void TestSatelliteCatalogStore::benchmarkLoad_data()
+{
+	QTest::addColumn<int>("nbSatellites");
+	QTest::newRow("1000") << 1000;
+	QTest::newRow("20000") << 20000;
+	QTest::newRow("50000") << 50000;
+}
+
+void TestSatelliteCatalogStore::benchmarkLoad()
+{
+	QFETCH(int, nbSatellites);
+	const QString jsonPath = tempDir.path()+QString("/bench%1.json").arg(nbSatellites);
+	const QString storePath = tempDir.path()+QString("/bench%1.dat").arg(nbSatellites);
+	writeCatalog(jsonPath, nbSatellites);
+
+	// Startup without store: parse the JSON file, then read the entries from the maps.
+	QElapsedTimer timer;
+	timer.start();
+	const QVector<SatelliteCatalogEntry> entries = readCatalog(jsonPath);
+	const qint64 jsonTime = timer.nsecsElapsed();
+	QCOMPARE(entries.size(), nbSatellites);
+
+	QVERIFY(SatelliteCatalogStore::write(storePath, entries, "0.10.0", Vec3f(0.f, 0.4f, 0.6f), jsonPath));
+
+	// Startup with store: map the file and read the entries.
+	timer.restart();
+	SatelliteCatalogStore store;
+	QVERIFY(store.open(storePath));
+	QVERIFY(store.matchesJson(jsonPath));
+	const QVector<SatelliteCatalogEntry> stored = store.getEntries();
+	const qint64 storeTime = timer.nsecsElapsed();
+	QCOMPARE(stored.size(), nbSatellites);
+
+	// Update of all elements: write the JSON file again, or each record in place.
+	timer.restart();
+	{
+		QVariantMap satellites;
+		foreach (const SatelliteCatalogEntry& entry, stored)
+			satellites.insert(entry.id, entry.toMap());
+		QVariantMap map;
+		map.insert("satellites", satellites);
+		QFile file(jsonPath);
+		QVERIFY(file.open(QIODevice::WriteOnly));
+		StelJsonParser::write(map, &file);
+	}
+	const qint64 jsonUpdateTime = timer.nsecsElapsed();
+	timer.restart();
+	for (int i=0;i<stored.size();++i)
+		QVERIFY(store.setEntry(i, stored.at(i)));
+	const qint64 storeUpdateTime = timer.nsecsElapsed();
+
+	qDebug() << nbSatellites << "satellites: loading JSON" << jsonTime/1e6 << "ms, store" << storeTime/1e6 << "ms;"
+		 << "updating JSON" << jsonUpdateTime/1e6 << "ms, store" << storeUpdateTime/1e6 << "ms";
+}
@@ -0,0 +1,175 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+#include <QVector>
+
+#include "tests/testSatellitePasses.hpp"
+#include "SatellitePasses.hpp"
+#include "sgp4io.h"
+#include "stdsat.h"
+
+#include <cmath>
+#include <cstring>
+
+QTEST_GUILESS_MAIN(TestSatellitePasses)
+
+#define LATITUDE 48.85
+#define LONGITUDE 2.35
+#define ALTITUDE 35.
+
+static SatellitePassPredictor::Target issTarget()
+{
+	char line1[130], line2[130];
+	std::strcpy(line1, "1 25544U 98067A   08264.51782528 -.00002182  00000-0 -11606-4 0  2927");
+	std::strcpy(line2, "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.72125391563537");
+	double startmfe, stopmfe, deltamin;
+	SatellitePassPredictor::Target target;
+	target.id = "25544";
+	target.name = "ISS";
+	twoline2rv(line1, line2, 'c', 'm', 'i', wgs72, startmfe, stopmfe, deltamin, target.satrec);
+	return target;
+}
+
+// Geometric altitude of the satellite in radians, as computed by the predictor.
+static double satelliteAltitude(elsetrec& satrec, double jd)
+{
+	double r[3], v[3];
+	sgp4(wgs72, satrec, (jd-satrec.jdsatepoch)*1440., r, v);
+	const gSatFrameContext frame(jd, LATITUDE, LONGITUDE, ALTITUDE, SatellitePassPredictor::computeSunECIPos(jd));
+	const Vec3d altAz = frame.computeAltAz(Vec3d(r[0], r[1], r[2]));
+	return std::asin(altAz[2]/altAz.length());
+}
+
+void TestSatellitePasses::testPredictedEvents()
+{
+	SatellitePassPredictor::Target target = issTarget();
+	const double startJD = target.satrec.jdsatepoch;
+	const double endJD = startJD+1.;
+	const SatellitePassPredictor predictor(LATITUDE, LONGITUDE, ALTITUDE);
+	const QVector<SatellitePass> passes = predictor.predict(target, startJD, endJD);
+
+	// Scan the day every 5 seconds for the horizon crossings.
+	const double step = 5./86400.;
+	QVector<double> rises, sets;
+	double previous = satelliteAltitude(target.satrec, startJD);
+	for (double jd=startJD+step;jd<endJD;jd+=step)
+	{
+		const double alt = satelliteAltitude(target.satrec, jd);
+		if (previous<=0. && alt>0.)
+			rises.append(jd);
+		else if (previous>0. && alt<=0. && !rises.isEmpty())
+			sets.append(jd);
+		previous = alt;
+	}
+	rises.resize(sets.size());
+
+	QVERIFY(!passes.isEmpty());
+	QCOMPARE(passes.size(), rises.size());
+	for (int i=0;i<passes.size();++i)
+	{
+		const SatellitePass& pass = passes.at(i);
+		QCOMPARE(pass.id, QString("25544"));
+		QVERIFY(std::fabs(pass.riseJD-rises.at(i))<=step);
+		QVERIFY(std::fabs(pass.setJD-sets.at(i))<=step);
+		QVERIFY(pass.riseJD<pass.culminationJD && pass.culminationJD<pass.setJD);
+		QVERIFY(pass.culminationAltitude>0.f);
+		QVERIFY(std::fabs(pass.culminationAltitude-satelliteAltitude(target.satrec, pass.culminationJD))<1e-6);
+		// The culmination is the highest point of the pass.
+		for (double jd=pass.riseJD;jd<pass.setJD;jd+=step)
+			QVERIFY(satelliteAltitude(target.satrec, jd)<=pass.culminationAltitude+1e-5);
+		if (pass.isVisible())
+			QVERIFY(pass.riseJD<=pass.visibleStartJD && pass.visibleStartJD<=pass.visibleEndJD && pass.visibleEndJD<=pass.setJD);
+	}
+
+	// The parallel prediction of several satellites gives the same passes, by rise time.
+	QVector<SatellitePassPredictor::Target> targets;
+	targets << target << target;
+	targets[1].id = "99999";
+	const QVector<SatellitePass> all = predictor.predict(targets, startJD, endJD, true);
+	QCOMPARE(all.size(), 2*passes.size());
+	for (int i=1;i<all.size();++i)
+		QVERIFY(all.at(i-1).riseJD<=all.at(i).riseJD);
+}
+
+static SatellitePass makePass(const QString& id, double rise, double set, float altitude, bool visible)
+{
+	SatellitePass pass;
+	pass.id = id;
+	pass.name = "SAT " + id;
+	pass.riseJD = rise;
+	pass.culminationJD = (rise+set)/2.;
+	pass.setJD = set;
+	pass.culminationAltitude = altitude;
+	if (visible)
+	{
+		pass.visibleStartJD = rise;
+		pass.visibleEndJD = set;
+	}
+	return pass;
+}
+
+void TestSatellitePasses::testPassIndex()
+{
+	QVector<SatellitePass> passes;
+	passes << makePass("3", 10.00, 10.015, 0.5f, true)
+	       << makePass("1", 10.02, 10.05, 1.2f, false)
+	       << makePass("2", 10.04, 10.045, 0.1f, true)
+	       << makePass("1", 10.20, 10.21, 0.3f, true);
+	SatellitePassIndex index;
+	index.setPasses(passes, 10., 11.);
+	QCOMPARE(index.size(), 4);
+
+	// A pass which rose before the interval but is still above the horizon is found.
+	QVector<int> found = index.getPasses(10.042, 10.1);
+	QCOMPARE(found.size(), 2);
+	QCOMPARE(index.at(found.at(0)).id, QString("1"));
+	QCOMPARE(index.at(found.at(1)).id, QString("2"));
+	QCOMPARE(index.getPasses(10.042, 10.1, true).size(), 1);
+	QVERIFY(index.getPasses(10.3, 11.).isEmpty());
+
+	found = index.getPassesOf("1");
+	QCOMPARE(found.size(), 2);
+	QVERIFY(index.at(found.at(0)).riseJD<index.at(found.at(1)).riseJD);
+	QVERIFY(index.getPassesOf("4").isEmpty());
+
+	found = index.getSortedPasses(SatellitePassIndex::CulminationAltitude);
+	QCOMPARE(found.size(), 4);
+	QCOMPARE(index.at(found.first()).culminationAltitude, 1.2f);
+	QCOMPARE(index.at(found.last()).culminationAltitude, 0.1f);
+	found = index.getSortedPasses(SatellitePassIndex::Duration, true);
+	QCOMPARE(found.size(), 3);
+	QCOMPARE(index.at(found.first()).id, QString("3"));
+	found = index.getSortedPasses(SatellitePassIndex::SatelliteName);
+	QCOMPARE(index.at(found.first()).id, QString("1"));
+	QCOMPARE(index.at(found.last()).id, QString("3"));
+
+	bool ok;
+	QCOMPARE(SatellitePassIndex::sortKeyFromString("duration", &ok), SatellitePassIndex::Duration);
+	QVERIFY(ok);
+	SatellitePassIndex::sortKeyFromString("magnitude", &ok);
+	QVERIFY(!ok);
+
+	const QVariantMap map = SatellitePassIndex::toVariantMap(index.at(0));
+	QCOMPARE(map.value("id").toString(), QString("3"));
+	QCOMPARE(map.value("visible").toBool(), true);
+	QVERIFY(std::fabs(map.value("culmination-altitude").toDouble()-0.5*KRAD2DEG)<1e-4);
+}
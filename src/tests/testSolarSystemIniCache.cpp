@@ -0,0 +1,216 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSettings>
+#include <QTextStream>
+
+#include "tests/testSolarSystemIniCache.hpp"
+#include "SolarSystemIniCache.hpp"
+#include "StelIniParser.hpp"
+
+QTEST_GUILESS_MAIN(TestSolarSystemIniCache)
+
+namespace
+{
+	// Write a solar system file with a few planets and moons and nbAsteroids asteroids.
+	// The section names are not sorted like the dependencies.
+	void writeSolarSystem(const QString& path, int nbAsteroids)
+	{
+		QFile file(path);
+		QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+		QTextStream out(&file);
+		out << "[sun]\nname = Sun\nparent = none\nradius = 696000\ncoord_func = ell_orbit\n\n";
+		out << "[earth]\nname = Earth\nradius = 6378.1366\ncoord_func = earth_special\nalbedo = 0.306\n\n";
+		out << "[a_moon]\nname = Moon\nparent = Earth\nradius = 1738\ncoord_func = lunar_special\n\n";
+		out << "[mars]\nname = Mars\nparent = Sun\nradius = 3396.19\ncoord_func = mars_special\n\n";
+		out << "[b_phobos]\nname = Phobos\nparent = Mars\nradius = 11.1\ncoord_func = ell_orbit\n\n";
+		out << "[c_sub]\nname = Sub satellite\nparent = Phobos\nradius = 0.1\ncoord_func = ell_orbit\n\n";
+		for (int i=1;i<=nbAsteroids;++i)
+		{
+			out << "[" << i << "asteroid]\n";
+			out << "name = (" << i << ") Asteroid " << i << "\n";
+			out << "parent = Sun\ntype = asteroid\ncoord_func = comet_orbit\n";
+			out << "minor_planet_number = " << i << "\n";
+			out << "absolute_magnitude = " << 10.+i%80/10. << "\nslope_parameter = 0.15\n";
+			out << "orbit_Epoch = 2457800.5\norbit_MeanAnomaly = " << i%360 << ".123456\n";
+			out << "orbit_SemimajorAxis = " << 2.+(i%1000)/1000. << "\norbit_Eccentricity = 0." << i%97 << "\n";
+			out << "orbit_ArgOfPericenter = " << i%360 << ".5\norbit_AscendingNode = " << (7*i)%360 << ".25\n";
+			out << "orbit_Inclination = " << i%30 << ".75\nalbedo = 0.1\nradius = " << 1+i%100 << "\n\n";
+		}
+	}
+
+	QString englishName(const SolarSystemIniCache& pd, const QString& section)
+	{
+		return pd.value(section+"/name").toString();
+	}
+}
+
+void TestSolarSystemIniCache::initTestCase()
+{
+	QVERIFY(tempDir.isValid());
+}
+
+void TestSolarSystemIniCache::testOrder()
+{
+	const QString path = tempDir.path()+"/order.ini";
+	writeSolarSystem(path, 10);
+	SolarSystemIniCache pd;
+	QVERIFY(pd.loadIni(path));
+	QVERIFY(!pd.isLoadedFromCache());
+
+	const QStringList sections = pd.getOrderedSections();
+	QCOMPARE(sections.size(), 16);
+	QCOMPARE(pd.size(), 16);
+	QCOMPARE(sections.first(), QString("sun"));
+	// Each body comes after its parent.
+	QStringList created;
+	foreach (const QString& section, sections)
+	{
+		const QString parent = pd.value(section+"/parent", "Sun").toString();
+		if (parent!="none")
+			QVERIFY2(created.contains(parent), qPrintable(section));
+		created << englishName(pd, section);
+	}
+	QVERIFY(sections.indexOf("c_sub")>sections.indexOf("b_phobos"));
+}
+
+void TestSolarSystemIniCache::testValues()
+{
+	const QString path = tempDir.path()+"/values.ini";
+	writeSolarSystem(path, 50);
+	SolarSystemIniCache pd;
+	QVERIFY(pd.loadIni(path));
+
+	// Same sections, keys and values as QSettings
+	QSettings settings(path, StelIniFormat);
+	QStringList sections = pd.getOrderedSections();
+	sections.sort();
+	QCOMPARE(sections, settings.childGroups());
+	foreach (const QString& section, sections)
+	{
+		settings.beginGroup(section);
+		const QStringList keys = settings.childKeys();
+		settings.endGroup();
+		QCOMPARE(pd.childKeys(section), keys);
+		foreach (const QString& key, keys)
+			QCOMPARE(pd.value(section+"/"+key), settings.value(section+"/"+key));
+	}
+	QCOMPARE(pd.value("earth/parent", "Sun").toString(), QString("Sun"));
+	QCOMPARE(pd.value("earth/hidden", false).toBool(), false);
+	QCOMPARE(pd.value("missing/name").isValid(), false);
+	QCOMPARE(pd.value("a_moon/radius").toDouble(), 1738.);
+}
+
+void TestSolarSystemIniCache::testCache()
+{
+	const QString path = tempDir.path()+"/cache.ini";
+	const QString cachePath = tempDir.path()+"/cache/cache.ini.cache";
+	writeSolarSystem(path, 20);
+
+	SolarSystemIniCache parsed;
+	QVERIFY(parsed.load(path, cachePath));
+	QVERIFY(!parsed.isLoadedFromCache());
+	QVERIFY(QFile::exists(cachePath));
+
+	SolarSystemIniCache cached;
+	QVERIFY(cached.load(path, cachePath));
+	QVERIFY(cached.isLoadedFromCache());
+	QCOMPARE(cached.getOrderedSections(), parsed.getOrderedSections());
+	foreach (const QString& section, parsed.getOrderedSections())
+	{
+		QCOMPARE(cached.childKeys(section), parsed.childKeys(section));
+		foreach (const QString& key, parsed.childKeys(section))
+			QCOMPARE(cached.value(section+"/"+key), parsed.value(section+"/"+key));
+	}
+	cached.clear();
+
+	// A changed file is parsed again, and the cache rewritten.
+	writeSolarSystem(path, 21);
+	SolarSystemIniCache changed;
+	QVERIFY(changed.load(path, cachePath));
+	QVERIFY(!changed.isLoadedFromCache());
+	QCOMPARE(changed.size(), 27);
+	QVERIFY(changed.load(path, cachePath));
+	QVERIFY(changed.isLoadedFromCache());
+	QCOMPARE(changed.size(), 27);
+	changed.clear();
+
+	// A damaged cache is not used.
+	QFile file(cachePath);
+	QVERIFY(file.open(QIODevice::ReadWrite));
+	QVERIFY(file.resize(file.size()-2));
+	file.close();
+	SolarSystemIniCache damaged;
+	QVERIFY(damaged.load(path, cachePath));
+	QVERIFY(!damaged.isLoadedFromCache());
+	QCOMPARE(damaged.size(), 27);
+}
+
+void TestSolarSystemIniCache::benchmarkLoad_data()
+{
+	QTest::addColumn<int>("nbAsteroids");
+	QTest::newRow("1000") << 1000;
+	QTest::newRow("20000") << 20000;
+	QTest::newRow("100000") << 100000;
+}
+
+void TestSolarSystemIniCache::benchmarkLoad()
+{
+	QFETCH(int, nbAsteroids);
+	const QString path = tempDir.path()+QString("/bench%1.ini").arg(nbAsteroids);
+	const QString cachePath = path+".cache";
+	writeSolarSystem(path, nbAsteroids);
+
+	// Startup without cache: parse and order the sections, then read a value of each section.
+	QElapsedTimer timer;
+	timer.start();
+	double sum = 0.;
+	{
+		SolarSystemIniCache pd;
+		QVERIFY(pd.loadIni(path));
+		foreach (const QString& section, pd.getOrderedSections())
+			sum += pd.value(section+"/radius").toDouble();
+	}
+	const qint64 parseTime = timer.nsecsElapsed();
+
+	{
+		SolarSystemIniCache pd;
+		QVERIFY(pd.load(path, cachePath));
+	}
+
+	// Startup with cache: hash the file and map the cache.
+	timer.restart();
+	double cachedSum = 0.;
+	{
+		SolarSystemIniCache pd;
+		QVERIFY(pd.load(path, cachePath));
+		QVERIFY(pd.isLoadedFromCache());
+		foreach (const QString& section, pd.getOrderedSections())
+			cachedSum += pd.value(section+"/radius").toDouble();
+	}
+	const qint64 cacheTime = timer.nsecsElapsed();
+	QCOMPARE(cachedSum, sum);
+
+	qDebug() << nbAsteroids << "asteroids: parsing" << parseTime/1e6 << "ms, cache" << cacheTime/1e6 << "ms";
+}
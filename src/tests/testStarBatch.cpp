@@ -0,0 +1,298 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+
+#include "tests/testStarBatch.hpp"
+
+QTEST_GUILESS_MAIN(TestStarBatch)
+
+#define NB_TEST_STARS 50000
+
+// Same as the loop SpecialZoneArray::draw used before stars were decoded in blocks.
+template<class Star>
+static int scalarVisibleStars(const ZoneData& zone, const Star* first, int count, float movementFactor, int cutoffMagStep,
+			      const QVector<StarBlockCap>& caps, QVector<Vec3f>* result)
+{
+	int nb=0;
+	Vec3f vf;
+	for (const Star* s=first;s<first+count;++s)
+	{
+		if (s->getMag() > cutoffMagStep)
+			break;
+		s->getJ2000Pos(&zone, movementFactor, vf);
+		vf.normalize();
+		bool isVisible = true;
+		foreach (const StarBlockCap& cap, caps)
+		{
+			if (!(vf[0]*cap.n[0]+vf[1]*cap.n[1]+vf[2]*cap.n[2]>=cap.d))
+			{
+				isVisible = false;
+				break;
+			}
+		}
+		if (!isVisible)
+			continue;
+		if (result)
+			result->append(vf);
+		++nb;
+	}
+	return nb;
+}
+
+template<class Star>
+static int batchVisibleStars(const ZoneData& zone, const Star* first, int count, float movementFactor, int cutoffMagStep,
+			     const QVector<StarBlockCap>& caps, QVector<Vec3f>* result)
+{
+	int nb=0;
+	StarPositionBlock block;
+	const Star* last = first+count;
+	for (const Star* blockStart=first;blockStart<last;)
+	{
+		const int nbDecoded = decodeStarBlock(&zone, blockStart, last, movementFactor, cutoffMagStep, block);
+		if (nbDecoded==0)
+			break;
+		cullStarBlock(block, caps.constData(), caps.size());
+		if (result)
+		{
+			for (int i=0;i<block.count;++i)
+				result->append(block.getPos(i));
+		}
+		nb += block.count;
+		blockStart += nbDecoded;
+	}
+	return nb;
+}
+
+void TestStarBatch::initTestCase()
+{
+	qsrand(42);
+
+	// A zone of a level 7 geodesic grid is roughly 0.6 degree wide.
+	zone.center = Vec3f(0.3f, 0.4f, 0.5f);
+	zone.center.normalize();
+	zone.axis0 = Vec3f(0.f, 0.f, 1.f) ^ zone.center;
+	zone.axis0.normalize();
+	zone.axis1 = zone.center ^ zone.axis0;
+	zone.axis0 *= 0.01f/Star2::MaxPosVal;
+	zone.axis1 *= 0.01f/Star2::MaxPosVal;
+	zone.size = NB_TEST_STARS;
+	zone.stars = Q_NULLPTR;
+
+	star2Data.resize(NB_TEST_STARS*sizeof(Star2));
+	star3Data.resize(NB_TEST_STARS*sizeof(Star3));
+	for (int i=0;i<star2Data.size();++i)
+		star2Data[i] = (char)(qrand() & 0xff);
+	for (int i=0;i<star3Data.size();++i)
+		star3Data[i] = (char)(qrand() & 0xff);
+
+	// Two caps crossing the zone so that about half of the stars are culled.
+	StarBlockCap cap;
+	const Vec3d c(zone.center[0], zone.center[1], zone.center[2]);
+	Vec3d n = c + Vec3d(0.002, -0.003, 0.001);
+	n.normalize();
+	cap.n[0]=n[0]; cap.n[1]=n[1]; cap.n[2]=n[2];
+	cap.d = std::cos(0.004);
+	caps.append(cap);
+	n = c - Vec3d(0.001, 0.001, 0.);
+	n.normalize();
+	cap.n[0]=n[0]; cap.n[1]=n[1]; cap.n[2]=n[2];
+	cap.d = std::cos(0.006);
+	caps.append(cap);
+}
+
+void TestStarBatch::testNormalize()
+{
+	StarPositionBlock block;
+	for (int i=0;i<StarPositionBlock::Size-1;++i)
+	{
+		block.x[i] = (float)(qrand()%2001-1000)*0.001f;
+		block.y[i] = (float)(qrand()%2001-1000)*0.001f;
+		block.z[i] = 1.f+(float)(qrand()%1000)*0.0001f;
+		block.index[i] = i;
+	}
+	block.count = StarPositionBlock::Size-1;
+	StarPositionBlock ref = block;
+	normalizeStarBlock(block);
+	for (int i=0;i<block.count;++i)
+	{
+		Vec3f v = ref.getPos(i);
+		v.normalize();
+		QVERIFY(v==block.getPos(i));
+	}
+}
+
+void TestStarBatch::testCullStar2()
+{
+	const Star2* stars = reinterpret_cast<const Star2*>(star2Data.constData());
+	QVector<Vec3f> ref, res;
+	const int nbRef = scalarVisibleStars(zone, stars, NB_TEST_STARS, 100.f, 31, caps, &ref);
+	const int nbRes = batchVisibleStars(zone, stars, NB_TEST_STARS, 100.f, 31, caps, &res);
+	QVERIFY(nbRef>0 && nbRef<NB_TEST_STARS);
+	QCOMPARE(nbRes, nbRef);
+	QVERIFY(ref==res);
+}
+
+void TestStarBatch::testCullStar3()
+{
+	const Star3* stars = reinterpret_cast<const Star3*>(star3Data.constData());
+	QVector<Vec3f> ref, res;
+	const int nbRef = scalarVisibleStars(zone, stars, NB_TEST_STARS, 0.f, 31, caps, &ref);
+	const int nbRes = batchVisibleStars(zone, stars, NB_TEST_STARS, 0.f, 31, caps, &res);
+	QVERIFY(nbRef>0 && nbRef<NB_TEST_STARS);
+	QCOMPARE(nbRes, nbRef);
+	QVERIFY(ref==res);
+}
+
+void TestStarBatch::testMagnitudeCutoff()
+{
+	const Star3* stars = reinterpret_cast<const Star3*>(star3Data.constData());
+	int firstFaint=0;
+	while (firstFaint<NB_TEST_STARS && stars[firstFaint].getMag()<=20)
+		++firstFaint;
+	StarPositionBlock block;
+	int nb=0;
+	for (const Star3* s=stars;s<stars+NB_TEST_STARS;)
+	{
+		const int n = decodeStarBlock(&zone, s, stars+NB_TEST_STARS, 0.f, 20, block);
+		if (n==0)
+			break;
+		nb += n;
+		s += n;
+	}
+	QCOMPARE(nb, firstFaint);
+}
+
+void TestStarBatch::benchmarkScalarZoneStar2()
+{
+	const Star2* stars = reinterpret_cast<const Star2*>(star2Data.constData());
+	int nb=0;
+	QBENCHMARK {
+		nb = scalarVisibleStars(zone, stars, NB_TEST_STARS, 100.f, 31, caps, Q_NULLPTR);
+	}
+	QVERIFY(nb>0);
+}
+
+void TestStarBatch::benchmarkBatchZoneStar2()
+{
+	const Star2* stars = reinterpret_cast<const Star2*>(star2Data.constData());
+	int nb=0;
+	QBENCHMARK {
+		nb = batchVisibleStars(zone, stars, NB_TEST_STARS, 100.f, 31, caps, Q_NULLPTR);
+	}
+	QVERIFY(nb>0);
+}
+
+void TestStarBatch::benchmarkScalarZoneStar3()
+{
+	const Star3* stars = reinterpret_cast<const Star3*>(star3Data.constData());
+	int nb=0;
+	QBENCHMARK {
+		nb = scalarVisibleStars(zone, stars, NB_TEST_STARS, 0.f, 31, caps, Q_NULLPTR);
+	}
+	QVERIFY(nb>0);
+}
+
+void TestStarBatch::benchmarkBatchZoneStar3()
+{
+	const Star3* stars = reinterpret_cast<const Star3*>(star3Data.constData());
+	int nb=0;
+	QBENCHMARK {
+		nb = batchVisibleStars(zone, stars, NB_TEST_STARS, 0.f, 31, caps, Q_NULLPTR);
+	}
+	QVERIFY(nb>0);
+}
+
+// Extinction modes of the draw loop benchmark.
+enum DrawLoopExtinction
+{
+	ExtinctionOff,		// no atmosphere
+	ExtinctionForward,	// per star rotation and Extinction::forward(), as before the table
+	ExtinctionTable		// shared rotation row and Extinction::forwardFromTable()
+};
+
+// Reproduces the star loop of SpecialZoneArray::drawZone() up to the point where the
+// star is handed to the sky drawer, and returns the sum of the extincted magnitude indices.
+template<class Star>
+static int drawLoop(const ZoneData& zone, const Star* first, int count, const QVector<StarBlockCap>& caps,
+		    const Extinction& extinction, const Mat4d& m, DrawLoopExtinction mode)
+{
+	const float k = 0.001f*15000/256;
+	const int cutoffMagStep = 255;
+	const float altRow[3] = {(float)m.r[2], (float)m.r[6], (float)m.r[10]};
+	float sinAlt[StarPositionBlock::Size];
+	StarPositionBlock block;
+	int sum=0;
+	const Star* last = first+count;
+	for (const Star* blockStart=first;blockStart<last;)
+	{
+		const int nbDecoded = decodeStarBlock(&zone, blockStart, last, 100.f, cutoffMagStep, block);
+		if (nbDecoded==0)
+			break;
+		cullStarBlock(block, caps.constData(), caps.size());
+		if (mode==ExtinctionTable)
+			computeStarBlockAltitudes(block, altRow, sinAlt);
+		for (int i=0;i<block.count;++i)
+		{
+			const Star* s = blockStart + block.index[i];
+			int extinctedMagIndex = s->getMag();
+			if (mode==ExtinctionForward)
+			{
+				Vec3f altAz(block.x[i], block.y[i], block.z[i]);
+				altAz.normalize();
+				altAz.transfo4d(m);
+				float extMagShift=0.f;
+				extinction.forward(altAz, &extMagShift);
+				extinctedMagIndex += (int)(extMagShift/k);
+			}
+			else if (mode==ExtinctionTable)
+				extinctedMagIndex += (int)(extinction.forwardFromTable(sinAlt[i])/k);
+			if (extinctedMagIndex >= cutoffMagStep)
+				continue;
+			sum += extinctedMagIndex;
+		}
+		blockStart += nbDecoded;
+	}
+	return sum;
+}
+
+void TestStarBatch::benchmarkDrawLoop_data()
+{
+	QTest::addColumn<int>("mode");
+	QTest::newRow("extinction off") << (int)ExtinctionOff;
+	QTest::newRow("extinction forward") << (int)ExtinctionForward;
+	QTest::newRow("extinction table") << (int)ExtinctionTable;
+}
+
+void TestStarBatch::benchmarkDrawLoop()
+{
+	QFETCH(int, mode);
+	const Star2* stars = reinterpret_cast<const Star2*>(star2Data.constData());
+	Extinction extinction;
+	extinction.setExtinctionCoefficient(0.2f);
+	// Put the zone about 20 degrees above the horizon.
+	const Mat4d m = Mat4d::xrotation(0.6)*Mat4d::zrotation(1.1);
+	int sum=0;
+	QBENCHMARK {
+		sum = drawLoop(zone, stars, NB_TEST_STARS, caps, extinction, m, (DrawLoopExtinction)mode);
+	}
+	QVERIFY(sum>0);
+}
@@ -0,0 +1,349 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+#include <QFile>
+#include <QtEndian>
+#include <QtConcurrent>
+
+#include <cstring>
+
+#include "tests/testStarCatalogFile.hpp"
+
+QTEST_GUILESS_MAIN(TestStarCatalogFile)
+
+#define LEVEL 1
+#define NR_OF_ZONES 80
+#define RECORD_SIZE 6
+
+static void writeInt(QFile& file, quint32 x, bool swapped)
+{
+	if (swapped)
+		x = qbswap(x);
+	file.write((const char*)&x, 4);
+}
+
+QByteArray TestStarCatalogFile::readAll(const QString& path)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+		return QByteArray();
+	return file.readAll();
+}
+
+QString TestStarCatalogFile::writeCatalog(const QString& name, bool swapped)
+{
+	const QString path = dir.filePath(name);
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly))
+		return QString();
+	const quint32 header[8] = {FILE_MAGIC, 2, 0, 0, LEVEL, (quint32)-2000, 8000, 256};
+	for (int i=0;i<8;++i)
+		writeInt(file, header[i], swapped);
+	foreach (quint32 size, zoneSizes)
+		writeInt(file, size, swapped);
+	file.write(records);
+	return path;
+}
+
+void TestStarCatalogFile::compareZones(const QByteArray& paged)
+{
+	const uchar* data = (const uchar*)paged.constData();
+	const PagedZoneEntry* table = StarCatalogFile::checkPaged(data, paged.size(), NR_OF_ZONES, RECORD_SIZE);
+	QVERIFY(table != Q_NULLPTR);
+	const PagedCatalogHeader* header = (const PagedCatalogHeader*)data;
+	QCOMPARE(header->type, 2u);
+	QCOMPARE(header->level, (quint32)LEVEL);
+	QCOMPARE(header->mag_min, (quint32)-2000);
+	QCOMPARE(header->mag_range, 8000u);
+	QCOMPARE(header->mag_steps, 256u);
+	QCOMPARE(header->page_size, StarCatalogFile::PageSize);
+	qint64 recordOffset = 0;
+	for (int z=0;z<NR_OF_ZONES;++z)
+	{
+		QCOMPARE(table[z].size, zoneSizes.at(z));
+		const qint64 bytes = (qint64)table[z].size*RECORD_SIZE;
+		QVERIFY(memcmp(data+table[z].offset, records.constData()+recordOffset, bytes) == 0);
+		recordOffset += bytes;
+		if (bytes == 0)
+			continue;
+		// Zones smaller than a page stay in one page, the others start a page.
+		if (bytes <= StarCatalogFile::PageSize)
+			QCOMPARE(table[z].offset/StarCatalogFile::PageSize, (table[z].offset+bytes-1)/StarCatalogFile::PageSize);
+		else
+			QCOMPARE(table[z].offset%StarCatalogFile::PageSize, (quint64)0);
+	}
+	QCOMPARE(recordOffset, (qint64)records.size());
+}
+
+qint64 TestStarCatalogFile::openStream(QFile& file, QVector<ZoneData>& zones)
+{
+	if (!file.open(QIODevice::ReadOnly))
+		return -1;
+	zones.resize(NR_OF_ZONES);
+	file.seek(8*4);
+	for (int z=0;z<NR_OF_ZONES;++z)
+	{
+		quint32 size;
+		file.read((char*)&size, 4);
+		zones[z].size = size;
+		// Must be overwritten by the stream.
+		zones[z].stars = &zones[z];
+	}
+	return file.pos();
+}
+
+bool TestStarCatalogFile::checkZone(const QVector<ZoneData>& zones, int zone) const
+{
+	return zones.at(zone).stars != Q_NULLPTR && zones.at(zone).size == (int)zoneSizes.at(zone) &&
+	       memcmp(zones.at(zone).stars, records.constData()+recordOffsets.at(zone), zoneSizes.at(zone)*RECORD_SIZE) == 0;
+}
+
+void TestStarCatalogFile::initTestCase()
+{
+	qsrand(42);
+	QVERIFY(dir.isValid());
+	QCOMPARE(StarCatalogFile::recordSize(2), RECORD_SIZE);
+	// Mostly small zones, a few empty ones and a few larger than a page,
+	// the last one non empty so that any truncation cuts stars.
+	zoneSizes.resize(NR_OF_ZONES);
+	for (int z=0;z<NR_OF_ZONES;++z)
+	{
+		if (z%13 == 5)
+			zoneSizes[z] = 0;
+		else if (z%17 == 3)
+			zoneSizes[z] = 700 + qrand()%2000;
+		else
+			zoneSizes[z] = 1 + qrand()%300;
+	}
+	int nrOfStars = 0;
+	nrOfNonEmptyZones = 0;
+	foreach (quint32 size, zoneSizes)
+	{
+		recordOffsets.append(nrOfStars*RECORD_SIZE);
+		nrOfStars += size;
+		if (size > 0)
+			++nrOfNonEmptyZones;
+	}
+	records.resize(nrOfStars*RECORD_SIZE);
+	for (int i=0;i<records.size();++i)
+		records[i] = (char)qrand();
+}
+
+void TestStarCatalogFile::testRepack_data()
+{
+	QTest::addColumn<bool>("swapped");
+	QTest::newRow("native") << false;
+	QTest::newRow("other endian") << true;
+}
+
+void TestStarCatalogFile::testRepack()
+{
+	QFETCH(bool, swapped);
+	const QString src = writeCatalog(swapped ? "swapped.cat" : "native.cat", swapped);
+	QVERIFY(!src.isEmpty());
+	QVERIFY(!StarCatalogFile::isPaged(src));
+	const QString dst = dir.filePath(swapped ? "swapped.paged" : "native.paged");
+	QVERIFY(StarCatalogFile::repack(src, dst));
+	QVERIFY(StarCatalogFile::isPaged(dst));
+	QVERIFY(!QFile::exists(dst + ".tmp"));
+
+	// Map it the way SpecialZoneArray::mapPagedCatalog() does.
+	QFile file(dst);
+	QVERIFY(file.open(QIODevice::ReadOnly));
+	const uchar* mapped = file.map(0, file.size());
+	QVERIFY(mapped != Q_NULLPTR);
+	compareZones(QByteArray::fromRawData((const char*)mapped, file.size()));
+	// Wrong star type or grid level.
+	QVERIFY(StarCatalogFile::checkPaged(mapped, file.size(), NR_OF_ZONES, StarCatalogFile::recordSize(1)) == Q_NULLPTR);
+	QVERIFY(StarCatalogFile::checkPaged(mapped, file.size(), NR_OF_ZONES*4, RECORD_SIZE) == Q_NULLPTR);
+	file.unmap((uchar*)mapped);
+}
+
+void TestStarCatalogFile::testTruncated()
+{
+	const QString dst = dir.filePath("truncated.paged");
+	QVERIFY(StarCatalogFile::repack(writeCatalog("truncated.cat", false), dst));
+	const QByteArray paged = readAll(dst);
+	QVERIFY(StarCatalogFile::checkPaged((const uchar*)paged.constData(), paged.size(), NR_OF_ZONES, RECORD_SIZE) != Q_NULLPTR);
+	// In the stars of the last zone, in the zone table, in the header.
+	QVERIFY(StarCatalogFile::checkPaged((const uchar*)paged.constData(), paged.size()-1, NR_OF_ZONES, RECORD_SIZE) == Q_NULLPTR);
+	QVERIFY(StarCatalogFile::checkPaged((const uchar*)paged.constData(), sizeof(PagedCatalogHeader)+10, NR_OF_ZONES, RECORD_SIZE) == Q_NULLPTR);
+	QVERIFY(StarCatalogFile::checkPaged((const uchar*)paged.constData(), 8, NR_OF_ZONES, RECORD_SIZE) == Q_NULLPTR);
+
+	// A truncated source is not converted, and leaves nothing behind.
+	const QByteArray source = readAll(dir.filePath("truncated.cat"));
+	QFile file(dir.filePath("short.cat"));
+	QVERIFY(file.open(QIODevice::WriteOnly));
+	file.write(source.left(source.size()-RECORD_SIZE));
+	file.close();
+	QVERIFY(!StarCatalogFile::repack(file.fileName(), dir.filePath("short.paged")));
+	QVERIFY(!QFile::exists(dir.filePath("short.paged")));
+	QVERIFY(!QFile::exists(dir.filePath("short.paged.tmp")));
+}
+
+void TestStarCatalogFile::testCorrupted()
+{
+	const QString dst = dir.filePath("corrupted.paged");
+	QVERIFY(StarCatalogFile::repack(writeCatalog("corrupted.cat", false), dst));
+	const QByteArray paged = readAll(dst);
+	// Any change in the header or in the zone table breaks the checksum.
+	const int tableEnd = sizeof(PagedCatalogHeader) + sizeof(PagedZoneEntry)*NR_OF_ZONES;
+	for (int i=0;i<tableEnd;i+=7)
+	{
+		QByteArray corrupted = paged;
+		corrupted[i] = corrupted.at(i) ^ 0x10;
+		QVERIFY2(StarCatalogFile::checkPaged((const uchar*)corrupted.constData(), corrupted.size(), NR_OF_ZONES, RECORD_SIZE) == Q_NULLPTR,
+			 qPrintable(QString("byte %1").arg(i)));
+	}
+}
+
+void TestStarCatalogFile::testStreamLoad()
+{
+	QFile file(writeCatalog("stream.cat", false));
+	QVector<ZoneData> zones;
+	const qint64 dataStart = openStream(file, zones);
+	QCOMPARE(dataStart, (qint64)(8+NR_OF_ZONES)*4);
+	StarZoneStream stream(&file, zones.data(), NR_OF_ZONES, dataStart, RECORD_SIZE);
+	for (int z=0;z<NR_OF_ZONES;++z)
+		QVERIFY(zones.at(z).stars == Q_NULLPTR);
+	QCOMPARE(stream.getNrOfResidentZones(), 0);
+	QCOMPARE(stream.getResidentSize(), (qint64)0);
+
+	// A zone is read when it is first used, and only then.
+	QVERIFY(stream.load(3));
+	QVERIFY(checkZone(zones, 3));
+	QVERIFY(zones.at(4).stars == Q_NULLPTR);
+	QCOMPARE(stream.getNrOfPageIns(), 1);
+	QCOMPARE(stream.getNrOfResidentZones(), 1);
+	QCOMPARE(stream.getResidentSize(), (qint64)zoneSizes.at(3)*RECORD_SIZE);
+	QVERIFY(stream.load(3));
+	QCOMPARE(stream.getNrOfPageIns(), 1);
+
+	// Nothing to read for an empty zone.
+	QCOMPARE(zoneSizes.at(5), 0u);
+	QVERIFY(stream.load(5));
+	QVERIFY(zones.at(5).stars == Q_NULLPTR);
+	QCOMPARE(stream.getNrOfPageIns(), 1);
+
+	for (int z=0;z<NR_OF_ZONES;++z)
+	{
+		QVERIFY(stream.load(z));
+		if (zoneSizes.at(z) > 0)
+			QVERIFY(checkZone(zones, z));
+	}
+	QCOMPARE(stream.getNrOfPageIns(), nrOfNonEmptyZones);
+	QCOMPARE(stream.getNrOfResidentZones(), nrOfNonEmptyZones);
+	QCOMPARE(stream.getResidentSize(), (qint64)records.size());
+	QVERIFY(stream.getTableSize() >= (qint64)NR_OF_ZONES*(8+4));
+}
+
+void TestStarCatalogFile::testStreamEviction()
+{
+	QFile file(writeCatalog("evict.cat", false));
+	QVector<ZoneData> zones;
+	const qint64 dataStart = openStream(file, zones);
+	StarZoneStream stream(&file, zones.data(), NR_OF_ZONES, dataStart, RECORD_SIZE);
+	// Zone z last used at frame z+1.
+	for (int z=0;z<NR_OF_ZONES;++z)
+	{
+		stream.setUseStamp(z+1);
+		QVERIFY(stream.load(z));
+	}
+
+	// Free the least recently used zones until half of the stars fit.
+	const qint64 budget = records.size()/2;
+	QVector<StarZoneStream::ResidentZone> resident;
+	stream.getResidentZones(resident);
+	QCOMPARE(resident.size(), nrOfNonEmptyZones);
+	int n = StarZoneStream::countZonesToRelease(resident, stream.getResidentSize(), budget, NR_OF_ZONES);
+	QVERIFY(n > 0 && n < resident.size());
+	for (int i=0;i<n;++i)
+		QCOMPARE(stream.release(resident.at(i).zone), resident.at(i).size);
+	QVERIFY(stream.getResidentSize() <= budget);
+	QCOMPARE(stream.getNrOfResidentZones(), nrOfNonEmptyZones-n);
+	// The oldest zones were freed, and no more than needed.
+	const int firstKept = resident.at(n).zone;
+	for (int z=0;z<NR_OF_ZONES;++z)
+	{
+		if (z < firstKept)
+			QVERIFY(zones.at(z).stars == Q_NULLPTR);
+		else if (zoneSizes.at(z) > 0)
+			QVERIFY(checkZone(zones, z));
+	}
+	QVERIFY(stream.getResidentSize() + resident.at(n-1).size > budget);
+
+	// An evicted zone is read again when it is used again.
+	const int pageIns = stream.getNrOfPageIns();
+	stream.setUseStamp(NR_OF_ZONES+1);
+	QVERIFY(stream.load(0));
+	QVERIFY(checkZone(zones, 0));
+	QCOMPARE(stream.getNrOfPageIns(), pageIns+1);
+	QVERIFY(stream.load(firstKept));
+	QCOMPARE(stream.getNrOfPageIns(), pageIns+1);
+
+	// The zones of the current frame are never freed, even over the budget.
+	resident.clear();
+	stream.getResidentZones(resident);
+	n = StarZoneStream::countZonesToRelease(resident, stream.getResidentSize(), 0, NR_OF_ZONES+1);
+	QCOMPARE(n, resident.size()-2);
+	for (int i=0;i<n;++i)
+		stream.release(resident.at(i).zone);
+	QCOMPARE(stream.getNrOfResidentZones(), 2);
+	QVERIFY(checkZone(zones, 0));
+	QVERIFY(checkZone(zones, firstKept));
+}
+
+struct LoadZone
+{
+	LoadZone(StarZoneStream* stream, QAtomicInt* failures) : stream(stream), failures(failures) {}
+	typedef void result_type;
+	void operator()(int zone)
+	{
+		if (!stream->load(zone))
+			failures->ref();
+	}
+	StarZoneStream* stream;
+	QAtomicInt* failures;
+};
+
+void TestStarCatalogFile::testStreamParallelLoad()
+{
+	QFile file(writeCatalog("parallel.cat", false));
+	QVector<ZoneData> zones;
+	const qint64 dataStart = openStream(file, zones);
+	StarZoneStream stream(&file, zones.data(), NR_OF_ZONES, dataStart, RECORD_SIZE);
+	// Each zone loaded by several threads at once, as zones seen by several jobs.
+	QVector<int> jobs;
+	for (int i=0;i<8;++i)
+		for (int z=0;z<NR_OF_ZONES;++z)
+			jobs.append(z);
+	QAtomicInt failures(0);
+	QtConcurrent::blockingMap(jobs, LoadZone(&stream, &failures));
+	QCOMPARE(failures.load(), 0);
+	for (int z=0;z<NR_OF_ZONES;++z)
+	{
+		if (zoneSizes.at(z) > 0)
+			QVERIFY(checkZone(zones, z));
+	}
+	QCOMPARE(stream.getNrOfResidentZones(), nrOfNonEmptyZones);
+	QCOMPARE(stream.getResidentSize(), (qint64)records.size());
+}
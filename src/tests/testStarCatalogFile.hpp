@@ -0,0 +1,64 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _TESTSTARCATALOGFILE_HPP_
+#define _TESTSTARCATALOGFILE_HPP_
+
+#include <QObject>
+#include <QtTest>
+#include <QByteArray>
+#include <QTemporaryDir>
+#include <QVector>
+
+#include "StarCatalogFile.hpp"
+
+class TestStarCatalogFile : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void testRepack_data();
+	void testRepack();
+	void testTruncated();
+	void testCorrupted();
+	void testStreamLoad();
+	void testStreamEviction();
+	void testStreamParallelLoad();
+private:
+	//! Write a type 2 (Star3) catalog of level 1 with random stars.
+	//! @param swapped write the header and the zone sizes in the other byte order
+	QString writeCatalog(const QString& name, bool swapped);
+	//! Map a repacked catalog and check it against the stars written by writeCatalog().
+	void compareZones(const QByteArray& paged);
+	static QByteArray readAll(const QString& path);
+	//! Open a catalog written by writeCatalog() for streaming: set the sizes of @em zones.
+	//! @return the offset of the first star
+	qint64 openStream(QFile& file, QVector<ZoneData>& zones);
+	//! Check that the stars of a zone in memory are the stars written by writeCatalog().
+	bool checkZone(const QVector<ZoneData>& zones, int zone) const;
+
+	QTemporaryDir dir;
+	QVector<quint32> zoneSizes;
+	QByteArray records;
+	//! Offset of the stars of each zone in records.
+	QVector<int> recordOffsets;
+	int nrOfNonEmptyZones;
+};
+
+#endif // _TESTSTARCATALOGFILE_HPP_
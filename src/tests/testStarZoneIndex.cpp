@@ -0,0 +1,259 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+
+#include "tests/testStarZoneIndex.hpp"
+
+#include <algorithm>
+
+QTEST_GUILESS_MAIN(TestStarZoneIndex)
+
+// A zone of a level 7 geodesic grid is roughly 0.6 degree wide.
+#define ZONE_RADIUS 0.005f
+
+static float frand()
+{
+	return (float)qrand()/RAND_MAX;
+}
+
+// Random stars around zoneCenter, half of them in a few tight clusters,
+// sorted by magnitude like in the catalogs.
+void TestStarZoneIndex::makeStars(int n)
+{
+	const Vec3f e0 = Vec3f(0.f, 0.f, 1.f) ^ zoneCenter;
+	const Vec3f e1 = zoneCenter ^ e0;
+	QVector<Vec3f> clusters;
+	for (int i=0;i<8;++i)
+		clusters.append(Vec3f(2.f*frand()-1.f, 2.f*frand()-1.f, 0.f)*ZONE_RADIUS);
+	pos.resize(n);
+	motionDir.resize(n);
+	motion.resize(n);
+	mag.resize(n);
+	for (int i=0;i<n;++i)
+	{
+		Vec3f p(2.f*frand()-1.f, 2.f*frand()-1.f, 0.f);
+		if (i%2)
+			p = clusters.at(qrand()%clusters.size()) + p*(0.05f*ZONE_RADIUS);
+		else
+			p *= ZONE_RADIUS;
+		pos[i] = zoneCenter + e0*p[0] + e1*p[1];
+		pos[i].normalize();
+		motionDir[i] = e0*(2.f*frand()-1.f) + e1*(2.f*frand()-1.f);
+		motionDir[i].normalize();
+		motion[i] = (i%10==0) ? 1e-4f*frand() : 0.f;
+		mag[i] = qrand()%32;
+	}
+	std::sort(mag.begin(), mag.end());
+}
+
+QVector<int> TestStarZoneIndex::bruteForce(const Vec3f& v, double cosLimFov, float movementFactor, int maxMag) const
+{
+	QVector<int> result;
+	for (int i=0;i<pos.size();++i)
+	{
+		if (mag.at(i)>maxMag)
+			break;
+		Vec3f p = pos.at(i) + motionDir.at(i)*(motion.at(i)*movementFactor);
+		p.normalize();
+		if (p*v>=cosLimFov)
+			result.append(i);
+	}
+	return result;
+}
+
+QVector<int> TestStarZoneIndex::indexQuery(const StarZoneIndex& index, const Vec3f& v, double cosLimFov, float movementFactor, int maxMag) const
+{
+	struct Visitor
+	{
+		const TestStarZoneIndex* t;
+		const Vec3f& v;
+		double cosLimFov;
+		float movementFactor;
+		QVector<int>& result;
+		void operator()(int i)
+		{
+			Vec3f p = t->pos.at(i) + t->motionDir.at(i)*(t->motion.at(i)*movementFactor);
+			p.normalize();
+			if (p*v>=cosLimFov)
+				result.append(i);
+		}
+	};
+	QVector<int> result;
+	Visitor visitor = {this, v, cosLimFov, movementFactor, result};
+	// Same margin as SpecialZoneArray::searchAround for the float test.
+	index.query(v, std::acos(cosLimFov-1e-6), movementFactor, maxMag, visitor);
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+struct PickHit
+{
+	float cosDistance;
+	float mag;
+	int star;
+};
+
+// The picking path of StarMgr::searchSelectionCandidates(): collect the hits of the
+// cone, then create an object only for the best candidates.
+QList<QSharedPointer<Vec3f> > TestStarZoneIndex::pick(const StarZoneIndex* index, const Vec3f& v, double cosLimFov, int maxNbItem) const
+{
+	const QVector<int> found = index ? indexQuery(*index, v, cosLimFov, 0.f, 31) : bruteForce(v, cosLimFov, 0.f, 31);
+	QVector<PickHit> hits;
+	hits.reserve(found.size());
+	foreach (int i, found)
+	{
+		const PickHit hit = {pos.at(i)*v, 0.25f*mag.at(i), i};
+		hits.append(hit);
+	}
+	const int n = StarZoneIndex::selectPickingCandidates(hits, maxNbItem, 1000.);
+	QList<QSharedPointer<Vec3f> > result;
+	for (int i=0;i<n;++i)
+		result.append(QSharedPointer<Vec3f>(new Vec3f(pos.at(hits.at(i).star))));
+	return result;
+}
+
+void TestStarZoneIndex::initTestCase()
+{
+	qsrand(42);
+	zoneCenter = Vec3f(0.3f, 0.4f, 0.5f);
+	zoneCenter.normalize();
+}
+
+void TestStarZoneIndex::testEmpty()
+{
+	StarZoneIndex index;
+	index.build(Q_NULLPTR, Q_NULLPTR, Q_NULLPTR, 0);
+	QCOMPARE(index.getNrOfStars(), 0);
+	QCOMPARE(index.getNrOfCells(), 0);
+	pos.clear();
+	QVERIFY(indexQuery(index, zoneCenter, 0.9, 0.f, 31).isEmpty());
+}
+
+void TestStarZoneIndex::testQuery()
+{
+	makeStars(20000);
+	StarZoneIndex index;
+	index.build(pos.constData(), mag.constData(), motion.constData(), pos.size());
+	QCOMPARE(index.getNrOfStars(), pos.size());
+	QVERIFY(index.getNrOfCells()>1);
+	int nbFound=0;
+	for (int q=0;q<200;++q)
+	{
+		Vec3f v = zoneCenter + Vec3f(2.f*frand()-1.f, 2.f*frand()-1.f, 2.f*frand()-1.f)*(1.5f*ZONE_RADIUS);
+		v.normalize();
+		const double cosLimFov = std::cos(ZONE_RADIUS*(0.01+0.5*frand()));
+		const int maxMag = qrand()%34;
+		const QVector<int> ref = bruteForce(v, cosLimFov, 0.f, maxMag);
+		QCOMPARE(indexQuery(index, v, cosLimFov, 0.f, maxMag), ref);
+		nbFound += ref.size();
+	}
+	QVERIFY(nbFound>0);
+}
+
+void TestStarZoneIndex::testProperMotion()
+{
+	makeStars(20000);
+	StarZoneIndex index;
+	index.build(pos.constData(), mag.constData(), motion.constData(), pos.size());
+	for (int q=0;q<200;++q)
+	{
+		Vec3f v = zoneCenter + Vec3f(2.f*frand()-1.f, 2.f*frand()-1.f, 2.f*frand()-1.f)*ZONE_RADIUS;
+		v.normalize();
+		const double cosLimFov = std::cos(ZONE_RADIUS*0.05);
+		const float movementFactor = (q%2 ? -50.f : 50.f)*frand();
+		QCOMPARE(indexQuery(index, v, cosLimFov, movementFactor, 31), bruteForce(v, cosLimFov, movementFactor, 31));
+	}
+}
+
+void TestStarZoneIndex::testPickingCandidates()
+{
+	makeStars(5000);
+	for (int q=0;q<100;++q)
+	{
+		Vec3f v = zoneCenter + Vec3f(2.f*frand()-1.f, 2.f*frand()-1.f, 2.f*frand()-1.f)*ZONE_RADIUS;
+		v.normalize();
+		const double degreeWeight = 1e4*frand();
+		QVector<PickHit> hits;
+		for (int i=0;i<pos.size();++i)
+		{
+			const PickHit hit = {pos.at(i)*v, 0.25f*mag.at(i), i};
+			hits.append(hit);
+		}
+		// The best candidate is the one minimizing the function of StelObjectMgr::cleverFind().
+		int best = -1;
+		double bestScore = 1e30;
+		foreach (const PickHit& hit, hits)
+		{
+			const double score = degreeWeight*(180./M_PI)*std::acos(qBound(-1., (double)hit.cosDistance, 1.)) + qMin(hit.mag, 15.f);
+			if (score<bestScore)
+			{
+				bestScore = score;
+				best = hit.star;
+			}
+		}
+		QCOMPARE(StarZoneIndex::selectPickingCandidates(hits, 8, degreeWeight), 8);
+		QCOMPARE(hits.at(0).star, best);
+	}
+	QVector<PickHit> hits;
+	QCOMPARE(StarZoneIndex::selectPickingCandidates(hits, 8, 1.), 0);
+}
+
+void TestStarZoneIndex::benchmarkBruteForce_data()
+{
+	QTest::addColumn<int>("nbStars");
+	QTest::newRow("1k") << 1000;
+	QTest::newRow("10k") << 10000;
+	QTest::newRow("100k") << 100000;
+}
+
+// Picking latency with a wide field of view, where the search cone of a click covers
+// the whole zone: the old path created an object for each star of the cone.
+void TestStarZoneIndex::benchmarkBruteForce()
+{
+	QFETCH(int, nbStars);
+	makeStars(nbStars);
+	const double cosLimFov = std::cos(ZONE_RADIUS*2.);
+	int nb=0;
+	QBENCHMARK {
+		nb = pick(Q_NULLPTR, zoneCenter, cosLimFov, nbStars).size();
+	}
+	QCOMPARE(nb, nbStars);
+}
+
+void TestStarZoneIndex::benchmarkIndex_data()
+{
+	benchmarkBruteForce_data();
+}
+
+void TestStarZoneIndex::benchmarkIndex()
+{
+	QFETCH(int, nbStars);
+	makeStars(nbStars);
+	StarZoneIndex index;
+	index.build(pos.constData(), mag.constData(), motion.constData(), pos.size());
+	const double cosLimFov = std::cos(ZONE_RADIUS*2.);
+	int nb=0;
+	QBENCHMARK {
+		nb = pick(&index, zoneCenter, cosLimFov, 8).size();
+	}
+	QCOMPARE(nb, 8);
+}
@@ -0,0 +1,55 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _TESTSTARZONEINDEX_HPP_
+#define _TESTSTARZONEINDEX_HPP_
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QtTest>
+#include <QVector>
+
+#include "StarZoneIndex.hpp"
+
+class TestStarZoneIndex : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void testEmpty();
+	void testQuery();
+	void testProperMotion();
+	void testPickingCandidates();
+	void benchmarkBruteForce_data();
+	void benchmarkBruteForce();
+	void benchmarkIndex_data();
+	void benchmarkIndex();
+private:
+	void makeStars(int n);
+	QVector<int> bruteForce(const Vec3f& v, double cosLimFov, float movementFactor, int maxMag) const;
+	QVector<int> indexQuery(const StarZoneIndex& index, const Vec3f& v, double cosLimFov, float movementFactor, int maxMag) const;
+	QList<QSharedPointer<Vec3f> > pick(const StarZoneIndex* index, const Vec3f& v, double cosLimFov, int maxNbItem) const;
+	Vec3f zoneCenter;
+	QVector<Vec3f> pos;
+	QVector<Vec3f> motionDir;
+	QVector<float> motion;
+	QVector<int> mag;
+};
+
+#endif // _TESTSTARZONEINDEX_HPP_
@@ -0,0 +1,264 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include "tests/testStelJsonParseQueue.hpp"
+
+#include <QObject>
+#include <QDebug>
+#include <QTest>
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QThread>
+#include <QtMath>
+#include <cmath>
+#include <stdexcept>
+
+#include "StelJsonParseQueue.hpp"
+
+QTEST_GUILESS_MAIN(TestStelJsonParseQueue)
+
+// The generated survey covers 64x64 degrees with 6 levels of tiles
+static const int SurveyLevels = 6;
+static const double SurveySize = 64.;
+
+static int tileKey(int level, int i, int j)
+{
+	return (level*64+i)*64+j;
+}
+
+static QString tileFileName(int level, int i, int j)
+{
+	return QString("t%1_%2_%3.json").arg(level).arg(i).arg(j);
+}
+
+static QByteArray tileJson(int level, int i, int j)
+{
+	const double s = SurveySize/(1<<level);
+	const double x0 = i*s, y0 = j*s, x1 = x0+s, y1 = y0+s;
+	QString json = QString("{\"imageUrl\": \"t%1_%2_%3.png\", \"minResolution\": %4, \"maxBrightness\": 15.5,\n"
+			       "\"imageCredits\": {\"short\": \"Test survey\", \"infoUrl\": \"http://localhost/survey\"},\n"
+			       "\"worldCoords\": [[[%5,%6],[%7,%6],[%7,%8],[%5,%8]]],\n"
+			       "\"textureCoords\": [[[0,0],[1,0],[1,1],[0,1]]]")
+			.arg(level).arg(i).arg(j).arg(s/256.).arg(x0).arg(y0).arg(x1).arg(y1);
+	if (level+1<SurveyLevels)
+	{
+		json += ",\n\"subTiles\": [";
+		for (int k=0;k<4;++k)
+			json += QString("%1\"%2\"").arg(k==0 ? "" : ", ").arg(tileFileName(level+1, 2*i+k%2, 2*j+k/2));
+		json += "]";
+	}
+	json += "}\n";
+	return json.toUtf8();
+}
+
+//! Thread parsing a single file, as the tiles did before the shared queue.
+class ParseThread : public QThread
+{
+public:
+	ParseThread(const QByteArray& adata) : data(adata) {;}
+	virtual void run()
+	{
+		QBuffer buf(&data);
+		buf.open(QIODevice::ReadOnly);
+		try
+		{
+			result = StelJsonParseQueue::parse(buf);
+		}
+		catch (std::runtime_error&)
+		{
+		}
+	}
+private:
+	QByteArray data;
+	QVariantMap result;
+};
+
+void TestStelJsonParseQueue::initTestCase()
+{
+	QVERIFY(surveyDir.isValid());
+	for (int l=0;l<SurveyLevels;++l)
+	{
+		for (int i=0;i<(1<<l);++i)
+		{
+			for (int j=0;j<(1<<l);++j)
+			{
+				QFile f(surveyDir.path()+"/"+tileFileName(l, i, j));
+				QVERIFY(f.open(QIODevice::WriteOnly));
+				f.write(tileJson(l, i, j));
+			}
+		}
+	}
+}
+
+void TestStelJsonParseQueue::testPriority()
+{
+	QList<int> order;
+	ParseReceiver r0(0, &order), r1(1, &order), r2(2, &order), r3(3, &order);
+	StelJsonParseQueue queue(1, 10);
+	// The first request is started at once, the others wait for the thread
+	queue.enqueue(tileJson(0, 0, 0), false, false, 10., &r0, "parsed");
+	StelJsonParseQueue::RequestP r = queue.enqueue(tileJson(1, 0, 0), false, false, 3., &r1, "parsed");
+	queue.enqueue(tileJson(1, 1, 0), false, false, 1., &r2, "parsed");
+	queue.enqueue(tileJson(1, 0, 1), false, false, 2., &r3, "parsed");
+	QCOMPARE(queue.getRunningCount(), 1);
+	QCOMPARE(queue.getQueuedCount(), 3);
+	QTRY_COMPARE(order.size(), 4);
+	QCOMPARE(order, QList<int>() << 0 << 2 << 3 << 1);
+	QCOMPARE(r->getState(), StelJsonParseQueue::Request::Finished);
+	QVERIFY(!r->hasError());
+	QCOMPARE(r->getResult().value("imageUrl").toString(), QString("t1_0_0.png"));
+	QCOMPARE(r->getResult().value("subTiles").toList().size(), 4);
+}
+
+void TestStelJsonParseQueue::testDropAndCancel()
+{
+	QList<int> order;
+	ParseReceiver r0(0, &order), r1(1, &order), r2(2, &order), r3(3, &order), r4(4, &order), r5(5, &order);
+	StelJsonParseQueue queue(1, 2);
+	StelJsonParseQueue::RequestP a = queue.enqueue(tileJson(0, 0, 0), false, false, 0., &r0, "parsed");
+	StelJsonParseQueue::RequestP b = queue.enqueue(tileJson(1, 0, 0), false, false, 1., &r1, "parsed");
+	StelJsonParseQueue::RequestP c = queue.enqueue(tileJson(1, 1, 0), false, false, 2., &r2, "parsed");
+	// The queue is full: the least urgent request is dropped
+	StelJsonParseQueue::RequestP d = queue.enqueue(tileJson(1, 0, 1), false, false, 3., &r3, "parsed");
+	QCOMPARE(d->getState(), StelJsonParseQueue::Request::Dropped);
+	StelJsonParseQueue::RequestP e = queue.enqueue(tileJson(1, 1, 1), false, false, 0.5, &r4, "parsed");
+	QCOMPARE(c->getState(), StelJsonParseQueue::Request::Dropped);
+	QCOMPARE(queue.getQueuedCount(), 2);
+	// A dropped request is queued again with its new priority
+	queue.setPriority(d, -1.);
+	QCOMPARE(d->getState(), StelJsonParseQueue::Request::Queued);
+	QCOMPARE(b->getState(), StelJsonParseQueue::Request::Dropped);
+	// A stale request is dropped explicitly
+	queue.drop(e);
+	QCOMPARE(e->getState(), StelJsonParseQueue::Request::Dropped);
+	// The result of a running request is discarded
+	QCOMPARE(a->getState(), StelJsonParseQueue::Request::Running);
+	queue.cancel(a);
+	StelJsonParseQueue::RequestP f = queue.enqueue("{", false, false, 0., &r5, "parsed");
+	QTRY_COMPARE(order.size(), 2);
+	QTest::qWait(50);
+	QCOMPARE(order, QList<int>() << 3 << 5);
+	QCOMPARE(a->getState(), StelJsonParseQueue::Request::Cancelled);
+	QVERIFY(f->hasError());
+	QCOMPARE(queue.getQueuedCount(), 0);
+	QCOMPARE(queue.getRunningCount(), 0);
+}
+
+void TestStelJsonParseQueue::benchmarkZoom_data()
+{
+	QTest::addColumn<bool>("useQueue");
+	QTest::newRow("Thread per tile") << false;
+	QTest::newRow("Shared queue") << true;
+}
+
+void TestStelJsonParseQueue::benchmarkZoom()
+{
+	QFETCH(bool, useQueue);
+
+	// Zoom from the whole survey to a 2 degrees field while panning, one step per frame.
+	const int steps = 40;
+	const int frameMs = 10;
+	QList<int> order;
+	QHash<int, ParseReceiver*> receivers;
+	QHash<int, StelJsonParseQueue::RequestP> requests;
+	QList<ParseThread*> threads;
+	QSet<int> finalView;
+	StelJsonParseQueue queue(qMin(2, QThread::idealThreadCount()), 64);
+
+	QElapsedTimer timer;
+	timer.start();
+	for (int k=0;k<steps;++k)
+	{
+		const double t = (double)k/(steps-1);
+		const double cx = 10.+30.*t;
+		const double cy = 10.+20.*t;
+		const double fov = SurveySize*std::pow(2./SurveySize, t);
+		const int maxLevel = qBound(0, (int)std::ceil(std::log(SurveySize/fov)/std::log(2.)), SurveyLevels-1);
+
+		QSet<int> view;
+		for (int l=0;l<=maxLevel;++l)
+		{
+			const double s = SurveySize/(1<<l);
+			const int n = 1<<l;
+			const int imin = qBound(0, (int)std::floor((cx-fov/2.)/s), n-1), imax = qBound(0, (int)std::floor((cx+fov/2.)/s), n-1);
+			const int jmin = qBound(0, (int)std::floor((cy-fov/2.)/s), n-1), jmax = qBound(0, (int)std::floor((cy+fov/2.)/s), n-1);
+			for (int i=imin;i<=imax;++i)
+			{
+				for (int j=jmin;j<=jmax;++j)
+				{
+					const int key = tileKey(l, i, j);
+					view.insert(key);
+					// Parse first the tiles closest to the center of the view
+					const double priority = std::sqrt(qPow((i+0.5)*s-cx, 2)+qPow((j+0.5)*s-cy, 2));
+					if (receivers.contains(key))
+					{
+						if (useQueue)
+							queue.setPriority(requests.value(key), priority);
+						continue;
+					}
+					QFile f(surveyDir.path()+"/"+tileFileName(l, i, j));
+					QVERIFY(f.open(QIODevice::ReadOnly));
+					ParseReceiver* receiver = new ParseReceiver(key, &order);
+					receivers.insert(key, receiver);
+					if (useQueue)
+						requests.insert(key, queue.enqueue(f.readAll(), false, false, priority, receiver, "parsed"));
+					else
+					{
+						ParseThread* thread = new ParseThread(f.readAll());
+						connect(thread, SIGNAL(finished()), receiver, SLOT(parsed()));
+						threads.append(thread);
+						thread->start(QThread::LowestPriority);
+					}
+				}
+			}
+		}
+		// The tiles which left the view are not parsed
+		if (useQueue)
+		{
+			QHash<int, StelJsonParseQueue::RequestP>::ConstIterator iter;
+			for (iter=requests.constBegin();iter!=requests.constEnd();++iter)
+			{
+				if (!view.contains(iter.key()))
+					queue.drop(iter.value());
+			}
+		}
+		finalView = view;
+		QTest::qWait(frameMs);
+	}
+
+	// Wait for the tiles of the last view
+	QElapsedTimer waitTimer;
+	waitTimer.start();
+	while (!order.toSet().contains(finalView) && waitTimer.elapsed()<30000)
+		QTest::qWait(1);
+	const qint64 elapsed = timer.elapsed();
+	QVERIFY(order.toSet().contains(finalView));
+	qDebug() << "Zoom over" << steps << "frames: last view ready after" << elapsed << "ms,"
+		 << receivers.size() << "files requested," << order.size() << "parsed";
+
+	foreach (ParseThread* thread, threads)
+	{
+		thread->wait();
+		delete thread;
+	}
+	qDeleteAll(receivers);
+}
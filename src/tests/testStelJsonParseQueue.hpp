@@ -0,0 +1,55 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#ifndef _TESTSTELJSONPARSEQUEUE_HPP_
+#define _TESTSTELJSONPARSEQUEUE_HPP_
+
+#include <QObject>
+#include <QTest>
+#include <QList>
+#include <QTemporaryDir>
+
+//! Records the order in which the requests are parsed.
+class ParseReceiver : public QObject
+{
+Q_OBJECT
+public:
+	ParseReceiver(int aid, QList<int>* aorder) : id(aid), order(aorder) {;}
+public slots:
+	void parsed() {order->append(id);}
+private:
+	int id;
+	QList<int>* order;
+};
+
+class TestStelJsonParseQueue : public QObject
+{
+Q_OBJECT
+private slots:
+	void initTestCase();
+	void testPriority();
+	void testDropAndCancel();
+	void benchmarkZoom_data();
+	void benchmarkZoom();
+private:
+	//! Directory of a generated survey of JSON tiles
+	QTemporaryDir surveyDir;
+};
+
+#endif // _TESTSTELJSONPARSEQUEUE_HPP_
@@ -0,0 +1,238 @@
+/*
+ * Stellarium
+ * Copyright (C) 2017 Stellarium Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+ */
+
+#include <QObject>
+#include <QtDebug>
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include "tests/testStelPrefixTrie.hpp"
+#include "StelPrefixTrie.hpp"
+
+QTEST_GUILESS_MAIN(TestStelPrefixTrie)
+
+void TestStelPrefixTrie::testFind()
+{
+	StelPrefixTrie trie;
+	QVERIFY(trie.isEmpty());
+	trie.insert("NGC31", "NGC31");
+	trie.insert("NGC3", "NGC3");
+	trie.insert("NGC310", "NGC310");
+	trie.insert("M31", "M31");
+	trie.insert("Ced214", "Ced214");
+	trie.insert("Andromeda Galaxy", "Andromeda Galaxy");
+	trie.insert("NGC31", "NGC31");
+	QCOMPARE(trie.size(), 7);
+
+	// Values in the order of the keys, the same value of a key given twice only once
+	QStringList result;
+	QCOMPARE(trie.find("NGC3", 10, result), 3);
+	QCOMPARE(result, QStringList() << "NGC3" << "NGC31" << "NGC310");
+
+	// Case insensitive prefixes, display values kept
+	result.clear();
+	QCOMPARE(trie.find("ced", 10, result), 1);
+	QCOMPARE(result, QStringList() << "Ced214");
+	result.clear();
+	trie.find("andromeda g", 10, result);
+	QCOMPARE(result, QStringList() << "Andromeda Galaxy");
+
+	// Limited number of values, appended to the result
+	result = QStringList() << "first";
+	QCOMPARE(trie.find("N", 2, result), 2);
+	QCOMPARE(result, QStringList() << "first" << "NGC3" << "NGC31");
+
+	result.clear();
+	QCOMPARE(trie.find("NGC4", 10, result), 0);
+	QCOMPARE(trie.find("NGC310X", 10, result), 0);
+	QCOMPARE(trie.find("M", 0, result), 0);
+	QVERIFY(result.isEmpty());
+
+	// Alias keys, as the Abell spellings of the ACO designations in NebulaMgr
+	StelPrefixTrie spacedTrie;
+	spacedTrie.insert("ACO 1", "ACO 1");
+	spacedTrie.insert("Abell 1", "ACO 1");
+	spacedTrie.insert("ACO 12", "ACO 12");
+	spacedTrie.insert("Abell 12", "ACO 12");
+	QCOMPARE(spacedTrie.find("ABELL 1", 10, result), 2);
+	QCOMPARE(result, QStringList() << "ACO 1" << "ACO 12");
+	result.clear();
+	QCOMPARE(spacedTrie.find("abell 12", 10, result), 1);
+	QCOMPARE(result, QStringList() << "ACO 12");
+	result.clear();
+	QCOMPARE(spacedTrie.find("ACO 1", 10, result), 2);
+	QCOMPARE(result, QStringList() << "ACO 1" << "ACO 12");
+	result.clear();
+
+	// As in NebulaMgr::listMatchingObjects(): a value found from both spellings is listed once,
+	// and the walk goes on until the requested number of distinct values is found.
+	StelPrefixTrie designationTrie;
+	for (int i=1;i<=2;++i)
+	{
+		designationTrie.insert(QString("ACO%1").arg(i), QString("ACO%1").arg(i));
+		designationTrie.insert(QString("Abell%1").arg(i), QString("ACO%1").arg(i));
+	}
+	QCOMPARE(designationTrie.find("A", 3, result), 2);
+	QCOMPARE(result, QStringList() << "ACO1" << "ACO2");
+	result.clear();
+	for (int i=10;i<=20;++i)
+	{
+		designationTrie.insert(QString("ACO%1").arg(i), QString("ACO%1").arg(i));
+		designationTrie.insert(QString("Abell%1").arg(i), QString("ACO%1").arg(i));
+	}
+	QCOMPARE(designationTrie.find("A", 3, result), 3);
+	QCOMPARE(result, QStringList() << "ACO1" << "ACO10" << "ACO11");
+	// The values already found, e.g. in another trie, are skipped too.
+	result = QStringList() << "ACO10";
+	QCOMPARE(designationTrie.find("ACO1", 3, result), 3);
+	QCOMPARE(result, QStringList() << "ACO10" << "ACO1" << "ACO11" << "ACO12");
+	StelPrefixTrie::sortCompletions(result, 3);
+	QCOMPARE(result, QStringList() << "ACO1" << "ACO10" << "ACO11");
+	result.clear();
+
+	// The completions are sorted in the order of the walk of the trie, without case.
+	StelPrefixTrie mixedTrie;
+	const QStringList mixedKeys = QStringList() << "ngc 2" << "NGC 10" << "Ced 5" << "M 1" << "Cr 399" << "CED 50" << "ced 6";
+	foreach (const QString& key, mixedKeys)
+		mixedTrie.insert(key, key);
+	QCOMPARE(mixedTrie.find("", 100, result), mixedKeys.size());
+	QStringList sorted = mixedKeys;
+	StelPrefixTrie::sortCompletions(sorted, 100);
+	QCOMPARE(sorted, result);
+	QCOMPARE(sorted, QStringList() << "Ced 5" << "CED 50" << "ced 6" << "Cr 399" << "M 1" << "NGC 10" << "ngc 2");
+	result.clear();
+	mixedTrie.find("", 4, result);
+	sorted = mixedKeys;
+	StelPrefixTrie::sortCompletions(sorted, 4);
+	QCOMPARE(sorted, result);
+	result.clear();
+	QVERIFY(StelPrefixTrie::lessThan("ABC", "abc"));
+	QVERIFY(!StelPrefixTrie::lessThan("abc", "ABC"));
+
+	trie.clear();
+	QVERIFY(trie.isEmpty());
+	QCOMPARE(trie.find("NGC", 10, result), 0);
+}
+
+void TestStelPrefixTrie::benchmarkKeystrokes_data()
+{
+	QTest::addColumn<int>("nbObjects");
+	QTest::newRow("10000") << 10000;
+	QTest::newRow("90000") << 90000;
+}
+
+//! A designation written without and with space, as NebulaMgr shows them.
+struct TestDesignation
+{
+	QString prefix;
+	QString spacedPrefix;
+	unsigned int number;
+};
+
+void TestStelPrefixTrie::benchmarkKeystrokes()
+{
+	QFETCH(int, nbObjects);
+
+	// Catalog numbers shaped like the extended DSO catalog: NGC, IC and M, then PGC for the rest.
+	QVector<TestDesignation> designations;
+	for (int i=0;i<nbObjects;++i)
+	{
+		TestDesignation d;
+		if (i<7840)
+		{
+			d.prefix = "NGC"; d.spacedPrefix = "NGC "; d.number = i+1;
+		}
+		else if (i<7840+5386)
+		{
+			d.prefix = "IC"; d.spacedPrefix = "IC "; d.number = i-7840+1;
+		}
+		else
+		{
+			d.prefix = "PGC"; d.spacedPrefix = "PGC "; d.number = 1+(i*37)%3000000;
+		}
+		designations.append(d);
+		if (i<110)
+		{
+			d.prefix = "M"; d.spacedPrefix = "M "; d.number = i+1;
+			designations.append(d);
+		}
+	}
+
+	StelPrefixTrie trie, spacedTrie;
+	QElapsedTimer timer;
+	timer.start();
+	foreach (const TestDesignation& d, designations)
+	{
+		const QString number = QString::number(d.number);
+		trie.insert(d.prefix+number, d.prefix+number);
+		spacedTrie.insert(d.spacedPrefix+number, d.spacedPrefix+number);
+	}
+	const qint64 buildTime = timer.nsecsElapsed();
+
+	// Recorded keystrokes of the search dialog, one prefix per typed character.
+	const QStringList words = QStringList() << "M31" << "NGC 224" << "NGC7000" << "IC 1805" << "PGC 2557" << "PGC12345" << "M 42";
+	QStringList trace;
+	foreach (const QString& word, words)
+	{
+		for (int i=1;i<=word.size();++i)
+			trace << word.left(i);
+	}
+	const int maxNbItem = 13;
+
+	// The previous auto-completion: format and compare the designations of all objects at each keystroke.
+	timer.restart();
+	QList<QStringList> expected;
+	foreach (const QString& objw, trace)
+	{
+		QStringList result;
+		foreach (const TestDesignation& d, designations)
+		{
+			QString constw = QString("%1%2").arg(d.prefix).arg(d.number);
+			if (constw.startsWith(objw))
+			{
+				result << constw;
+				continue;
+			}
+			constw = QString("%1%2").arg(d.spacedPrefix).arg(d.number);
+			if (constw.startsWith(objw))
+				result << constw;
+		}
+		result.sort();
+		expected << result.mid(0, maxNbItem);
+	}
+	const qint64 scanTime = timer.nsecsElapsed();
+
+	timer.restart();
+	QList<QStringList> completions;
+	foreach (const QString& objw, trace)
+	{
+		QStringList result;
+		trie.find(objw, maxNbItem, result);
+		if (objw.contains(' '))
+			spacedTrie.find(objw, maxNbItem, result);
+		result.sort();
+		completions << result.mid(0, maxNbItem);
+	}
+	const qint64 trieTime = timer.nsecsElapsed();
+	QCOMPARE(completions, expected);
+
+	qDebug() << designations.size() << "designations," << trace.size() << "keystrokes: scan" << scanTime/1e6
+		 << "ms, trie" << trieTime/1e6 << "ms (built in" << buildTime/1e6 << "ms)";
+}
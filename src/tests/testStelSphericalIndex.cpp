@@ -22,8 +22,11 @@
 #include <QObject>
 #include <QDebug>
 #include <QTest>
+#include <QElapsedTimer>
 
 #include <stdexcept>
+#include <algorithm>
+#include <cmath>
 
 #include "StelSphereGeometry.hpp"
 #include "StelUtils.hpp"
@@ -40,6 +43,34 @@ class TestRegionObject : public StelRegionObject
 		SphericalRegionP region;
 };
 
+//! An object at a point of the sphere, as the DSO of NebulaMgr.
+class TestPointObject : public StelRegionObject
+{
+	public:
+		TestPointObject(const Vec3d& apos) : pos(apos), region(new SphericalPoint(apos)) {;}
+		virtual SphericalRegionP getRegion() const { return region; }
+		virtual Vec3d getPointInRegion() const { return pos; }
+		Vec3d pos;
+		SphericalRegionP region;
+};
+
+//! The i-th of nb points evenly spread on the sphere.
+static Vec3d spiralPoint(int i, int nb)
+{
+	const double z = 1.-(2.*i+1.)/nb;
+	const double r = std::sqrt(1.-z*z);
+	const double lon = 2.399963229728653*i;
+	return Vec3d(r*std::cos(lon), r*std::sin(lon), z);
+}
+
+//! A direction not on the grid of spiralPoint().
+static Vec3d pickDirection(int i)
+{
+	Vec3d v;
+	StelUtils::spheToRect(0.61803398875*i, std::asin(std::fmod(0.7548776662*i, 2.)-1.), v);
+	return v;
+}
+
 void TestStelSphericalIndex::initTestCase()
 {
 }
@@ -102,3 +133,341 @@ void TestStelSphericalIndex::testBase()
 	QVERIFY(countFunc.count==30000);
 }
 
+
+struct CollectFuncObject
+{
+	void operator()(const StelRegionObjectP& obj)
+	{
+		objects.append(obj);
+	}
+	QVector<StelRegionObjectP> objects;
+};
+
+void TestStelSphericalIndex::testCap()
+{
+	const int nb = 5000;
+	StelSphericalIndex grid(10);
+	QVector<StelRegionObjectP> objects;
+	for (int i=0;i<nb;++i)
+	{
+		objects.append(StelRegionObjectP(new TestPointObject(spiralPoint(i, nb))));
+		grid.insert(objects.last());
+	}
+
+	for (int p=0;p<20;++p)
+	{
+		const SphericalCap cap(pickDirection(p), std::cos(0.05*(p+1)));
+		CollectFuncObject func;
+		grid.processPointsInCap(cap, func);
+
+		int expected = 0;
+		foreach (const StelRegionObjectP& obj, objects)
+		{
+			if (cap.contains(obj->getPointInRegion()))
+			{
+				++expected;
+				QVERIFY(func.objects.contains(obj));
+			}
+		}
+		QCOMPARE(func.objects.size(), expected);
+	}
+}
+
+void TestStelSphericalIndex::testNearest()
+{
+	const int nb = 5000;
+	StelSphericalIndex grid(10);
+	QVector<StelRegionObjectP> objects;
+	for (int i=0;i<nb;++i)
+	{
+		objects.append(StelRegionObjectP(new TestPointObject(spiralPoint(i, nb))));
+		grid.insert(objects.last());
+	}
+
+	QVector<StelSphericalIndex::Neighbour> neighbours;
+	for (int p=0;p<50;++p)
+	{
+		const Vec3d v = pickDirection(p);
+		grid.findNearest(v, 5, -2., neighbours);
+		QCOMPARE(neighbours.size(), 5);
+
+		// The 5 largest cosines of a linear scan, in decreasing order
+		QVector<double> cosAngles;
+		foreach (const StelRegionObjectP& obj, objects)
+			cosAngles.append(obj->getPointInRegion()*v);
+		std::sort(cosAngles.begin(), cosAngles.end());
+		for (int i=0;i<5;++i)
+		{
+			QCOMPARE(neighbours.at(i).cosAngle, cosAngles.at(nb-1-i));
+			QCOMPARE(neighbours.at(i).obj->getPointInRegion()*v, neighbours.at(i).cosAngle);
+		}
+	}
+
+	// Limited angle: only the object in the direction is found, the others are farther.
+	const Vec3d v = spiralPoint(10, nb);
+	grid.findNearest(v, 3, std::cos(0.001), neighbours);
+	QCOMPARE(neighbours.size(), 1);
+	QVERIFY(neighbours.first().obj==objects.at(10));
+	// The south pole is far from all objects, the nearest one is about sqrt(2/nb) rad away.
+	grid.findNearest(Vec3d(0., 0., -1.), 3, std::cos(0.001), neighbours);
+	QVERIFY(neighbours.isEmpty());
+	grid.findNearest(v, 0, -2., neighbours);
+	QVERIFY(neighbours.isEmpty());
+	StelSphericalIndex emptyGrid;
+	emptyGrid.findNearest(v, 3, -2., neighbours);
+	QVERIFY(neighbours.isEmpty());
+}
+
+void TestStelSphericalIndex::benchmarkPicking_data()
+{
+	QTest::addColumn<int>("nbObjects");
+	QTest::newRow("1000") << 1000;
+	QTest::newRow("20000") << 20000;
+	QTest::newRow("90000") << 90000;
+}
+
+void TestStelSphericalIndex::benchmarkPicking()
+{
+	QFETCH(int, nbObjects);
+	// Same grid parameters as the one of NebulaMgr
+	StelSphericalIndex grid(200);
+	QVector<StelRegionObjectP> objects;
+	for (int i=0;i<nbObjects;++i)
+	{
+		objects.append(StelRegionObjectP(new TestPointObject(spiralPoint(i, nbObjects))));
+		grid.insert(objects.last());
+	}
+
+	// A click selects the nearest object, as NebulaMgr::search(const Vec3d&) did with a linear scan.
+	const int nbPicks = 1000;
+	QElapsedTimer timer;
+	timer.start();
+	QVector<const StelRegionObject*> scanned;
+	for (int p=0;p<nbPicks;++p)
+	{
+		const Vec3d v = pickDirection(p);
+		const StelRegionObject* nearest = Q_NULLPTR;
+		double maxCosAngle = -2.;
+		foreach (const StelRegionObjectP& obj, objects)
+		{
+			const double cosAngle = obj->getPointInRegion()*v;
+			if (cosAngle>maxCosAngle)
+			{
+				maxCosAngle = cosAngle;
+				nearest = obj.data();
+			}
+		}
+		scanned.append(nearest);
+	}
+	const qint64 scanTime = timer.nsecsElapsed();
+
+	QVector<StelSphericalIndex::Neighbour> neighbours;
+	qint64 gridTimes[2];
+	for (int layout=0;layout<2;++layout)
+	{
+		if (layout==1)
+			grid.compact();
+		timer.restart();
+		int found = 0;
+		for (int p=0;p<nbPicks;++p)
+		{
+			grid.findNearest(pickDirection(p), 1, -2., neighbours);
+			if (neighbours.size()==1 && neighbours.first().obj.data()==scanned.at(p))
+				++found;
+		}
+		gridTimes[layout] = timer.nsecsElapsed();
+		QCOMPARE(found, nbPicks);
+	}
+
+	qDebug() << nbObjects << "objects: picking latency, scan" << scanTime/1e3/nbPicks << "us, tree" << gridTimes[0]/1e3/nbPicks
+		 << "us, flat" << gridTimes[1]/1e3/nbPicks << "us";
+}
+
+//! A square field of view of the given size in radians around the direction (lon, lat), as StelProjector::getViewportConvexPolygon().
+static SphericalRegionP viewport(double lon, double lat, double size)
+{
+	QVector<Vec3d> contour(4);
+	StelUtils::spheToRect(lon-size/2, lat-size/2, contour[3]);
+	StelUtils::spheToRect(lon+size/2, lat-size/2, contour[2]);
+	StelUtils::spheToRect(lon+size/2, lat+size/2, contour[1]);
+	StelUtils::spheToRect(lon-size/2, lat+size/2, contour[0]);
+	return SphericalRegionP(new SphericalConvexPolygon(contour));
+}
+
+struct SumFuncObject
+{
+	SumFuncObject() : count(0), sum(0.) {;}
+	void operator()(const StelRegionObject* obj)
+	{
+		++count;
+		sum += obj->getPointInRegion()[2];
+	}
+	int count;
+	double sum;
+};
+
+void TestStelSphericalIndex::testCompact()
+{
+	const int nb = 5000;
+	StelSphericalIndex grid(10);
+	for (int i=0;i<nb;++i)
+		grid.insert(StelRegionObjectP(new TestPointObject(spiralPoint(i, nb))));
+	QVERIFY(!grid.isCompact());
+
+	// The same objects are found in both layouts
+	QList<SphericalRegionP> regions;
+	for (int i=0;i<10;++i)
+		regions << viewport(0.7*i, 0.15*i-0.7, 0.1*(i+1));
+	regions << SphericalRegionP(new SphericalCap(Vec3d(0,0,1), 0.8)) << SphericalRegionP(new AllSkySphericalRegion());
+	QVector<SumFuncObject> treeResults;
+	foreach (const SphericalRegionP& region, regions)
+	{
+		SumFuncObject func;
+		grid.processIntersectingPointInRegions(region.data(), func);
+		treeResults << func;
+	}
+	grid.compact();
+	QVERIFY(grid.isCompact());
+	for (int r=0;r<regions.size();++r)
+	{
+		SumFuncObject func;
+		grid.processIntersectingPointInRegions(regions.at(r).data(), func);
+		QVERIFY(func.count>0);
+		QCOMPARE(func.count, treeResults.at(r).count);
+		QCOMPARE(func.sum, treeResults.at(r).sum);
+	}
+	QCOMPARE(grid.count(), (unsigned int)nb);
+
+	// Inserting drops the flat layout
+	grid.insert(StelRegionObjectP(new TestPointObject(Vec3d(1,0,0))));
+	QVERIFY(!grid.isCompact());
+	QCOMPARE(grid.count(), (unsigned int)nb+1);
+	grid.compact();
+	grid.clear();
+	QVERIFY(!grid.isCompact());
+	QCOMPARE(grid.count(), 0u);
+}
+
+//! Sums the z coordinates of the elements found by index.
+struct IndexSumFuncObject
+{
+	IndexSumFuncObject(const StelSphericalIndex& agrid) : grid(agrid), count(0), sum(0.) {;}
+	void operator()(int i)
+	{
+		++count;
+		sum += grid.getFlatPoint(i)[2];
+	}
+	const StelSphericalIndex& grid;
+	int count;
+	double sum;
+};
+
+void TestStelSphericalIndex::testFlatLayout()
+{
+	const int nb = 5000;
+	StelSphericalIndex grid(10);
+	for (int i=0;i<nb;++i)
+		grid.insert(StelRegionObjectP(new TestPointObject(spiralPoint(i, nb))));
+	grid.compact();
+	QCOMPARE(grid.getFlatElementCount(), nb);
+
+	// Copy the layout without the objects, as it is saved in a file
+	QVector<double> x, y, z;
+	for (int i=0;i<grid.getFlatElementCount();++i)
+	{
+		const Vec3d p = grid.getFlatPoint(i);
+		x << p[0];
+		y << p[1];
+		z << p[2];
+	}
+	StelSphericalIndex copy;
+	QVERIFY(copy.setFlatLayout(grid.getFlatNodes(), grid.getFlatTriangles(), x, y, z));
+	QVERIFY(copy.isCompact());
+	QVERIFY(copy.getFlatObject(0).isNull());
+
+	// The same elements are found by index
+	QList<SphericalRegionP> regions;
+	for (int i=0;i<10;++i)
+		regions << viewport(0.7*i, 0.15*i-0.7, 0.1*(i+1));
+	regions << SphericalRegionP(new SphericalCap(Vec3d(0,0,1), 0.8)) << SphericalRegionP(new AllSkySphericalRegion());
+	foreach (const SphericalRegionP& region, regions)
+	{
+		SumFuncObject func;
+		grid.processIntersectingPointInRegions(region.data(), func);
+		IndexSumFuncObject indexFunc(copy);
+		copy.processPointIndicesInRegion(region.data(), indexFunc);
+		QVERIFY(indexFunc.count>0);
+		QCOMPARE(indexFunc.count, func.count);
+		QCOMPARE(indexFunc.sum, func.sum);
+	}
+
+	QVector<StelSphericalIndex::Neighbour> neighbours, copyNeighbours;
+	for (int p=0;p<20;++p)
+	{
+		const Vec3d v = pickDirection(p);
+		grid.findNearest(v, 5, -2., neighbours);
+		copy.findNearest(v, 5, -2., copyNeighbours);
+		QCOMPARE(copyNeighbours.size(), 5);
+		for (int i=0;i<5;++i)
+		{
+			QCOMPARE(copyNeighbours.at(i).index, neighbours.at(i).index);
+			QCOMPARE(copyNeighbours.at(i).cosAngle, neighbours.at(i).cosAngle);
+			QVERIFY(grid.getFlatObject(copyNeighbours.at(i).index)==neighbours.at(i).obj);
+		}
+	}
+
+	// The queries on the objects find nothing without the objects
+	QVERIFY(!copy.hasFlatObjects());
+	QVERIFY(grid.hasFlatObjects());
+	QCOMPARE(copy.count(), 0u);
+	SumFuncObject objectFunc;
+	copy.processIntersectingPointInRegions(regions.last().data(), objectFunc);
+	QCOMPARE(objectFunc.count, 0);
+	CollectFuncObject capFunc;
+	copy.processPointsInCap(SphericalCap(Vec3d(0,0,1), -1.), capFunc);
+	QVERIFY(capFunc.objects.isEmpty());
+
+	// An invalid layout leaves the container empty
+	QVector<StelSphericalIndex::FlatNode> nodes = grid.getFlatNodes();
+	nodes[0].endElement = nb+1;
+	QVERIFY(!copy.setFlatLayout(nodes, grid.getFlatTriangles(), x, y, z));
+	QVERIFY(!copy.isCompact());
+}
+
+void TestStelSphericalIndex::benchmarkDraw_data()
+{
+	QTest::addColumn<int>("nbObjects");
+	QTest::newRow("20000") << 20000;
+	QTest::newRow("90000") << 90000;
+}
+
+void TestStelSphericalIndex::benchmarkDraw()
+{
+	QFETCH(int, nbObjects);
+	// Same grid parameters as the one of NebulaMgr
+	StelSphericalIndex grid(200);
+	for (int i=0;i<nbObjects;++i)
+		grid.insert(StelRegionObjectP(new TestPointObject(spiralPoint(i, nbObjects))));
+
+	// Frames panning the sky with fields of view from 1 to 60 degrees, as NebulaMgr::draw() queries them.
+	QList<SphericalRegionP> frames;
+	for (int f=0;f<500;++f)
+		frames << viewport(0.013*f, std::sin(0.01*f), (1.+(f%60))*M_PI/180.);
+
+	qint64 times[2];
+	SumFuncObject results[2];
+	for (int layout=0;layout<2;++layout)
+	{
+		if (layout==1)
+			grid.compact();
+		QElapsedTimer timer;
+		timer.start();
+		foreach (const SphericalRegionP& frame, frames)
+			grid.processIntersectingPointInRegions(frame.data(), results[layout]);
+		times[layout] = timer.nsecsElapsed();
+	}
+	QCOMPARE(results[1].count, results[0].count);
+
+	qDebug() << nbObjects << "objects," << results[0].count/frames.size() << "per frame: tree" << times[0]/1e3/frames.size()
+		 << "us, flat" << times[1]/1e3/frames.size() << "us per frame";
+}
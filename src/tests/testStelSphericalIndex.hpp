@@ -31,6 +31,14 @@ Q_OBJECT
 private slots:
 	void initTestCase();
 	void testBase();
+	void testCap();
+	void testNearest();
+	void benchmarkPicking_data();
+	void benchmarkPicking();
+	void testCompact();
+	void testFlatLayout();
+	void benchmarkDraw_data();
+	void benchmarkDraw();
 private:
 };
 